@@ -65,6 +65,13 @@
    #error COAP_CLIENT_BLOCK_SUPPORT parameter is not valid
 #endif
 
+//CoAP Q-Block support (RFC 9177)
+#ifndef COAP_CLIENT_Q_BLOCK_SUPPORT
+   #define COAP_CLIENT_Q_BLOCK_SUPPORT DISABLED
+#elif (COAP_CLIENT_Q_BLOCK_SUPPORT != ENABLED && COAP_CLIENT_Q_BLOCK_SUPPORT != DISABLED)
+   #error COAP_CLIENT_Q_BLOCK_SUPPORT parameter is not valid
+#endif
+
 //CoAP client tick interval
 #ifndef COAP_CLIENT_TICK_INTERVAL
    #define COAP_CLIENT_TICK_INTERVAL 100
@@ -121,6 +128,27 @@
    #error COAP_CLIENT_RAND_DELAY_MAX parameter is not valid
 #endif
 
+//Maximum number of blocks in flight (Q-Block mode)
+#ifndef COAP_CLIENT_MAX_PAYLOADS
+   #define COAP_CLIENT_MAX_PAYLOADS 10
+#elif (COAP_CLIENT_MAX_PAYLOADS < 1 || COAP_CLIENT_MAX_PAYLOADS > 32)
+   #error COAP_CLIENT_MAX_PAYLOADS parameter is not valid
+#endif
+
+//Time to wait for a response to a set of blocks (Q-Block mode)
+#ifndef COAP_CLIENT_NON_TIMEOUT
+   #define COAP_CLIENT_NON_TIMEOUT 2000
+#elif (COAP_CLIENT_NON_TIMEOUT < 1000)
+   #error COAP_CLIENT_NON_TIMEOUT parameter is not valid
+#endif
+
+//Maximum number of retransmissions of a set of blocks (Q-Block mode)
+#ifndef COAP_CLIENT_NON_MAX_RETRANSMIT
+   #define COAP_CLIENT_NON_MAX_RETRANSMIT 4
+#elif (COAP_CLIENT_NON_MAX_RETRANSMIT < 1)
+   #error COAP_CLIENT_NON_MAX_RETRANSMIT parameter is not valid
+#endif
+
 //Default token length
 #ifndef COAP_CLIENT_DEFAULT_TOKEN_LEN
    #define COAP_CLIENT_DEFAULT_TOKEN_LEN 4
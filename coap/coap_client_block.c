@@ -36,6 +36,9 @@
 #include "core/net.h"
 #include "coap/coap_client.h"
 #include "coap/coap_client_block.h"
+#include "coap/coap_client_transport.h"
+#include "coap/coap_client_misc.h"
+#include "coap/coap_debug.h"
 #include "debug.h"
 #include "error.h"
 
@@ -123,6 +126,148 @@ error_t coapClientSetRxBlockSize(CoapClientRequest *request, uint_t blockSize)
    if(request->rxBlockSzx > coapClientGetMaxBlockSize())
       request->rxBlockSzx = coapClientGetMaxBlockSize();
 
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   //Q-Block mode enabled?
+   if(request->qBlock.enabled)
+   {
+      //Update the block size advertised in the Q-Block2 option (the NUM
+      //and M fields are zero)
+      coapSetUintOption(&request->message, COAP_OPT_Q_BLOCK2, 0,
+         request->rxBlockSzx);
+   }
+#endif
+
+   //Release exclusive access to the CoAP client context
+   osReleaseMutex(&request->context->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+
+/**
+ * @brief Enable or disable Q-Block mode
+ *
+ * In Q-Block mode (RFC 9177), the blocks of a body are sent as a burst of
+ * Non-confirmable messages, and only the missing blocks are transmitted
+ * again. The server must support the Q-Block1 and Q-Block2 options. This
+ * function must be called before the request is sent
+ *
+ * @param[in] request CoAP request handle
+ * @param[in] enable Enable or disable Q-Block mode
+ * @return Error code
+ **/
+
+error_t coapClientSetQBlockMode(CoapClientRequest *request, bool_t enable)
+{
+   error_t error;
+   uint32_t value;
+
+   //Make sure the CoAP request handle is valid
+   if(request == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the CoAP client context
+   osAcquireMutex(&request->context->mutex);
+
+   //The request cannot be modified while the message exchange is on-going
+   if(request->state == COAP_REQ_STATE_INIT)
+   {
+      //Check whether Q-Block mode should be enabled
+      if(enable)
+      {
+         //The client indicates that it supports Q-Block2 by including the
+         //option in the initial request (refer to RFC 9177, section 4.4)
+         value = 0;
+         COAP_SET_BLOCK_NUM(value, 0);
+         COAP_SET_BLOCK_M(value, 0);
+
+         //Set preferred block size
+         if(request->rxBlockSzx < COAP_BLOCK_SIZE_RESERVED)
+            COAP_SET_BLOCK_SZX(value, request->rxBlockSzx);
+         else
+            COAP_SET_BLOCK_SZX(value, coapClientGetMaxBlockSize());
+
+         //Add the Q-Block2 option to the request
+         error = coapSetUintOption(&request->message, COAP_OPT_Q_BLOCK2, 0,
+            value);
+      }
+      else
+      {
+         //Remove the Q-Block2 option from the request
+         error = coapDeleteOption(&request->message, COAP_OPT_Q_BLOCK2, 0);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Save Q-Block mode
+         request->qBlock.enabled = enable;
+      }
+   }
+   else
+   {
+      //Report an error
+      error = ERROR_WRONG_STATE;
+   }
+
+   //Release exclusive access to the CoAP client context
+   osReleaseMutex(&request->context->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Set the maximum number of blocks in flight
+ * @param[in] request CoAP request handle
+ * @param[in] maxPayloads Maximum number of blocks that can be sent or
+ *   requested before waiting for a response (Q-Block mode only)
+ * @return Error code
+ **/
+
+error_t coapClientSetMaxPayloads(CoapClientRequest *request,
+   uint_t maxPayloads)
+{
+   //Check parameters
+   if(request == NULL || maxPayloads == 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the CoAP client context
+   osAcquireMutex(&request->context->mutex);
+   //Limit the number of blocks in flight
+   request->qBlock.maxPayloads = MIN(maxPayloads, COAP_CLIENT_MAX_PAYLOADS);
+   //Release exclusive access to the CoAP client context
+   osReleaseMutex(&request->context->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Get statistics about the last block-wise transfer
+ * @param[in] request CoAP request handle
+ * @param[out] stats Number of blocks, retransmissions and transfer time
+ * @return Error code
+ **/
+
+error_t coapClientGetBlockStats(CoapClientRequest *request,
+   CoapClientBlockStats *stats)
+{
+   //Check parameters
+   if(request == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the CoAP client context
+   osAcquireMutex(&request->context->mutex);
+   //Copy statistics
+   *stats = request->blockStats;
    //Release exclusive access to the CoAP client context
    osReleaseMutex(&request->context->mutex);
 
@@ -155,6 +300,12 @@ error_t coapClientWriteBody(CoapClientRequest *request,
    CoapMessage *responseMsg;
    CoapCode responseCode;
 
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   //Q-Block mode enabled?
+   if(request->qBlock.enabled)
+      return coapClientWriteQBlockBody(request, data, length, written, last);
+#endif
+
    //Initialize status code
    error = NO_ERROR;
 
@@ -257,12 +408,28 @@ error_t coapClientWriteBody(CoapClientRequest *request,
             }
          }
 
+         //First block of the body?
+         if(blockPos == 0 && request->state == COAP_REQ_STATE_INIT)
+         {
+            //Reset statistics
+            memset(&request->blockStats, 0, sizeof(CoapClientBlockStats));
+            //Save the time at which the transfer started
+            request->blockStats.startTime = osGetSystemTime();
+         }
+
          //Send request
          error = coapClientSendRequest(request, NULL, NULL);
          //Any error to report?
          if(error)
             break;
 
+         //Update statistics
+         request->blockStats.blockCount++;
+         request->blockStats.retransmitCount += request->retransmitCount - 1;
+         request->blockStats.length += payloadLen;
+         request->blockStats.duration = osGetSystemTime() -
+            request->blockStats.startTime;
+
          //Point to the response message
          responseMsg = coapClientGetResponseMessage(request);
 
@@ -370,6 +537,20 @@ error_t coapClientReadBody(CoapClientRequest *request, void *data,
    CoapMessage *responseMsg;
    CoapCode responseCode;
 
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   //Q-Block mode enabled?
+   if(request->qBlock.enabled)
+   {
+      //The server uses Q-Block2 if the response carries a Q-Block2 option
+      if(request->qBlock.option != 0 || request->qBlock.next != 0 ||
+         !coapClientGetUintOption(coapClientGetResponseMessage(request),
+         COAP_OPT_Q_BLOCK2, 0, &value))
+      {
+         return coapClientReadQBlockBody(request, data, size, received);
+      }
+   }
+#endif
+
    //Initialize status code
    error = NO_ERROR;
 
@@ -464,6 +645,17 @@ error_t coapClientReadBody(CoapClientRequest *request, void *data,
                break;
             }
 
+            //First block of the body?
+            if(blockPos == 0)
+            {
+               //The first block was carried by the response to the initial
+               //request
+               request->blockStats.startTime = request->startTime;
+               request->blockStats.blockCount = 1;
+               request->blockStats.retransmitCount = request->retransmitCount - 1;
+               request->blockStats.length = payloadLen;
+            }
+
             //If the first request uses a bigger block size than the receiver
             //prefers, subsequent requests will use the preferred block size
             if(blockSzx > COAP_GET_BLOCK_SZX(value))
@@ -500,6 +692,16 @@ error_t coapClientReadBody(CoapClientRequest *request, void *data,
             //Point to the response message
             responseMsg = coapClientGetResponseMessage(request);
 
+            //Update statistics
+            request->blockStats.blockCount++;
+            request->blockStats.retransmitCount += request->retransmitCount - 1;
+            request->blockStats.duration = osGetSystemTime() -
+               request->blockStats.startTime;
+
+            //Retrieve the length of the block
+            if(!coapClientGetPayload(responseMsg, &payload, &payloadLen))
+               request->blockStats.length += payloadLen;
+
             //Retrieve response code
             error = coapClientGetResponseCode(responseMsg, &responseCode);
             //Any error to report?
@@ -545,6 +747,1184 @@ error_t coapClientReadBody(CoapClientRequest *request, void *data,
 }
 
 
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+
+/**
+ * @brief Write resource body using Q-Block1 transfers
+ *
+ * The body is sent in sets of up to MAX_PAYLOADS blocks. The server
+ * acknowledges each set with a 2.31 (Continue) response, or reports the
+ * blocks it is missing with a 4.08 (Request Entity Incomplete) response.
+ * Until the last fragment of the body, only complete blocks are sent and
+ * the remaining data must be written again by the caller
+ *
+ * @param[in] request CoAP request handle
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] last Flag indicating whether this message fragment is the last
+ * @return Error code
+ **/
+
+error_t coapClientWriteQBlockBody(CoapClientRequest *request,
+   const void *data, size_t length, size_t *written, bool_t last)
+{
+   error_t error;
+   uint_t n;
+   size_t blockSize;
+   CoapMessage *requestMsg;
+   CoapMessage *responseMsg;
+   CoapCode responseCode;
+   CoapClientQBlockState *qBlock;
+
+   //Point to the Q-Block transfer state
+   qBlock = &request->qBlock;
+   //Retrieve block size
+   blockSize = COAP_GET_BLOCK_SIZE(request->txBlockSzx);
+
+   //The caller must be told how many bytes have been consumed when the
+   //data does not end on a block boundary
+   if(!last && written == NULL && (length % blockSize) != 0)
+      return ERROR_INVALID_LENGTH;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Total number of bytes that have been written
+   if(written != NULL)
+      *written = 0;
+
+   //Send the body one set of blocks at a time
+   while(!error)
+   {
+      //No set in progress?
+      if(qBlock->option == 0)
+      {
+         //Number of blocks that can be sent
+         if(last)
+            n = MAX((length + blockSize - 1) / blockSize, 1);
+         else
+            n = length / blockSize;
+
+         //Wait for the next fragment of the body
+         if(n == 0)
+            break;
+
+         //Point to the request message
+         requestMsg = coapClientGetRequestMessage(request);
+
+         //The request cannot be accessed while the message exchange is
+         //on-going
+         if(requestMsg == NULL)
+         {
+            error = ERROR_WRONG_STATE;
+            break;
+         }
+
+         //First block of the body?
+         if(qBlock->next == 0)
+         {
+            //Reset statistics
+            memset(&request->blockStats, 0, sizeof(CoapClientBlockStats));
+            //Save the time at which the transfer started
+            request->blockStats.startTime = osGetSystemTime();
+         }
+
+         //Limit the number of blocks in flight
+         qBlock->count = MIN(n, qBlock->maxPayloads);
+
+         //Initialize the state of the set
+         qBlock->option = COAP_OPT_Q_BLOCK1;
+         qBlock->szx = request->txBlockSzx;
+         qBlock->length = MIN(qBlock->count * blockSize, length);
+         qBlock->first = qBlock->next;
+         qBlock->pending = COAP_CLIENT_Q_BLOCK_MASK(qBlock->count);
+         qBlock->sent = 0;
+         qBlock->last = (last && qBlock->count == n);
+         qBlock->inFlight = FALSE;
+      }
+
+      //The blocks of the set are read directly from the caller's buffer
+      qBlock->buffer = (uint8_t *) data;
+
+      //Send the set and wait for the server to acknowledge it
+      error = coapClientSendRequest(request, NULL, NULL);
+
+      //The set is still in progress (non-blocking mode)?
+      if(error == ERROR_WOULD_BLOCK)
+         break;
+
+      //The set is complete
+      qBlock->option = 0;
+
+      //Check status code
+      if(!error)
+      {
+         //Point to the response message
+         responseMsg = coapClientGetResponseMessage(request);
+         //Retrieve response code
+         error = coapClientGetResponseCode(responseMsg, &responseCode);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //The server acknowledges intermediate sets with a 2.31 (Continue)
+         //response, whereas the last set triggers the final response
+         if(qBlock->last)
+         {
+            if(COAP_GET_CODE_CLASS(responseCode) != COAP_CODE_CLASS_SUCCESS)
+               error = ERROR_INVALID_STATUS;
+         }
+         else
+         {
+            if(responseCode != COAP_CODE_CONTINUE)
+               error = ERROR_INVALID_STATUS;
+         }
+      }
+
+      //Any error to report?
+      if(error)
+      {
+         //Abort the transfer
+         qBlock->next = 0;
+         break;
+      }
+
+      //Update statistics
+      request->blockStats.length += qBlock->length;
+      request->blockStats.duration = osGetSystemTime() -
+         request->blockStats.startTime;
+
+      //Advance data pointer
+      data = (uint8_t *) data + qBlock->length;
+      length -= qBlock->length;
+
+      //Total number of bytes that have been written
+      if(written != NULL)
+         *written += qBlock->length;
+
+      //Number of the next block of the body
+      qBlock->next += qBlock->count;
+
+      //Last set?
+      if(qBlock->last)
+      {
+         //The body has been entirely transferred
+         qBlock->next = 0;
+
+         //Point to the request message
+         requestMsg = coapClientGetRequestMessage(request);
+
+         //Remove the Q-Block1 option and the last block from the request
+         error = coapClientDeleteOption(requestMsg, COAP_OPT_Q_BLOCK1, 0);
+
+         //Check status code
+         if(!error)
+         {
+            //Trim the existing payload
+            error = coapClientSetPayload(requestMsg, NULL, 0);
+         }
+
+         //We are done
+         break;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read resource body using Q-Block2 transfers
+ *
+ * The blocks of each set are written directly to the caller's buffer, in
+ * whatever order they arrive. When less than one block fits in the buffer,
+ * a single block is requested and read from the response message
+ *
+ * @param[in] request CoAP request handle
+ * @param[out] data Buffer into which received data will be placed
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @return Error code
+ **/
+
+error_t coapClientReadQBlockBody(CoapClientRequest *request, void *data,
+   size_t size, size_t *received)
+{
+   error_t error;
+   size_t n;
+   uint32_t value;
+   size_t payloadLen;
+   const uint8_t *payload;
+   CoapMessage *requestMsg;
+   CoapMessage *responseMsg;
+   CoapCode responseCode;
+   CoapClientQBlockState *qBlock;
+
+   //Point to the Q-Block transfer state
+   qBlock = &request->qBlock;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Total number of bytes that have been received
+   *received = 0;
+
+   //First call for this body?
+   if(qBlock->next == 0 && qBlock->option == 0)
+   {
+      //Point to the response message
+      responseMsg = coapClientGetResponseMessage(request);
+
+      //The first block is carried by the response to the initial request
+      error = coapClientGetUintOption(responseMsg, COAP_OPT_Q_BLOCK2, 0,
+         &value);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The value 7 for SZX is reserved
+      if(COAP_GET_BLOCK_NUM(value) != 0 ||
+         COAP_GET_BLOCK_SZX(value) >= COAP_BLOCK_SIZE_RESERVED)
+      {
+         return ERROR_FAILURE;
+      }
+
+      //Save block parameters
+      qBlock->szx = (CoapBlockSize) COAP_GET_BLOCK_SZX(value);
+      qBlock->next = 1;
+      qBlock->last = !COAP_GET_BLOCK_M(value);
+
+      //The server sends the remaining blocks of the first set without
+      //waiting for a further request (refer to RFC 9177, section 4.4)
+      qBlock->inFlight = COAP_GET_BLOCK_M(value);
+
+      //Retrieve the length of the first block
+      error = coapClientGetPayload(responseMsg, &payload, &payloadLen);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Initialize statistics
+      request->blockStats.startTime = request->startTime;
+      request->blockStats.duration = osGetSystemTime() - request->startTime;
+      request->blockStats.blockCount = 1;
+      request->blockStats.retransmitCount = request->retransmitCount - 1;
+      request->blockStats.length = payloadLen;
+   }
+
+   //Receive the body one set of blocks at a time
+   while(*received < size)
+   {
+      //No set in progress?
+      if(qBlock->option == 0)
+      {
+         //Point to the response message
+         responseMsg = coapClientGetResponseMessage(request);
+
+         //Read the data that remains in the response message
+         error = coapClientReadPayload(responseMsg, data, size - *received, &n);
+
+         //Check status code
+         if(error == NO_ERROR)
+         {
+            //Advance data pointer
+            data = (uint8_t *) data + n;
+            //Total number of bytes that have been received
+            *received += n;
+            //Continue processing
+            continue;
+         }
+         else if(error != ERROR_END_OF_STREAM)
+         {
+            //Failed to read payload data
+            break;
+         }
+
+         //Last block of the body?
+         if(qBlock->last)
+         {
+            //The body has been entirely received
+            qBlock->next = 0;
+            break;
+         }
+
+         //Point to the request message
+         requestMsg = coapClientGetRequestMessage(request);
+
+         //The request cannot be accessed while the message exchange is
+         //on-going
+         if(requestMsg == NULL)
+         {
+            error = ERROR_WRONG_STATE;
+            break;
+         }
+
+         //Number of complete blocks that fit in the buffer
+         n = (size - *received) / COAP_GET_BLOCK_SIZE(qBlock->szx);
+
+         //Initialize the state of the set
+         qBlock->option = COAP_OPT_Q_BLOCK2;
+         qBlock->first = qBlock->next;
+         qBlock->length = 0;
+
+         //Check whether a complete block fits in the buffer
+         if(n > 0)
+         {
+            //The blocks are written directly to the caller's buffer
+            qBlock->buffer = data;
+            qBlock->count = MIN(n, qBlock->maxPayloads);
+         }
+         else
+         {
+            //A single block is read from the response message
+            qBlock->buffer = NULL;
+            qBlock->count = 1;
+         }
+
+         //Blocks that have not been received yet
+         qBlock->pending = COAP_CLIENT_Q_BLOCK_MASK(qBlock->count);
+
+         //Blocks that are already on their way must not be requested again
+         //until they are known to be missing
+         if(qBlock->inFlight)
+            qBlock->sent = qBlock->pending;
+         else
+            qBlock->sent = 0;
+
+         //Initialize status code
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Resume the set that is in progress (non-blocking mode)
+         if(qBlock->buffer != NULL)
+            qBlock->buffer = data;
+      }
+
+      //Request the blocks of the set and wait for them to be received
+      error = coapClientSendRequest(request, NULL, NULL);
+
+      //The set is still in progress (non-blocking mode)?
+      if(error == ERROR_WOULD_BLOCK)
+         break;
+
+      //The set is complete
+      qBlock->option = 0;
+      qBlock->inFlight = FALSE;
+
+      //Check status code
+      if(!error)
+      {
+         //Point to the response message
+         responseMsg = coapClientGetResponseMessage(request);
+         //Retrieve response code
+         error = coapClientGetResponseCode(responseMsg, &responseCode);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Check response code
+         if(COAP_GET_CODE_CLASS(responseCode) != COAP_CODE_CLASS_SUCCESS)
+         {
+            error = ERROR_INVALID_STATUS;
+         }
+         else if(qBlock->pending != 0)
+         {
+            //The server has not used Q-Block2 to send the blocks of the set
+            error = ERROR_FAILURE;
+         }
+         else
+         {
+            //Just for sanity
+         }
+      }
+
+      //Any error to report?
+      if(error)
+      {
+         //Abort the transfer
+         qBlock->next = 0;
+         break;
+      }
+
+      //Update statistics
+      request->blockStats.duration = osGetSystemTime() -
+         request->blockStats.startTime;
+
+      //Check whether the blocks were written to the caller's buffer
+      if(qBlock->buffer != NULL)
+      {
+         //Advance data pointer
+         data = (uint8_t *) data + qBlock->length;
+         //Total number of bytes that have been received
+         *received += qBlock->length;
+
+         //Number of the next block of the body
+         qBlock->next = qBlock->first + qBlock->count;
+
+         //The payload of the last block received has already been copied
+         responseMsg->pos = responseMsg->length;
+      }
+      else
+      {
+         //Retrieve the parameters of the block held in the response
+         error = coapClientGetUintOption(responseMsg, COAP_OPT_Q_BLOCK2, 0,
+            &value);
+         //Any error to report?
+         if(error)
+         {
+            //Abort the transfer
+            qBlock->next = 0;
+            break;
+         }
+
+         //Number of the next block of the body
+         qBlock->next = COAP_GET_BLOCK_NUM(value) + 1;
+      }
+   }
+
+   //Any data received?
+   if(*received > 0)
+   {
+      //Catch exception
+      if(error == ERROR_END_OF_STREAM)
+         error = NO_ERROR;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process events related to a Q-Block set
+ * @param[in] request CoAP request handle
+ * @return Error code
+ **/
+
+error_t coapClientProcessQBlockEvents(CoapClientRequest *request)
+{
+   error_t error;
+   systime_t time;
+   CoapClientQBlockState *qBlock;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Point to the Q-Block transfer state
+   qBlock = &request->qBlock;
+
+   //Check current state
+   if(request->state == COAP_REQ_STATE_TRANSMIT)
+   {
+      //Send the pending blocks of the set
+      error = coapClientSendQBlockSet(request);
+   }
+   else if(request->state == COAP_REQ_STATE_RECEIVE)
+   {
+      //Check whether the timeout has elapsed
+      if(timeCompare(time, request->startTime + request->timeout) >= 0)
+      {
+         //Report a timeout error
+         error = coapClientChangeRequestState(request, COAP_REQ_STATE_TIMEOUT);
+      }
+      else if(timeCompare(time, request->retransmitStartTime +
+         request->retransmitTimeout) >= 0)
+      {
+         //Check retransmission counter
+         if(request->retransmitCount < COAP_CLIENT_NON_MAX_RETRANSMIT)
+         {
+            //If no response is received, the client sends the last block of
+            //the set again to elicit a response from the server, whereas
+            //the missing blocks of a Q-Block2 set are requested again
+            if(qBlock->option == COAP_OPT_Q_BLOCK1)
+               qBlock->pending = 1UL << (qBlock->count - 1);
+
+            //Retransmit the set
+            error = coapClientChangeRequestState(request,
+               COAP_REQ_STATE_TRANSMIT);
+         }
+         else
+         {
+            //The attempt to transfer the set is canceled
+            error = coapClientChangeRequestState(request,
+               COAP_REQ_STATE_TIMEOUT);
+         }
+      }
+      else
+      {
+         //Just for sanity
+      }
+   }
+   else
+   {
+      //Just for sanity
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the pending blocks of a Q-Block set
+ * @param[in] request CoAP request handle
+ * @return Error code
+ **/
+
+error_t coapClientSendQBlockSet(CoapClientRequest *request)
+{
+   error_t error;
+   uint_t i;
+   uint_t k;
+   size_t n;
+   size_t blockSize;
+   uint32_t num;
+   uint32_t value;
+   uint8_t type;
+   uint8_t token[COAP_MAX_TOKEN_LEN];
+   CoapMessageHeader *header;
+   CoapClientQBlockState *qBlock;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Point to the CoAP message header
+   header = (CoapMessageHeader *) request->message.buffer;
+   //Point to the Q-Block transfer state
+   qBlock = &request->qBlock;
+   //Retrieve block size
+   blockSize = COAP_GET_BLOCK_SIZE(qBlock->szx);
+
+   //Save the type and the token of the request
+   type = header->type;
+   memcpy(token, header->token, header->tokenLen);
+
+   //Number of messages sent in the burst
+   qBlock->midCount = 0;
+
+   //Check the type of transfer
+   if(qBlock->inFlight)
+   {
+      //The blocks of the first Q-Block2 set have been requested by the
+      //initial request and are already on their way
+      qBlock->inFlight = FALSE;
+   }
+   else if(qBlock->option == COAP_OPT_Q_BLOCK1)
+   {
+      //Send the pending blocks of the body
+      for(i = 0; i < qBlock->count && !error; i++)
+      {
+         //Skip the blocks that have been received by the server
+         if((qBlock->pending & (1UL << i)) == 0)
+            continue;
+
+         //Length of the current block
+         n = MIN(blockSize, qBlock->length - i * blockSize);
+
+         //The M bit is cleared in the last block of the body
+         value = 0;
+         COAP_SET_BLOCK_NUM(value, qBlock->first + i);
+         COAP_SET_BLOCK_M(value, !qBlock->last || i < (qBlock->count - 1));
+         COAP_SET_BLOCK_SZX(value, qBlock->szx);
+
+         //Q-Block1 option is used in descriptive usage in a request
+         error = coapSetUintOption(&request->message, COAP_OPT_Q_BLOCK1, 0,
+            value);
+
+         //Check status code
+         if(!error)
+         {
+            //Copy the block
+            error = coapSetPayload(&request->message,
+               qBlock->buffer + i * blockSize, n);
+         }
+
+         //Check status code
+         if(!error)
+         {
+            //Send the block
+            error = coapClientSendQBlockMessage(request, token,
+               qBlock->first + i);
+         }
+
+         //Update statistics
+         if((qBlock->sent & (1UL << i)) != 0)
+            request->blockStats.retransmitCount++;
+         else
+            request->blockStats.blockCount++;
+
+         //The block has been sent
+         qBlock->sent |= 1UL << i;
+      }
+
+      //The server will report the blocks it is missing
+      qBlock->pending = 0;
+   }
+   else
+   {
+      //Remove the Q-Block2 options of the previous request
+      while(!error && !coapGetUintOption(&request->message,
+         COAP_OPT_Q_BLOCK2, 0, &value))
+      {
+         error = coapDeleteOption(&request->message, COAP_OPT_Q_BLOCK2, 0);
+      }
+
+      //The response to the request carries its token
+      num = qBlock->first;
+
+      //A single request can ask for several blocks by including one
+      //Q-Block2 option per block (refer to RFC 9177, section 4.4)
+      for(i = 0, k = 0; i < qBlock->count && !error; i++)
+      {
+         //Skip the blocks that have already been received
+         if((qBlock->pending & (1UL << i)) == 0)
+            continue;
+
+         //Keep track of the first missing block
+         if(k == 0)
+            num = qBlock->first + i;
+
+         //The M bit has no function in a request
+         value = 0;
+         COAP_SET_BLOCK_NUM(value, qBlock->first + i);
+         COAP_SET_BLOCK_M(value, 0);
+         COAP_SET_BLOCK_SZX(value, qBlock->szx);
+
+         //Q-Block2 option is used in control usage in a request
+         error = coapSetUintOption(&request->message, COAP_OPT_Q_BLOCK2, k++,
+            value);
+
+         //Update statistics
+         if((qBlock->sent & (1UL << i)) != 0)
+            request->blockStats.retransmitCount++;
+
+         //The block has been requested
+         qBlock->sent |= 1UL << i;
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Send the request
+         error = coapClientSendQBlockMessage(request, token, num);
+      }
+   }
+
+   //Restore the type and the token of the request
+   header->type = type;
+   memcpy(header->token, token, header->tokenLen);
+
+   //Check status code
+   if(!error)
+   {
+      //Save the time at which the set was sent
+      request->retransmitStartTime = osGetSystemTime();
+
+      //Check retransmission counter
+      if(request->retransmitCount == 0)
+      {
+         //Save request start time
+         request->startTime = request->retransmitStartTime;
+         //Initial timeout
+         request->retransmitTimeout = COAP_CLIENT_NON_TIMEOUT;
+      }
+      else
+      {
+         //The timeout is doubled
+         request->retransmitTimeout *= 2;
+      }
+
+      //Increment retransmission counter
+      request->retransmitCount++;
+
+      //Wait for a response to be received
+      error = coapClientChangeRequestState(request, COAP_REQ_STATE_RECEIVE);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send a message that belongs to a Q-Block set
+ * @param[in] request CoAP request handle
+ * @param[in] token Token of the request
+ * @param[in] num Number of the block the message relates to
+ * @return Error code
+ **/
+
+error_t coapClientSendQBlockMessage(CoapClientRequest *request,
+   const uint8_t *token, uint32_t num)
+{
+   CoapMessageHeader *header;
+
+   //Point to the CoAP message header
+   header = (CoapMessageHeader *) request->message.buffer;
+
+   //Blocks are carried by Non-confirmable messages, so that a whole set
+   //can be sent without waiting for acknowledgments
+   header->type = COAP_TYPE_NON;
+
+   //Each message uses its own token, derived from the token of the request
+   coapClientFormatQBlockToken(header, token, num);
+
+   //The message ID is a 16-bit unsigned integer that is generated by
+   //the sender of a Confirmable or Non-confirmable message
+   coapClientGenerateMessageId(request->context, header);
+
+   //Keep track of the message IDs of the burst
+   if(request->qBlock.midCount++ == 0)
+      request->qBlock.mid = ntohs(header->mid);
+
+   //Debug message
+   TRACE_INFO("Sending CoAP message (%" PRIuSIZE " bytes)...\r\n",
+      request->message.length);
+
+   //Dump the contents of the message for debugging purpose
+   coapDumpMessage(request->message.buffer, request->message.length);
+
+   //Send CoAP message
+   return coapClientSendDatagram(request->context, request->message.buffer,
+      request->message.length);
+}
+
+
+/**
+ * @brief Check whether a response relates to the current Q-Block set
+ * @param[in] request CoAP request handle
+ * @param[in] response Pointer to the response message
+ * @return Error code
+ **/
+
+error_t coapClientMatchQBlockResponse(const CoapClientRequest *request,
+   const CoapMessage *response)
+{
+   error_t error;
+   uint32_t num;
+   const CoapMessageHeader *reqHeader;
+   const CoapMessageHeader *respHeader;
+
+   //Get CoAP request and response headers
+   reqHeader = (CoapMessageHeader *) request->message.buffer;
+   respHeader = (CoapMessageHeader *) response->buffer;
+
+   //Initialize status code
+   error = ERROR_UNEXPECTED_MESSAGE;
+
+   //Check the type of the response
+   if(respHeader->type == COAP_TYPE_CON ||
+      respHeader->type == COAP_TYPE_NON)
+   {
+      //Retrieve the block number encoded in the token
+      if(!coapClientGetQBlockTokenNum(reqHeader, respHeader, &num))
+      {
+         //Short tokens wrap around and cannot be used to discard the
+         //responses that relate to subsequent blocks
+         if(reqHeader->tokenLen < 4 ||
+            num < request->qBlock.first + request->qBlock.count)
+         {
+            //A matching response has been received
+            error = NO_ERROR;
+         }
+      }
+   }
+   else if(respHeader->type == COAP_TYPE_RST)
+   {
+      //The message ID of the Reset must match the message ID of one of the
+      //messages of the last burst
+      if((uint16_t) (ntohs(respHeader->mid) - request->qBlock.mid) <
+         request->qBlock.midCount)
+      {
+         //A matching response has been received
+         error = NO_ERROR;
+      }
+   }
+   else
+   {
+      //Just for sanity
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a response that relates to the current Q-Block set
+ * @param[in] request CoAP request handle
+ * @param[in] response Pointer to the response message
+ * @return Error code
+ **/
+
+error_t coapClientProcessQBlockResponse(CoapClientRequest *request,
+   const CoapMessage *response)
+{
+   error_t error;
+   uint_t n;
+   uint32_t i;
+   uint32_t num;
+   uint32_t mask;
+   uint32_t value;
+   size_t blockSize;
+   size_t payloadLen;
+   const uint8_t *payload;
+   const CoapMessageHeader *reqHeader;
+   const CoapMessageHeader *respHeader;
+   CoapClientQBlockState *qBlock;
+
+   //Get CoAP request and response headers
+   reqHeader = (CoapMessageHeader *) request->message.buffer;
+   respHeader = (CoapMessageHeader *) response->buffer;
+
+   //Point to the Q-Block transfer state
+   qBlock = &request->qBlock;
+   //Retrieve block size
+   blockSize = COAP_GET_BLOCK_SIZE(qBlock->szx);
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Check the type of the response
+   if(respHeader->type == COAP_TYPE_RST)
+   {
+      //A Reset message indicates that the request was received by the server,
+      //but some context is missing to properly process it
+      error = coapClientChangeRequestState(request, COAP_REQ_STATE_RESET);
+   }
+   else if(qBlock->option == COAP_OPT_Q_BLOCK1)
+   {
+      //Retrieve the block number encoded in the token
+      coapClientGetQBlockTokenNum(reqHeader, respHeader, &num);
+
+      //Short tokens wrap around
+      if(reqHeader->tokenLen < 4)
+         mask = (1UL << (reqHeader->tokenLen * 8)) - 1;
+      else
+         mask = 0xFFFFFFFF;
+
+      //Index of the block within the set
+      i = (num - qBlock->first) & mask;
+
+      //Discard the responses that relate to a previous set
+      if(i < qBlock->count)
+      {
+         //Check response code
+         if(respHeader->code == COAP_CODE_CONTINUE)
+         {
+            //The server may use a smaller set size, in which case it sends
+            //a 2.31 response before the end of the set
+            if(i == (qBlock->count - 1) || reqHeader->tokenLen == 0)
+            {
+               //All the blocks of the set have been received by the server
+               error = coapClientChangeRequestState(request,
+                  COAP_REQ_STATE_DONE);
+            }
+         }
+         else if(respHeader->code == COAP_CODE_REQUEST_ENTITY_INCOMPLETE)
+         {
+            //The payload of the response lists the missing blocks
+            error = coapGetPayload(response, &payload, &payloadLen);
+
+            //Check status code
+            if(!error && payloadLen > 0)
+            {
+               //Parse the list of missing blocks
+               error = coapClientParseMissingBlocks(request, payload,
+                  payloadLen, &n);
+            }
+            else
+            {
+               //The server has given up the reassembly of the body
+               error = ERROR_INVALID_LENGTH;
+            }
+
+            //Check status code
+            if(!error)
+            {
+               //Any missing block in the current set?
+               if(n > 0)
+               {
+                  //The server is making progress, so that the retransmission
+                  //timer is restarted
+                  request->retransmitCount = 0;
+
+                  //Send the missing blocks again
+                  error = coapClientChangeRequestState(request,
+                     COAP_REQ_STATE_TRANSMIT);
+               }
+            }
+            else
+            {
+               //Report the failure to the caller
+               error = coapClientChangeRequestState(request,
+                  COAP_REQ_STATE_DONE);
+            }
+         }
+         else
+         {
+            //Final response or error
+            error = coapClientChangeRequestState(request, COAP_REQ_STATE_DONE);
+         }
+      }
+   }
+   else
+   {
+      //Search the response for a Q-Block2 option
+      error = coapGetUintOption(response, COAP_OPT_Q_BLOCK2, 0, &value);
+
+      //Check whether the server uses Q-Block2
+      if(error || COAP_GET_CODE_CLASS(respHeader->code) !=
+         COAP_CODE_CLASS_SUCCESS)
+      {
+         //Report the response to the caller
+         error = coapClientChangeRequestState(request, COAP_REQ_STATE_DONE);
+      }
+      else
+      {
+         //Retrieve the payload of the response
+         error = coapGetPayload(response, &payload, &payloadLen);
+
+         //Check status code
+         if(!error)
+         {
+            //Index of the block within the set
+            num = COAP_GET_BLOCK_NUM(value);
+            i = num - qBlock->first;
+
+            //Discard duplicate blocks, blocks that do not belong to the set
+            //and blocks whose length is not consistent with the block size
+            if(COAP_GET_BLOCK_SZX(value) == qBlock->szx &&
+               num >= qBlock->first && i < qBlock->count &&
+               (qBlock->pending & (1UL << i)) != 0 &&
+               (payloadLen == blockSize ||
+               (payloadLen < blockSize && !COAP_GET_BLOCK_M(value))))
+            {
+               //Copy the block to its final location
+               if(qBlock->buffer != NULL)
+                  memcpy(qBlock->buffer + i * blockSize, payload, payloadLen);
+
+               //The block has been received
+               qBlock->pending &= ~(1UL << i);
+
+               //Update statistics
+               request->blockStats.blockCount++;
+               request->blockStats.length += payloadLen;
+
+               //Last block of the body?
+               if(!COAP_GET_BLOCK_M(value))
+               {
+                  //The blocks that follow do not exist
+                  qBlock->count = i + 1;
+                  qBlock->pending &= COAP_CLIENT_Q_BLOCK_MASK(qBlock->count);
+                  qBlock->length = i * blockSize + payloadLen;
+                  qBlock->last = TRUE;
+               }
+               else if(qBlock->pending == 0 && !qBlock->last)
+               {
+                  //Length of the data received
+                  qBlock->length = qBlock->count * blockSize;
+               }
+               else
+               {
+                  //Just for sanity
+               }
+
+               //All the blocks of the set have been received?
+               if(qBlock->pending == 0)
+               {
+                  error = coapClientChangeRequestState(request,
+                     COAP_REQ_STATE_DONE);
+               }
+            }
+         }
+         else
+         {
+            //Silently discard the block
+            error = NO_ERROR;
+         }
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Parse the list of missing blocks
+ *
+ * The payload of a 4.08 response is a CBOR sequence of unsigned integers,
+ * each of them giving the number of a missing block
+ *
+ * @param[in] request CoAP request handle
+ * @param[in] p Pointer to the payload of the response
+ * @param[in] length Length of the payload, in bytes
+ * @param[out] count Number of missing blocks that belong to the current set
+ * @return Error code
+ **/
+
+error_t coapClientParseMissingBlocks(CoapClientRequest *request,
+   const uint8_t *p, size_t length, uint_t *count)
+{
+   size_t n;
+   uint32_t i;
+   uint32_t num;
+   CoapClientQBlockState *qBlock;
+
+   //Point to the Q-Block transfer state
+   qBlock = &request->qBlock;
+
+   //Number of missing blocks that belong to the current set
+   *count = 0;
+
+   //Parse the CBOR sequence
+   while(length > 0)
+   {
+      //Each item must be an unsigned integer (major type 0)
+      if((p[0] & 0xE0) != 0)
+         return ERROR_INVALID_SYNTAX;
+
+      //Decode the additional information
+      if((p[0] & 0x1F) < 24)
+      {
+         //The value is encoded in the initial byte
+         num = p[0] & 0x1F;
+         n = 1;
+      }
+      else if((p[0] & 0x1F) == 24 && length >= 2)
+      {
+         //8-bit value
+         num = p[1];
+         n = 2;
+      }
+      else if((p[0] & 0x1F) == 25 && length >= 3)
+      {
+         //16-bit value
+         num = LOAD16BE(p + 1);
+         n = 3;
+      }
+      else if((p[0] & 0x1F) == 26 && length >= 5)
+      {
+         //32-bit value
+         num = LOAD32BE(p + 1);
+         n = 5;
+      }
+      else
+      {
+         //Malformed item
+         return ERROR_INVALID_SYNTAX;
+      }
+
+      //Index of the block within the set
+      i = num - qBlock->first;
+
+      //Ignore the blocks that do not belong to the current set
+      if(num >= qBlock->first && i < qBlock->count)
+      {
+         //The block must be sent again
+         if((qBlock->pending & (1UL << i)) == 0)
+         {
+            qBlock->pending |= 1UL << i;
+            (*count)++;
+         }
+      }
+
+      //Next item
+      p += n;
+      length -= n;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Generate the token of a message that belongs to a Q-Block set
+ * @param[in] header Pointer to the CoAP message header
+ * @param[in] token Token of the request
+ * @param[in] num Number of the block the message relates to
+ **/
+
+void coapClientFormatQBlockToken(CoapMessageHeader *header,
+   const uint8_t *token, uint32_t num)
+{
+   uint_t i;
+   uint32_t carry;
+
+   //The block number is added to the token of the request, which is
+   //handled as a big-endian integer
+   carry = num;
+
+   //Process the token from the least significant byte
+   for(i = header->tokenLen; i > 0; i--)
+   {
+      carry += token[i - 1];
+      header->token[i - 1] = carry & 0xFF;
+      carry >>= 8;
+   }
+}
+
+
+/**
+ * @brief Retrieve the block number encoded in the token of a response
+ * @param[in] reqHeader Pointer to the header of the request
+ * @param[in] respHeader Pointer to the header of the response
+ * @param[out] num Number of the block the response relates to
+ * @return Error code
+ **/
+
+error_t coapClientGetQBlockTokenNum(const CoapMessageHeader *reqHeader,
+   const CoapMessageHeader *respHeader, uint32_t *num)
+{
+   uint_t i;
+   uint_t k;
+   uint_t borrow;
+   uint_t value;
+
+   //The token of the response must have the same length
+   if(respHeader->tokenLen != reqHeader->tokenLen)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Initialize variables
+   *num = 0;
+   borrow = 0;
+
+   //Subtract the token of the request, starting from the least
+   //significant byte
+   for(i = 0; i < respHeader->tokenLen; i++)
+   {
+      //Index of the current byte
+      k = respHeader->tokenLen - i - 1;
+
+      //Subtract the current byte
+      value = respHeader->token[k] + 256 - reqHeader->token[k] - borrow;
+      borrow = (value < 256) ? 1 : 0;
+      value &= 0xFF;
+
+      //The block number is a 32-bit value
+      if(i < 4)
+         *num |= (uint32_t) value << (i * 8);
+      else if(value != 0)
+         return ERROR_UNEXPECTED_MESSAGE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
 /**
  * @brief Get maximum block size
  * @return Block size
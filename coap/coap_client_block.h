@@ -35,6 +35,9 @@
 #include "core/net.h"
 #include "coap/coap_client.h"
 
+//Mask covering the first n blocks of a Q-Block set
+#define COAP_CLIENT_Q_BLOCK_MASK(n) (((n) < 32) ? ((1UL << (n)) - 1) : 0xFFFFFFFFUL)
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -44,12 +47,55 @@ extern "C" {
 error_t coapClientSetTxBlockSize(CoapClientRequest *request, uint_t blockSize);
 error_t coapClientSetRxBlockSize(CoapClientRequest *request, uint_t blockSize);
 
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+
+error_t coapClientSetQBlockMode(CoapClientRequest *request, bool_t enable);
+
+error_t coapClientSetMaxPayloads(CoapClientRequest *request,
+   uint_t maxPayloads);
+
+#endif
+
+error_t coapClientGetBlockStats(CoapClientRequest *request,
+   CoapClientBlockStats *stats);
+
 error_t coapClientWriteBody(CoapClientRequest *request, const void *data,
    size_t length, size_t *written, bool_t last);
 
 error_t coapClientReadBody(CoapClientRequest *request, void *data,
    size_t size, size_t *received);
 
+#if (COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+
+error_t coapClientWriteQBlockBody(CoapClientRequest *request,
+   const void *data, size_t length, size_t *written, bool_t last);
+
+error_t coapClientReadQBlockBody(CoapClientRequest *request, void *data,
+   size_t size, size_t *received);
+
+error_t coapClientProcessQBlockEvents(CoapClientRequest *request);
+error_t coapClientSendQBlockSet(CoapClientRequest *request);
+
+error_t coapClientSendQBlockMessage(CoapClientRequest *request,
+   const uint8_t *token, uint32_t num);
+
+error_t coapClientMatchQBlockResponse(const CoapClientRequest *request,
+   const CoapMessage *response);
+
+error_t coapClientProcessQBlockResponse(CoapClientRequest *request,
+   const CoapMessage *response);
+
+error_t coapClientParseMissingBlocks(CoapClientRequest *request,
+   const uint8_t *p, size_t length, uint_t *count);
+
+void coapClientFormatQBlockToken(CoapMessageHeader *header,
+   const uint8_t *token, uint32_t num);
+
+error_t coapClientGetQBlockTokenNum(const CoapMessageHeader *reqHeader,
+   const CoapMessageHeader *respHeader, uint32_t *num);
+
+#endif
+
 CoapBlockSize coapClientGetMaxBlockSize(void);
 
 //C++ guard
@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include "core/net.h"
 #include "coap/coap_client.h"
+#include "coap/coap_client_block.h"
 #include "coap/coap_client_observe.h"
 #include "coap/coap_client_transport.h"
 #include "coap/coap_client_misc.h"
@@ -211,6 +212,16 @@ error_t coapClientProcessRequestEvents(CoapClientRequest *request)
    header = (CoapMessageHeader *) request->message.buffer;
 
    //Check current state
+#if (COAP_CLIENT_BLOCK_SUPPORT == ENABLED && COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   if(request->qBlock.option != 0 &&
+      (request->state == COAP_REQ_STATE_TRANSMIT ||
+      request->state == COAP_REQ_STATE_RECEIVE))
+   {
+      //The blocks of a Q-Block set are sent and retransmitted as a whole
+      error = coapClientProcessQBlockEvents(request);
+   }
+   else
+#endif
    if(request->state == COAP_REQ_STATE_TRANSMIT)
    {
       //Debug message
@@ -441,6 +452,14 @@ error_t coapClientMatchResponse(const CoapClientRequest *request,
    error = ERROR_UNEXPECTED_MESSAGE;
 
    //Check request state
+#if (COAP_CLIENT_BLOCK_SUPPORT == ENABLED && COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   if(request->state == COAP_REQ_STATE_RECEIVE && request->qBlock.option != 0)
+   {
+      //Each block of a Q-Block set is carried by a distinct message
+      error = coapClientMatchQBlockResponse(request, response);
+   }
+   else
+#endif
    if(request->state == COAP_REQ_STATE_RECEIVE)
    {
       //Confirmable request?
@@ -585,6 +604,14 @@ error_t coapClientProcessResponse(CoapClientRequest *request,
    }
 
    //Check the type of the response
+#if (COAP_CLIENT_BLOCK_SUPPORT == ENABLED && COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   if(request->qBlock.option != 0)
+   {
+      //Process the response to a Q-Block set
+      error = coapClientProcessQBlockResponse(request, response);
+   }
+   else
+#endif
    if(header->type == COAP_TYPE_ACK &&
       header->code == COAP_CODE_EMPTY)
    {
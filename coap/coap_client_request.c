@@ -88,6 +88,14 @@ CoapClientRequest *coapClientCreateRequest(CoapClientContext *context)
             request->txBlockSzx = coapClientGetMaxBlockSize();
             //Default RX block size
             request->rxBlockSzx = COAP_BLOCK_SIZE_RESERVED;
+            //Clear block-wise transfer statistics
+            memset(&request->blockStats, 0, sizeof(CoapClientBlockStats));
+#endif
+#if (COAP_CLIENT_BLOCK_SUPPORT == ENABLED && COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+            //Q-Block mode is disabled by default
+            memset(&request->qBlock, 0, sizeof(CoapClientQBlockState));
+            //Default number of blocks in flight
+            request->qBlock.maxPayloads = COAP_CLIENT_MAX_PAYLOADS;
 #endif
             //Point to the CoAP message header
             header = (CoapMessageHeader *) request->message.buffer;
@@ -105,6 +113,8 @@ CoapClientRequest *coapClientCreateRequest(CoapClientContext *context)
 
             //Calculate the length of the CoAP message
             request->message.length = sizeof(CoapMessageHeader) + header->tokenLen;
+            //The message does not contain any option yet
+            coapInvalidateOptionIndex(&request->message);
 
             //We are done
             break;
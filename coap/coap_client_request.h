@@ -75,6 +75,44 @@ typedef enum
 } CoapRequestStatus;
 
 
+/**
+ * @brief Block-wise transfer statistics
+ **/
+
+typedef struct
+{
+   systime_t startTime;   ///<Time at which the transfer started
+   systime_t duration;    ///<Duration of the transfer, in milliseconds
+   uint_t blockCount;     ///<Number of blocks that have been transferred
+   uint_t retransmitCount;///<Number of blocks that have been sent or requested again
+   size_t length;         ///<Number of body bytes that have been transferred
+} CoapClientBlockStats;
+
+
+/**
+ * @brief Q-Block transfer state
+ **/
+
+typedef struct
+{
+   bool_t enabled;        ///<Q-Block mode (RFC 9177)
+   uint_t maxPayloads;    ///<Maximum number of blocks in flight
+   uint16_t option;       ///<Q-Block option of the current set (0 if no set is in progress)
+   CoapBlockSize szx;     ///<Block size
+   uint8_t *buffer;       ///<Body data of the current set
+   size_t length;         ///<Length of the body data, in bytes
+   uint32_t first;        ///<Number of the first block of the set
+   uint_t count;          ///<Number of blocks in the set
+   uint32_t pending;      ///<Blocks that remain to be sent or received
+   uint32_t sent;         ///<Blocks that have already been sent or requested
+   bool_t last;           ///<The set contains the last block of the body
+   bool_t inFlight;       ///<The blocks of the set were requested by the initial request
+   uint32_t next;         ///<Number of the next block of the body
+   uint16_t mid;          ///<Message ID of the first message of the last burst
+   uint_t midCount;       ///<Number of messages in the last burst
+} CoapClientQBlockState;
+
+
 /**
  * @brief Request completed callback
  **/
@@ -102,6 +140,10 @@ struct _CoapClientRequest
 #if (COAP_CLIENT_BLOCK_SUPPORT == ENABLED)
    CoapBlockSize txBlockSzx;       ///<TX block size
    CoapBlockSize rxBlockSzx;       ///<RX block size
+   CoapClientBlockStats blockStats; ///<Block-wise transfer statistics
+#endif
+#if (COAP_CLIENT_BLOCK_SUPPORT == ENABLED && COAP_CLIENT_Q_BLOCK_SUPPORT == ENABLED)
+   CoapClientQBlockState qBlock;   ///<Q-Block transfer state
 #endif
    CoapMessage message;           ///<CoAP request message
    CoapRequestCallback callback;  ///<Callback function to invoke when the request completes
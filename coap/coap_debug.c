@@ -34,7 +34,7 @@
 //Dependencies
 #include "core/net.h"
 #include "coap/coap_client.h"
-//#include "coap/coap_server.h"
+#include "coap/coap_server.h"
 #include "coap/coap_debug.h"
 #include "debug.h"
 #include "error.h"
@@ -104,12 +104,13 @@ const CoapParamDesc coapObserveList[] =
 //Content-Format option values
 const CoapParamDesc coapContentFormatList[] =
 {
-   {COAP_CONTENT_FORMAT_TEXT_PLAIN,       "text/plain"},
-   {COAP_CONTENT_FORMAT_APP_LINK_FORMAT,  "application/link-format"},
-   {COAP_CONTENT_FORMAT_APP_XML,          "application/xml"},
-   {COAP_CONTENT_FORMAT_APP_OCTET_STREAM, "application/octet-stream"},
-   {COAP_CONTENT_FORMAT_APP_EXI,          "application/exi"},
-   {COAP_CONTENT_FORMAT_APP_JSON,         "application/json"}
+   {COAP_CONTENT_FORMAT_TEXT_PLAIN,         "text/plain"},
+   {COAP_CONTENT_FORMAT_APP_LINK_FORMAT,    "application/link-format"},
+   {COAP_CONTENT_FORMAT_APP_XML,            "application/xml"},
+   {COAP_CONTENT_FORMAT_APP_OCTET_STREAM,   "application/octet-stream"},
+   {COAP_CONTENT_FORMAT_APP_EXI,            "application/exi"},
+   {COAP_CONTENT_FORMAT_APP_JSON,           "application/json"},
+   {COAP_CONTENT_FORMAT_APP_MISSING_BLOCKS, "application/missing-blocks+cbor-seq"}
 };
 
 
@@ -343,7 +344,9 @@ error_t coapDumpOption(const CoapOption *option)
             TRACE_DEBUG("    %" PRIu32 " (%s)\r\n", value, name);
          }
          else if(option->number == COAP_OPT_BLOCK1 ||
-            option->number == COAP_OPT_BLOCK2)
+            option->number == COAP_OPT_BLOCK2 ||
+            option->number == COAP_OPT_Q_BLOCK1 ||
+            option->number == COAP_OPT_Q_BLOCK2)
          {
             //Dump the value of the Block option
             TRACE_DEBUG("    %" PRIu32 "/%" PRIu32 "/%" PRIu32 "\r\n",
@@ -47,7 +47,7 @@ extern "C" {
 
 typedef struct
 {
-   uint8_t value;
+   uint16_t value;
    const char_t *name;
 } CoapParamDesc;
 
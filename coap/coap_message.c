@@ -34,7 +34,7 @@
 //Dependencies
 #include "core/net.h"
 #include "coap/coap_client.h"
-//#include "coap/coap_server.h"
+#include "coap/coap_server.h"
 #include "coap/coap_message.h"
 #include "debug.h"
 
@@ -48,13 +48,16 @@
  * @return Error code
  **/
 
-error_t coapParseMessage(const CoapMessage *message)
+error_t coapParseMessage(CoapMessage *message)
 {
    error_t error;
    size_t n;
    size_t length;
    const uint8_t *p;
 
+   //The contents of the message have changed
+   coapInvalidateOptionIndex(message);
+
    //Point to the first byte of the CoAP message
    p = message->buffer;
    //Retrieve the length of the message
@@ -96,6 +99,13 @@ error_t coapParseMessage(const CoapMessage *message)
          return ERROR_INVALID_MESSAGE;
    }
 
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+   //Index the options so that subsequent lookups do not need to parse the
+   //whole option list again (the index is left invalid if the message has
+   //too many options)
+   coapIndexOptions(message);
+#endif
+
    //Successful processing
    return NO_ERROR;
 }
@@ -42,12 +42,52 @@
    #error COAP_MAX_MSG_SIZE parameter is not valid
 #endif
 
+//Option index support
+#ifndef COAP_OPTION_INDEX_SUPPORT
+   #define COAP_OPTION_INDEX_SUPPORT ENABLED
+#elif (COAP_OPTION_INDEX_SUPPORT != ENABLED && COAP_OPTION_INDEX_SUPPORT != DISABLED)
+   #error COAP_OPTION_INDEX_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of options that can be indexed per message
+#ifndef COAP_MAX_INDEXED_OPTIONS
+   #define COAP_MAX_INDEXED_OPTIONS 16
+#elif (COAP_MAX_INDEXED_OPTIONS < 1)
+   #error COAP_MAX_INDEXED_OPTIONS parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/**
+ * @brief CoAP option index entry
+ **/
+
+typedef struct
+{
+   uint16_t number;   ///<Option number
+   uint16_t offset;   ///<Offset of the option from the beginning of the message
+   uint16_t length;   ///<Length of the option, including its header
+   uint16_t valueLen; ///<Length of the option value
+} CoapOptionIndexEntry;
+
+
+/**
+ * @brief CoAP option index
+ **/
+
+typedef struct
+{
+   bool_t valid;      ///<The index reflects the contents of the message
+   uint_t numOptions; ///<Number of options in the message
+   size_t end;        ///<Offset of the end of the option list
+   CoapOptionIndexEntry options[COAP_MAX_INDEXED_OPTIONS];
+} CoapOptionIndex;
+
+
 /**
  * @brief CoAP message
  **/
@@ -57,11 +97,14 @@ typedef struct
    uint8_t buffer[COAP_MAX_MSG_SIZE];
    size_t length;
    size_t pos;
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+   CoapOptionIndex optionIndex;
+#endif
 } CoapMessage;
 
 
 //CoAP related functions
-error_t coapParseMessage(const CoapMessage *message);
+error_t coapParseMessage(CoapMessage *message);
 
 error_t coapParseMessageHeader(const uint8_t *p, size_t length,
    size_t *consumed);
@@ -34,7 +34,7 @@
 //Dependencies
 #include "core/net.h"
 #include "coap/coap_client.h"
-//#include "coap/coap_server.h"
+#include "coap/coap_server.h"
 #include "coap/coap_option.h"
 #include "debug.h"
 
@@ -60,10 +60,12 @@ const CoapOptionParameters coapOptionList[] =
    {COAP_OPT_MAX_AGE,        FALSE, TRUE,  FALSE, FALSE, "Max-Age",        COAP_OPT_FORMAT_UINT,   0, 4},
    {COAP_OPT_URI_QUERY,      TRUE,  TRUE,  FALSE, TRUE,  "Uri-Query",      COAP_OPT_FORMAT_STRING, 0, 255},
    {COAP_OPT_ACCEPT,         TRUE,  FALSE, FALSE, FALSE, "Accept",         COAP_OPT_FORMAT_UINT,   0, 2},
+   {COAP_OPT_Q_BLOCK1,       TRUE,  TRUE,  FALSE, FALSE, "Q-Block1",       COAP_OPT_FORMAT_UINT,   0, 3},
    {COAP_OPT_LOCATION_QUERY, FALSE, FALSE, FALSE, TRUE,  "Location-Query", COAP_OPT_FORMAT_STRING, 0, 255},
    {COAP_OPT_BLOCK2,         TRUE,  TRUE,  FALSE, FALSE, "Block2",         COAP_OPT_FORMAT_UINT,   0, 3},
    {COAP_OPT_BLOCK1,         TRUE,  TRUE,  FALSE, FALSE, "Block1",         COAP_OPT_FORMAT_UINT,   0, 3},
    {COAP_OPT_SIZE2,          FALSE, FALSE, TRUE,  FALSE, "Size2",          COAP_OPT_FORMAT_UINT,   0, 4},
+   {COAP_OPT_Q_BLOCK2,       TRUE,  TRUE,  FALSE, TRUE,  "Q-Block2",       COAP_OPT_FORMAT_UINT,   0, 3},
    {COAP_OPT_PROXY_URI,      TRUE,  TRUE,  FALSE, FALSE, "Proxy-Uri",      COAP_OPT_FORMAT_STRING, 1, 1034},
    {COAP_OPT_PROXY_SCHEME,   TRUE,  TRUE,  FALSE, FALSE, "Proxy-Scheme",   COAP_OPT_FORMAT_STRING, 1, 255},
    {COAP_OPT_SIZE1,          FALSE, FALSE, TRUE,  FALSE, "Size1",          COAP_OPT_FORMAT_UINT,   0, 4}
@@ -398,6 +400,24 @@ error_t coapSetOption(CoapMessage *message, uint16_t optionNum,
    uint8_t *p;
    CoapOption option;
 
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+   //Make sure the option index is up to date
+   error = coapIndexOptions(message);
+
+   //Check status code
+   if(!error)
+   {
+      //The option index locates the insertion point without parsing the
+      //option list
+      error = coapSetIndexedOption(message, optionNum, optionIndex,
+         optionValue, optionLen);
+
+      //Fall back to the linear search if the index is full
+      if(error != ERROR_OUT_OF_RESOURCES)
+         return error;
+   }
+#endif
+
    //Initialize variables
    replace = FALSE;
    index = 0;
@@ -578,6 +598,17 @@ error_t coapGetOption(const CoapMessage *message, uint16_t optionNum,
    const uint8_t *p;
    CoapOption option;
 
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+   //Check whether the options of the message have been indexed
+   if(message->optionIndex.valid &&
+      message->optionIndex.end <= message->length)
+   {
+      //Search the option index for the specified option number
+      return coapGetIndexedOption(message, optionNum, optionIndex,
+         optionValue, optionLen);
+   }
+#endif
+
    //Initialize index
    index = 0;
 
@@ -698,6 +729,18 @@ error_t coapDeleteOption(CoapMessage *message, uint16_t optionNum,
    uint8_t *p;
    CoapOption option;
 
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+   //Make sure the option index is up to date
+   error = coapIndexOptions(message);
+
+   //Check status code
+   if(!error)
+   {
+      //The option index locates the option without parsing the option list
+      return coapDeleteIndexedOption(message, optionNum, optionIndex);
+   }
+#endif
+
    //Initialize variables
    found = FALSE;
    index = 0;
@@ -810,6 +853,477 @@ error_t coapDeleteOption(CoapMessage *message, uint16_t optionNum,
 }
 
 
+/**
+ * @brief Invalidate the option index of a CoAP message
+ *
+ * This function must be called whenever the contents of the message are
+ * modified without using the option API (e.g. when a new message is
+ * formatted in place or when a datagram is received in the buffer)
+ *
+ * @param[in] message Pointer to the CoAP message
+ **/
+
+void coapInvalidateOptionIndex(CoapMessage *message)
+{
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+   //The index will be rebuilt on next use
+   message->optionIndex.valid = FALSE;
+   message->optionIndex.numOptions = 0;
+#endif
+}
+
+
+#if (COAP_OPTION_INDEX_SUPPORT == ENABLED)
+
+/**
+ * @brief Build the option index of a CoAP message
+ * @param[in] message Pointer to the CoAP message
+ * @return Error code
+ **/
+
+error_t coapIndexOptions(CoapMessage *message)
+{
+   error_t error;
+   size_t n;
+   size_t offset;
+   CoapOption option;
+   CoapOptionIndex *index;
+   CoapOptionIndexEntry *entry;
+
+   //Point to the option index
+   index = &message->optionIndex;
+
+   //The index is maintained as long as the message is edited through the
+   //option API
+   if(index->valid && index->end <= message->length)
+      return NO_ERROR;
+
+   //Clear the option index
+   coapInvalidateOptionIndex(message);
+
+   //Parse message header
+   error = coapParseMessageHeader(message->buffer, message->length, &offset);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //For the first option in a message, a preceding option instance with
+   //Option Number zero is assumed
+   option.number = 0;
+
+   //Loop through CoAP options
+   while(offset < message->length)
+   {
+      //Payload marker found?
+      if(message->buffer[offset] == COAP_PAYLOAD_MARKER)
+         break;
+
+      //Parse current option
+      error = coapParseOption(message->buffer + offset,
+         message->length - offset, option.number, &option, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Make sure the index is large enough to hold the new entry
+      if(index->numOptions >= COAP_MAX_INDEXED_OPTIONS)
+      {
+         //Clear the option index
+         coapInvalidateOptionIndex(message);
+         //Report an error
+         return ERROR_OUT_OF_RESOURCES;
+      }
+
+      //Add a new entry to the index
+      entry = &index->options[index->numOptions++];
+      entry->number = option.number;
+      entry->offset = (uint16_t) offset;
+      entry->length = (uint16_t) n;
+      entry->valueLen = (uint16_t) option.length;
+
+      //Jump to the next option
+      offset += n;
+   }
+
+   //Save the offset of the end of the option list
+   index->end = offset;
+   //The option index is now valid
+   index->valid = TRUE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Search the option index for a given occurrence of an option
+ *
+ * Options are stored in ascending order, so that a binary search locates
+ * the first occurrence of the option number
+ *
+ * @param[in] index Pointer to the option index
+ * @param[in] optionNum Option number
+ * @param[in] optionIndex Occurrence index (for repeatable options only)
+ * @return Position of the occurrence in the index, or position where the
+ *   option is to be inserted if the occurrence does not exist
+ **/
+
+uint_t coapSearchOptionIndex(const CoapOptionIndex *index,
+   uint16_t optionNum, uint_t optionIndex)
+{
+   uint_t i;
+   uint_t left;
+   uint_t right;
+
+   //Initialize variables
+   left = 0;
+   right = index->numOptions;
+
+   //Binary search
+   while(left < right)
+   {
+      //Check the entry in the middle of the range
+      i = left + (right - left) / 2;
+
+      //Narrow the search range
+      if(index->options[i].number < optionNum)
+         left = i + 1;
+      else
+         right = i;
+   }
+
+   //Skip the occurrences that precede the requested one
+   for(i = 0; i < optionIndex && left < index->numOptions; i++)
+   {
+      //Last occurrence of the option?
+      if(index->options[left].number != optionNum)
+         break;
+
+      //Next occurrence
+      left++;
+   }
+
+   //Return the position of the occurrence
+   return left;
+}
+
+
+/**
+ * @brief Add an option to a CoAP message whose options are indexed
+ *
+ * When options are added in ascending order, the new option is appended to
+ * the option list and no data needs to be moved
+ *
+ * @param[in] message Pointer to the CoAP message
+ * @param[in] optionNum Option number
+ * @param[in] optionIndex Occurrence index (for repeatable options only)
+ * @param[in] optionValue Pointer to the first byte of the option value
+ * @param[in] optionLen Length of the option, in bytes
+ * @return Error code
+ **/
+
+error_t coapSetIndexedOption(CoapMessage *message, uint16_t optionNum,
+   uint_t optionIndex, const uint8_t *optionValue, size_t optionLen)
+{
+   error_t error;
+   bool_t replace;
+   uint_t i;
+   uint_t k;
+   size_t n;
+   size_t m;
+   size_t offset;
+   size_t removed;
+   uint16_t prevOptionNum;
+   uint8_t *p;
+   CoapOption option;
+   CoapOptionIndex *index;
+   CoapOptionIndexEntry *entry;
+
+   //Point to the option index
+   index = &message->optionIndex;
+
+   //Search the index for the specified occurrence
+   k = coapSearchOptionIndex(index, optionNum, optionIndex);
+
+   //Check whether the current occurrence should be replaced
+   if(k < index->numOptions && index->options[k].number == optionNum)
+      replace = TRUE;
+   else
+      replace = FALSE;
+
+   //Make sure the index is large enough to hold the new entry
+   if(!replace && index->numOptions >= COAP_MAX_INDEXED_OPTIONS)
+   {
+      //Clear the option index
+      coapInvalidateOptionIndex(message);
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Option number of the previous instance
+   prevOptionNum = (k > 0) ? index->options[k - 1].number : 0;
+   //Offset where the option is to be written
+   offset = (k < index->numOptions) ? index->options[k].offset : index->end;
+   //Number of bytes occupied by the option being replaced
+   removed = replace ? index->options[k].length : 0;
+
+   //Each option instance in a message specifies the Option Number of the
+   //defined CoAP option, the length of the Option Value, and the Option
+   //Value itself
+   option.number = optionNum;
+   option.length = optionLen;
+   option.value = optionValue;
+
+   //The first pass calculates the required length
+   error = coapFormatOption(NULL, prevOptionNum, &option, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Make sure the output buffer is large enough to hold the new option
+   if((message->length - removed + n) > COAP_MAX_MSG_SIZE)
+      return ERROR_BUFFER_OVERFLOW;
+
+   //Point to the location of the option
+   p = message->buffer + offset;
+
+   //Make room for the new option (no data is moved when the option is
+   //appended to a message that has no payload)
+   memmove(p + n, p + removed, message->length - offset - removed);
+
+   //The second pass formats the CoAP option
+   error = coapFormatOption(p, prevOptionNum, &option, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Adjust the length of the CoAP message
+   message->length = message->length - removed + n;
+   index->end = index->end - removed + n;
+
+   //New option?
+   if(!replace)
+   {
+      //Make room for the new entry
+      memmove(index->options + k + 1, index->options + k,
+         (index->numOptions - k) * sizeof(CoapOptionIndexEntry));
+
+      //Update the number of entries
+      index->numOptions++;
+   }
+
+   //Update the entry that describes the option
+   entry = &index->options[k];
+   entry->number = optionNum;
+   entry->offset = (uint16_t) offset;
+   entry->length = (uint16_t) n;
+   entry->valueLen = (uint16_t) optionLen;
+
+   //Fix the offsets of the options that follow
+   for(i = k + 1; i < index->numOptions; i++)
+   {
+      index->options[i].offset = (uint16_t) (index->options[i].offset +
+         n - removed);
+   }
+
+   //Check whether another CoAP option is following
+   if(!replace && (k + 1) < index->numOptions)
+   {
+      //Point to the following option
+      entry = &index->options[k + 1];
+      p = message->buffer + entry->offset;
+
+      //Parse the following option
+      error = coapParseOption(p, entry->length, prevOptionNum, &option, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Fix the Option Delta field
+      error = coapFormatOption(p, optionNum, &option, &m);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Test if the length of the option has changed
+      if(m < n)
+      {
+         //Move the rest of the CoAP message
+         memmove(p + m, p + n, message->length - entry->offset - n);
+
+         //Fix the length of the message
+         message->length -= n - m;
+         index->end -= n - m;
+
+         //Fix the entries of the options that follow
+         entry->length = (uint16_t) m;
+
+         for(i = k + 2; i < index->numOptions; i++)
+            index->options[i].offset -= (uint16_t) (n - m);
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the value of an option using the option index
+ * @param[in] message Pointer to the CoAP message
+ * @param[in] optionNum Option number
+ * @param[in] optionIndex Occurrence index (for repeatable options only)
+ * @param[out] optionValue Pointer to the first byte of the option value
+ * @param[out] optionLen Length of the option, in bytes
+ * @return Error code
+ **/
+
+error_t coapGetIndexedOption(const CoapMessage *message, uint16_t optionNum,
+   uint_t optionIndex, const uint8_t **optionValue, size_t *optionLen)
+{
+   uint_t k;
+   const CoapOptionIndexEntry *entry;
+
+   //Search the index for the specified occurrence
+   k = coapSearchOptionIndex(&message->optionIndex, optionNum, optionIndex);
+
+   //The specified option number does not exist?
+   if(k >= message->optionIndex.numOptions)
+      return ERROR_NOT_FOUND;
+
+   //Point to the matching entry
+   entry = &message->optionIndex.options[k];
+
+   //Check option number
+   if(entry->number != optionNum)
+      return ERROR_NOT_FOUND;
+
+   //The option value is located at the end of the option
+   *optionValue = message->buffer + entry->offset + entry->length -
+      entry->valueLen;
+
+   //Return the length of the option value
+   *optionLen = entry->valueLen;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Remove an option from a CoAP message whose options are indexed
+ * @param[in] message Pointer to the CoAP message
+ * @param[in] optionNum Option number
+ * @param[in] optionIndex Occurrence index (for repeatable options only)
+ * @return Error code
+ **/
+
+error_t coapDeleteIndexedOption(CoapMessage *message, uint16_t optionNum,
+   uint_t optionIndex)
+{
+   error_t error;
+   uint_t i;
+   uint_t k;
+   size_t n;
+   size_t m;
+   size_t offset;
+   size_t removed;
+   uint16_t prevOptionNum;
+   uint8_t *p;
+   CoapOption option;
+   CoapOptionIndex *index;
+   CoapOptionIndexEntry *entry;
+
+   //Point to the option index
+   index = &message->optionIndex;
+
+   //Search the index for the specified occurrence
+   k = coapSearchOptionIndex(index, optionNum, optionIndex);
+
+   //The specified option number does not exist?
+   if(k >= index->numOptions || index->options[k].number != optionNum)
+      return NO_ERROR;
+
+   //Option number of the previous instance
+   prevOptionNum = (k > 0) ? index->options[k - 1].number : 0;
+   //Location of the option
+   offset = index->options[k].offset;
+   removed = index->options[k].length;
+
+   //Point to the location of the option
+   p = message->buffer + offset;
+
+   //Remove the current occurrence of the option
+   memmove(p, p + removed, message->length - offset - removed);
+
+   //Adjust the length of the CoAP message
+   message->length -= removed;
+   index->end -= removed;
+
+   //Remove the corresponding entry
+   memmove(index->options + k, index->options + k + 1,
+      (index->numOptions - k - 1) * sizeof(CoapOptionIndexEntry));
+
+   //Update the number of entries
+   index->numOptions--;
+
+   //Fix the offsets of the options that follow
+   for(i = k; i < index->numOptions; i++)
+      index->options[i].offset -= (uint16_t) removed;
+
+   //Check whether another CoAP option is following
+   if(k < index->numOptions)
+   {
+      //Point to the following option
+      entry = &index->options[k];
+
+      //Parse the following option
+      error = coapParseOption(p, entry->length, optionNum, &option, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The first pass calculates the required length
+      error = coapFormatOption(NULL, prevOptionNum, &option, &m);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Test if the length of the option has changed
+      if(m > n)
+      {
+         //Move the rest of the CoAP message
+         memmove(p + m - option.length, p + n - option.length,
+            message->length - offset - n + option.length);
+
+         //Fix the value of the option
+         option.value += m - n;
+
+         //Fix the length of the message
+         message->length += m - n;
+         index->end += m - n;
+
+         //Fix the entries of the options that follow
+         entry->length = (uint16_t) m;
+
+         for(i = k + 1; i < index->numOptions; i++)
+            index->options[i].offset += (uint16_t) (m - n);
+      }
+
+      //The second pass fixes the Option Delta field
+      error = coapFormatOption(p, prevOptionNum, &option, &m);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
 /**
  * @brief Encode a path or query component into multiple repeatable options
  * @param[in] message Pointer to the CoAP message
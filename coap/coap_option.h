@@ -101,10 +101,12 @@ typedef enum
    COAP_OPT_MAX_AGE        = 14, //RFC 7252
    COAP_OPT_URI_QUERY      = 15, //RFC 7252
    COAP_OPT_ACCEPT         = 17, //RFC 7252
+   COAP_OPT_Q_BLOCK1       = 19, //RFC 9177
    COAP_OPT_LOCATION_QUERY = 20, //RFC 7252
    COAP_OPT_BLOCK2         = 23, //RFC 7959
    COAP_OPT_BLOCK1         = 27, //RFC 7959
    COAP_OPT_SIZE2          = 28, //RFC 7959
+   COAP_OPT_Q_BLOCK2       = 31, //RFC 9177
    COAP_OPT_PROXY_URI      = 35, //RFC 7252
    COAP_OPT_PROXY_SCHEME   = 39, //RFC 7252
    COAP_OPT_SIZE1          = 60, //RFC 7252
@@ -142,12 +144,13 @@ typedef enum
 
 typedef enum
 {
-   COAP_CONTENT_FORMAT_TEXT_PLAIN       = 0,
-   COAP_CONTENT_FORMAT_APP_LINK_FORMAT  = 40,
-   COAP_CONTENT_FORMAT_APP_XML          = 41,
-   COAP_CONTENT_FORMAT_APP_OCTET_STREAM = 42,
-   COAP_CONTENT_FORMAT_APP_EXI          = 47,
-   COAP_CONTENT_FORMAT_APP_JSON         = 50
+   COAP_CONTENT_FORMAT_TEXT_PLAIN         = 0,
+   COAP_CONTENT_FORMAT_APP_LINK_FORMAT    = 40,
+   COAP_CONTENT_FORMAT_APP_XML            = 41,
+   COAP_CONTENT_FORMAT_APP_OCTET_STREAM   = 42,
+   COAP_CONTENT_FORMAT_APP_EXI            = 47,
+   COAP_CONTENT_FORMAT_APP_JSON           = 50,
+   COAP_CONTENT_FORMAT_APP_MISSING_BLOCKS = 272
 } CoapContentFormat;
 
 
@@ -223,6 +226,21 @@ error_t coapGetUintOption(const CoapMessage *message, uint16_t optionNum,
 error_t coapDeleteOption(CoapMessage *message, uint16_t optionNum,
    uint_t optionIndex);
 
+void coapInvalidateOptionIndex(CoapMessage *message);
+error_t coapIndexOptions(CoapMessage *message);
+
+uint_t coapSearchOptionIndex(const CoapOptionIndex *index,
+   uint16_t optionNum, uint_t optionIndex);
+
+error_t coapSetIndexedOption(CoapMessage *message, uint16_t optionNum,
+   uint_t optionIndex, const uint8_t *optionValue, size_t optionLen);
+
+error_t coapGetIndexedOption(const CoapMessage *message, uint16_t optionNum,
+   uint_t optionIndex, const uint8_t **optionValue, size_t *optionLen);
+
+error_t coapDeleteIndexedOption(CoapMessage *message, uint16_t optionNum,
+   uint_t optionIndex);
+
 error_t coapSplitRepeatableOption(CoapMessage *message, uint16_t optionNum,
    const char_t *optionValue, char_t separator);
 
@@ -0,0 +1,454 @@
+/**
+ * @file coap_server.c
+ * @brief CoAP server
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * CoAP is a specialized web transfer protocol for use with constrained nodes
+ * and constrained networks. The server exposes a tree of resources and
+ * dispatches incoming requests to the relevant resource handler. Refer to
+ * the following RFCs for complete details:
+ * - RFC 7252: The Constrained Application Protocol
+ * - RFC 7641: Observing Resources in CoAP
+ * - RFC 7959: Block-Wise Transfers in CoAP
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL COAP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_server.h"
+#include "coap/coap_server_misc.h"
+#include "coap/coap_server_observe.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (COAP_SERVER_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Initialize settings with default values
+ * @param[out] settings Structure that contains CoAP server settings
+ **/
+
+void coapServerGetDefaultSettings(CoapServerSettings *settings)
+{
+   //The CoAP server is not bound to any interface
+   settings->interface = NULL;
+
+   //CoAP port number
+   settings->port = COAP_PORT;
+}
+
+
+/**
+ * @brief CoAP server initialization
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] settings CoAP server specific settings
+ * @return Error code
+ **/
+
+error_t coapServerInit(CoapServerContext *context,
+   const CoapServerSettings *settings)
+{
+   error_t error;
+
+   //Debug message
+   TRACE_INFO("Initializing CoAP server...\r\n");
+
+   //Ensure the parameters are valid
+   if(context == NULL || settings == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Clear the CoAP server context
+   memset(context, 0, sizeof(CoapServerContext));
+
+   //Save user settings
+   context->settings = *settings;
+
+   //The root node of the resource tree matches the empty path
+   context->nodes[0].used = TRUE;
+   context->nodes[0].name = "";
+
+   //It is strongly recommended that the initial value of the message ID
+   //be randomized (refer to RFC 7252, section 4.4)
+   context->mid = (uint16_t) netGetRand();
+
+   //Create a mutex to prevent simultaneous access to the context
+   if(!osCreateMutex(&context->mutex))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create an event object to poll the state of the socket
+   if(!osCreateEvent(&context->event))
+   {
+      //Clean up side effects
+      osDeleteMutex(&context->mutex);
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Start of exception handling block
+   do
+   {
+      //Open a UDP socket
+      context->socket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_IP_PROTO_UDP);
+
+      //Failed to open socket?
+      if(context->socket == NULL)
+      {
+         //Report an error
+         error = ERROR_OPEN_FAILED;
+         //Exit immediately
+         break;
+      }
+
+      //Force the socket to operate in non-blocking mode
+      error = socketSetTimeout(context->socket, 0);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Associate the socket with the relevant interface
+      error = socketBindToInterface(context->socket, settings->interface);
+      //Unable to bind the socket to the desired interface?
+      if(error)
+         break;
+
+      //The CoAP server listens for requests on port 5683
+      error = socketBind(context->socket, &IP_ADDR_ANY, settings->port);
+      //Unable to bind the socket to the desired port?
+      if(error)
+         break;
+
+      //End of exception handling block
+   } while(0);
+
+   //Did we encounter an error?
+   if(error)
+   {
+      //Free previously allocated resources
+      osDeleteMutex(&context->mutex);
+      osDeleteEvent(&context->event);
+      //Close socket
+      socketClose(context->socket);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Register a resource
+ *
+ * The resource is inserted in the resource tree, one node per path segment.
+ * The structure and its path string must remain valid until the resource
+ * is unregistered
+ *
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Resource to be registered
+ * @return Error code
+ **/
+
+error_t coapServerRegisterResource(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   size_t n;
+   const char_t *p;
+   CoapServerNode *node;
+
+   //Check parameters
+   if(context == NULL || resource == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(resource->path == NULL || resource->callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Acquire exclusive access to the CoAP server context
+   osAcquireMutex(&context->mutex);
+
+   //Start from the root of the resource tree
+   i = 0;
+   p = resource->path;
+
+   //Walk through the path segments
+   while(*p != '\0' && !error)
+   {
+      //Skip the delimiting character
+      if(*p == '/')
+      {
+         p++;
+         continue;
+      }
+
+      //Determine the length of the current segment
+      for(n = 0; p[n] != '\0' && p[n] != '/'; n++);
+
+      //Search the children of the current node for a matching segment
+      j = coapServerFindChildNode(context, i, (const uint8_t *) p, n);
+
+      //No matching node?
+      if(j == 0)
+      {
+         //Look for a free node
+         for(j = 1; j < COAP_SERVER_MAX_NODES; j++)
+         {
+            if(!context->nodes[j].used)
+               break;
+         }
+
+         //The resource tree is full?
+         if(j >= COAP_SERVER_MAX_NODES)
+         {
+            //Report an error
+            error = ERROR_OUT_OF_RESOURCES;
+            break;
+         }
+
+         //Point to the new node
+         node = &context->nodes[j];
+
+         //The node refers to the segment within the path string
+         node->used = TRUE;
+         node->name = p;
+         node->nameLen = n;
+         node->child = 0;
+         node->resource = NULL;
+
+         //Insert the node at the head of the children list
+         node->parent = i;
+         node->sibling = context->nodes[i].child;
+         context->nodes[i].child = j;
+      }
+
+      //Move to the next segment
+      i = j;
+      p += n;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Point to the node that matches the full path
+      node = &context->nodes[i];
+
+      //Make sure the path is not already in use
+      if(node->resource == NULL)
+      {
+         //Attach the resource to the node
+         node->resource = resource;
+         //Reset the sequence number used for notifications
+         resource->observeSeqNum = 0;
+         resource->changed = FALSE;
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_INVALID_PATH;
+      }
+   }
+
+   //Check status code
+   if(error)
+   {
+      //Remove the nodes that were inserted before the failure
+      coapServerPruneNode(context, i);
+   }
+
+   //Release exclusive access to the CoAP server context
+   osReleaseMutex(&context->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Unregister a resource
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Resource to be unregistered
+ * @return Error code
+ **/
+
+error_t coapServerUnregisterResource(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   error_t error;
+   uint_t i;
+
+   //Check parameters
+   if(context == NULL || resource == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize status code
+   error = ERROR_NOT_FOUND;
+
+   //Acquire exclusive access to the CoAP server context
+   osAcquireMutex(&context->mutex);
+
+   //Loop through the nodes of the resource tree
+   for(i = 0; i < COAP_SERVER_MAX_NODES; i++)
+   {
+      //Matching resource?
+      if(context->nodes[i].used && context->nodes[i].resource == resource)
+      {
+         //Detach the resource from the node
+         context->nodes[i].resource = NULL;
+         //Release the nodes that are no longer needed
+         coapServerPruneNode(context, i);
+
+         //The resource has been successfully removed
+         error = NO_ERROR;
+         break;
+      }
+   }
+
+#if (COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+   //Observers of the resource are silently discarded
+   coapServerDeleteObservers(context, resource);
+#endif
+
+#if (COAP_SERVER_BLOCK_SUPPORT == ENABLED)
+   //Abort any Block1 transfer targeting the resource
+   for(i = 0; i < COAP_SERVER_MAX_BLOCK_TRANSFERS; i++)
+   {
+      if(context->transfers[i].resource == resource)
+         context->transfers[i].resource = NULL;
+   }
+#endif
+
+   //Release exclusive access to the CoAP server context
+   osReleaseMutex(&context->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Start CoAP server
+ * @param[in] context Pointer to the CoAP server context
+ * @return Error code
+ **/
+
+error_t coapServerStart(CoapServerContext *context)
+{
+   OsTask *task;
+
+   //Debug message
+   TRACE_INFO("Starting CoAP server...\r\n");
+
+   //Make sure the CoAP server context is valid
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Create the CoAP server task
+   task = osCreateTask("CoAP Server", (OsTaskCode) coapServerTask,
+      context, COAP_SERVER_STACK_SIZE, COAP_SERVER_PRIORITY);
+
+   //Unable to create the task?
+   if(task == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief CoAP server task
+ * @param[in] context Pointer to the CoAP server context
+ **/
+
+void coapServerTask(CoapServerContext *context)
+{
+   error_t error;
+   uint_t i;
+   SocketEventDesc eventDesc;
+
+#if (NET_RTOS_SUPPORT == ENABLED)
+   //Task prologue
+   osEnterTask();
+
+   //Process events
+   while(1)
+   {
+#endif
+      //Wait for a request to be received
+      eventDesc.socket = context->socket;
+      eventDesc.eventMask = SOCKET_EVENT_RX_READY;
+      eventDesc.eventFlags = 0;
+
+      //Wait for the socket to become ready to perform I/O
+      error = socketPoll(&eventDesc, 1, &context->event,
+         COAP_SERVER_TICK_INTERVAL);
+
+      //Acquire exclusive access to the CoAP server context
+      osAcquireMutex(&context->mutex);
+
+      //Any datagram received?
+      if(!error && (eventDesc.eventFlags & SOCKET_EVENT_RX_READY))
+      {
+         //Drain the receive queue so that a burst of requests is served
+         //within a single wake-up
+         for(i = 0; i < COAP_SERVER_RX_BURST; i++)
+         {
+            //Read the next pending datagram, if any (one byte is kept to
+            //terminate the payload with a NULL character)
+            error = socketReceiveEx(context->socket, &context->remoteIpAddr,
+               &context->remotePort, &context->localIpAddr,
+               context->request.buffer, COAP_MAX_MSG_SIZE - 1,
+               &context->request.length, 0);
+
+            //The receive queue is empty?
+            if(error)
+               break;
+
+            //Process the incoming message
+            coapServerProcessMessage(context);
+         }
+      }
+
+      //Handle periodic operations
+      coapServerTick(context);
+
+      //Release exclusive access to the CoAP server context
+      osReleaseMutex(&context->mutex);
+
+#if (NET_RTOS_SUPPORT == ENABLED)
+   }
+#endif
+}
+
+#endif
@@ -0,0 +1,345 @@
+/**
+ * @file coap_server.h
+ * @brief CoAP server
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _COAP_SERVER_H
+#define _COAP_SERVER_H
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_common.h"
+#include "coap/coap_message.h"
+#include "coap/coap_option.h"
+
+//CoAP server support
+#ifndef COAP_SERVER_SUPPORT
+   #define COAP_SERVER_SUPPORT ENABLED
+#elif (COAP_SERVER_SUPPORT != ENABLED && COAP_SERVER_SUPPORT != DISABLED)
+   #error COAP_SERVER_SUPPORT parameter is not valid
+#endif
+
+//CoAP observe support
+#ifndef COAP_SERVER_OBSERVE_SUPPORT
+   #define COAP_SERVER_OBSERVE_SUPPORT ENABLED
+#elif (COAP_SERVER_OBSERVE_SUPPORT != ENABLED && COAP_SERVER_OBSERVE_SUPPORT != DISABLED)
+   #error COAP_SERVER_OBSERVE_SUPPORT parameter is not valid
+#endif
+
+//CoAP block-wise transfer support
+#ifndef COAP_SERVER_BLOCK_SUPPORT
+   #define COAP_SERVER_BLOCK_SUPPORT ENABLED
+#elif (COAP_SERVER_BLOCK_SUPPORT != ENABLED && COAP_SERVER_BLOCK_SUPPORT != DISABLED)
+   #error COAP_SERVER_BLOCK_SUPPORT parameter is not valid
+#endif
+
+//Stack size required to run the CoAP server
+#ifndef COAP_SERVER_STACK_SIZE
+   #define COAP_SERVER_STACK_SIZE 650
+#elif (COAP_SERVER_STACK_SIZE < 1)
+   #error COAP_SERVER_STACK_SIZE parameter is not valid
+#endif
+
+//Priority at which the CoAP server should run
+#ifndef COAP_SERVER_PRIORITY
+   #define COAP_SERVER_PRIORITY OS_TASK_PRIORITY_NORMAL
+#endif
+
+//CoAP server tick interval
+#ifndef COAP_SERVER_TICK_INTERVAL
+   #define COAP_SERVER_TICK_INTERVAL 100
+#elif (COAP_SERVER_TICK_INTERVAL < 10)
+   #error COAP_SERVER_TICK_INTERVAL parameter is not valid
+#endif
+
+//Maximum number of datagrams processed each time the socket is ready
+#ifndef COAP_SERVER_RX_BURST
+   #define COAP_SERVER_RX_BURST 16
+#elif (COAP_SERVER_RX_BURST < 1)
+   #error COAP_SERVER_RX_BURST parameter is not valid
+#endif
+
+//Maximum number of nodes in the resource tree
+#ifndef COAP_SERVER_MAX_NODES
+   #define COAP_SERVER_MAX_NODES 32
+#elif (COAP_SERVER_MAX_NODES < 2)
+   #error COAP_SERVER_MAX_NODES parameter is not valid
+#endif
+
+//Size of the cache used to detect duplicate messages
+#ifndef COAP_SERVER_DEDUP_CACHE_SIZE
+   #define COAP_SERVER_DEDUP_CACHE_SIZE 8
+#elif (COAP_SERVER_DEDUP_CACHE_SIZE < 1)
+   #error COAP_SERVER_DEDUP_CACHE_SIZE parameter is not valid
+#endif
+
+//Time during which a message ID is remembered (EXCHANGE_LIFETIME)
+#ifndef COAP_SERVER_EXCHANGE_LIFETIME
+   #define COAP_SERVER_EXCHANGE_LIFETIME 247000
+#elif (COAP_SERVER_EXCHANGE_LIFETIME < 1000)
+   #error COAP_SERVER_EXCHANGE_LIFETIME parameter is not valid
+#endif
+
+//Maximum size of a resource representation
+#ifndef COAP_SERVER_MAX_BODY_SIZE
+   #define COAP_SERVER_MAX_BODY_SIZE 2048
+#elif (COAP_SERVER_MAX_BODY_SIZE < 16)
+   #error COAP_SERVER_MAX_BODY_SIZE parameter is not valid
+#endif
+
+//Maximum number of simultaneous Block1 transfers
+#ifndef COAP_SERVER_MAX_BLOCK_TRANSFERS
+   #define COAP_SERVER_MAX_BLOCK_TRANSFERS 2
+#elif (COAP_SERVER_MAX_BLOCK_TRANSFERS < 1)
+   #error COAP_SERVER_MAX_BLOCK_TRANSFERS parameter is not valid
+#endif
+
+//Maximum number of observers
+#ifndef COAP_SERVER_MAX_OBSERVERS
+   #define COAP_SERVER_MAX_OBSERVERS 8
+#elif (COAP_SERVER_MAX_OBSERVERS < 1)
+   #error COAP_SERVER_MAX_OBSERVERS parameter is not valid
+#endif
+
+//Number of notifications between two confirmable notifications
+#ifndef COAP_SERVER_OBSERVE_CON_INTERVAL
+   #define COAP_SERVER_OBSERVE_CON_INTERVAL 16
+#elif (COAP_SERVER_OBSERVE_CON_INTERVAL < 1)
+   #error COAP_SERVER_OBSERVE_CON_INTERVAL parameter is not valid
+#endif
+
+//Maximum number of retransmissions
+#ifndef COAP_SERVER_MAX_RETRANSMIT
+   #define COAP_SERVER_MAX_RETRANSMIT 4
+#elif (COAP_SERVER_MAX_RETRANSMIT < 1)
+   #error COAP_SERVER_MAX_RETRANSMIT parameter is not valid
+#endif
+
+//Initial retransmission timeout (minimum)
+#ifndef COAP_SERVER_ACK_TIMEOUT_MIN
+   #define COAP_SERVER_ACK_TIMEOUT_MIN 2000
+#elif (COAP_SERVER_ACK_TIMEOUT_MIN < 1000)
+   #error COAP_SERVER_ACK_TIMEOUT_MIN parameter is not valid
+#endif
+
+//Initial retransmission timeout (maximum)
+#ifndef COAP_SERVER_ACK_TIMEOUT_MAX
+   #define COAP_SERVER_ACK_TIMEOUT_MAX 3000
+#elif (COAP_SERVER_ACK_TIMEOUT_MAX < COAP_SERVER_ACK_TIMEOUT_MIN)
+   #error COAP_SERVER_ACK_TIMEOUT_MAX parameter is not valid
+#endif
+
+//The resource can be observed (RFC 7641)
+#define COAP_RESOURCE_FLAG_OBSERVABLE 0x01
+//The resource also handles requests targeting any of its sub-paths
+#define COAP_RESOURCE_FLAG_PREFIX     0x02
+
+//Method mask
+#define COAP_SERVER_METHOD(code) (1U << (code))
+
+//Forward declaration of CoapServerContext structure
+struct _CoapServerContext;
+#define CoapServerContext struct _CoapServerContext
+
+//Forward declaration of CoapServerResource structure
+struct _CoapServerResource;
+#define CoapServerResource struct _CoapServerResource
+
+//Dependencies
+#include "coap/coap_server_request.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Resource handler
+ **/
+
+typedef error_t (*CoapServerResourceCallback)(CoapServerContext *context,
+   CoapServerResource *resource);
+
+
+/**
+ * @brief CoAP resource
+ **/
+
+struct _CoapServerResource
+{
+   const char_t *path;                  ///<Absolute path of the resource
+   uint_t flags;                        ///<Resource flags
+   uint_t methods;                      ///<Allowed methods (0 means any method)
+   CoapServerResourceCallback callback; ///<Resource handler
+   void *param;                         ///<User-specific parameter
+   uint32_t observeSeqNum;              ///<Sequence number of the last notification
+   bool_t changed;                      ///<The state of the resource has changed
+};
+
+
+/**
+ * @brief Node of the resource tree
+ **/
+
+typedef struct
+{
+   bool_t used;                  ///<The node is in use
+   const char_t *name;           ///<Path segment (not NULL-terminated)
+   size_t nameLen;               ///<Length of the path segment
+   uint_t parent;                ///<Index of the parent node
+   uint_t child;                 ///<Index of the first child node (0 if none)
+   uint_t sibling;               ///<Index of the next sibling node (0 if none)
+   CoapServerResource *resource; ///<Resource attached to the node, if any
+} CoapServerNode;
+
+
+/**
+ * @brief Message exchange (deduplication cache entry)
+ **/
+
+typedef struct
+{
+   bool_t valid;          ///<The entry is in use
+   systime_t timestamp;   ///<Time at which the request was received
+   IpAddr remoteIpAddr;   ///<IP address of the client
+   uint16_t remotePort;   ///<UDP port of the client
+   uint16_t mid;          ///<Message ID of the request
+   CoapMessage response;  ///<Response sent back to the client
+} CoapServerExchange;
+
+
+/**
+ * @brief Block1 transfer
+ **/
+
+typedef struct
+{
+   CoapServerResource *resource;             ///<Target resource
+   systime_t timestamp;                      ///<Time at which the last block was received
+   IpAddr remoteIpAddr;                      ///<IP address of the client
+   uint16_t remotePort;                      ///<UDP port of the client
+   size_t length;                            ///<Number of bytes received so far
+   uint8_t buffer[COAP_SERVER_MAX_BODY_SIZE]; ///<Request body
+} CoapServerBlockTransfer;
+
+
+/**
+ * @brief Observer
+ **/
+
+typedef struct
+{
+   CoapServerResource *resource;       ///<Observed resource
+   IpAddr remoteIpAddr;                ///<IP address of the client
+   uint16_t remotePort;                ///<UDP port of the client
+   uint8_t token[COAP_MAX_TOKEN_LEN];  ///<Token of the registration request
+   size_t tokenLen;                    ///<Length of the token
+   bool_t pending;                     ///<A notification is waiting to be sent
+   uint_t count;                       ///<Notifications sent since the last confirmable one
+   uint16_t mid;                       ///<Message ID of the last notification
+   bool_t ackPending;                  ///<A confirmable notification is awaiting acknowledgment
+   systime_t retransmitStartTime;      ///<Time at which the last notification was sent
+   systime_t retransmitTimeout;        ///<Retransmission timeout
+   uint_t retransmitCount;             ///<Retransmission counter
+} CoapServerObserver;
+
+
+/**
+ * @brief CoAP server settings
+ **/
+
+typedef struct
+{
+   NetInterface *interface; ///<Underlying network interface
+   uint16_t port;           ///<CoAP port number
+} CoapServerSettings;
+
+
+/**
+ * @brief CoAP server context
+ **/
+
+struct _CoapServerContext
+{
+   CoapServerSettings settings;                                     ///<User settings
+   OsMutex mutex;                                                   ///<Mutex preventing simultaneous access to the context
+   OsEvent event;                                                   ///<Event object used to poll the socket
+   Socket *socket;                                                  ///<Underlying UDP socket
+   uint16_t mid;                                                    ///<Message identifier
+   CoapServerNode nodes[COAP_SERVER_MAX_NODES];                     ///<Resource tree
+   CoapServerExchange cache[COAP_SERVER_DEDUP_CACHE_SIZE];          ///<Deduplication cache
+   IpAddr remoteIpAddr;                                             ///<IP address of the client
+   uint16_t remotePort;                                             ///<UDP port of the client
+   IpAddr localIpAddr;                                              ///<Destination address of the request
+   CoapMessage request;                                             ///<Request being processed
+   CoapMessage *response;                                           ///<Response being formatted
+   CoapServerResource *resource;                                    ///<Target resource
+   const uint8_t *requestBody;                                      ///<Request body
+   size_t requestBodyLen;                                           ///<Length of the request body
+   uint8_t responseBody[COAP_SERVER_MAX_BODY_SIZE];                 ///<Response body
+   size_t responseBodyLen;                                          ///<Length of the response body
+#if (COAP_SERVER_BLOCK_SUPPORT == ENABLED)
+   CoapServerBlockTransfer transfers[COAP_SERVER_MAX_BLOCK_TRANSFERS]; ///<Block1 transfers
+#endif
+#if (COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+   CoapServerObserver observers[COAP_SERVER_MAX_OBSERVERS];         ///<Observers
+   CoapMessage notification;                                        ///<Notification being formatted
+#endif
+};
+
+
+//CoAP server related functions
+void coapServerGetDefaultSettings(CoapServerSettings *settings);
+
+error_t coapServerInit(CoapServerContext *context,
+   const CoapServerSettings *settings);
+
+error_t coapServerRegisterResource(CoapServerContext *context,
+   CoapServerResource *resource);
+
+error_t coapServerUnregisterResource(CoapServerContext *context,
+   CoapServerResource *resource);
+
+error_t coapServerStart(CoapServerContext *context);
+
+#if (COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+
+error_t coapServerNotifyObservers(CoapServerContext *context,
+   CoapServerResource *resource);
+
+#endif
+
+void coapServerTask(CoapServerContext *context);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,421 @@
+/**
+ * @file coap_server_block.c
+ * @brief CoAP block-wise transfer (server side)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL COAP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_server.h"
+#include "coap/coap_server_block.h"
+#include "coap/coap_server_misc.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (COAP_SERVER_SUPPORT == ENABLED && COAP_SERVER_BLOCK_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Reassemble a request body carried in several blocks (Block1)
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Target resource
+ * @return Error code. ERROR_WOULD_BLOCK is returned when the response has
+ *   already been formatted and the resource handler must not be invoked
+ **/
+
+error_t coapServerProcessBlock1(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   error_t error;
+   uint32_t value;
+   size_t blockPos;
+   size_t blockSize;
+   CoapServerBlockTransfer *transfer;
+
+   //Search the request for a Block1 option
+   error = coapGetUintOption(&context->request, COAP_OPT_BLOCK1, 0, &value);
+
+   //The request body is contained in a single message?
+   if(error)
+      return NO_ERROR;
+
+   //The value 7 for SZX is reserved
+   if(COAP_GET_BLOCK_SZX(value) == COAP_BLOCK_SIZE_RESERVED)
+   {
+      //Report an error to the client
+      coapServerFormatErrorResponse(context, COAP_CODE_BAD_REQUEST);
+      //The resource handler is not invoked
+      return ERROR_WOULD_BLOCK;
+   }
+
+   //Retrieve the size and the position of the block
+   blockSize = COAP_GET_BLOCK_SIZE(value);
+   blockPos = COAP_GET_BLOCK_POS(value);
+
+   //All blocks but the last one must carry exactly one block of data
+   if(COAP_GET_BLOCK_M(value) && context->requestBodyLen != blockSize)
+   {
+      //Report an error to the client
+      coapServerFormatErrorResponse(context, COAP_CODE_BAD_REQUEST);
+      //The resource handler is not invoked
+      return ERROR_WOULD_BLOCK;
+   }
+
+   //Search for a transfer in progress
+   transfer = coapServerFindBlockTransfer(context, resource);
+
+   //First block?
+   if(blockPos == 0)
+   {
+      //Start a new transfer
+      if(transfer == NULL)
+         transfer = coapServerCreateBlockTransfer(context, resource);
+
+      //Discard any previous data
+      transfer->length = 0;
+   }
+   else if(transfer == NULL || transfer->length != blockPos)
+   {
+      //The server has not received all the preceding blocks (refer to
+      //RFC 7959, section 2.9.2)
+      coapServerFormatErrorResponse(context,
+         COAP_CODE_REQUEST_ENTITY_INCOMPLETE);
+
+      //The resource handler is not invoked
+      return ERROR_WOULD_BLOCK;
+   }
+   else
+   {
+      //The block follows the data received so far
+   }
+
+   //Make sure the request body fits in the reassembly buffer
+   if((blockPos + context->requestBodyLen) > COAP_SERVER_MAX_BODY_SIZE)
+   {
+      //Abort the transfer
+      transfer->resource = NULL;
+
+      //The Size1 option indicates the maximum acceptable size (refer to
+      //RFC 7959, section 2.9.3)
+      coapServerFormatErrorResponse(context,
+         COAP_CODE_REQUEST_ENTITY_TO_LARGE);
+
+      coapSetUintOption(context->response, COAP_OPT_SIZE1, 0,
+         COAP_SERVER_MAX_BODY_SIZE);
+
+      //The resource handler is not invoked
+      return ERROR_WOULD_BLOCK;
+   }
+
+   //Append the block to the request body
+   memcpy(transfer->buffer + blockPos, context->requestBody,
+      context->requestBodyLen);
+
+   //Update the length of the request body
+   transfer->length += context->requestBodyLen;
+   //Save the time at which the block was received
+   transfer->timestamp = osGetSystemTime();
+
+   //The Block1 option is echoed in the response
+   error = coapSetUintOption(context->response, COAP_OPT_BLOCK1, 0, value);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //More blocks to come?
+   if(COAP_GET_BLOCK_M(value))
+   {
+      //The server acknowledges the block with a 2.31 response
+      context->response->buffer[1] = COAP_CODE_CONTINUE;
+      //The resource handler is not invoked
+      return ERROR_WOULD_BLOCK;
+   }
+
+   //The resource handler processes the whole request body
+   context->requestBody = transfer->buffer;
+   context->requestBodyLen = transfer->length;
+
+   //Release the transfer. The buffer remains untouched until the handler
+   //returns since requests are processed one at a time
+   transfer->resource = NULL;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Add the response body, splitting it into blocks if needed (Block2)
+ * @param[in] context Pointer to the CoAP server context
+ * @return Error code
+ **/
+
+error_t coapServerFormatBlock2(CoapServerContext *context)
+{
+   error_t error;
+   uint_t szx;
+   uint_t maxSzx;
+   uint32_t value;
+   uint32_t blockNum;
+   size_t n;
+   size_t blockPos;
+   size_t blockSize;
+   CoapMessage *response;
+
+   //Point to the response message
+   response = context->response;
+   //Retrieve the largest block size supported by the server
+   maxSzx = coapServerGetMaxBlockSize();
+
+   //Check whether the client asked for a particular block
+   error = coapGetUintOption(&context->request, COAP_OPT_BLOCK2, 0, &value);
+
+   //No Block2 option in the request?
+   if(error)
+   {
+      //The representation fits in a single message?
+      if((response->length + context->responseBodyLen + 2) <=
+         COAP_MAX_MSG_SIZE)
+      {
+         //Block-wise transfer is not needed
+         return coapSetPayload(response, context->responseBody,
+            context->responseBodyLen);
+      }
+
+      //The first block is sent
+      blockNum = 0;
+      szx = maxSzx;
+   }
+   else
+   {
+      //The value 7 for SZX is reserved
+      if(COAP_GET_BLOCK_SZX(value) == COAP_BLOCK_SIZE_RESERVED)
+         return coapServerFormatErrorResponse(context, COAP_CODE_BAD_REQUEST);
+
+      //Retrieve the block requested by the client
+      blockNum = COAP_GET_BLOCK_NUM(value);
+      szx = COAP_GET_BLOCK_SZX(value);
+
+      //The server may use a smaller block size than the one requested by the
+      //client (refer to RFC 7959, section 2.4)
+      if(szx > maxSzx)
+      {
+         blockNum <<= szx - maxSzx;
+         szx = maxSzx;
+      }
+   }
+
+   //Make sure the block fits in the message along with the options
+   while(szx > COAP_BLOCK_SIZE_16 && (response->length + (16U << szx) +
+      COAP_SERVER_BLOCK2_OVERHEAD) > COAP_MAX_MSG_SIZE)
+   {
+      //Halve the block size
+      blockNum <<= 1;
+      szx--;
+   }
+
+   //Compute the position of the block
+   blockSize = 16U << szx;
+   blockPos = blockNum * blockSize;
+
+   //The requested block does not exist?
+   if(blockPos > context->responseBodyLen ||
+      (blockPos == context->responseBodyLen && blockPos > 0))
+   {
+      //Report an error to the client
+      return coapServerFormatErrorResponse(context, COAP_CODE_BAD_OPTION);
+   }
+
+   //Number of bytes in the current block
+   n = MIN(context->responseBodyLen - blockPos, blockSize);
+
+   //Format Block2 option
+   value = 0;
+   COAP_SET_BLOCK_NUM(value, blockNum);
+   COAP_SET_BLOCK_M(value, (blockPos + n) < context->responseBodyLen);
+   COAP_SET_BLOCK_SZX(value, szx);
+
+   //Add Block2 option
+   error = coapSetUintOption(response, COAP_OPT_BLOCK2, 0, value);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The first block indicates the total size of the representation
+   if(blockNum == 0 && COAP_GET_BLOCK_M(value))
+   {
+      //Add Size2 option
+      error = coapSetUintOption(response, COAP_OPT_SIZE2, 0,
+         context->responseBodyLen);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+
+   //Copy the contents of the block
+   return coapSetPayload(response, context->responseBody + blockPos, n);
+}
+
+
+/**
+ * @brief Search for a Block1 transfer in progress
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Target resource
+ * @return Pointer to the matching transfer, if any
+ **/
+
+CoapServerBlockTransfer *coapServerFindBlockTransfer(
+   CoapServerContext *context, CoapServerResource *resource)
+{
+   uint_t i;
+   systime_t time;
+   CoapServerBlockTransfer *transfer;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the transfers
+   for(i = 0; i < COAP_SERVER_MAX_BLOCK_TRANSFERS; i++)
+   {
+      //Point to the current transfer
+      transfer = &context->transfers[i];
+
+      //Transfer in progress?
+      if(transfer->resource != NULL)
+      {
+         //Stale transfers are discarded
+         if(timeCompare(time, transfer->timestamp +
+            COAP_SERVER_EXCHANGE_LIFETIME) >= 0)
+         {
+            //Release the transfer
+            transfer->resource = NULL;
+         }
+         else if(transfer->resource == resource &&
+            transfer->remotePort == context->remotePort &&
+            ipCompAddr(&transfer->remoteIpAddr, &context->remoteIpAddr))
+         {
+            //A matching transfer has been found
+            return transfer;
+         }
+         else
+         {
+            //Just for sanity
+         }
+      }
+   }
+
+   //No matching transfer
+   return NULL;
+}
+
+
+/**
+ * @brief Start a new Block1 transfer
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Target resource
+ * @return Pointer to the newly created transfer
+ **/
+
+CoapServerBlockTransfer *coapServerCreateBlockTransfer(
+   CoapServerContext *context, CoapServerResource *resource)
+{
+   uint_t i;
+   CoapServerBlockTransfer *transfer;
+   CoapServerBlockTransfer *oldestTransfer;
+
+   //Keep track of the oldest transfer
+   oldestTransfer = &context->transfers[0];
+
+   //Loop through the transfers
+   for(i = 0; i < COAP_SERVER_MAX_BLOCK_TRANSFERS; i++)
+   {
+      //Point to the current transfer
+      transfer = &context->transfers[i];
+
+      //Check whether the transfer is available
+      if(transfer->resource == NULL)
+      {
+         oldestTransfer = transfer;
+         break;
+      }
+
+      //Keep track of the oldest transfer
+      if(timeCompare(transfer->timestamp, oldestTransfer->timestamp) < 0)
+      {
+         oldestTransfer = transfer;
+      }
+   }
+
+   //Point to the selected transfer
+   transfer = oldestTransfer;
+
+   //Initialize the transfer
+   transfer->resource = resource;
+   transfer->timestamp = osGetSystemTime();
+   transfer->remoteIpAddr = context->remoteIpAddr;
+   transfer->remotePort = context->remotePort;
+   transfer->length = 0;
+
+   //Return a pointer to the transfer
+   return transfer;
+}
+
+
+/**
+ * @brief Get maximum block size
+ * @return Block size
+ **/
+
+CoapBlockSize coapServerGetMaxBlockSize(void)
+{
+   CoapBlockSize blockSize;
+
+   //Retrieve maximum block size
+#if (COAP_MAX_MSG_SIZE > 1024)
+   blockSize = COAP_BLOCK_SIZE_1024;
+#elif (COAP_MAX_MSG_SIZE > 512)
+   blockSize = COAP_BLOCK_SIZE_512;
+#elif (COAP_MAX_MSG_SIZE > 256)
+   blockSize = COAP_BLOCK_SIZE_256;
+#elif (COAP_MAX_MSG_SIZE > 128)
+   blockSize = COAP_BLOCK_SIZE_128;
+#elif (COAP_MAX_MSG_SIZE > 64)
+   blockSize = COAP_BLOCK_SIZE_64;
+#elif (COAP_MAX_MSG_SIZE > 32)
+   blockSize = COAP_BLOCK_SIZE_32;
+#else
+   blockSize = COAP_BLOCK_SIZE_16;
+#endif
+
+   //Return maximum block size
+   return blockSize;
+}
+
+#endif
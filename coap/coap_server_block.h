@@ -0,0 +1,65 @@
+/**
+ * @file coap_server_block.h
+ * @brief CoAP block-wise transfer (server side)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _COAP_SERVER_BLOCK_H
+#define _COAP_SERVER_BLOCK_H
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_server.h"
+
+//Room reserved for the Block2 and Size2 options
+#define COAP_SERVER_BLOCK2_OVERHEAD 16
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//CoAP server related functions
+error_t coapServerProcessBlock1(CoapServerContext *context,
+   CoapServerResource *resource);
+
+error_t coapServerFormatBlock2(CoapServerContext *context);
+
+CoapServerBlockTransfer *coapServerFindBlockTransfer(
+   CoapServerContext *context, CoapServerResource *resource);
+
+CoapServerBlockTransfer *coapServerCreateBlockTransfer(
+   CoapServerContext *context, CoapServerResource *resource);
+
+CoapBlockSize coapServerGetMaxBlockSize(void);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
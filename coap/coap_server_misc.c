@@ -0,0 +1,867 @@
+/**
+ * @file coap_server_misc.c
+ * @brief Helper functions for CoAP server
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL COAP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_server.h"
+#include "coap/coap_server_misc.h"
+#include "coap/coap_server_block.h"
+#include "coap/coap_server_observe.h"
+#include "coap/coap_debug.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (COAP_SERVER_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Handle periodic operations
+ * @param[in] context Pointer to the CoAP server context
+ **/
+
+void coapServerTick(CoapServerContext *context)
+{
+#if (COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+   //Send pending notifications and retransmit confirmable ones
+   coapServerProcessObservers(context);
+#endif
+}
+
+
+/**
+ * @brief Process incoming CoAP message
+ * @param[in] context Pointer to the CoAP server context
+ * @return Error code
+ **/
+
+error_t coapServerProcessMessage(CoapServerContext *context)
+{
+   error_t error;
+   uint16_t mid;
+   CoapMessageHeader *header;
+   CoapServerExchange *exchange;
+
+   //Rewind to the beginning of the buffer
+   context->request.pos = 0;
+
+   //Debug message
+   TRACE_DEBUG("CoAP message received from %s port %" PRIu16
+      " (%" PRIuSIZE " bytes)...\r\n", ipAddrToString(&context->remoteIpAddr,
+      NULL), context->remotePort, context->request.length);
+
+   //Point to the CoAP message header
+   header = (CoapMessageHeader *) context->request.buffer;
+
+   //Check the format of the message
+   error = coapParseMessage(&context->request);
+
+   //Malformed message?
+   if(error)
+   {
+      //Rejecting a confirmable message is effected by sending a matching
+      //Reset message (refer to RFC 7252, section 4.2)
+      if(context->request.length >= sizeof(CoapMessageHeader) &&
+         header->version == COAP_VERSION_1 && header->type == COAP_TYPE_CON)
+      {
+         coapServerSendReset(context, ntohs(header->mid));
+      }
+
+      //Drop the incoming message
+      return error;
+   }
+
+   //Terminate the payload with a NULL character
+   context->request.buffer[context->request.length] = '\0';
+
+   //Dump the contents of the message for debugging purpose
+   coapDumpMessage(context->request.buffer, context->request.length);
+
+   //Retrieve message ID
+   mid = ntohs(header->mid);
+
+   //Acknowledgment or Reset message?
+   if(header->type == COAP_TYPE_ACK || header->type == COAP_TYPE_RST)
+   {
+#if (COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+      //The message may relate to a notification
+      coapServerProcessObserveReply(context, (CoapMessageType) header->type,
+         mid);
+#endif
+      //Successful processing
+      return NO_ERROR;
+   }
+
+   //Empty or response message?
+   if(COAP_GET_CODE_CLASS(header->code) != 0 ||
+      header->code == COAP_CODE_EMPTY)
+   {
+      //An empty confirmable message (CoAP ping) elicits a Reset message.
+      //Unexpected non-confirmable messages are silently ignored
+      if(header->type == COAP_TYPE_CON)
+         coapServerSendReset(context, mid);
+
+      //Drop the incoming message
+      return NO_ERROR;
+   }
+
+   //Search the cache for a previous instance of the same message
+   exchange = coapServerFindExchange(context, mid);
+
+   //Duplicate message?
+   if(exchange != NULL)
+   {
+      //Debug message
+      TRACE_DEBUG("Duplicate CoAP message received (MID = %" PRIu16 ")\r\n",
+         mid);
+
+      //The response is sent again without processing the request a second
+      //time (refer to RFC 7252, section 4.5)
+      if(exchange->response.length > 0)
+      {
+         coapServerSendMessage(context, &context->remoteIpAddr,
+            context->remotePort, &exchange->response);
+      }
+
+      //Exit immediately
+      return NO_ERROR;
+   }
+
+   //The response is formatted directly in the cache
+   exchange = coapServerCreateExchange(context, mid);
+   context->response = &exchange->response;
+
+   //Process CoAP request
+   error = coapServerProcessRequest(context);
+
+   //Check status code
+   if(!error)
+   {
+      //A server should not respond with an error to a multicast request
+      //(refer to RFC 7252, section 8.1)
+      if(ipIsMulticastAddr(&context->localIpAddr))
+      {
+         //Check response code
+         if(COAP_GET_CODE_CLASS(context->response->buffer[1]) !=
+            COAP_CODE_CLASS_SUCCESS)
+         {
+            //Suppress the response
+            context->response->length = 0;
+            coapInvalidateOptionIndex(context->response);
+         }
+      }
+
+      //Any response to send?
+      if(context->response->length > 0)
+      {
+         //Send the response back to the client
+         error = coapServerSendMessage(context, &context->remoteIpAddr,
+            context->remotePort, context->response);
+      }
+   }
+   else
+   {
+      //The request could not be processed
+      exchange->valid = FALSE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process CoAP request
+ * @param[in] context Pointer to the CoAP server context
+ * @return Error code
+ **/
+
+error_t coapServerProcessRequest(CoapServerContext *context)
+{
+   error_t error;
+   uint_t method;
+   CoapMessageHeader *header;
+   CoapServerResource *resource;
+
+   //Point to the CoAP message header
+   header = (CoapMessageHeader *) context->request.buffer;
+   //Retrieve method code
+   method = header->code;
+
+   //Check message type
+   if(header->type == COAP_TYPE_CON)
+   {
+      //A confirmable request is acknowledged with a piggybacked response
+      //that echoes the message ID of the request
+      error = coapServerFormatResponseHeader(context, context->response,
+         COAP_TYPE_ACK, ntohs(header->mid), header);
+   }
+   else
+   {
+      //A non-confirmable request is answered with a non-confirmable response
+      error = coapServerFormatResponseHeader(context, context->response,
+         COAP_TYPE_NON, coapServerGenerateMessageId(context), header);
+   }
+
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Walk through the resource tree
+   error = coapServerFindResource(context, &resource);
+
+   //Check status code
+   if(error == ERROR_INVALID_OPTION)
+   {
+      //Unrecognized options of class critical must cause a 4.02 response
+      error = coapServerFormatErrorResponse(context, COAP_CODE_BAD_OPTION);
+   }
+   else if(error == ERROR_NOT_FOUND)
+   {
+      //No resource matches the request URI
+      error = coapServerFormatErrorResponse(context, COAP_CODE_NOT_FOUND);
+   }
+   else if(error)
+   {
+      //Malformed request
+   }
+   else if(method > COAP_CODE_IPATCH || (resource->methods != 0 &&
+      (resource->methods & COAP_SERVER_METHOD(method)) == 0))
+   {
+      //The method is not recognized or not supported by the resource
+      error = coapServerFormatErrorResponse(context,
+         COAP_CODE_METHOD_NOT_ALLOWED);
+   }
+   else
+   {
+      //Retrieve the payload of the request
+      error = coapGetPayload(&context->request, &context->requestBody,
+         &context->requestBodyLen);
+
+#if (COAP_SERVER_BLOCK_SUPPORT == ENABLED)
+      //Check status code
+      if(!error)
+      {
+         //Reassemble the request body when it is split into several blocks
+         error = coapServerProcessBlock1(context, resource);
+      }
+#endif
+
+      //Check status code
+      if(!error)
+      {
+         //Invoke the resource handler
+         error = coapServerInvokeHandler(context, resource);
+
+#if (COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+         //Check status code
+         if(!error)
+         {
+            //Register or deregister the client as an observer
+            error = coapServerProcessObserveRequest(context, resource);
+         }
+#endif
+         //Check status code
+         if(!error)
+         {
+            //Add the response body
+            error = coapServerFormatPayload(context);
+         }
+      }
+      else if(error == ERROR_WOULD_BLOCK)
+      {
+         //The response has already been formatted
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Just for sanity
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Invoke the handler of a given resource
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Target resource
+ * @return Error code
+ **/
+
+error_t coapServerInvokeHandler(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   error_t error;
+
+   //Save the target resource
+   context->resource = resource;
+   //The response body is empty until the handler writes it
+   context->responseBodyLen = 0;
+
+   //Invoke user callback function
+   error = resource->callback(context, resource);
+
+   //Check status code
+   if(error)
+   {
+      //Debug message
+      TRACE_WARNING("CoAP resource handler failed (error %u)\r\n", error);
+
+      //Report an internal server error to the client
+      error = coapServerFormatErrorResponse(context,
+         COAP_CODE_INTERNAL_SERVER);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Search the resource tree for the target of a request
+ *
+ * The options of the request are walked through once. Each Uri-Path segment
+ * moves one level down the resource tree, while unrecognized critical
+ * options are reported to the caller
+ *
+ * @param[in] context Pointer to the CoAP server context
+ * @param[out] resource Resource that matches the request URI
+ * @return Error code
+ **/
+
+error_t coapServerFindResource(CoapServerContext *context,
+   CoapServerResource **resource)
+{
+   error_t error;
+   bool_t matched;
+   size_t n;
+   size_t length;
+   uint_t i;
+   uint_t j;
+   const uint8_t *p;
+   CoapOption option;
+   CoapServerResource *prefix;
+
+   //Point to the first byte of the CoAP message
+   p = context->request.buffer;
+   //Retrieve the length of the message
+   length = context->request.length;
+
+   //Parse message header
+   error = coapParseMessageHeader(p, length, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Point to the first option of the message
+   p += n;
+   //Number of bytes left to process
+   length -= n;
+
+   //Start from the root of the resource tree
+   i = 0;
+   matched = TRUE;
+   prefix = NULL;
+
+   //For the first option in a message, a preceding option instance with
+   //Option Number zero is assumed
+   option.number = 0;
+
+   //Loop through CoAP options
+   while(length > 0)
+   {
+      //Payload marker found?
+      if(*p == COAP_PAYLOAD_MARKER)
+         break;
+
+      //Parse current option
+      error = coapParseOption(p, length, option.number, &option, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Uri-Path option?
+      if(option.number == COAP_OPT_URI_PATH)
+      {
+         //The path has matched so far?
+         if(matched)
+         {
+            //Keep track of the deepest resource that handles sub-paths
+            if(context->nodes[i].resource != NULL &&
+               (context->nodes[i].resource->flags & COAP_RESOURCE_FLAG_PREFIX))
+            {
+               prefix = context->nodes[i].resource;
+            }
+
+            //Move one level down the resource tree
+            j = coapServerFindChildNode(context, i, option.value,
+               option.length);
+
+            //Check whether the segment has been found
+            if(j != 0)
+               i = j;
+            else
+               matched = FALSE;
+         }
+      }
+      else if(COAP_IS_OPTION_CRITICAL(option.number))
+      {
+         //Unrecognized options of class critical must be rejected (refer to
+         //RFC 7252, section 5.4.1). Q-Block options are not supported by the
+         //server, so that the client falls back to Block1/Block2
+         if(coapGetOptionParameters(option.number) == NULL ||
+            option.number == COAP_OPT_Q_BLOCK1 ||
+            option.number == COAP_OPT_Q_BLOCK2)
+         {
+            return ERROR_INVALID_OPTION;
+         }
+      }
+      else
+      {
+         //Unrecognized elective options are silently ignored
+      }
+
+      //Jump to the next option
+      p += n;
+      length -= n;
+   }
+
+   //Exact match?
+   if(matched && context->nodes[i].resource != NULL)
+   {
+      *resource = context->nodes[i].resource;
+   }
+   else if(prefix != NULL)
+   {
+      *resource = prefix;
+   }
+   else
+   {
+      //No resource matches the request URI
+      return ERROR_NOT_FOUND;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Search the children of a node for a given path segment
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] parent Index of the parent node
+ * @param[in] name Path segment
+ * @param[in] length Length of the path segment
+ * @return Index of the matching node, or 0 if no match was found
+ **/
+
+uint_t coapServerFindChildNode(CoapServerContext *context, uint_t parent,
+   const uint8_t *name, size_t length)
+{
+   uint_t i;
+   CoapServerNode *node;
+
+   //Loop through the children of the parent node
+   for(i = context->nodes[parent].child; i != 0; i = node->sibling)
+   {
+      //Point to the current node
+      node = &context->nodes[i];
+
+      //Compare path segments
+      if(node->nameLen == length && !memcmp(node->name, name, length))
+         break;
+   }
+
+   //Return the index of the matching node
+   return i;
+}
+
+
+/**
+ * @brief Release the nodes that are no longer needed
+ *
+ * Starting from the specified node, the nodes that are neither attached to
+ * a resource nor have any children are removed from the resource tree
+ *
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] index Index of the first node to consider
+ **/
+
+void coapServerPruneNode(CoapServerContext *context, uint_t index)
+{
+   uint_t *p;
+   CoapServerNode *node;
+
+   //The root node is never released
+   while(index != 0)
+   {
+      //Point to the current node
+      node = &context->nodes[index];
+
+      //The node is still needed?
+      if(node->resource != NULL || node->child != 0)
+         break;
+
+      //Unlink the node from the children list of its parent
+      for(p = &context->nodes[node->parent].child; *p != 0;
+         p = &context->nodes[*p].sibling)
+      {
+         if(*p == index)
+         {
+            *p = node->sibling;
+            break;
+         }
+      }
+
+      //Release the node
+      node->used = FALSE;
+      //Move to the parent node
+      index = node->parent;
+   }
+}
+
+
+/**
+ * @brief Search the deduplication cache for a given message
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] mid Message ID
+ * @return Pointer to the matching entry, if any
+ **/
+
+CoapServerExchange *coapServerFindExchange(CoapServerContext *context,
+   uint16_t mid)
+{
+   uint_t i;
+   systime_t time;
+   CoapServerExchange *exchange;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the deduplication cache
+   for(i = 0; i < COAP_SERVER_DEDUP_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      exchange = &context->cache[i];
+
+      //Valid entry?
+      if(exchange->valid)
+      {
+         //A message ID is remembered for EXCHANGE_LIFETIME
+         if(timeCompare(time, exchange->timestamp +
+            COAP_SERVER_EXCHANGE_LIFETIME) >= 0)
+         {
+            //The entry has expired
+            exchange->valid = FALSE;
+         }
+         else if(exchange->mid == mid &&
+            exchange->remotePort == context->remotePort &&
+            ipCompAddr(&exchange->remoteIpAddr, &context->remoteIpAddr))
+         {
+            //A matching entry has been found
+            return exchange;
+         }
+         else
+         {
+            //Just for sanity
+         }
+      }
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+
+/**
+ * @brief Create a new entry in the deduplication cache
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] mid Message ID
+ * @return Pointer to the newly created entry
+ **/
+
+CoapServerExchange *coapServerCreateExchange(CoapServerContext *context,
+   uint16_t mid)
+{
+   uint_t i;
+   CoapServerExchange *exchange;
+   CoapServerExchange *oldestExchange;
+
+   //Keep track of the oldest entry
+   oldestExchange = &context->cache[0];
+
+   //Loop through the deduplication cache
+   for(i = 0; i < COAP_SERVER_DEDUP_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      exchange = &context->cache[i];
+
+      //Check whether the entry is available
+      if(!exchange->valid)
+      {
+         oldestExchange = exchange;
+         break;
+      }
+
+      //Keep track of the oldest entry
+      if(timeCompare(exchange->timestamp, oldestExchange->timestamp) < 0)
+      {
+         oldestExchange = exchange;
+      }
+   }
+
+   //Point to the selected entry
+   exchange = oldestExchange;
+
+   //Save the identity of the message
+   exchange->valid = TRUE;
+   exchange->timestamp = osGetSystemTime();
+   exchange->remoteIpAddr = context->remoteIpAddr;
+   exchange->remotePort = context->remotePort;
+   exchange->mid = mid;
+   exchange->response.length = 0;
+   exchange->response.pos = 0;
+   coapInvalidateOptionIndex(&exchange->response);
+
+   //Return a pointer to the entry
+   return exchange;
+}
+
+
+/**
+ * @brief Format the header of a response message
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] response Response message to be formatted
+ * @param[in] type Message type (ACK, CON or NON)
+ * @param[in] mid Message ID
+ * @param[in] request Header of the request
+ * @return Error code
+ **/
+
+error_t coapServerFormatResponseHeader(CoapServerContext *context,
+   CoapMessage *response, CoapMessageType type, uint16_t mid,
+   const CoapMessageHeader *request)
+{
+   CoapCode code;
+   CoapMessageHeader *header;
+
+   //Select a default response code that matches the method
+   switch(request->code)
+   {
+   case COAP_CODE_GET:
+   case COAP_CODE_FETCH:
+      code = COAP_CODE_CONTENT;
+      break;
+   case COAP_CODE_DELETE:
+      code = COAP_CODE_DELETED;
+      break;
+   default:
+      code = COAP_CODE_CHANGED;
+      break;
+   }
+
+   //Point to the CoAP message header
+   header = (CoapMessageHeader *) response->buffer;
+
+   //Format message header
+   header->version = COAP_VERSION_1;
+   header->type = type;
+   header->tokenLen = request->tokenLen;
+   header->code = code;
+   header->mid = htons(mid);
+
+   //The token of the request is echoed in the response
+   memcpy(header->token, request->token, request->tokenLen);
+
+   //Length of the response message
+   response->length = sizeof(CoapMessageHeader) + request->tokenLen;
+   response->pos = 0;
+
+   //The response does not contain any option yet
+   coapInvalidateOptionIndex(response);
+
+   //The response body is empty for now
+   context->response = response;
+   context->responseBodyLen = 0;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format an error response
+ *
+ * The options that may have been added to the response so far are discarded
+ *
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] code Response code
+ * @return Error code
+ **/
+
+error_t coapServerFormatErrorResponse(CoapServerContext *context,
+   CoapCode code)
+{
+   CoapMessageHeader *header;
+
+   //Point to the CoAP message header
+   header = (CoapMessageHeader *) context->response->buffer;
+
+   //Keep the header and the token only
+   context->response->length = sizeof(CoapMessageHeader) + header->tokenLen;
+   coapInvalidateOptionIndex(context->response);
+   //Set response code
+   header->code = code;
+
+   //The response carries no payload
+   context->responseBodyLen = 0;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Add the response body to the response message
+ * @param[in] context Pointer to the CoAP server context
+ * @return Error code
+ **/
+
+error_t coapServerFormatPayload(CoapServerContext *context)
+{
+   error_t error;
+
+#if (COAP_SERVER_BLOCK_SUPPORT == ENABLED)
+   //Successful response?
+   if(COAP_GET_CODE_CLASS(context->response->buffer[1]) ==
+      COAP_CODE_CLASS_SUCCESS)
+   {
+      //Large representations are split into several blocks
+      error = coapServerFormatBlock2(context);
+   }
+   else
+#endif
+   {
+      //The response body is sent in a single message
+      error = coapSetPayload(context->response, context->responseBody,
+         context->responseBodyLen);
+   }
+
+   //The response body does not fit in the message?
+   if(error == ERROR_BUFFER_OVERFLOW)
+   {
+      //Report an internal server error to the client
+      error = coapServerFormatErrorResponse(context,
+         COAP_CODE_INTERNAL_SERVER);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send a CoAP message
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] remoteIpAddr IP address of the client
+ * @param[in] remotePort UDP port of the client
+ * @param[in] message CoAP message to be sent
+ * @return Error code
+ **/
+
+error_t coapServerSendMessage(CoapServerContext *context,
+   const IpAddr *remoteIpAddr, uint16_t remotePort,
+   const CoapMessage *message)
+{
+   //Debug message
+   TRACE_DEBUG("Sending CoAP message (%" PRIuSIZE " bytes)...\r\n",
+      message->length);
+
+   //Dump the contents of the message for debugging purpose
+   coapDumpMessage(message->buffer, message->length);
+
+   //Send CoAP message
+   return socketSendTo(context->socket, remoteIpAddr, remotePort,
+      message->buffer, message->length, NULL, 0);
+}
+
+
+/**
+ * @brief Send Reset message
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] mid Message ID
+ * @return Error code
+ **/
+
+error_t coapServerSendReset(CoapServerContext *context, uint16_t mid)
+{
+   CoapMessageHeader message;
+
+   //Format Reset message
+   message.version = COAP_VERSION_1;
+   message.type = COAP_TYPE_RST;
+   message.tokenLen = 0;
+   message.code = COAP_CODE_EMPTY;
+
+   //The Reset message message must echo the message ID of the confirmable
+   //message and must be empty
+   message.mid = htons(mid);
+
+   //Debug message
+   TRACE_DEBUG("Sending Reset message (%" PRIuSIZE " bytes)...\r\n",
+      sizeof(message));
+
+   //Dump the contents of the message for debugging purpose
+   coapDumpMessage(&message, sizeof(message));
+
+   //Send CoAP message
+   return socketSendTo(context->socket, &context->remoteIpAddr,
+      context->remotePort, &message, sizeof(message), NULL, 0);
+}
+
+
+/**
+ * @brief Generate a new message identifier
+ * @param[in] context Pointer to the CoAP server context
+ * @return Message identifier
+ **/
+
+uint16_t coapServerGenerateMessageId(CoapServerContext *context)
+{
+   //Increment message identifier
+   return context->mid++;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file coap_server_misc.h
+ * @brief Helper functions for CoAP server
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _COAP_SERVER_MISC_H
+#define _COAP_SERVER_MISC_H
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_server.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//CoAP server related functions
+void coapServerTick(CoapServerContext *context);
+
+error_t coapServerProcessMessage(CoapServerContext *context);
+error_t coapServerProcessRequest(CoapServerContext *context);
+
+error_t coapServerInvokeHandler(CoapServerContext *context,
+   CoapServerResource *resource);
+
+error_t coapServerFindResource(CoapServerContext *context,
+   CoapServerResource **resource);
+
+uint_t coapServerFindChildNode(CoapServerContext *context, uint_t parent,
+   const uint8_t *name, size_t length);
+
+void coapServerPruneNode(CoapServerContext *context, uint_t index);
+
+CoapServerExchange *coapServerFindExchange(CoapServerContext *context,
+   uint16_t mid);
+
+CoapServerExchange *coapServerCreateExchange(CoapServerContext *context,
+   uint16_t mid);
+
+error_t coapServerFormatResponseHeader(CoapServerContext *context,
+   CoapMessage *response, CoapMessageType type, uint16_t mid,
+   const CoapMessageHeader *request);
+
+error_t coapServerFormatErrorResponse(CoapServerContext *context,
+   CoapCode code);
+
+error_t coapServerFormatPayload(CoapServerContext *context);
+
+error_t coapServerSendMessage(CoapServerContext *context,
+   const IpAddr *remoteIpAddr, uint16_t remotePort,
+   const CoapMessage *message);
+
+error_t coapServerSendReset(CoapServerContext *context, uint16_t mid);
+
+uint16_t coapServerGenerateMessageId(CoapServerContext *context);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,529 @@
+/**
+ * @file coap_server_observe.c
+ * @brief CoAP observe (server side)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL COAP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "coap/coap_server.h"
+#include "coap/coap_server_observe.h"
+#include "coap/coap_server_misc.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (COAP_SERVER_SUPPORT == ENABLED && COAP_SERVER_OBSERVE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Notify the observers of a resource that its state has changed
+ *
+ * The notifications are sent asynchronously by the CoAP server task, which
+ * invokes the resource handler once per observer. The function does not
+ * acquire the CoAP server mutex, so that it can be called from any task,
+ * including a resource handler
+ *
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Resource whose state has changed
+ * @return Error code
+ **/
+
+error_t coapServerNotifyObservers(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   //Check parameters
+   if(context == NULL || resource == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The observers are marked by the CoAP server task
+   resource->changed = TRUE;
+
+   //Wake up the CoAP server task
+   osSetEvent(&context->event);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process the Observe option of a request
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Target resource
+ * @return Error code
+ **/
+
+error_t coapServerProcessObserveRequest(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   error_t error;
+   uint32_t value;
+   CoapServerObserver *observer;
+   CoapMessageHeader *header;
+
+   //Search the request for an Observe option
+   error = coapGetUintOption(&context->request, COAP_OPT_OBSERVE, 0, &value);
+   //Not an observation request?
+   if(error)
+      return NO_ERROR;
+
+   //Point to the request header
+   header = (CoapMessageHeader *) context->request.buffer;
+
+   //Only GET and FETCH requests can be observed
+   if(header->code != COAP_CODE_GET && header->code != COAP_CODE_FETCH)
+      return NO_ERROR;
+
+   //Search for an existing observation of the resource by the same client
+   observer = coapServerFindObserver(context, resource);
+
+   //Deregistration request?
+   if(value == COAP_OBSERVE_DEREGISTER)
+   {
+      //The client is removed from the list of observers
+      if(observer != NULL)
+         observer->resource = NULL;
+
+      //The request is processed as a normal GET request
+      return NO_ERROR;
+   }
+
+   //A non-2.xx response removes the client from the list of observers
+   //(refer to RFC 7641, section 4.1)
+   if(COAP_GET_CODE_CLASS(context->response->buffer[1]) !=
+      COAP_CODE_CLASS_SUCCESS)
+   {
+      if(observer != NULL)
+         observer->resource = NULL;
+
+      return NO_ERROR;
+   }
+
+   //The resource cannot be observed?
+   if(!(resource->flags & COAP_RESOURCE_FLAG_OBSERVABLE))
+      return NO_ERROR;
+
+   //Only the first block of a representation registers an observation
+   error = coapGetUintOption(&context->request, COAP_OPT_BLOCK2, 0, &value);
+   if(!error && COAP_GET_BLOCK_NUM(value) != 0)
+      return NO_ERROR;
+
+   //New observer?
+   if(observer == NULL)
+   {
+      //Search the list of observers for a free entry
+      observer = coapServerFindObserver(context, NULL);
+
+      //The server is unwilling to add the client to the list of observers?
+      if(observer == NULL)
+      {
+         //Debug message
+         TRACE_INFO("Too many CoAP observers!\r\n");
+         //The request is processed as a normal GET request
+         return NO_ERROR;
+      }
+
+      //Save the identity of the client
+      observer->resource = resource;
+      observer->remoteIpAddr = context->remoteIpAddr;
+      observer->remotePort = context->remotePort;
+      observer->ackPending = FALSE;
+   }
+
+   //Notifications echo the token of the latest registration request
+   memcpy(observer->token, header->token, header->tokenLen);
+   observer->tokenLen = header->tokenLen;
+
+   //Reset the notification state
+   observer->pending = FALSE;
+   observer->count = 0;
+
+   //The response includes the Observe option to indicate that the client
+   //has been added to the list of observers
+   return coapSetUintOption(context->response, COAP_OPT_OBSERVE, 0,
+      resource->observeSeqNum);
+}
+
+
+/**
+ * @brief Process an Acknowledgment or Reset message related to a notification
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] type Message type (ACK or RST)
+ * @param[in] mid Message ID
+ **/
+
+void coapServerProcessObserveReply(CoapServerContext *context,
+   CoapMessageType type, uint16_t mid)
+{
+   uint_t i;
+   CoapServerObserver *observer;
+
+   //Loop through the observers
+   for(i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++)
+   {
+      //Point to the current observer
+      observer = &context->observers[i];
+
+      //Matching notification?
+      if(observer->resource != NULL && observer->mid == mid &&
+         observer->remotePort == context->remotePort &&
+         ipCompAddr(&observer->remoteIpAddr, &context->remoteIpAddr))
+      {
+         //Acknowledgment message?
+         if(type == COAP_TYPE_ACK)
+         {
+            //The client is still interested in the resource
+            observer->ackPending = FALSE;
+         }
+         else
+         {
+            //A client that rejects a notification is removed from the list
+            //of observers (refer to RFC 7641, section 3.6)
+            observer->resource = NULL;
+         }
+
+         //We are done
+         break;
+      }
+   }
+}
+
+
+/**
+ * @brief Send pending notifications and retransmit confirmable ones
+ * @param[in] context Pointer to the CoAP server context
+ **/
+
+void coapServerProcessObservers(CoapServerContext *context)
+{
+   uint_t i;
+   uint_t j;
+   systime_t time;
+   CoapServerObserver *observer;
+   CoapServerResource *resource;
+
+   //Loop through the observers
+   for(i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++)
+   {
+      //Point to the observed resource
+      resource = context->observers[i].resource;
+
+      //Has the state of the resource changed?
+      if(resource != NULL && resource->changed)
+      {
+         //The flag is cleared before the resource handler is invoked, so
+         //that a change made meanwhile triggers a new notification
+         resource->changed = FALSE;
+
+         //The sequence number is incremented for each new state of the
+         //resource
+         resource->observeSeqNum = (resource->observeSeqNum + 1) & 0x00FFFFFF;
+
+         //Loop through the observers of the resource
+         for(j = i; j < COAP_SERVER_MAX_OBSERVERS; j++)
+         {
+            //Matching resource?
+            if(context->observers[j].resource == resource)
+            {
+               //A notification is waiting to be sent
+               context->observers[j].pending = TRUE;
+            }
+         }
+      }
+   }
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the observers
+   for(i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++)
+   {
+      //Point to the current observer
+      observer = &context->observers[i];
+
+      //Inactive entry?
+      if(observer->resource == NULL)
+         continue;
+
+      //Confirmable notification awaiting acknowledgment?
+      if(observer->ackPending)
+      {
+         //Check whether the retransmission timer has expired
+         if(timeCompare(time, observer->retransmitStartTime +
+            observer->retransmitTimeout) >= 0)
+         {
+            //Maximum number of retransmissions not reached?
+            if(observer->retransmitCount < COAP_SERVER_MAX_RETRANSMIT)
+            {
+               //The timeout is doubled after each retransmission
+               observer->retransmitTimeout *= 2;
+               observer->retransmitCount++;
+
+               //The retransmission carries the current state of the resource
+               //(refer to RFC 7641, section 4.5.2)
+               coapServerSendNotification(context, observer);
+            }
+            else
+            {
+               //Debug message
+               TRACE_INFO("CoAP observer is not responding!\r\n");
+
+               //The client is removed from the list of observers
+               observer->resource = NULL;
+            }
+         }
+      }
+      else if(observer->pending)
+      {
+         //Send a notification to the client
+         coapServerSendNotification(context, observer);
+      }
+      else
+      {
+         //No notification to send
+      }
+   }
+}
+
+
+/**
+ * @brief Send a notification to an observer
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] observer Pointer to the observer
+ * @return Error code
+ **/
+
+error_t coapServerSendNotification(CoapServerContext *context,
+   CoapServerObserver *observer)
+{
+   error_t error;
+   uint16_t mid;
+   CoapMessageType type;
+   CoapMessageHeader *header;
+   CoapServerResource *resource;
+
+   //Point to the observed resource
+   resource = observer->resource;
+   //Message ID of the previous notification
+   mid = observer->mid;
+
+   //A notification is sent as a confirmable message at regular intervals
+   //so that the server learns whether the client is still interested
+   if(observer->ackPending ||
+      ++observer->count >= COAP_SERVER_OBSERVE_CON_INTERVAL)
+   {
+      type = COAP_TYPE_CON;
+   }
+   else
+   {
+      type = COAP_TYPE_NON;
+   }
+
+   //The resource handler sees the registration request again
+   header = (CoapMessageHeader *) context->request.buffer;
+   header->version = COAP_VERSION_1;
+   header->type = COAP_TYPE_NON;
+   header->tokenLen = observer->tokenLen;
+   header->code = COAP_CODE_GET;
+   header->mid = 0;
+   memcpy(header->token, observer->token, observer->tokenLen);
+
+   //Length of the request
+   context->request.length = sizeof(CoapMessageHeader) + observer->tokenLen;
+   context->request.pos = 0;
+   coapInvalidateOptionIndex(&context->request);
+
+   //The notification is sent to the observer
+   context->remoteIpAddr = observer->remoteIpAddr;
+   context->remotePort = observer->remotePort;
+   context->requestBody = NULL;
+   context->requestBodyLen = 0;
+
+   //Rebuild the Uri-Path and Observe options
+   error = coapSplitRepeatableOption(&context->request, COAP_OPT_URI_PATH,
+      resource->path, '/');
+
+   //Check status code
+   if(!error)
+   {
+      error = coapSetUintOption(&context->request, COAP_OPT_OBSERVE, 0,
+         COAP_OBSERVE_REGISTER);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Each notification is sent with a new message ID
+      mid = coapServerGenerateMessageId(context);
+
+      //Format notification header
+      error = coapServerFormatResponseHeader(context, &context->notification,
+         type, mid, header);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Retrieve the current state of the resource
+      error = coapServerInvokeHandler(context, resource);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Successful response?
+      if(COAP_GET_CODE_CLASS(context->notification.buffer[1]) ==
+         COAP_CODE_CLASS_SUCCESS)
+      {
+         //Notifications include the sequence number of the current state
+         error = coapSetUintOption(&context->notification, COAP_OPT_OBSERVE,
+            0, resource->observeSeqNum);
+      }
+      else
+      {
+         //A notification with an error response code ends the observation
+         //(refer to RFC 7641, section 4.2)
+         observer->resource = NULL;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Add the representation of the resource
+      error = coapServerFormatPayload(context);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Send the notification
+      error = coapServerSendMessage(context, &observer->remoteIpAddr,
+         observer->remotePort, &context->notification);
+   }
+
+   //The notification has been processed
+   observer->pending = FALSE;
+   observer->mid = mid;
+
+   //Confirmable notification?
+   if(type == COAP_TYPE_CON && observer->resource != NULL)
+   {
+      //First transmission?
+      if(!observer->ackPending)
+      {
+         //The initial timeout is set to a random duration
+         observer->retransmitTimeout = netGetRandRange(
+            COAP_SERVER_ACK_TIMEOUT_MIN, COAP_SERVER_ACK_TIMEOUT_MAX);
+
+         //Reset retransmission counter
+         observer->retransmitCount = 0;
+         observer->ackPending = TRUE;
+      }
+
+      //Save the time at which the notification was sent
+      observer->retransmitStartTime = osGetSystemTime();
+      //Reset the notification counter
+      observer->count = 0;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Search the list of observers
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Observed resource (NULL to search for a free entry)
+ * @return Pointer to the matching observer, if any
+ **/
+
+CoapServerObserver *coapServerFindObserver(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   uint_t i;
+   CoapServerObserver *observer;
+
+   //Loop through the observers
+   for(i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++)
+   {
+      //Point to the current observer
+      observer = &context->observers[i];
+
+      //Free entry requested?
+      if(resource == NULL)
+      {
+         //Check whether the entry is available
+         if(observer->resource == NULL)
+            return observer;
+      }
+      else
+      {
+         //An observation is identified by the client endpoint and the
+         //target resource
+         if(observer->resource == resource &&
+            observer->remotePort == context->remotePort &&
+            ipCompAddr(&observer->remoteIpAddr, &context->remoteIpAddr))
+         {
+            return observer;
+         }
+      }
+   }
+
+   //No matching observer
+   return NULL;
+}
+
+
+/**
+ * @brief Remove all the observers of a resource
+ * @param[in] context Pointer to the CoAP server context
+ * @param[in] resource Observed resource
+ **/
+
+void coapServerDeleteObservers(CoapServerContext *context,
+   CoapServerResource *resource)
+{
+   uint_t i;
+
+   //Loop through the observers
+   for(i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++)
+   {
+      //Matching resource?
+      if(context->observers[i].resource == resource)
+      {
+         //Release the entry
+         context->observers[i].resource = NULL;
+      }
+   }
+}
+
+#endif
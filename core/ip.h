@@ -59,6 +59,7 @@ typedef enum
 typedef enum
 {
    IP_FLAG_DONT_ROUTE = 0x0400,
+   IP_FLAG_DONT_FRAG  = 0x0800,
    IP_FLAG_TTL        = 0x00FF,
    IP_FLAG_HOP_LIMIT  = 0x00FF
 } IpFlags;
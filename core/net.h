@@ -47,6 +47,8 @@ struct _NetInterface;
 #include "ipv4/auto_ip.h"
 #include "ipv6/ipv6.h"
 #include "ipv4/arp.h"
+#include "ipv4/ipv4_pmtu.h"
+#include "ipv4/ipv4_template.h"
 #include "ipv6/ndp.h"
 #include "ipv6/ndp_router_adv.h"
 #include "ipv6/slaac.h"
@@ -228,6 +230,9 @@ struct _NetInterface
 #if (IPV4_SUPPORT == ENABLED)
    Ipv4Context ipv4Context;                       ///<IPv4 context
    ArpCacheEntry arpCache[ARP_CACHE_SIZE];        ///<ARP cache
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+   Ipv4PmtuCacheEntry ipv4PmtuCache[IPV4_PMTU_CACHE_SIZE]; ///<PMTU cache
+#endif
 #if (IGMP_SUPPORT == ENABLED)
    systime_t igmpv1RouterPresentTimer;            ///<IGMPv1 router present timer
    bool_t igmpv1RouterPresent;                    ///<An IGMPv1 query has been recently heard
@@ -63,6 +63,13 @@
 //Helper macro for defining a buffer
 #define N(size) (((size) + NET_MEM_POOL_BUFFER_SIZE - 1) / NET_MEM_POOL_BUFFER_SIZE)
 
+//Amount of memory actually consumed by a call to memPoolAlloc
+#if (NET_MEM_POOL_SUPPORT == ENABLED)
+   #define NET_MEM_ALLOC_SIZE(size) NET_MEM_POOL_BUFFER_SIZE
+#else
+   #define NET_MEM_ALLOC_SIZE(size) (size)
+#endif
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
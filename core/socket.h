@@ -227,6 +227,9 @@ struct _Socket
    uint_t eventMask;
    uint_t eventFlags;
    OsEvent *userEvent;
+#if (IPV4_SUPPORT == ENABLED && IPV4_TEMPLATE_SUPPORT == ENABLED)
+   Ipv4HeaderTemplate ipv4Template; ///<Pre-formatted IPv4 header and resolved next hop
+#endif
 
 //TCP specific variables
 #if (TCP_SUPPORT == ENABLED)
@@ -237,6 +240,7 @@ struct _Socket
 
    uint16_t smss;                 ///<Sender maximum segment size
    uint16_t rmss;                 ///<Receiver maximum segment size
+   uint16_t peerMss;              ///<MSS advertised by the remote host
    uint32_t iss;                  ///<Initial send sequence number
    uint32_t irs;                  ///<Initial receive sequence number
 
@@ -288,6 +292,15 @@ struct _Socket
    TcpTimer finWait2Timer;        ///<FIN-WAIT-2 timer
    TcpTimer timeWaitTimer;        ///<2MSL timer
 
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+   uint16_t searchLow;            ///<Smallest segment size of the PLPMTUD search range
+   uint16_t searchHigh;           ///<Largest segment size of the PLPMTUD search range
+   uint16_t probeSize;            ///<Size of the outstanding probe, if any
+   uint32_t probeSeqNum;          ///<Sequence number of the outstanding probe
+   uint_t probeCount;             ///<Number of lost probes of the current size
+   systime_t probeTimestamp;      ///<Time at which the PLPMTUD search was started
+#endif
+
    bool_t sackPermitted;                        ///<SACK Permitted option received
    TcpSackBlock sackBlock[TCP_MAX_SACK_BLOCKS]; ///<List of non-contiguous blocks that have been received
    uint_t sackBlockCount;                       ///<Number of non-contiguous blocks that have been received
@@ -357,8 +357,8 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
             newSocket->remotePort = queueItem->srcPort;
 
             //The SMSS is the size of the largest segment that the sender
-            //can transmit
-            newSocket->smss = queueItem->mss;
+            //can transmit (this value must not exceed the PMTU of the path)
+            tcpInitMss(newSocket, queueItem->mss);
 
             //The RMSS is the size of the largest segment the receiver is
             //willing to accept
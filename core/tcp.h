@@ -210,6 +210,48 @@
    #error TCP_MAX_SACK_BLOCKS parameter is not valid
 #endif
 
+//Packetization layer path MTU discovery (RFC 4821)
+#ifndef TCP_PLPMTUD_SUPPORT
+   #define TCP_PLPMTUD_SUPPORT DISABLED
+#elif (TCP_PLPMTUD_SUPPORT != ENABLED && TCP_PLPMTUD_SUPPORT != DISABLED)
+   #error TCP_PLPMTUD_SUPPORT parameter is not valid
+#endif
+
+//Segment size used when a PMTU black hole is detected
+#ifndef TCP_PLPMTUD_BASE_MSS
+   #define TCP_PLPMTUD_BASE_MSS 536
+#elif (TCP_PLPMTUD_BASE_MSS < TCP_MIN_MSS)
+   #error TCP_PLPMTUD_BASE_MSS parameter is not valid
+#endif
+
+//Number of retransmission timeouts before a PMTU black hole is assumed
+#ifndef TCP_PLPMTUD_BLACK_HOLE_THRES
+   #define TCP_PLPMTUD_BLACK_HOLE_THRES 2
+#elif (TCP_PLPMTUD_BLACK_HOLE_THRES < 1)
+   #error TCP_PLPMTUD_BLACK_HOLE_THRES parameter is not valid
+#endif
+
+//Number of lost probes of a given size before the size is deemed too large
+#ifndef TCP_PLPMTUD_MAX_PROBES
+   #define TCP_PLPMTUD_MAX_PROBES 3
+#elif (TCP_PLPMTUD_MAX_PROBES < 1)
+   #error TCP_PLPMTUD_MAX_PROBES parameter is not valid
+#endif
+
+//The search is stopped when the search range is smaller than this value
+#ifndef TCP_PLPMTUD_SEARCH_THRES
+   #define TCP_PLPMTUD_SEARCH_THRES 32
+#elif (TCP_PLPMTUD_SEARCH_THRES < 1)
+   #error TCP_PLPMTUD_SEARCH_THRES parameter is not valid
+#endif
+
+//Time interval after which a completed search is restarted
+#ifndef TCP_PLPMTUD_PROBE_INTERVAL
+   #define TCP_PLPMTUD_PROBE_INTERVAL 600000
+#elif (TCP_PLPMTUD_PROBE_INTERVAL < 60000)
+   #error TCP_PLPMTUD_PROBE_INTERVAL parameter is not valid
+#endif
+
 //Maximum TCP header length
 #define TCP_MAX_HEADER_LENGTH 60
 //Default maximum segment size
@@ -641,6 +641,9 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
          socket->smss = MAX(socket->smss, TCP_MIN_MSS);
       }
 
+      //The SMSS must not exceed the PMTU of the path
+      tcpInitMss(socket, socket->smss);
+
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
       //Initial congestion window
       socket->cwnd = MIN(TCP_INITIAL_WINDOW * socket->smss, socket->txBufferSize);
@@ -41,7 +41,10 @@
 #include "core/tcp_timer.h"
 #include "core/ip.h"
 #include "ipv4/ipv4.h"
+#include "ipv4/ipv4_pmtu.h"
 #include "ipv6/ipv6.h"
+#include "ipv6/ipv6_pmtu.h"
+#include "ipv6/ndp_cache.h"
 #include "mibs/mib2_module.h"
 #include "mibs/tcp_mib_module.h"
 #include "date_time.h"
@@ -66,6 +69,7 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    uint32_t ackNum, size_t length, bool_t addToQueue)
 {
    error_t error;
+   uint_t ipFlags;
    size_t offset;
    size_t totalLength;
    NetBuffer *buffer;
@@ -263,8 +267,29 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    //Dump TCP header contents for debugging purpose
    tcpDumpHeader(segment, length, socket->iss, socket->irs);
 
-   //Send TCP segment
-   error = ipSendDatagram(socket->interface, &pseudoHeader, buffer, offset, 0);
+#if (IPV4_PMTU_SUPPORT == ENABLED || TCP_PLPMTUD_SUPPORT == ENABLED)
+   //Set the DF bit so that the PMTU of the path can be discovered
+   ipFlags = IP_FLAG_DONT_FRAG;
+#else
+   //Fragmentation is allowed
+   ipFlags = 0;
+#endif
+
+#if (IPV4_SUPPORT == ENABLED && IPV4_TEMPLATE_SUPPORT == ENABLED)
+   //IPv4 connection?
+   if(pseudoHeader.length == sizeof(Ipv4PseudoHeader))
+   {
+      //Send TCP segment using the header template of the socket
+      error = ipv4SendTemplateDatagram(&socket->ipv4Template,
+         socket->interface, &pseudoHeader.ipv4Data, buffer, offset, ipFlags);
+   }
+   else
+#endif
+   {
+      //Send TCP segment
+      error = ipSendDatagram(socket->interface, &pseudoHeader, buffer, offset,
+         ipFlags);
+   }
 
    //Free previously allocated memory
    netBufferFree(buffer);
@@ -684,6 +709,22 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       //entirely acknowledged are removed
       tcpUpdateRetransmitQueue(socket);
 
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+      //Check whether the outstanding probe has been acknowledged
+      tcpProcessProbeAck(socket);
+#endif
+
+#if (IPV6_SUPPORT == ENABLED && NDP_SUPPORT == ENABLED)
+      //IPv6 connection?
+      if(socket->remoteIpAddr.length == sizeof(Ipv6Addr))
+      {
+         //The acknowledgment of new data is a positive confirmation that the
+         //next-hop neighbor is reachable (refer to RFC 4861, section 7.3.1)
+         ndpConfirmReachability(socket->interface,
+            &socket->remoteIpAddr.ipv6Addr);
+      }
+#endif
+
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
       //Check congestion state
       if(socket->congestState == TCP_CONGEST_STATE_RECOVERY)
@@ -1493,6 +1534,7 @@ bool_t tcpComputeRto(Socket *socket)
 error_t tcpRetransmitSegment(Socket *socket)
 {
    error_t error;
+   uint_t flags;
    size_t offset;
    size_t length;
    NetBuffer *buffer;
@@ -1513,8 +1555,10 @@ error_t tcpRetransmitSegment(Socket *socket)
       //Total number of bytes that have been retransmitted
       length += queueItem->length;
 
-      //The amount of data that can be sent cannot exceed the MSS
-      if(length > socket->smss)
+      //The amount of data that can be sent cannot exceed the MSS. Note that
+      //the first segment is always retransmitted, even if the SMSS has been
+      //reduced since it was originally sent
+      if(length > socket->smss && queueItem != socket->retransmitQueue)
       {
          //We are done
          error = NO_ERROR;
@@ -1525,6 +1569,24 @@ error_t tcpRetransmitSegment(Socket *socket)
       //Point to the TCP header
       header = (TcpHeader *) queueItem->header;
 
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+      //Retransmission of the probe?
+      if(socket->probeSize > 0 && ntohl(header->seqNum) == socket->probeSeqNum)
+      {
+         //The probe is assumed to have been lost
+         tcpProcessProbeLoss(socket);
+      }
+#endif
+
+#if (IPV4_PMTU_SUPPORT == ENABLED || TCP_PLPMTUD_SUPPORT == ENABLED)
+      //Segments that are larger than the current SMSS may be fragmented by
+      //the routers along the path
+      flags = (queueItem->length <= socket->smss) ? IP_FLAG_DONT_FRAG : 0;
+#else
+      //Default behavior
+      flags = 0;
+#endif
+
       //Allocate a memory buffer to hold the TCP segment
       buffer = ipAllocBuffer(0, &offset);
       //Failed to allocate memory?
@@ -1562,7 +1624,7 @@ error_t tcpRetransmitSegment(Socket *socket)
          //Retransmit the lost segment without waiting for the retransmission
          //timer to expire
          error = ipSendDatagram(socket->interface, &queueItem->pseudoHeader,
-            buffer, offset, 0);
+            buffer, offset, flags);
 
          //End of exception handling block
       } while(0);
@@ -1586,6 +1648,399 @@ error_t tcpRetransmitSegment(Socket *socket)
 }
 
 
+/**
+ * @brief Initialize the SMSS once the MSS of the remote host is known
+ * @param[in] socket Handle referencing the socket
+ * @param[in] mss MSS advertised by the remote host
+ **/
+
+void tcpInitMss(Socket *socket, uint16_t mss)
+{
+   //Save the MSS advertised by the remote host
+   socket->peerMss = mss;
+   //The SMSS is the size of the largest segment that the sender can transmit
+   socket->smss = mss;
+
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+   //Initialize PLPMTUD state
+   socket->searchLow = TCP_PLPMTUD_BASE_MSS;
+   socket->searchHigh = mss;
+   socket->probeSize = 0;
+   socket->probeCount = 0;
+   socket->probeTimestamp = osGetSystemTime();
+#endif
+
+#if (IPV4_PMTU_SUPPORT == ENABLED || TCP_PLPMTUD_SUPPORT == ENABLED)
+   //The SMSS must not exceed the PMTU of the path
+   tcpUpdateMss(socket);
+#endif
+}
+
+
+/**
+ * @brief Update the SMSS according to the PMTU of the path
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpUpdateMss(Socket *socket)
+{
+   uint_t mss;
+
+   //Largest segment size allowed by both the remote host and the path
+   mss = tcpGetPathMss(socket);
+
+   //Check whether the SMSS should be reduced
+   if(socket->smss > mss)
+   {
+      //Debug message
+      TRACE_INFO("TCP SMSS reduced to %u bytes\r\n", mss);
+      //Save the new SMSS value
+      socket->smss = mss;
+   }
+#if (TCP_PLPMTUD_SUPPORT == DISABLED)
+   else if(socket->smss < mss)
+   {
+      //The PMTU estimate has increased (for instance, a reduced estimate
+      //has aged out of the PMTU cache)
+      TRACE_INFO("TCP SMSS increased to %u bytes\r\n", mss);
+      //Save the new SMSS value
+      socket->smss = mss;
+   }
+#endif
+
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+   //The upper bound of the search range cannot exceed the PMTU estimate. A
+   //larger SMSS is only used once a probe of that size has been acknowledged
+   socket->searchHigh = MIN(socket->searchHigh, mss);
+   socket->searchLow = MIN(socket->searchLow, mss);
+
+   //Cancel the outstanding probe if it is too large
+   if(socket->probeSize > mss)
+      socket->probeSize = 0;
+#endif
+}
+
+
+/**
+ * @brief Get the largest segment size allowed by the path
+ * @param[in] socket Handle referencing the socket
+ * @return Maximum segment size
+ **/
+
+uint_t tcpGetPathMss(Socket *socket)
+{
+   uint_t mss;
+   size_t pathMtu;
+
+   //The segment size is limited by the MSS advertised by the remote host
+   mss = socket->peerMss;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 connection?
+   if(socket->remoteIpAddr.length == sizeof(Ipv4Addr))
+   {
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+      //Retrieve the PMTU for the specified destination address
+      pathMtu = ipv4GetPathMtu(socket->interface,
+         socket->remoteIpAddr.ipv4Addr);
+#else
+      //The PMTU value for the path is assumed to be the MTU of the first-hop
+      //link
+      pathMtu = socket->interface->ipv4Context.linkMtu;
+#endif
+      //Take into account the size of the IPv4 and TCP headers
+      mss = MIN(mss, pathMtu - sizeof(Ipv4Header) - sizeof(TcpHeader));
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 connection?
+   if(socket->remoteIpAddr.length == sizeof(Ipv6Addr))
+   {
+#if (IPV6_PMTU_SUPPORT == ENABLED)
+      //Retrieve the PMTU for the specified destination address
+      pathMtu = ipv6GetPathMtu(socket->interface,
+         &socket->remoteIpAddr.ipv6Addr);
+      //The PMTU should not exceed the MTU of the first-hop link
+      pathMtu = MIN(pathMtu, socket->interface->ipv6Context.linkMtu);
+#else
+      //The PMTU value for the path is assumed to be the MTU of the first-hop
+      //link
+      pathMtu = socket->interface->ipv6Context.linkMtu;
+#endif
+      //Take into account the size of the IPv6 and TCP headers
+      mss = MIN(mss, pathMtu - sizeof(Ipv6Header) - sizeof(TcpHeader));
+   }
+   else
+#endif
+   //Invalid address?
+   {
+      //Use the MSS advertised by the remote host
+   }
+
+   //Make sure that the resulting MSS is acceptable
+   return MAX(mss, TCP_MIN_MSS);
+}
+
+
+/**
+ * @brief Process a change of the PMTU for a given destination
+ * @param[in] interface Underlying network interface
+ * @param[in] remoteIpAddr IP address of the remote host
+ **/
+
+void tcpProcessPathMtuChange(NetInterface *interface,
+   const IpAddr *remoteIpAddr)
+{
+   uint_t i;
+   Socket *socket;
+
+   //Loop through opened sockets
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      //Point to the current socket
+      socket = &socketTable[i];
+
+      //TCP socket?
+      if(socket->type != SOCKET_TYPE_STREAM)
+         continue;
+
+      //Check the current state of the TCP state machine
+      if(socket->state == TCP_STATE_CLOSED ||
+         socket->state == TCP_STATE_LISTEN ||
+         socket->state == TCP_STATE_SYN_SENT)
+      {
+         continue;
+      }
+
+      //Check whether the connection uses the specified path
+      if(socket->interface == interface &&
+         ipCompAddr(&socket->remoteIpAddr, remoteIpAddr))
+      {
+         //Adjust the SMSS according to the new PMTU estimate
+         tcpUpdateMss(socket);
+      }
+   }
+}
+
+
+/**
+ * @brief Check whether an ICMP error message refers to a live connection
+ *
+ * The TCP header quoted in the ICMP payload must match an existing
+ * connection and its sequence number must lie within the range of data
+ * that has been sent but not yet acknowledged (refer to RFC 5927,
+ * section 4.1)
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] localIpAddr Source address of the original datagram
+ * @param[in] remoteIpAddr Destination address of the original datagram
+ * @param[in] segment TCP header quoted in the ICMP payload (only the first
+ *   8 bytes are used)
+ * @return TRUE if the ICMP error message is acceptable, else FALSE
+ **/
+
+bool_t tcpCheckIcmpError(NetInterface *interface, const IpAddr *localIpAddr,
+   const IpAddr *remoteIpAddr, const TcpHeader *segment)
+{
+   uint_t i;
+   uint32_t seqNum;
+   Socket *socket;
+
+   //Sequence number of the original segment
+   seqNum = ntohl(segment->seqNum);
+
+   //Loop through opened sockets
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      //Point to the current socket
+      socket = &socketTable[i];
+
+      //TCP socket?
+      if(socket->type != SOCKET_TYPE_STREAM)
+         continue;
+
+      //Check the current state of the TCP state machine
+      if(socket->state == TCP_STATE_CLOSED ||
+         socket->state == TCP_STATE_LISTEN)
+      {
+         continue;
+      }
+
+      //Check whether the original segment belongs to this connection
+      if(socket->interface != interface)
+         continue;
+      if(socket->localPort != ntohs(segment->srcPort))
+         continue;
+      if(socket->remotePort != ntohs(segment->destPort))
+         continue;
+      if(!ipCompAddr(&socket->remoteIpAddr, remoteIpAddr))
+         continue;
+      if(socket->localIpAddr.length != 0 &&
+         !ipCompAddr(&socket->localIpAddr, localIpAddr))
+      {
+         continue;
+      }
+
+      //The ICMP message is only accepted if SND.UNA <= SEQ < SND.NXT
+      return (TCP_CMP_SEQ(seqNum, socket->sndUna) >= 0 &&
+         TCP_CMP_SEQ(seqNum, socket->sndNxt) < 0);
+   }
+
+   //The ICMP message does not refer to any connection
+   return FALSE;
+}
+
+
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+
+/**
+ * @brief Determine the size of the next probe (PLPMTUD)
+ * @param[in] socket Handle referencing the socket
+ * @return Size of the probe, or zero if no probe should be sent
+ **/
+
+uint_t tcpGetProbeSize(Socket *socket)
+{
+   systime_t time;
+
+   //Probing is only performed on established connections
+   if(socket->state != TCP_STATE_ESTABLISHED &&
+      socket->state != TCP_STATE_CLOSE_WAIT)
+   {
+      return 0;
+   }
+
+   //Only one probe may be outstanding at any time
+   if(socket->probeSize > 0)
+      return 0;
+
+#if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   //Do not probe while recovering from losses
+   if(socket->congestState != TCP_CONGEST_STATE_IDLE)
+      return 0;
+#endif
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Search completed?
+   if((socket->searchHigh - socket->smss) < TCP_PLPMTUD_SEARCH_THRES)
+   {
+      //Periodically restart the search in order to detect an increase in
+      //the PMTU (refer to RFC 4821, section 7.7)
+      if(timeCompare(time, socket->probeTimestamp +
+         TCP_PLPMTUD_PROBE_INTERVAL) < 0)
+      {
+         return 0;
+      }
+
+      //Restart the search from the current PMTU estimate
+      socket->searchHigh = socket->peerMss;
+      socket->probeCount = 0;
+      socket->probeTimestamp = time;
+
+      //The upper bound of the search range is limited by the PMTU estimate
+      tcpUpdateMss(socket);
+
+      //Nothing to probe?
+      if((socket->searchHigh - socket->smss) < TCP_PLPMTUD_SEARCH_THRES)
+         return 0;
+   }
+
+   //The probe size is selected using a binary search between the current
+   //SMSS and the upper bound of the search range
+   return (socket->smss + socket->searchHigh + 1) / 2;
+}
+
+
+/**
+ * @brief Check whether the outstanding probe has been acknowledged (PLPMTUD)
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpProcessProbeAck(Socket *socket)
+{
+   //Any outstanding probe?
+   if(socket->probeSize > 0)
+   {
+      //The probe is acknowledged without being retransmitted?
+      if(TCP_CMP_SEQ(socket->sndUna, socket->probeSeqNum +
+         socket->probeSize) >= 0)
+      {
+         //Debug message
+         TRACE_INFO("TCP PLPMTUD probe acknowledged (%u bytes)\r\n",
+            socket->probeSize);
+
+         //The path is able to carry segments of the probed size
+         socket->searchLow = socket->probeSize;
+         socket->smss = socket->probeSize;
+
+         //The probe is no longer outstanding
+         socket->probeSize = 0;
+         socket->probeCount = 0;
+         socket->probeTimestamp = osGetSystemTime();
+      }
+   }
+}
+
+
+/**
+ * @brief Process the loss of the outstanding probe (PLPMTUD)
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpProcessProbeLoss(Socket *socket)
+{
+   //Debug message
+   TRACE_INFO("TCP PLPMTUD probe lost (%u bytes)\r\n", socket->probeSize);
+
+   //Increment the number of consecutive lost probes
+   socket->probeCount++;
+
+   //A single loss may be caused by congestion. The probed size is deemed
+   //too large when several consecutive probes of that size are lost
+   if(socket->probeCount >= TCP_PLPMTUD_MAX_PROBES)
+   {
+      //Reduce the upper bound of the search range
+      socket->searchHigh = socket->probeSize - 1;
+      socket->probeCount = 0;
+      socket->probeTimestamp = osGetSystemTime();
+   }
+
+   //The probe is no longer outstanding
+   socket->probeSize = 0;
+}
+
+
+/**
+ * @brief Detect PMTU black holes (PLPMTUD)
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpDetectBlackHole(Socket *socket)
+{
+   //Repeated retransmission timeouts of a full-sized segment indicate that
+   //the path may silently drop large packets (refer to RFC 4821, section 7.8)
+   if((socket->retransmitCount + 1) >= TCP_PLPMTUD_BLACK_HOLE_THRES &&
+      socket->smss > socket->searchLow &&
+      socket->retransmitQueue->length > socket->searchLow)
+   {
+      //Debug message
+      TRACE_WARNING("TCP PMTU black hole detected!\r\n");
+
+      //Fall back to the lower bound of the search range. The search will
+      //then be performed again using probes
+      socket->smss = socket->searchLow;
+      socket->probeSize = 0;
+      socket->probeCount = 0;
+      socket->probeTimestamp = osGetSystemTime();
+   }
+}
+
+#endif
+
+
 /**
  * @brief Nagle algorithm implementation
  * @param[in] socket Handle referencing the socket
@@ -1598,6 +2053,9 @@ error_t tcpNagleAlgo(Socket *socket, uint_t flags)
    error_t error;
    uint_t n;
    uint_t u;
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+   uint_t m;
+#endif
 
    //The amount of data that can be sent at any given time is
    //limited by the receiver window and the congestion window
@@ -1624,6 +2082,18 @@ error_t tcpNagleAlgo(Socket *socket, uint_t flags)
       n = MIN(u, socket->sndUser);
       n = MIN(n, socket->smss);
 
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+      //Check whether a probe should be sent
+      m = tcpGetProbeSize(socket);
+
+      //A probe is sent only when enough data is available to fill it (refer
+      //to RFC 4821, section 7.4)
+      if(m > 0 && MIN(u, socket->sndUser) >= m)
+         n = m;
+      else
+         m = 0;
+#endif
+
       //Disable Nagle algorithm?
       if(flags & SOCKET_FLAG_NO_DELAY)
       {
@@ -1700,6 +2170,16 @@ error_t tcpNagleAlgo(Socket *socket, uint_t flags)
          }
       }
 
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+      //Probe successfully sent?
+      if(m > 0)
+      {
+         //Keep track of the outstanding probe
+         socket->probeSeqNum = socket->sndNxt;
+         socket->probeSize = m;
+      }
+#endif
+
       //Advance SND.NXT pointer
       socket->sndNxt += n;
       //Update the number of data buffered but not yet sent
@@ -80,6 +80,22 @@ void tcpUpdateReceiveWindow(Socket *socket);
 
 bool_t tcpComputeRto(Socket *socket);
 error_t tcpRetransmitSegment(Socket *socket);
+
+void tcpInitMss(Socket *socket, uint16_t mss);
+void tcpUpdateMss(Socket *socket);
+uint_t tcpGetPathMss(Socket *socket);
+
+void tcpProcessPathMtuChange(NetInterface *interface,
+   const IpAddr *remoteIpAddr);
+
+bool_t tcpCheckIcmpError(NetInterface *interface, const IpAddr *localIpAddr,
+   const IpAddr *remoteIpAddr, const TcpHeader *segment);
+
+uint_t tcpGetProbeSize(Socket *socket);
+void tcpProcessProbeAck(Socket *socket);
+void tcpProcessProbeLoss(Socket *socket);
+void tcpDetectBlackHole(Socket *socket);
+
 error_t tcpNagleAlgo(Socket *socket, uint_t flags);
 
 void tcpChangeState(Socket *socket, TcpState newState);
@@ -38,6 +38,7 @@
 #include "core/tcp_misc.h"
 #include "core/tcp_timer.h"
 #include "ipv4/ipv4.h"
+#include "ipv4/ipv4_pmtu.h"
 #include "ipv6/ipv6.h"
 #include "date_time.h"
 #include "debug.h"
@@ -111,6 +112,10 @@ void tcpTick(void)
                   formatSystemTime(osGetSystemTime(), NULL), socket->retransmitCount + 1,
                   socket->retransmitQueue->length);
 
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+               //Repeated timeouts may indicate a PMTU black hole
+               tcpDetectBlackHole(socket);
+#endif
                //Retransmit the earliest segment that has not been
                //acknowledged by the TCP receiver
                tcpRetransmitSegment(socket);
@@ -171,6 +176,16 @@ void tcpTick(void)
          }
       }
 
+#if (IPV4_PMTU_SUPPORT == ENABLED && TCP_PLPMTUD_SUPPORT == DISABLED)
+      //A reduced PMTU estimate eventually ages out of the cache, in which
+      //case the SMSS may grow again
+      if(socket->state >= TCP_STATE_ESTABLISHED &&
+         socket->state <= TCP_STATE_TIME_WAIT && socket->interface != NULL)
+      {
+         tcpUpdateMss(socket);
+      }
+#endif
+
       //To avoid a deadlock, it is necessary to have a timeout to force
       //transmission of data, overriding the SWS avoidance algorithm. In
       //practice, this timeout should seldom occur (refer to RFC 1122,
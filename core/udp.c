@@ -427,9 +427,22 @@ error_t udpSendDatagram(Socket *socket, const IpAddr *destIpAddr,
    //Successful processing?
    if(!error)
    {
-      //Send UDP datagram
-      error = udpSendDatagramEx(socket->interface, NULL, socket->localPort,
-         destIpAddr, destPort, buffer, offset, flags);
+#if (IPV4_SUPPORT == ENABLED && IPV4_TEMPLATE_SUPPORT == ENABLED)
+      //Connected socket sending to its remote IPv4 address?
+      if(destIpAddr->length == sizeof(Ipv4Addr) &&
+         ipCompAddr(destIpAddr, &socket->remoteIpAddr) &&
+         destPort == socket->remotePort)
+      {
+         //Send UDP datagram using the header template of the socket
+         error = udpSendTemplateDatagram(socket, buffer, offset, flags);
+      }
+      else
+#endif
+      {
+         //Send UDP datagram
+         error = udpSendDatagramEx(socket->interface, NULL, socket->localPort,
+            destIpAddr, destPort, buffer, offset, flags);
+      }
    }
 
    //Successful processing?
@@ -465,12 +478,51 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
    NetBuffer *buffer, size_t offset, uint_t flags)
 {
    error_t error;
-   size_t length;
-   UdpHeader *header;
    IpPseudoHeader pseudoHeader;
 
    //Make room for the UDP header
    offset -= sizeof(UdpHeader);
+
+   //Format the UDP header and select the source address
+   error = udpFormatDatagram(&interface, srcIpAddr, srcPort, destIpAddr,
+      destPort, buffer, offset, &pseudoHeader);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Send UDP datagram
+   error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, flags);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Format a UDP datagram
+ *
+ * The source address and the relevant network interface are selected
+ * when no source address is specified. The pseudo header is formatted
+ * and the UDP checksum is calculated
+ *
+ * @param[in,out] interface Underlying network interface
+ * @param[in] srcIpAddr Source IP address (optional parameter)
+ * @param[in] srcPort Source port
+ * @param[in] destIpAddr IP address of the target host
+ * @param[in] destPort Target port number
+ * @param[in] buffer Multi-part buffer containing the datagram
+ * @param[in] offset Offset to the UDP header
+ * @param[out] pseudoHeader UDP pseudo header
+ * @return Error code
+ **/
+
+error_t udpFormatDatagram(NetInterface **interface, const IpAddr *srcIpAddr,
+   uint16_t srcPort, const IpAddr *destIpAddr, uint16_t destPort,
+   NetBuffer *buffer, size_t offset, IpPseudoHeader *pseudoHeader)
+{
+   error_t error;
+   size_t length;
+   UdpHeader *header;
+
    //Retrieve the length of the datagram
    length = netBufferGetLength(buffer) - offset;
 
@@ -494,7 +546,7 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
       if(srcIpAddr != NULL && srcIpAddr->length == sizeof(Ipv4Addr))
       {
          //Copy the source IP address
-         pseudoHeader.ipv4Data.srcAddr = srcIpAddr->ipv4Addr;
+         pseudoHeader->ipv4Data.srcAddr = srcIpAddr->ipv4Addr;
       }
       else
       {
@@ -502,23 +554,23 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
 
          //Select the source IPv4 address and the relevant network interface
          //to use when sending data to the specified destination host
-         error = ipv4SelectSourceAddr(&interface, destIpAddr->ipv4Addr,
+         error = ipv4SelectSourceAddr(interface, destIpAddr->ipv4Addr,
             &ipAddr);
 
          //Check status code
          if(!error)
          {
             //Copy the resulting source IP address
-            pseudoHeader.ipv4Data.srcAddr = ipAddr;
+            pseudoHeader->ipv4Data.srcAddr = ipAddr;
          }
          else
          {
             //Handle the special case where the destination address is the
             //broadcast address
-            if(destIpAddr->ipv4Addr == IPV4_BROADCAST_ADDR && interface != NULL)
+            if(destIpAddr->ipv4Addr == IPV4_BROADCAST_ADDR && *interface != NULL)
             {
                //Use the unspecified address as source address
-               pseudoHeader.ipv4Data.srcAddr = IPV4_UNSPECIFIED_ADDR;
+               pseudoHeader->ipv4Data.srcAddr = IPV4_UNSPECIFIED_ADDR;
             }
             else
             {
@@ -529,14 +581,14 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
       }
 
       //Format IPv4 pseudo header
-      pseudoHeader.length = sizeof(Ipv4PseudoHeader);
-      pseudoHeader.ipv4Data.destAddr = destIpAddr->ipv4Addr;
-      pseudoHeader.ipv4Data.reserved = 0;
-      pseudoHeader.ipv4Data.protocol = IPV4_PROTOCOL_UDP;
-      pseudoHeader.ipv4Data.length = htons(length);
+      pseudoHeader->length = sizeof(Ipv4PseudoHeader);
+      pseudoHeader->ipv4Data.destAddr = destIpAddr->ipv4Addr;
+      pseudoHeader->ipv4Data.reserved = 0;
+      pseudoHeader->ipv4Data.protocol = IPV4_PROTOCOL_UDP;
+      pseudoHeader->ipv4Data.length = htons(length);
 
       //Calculate UDP header checksum
-      header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
+      header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader->ipv4Data,
          sizeof(Ipv4PseudoHeader), buffer, offset, length);
    }
    else
@@ -549,28 +601,28 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
       if(srcIpAddr != NULL && srcIpAddr->length == sizeof(Ipv6Addr))
       {
          //Copy the source IP address
-         pseudoHeader.ipv6Data.srcAddr = srcIpAddr->ipv6Addr;
+         pseudoHeader->ipv6Data.srcAddr = srcIpAddr->ipv6Addr;
       }
       else
       {
          //Select the source IPv6 address and the relevant network interface
          //to use when sending data to the specified destination host
-         error = ipv6SelectSourceAddr(&interface, &destIpAddr->ipv6Addr,
-            &pseudoHeader.ipv6Data.srcAddr);
+         error = ipv6SelectSourceAddr(interface, &destIpAddr->ipv6Addr,
+            &pseudoHeader->ipv6Data.srcAddr);
          //Any error to report?
          if(error)
             return error;
       }
 
       //Format IPv6 pseudo header
-      pseudoHeader.length = sizeof(Ipv6PseudoHeader);
-      pseudoHeader.ipv6Data.destAddr = destIpAddr->ipv6Addr;
-      pseudoHeader.ipv6Data.length = htonl(length);
-      pseudoHeader.ipv6Data.reserved = 0;
-      pseudoHeader.ipv6Data.nextHeader = IPV6_UDP_HEADER;
+      pseudoHeader->length = sizeof(Ipv6PseudoHeader);
+      pseudoHeader->ipv6Data.destAddr = destIpAddr->ipv6Addr;
+      pseudoHeader->ipv6Data.length = htonl(length);
+      pseudoHeader->ipv6Data.reserved = 0;
+      pseudoHeader->ipv6Data.nextHeader = IPV6_UDP_HEADER;
 
       //Calculate UDP header checksum
-      header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv6Data,
+      header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader->ipv6Data,
          sizeof(Ipv6PseudoHeader), buffer, offset, length);
    }
    else
@@ -599,12 +651,75 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
    //Dump UDP header contents for debugging purpose
    udpDumpHeader(header);
 
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+#if (IPV4_SUPPORT == ENABLED && IPV4_TEMPLATE_SUPPORT == ENABLED)
+
+/**
+ * @brief Send a UDP datagram to the remote host of a connected socket
+ *
+ * The source address and the next hop are taken from the IPv4 header
+ * template of the socket, as long as the template is up to date
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] buffer Multi-part buffer containing the payload
+ * @param[in] offset Offset to the first payload byte
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t udpSendTemplateDatagram(Socket *socket, NetBuffer *buffer,
+   size_t offset, uint_t flags)
+{
+   error_t error;
+   IpAddr srcIpAddr;
+   NetInterface *interface;
+   Ipv4HeaderTemplate *hdrTemplate;
+   IpPseudoHeader pseudoHeader;
+
+   //Point to the header template of the socket
+   hdrTemplate = &socket->ipv4Template;
+   //Underlying network interface
+   interface = socket->interface;
+
+   //Reuse the source address of the template as long as the configuration
+   //of the interface has not changed since the template was built
+   if(hdrTemplate->valid && hdrTemplate->interface == interface &&
+      hdrTemplate->generation == interface->ipv4Context.templateGeneration &&
+      hdrTemplate->header.destAddr == socket->remoteIpAddr.ipv4Addr &&
+      !ipv4CheckSourceAddr(interface, hdrTemplate->header.srcAddr))
+   {
+      srcIpAddr.length = sizeof(Ipv4Addr);
+      srcIpAddr.ipv4Addr = hdrTemplate->header.srcAddr;
+   }
+   else
+   {
+      //The source address is selected as for any other datagram
+      srcIpAddr.length = 0;
+   }
+
+   //Make room for the UDP header
+   offset -= sizeof(UdpHeader);
+
+   //Format the UDP header and select the source address, if necessary
+   error = udpFormatDatagram(&interface, &srcIpAddr, socket->localPort,
+      &socket->remoteIpAddr, socket->remotePort, buffer, offset,
+      &pseudoHeader);
+   //Any error to report?
+   if(error)
+      return error;
+
    //Send UDP datagram
-   error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, flags);
+   error = ipv4SendTemplateDatagram(hdrTemplate, interface,
+      &pseudoHeader.ipv4Data, buffer, offset, flags);
    //Return status code
    return error;
 }
 
+#endif
 
 /**
  * @brief Receive data from a UDP socket
@@ -129,9 +129,16 @@ error_t udpSendDatagramEx(NetInterface *interface, const IpAddr *srcIpAddr,
    uint16_t srcPort, const IpAddr *destIpAddr, uint16_t destPort,
    NetBuffer *buffer, size_t offset, uint_t flags);
 
+error_t udpFormatDatagram(NetInterface **interface, const IpAddr *srcIpAddr,
+   uint16_t srcPort, const IpAddr *destIpAddr, uint16_t destPort,
+   NetBuffer *buffer, size_t offset, IpPseudoHeader *pseudoHeader);
+
 error_t udpReceiveDatagram(Socket *socket, IpAddr *srcIpAddr, uint16_t *srcPort,
    IpAddr *destIpAddr, void *data, size_t size, size_t *received, uint_t flags);
 
+error_t udpSendTemplateDatagram(Socket *socket, NetBuffer *buffer,
+   size_t offset, uint_t flags);
+
 NetBuffer *udpAllocBuffer(size_t length, size_t *offset);
 
 void udpUpdateEvents(Socket *socket);
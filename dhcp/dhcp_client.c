@@ -1632,6 +1632,11 @@ void dhcpClientParseAck(DhcpClientContext *context,
       }
    }
 
+#if (IPV4_TEMPLATE_SUPPORT == ENABLED)
+   //The subnet mask or the default gateway may have changed
+   ipv4InvalidateTemplates(interface);
+#endif
+
    //Use the DNS servers provided by the DHCP server?
    if(!context->settings.manualDnsConfig)
    {
@@ -0,0 +1,882 @@
+/**
+ * @file hpack.c
+ * @brief HPACK header compression for HTTP/2
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * HPACK is the compression format used to represent HTTP header fields
+ * in HTTP/2. A header field is encoded either as an index into the static
+ * or dynamic table, or as a literal name/value pair whose strings may be
+ * Huffman coded. Refer to RFC 7541 for more details
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "http/http_server.h"
+#include "http/hpack.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_SUPPORT == ENABLED && HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+
+//Static table (refer to RFC 7541, appendix A)
+static const HpackStaticEntry hpackStaticTable[HPACK_STATIC_TABLE_SIZE] =
+{
+   {":authority", ""},
+   {":method", "GET"},
+   {":method", "POST"},
+   {":path", "/"},
+   {":path", "/index.html"},
+   {":scheme", "http"},
+   {":scheme", "https"},
+   {":status", "200"},
+   {":status", "204"},
+   {":status", "206"},
+   {":status", "304"},
+   {":status", "400"},
+   {":status", "404"},
+   {":status", "500"},
+   {"accept-charset", ""},
+   {"accept-encoding", "gzip, deflate"},
+   {"accept-language", ""},
+   {"accept-ranges", ""},
+   {"accept", ""},
+   {"access-control-allow-origin", ""},
+   {"age", ""},
+   {"allow", ""},
+   {"authorization", ""},
+   {"cache-control", ""},
+   {"content-disposition", ""},
+   {"content-encoding", ""},
+   {"content-language", ""},
+   {"content-length", ""},
+   {"content-location", ""},
+   {"content-range", ""},
+   {"content-type", ""},
+   {"cookie", ""},
+   {"date", ""},
+   {"etag", ""},
+   {"expect", ""},
+   {"expires", ""},
+   {"from", ""},
+   {"host", ""},
+   {"if-match", ""},
+   {"if-modified-since", ""},
+   {"if-none-match", ""},
+   {"if-range", ""},
+   {"if-unmodified-since", ""},
+   {"last-modified", ""},
+   {"link", ""},
+   {"location", ""},
+   {"max-forwards", ""},
+   {"proxy-authenticate", ""},
+   {"proxy-authorization", ""},
+   {"range", ""},
+   {"referer", ""},
+   {"refresh", ""},
+   {"retry-after", ""},
+   {"server", ""},
+   {"set-cookie", ""},
+   {"strict-transport-security", ""},
+   {"transfer-encoding", ""},
+   {"user-agent", ""},
+   {"vary", ""},
+   {"via", ""},
+   {"www-authenticate", ""}
+};
+
+//Number of Huffman codes of each length (refer to RFC 7541, appendix B)
+static const uint8_t hpackHuffmanCount[31] =
+{
+   0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3,
+   0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4
+};
+
+//Symbols ordered by code length, then by symbol value. The codes are
+//canonical, so the code of each symbol can be derived from its rank
+static const uint16_t hpackHuffmanSymbols[257] =
+{
+   48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37,
+   45, 46, 47, 51, 52, 53, 54, 55, 56, 57, 61, 65,
+   95, 98, 100, 102, 103, 104, 108, 109, 110, 112, 114, 117,
+   58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+   77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89,
+   106, 107, 113, 118, 119, 120, 121, 122, 38, 42, 44, 59,
+   88, 90, 33, 34, 40, 41, 63, 39, 43, 124, 35, 62,
+   0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+   195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161,
+   167, 172, 176, 177, 179, 209, 216, 217, 227, 229, 230, 129,
+   132, 133, 134, 136, 146, 154, 156, 160, 163, 164, 169, 170,
+   173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+   233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150,
+   151, 152, 155, 157, 158, 165, 166, 168, 174, 175, 180, 182,
+   183, 188, 191, 197, 231, 239, 9, 142, 144, 145, 148, 159,
+   171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+   200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243,
+   255, 203, 204, 211, 212, 214, 221, 222, 223, 241, 244, 245,
+   246, 247, 248, 250, 251, 252, 253, 254, 2, 3, 4, 5,
+   6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+   21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220,
+   249, 10, 13, 22, 256
+};
+
+
+/**
+ * @brief Initialize dynamic table
+ * @param[in] table Pointer to the dynamic table
+ **/
+
+void hpackInitDynamicTable(HpackDynamicTable *table)
+{
+   //The dynamic table is initially empty
+   table->maxSize = HPACK_DYNAMIC_TABLE_SIZE;
+   table->size = 0;
+   table->length = 0;
+   table->numEntries = 0;
+}
+
+
+/**
+ * @brief Decode a header block
+ *
+ * The callback function is invoked for each header field, in the order
+ * they appear in the header block. Both strings are NULL-terminated and
+ * reside in the scratch buffer, which is reused for the next field
+ *
+ * @param[in] table Pointer to the dynamic table
+ * @param[in] data Pointer to the header block
+ * @param[in] length Length of the header block
+ * @param[out] buffer Scratch buffer where to decode the header fields
+ * @param[in] size Size of the scratch buffer
+ * @param[in] callback Callback function invoked for each header field
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t hpackDecodeHeaderBlock(HpackDynamicTable *table, const uint8_t *data,
+   size_t length, char_t *buffer, size_t size, HpackFieldCallback callback,
+   void *param)
+{
+   error_t error;
+   size_t pos;
+   size_t nameLen;
+   size_t valueLen;
+   uint32_t index;
+   bool_t indexing;
+   char_t *p;
+   const char_t *name;
+   const char_t *value;
+
+   //Point to the first header field representation
+   pos = 0;
+
+   //Parse the header block
+   while(pos < length)
+   {
+      //Indexed header field representation?
+      if(data[pos] & 0x80)
+      {
+         //The index is encoded with a 7-bit prefix
+         error = hpackDecodeInteger(data, length, &pos, 7, &index);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Retrieve the header field from the static or dynamic table
+         error = hpackGetEntry(table, index, &name, &nameLen, &value, &valueLen);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Make sure the scratch buffer is large enough
+         if((nameLen + valueLen + 2) > size)
+            return ERROR_BUFFER_OVERFLOW;
+
+         //Copy the name and the value of the header field
+         memcpy(buffer, name, nameLen);
+         buffer[nameLen] = '\0';
+         p = buffer + nameLen + 1;
+         memcpy(p, value, valueLen);
+         p[valueLen] = '\0';
+      }
+      //Dynamic table size update?
+      else if((data[pos] & 0xE0) == 0x20)
+      {
+         //The new maximum size is encoded with a 5-bit prefix
+         error = hpackDecodeInteger(data, length, &pos, 5, &index);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //The new maximum size must not exceed the limit advertised
+         //in the SETTINGS_HEADER_TABLE_SIZE parameter
+         if(index > HPACK_DYNAMIC_TABLE_SIZE)
+            return ERROR_INVALID_LENGTH;
+
+         //Reducing the maximum size can cause entries to be evicted
+         hpackEvictEntries(table, index);
+         table->maxSize = index;
+
+         //This representation does not emit any header field
+         continue;
+      }
+      //Literal header field representation?
+      else
+      {
+         //Literal header field with incremental indexing?
+         indexing = ((data[pos] & 0xC0) == 0x40) ? TRUE : FALSE;
+
+         //The name index is encoded with a 6-bit prefix (incremental
+         //indexing) or a 4-bit prefix (without indexing, never indexed)
+         error = hpackDecodeInteger(data, length, &pos, indexing ? 6 : 4,
+            &index);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //New name?
+         if(index == 0)
+         {
+            //Decode the header field name
+            error = hpackDecodeString(data, length, &pos, buffer, size,
+               &nameLen);
+            //Any error to report?
+            if(error)
+               return error;
+         }
+         else
+         {
+            //The name is taken from the static or dynamic table
+            error = hpackGetEntry(table, index, &name, &nameLen, &value,
+               &valueLen);
+            //Any error to report?
+            if(error)
+               return error;
+
+            //Make sure the scratch buffer is large enough
+            if((nameLen + 1) > size)
+               return ERROR_BUFFER_OVERFLOW;
+
+            //Copy the name of the header field
+            memcpy(buffer, name, nameLen);
+            buffer[nameLen] = '\0';
+         }
+
+         //The value immediately follows the name
+         p = buffer + nameLen + 1;
+
+         //Decode the header field value
+         error = hpackDecodeString(data, length, &pos, p,
+            size - nameLen - 1, &valueLen);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //The header field must be inserted into the dynamic table
+         //before the callback has a chance to alter the strings
+         if(indexing)
+            hpackAddEntry(table, buffer, nameLen, p, valueLen);
+      }
+
+      //Process the header field
+      callback(param, buffer, p);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode an integer with an N-bit prefix
+ * @param[in] data Pointer to the header block
+ * @param[in] length Length of the header block
+ * @param[in,out] pos Current position in the header block
+ * @param[in] prefixLen Length of the prefix, in bits
+ * @param[out] value Decoded integer
+ * @return Error code
+ **/
+
+error_t hpackDecodeInteger(const uint8_t *data, size_t length, size_t *pos,
+   uint_t prefixLen, uint32_t *value)
+{
+   uint_t m;
+   uint8_t b;
+   uint32_t mask;
+
+   //Malformed representation?
+   if(*pos >= length)
+      return ERROR_INVALID_LENGTH;
+
+   //Extract the prefix
+   mask = (1U << prefixLen) - 1;
+   *value = data[*pos] & mask;
+   *pos += 1;
+
+   //If the value is small enough, it is encoded within the prefix
+   if(*value < mask)
+      return NO_ERROR;
+
+   //Otherwise, the remainder is encoded using a list of octets, the most
+   //significant bit being used as a continuation flag
+   for(m = 0; ; m += 7)
+   {
+      //Malformed representation?
+      if(*pos >= length)
+         return ERROR_INVALID_LENGTH;
+
+      //Integers larger than 2^28 are not expected
+      if(m > 21)
+         return ERROR_OUT_OF_RANGE;
+
+      //Get the next octet
+      b = data[*pos];
+      *pos += 1;
+
+      //Add the 7-bit value
+      *value += (uint32_t) (b & 0x7F) << m;
+
+      //Last octet?
+      if(!(b & 0x80))
+         break;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode a string literal
+ * @param[in] data Pointer to the header block
+ * @param[in] length Length of the header block
+ * @param[in,out] pos Current position in the header block
+ * @param[out] buffer Output buffer where to store the NULL-terminated string
+ * @param[in] size Size of the output buffer
+ * @param[out] written Length of the decoded string
+ * @return Error code
+ **/
+
+error_t hpackDecodeString(const uint8_t *data, size_t length, size_t *pos,
+   char_t *buffer, size_t size, size_t *written)
+{
+   error_t error;
+   bool_t huffman;
+   uint32_t n;
+
+   //Malformed representation?
+   if(*pos >= length)
+      return ERROR_INVALID_LENGTH;
+
+   //The H flag indicates whether the string is Huffman encoded
+   huffman = (data[*pos] & 0x80) ? TRUE : FALSE;
+
+   //The length of the string is encoded with a 7-bit prefix
+   error = hpackDecodeInteger(data, length, pos, 7, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Malformed representation?
+   if(n > (length - *pos))
+      return ERROR_INVALID_LENGTH;
+
+   //Huffman encoded string?
+   if(huffman)
+   {
+      //Decode the string
+      error = hpackDecodeHuffman(data + *pos, n, buffer, size, written);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+   else
+   {
+      //Make sure the output buffer is large enough
+      if((n + 1) > size)
+         return ERROR_BUFFER_OVERFLOW;
+
+      //Copy the string
+      memcpy(buffer, data + *pos, n);
+      buffer[n] = '\0';
+
+      //Return the length of the string
+      *written = n;
+   }
+
+   //Skip the string literal
+   *pos += n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode a Huffman encoded string
+ * @param[in] data Pointer to the encoded string
+ * @param[in] length Length of the encoded string
+ * @param[out] buffer Output buffer where to store the NULL-terminated string
+ * @param[in] size Size of the output buffer
+ * @param[out] written Length of the decoded string
+ * @return Error code
+ **/
+
+error_t hpackDecodeHuffman(const uint8_t *data, size_t length,
+   char_t *buffer, size_t size, size_t *written)
+{
+   size_t i;
+   size_t n;
+   uint_t j;
+   uint_t len;
+   uint_t symbol;
+   int32_t code;
+   int32_t first;
+   int32_t count;
+   int32_t index;
+   bool_t padding;
+
+   //Initialize variables
+   n = 0;
+   len = 0;
+   code = 0;
+   first = 0;
+   index = 0;
+   padding = TRUE;
+
+   //The size of the output buffer must account for the terminating NULL
+   if(size < 1)
+      return ERROR_BUFFER_OVERFLOW;
+
+   //Process the encoded string bit by bit, most significant bit first
+   for(i = 0; i < length; i++)
+   {
+      for(j = 8; j > 0; j--)
+      {
+         //Append the next bit to the current code
+         code |= (data[i] >> (j - 1)) & 0x01;
+         len++;
+
+         //Padding consists of the most significant bits of the EOS code,
+         //which are all set to one
+         if(!(code & 0x01))
+            padding = FALSE;
+
+         //Number of codes of the current length
+         count = hpackHuffmanCount[len];
+
+         //Canonical codes of the same length are consecutive integers
+         if((code - first) < count)
+         {
+            //Retrieve the corresponding symbol
+            symbol = hpackHuffmanSymbols[index + code - first];
+
+            //A Huffman encoded string literal containing the EOS symbol
+            //must be treated as a decoding error
+            if(symbol == 256)
+               return ERROR_WRONG_ENCODING;
+
+            //Make sure the output buffer is large enough
+            if((n + 1) >= size)
+               return ERROR_BUFFER_OVERFLOW;
+
+            //Save the decoded symbol
+            buffer[n++] = (char_t) symbol;
+
+            //Decode the next symbol
+            len = 0;
+            code = 0;
+            first = 0;
+            index = 0;
+            padding = TRUE;
+         }
+         else
+         {
+            //The longest code (EOS) is 30 bits long
+            if(len >= 30)
+               return ERROR_WRONG_ENCODING;
+
+            //Move to the codes of the next length
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+         }
+      }
+   }
+
+   //Padding strictly longer than 7 bits, or that does not correspond to
+   //the most significant bits of the EOS code, is a decoding error
+   if(len > 7 || !padding)
+      return ERROR_WRONG_ENCODING;
+
+   //Properly terminate the string with a NULL character
+   buffer[n] = '\0';
+   //Return the length of the decoded string
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve a header field from the static or dynamic table
+ * @param[in] table Pointer to the dynamic table
+ * @param[in] index Index of the header field
+ * @param[out] name Name of the header field
+ * @param[out] nameLen Length of the name
+ * @param[out] value Value of the header field
+ * @param[out] valueLen Length of the value
+ * @return Error code
+ **/
+
+error_t hpackGetEntry(HpackDynamicTable *table, uint32_t index,
+   const char_t **name, size_t *nameLen, const char_t **value, size_t *valueLen)
+{
+   uint8_t *p;
+
+   //The index value of 0 is not used
+   if(index == 0)
+   {
+      //Report an error
+      return ERROR_INVALID_PARAMETER;
+   }
+   //Static table?
+   else if(index <= HPACK_STATIC_TABLE_SIZE)
+   {
+      //Point to the relevant entry
+      *name = hpackStaticTable[index - 1].name;
+      *nameLen = strlen(*name);
+      *value = hpackStaticTable[index - 1].value;
+      *valueLen = strlen(*value);
+   }
+   //Dynamic table?
+   else
+   {
+      //Indices strictly greater than the sum of the lengths of both
+      //tables must be treated as a decoding error
+      index -= HPACK_STATIC_TABLE_SIZE + 1;
+      if(index >= table->numEntries)
+         return ERROR_INVALID_PARAMETER;
+
+      //The newest entry is at the lowest index
+      p = table->buffer + table->offsets[table->numEntries - index - 1];
+
+      //Point to the relevant entry
+      *nameLen = LOAD16BE(p);
+      *valueLen = LOAD16BE(p + 2);
+      *name = (char_t *) p + 4;
+      *value = (char_t *) p + 4 + *nameLen;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Insert a header field into the dynamic table
+ * @param[in] table Pointer to the dynamic table
+ * @param[in] name Name of the header field
+ * @param[in] nameLen Length of the name
+ * @param[in] value Value of the header field
+ * @param[in] valueLen Length of the value
+ **/
+
+void hpackAddEntry(HpackDynamicTable *table, const char_t *name,
+   size_t nameLen, const char_t *value, size_t valueLen)
+{
+   size_t n;
+   uint8_t *p;
+
+   //The size of an entry is the sum of its name's length, its value's
+   //length, and 32
+   n = nameLen + valueLen + HPACK_ENTRY_OVERHEAD;
+
+   //An attempt to add an entry larger than the maximum size causes the
+   //table to be emptied of all existing entries
+   if(n > table->maxSize)
+   {
+      hpackEvictEntries(table, 0);
+      return;
+   }
+
+   //Evict entries from the end of the table until the size of the table
+   //is less than or equal to the maximum size minus the new entry size
+   hpackEvictEntries(table, table->maxSize - n);
+
+   //Point to the free space at the end of the buffer
+   p = table->buffer + table->length;
+
+   //Append the new entry
+   STORE16BE(nameLen, p);
+   STORE16BE(valueLen, p + 2);
+   memcpy(p + 4, name, nameLen);
+   memcpy(p + 4 + nameLen, value, valueLen);
+
+   //Update the dynamic table
+   table->offsets[table->numEntries++] = (uint16_t) table->length;
+   table->length += nameLen + valueLen + 4;
+   table->size += n;
+}
+
+
+/**
+ * @brief Evict the oldest entries of the dynamic table
+ * @param[in] table Pointer to the dynamic table
+ * @param[in] maxSize Size of the table not to be exceeded
+ **/
+
+void hpackEvictEntries(HpackDynamicTable *table, size_t maxSize)
+{
+   uint_t i;
+   uint_t k;
+   size_t n;
+   uint8_t *p;
+
+   //Count the number of entries to be evicted, oldest first
+   for(i = 0; i < table->numEntries && table->size > maxSize; i++)
+   {
+      //Point to the current entry
+      p = table->buffer + table->offsets[i];
+      //Update the size of the table
+      table->size -= LOAD16BE(p) + LOAD16BE(p + 2) + HPACK_ENTRY_OVERHEAD;
+   }
+
+   //Any entry to evict?
+   if(i > 0)
+   {
+      //Number of bytes occupied by the evicted entries
+      n = (i < table->numEntries) ? table->offsets[i] : table->length;
+
+      //Remove the evicted entries from the head of the buffer
+      memmove(table->buffer, table->buffer + n, table->length - n);
+      table->length -= n;
+
+      //Adjust the offset of the remaining entries
+      for(k = i; k < table->numEntries; k++)
+         table->offsets[k - i] = (uint16_t) (table->offsets[k] - n);
+
+      //Update the number of entries
+      table->numEntries -= i;
+   }
+}
+
+
+/**
+ * @brief Encode an integer with an N-bit prefix
+ * @param[out] data Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[in] pattern Bits that precede the prefix in the first octet
+ * @param[in] prefixLen Length of the prefix, in bits
+ * @param[in] value Integer to be encoded
+ * @return Number of bytes written (0 if the output buffer is too small)
+ **/
+
+size_t hpackEncodeInteger(uint8_t *data, size_t size, uint8_t pattern,
+   uint_t prefixLen, uint32_t value)
+{
+   size_t n;
+   uint32_t mask;
+
+   //Make sure the output buffer is large enough
+   if(size < 1)
+      return 0;
+
+   //Maximum value that fits in the prefix
+   mask = (1U << prefixLen) - 1;
+
+   //If the value is small enough, it is encoded within the prefix
+   if(value < mask)
+   {
+      data[0] = pattern | (uint8_t) value;
+      return 1;
+   }
+
+   //All the bits of the prefix are set to 1
+   data[0] = pattern | (uint8_t) mask;
+   value -= mask;
+   n = 1;
+
+   //The remainder is encoded using a list of octets
+   while(value >= 128)
+   {
+      //Make sure the output buffer is large enough
+      if(n >= size)
+         return 0;
+
+      //Set the continuation flag
+      data[n++] = (uint8_t) ((value & 0x7F) | 0x80);
+      value >>= 7;
+   }
+
+   //Make sure the output buffer is large enough
+   if(n >= size)
+      return 0;
+
+   //Last octet
+   data[n++] = (uint8_t) value;
+
+   //Return the number of bytes written
+   return n;
+}
+
+
+/**
+ * @brief Encode a string literal (without Huffman coding)
+ * @param[out] data Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[in] s NULL-terminated string to be encoded
+ * @return Number of bytes written (0 if the output buffer is too small)
+ **/
+
+size_t hpackEncodeString(uint8_t *data, size_t size, const char_t *s)
+{
+   size_t n;
+   size_t length;
+
+   //Length of the string
+   length = strlen(s);
+
+   //The H flag is cleared and the length uses a 7-bit prefix
+   n = hpackEncodeInteger(data, size, 0x00, 7, length);
+
+   //Make sure the output buffer is large enough
+   if(n == 0 || (n + length) > size)
+      return 0;
+
+   //Copy the string
+   memcpy(data + n, s, length);
+
+   //Return the number of bytes written
+   return n + length;
+}
+
+
+/**
+ * @brief Encode an indexed header field
+ * @param[out] data Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[in] index Index of the header field
+ * @return Number of bytes written (0 if the output buffer is too small)
+ **/
+
+size_t hpackEncodeIndexedField(uint8_t *data, size_t size, uint_t index)
+{
+   //The index is encoded with a 7-bit prefix
+   return hpackEncodeInteger(data, size, 0x80, 7, index);
+}
+
+
+/**
+ * @brief Encode a literal header field without indexing
+ *
+ * The encoder never inserts entries into the peer's dynamic table, so that
+ * the state kept by the decoder does not grow with the number of responses
+ *
+ * @param[out] data Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[in] name Name of the header field (lowercase)
+ * @param[in] value Value of the header field
+ * @return Number of bytes written (0 if the output buffer is too small)
+ **/
+
+size_t hpackEncodeLiteralField(uint8_t *data, size_t size,
+   const char_t *name, const char_t *value)
+{
+   size_t n;
+   size_t m;
+   uint_t index;
+
+   //Search the static table for a matching name
+   index = hpackFindStaticEntry(name, NULL);
+
+   //Indexed name?
+   if(index != 0)
+   {
+      //The name index is encoded with a 4-bit prefix
+      n = hpackEncodeInteger(data, size, 0x00, 4, index);
+   }
+   else
+   {
+      //Make sure the output buffer is large enough
+      if(size < 1)
+         return 0;
+
+      //The name is represented as a string literal
+      data[0] = 0x00;
+      m = hpackEncodeString(data + 1, size - 1, name);
+      n = (m != 0) ? m + 1 : 0;
+   }
+
+   //Failed to encode the name?
+   if(n == 0)
+      return 0;
+
+   //Encode the value
+   m = hpackEncodeString(data + n, size - n, value);
+   //Failed to encode the value?
+   if(m == 0)
+      return 0;
+
+   //Return the number of bytes written
+   return n + m;
+}
+
+
+/**
+ * @brief Search the static table
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field (NULL to match the name only)
+ * @return Index of the matching entry (0 if no entry matches)
+ **/
+
+uint_t hpackFindStaticEntry(const char_t *name, const char_t *value)
+{
+   uint_t i;
+
+   //Loop through the static table
+   for(i = 0; i < HPACK_STATIC_TABLE_SIZE; i++)
+   {
+      //Matching name?
+      if(!strcmp(hpackStaticTable[i].name, name))
+      {
+         //Matching value?
+         if(value == NULL || !strcmp(hpackStaticTable[i].value, value))
+            return i + 1;
+      }
+   }
+
+   //No matching entry
+   return 0;
+}
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @file hpack.h
+ * @brief HPACK header compression for HTTP/2
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _HPACK_H
+#define _HPACK_H
+
+//Dependencies
+#include "core/net.h"
+
+//Size of the dynamic table
+#ifndef HPACK_DYNAMIC_TABLE_SIZE
+   #define HPACK_DYNAMIC_TABLE_SIZE 4096
+#elif (HPACK_DYNAMIC_TABLE_SIZE < 64 || HPACK_DYNAMIC_TABLE_SIZE > 65535)
+   #error HPACK_DYNAMIC_TABLE_SIZE parameter is not valid
+#endif
+
+//Size overhead of a dynamic table entry
+#define HPACK_ENTRY_OVERHEAD 32
+//Number of entries in the static table
+#define HPACK_STATIC_TABLE_SIZE 61
+//Maximum number of entries in the dynamic table
+#define HPACK_MAX_ENTRIES (HPACK_DYNAMIC_TABLE_SIZE / HPACK_ENTRY_OVERHEAD)
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Static table entry
+ **/
+
+typedef struct
+{
+   const char_t *name;
+   const char_t *value;
+} HpackStaticEntry;
+
+
+/**
+ * @brief Dynamic table
+ *
+ * Entries are stored back to back, oldest first, as a 2-byte name length,
+ * a 2-byte value length, the name and the value. Eviction removes the
+ * entry at the head of the buffer
+ *
+ **/
+
+typedef struct
+{
+   size_t maxSize;                            ///<Maximum size of the table, as defined by RFC 7541
+   size_t size;                               ///<Current size of the table, as defined by RFC 7541
+   size_t length;                             ///<Number of bytes used in the buffer
+   uint_t numEntries;                         ///<Number of entries
+   uint16_t offsets[HPACK_MAX_ENTRIES];       ///<Offset of each entry, oldest first
+   uint8_t buffer[HPACK_DYNAMIC_TABLE_SIZE];  ///<Entries
+} HpackDynamicTable;
+
+
+/**
+ * @brief Callback function invoked for each decoded header field
+ **/
+
+typedef void (*HpackFieldCallback)(void *param, char_t *name, char_t *value);
+
+
+//HPACK related functions
+void hpackInitDynamicTable(HpackDynamicTable *table);
+
+error_t hpackDecodeHeaderBlock(HpackDynamicTable *table, const uint8_t *data,
+   size_t length, char_t *buffer, size_t size, HpackFieldCallback callback,
+   void *param);
+
+error_t hpackDecodeInteger(const uint8_t *data, size_t length, size_t *pos,
+   uint_t prefixLen, uint32_t *value);
+
+error_t hpackDecodeString(const uint8_t *data, size_t length, size_t *pos,
+   char_t *buffer, size_t size, size_t *written);
+
+error_t hpackDecodeHuffman(const uint8_t *data, size_t length,
+   char_t *buffer, size_t size, size_t *written);
+
+error_t hpackGetEntry(HpackDynamicTable *table, uint32_t index,
+   const char_t **name, size_t *nameLen, const char_t **value, size_t *valueLen);
+
+void hpackAddEntry(HpackDynamicTable *table, const char_t *name,
+   size_t nameLen, const char_t *value, size_t valueLen);
+
+void hpackEvictEntries(HpackDynamicTable *table, size_t maxSize);
+
+size_t hpackEncodeInteger(uint8_t *data, size_t size, uint8_t pattern,
+   uint_t prefixLen, uint32_t value);
+
+size_t hpackEncodeString(uint8_t *data, size_t size, const char_t *s);
+
+size_t hpackEncodeIndexedField(uint8_t *data, size_t size, uint_t index);
+
+size_t hpackEncodeLiteralField(uint8_t *data, size_t size,
+   const char_t *name, const char_t *value);
+
+uint_t hpackFindStaticEntry(const char_t *name, const char_t *value);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,2425 @@
+/**
+ * @file http2_server.c
+ * @brief HTTP/2 server (connection management and framing)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * HTTP/2 carries the same request and response semantics as HTTP/1.1 over
+ * a single connection made of independent streams, with binary framing,
+ * HPACK header compression and per-stream flow control. The connection is
+ * established with ALPN ("h2") over TLS, with prior knowledge, or through
+ * the HTTP/1.1 Upgrade mechanism ("h2c"). Requests are handed over to the
+ * same request callback, SSI engine and file system backends as HTTP/1.x
+ * requests. Refer to RFC 7540 for more details
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "http/http_server.h"
+#include "http/http_server_misc.h"
+#include "http/http2_server.h"
+#include "http/hpack.h"
+#include "str.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_SUPPORT == ENABLED && HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Check whether HTTP/2 is used from the start of the connection
+ *
+ * Over TLS, HTTP/2 is selected by the ALPN extension. Over cleartext TCP,
+ * a client with prior knowledge starts with the connection preface, which
+ * is left in the receive buffer
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if the connection uses HTTP/2, else FALSE
+ **/
+
+bool_t http2CheckConnection(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED && TLS_ALPN_SUPPORT == ENABLED)
+   //TLS-secured connection?
+   if(connection->tlsContext != NULL)
+   {
+      const char_t *protocol;
+
+      //Retrieve the protocol selected during the TLS handshake
+      protocol = tlsGetAlpnProtocol(connection->tlsContext);
+
+      //HTTP/2 over TLS is identified by the "h2" string
+      if(protocol != NULL && !strcmp(protocol, "h2"))
+         return TRUE;
+      else
+         return FALSE;
+   }
+#endif
+
+   //Compare the data received so far with the connection preface
+   while(1)
+   {
+      //Number of bytes available in the receive buffer
+      n = connection->rxBufferLen - connection->rxBufferPos;
+      n = MIN(n, HTTP2_PREFACE_SIZE);
+
+      //HTTP/1.x request?
+      if(memcmp(connection->rxBuffer + connection->rxBufferPos,
+         HTTP2_PREFACE, n))
+      {
+         return FALSE;
+      }
+
+      //The whole preface has been received?
+      if(n == HTTP2_PREFACE_SIZE)
+         return TRUE;
+
+      //Receive more data
+      error = httpReadRxBuffer(connection);
+      //Any error to report?
+      if(error)
+         return FALSE;
+   }
+}
+
+
+/**
+ * @brief Check whether the client asks to switch to HTTP/2 (h2c)
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if the connection can be upgraded, else FALSE
+ **/
+
+bool_t http2CheckUpgrade(HttpConnection *connection)
+{
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //The "h2c" token must not be used over TLS
+   if(connection->tlsContext != NULL)
+      return FALSE;
+#endif
+
+   //The request must include the Upgrade and HTTP2-Settings header fields
+   if(!connection->request.upgradeHttp2 || !connection->request.http2Settings)
+      return FALSE;
+
+   //Upgrading a request that carries a body would require the body to be
+   //buffered, so that the server ignores the upgrade in this case
+   if(connection->request.chunkedEncoding || connection->request.contentLength > 0)
+      return FALSE;
+
+   //The Upgrade mechanism is defined for HTTP/1.1 only
+   if(connection->request.version < HTTP_VERSION_1_1)
+      return FALSE;
+
+   //The connection can be upgraded
+   return TRUE;
+}
+
+
+/**
+ * @brief Service an HTTP/2 connection
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] upgrade The connection is upgraded from HTTP/1.1 and the
+ *   request that has been already parsed must be serviced as stream 1
+ * @return Error code
+ **/
+
+error_t http2ServeConnection(HttpConnection *connection, bool_t upgrade)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   char_t preface[HTTP2_PREFACE_SIZE];
+   Http2Context *context;
+
+   //Debug message
+   TRACE_INFO("Starting HTTP/2 session...\r\n");
+
+   //Allocate a memory buffer to hold the state of the HTTP/2 connection
+   context = osAllocMem(sizeof(Http2Context));
+   //Failed to allocate memory?
+   if(context == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Initialize connection state
+   hpackInitDynamicTable(&context->decoderTable);
+   context->errorCode = HTTP2_ERROR_NO_ERROR;
+   context->settingsReceived = FALSE;
+   context->goAway = FALSE;
+   context->initialWindowSize = HTTP2_DEFAULT_WINDOW_SIZE;
+   context->maxFrameSize = HTTP2_DEFAULT_MAX_FRAME_SIZE;
+   context->connSendWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+   context->lastStreamId = 0;
+   context->resetStreamId = 0;
+   context->streamId = 0;
+   context->requestReady = FALSE;
+   context->dataRemaining = 0;
+   context->bufferedStream = NULL;
+
+   //No stream is pending
+   for(i = 0; i < HTTP_SERVER_HTTP2_MAX_STREAMS; i++)
+      context->stream[i].id = 0;
+
+   //Attach the HTTP/2 state to the connection
+   connection->http2Context = context;
+
+   //Start of exception handling block
+   do
+   {
+      //Upgrade from HTTP/1.1?
+      if(upgrade)
+      {
+         //Debug message
+         TRACE_INFO("Switching to HTTP/2 (h2c)...\r\n");
+
+         //Accept the upgrade with a 101 status code
+         strcpy(connection->buffer, "HTTP/1.1 101 Switching Protocols\r\n"
+            "Connection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+
+         //Send the response
+         error = httpSend(connection, connection->buffer,
+            strlen(connection->buffer), HTTP_FLAG_DELAY);
+         //Any error to report?
+         if(error)
+            break;
+      }
+
+      //The server connection preface consists of a SETTINGS frame
+      error = http2SendSettings(connection);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Read the client connection preface
+      error = httpReceive(connection, preface, HTTP2_PREFACE_SIZE, &n,
+         HTTP_FLAG_WAIT_ALL);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Check the contents of the preface
+      if(n != HTTP2_PREFACE_SIZE || memcmp(preface, HTTP2_PREFACE, n))
+      {
+         error = http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+         break;
+      }
+
+      //The preface must be followed by a SETTINGS frame
+      error = http2ProcessFrame(connection, FALSE);
+      //Any error to report?
+      if(error)
+         break;
+
+      //SETTINGS frame not received?
+      if(!context->settingsReceived)
+      {
+         error = http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+         break;
+      }
+
+      //Upgrade from HTTP/1.1?
+      if(upgrade)
+      {
+         //The request is assigned a stream identifier of 1 and is
+         //half-closed from the client
+         context->lastStreamId = 1;
+         context->streamId = 1;
+         context->endStream = TRUE;
+         context->streamReset = FALSE;
+         context->headersSent = FALSE;
+         context->streamClosed = FALSE;
+         context->streamSendWindow = context->initialWindowSize;
+
+         //Send the response on stream 1
+         error = http2ServeStream(connection);
+      }
+
+      //Process incoming frames
+      while(!error)
+      {
+         //No stream is being serviced?
+         if(context->streamId == 0 && !context->requestReady)
+         {
+            //Resume the oldest pending stream, if any
+            error = http2ActivateStream(connection);
+            //Any error to report?
+            if(error)
+               break;
+         }
+
+         //A new stream has been opened?
+         if(context->requestReady)
+         {
+            //Clear flag
+            context->requestReady = FALSE;
+
+            //Build the request from the pseudo-header fields
+            error = http2ParseRequest(connection);
+
+            //Check status code
+            if(!error)
+            {
+               //Send the response
+               error = http2ServeStream(connection);
+            }
+            else if(context->errorCode == HTTP2_ERROR_NO_ERROR)
+            {
+               //Malformed requests are treated as a stream error
+               error = http2SendRstStream(connection, context->streamId,
+                  HTTP2_ERROR_PROTOCOL_ERROR);
+               //The stream is closed
+               http2ReleaseStream(connection);
+            }
+
+            //Service the next stream
+            continue;
+         }
+
+         //The client does not open any further stream?
+         if(context->goAway)
+            break;
+
+         //Set the maximum time the server will wait for a frame
+         //before closing the connection
+         error = socketSetTimeout(connection->socket, HTTP_SERVER_IDLE_TIMEOUT);
+         //Any error to report?
+         if(error)
+            break;
+
+         //Read and process the next frame
+         error = http2ProcessFrame(connection, FALSE);
+         //Any error to report?
+         if(error)
+            break;
+
+         //Revert to default timeout
+         error = socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Debug message
+   TRACE_INFO("Closing HTTP/2 session...\r\n");
+
+   //Notify the client that the connection is being shut down
+   http2SendGoAway(connection);
+
+   //Release the HTTP/2 state
+   connection->http2Context = NULL;
+   osFreeMem(context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the response to the current stream
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2ServeStream(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Debug message
+   TRACE_INFO("Processing HTTP/2 stream %" PRIu32 "...\r\n", context->streamId);
+
+   //The request is processed the same way as an HTTP/1.x request
+   error = httpHandleRequest(connection);
+
+   //Connection error?
+   if(context->errorCode != HTTP2_ERROR_NO_ERROR)
+      return ERROR_INVALID_PROTOCOL;
+
+   //The stream has been reset by the client?
+   if(context->streamReset)
+   {
+      //No further frames can be sent on the stream
+      error = NO_ERROR;
+   }
+   //The response is complete?
+   else if(context->streamClosed)
+   {
+      //Successful processing
+      error = NO_ERROR;
+   }
+   //The response header has been sent?
+   else if(context->headersSent)
+   {
+      //Terminate the response
+      error = http2CloseStream(connection);
+   }
+   else
+   {
+      //No response could be generated
+      error = http2SendRstStream(connection, context->streamId,
+         HTTP2_ERROR_INTERNAL_ERROR);
+   }
+
+   //The client is still sending the request body?
+   if(!error && !context->endStream && !context->streamReset)
+   {
+      //The response is complete, so that the remaining of the request
+      //body is not needed anymore
+      error = http2SendRstStream(connection, context->streamId,
+         HTTP2_ERROR_NO_ERROR);
+   }
+
+   //The stream is now closed
+   http2ReleaseStream(connection);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Build the request from the pseudo-header fields
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2ParseRequest(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //All HTTP/2 requests must include exactly one valid value for the
+   //:method and :path pseudo-header fields
+   if(context->malformed || context->method[0] == '\0' ||
+      context->path[0] == '\0')
+   {
+      return ERROR_INVALID_REQUEST;
+   }
+
+   //Make sure the buffer is large enough to hold the Request-Line
+   if((strlen(context->method) + strlen(context->path) + 11) >
+      HTTP_SERVER_BUFFER_SIZE)
+   {
+      return ERROR_INVALID_REQUEST;
+   }
+
+   //Format the equivalent HTTP/1.1 Request-Line
+   sprintf(connection->buffer, "%s %s HTTP/1.1", context->method,
+      context->path);
+
+   //Debug message
+   TRACE_INFO("%s\r\n", connection->buffer);
+
+   //Parse the Request-Line
+   error = httpParseRequestLine(connection, connection->buffer);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The request body is carried in DATA frames
+   connection->request.chunkedEncoding = FALSE;
+   connection->request.byteCount = connection->request.contentLength;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read and process an incoming frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] readData The caller is reading the request body of the
+ *   current stream (the payload of such DATA frames is left unread)
+ * @return Error code
+ **/
+
+error_t http2ProcessFrame(HttpConnection *connection, bool_t readData)
+{
+   error_t error;
+   uint8_t type;
+   uint8_t flags;
+   size_t length;
+   uint32_t streamId;
+   uint8_t payload[8];
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Read the frame header
+   error = http2ReadFrameHeader(connection, &type, &flags, &length, &streamId);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Debug message
+   TRACE_DEBUG("HTTP/2 frame received (type = %u, flags = 0x%02X, length = %"
+      PRIuSIZE ", stream = %" PRIu32 ")\r\n", type, flags, length, streamId);
+
+   //The frame must not exceed the size advertised by the server
+   if(length > HTTP2_DEFAULT_MAX_FRAME_SIZE)
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+   //Check frame type
+   if(type == HTTP2_FRAME_TYPE_DATA)
+   {
+      //Process DATA frame
+      error = http2ProcessDataFrame(connection, flags, streamId, length,
+         readData);
+   }
+   else if(type == HTTP2_FRAME_TYPE_HEADERS)
+   {
+      //Process HEADERS frame
+      error = http2ProcessHeadersFrame(connection, flags, streamId, length);
+   }
+   else if(type == HTTP2_FRAME_TYPE_PRIORITY)
+   {
+      //Check the length of the frame
+      if(length != 5)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Streams are serviced in order, so that priorities are ignored
+      error = http2DiscardPayload(connection, length);
+   }
+   else if(type == HTTP2_FRAME_TYPE_RST_STREAM)
+   {
+      //RST_STREAM frames must be associated with a stream that is not idle
+      if(streamId == 0 || http2IsIdleStream(connection, streamId))
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Check the length of the frame
+      if(length != 4)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Read the error code
+      error = http2ReadPayload(connection, payload, length);
+
+      //Check status code
+      if(!error)
+      {
+         //Debug message
+         TRACE_INFO("HTTP/2 stream %" PRIu32 " reset by the client (error %" PRIu32 ")\r\n",
+            streamId, LOAD32BE(payload));
+
+         //The current stream is cancelled?
+         if(streamId == context->streamId)
+         {
+            context->streamReset = TRUE;
+         }
+         else
+         {
+            //Search the pending streams
+            stream = http2FindStream(connection, streamId);
+
+            //A pending stream is cancelled?
+            if(stream != NULL)
+               stream->id = 0;
+         }
+      }
+   }
+   else if(type == HTTP2_FRAME_TYPE_SETTINGS)
+   {
+      //Process SETTINGS frame
+      error = http2ProcessSettingsFrame(connection, flags, streamId, length);
+   }
+   else if(type == HTTP2_FRAME_TYPE_PING)
+   {
+      //PING frames are not associated with any stream
+      if(streamId != 0)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Check the length of the frame
+      if(length != 8)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Read opaque data
+      error = http2ReadPayload(connection, payload, length);
+
+      //The receiver of a PING frame must send a PING frame with the ACK
+      //flag set in response, with an identical payload
+      if(!error && !(flags & HTTP2_FLAG_ACK))
+      {
+         error = http2SendFrame(connection, HTTP2_FRAME_TYPE_PING,
+            HTTP2_FLAG_ACK, 0, payload, length, HTTP_FLAG_NO_DELAY);
+      }
+   }
+   else if(type == HTTP2_FRAME_TYPE_GOAWAY)
+   {
+      //GOAWAY frames are not associated with any stream
+      if(streamId != 0)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Check the length of the frame
+      if(length < 8)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //The client does not open any further stream
+      context->goAway = TRUE;
+      //Discard the last stream identifier, error code and debug data
+      error = http2DiscardPayload(connection, length);
+   }
+   else if(type == HTTP2_FRAME_TYPE_WINDOW_UPDATE)
+   {
+      //Process WINDOW_UPDATE frame
+      error = http2ProcessWindowUpdateFrame(connection, streamId, length);
+   }
+   else if(type == HTTP2_FRAME_TYPE_PUSH_PROMISE ||
+      type == HTTP2_FRAME_TYPE_CONTINUATION)
+   {
+      //A client cannot push, and CONTINUATION frames must immediately
+      //follow a HEADERS frame
+      error = http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+   }
+   else
+   {
+      //Frames of unknown types must be ignored
+      error = http2DiscardPayload(connection, length);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process DATA frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] flags Frame flags
+ * @param[in] streamId Stream identifier
+ * @param[in] length Length of the frame payload
+ * @param[in] readData The caller is reading the request body
+ * @return Error code
+ **/
+
+error_t http2ProcessDataFrame(HttpConnection *connection, uint8_t flags,
+   uint32_t streamId, size_t length, bool_t readData)
+{
+   error_t error;
+   size_t n;
+   uint8_t padLength;
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //DATA frames must be associated with a stream that is not idle
+   if(streamId == 0 || http2IsIdleStream(connection, streamId))
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Length of the data
+   n = length;
+   padLength = 0;
+
+   //Padded frame?
+   if(flags & HTTP2_FLAG_PADDED)
+   {
+      //Malformed frame?
+      if(n < 1)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Read the Pad Length field
+      error = http2ReadPayload(connection, &padLength, 1);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The padding cannot exceed the remaining of the payload
+      if(padLength >= n)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Length of the data
+      n -= padLength + 1;
+   }
+
+   //Search the pending streams
+   stream = http2FindStream(connection, streamId);
+
+   //Request body of the current stream?
+   if(readData && streamId == context->streamId && !context->endStream &&
+      !context->streamReset)
+   {
+      //The data are read by the caller
+      context->dataRemaining = n;
+      context->dataPadding = padLength;
+      context->dataLength = length;
+      context->dataEndStream = (flags & HTTP2_FLAG_END_STREAM) ? TRUE : FALSE;
+
+      //Empty frame?
+      if(n == 0)
+         error = http2EndDataFrame(connection);
+   }
+   //Request body of a pending stream?
+   else if(stream != NULL && !stream->endStream)
+   {
+      //Keep the data until the stream is serviced
+      error = http2BufferData(connection, stream, flags, length, n,
+         padLength);
+   }
+   else
+   {
+      //Discard the data
+      error = http2DiscardPayload(connection, n + padLength);
+
+      //Check status code
+      if(!error)
+      {
+         //Discarded data still count against the connection flow-control
+         //window, which must be replenished
+         if(length > 0)
+            error = http2SendWindowUpdate(connection, 0, length);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //The current stream is still open?
+         if(streamId == context->streamId && !context->endStream &&
+            !context->streamReset)
+         {
+            //The request body is not needed by the caller
+            if(flags & HTTP2_FLAG_END_STREAM)
+               context->endStream = TRUE;
+         }
+         //The server has just reset the stream?
+         else if(streamId == context->resetStreamId)
+         {
+            //Frames that were in flight when the RST_STREAM frame was sent
+            //must be ignored (refer to RFC 9113, section 5.1)
+         }
+         else
+         {
+            //The stream is half-closed (remote) or closed
+            if(streamId == context->streamId)
+               context->streamReset = TRUE;
+            else if(stream != NULL)
+               stream->id = 0;
+
+            //This is a stream error of type STREAM_CLOSED (refer to
+            //RFC 9113, section 6.1)
+            error = http2SendRstStream(connection, streamId,
+               HTTP2_ERROR_STREAM_CLOSED);
+         }
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process HEADERS frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] flags Frame flags
+ * @param[in] streamId Stream identifier
+ * @param[in] length Length of the frame payload
+ * @return Error code
+ **/
+
+error_t http2ProcessHeadersFrame(HttpConnection *connection, uint8_t flags,
+   uint32_t streamId, size_t length)
+{
+   error_t error;
+   size_t n;
+   size_t pos;
+   uint8_t type;
+   uint8_t padLength;
+   uint32_t id;
+   bool_t endStream;
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //HEADERS frames must be associated with a stream
+   if(streamId == 0)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //The header block must fit in the buffer, otherwise the HPACK decoder
+   //state could not be kept in sync with the client
+   if(length > HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE)
+      return http2ConnectionError(connection, HTTP2_ERROR_ENHANCE_YOUR_CALM);
+
+   //Read the frame payload
+   error = http2ReadPayload(connection, context->headerBlock, length);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Point to the header block fragment
+   pos = 0;
+   n = length;
+
+   //Padded frame?
+   if(flags & HTTP2_FLAG_PADDED)
+   {
+      //Malformed frame?
+      if(n < 1)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Get the length of the padding
+      padLength = context->headerBlock[0];
+
+      //The padding cannot exceed the remaining of the payload
+      if(padLength >= n)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Skip the Pad Length field and strip the padding
+      pos++;
+      n -= padLength + 1;
+   }
+
+   //Priority information present?
+   if(flags & HTTP2_FLAG_PRIORITY)
+   {
+      //Malformed frame?
+      if(n < 5)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Streams are serviced in order, so that priorities are ignored
+      pos += 5;
+      n -= 5;
+   }
+
+   //Move the header block fragment to the beginning of the buffer
+   memmove(context->headerBlock, context->headerBlock + pos, n);
+
+   //Save the END_STREAM flag
+   endStream = (flags & HTTP2_FLAG_END_STREAM) ? TRUE : FALSE;
+
+   //The header block may be split across CONTINUATION frames
+   while(!(flags & HTTP2_FLAG_END_HEADERS))
+   {
+      //Read the frame header
+      error = http2ReadFrameHeader(connection, &type, &flags, &length, &id);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //No other frame can be interleaved with the header block
+      if(type != HTTP2_FRAME_TYPE_CONTINUATION || id != streamId)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Make sure the buffer is large enough
+      if((n + length) > HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE)
+         return http2ConnectionError(connection, HTTP2_ERROR_ENHANCE_YOUR_CALM);
+
+      //Append the header block fragment
+      error = http2ReadPayload(connection, context->headerBlock + n, length);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Update the length of the header block
+      n += length;
+   }
+
+   //Trailer section of the current stream?
+   if(streamId == context->streamId)
+   {
+      //Trailer fields are not used by the server
+      error = hpackDecodeHeaderBlock(&context->decoderTable,
+         context->headerBlock, n, context->field,
+         HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE, http2DiscardHeaderField, NULL);
+
+      //The trailer section terminates the request
+      if(endStream)
+         context->endStream = TRUE;
+   }
+   //Trailer section of a pending stream?
+   else if((stream = http2FindStream(connection, streamId)) != NULL)
+   {
+      //Trailer fields are not used by the server
+      error = hpackDecodeHeaderBlock(&context->decoderTable,
+         context->headerBlock, n, context->field,
+         HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE, http2DiscardHeaderField, NULL);
+
+      //The trailer section terminates the request
+      if(endStream)
+         stream->endStream = TRUE;
+   }
+   //New stream?
+   else if((streamId & 1) != 0 && streamId > context->lastStreamId)
+   {
+      //Update the highest stream identifier
+      context->lastStreamId = streamId;
+
+      //Another stream is being serviced?
+      if(context->streamId != 0 || context->requestReady)
+      {
+         //The stream is serviced once the current one is complete
+         return http2QueueStream(connection, streamId, n, endStream);
+      }
+      else
+      {
+         //Clear request header
+         memset(&connection->request, 0, sizeof(HttpRequest));
+         //Clear response header
+         memset(&connection->response, 0, sizeof(HttpResponse));
+
+         //Clear pseudo-header fields
+         context->method[0] = '\0';
+         context->path[0] = '\0';
+         context->malformed = FALSE;
+
+         //Decode the request header
+         error = hpackDecodeHeaderBlock(&context->decoderTable,
+            context->headerBlock, n, context->field,
+            HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE, http2ParseHeaderField,
+            connection);
+
+         //Initialize stream state
+         context->streamId = streamId;
+         context->endStream = endStream;
+         context->streamReset = FALSE;
+         context->headersSent = FALSE;
+         context->streamClosed = FALSE;
+         context->streamSendWindow = context->initialWindowSize;
+         context->dataRemaining = 0;
+
+         //The request can be serviced
+         context->requestReady = TRUE;
+      }
+   }
+   else
+   {
+      //Stream identifiers cannot be reused
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+   }
+
+   //A decoding error is a connection error
+   if(error)
+      return http2ConnectionError(connection, HTTP2_ERROR_COMPRESSION_ERROR);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process SETTINGS frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] flags Frame flags
+ * @param[in] streamId Stream identifier
+ * @param[in] length Length of the frame payload
+ * @return Error code
+ **/
+
+error_t http2ProcessSettingsFrame(HttpConnection *connection, uint8_t flags,
+   uint32_t streamId, size_t length)
+{
+   error_t error;
+   size_t i;
+   uint_t j;
+   uint16_t param;
+   uint32_t value;
+   int32_t delta;
+   uint8_t buffer[6];
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //SETTINGS frames are not associated with any stream
+   if(streamId != 0)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Acknowledgment of the server settings?
+   if(flags & HTTP2_FLAG_ACK)
+   {
+      //The payload of an acknowledgment must be empty
+      if(length != 0)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+      //Nothing to do
+      return NO_ERROR;
+   }
+
+   //Each parameter is 6 bytes long
+   if((length % 6) != 0)
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+   //Parse the parameters
+   for(i = 0; i < length; i += 6)
+   {
+      //Read the current parameter
+      error = http2ReadPayload(connection, buffer, 6);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Get the identifier and the value of the parameter
+      param = LOAD16BE(buffer);
+      value = LOAD32BE(buffer + 2);
+
+      //Debug message
+      TRACE_DEBUG("  HTTP/2 setting %" PRIu16 " = %" PRIu32 "\r\n", param, value);
+
+      //Initial window size for stream-level flow control?
+      if(param == HTTP2_SETTINGS_INITIAL_WINDOW_SIZE)
+      {
+         //Values above the maximum flow-control window size must be
+         //treated as a connection error
+         if(value > HTTP2_MAX_WINDOW_SIZE)
+            return http2ConnectionError(connection, HTTP2_ERROR_FLOW_CONTROL_ERROR);
+
+         //A change applies to the windows of all open streams, which
+         //can become negative
+         delta = (int32_t) value - (int32_t) context->initialWindowSize;
+
+         //A change that causes any window to exceed 2^31-1 bytes must be
+         //treated as a connection error (refer to RFC 9113, section 6.9.2)
+         if(delta > 0)
+         {
+            //Check the window of the stream being serviced
+            if(context->streamId != 0 &&
+               context->streamSendWindow > (HTTP2_MAX_WINDOW_SIZE - delta))
+            {
+               return http2ConnectionError(connection,
+                  HTTP2_ERROR_FLOW_CONTROL_ERROR);
+            }
+
+            //Check the windows of the pending streams
+            for(j = 0; j < HTTP_SERVER_HTTP2_MAX_STREAMS; j++)
+            {
+               if(context->stream[j].id != 0 &&
+                  &context->stream[j] != context->bufferedStream &&
+                  context->stream[j].sendWindow > (HTTP2_MAX_WINDOW_SIZE - delta))
+               {
+                  return http2ConnectionError(connection,
+                     HTTP2_ERROR_FLOW_CONTROL_ERROR);
+               }
+            }
+         }
+
+         //Update the window of the stream being serviced
+         context->streamSendWindow += delta;
+
+         //Update the windows of the pending streams
+         for(j = 0; j < HTTP_SERVER_HTTP2_MAX_STREAMS; j++)
+         {
+            if(context->stream[j].id != 0)
+               context->stream[j].sendWindow += delta;
+         }
+
+         //Save the new value
+         context->initialWindowSize = value;
+      }
+      //Largest frame payload accepted by the client?
+      else if(param == HTTP2_SETTINGS_MAX_FRAME_SIZE)
+      {
+         //Check the value of the parameter
+         if(value < HTTP2_DEFAULT_MAX_FRAME_SIZE || value > HTTP2_MAX_FRAME_SIZE)
+            return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+         //Save the new value
+         context->maxFrameSize = value;
+      }
+      //Other parameter?
+      else
+      {
+         //The server does not insert entries into the dynamic table of the
+         //client and never pushes, so that other parameters can be ignored
+      }
+   }
+
+   //The client settings have been received
+   context->settingsReceived = TRUE;
+
+   //Acknowledge the settings
+   return http2SendFrame(connection, HTTP2_FRAME_TYPE_SETTINGS, HTTP2_FLAG_ACK,
+      0, NULL, 0, HTTP_FLAG_NO_DELAY);
+}
+
+
+/**
+ * @brief Process WINDOW_UPDATE frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier
+ * @param[in] length Length of the frame payload
+ * @return Error code
+ **/
+
+error_t http2ProcessWindowUpdateFrame(HttpConnection *connection,
+   uint32_t streamId, size_t length)
+{
+   error_t error;
+   uint32_t increment;
+   uint8_t buffer[4];
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Check the length of the frame
+   if(length != 4)
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+   //Read the Window Size Increment field
+   error = http2ReadPayload(connection, buffer, 4);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The most significant bit is reserved
+   increment = LOAD32BE(buffer) & HTTP2_MAX_WINDOW_SIZE;
+
+   //Idle streams cannot receive WINDOW_UPDATE frames
+   if(streamId != 0 && http2IsIdleStream(connection, streamId))
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Connection-level flow control?
+   if(streamId == 0)
+   {
+      //An increment of 0 must be treated as a connection error
+      if(increment == 0)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //The window cannot exceed 2^31-1 bytes
+      if(context->connSendWindow > 0 &&
+         increment > (uint32_t) (HTTP2_MAX_WINDOW_SIZE - context->connSendWindow))
+      {
+         return http2ConnectionError(connection, HTTP2_ERROR_FLOW_CONTROL_ERROR);
+      }
+
+      //Update the connection-level send window
+      context->connSendWindow += (int32_t) increment;
+   }
+   //Stream-level flow control?
+   else if(streamId == context->streamId && !context->streamReset)
+   {
+      //Invalid increment?
+      if(increment == 0 || (context->streamSendWindow > 0 &&
+         increment > (uint32_t) (HTTP2_MAX_WINDOW_SIZE - context->streamSendWindow)))
+      {
+         //This is a stream error
+         context->streamReset = TRUE;
+
+         //Reset the stream
+         error = http2SendRstStream(connection, streamId, (increment == 0) ?
+            HTTP2_ERROR_PROTOCOL_ERROR : HTTP2_ERROR_FLOW_CONTROL_ERROR);
+      }
+      else
+      {
+         //Update the stream-level send window
+         context->streamSendWindow += (int32_t) increment;
+      }
+   }
+   //Pending stream?
+   else if((stream = http2FindStream(connection, streamId)) != NULL)
+   {
+      //Invalid increment?
+      if(increment == 0 || (stream->sendWindow > 0 &&
+         increment > (uint32_t) (HTTP2_MAX_WINDOW_SIZE - stream->sendWindow)))
+      {
+         //This is a stream error
+         stream->id = 0;
+
+         //Reset the stream
+         error = http2SendRstStream(connection, streamId, (increment == 0) ?
+            HTTP2_ERROR_PROTOCOL_ERROR : HTTP2_ERROR_FLOW_CONTROL_ERROR);
+      }
+      else
+      {
+         //Update the stream-level send window
+         stream->sendWindow += (int32_t) increment;
+      }
+   }
+   else
+   {
+      //WINDOW_UPDATE frames can be received for a short period after the
+      //response has been sent with the END_STREAM flag, and must then be
+      //ignored (refer to RFC 9113, section 5.1)
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Keep a new stream pending until the current one is complete
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier
+ * @param[in] length Length of the header block
+ * @param[in] endStream The header block ends the stream
+ * @return Error code
+ **/
+
+error_t http2QueueStream(HttpConnection *connection, uint32_t streamId,
+   size_t length, bool_t endStream)
+{
+   error_t error;
+   uint_t i;
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Initialize pointer
+   stream = NULL;
+
+   //The number of concurrent streams must not exceed the advertised limit
+   if(http2GetOpenStreams(connection) < HTTP_SERVER_HTTP2_MAX_STREAMS)
+   {
+      //Loop through the pending streams
+      for(i = 0; i < HTTP_SERVER_HTTP2_MAX_STREAMS; i++)
+      {
+         //Check whether the current entry is free
+         if(context->stream[i].id == 0)
+         {
+            stream = &context->stream[i];
+            break;
+         }
+      }
+   }
+
+   //Any entry available?
+   if(stream != NULL)
+   {
+      //Initialize stream state
+      stream->id = streamId;
+      stream->endStream = endStream;
+      stream->overflow = FALSE;
+      stream->sendWindow = context->initialWindowSize;
+      stream->windowConsumed = 0;
+      stream->headerLength = 0;
+      stream->bodyLength = 0;
+      stream->bodyPos = 0;
+
+      //Decode the request header and save the header fields
+      error = hpackDecodeHeaderBlock(&context->decoderTable,
+         context->headerBlock, length, context->field,
+         HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE, http2SaveHeaderField, stream);
+
+      //The request header does not fit in the buffer?
+      if(error || stream->overflow)
+      {
+         //Release the entry
+         stream->id = 0;
+         stream = NULL;
+      }
+   }
+   else
+   {
+      //The header block must be decoded to keep the dynamic table in sync
+      error = hpackDecodeHeaderBlock(&context->decoderTable,
+         context->headerBlock, length, context->field,
+         HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE, http2DiscardHeaderField, NULL);
+   }
+
+   //A decoding error is a connection error
+   if(error)
+      return http2ConnectionError(connection, HTTP2_ERROR_COMPRESSION_ERROR);
+
+   //The stream cannot be kept pending?
+   if(stream == NULL)
+   {
+      //Debug message
+      TRACE_INFO("Refusing HTTP/2 stream %" PRIu32 "...\r\n", streamId);
+
+      //The client can safely retry a refused stream since it has not
+      //been processed
+      return http2SendRstStream(connection, streamId,
+         HTTP2_ERROR_REFUSED_STREAM);
+   }
+
+   //Debug message
+   TRACE_INFO("HTTP/2 stream %" PRIu32 " is pending...\r\n", streamId);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Resume the oldest pending stream
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2ActivateStream(HttpConnection *connection)
+{
+   uint_t i;
+   size_t pos;
+   char_t *name;
+   char_t *value;
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Initialize pointer
+   stream = NULL;
+
+   //Streams are serviced in the order they have been opened
+   for(i = 0; i < HTTP_SERVER_HTTP2_MAX_STREAMS; i++)
+   {
+      //Pending stream?
+      if(context->stream[i].id != 0)
+      {
+         //Keep track of the lowest stream identifier
+         if(stream == NULL || context->stream[i].id < stream->id)
+            stream = &context->stream[i];
+      }
+   }
+
+   //No pending stream?
+   if(stream == NULL)
+      return NO_ERROR;
+
+   //Debug message
+   TRACE_INFO("Resuming HTTP/2 stream %" PRIu32 "...\r\n", stream->id);
+
+   //Clear request header
+   memset(&connection->request, 0, sizeof(HttpRequest));
+   //Clear response header
+   memset(&connection->response, 0, sizeof(HttpResponse));
+
+   //Clear pseudo-header fields
+   context->method[0] = '\0';
+   context->path[0] = '\0';
+   context->malformed = FALSE;
+
+   //Process the saved header fields
+   for(pos = 0; pos < stream->headerLength; )
+   {
+      //Point to the name of the header field
+      name = (char_t *) stream->buffer + pos;
+      pos += strlen(name) + 1;
+
+      //Point to the value of the header field
+      value = (char_t *) stream->buffer + pos;
+      pos += strlen(value) + 1;
+
+      //Parse the header field
+      http2ParseHeaderField(connection, name, value);
+   }
+
+   //Initialize stream state
+   context->streamId = stream->id;
+   context->endStream = stream->endStream;
+   context->streamReset = FALSE;
+   context->headersSent = FALSE;
+   context->streamClosed = FALSE;
+   context->streamSendWindow = stream->sendWindow;
+   context->dataRemaining = 0;
+
+   //The buffered part of the request body is read first
+   context->bufferedStream = stream;
+   //The request can be serviced
+   context->requestReady = TRUE;
+
+   //The stream-level receive window has not been replenished while the
+   //stream was pending
+   if(!stream->endStream && stream->windowConsumed > 0)
+   {
+      return http2SendWindowUpdate(connection, stream->id,
+         stream->windowConsumed);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the stream being serviced
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void http2ReleaseStream(HttpConnection *connection)
+{
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //The stream is now closed
+   context->streamId = 0;
+   context->dataRemaining = 0;
+
+   //Release the buffered request, if any
+   if(context->bufferedStream != NULL)
+   {
+      context->bufferedStream->id = 0;
+      context->bufferedStream = NULL;
+   }
+}
+
+
+/**
+ * @brief Search the pending streams for a given stream identifier
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier
+ * @return Pointer to the matching stream, if any
+ **/
+
+Http2Stream *http2FindStream(HttpConnection *connection, uint32_t streamId)
+{
+   uint_t i;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //The stream being serviced is not pending
+   if(streamId == 0 || streamId == context->streamId)
+      return NULL;
+
+   //Loop through the pending streams
+   for(i = 0; i < HTTP_SERVER_HTTP2_MAX_STREAMS; i++)
+   {
+      //Matching stream identifier?
+      if(context->stream[i].id == streamId)
+         return &context->stream[i];
+   }
+
+   //The stream is not pending
+   return NULL;
+}
+
+
+/**
+ * @brief Check whether a stream is in the idle state
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier
+ * @return TRUE if the stream has not been opened yet, else FALSE
+ **/
+
+bool_t http2IsIdleStream(HttpConnection *connection, uint32_t streamId)
+{
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //The server never pushes, so that streams with an even identifier are
+   //never opened. Clients open streams in increasing order
+   if((streamId & 1) == 0 || streamId > context->lastStreamId)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Get the number of open streams
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Number of streams that are serviced or pending
+ **/
+
+uint_t http2GetOpenStreams(HttpConnection *connection)
+{
+   uint_t i;
+   uint_t n;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Stream being serviced
+   n = (context->streamId != 0 || context->requestReady) ? 1 : 0;
+
+   //Loop through the pending streams
+   for(i = 0; i < HTTP_SERVER_HTTP2_MAX_STREAMS; i++)
+   {
+      //The entry of the stream being serviced is not counted twice
+      if(context->stream[i].id != 0 &&
+         &context->stream[i] != context->bufferedStream)
+      {
+         n++;
+      }
+   }
+
+   //Return the number of open streams
+   return n;
+}
+
+
+/**
+ * @brief Buffer the request body of a pending stream
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] stream Pointer to the pending stream
+ * @param[in] flags Frame flags
+ * @param[in] length Length of the frame payload
+ * @param[in] n Length of the data
+ * @param[in] padLength Length of the padding
+ * @return Error code
+ **/
+
+error_t http2BufferData(HttpConnection *connection, Http2Stream *stream,
+   uint8_t flags, size_t length, size_t n, uint8_t padLength)
+{
+   error_t error;
+   size_t offset;
+   uint32_t streamId;
+
+   //Offset where to append the data
+   offset = stream->headerLength + stream->bodyLength;
+
+   //Make sure the buffer is large enough
+   if((offset + n) <= HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE)
+   {
+      //Save the data
+      error = http2ReadPayload(connection, stream->buffer + offset, n);
+
+      //Check status code
+      if(!error)
+      {
+         //Discard padding
+         error = http2DiscardPayload(connection, padLength);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Update the length of the buffered request body
+         stream->bodyLength += n;
+         //Flow-controlled data are acknowledged once the stream is resumed
+         stream->windowConsumed += length;
+
+         //End of the request body?
+         if(flags & HTTP2_FLAG_END_STREAM)
+            stream->endStream = TRUE;
+      }
+   }
+   else
+   {
+      //Discard the data
+      error = http2DiscardPayload(connection, n + padLength);
+
+      //Check status code
+      if(!error)
+      {
+         //Save the stream identifier
+         streamId = stream->id;
+         //Release the entry
+         stream->id = 0;
+
+         //Debug message
+         TRACE_INFO("Refusing HTTP/2 stream %" PRIu32 "...\r\n", streamId);
+
+         //The client can safely retry a refused stream since it has not
+         //been processed
+         error = http2SendRstStream(connection, streamId,
+            HTTP2_ERROR_REFUSED_STREAM);
+      }
+   }
+
+   //The data count against the connection flow-control window, which
+   //must be replenished
+   if(!error && length > 0)
+      error = http2SendWindowUpdate(connection, 0, length);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a header field of the request
+ * @param[in] param Structure representing an HTTP connection
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field
+ **/
+
+void http2ParseHeaderField(void *param, char_t *name, char_t *value)
+{
+   HttpConnection *connection;
+   Http2Context *context;
+
+   //Point to the structure representing the HTTP connection
+   connection = (HttpConnection *) param;
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Debug message
+   TRACE_DEBUG("%s: %s\r\n", name, value);
+
+   //Pseudo-header field?
+   if(name[0] == ':')
+   {
+      //Check the name of the pseudo-header field
+      if(!strcmp(name, ":method"))
+      {
+         //Save the method
+         if(strSafeCopy(context->method, value, sizeof(context->method)))
+            context->malformed = TRUE;
+      }
+      else if(!strcmp(name, ":path"))
+      {
+         //Save the path and the query string
+         if(strSafeCopy(context->path, value, sizeof(context->path)))
+            context->malformed = TRUE;
+      }
+      else if(!strcmp(name, ":authority"))
+      {
+         //The :authority pseudo-header field replaces the Host field
+         httpParseHeaderField(connection, "Host", value);
+      }
+      else if(!strcmp(name, ":scheme"))
+      {
+         //The scheme is implied by the connection
+      }
+      else
+      {
+         //Undefined pseudo-header fields are not allowed
+         context->malformed = TRUE;
+      }
+   }
+   //Connection-specific header field?
+   else if(!strcmp(name, "connection") || !strcmp(name, "keep-alive") ||
+      !strcmp(name, "transfer-encoding") || !strcmp(name, "upgrade") ||
+      !strcmp(name, "proxy-connection"))
+   {
+      //HTTP/2 does not use such header fields
+   }
+#if (HTTP_SERVER_COOKIE_SUPPORT == ENABLED)
+   //Additional Cookie header field?
+   else if(!strcmp(name, "cookie") && connection->request.cookie[0] != '\0')
+   {
+      size_t n;
+
+      //The client may split the Cookie header field into several fields,
+      //which must be concatenated
+      n = strlen(connection->request.cookie);
+
+      //Make sure the buffer is large enough
+      if((n + strlen(value) + 2) <= HTTP_SERVER_COOKIE_MAX_LEN)
+      {
+         strcat(connection->request.cookie, "; ");
+         strcat(connection->request.cookie, value);
+      }
+   }
+#endif
+   //Regular header field?
+   else
+   {
+      //Parse HTTP header field
+      httpParseHeaderField(connection, name, value);
+   }
+}
+
+
+/**
+ * @brief Save a header field of a pending stream
+ * @param[in] param Pointer to the pending stream
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field
+ **/
+
+void http2SaveHeaderField(void *param, char_t *name, char_t *value)
+{
+   size_t m;
+   size_t n;
+   Http2Stream *stream;
+
+   //Point to the pending stream
+   stream = (Http2Stream *) param;
+
+   //Length of the name and the value, including the NULL terminators
+   m = strlen(name) + 1;
+   n = strlen(value) + 1;
+
+   //Make sure the buffer is large enough
+   if(!stream->overflow &&
+      (stream->headerLength + m + n) <= HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE)
+   {
+      //Save the header field
+      memcpy(stream->buffer + stream->headerLength, name, m);
+      memcpy(stream->buffer + stream->headerLength + m, value, n);
+
+      //Update the length of the header fields
+      stream->headerLength += m + n;
+   }
+   else
+   {
+      //The stream is refused
+      stream->overflow = TRUE;
+   }
+}
+
+
+/**
+ * @brief Discard a header field
+ * @param[in] param Unused parameter
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field
+ **/
+
+void http2DiscardHeaderField(void *param, char_t *name, char_t *value)
+{
+   //Debug message
+   TRACE_DEBUG("%s: %s (discarded)\r\n", name, value);
+}
+
+
+/**
+ * @brief Send the response header in a HEADERS frame
+ *
+ * The HTTP/1.1 header is formatted as usual, then each field is converted
+ * to an HPACK representation. Field names are lowercased and
+ * connection-specific fields are removed
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2WriteHeaders(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+   size_t m;
+   uint_t index;
+   char_t *p;
+   char_t *q;
+   char_t *name;
+   char_t *value;
+   char_t status[4];
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //The stream has been reset by the client?
+   if(context->streamReset)
+      return ERROR_CONNECTION_RESET;
+   //The response header has already been sent?
+   if(context->headersSent)
+      return ERROR_WRONG_STATE;
+
+   //The Content-Length field is emitted whenever the length of the body is
+   //known, since HTTP/2 has no notion of persistent connection
+   connection->response.version = HTTP_VERSION_1_1;
+   connection->response.keepAlive = TRUE;
+
+   //Format HTTP response header
+   error = httpFormatResponseHeader(connection, connection->buffer);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Debug message
+   TRACE_DEBUG("HTTP/2 response header:\r\n%s", connection->buffer);
+
+   //The status code is carried in the :status pseudo-header field
+   sprintf(status, "%03u", connection->response.statusCode % 1000);
+
+   //Common status codes are present in the static table
+   index = hpackFindStaticEntry(":status", status);
+
+   //Encode the :status pseudo-header field
+   if(index != 0)
+   {
+      n = hpackEncodeIndexedField(context->headerBlock,
+         HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE, index);
+   }
+   else
+   {
+      n = hpackEncodeLiteralField(context->headerBlock,
+         HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE, ":status", status);
+   }
+
+   //Skip the Status-Line
+   p = strstr(connection->buffer, "\r\n");
+
+   //Convert the header fields
+   while(p != NULL)
+   {
+      //Point to the next line
+      p += 2;
+
+      //An empty line indicates the end of the header fields
+      q = strstr(p, "\r\n");
+      if(q == NULL || q == p)
+         break;
+
+      //Split the lines
+      *q = '\0';
+
+      //Check whether a separator is present
+      value = strchr(p, ':');
+
+      //Separator found?
+      if(value != NULL)
+      {
+         //Split the name and the value
+         *value = '\0';
+
+         //Trim whitespace characters
+         name = strTrimWhitespace(p);
+         value = strTrimWhitespace(value + 1);
+
+         //Field names must be converted to lowercase
+         for(p = name; *p != '\0'; p++)
+         {
+            if(*p >= 'A' && *p <= 'Z')
+               *p += 'a' - 'A';
+         }
+
+         //Connection-specific header fields must not be sent
+         if(strcmp(name, "connection") && strcmp(name, "keep-alive") &&
+            strcmp(name, "transfer-encoding"))
+         {
+            //Encode the header field
+            m = hpackEncodeLiteralField(context->headerBlock + n,
+               HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE - n, name, value);
+
+            //The buffer is too small?
+            if(m == 0)
+               return ERROR_BUFFER_OVERFLOW;
+
+            //Update the length of the header block
+            n += m;
+         }
+      }
+
+      //Point to the end of the current line
+      p = q;
+   }
+
+   //Send the header block
+   error = http2SendFrame(connection, HTTP2_FRAME_TYPE_HEADERS,
+      HTTP2_FLAG_END_HEADERS, context->streamId, context->headerBlock, n,
+      HTTP_FLAG_DELAY);
+
+   //Check status code
+   if(!error)
+   {
+      //The response header has been sent
+      context->headersSent = TRUE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send part of the response body in DATA frames
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Pointer to the data to be sent
+ * @param[in] length Number of bytes to be sent
+ * @return Error code
+ **/
+
+error_t http2WriteData(HttpConnection *connection, const void *data, size_t length)
+{
+   error_t error;
+   size_t n;
+   const uint8_t *p;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Connection error?
+   if(context->errorCode != HTTP2_ERROR_NO_ERROR)
+      return ERROR_INVALID_PROTOCOL;
+
+   //The length of the body shall not exceed the value specified in
+   //the Content-Length field
+   if(!connection->response.chunkedEncoding)
+   {
+      length = MIN(length, connection->response.byteCount);
+      connection->response.byteCount -= length;
+   }
+
+   //Point to the data to be sent
+   p = data;
+
+   //Send as many DATA frames as necessary
+   while(length > 0)
+   {
+      //The stream has been reset by the client?
+      if(context->streamReset)
+         return ERROR_CONNECTION_RESET;
+
+      //The flow-control windows are exhausted?
+      if(context->connSendWindow <= 0 || context->streamSendWindow <= 0)
+      {
+         //Flush the frames that have been sent so far
+         error = httpSend(connection, "", 0, HTTP_FLAG_NO_DELAY);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Wait for a WINDOW_UPDATE frame from the client
+         error = http2ProcessFrame(connection, FALSE);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Check the windows again
+         continue;
+      }
+
+      //Limit the size of the frame
+      n = MIN(length, context->maxFrameSize);
+      n = MIN(n, (size_t) context->connSendWindow);
+      n = MIN(n, (size_t) context->streamSendWindow);
+
+      //Send a DATA frame
+      error = http2SendFrame(connection, HTTP2_FRAME_TYPE_DATA, 0,
+         context->streamId, p, n, HTTP_FLAG_DELAY);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Update the flow-control windows
+      context->connSendWindow -= (int32_t) n;
+      context->streamSendWindow -= (int32_t) n;
+
+      //Advance data pointer
+      p += n;
+      length -= n;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Terminate the response
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2CloseStream(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Connection error?
+   if(context->errorCode != HTTP2_ERROR_NO_ERROR)
+      return ERROR_INVALID_PROTOCOL;
+   //The stream has been reset by the client?
+   if(context->streamReset)
+      return ERROR_CONNECTION_RESET;
+   //The response has already been terminated?
+   if(context->streamClosed)
+      return NO_ERROR;
+
+   //An empty DATA frame with the END_STREAM flag set terminates the stream
+   error = http2SendFrame(connection, HTTP2_FRAME_TYPE_DATA,
+      HTTP2_FLAG_END_STREAM, context->streamId, NULL, 0, HTTP_FLAG_NO_DELAY);
+
+   //Check status code
+   if(!error)
+   {
+      //The whole response has been sent
+      context->streamClosed = TRUE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read the request body from DATA frames
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t http2ReadData(HttpConnection *connection,
+   void *data, size_t size, size_t *received, uint_t flags)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   char_t *p;
+   const uint8_t *q;
+   Http2Stream *stream;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+   //Point to the part of the request body received while the stream
+   //was pending, if any
+   stream = context->bufferedStream;
+
+   //Connection error?
+   if(context->errorCode != HTTP2_ERROR_NO_ERROR)
+      return ERROR_INVALID_PROTOCOL;
+
+   //Point to the output buffer
+   p = data;
+   //No data has been read yet
+   *received = 0;
+
+   //Read as much data as possible
+   while(*received < size)
+   {
+      //Any buffered data left?
+      if(stream != NULL && stream->bodyPos < stream->bodyLength)
+      {
+         //Point to the buffered data
+         q = stream->buffer + stream->headerLength + stream->bodyPos;
+         //Limit the number of bytes to read at a time
+         n = MIN(size - *received, stream->bodyLength - stream->bodyPos);
+
+         //Stop reading as soon as the break character is encountered
+         if(flags & HTTP_FLAG_BREAK_CRLF)
+         {
+            //Search the buffered data for the break character
+            for(i = 0; i < n; i++)
+            {
+               if(q[i] == LSB(flags))
+               {
+                  n = i + 1;
+                  break;
+               }
+            }
+         }
+
+         //Copy buffered data
+         memcpy(p, q, n);
+
+         //Total number of data that have been read
+         *received += n;
+         //Number of buffered bytes that have been consumed
+         stream->bodyPos += n;
+      }
+      //The current DATA frame has been completely consumed?
+      else if(context->dataRemaining == 0)
+      {
+         //End of the request body?
+         if(context->endStream || context->streamReset)
+            break;
+
+         //Wait for the next DATA frame
+         error = http2ProcessFrame(connection, TRUE);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Process the next frame, if any
+         continue;
+      }
+      else
+      {
+         //Limit the number of bytes to read at a time
+         n = MIN(size - *received, context->dataRemaining);
+
+         //Read data
+         error = httpReceive(connection, p, n, &n, flags);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Total number of data that have been read
+         *received += n;
+         //Number of bytes left to process in the current DATA frame
+         context->dataRemaining -= n;
+
+         //End of the DATA frame?
+         if(context->dataRemaining == 0)
+         {
+            //Discard padding and replenish the flow-control windows
+            error = http2EndDataFrame(connection);
+            //Any error to report?
+            if(error)
+               return error;
+         }
+      }
+
+      //The HTTP_FLAG_BREAK_CHAR flag causes the function to stop reading
+      //data as soon as the specified break character is encountered
+      if(flags & HTTP_FLAG_BREAK_CRLF)
+      {
+         //Check whether a break character has been received
+         if(p[n - 1] == LSB(flags))
+            break;
+      }
+      //The HTTP_FLAG_WAIT_ALL flag causes the function to return
+      //only when the requested number of bytes have been read
+      else if(!(flags & HTTP_FLAG_WAIT_ALL))
+      {
+         break;
+      }
+
+      //Advance data pointer
+      p += n;
+   }
+
+   //The stream has been reset by the client?
+   if(context->streamReset)
+      return ERROR_CONNECTION_RESET;
+
+   //The user must be satisfied with data already on hand
+   return (*received > 0) ? NO_ERROR : ERROR_END_OF_STREAM;
+}
+
+
+/**
+ * @brief Complete the processing of a DATA frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2EndDataFrame(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Discard padding
+   error = http2DiscardPayload(connection, context->dataPadding);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //End of the request body?
+   if(context->dataEndStream)
+      context->endStream = TRUE;
+
+   //Any flow-controlled data?
+   if(context->dataLength > 0)
+   {
+      //Replenish the connection-level receive window
+      error = http2SendWindowUpdate(connection, 0, context->dataLength);
+
+      //The stream-level window is replenished as long as the stream is open
+      if(!error && !context->endStream)
+      {
+         error = http2SendWindowUpdate(connection, context->streamId,
+            context->dataLength);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read a frame header
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] type Frame type
+ * @param[out] flags Frame flags
+ * @param[out] length Length of the frame payload
+ * @param[out] streamId Stream identifier
+ * @return Error code
+ **/
+
+error_t http2ReadFrameHeader(HttpConnection *connection, uint8_t *type,
+   uint8_t *flags, size_t *length, uint32_t *streamId)
+{
+   error_t error;
+   uint8_t header[HTTP2_FRAME_HEADER_SIZE];
+
+   //Read the frame header
+   error = http2ReadPayload(connection, header, HTTP2_FRAME_HEADER_SIZE);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The length is expressed as a 24-bit unsigned integer
+   *length = ((size_t) header[0] << 16) | ((size_t) header[1] << 8) | header[2];
+   //Retrieve frame type and flags
+   *type = header[3];
+   *flags = header[4];
+   //The most significant bit of the stream identifier is reserved
+   *streamId = LOAD32BE(header + 5) & 0x7FFFFFFF;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read part of a frame payload
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the data
+ * @param[in] length Number of bytes to read
+ * @return Error code
+ **/
+
+error_t http2ReadPayload(HttpConnection *connection, void *data, size_t length)
+{
+   error_t error;
+   size_t n;
+
+   //Nothing to read?
+   if(length == 0)
+      return NO_ERROR;
+
+   //Read the requested number of bytes
+   error = httpReceive(connection, data, length, &n, HTTP_FLAG_WAIT_ALL);
+
+   //The connection has been closed before the end of the frame?
+   if(!error && n != length)
+      error = ERROR_END_OF_STREAM;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Discard part of a frame payload
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] length Number of bytes to discard
+ * @return Error code
+ **/
+
+error_t http2DiscardPayload(HttpConnection *connection, size_t length)
+{
+   error_t error;
+   size_t n;
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Discard the data
+   while(length > 0 && !error)
+   {
+      //The field buffer is not in use between two header blocks
+      n = MIN(length, HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE);
+
+      //Read data
+      error = http2ReadPayload(connection, context->field, n);
+
+      //Number of bytes left to discard
+      length -= n;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send a frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] type Frame type
+ * @param[in] flags Frame flags
+ * @param[in] streamId Stream identifier
+ * @param[in] payload Pointer to the frame payload
+ * @param[in] length Length of the frame payload
+ * @param[in] httpFlags Set of flags that influences the behavior of httpSend()
+ * @return Error code
+ **/
+
+error_t http2SendFrame(HttpConnection *connection, uint8_t type, uint8_t flags,
+   uint32_t streamId, const void *payload, size_t length, uint_t httpFlags)
+{
+   error_t error;
+   uint8_t header[HTTP2_FRAME_HEADER_SIZE];
+
+   //Format the frame header
+   header[0] = (length >> 16) & 0xFF;
+   header[1] = (length >> 8) & 0xFF;
+   header[2] = length & 0xFF;
+   header[3] = type;
+   header[4] = flags;
+   STORE32BE(streamId & 0x7FFFFFFF, header + 5);
+
+   //Empty payload?
+   if(length == 0)
+   {
+      //Send the frame header
+      error = httpSend(connection, header, HTTP2_FRAME_HEADER_SIZE, httpFlags);
+   }
+   else
+   {
+      //Send the frame header
+      error = httpSend(connection, header, HTTP2_FRAME_HEADER_SIZE,
+         HTTP_FLAG_DELAY);
+
+      //Check status code
+      if(!error)
+      {
+         //Send the payload
+         error = httpSend(connection, payload, length, httpFlags);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send SETTINGS frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2SendSettings(HttpConnection *connection)
+{
+   uint8_t payload[12];
+
+   //Size of the HPACK dynamic table used to decode requests
+   STORE16BE(HTTP2_SETTINGS_HEADER_TABLE_SIZE, payload);
+   STORE32BE(HPACK_DYNAMIC_TABLE_SIZE, payload + 2);
+
+   //Maximum number of concurrent streams
+   STORE16BE(HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, payload + 6);
+   STORE32BE(HTTP_SERVER_HTTP2_MAX_STREAMS, payload + 8);
+
+   //The default values apply to the other parameters
+   return http2SendFrame(connection, HTTP2_FRAME_TYPE_SETTINGS, 0, 0,
+      payload, sizeof(payload), HTTP_FLAG_NO_DELAY);
+}
+
+
+/**
+ * @brief Send WINDOW_UPDATE frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier (0 for the connection)
+ * @param[in] increment Window size increment
+ * @return Error code
+ **/
+
+error_t http2SendWindowUpdate(HttpConnection *connection,
+   uint32_t streamId, uint32_t increment)
+{
+   uint8_t payload[4];
+
+   //Format the Window Size Increment field
+   STORE32BE(increment, payload);
+
+   //Send WINDOW_UPDATE frame
+   return http2SendFrame(connection, HTTP2_FRAME_TYPE_WINDOW_UPDATE, 0,
+      streamId, payload, sizeof(payload), HTTP_FLAG_NO_DELAY);
+}
+
+
+/**
+ * @brief Send RST_STREAM frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier
+ * @param[in] errorCode Reason for resetting the stream
+ * @return Error code
+ **/
+
+error_t http2SendRstStream(HttpConnection *connection,
+   uint32_t streamId, Http2ErrorCode errorCode)
+{
+   uint8_t payload[4];
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Debug message
+   TRACE_INFO("Resetting HTTP/2 stream %" PRIu32 " (error %u)...\r\n",
+      streamId, errorCode);
+
+   //Frames that are still in flight on this stream will be ignored
+   context->resetStreamId = streamId;
+
+   //Format the Error Code field
+   STORE32BE(errorCode, payload);
+
+   //Send RST_STREAM frame
+   return http2SendFrame(connection, HTTP2_FRAME_TYPE_RST_STREAM, 0,
+      streamId, payload, sizeof(payload), HTTP_FLAG_NO_DELAY);
+}
+
+
+/**
+ * @brief Send GOAWAY frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2SendGoAway(HttpConnection *connection)
+{
+   uint8_t payload[8];
+   Http2Context *context;
+
+   //Point to the HTTP/2 state
+   context = connection->http2Context;
+
+   //Last stream identifier that may have been processed
+   STORE32BE(context->lastStreamId, payload);
+   //Reason for closing the connection
+   STORE32BE(context->errorCode, payload + 4);
+
+   //Send GOAWAY frame
+   return http2SendFrame(connection, HTTP2_FRAME_TYPE_GOAWAY, 0, 0,
+      payload, sizeof(payload), HTTP_FLAG_NO_DELAY);
+}
+
+
+/**
+ * @brief Report a connection error
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] errorCode HTTP/2 error code to be sent in the GOAWAY frame
+ * @return Error code
+ **/
+
+error_t http2ConnectionError(HttpConnection *connection,
+   Http2ErrorCode errorCode)
+{
+   //Debug message
+   TRACE_WARNING("HTTP/2 connection error %u!\r\n", errorCode);
+
+   //Save the error code
+   connection->http2Context->errorCode = errorCode;
+
+   //The connection is closed after sending a GOAWAY frame
+   return ERROR_INVALID_PROTOCOL;
+}
+
+#endif
@@ -0,0 +1,272 @@
+/**
+ * @file http2_server.h
+ * @brief HTTP/2 server (connection management and framing)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _HTTP2_SERVER_H
+#define _HTTP2_SERVER_H
+
+//Dependencies
+#include "http/http_server.h"
+#include "http/hpack.h"
+
+//Size of the frame header
+#define HTTP2_FRAME_HEADER_SIZE 9
+//Default maximum size of a frame payload
+#define HTTP2_DEFAULT_MAX_FRAME_SIZE 16384
+//Largest frame payload size that can be advertised
+#define HTTP2_MAX_FRAME_SIZE 16777215
+//Initial flow-control window size
+#define HTTP2_DEFAULT_WINDOW_SIZE 65535
+//Maximum flow-control window size
+#define HTTP2_MAX_WINDOW_SIZE 0x7FFFFFFF
+
+//Client connection preface
+#define HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+//Length of the client connection preface
+#define HTTP2_PREFACE_SIZE 24
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Frame types
+ **/
+
+typedef enum
+{
+   HTTP2_FRAME_TYPE_DATA          = 0,
+   HTTP2_FRAME_TYPE_HEADERS       = 1,
+   HTTP2_FRAME_TYPE_PRIORITY      = 2,
+   HTTP2_FRAME_TYPE_RST_STREAM    = 3,
+   HTTP2_FRAME_TYPE_SETTINGS      = 4,
+   HTTP2_FRAME_TYPE_PUSH_PROMISE  = 5,
+   HTTP2_FRAME_TYPE_PING          = 6,
+   HTTP2_FRAME_TYPE_GOAWAY        = 7,
+   HTTP2_FRAME_TYPE_WINDOW_UPDATE = 8,
+   HTTP2_FRAME_TYPE_CONTINUATION  = 9
+} Http2FrameType;
+
+
+/**
+ * @brief Frame flags
+ **/
+
+typedef enum
+{
+   HTTP2_FLAG_END_STREAM  = 0x01,
+   HTTP2_FLAG_ACK         = 0x01,
+   HTTP2_FLAG_END_HEADERS = 0x04,
+   HTTP2_FLAG_PADDED      = 0x08,
+   HTTP2_FLAG_PRIORITY    = 0x20
+} Http2FrameFlags;
+
+
+/**
+ * @brief SETTINGS parameters
+ **/
+
+typedef enum
+{
+   HTTP2_SETTINGS_HEADER_TABLE_SIZE      = 1,
+   HTTP2_SETTINGS_ENABLE_PUSH            = 2,
+   HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS = 3,
+   HTTP2_SETTINGS_INITIAL_WINDOW_SIZE    = 4,
+   HTTP2_SETTINGS_MAX_FRAME_SIZE         = 5,
+   HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE   = 6
+} Http2SettingsParam;
+
+
+/**
+ * @brief Error codes
+ **/
+
+typedef enum
+{
+   HTTP2_ERROR_NO_ERROR            = 0,
+   HTTP2_ERROR_PROTOCOL_ERROR      = 1,
+   HTTP2_ERROR_INTERNAL_ERROR      = 2,
+   HTTP2_ERROR_FLOW_CONTROL_ERROR  = 3,
+   HTTP2_ERROR_SETTINGS_TIMEOUT    = 4,
+   HTTP2_ERROR_STREAM_CLOSED       = 5,
+   HTTP2_ERROR_FRAME_SIZE_ERROR    = 6,
+   HTTP2_ERROR_REFUSED_STREAM      = 7,
+   HTTP2_ERROR_CANCEL              = 8,
+   HTTP2_ERROR_COMPRESSION_ERROR   = 9,
+   HTTP2_ERROR_CONNECT_ERROR       = 10,
+   HTTP2_ERROR_ENHANCE_YOUR_CALM   = 11,
+   HTTP2_ERROR_INADEQUATE_SECURITY = 12,
+   HTTP2_ERROR_HTTP_1_1_REQUIRED   = 13
+} Http2ErrorCode;
+
+
+/**
+ * @brief Pending HTTP/2 stream
+ *
+ * The buffer holds the decoded header fields of the request, stored as
+ * NULL-terminated name/value pairs, followed by the part of the request
+ * body received so far
+ *
+ **/
+
+typedef struct
+{
+   uint32_t id;                                          ///<Stream identifier (0 if the entry is free)
+   bool_t endStream;                                     ///<The client has sent the whole request
+   bool_t overflow;                                      ///<The header fields do not fit in the buffer
+   int32_t sendWindow;                                   ///<Stream-level send window
+   uint32_t windowConsumed;                              ///<Flow-controlled bytes received on the stream
+   size_t headerLength;                                  ///<Length of the header fields
+   size_t bodyLength;                                    ///<Length of the buffered request body
+   size_t bodyPos;                                       ///<Number of buffered body bytes already read
+   uint8_t buffer[HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE]; ///<Header fields and request body
+} Http2Stream;
+
+
+/**
+ * @brief HTTP/2 connection state
+ *
+ * Streams are serviced one at a time by the connection task. A stream
+ * opened while another one is being serviced is kept pending, together
+ * with the beginning of its request body, and is serviced once the
+ * current response is complete. A stream whose request does not fit in
+ * the buffer is refused, which lets the client retry it later
+ *
+ **/
+
+struct _Http2Context
+{
+   HpackDynamicTable decoderTable;                                      ///<HPACK decoder state
+   Http2ErrorCode errorCode;                                            ///<Connection error, if any
+   bool_t settingsReceived;                                             ///<The client has sent its SETTINGS frame
+   bool_t goAway;                                                       ///<The client is shutting down the connection
+   uint32_t initialWindowSize;                                          ///<Initial stream window size of the client
+   uint32_t maxFrameSize;                                               ///<Largest frame payload accepted by the client
+   int32_t connSendWindow;                                              ///<Connection-level send window
+   uint32_t lastStreamId;                                               ///<Highest stream identifier opened by the client
+   uint32_t resetStreamId;                                              ///<Stream most recently reset by the server
+   uint32_t streamId;                                                   ///<Stream being serviced (0 if none)
+   bool_t requestReady;                                                 ///<A new request header has been received
+   bool_t malformed;                                                    ///<The request header is malformed
+   bool_t endStream;                                                    ///<The client has sent the whole request
+   bool_t streamReset;                                                  ///<The stream has been reset by the client
+   bool_t headersSent;                                                  ///<The response header has been sent
+   bool_t streamClosed;                                                 ///<The whole response has been sent
+   int32_t streamSendWindow;                                            ///<Stream-level send window
+   uint32_t dataRemaining;                                              ///<Number of body bytes left in the current DATA frame
+   uint32_t dataPadding;                                                ///<Padding that follows the body bytes
+   uint32_t dataLength;                                                 ///<Flow-controlled length of the current DATA frame
+   bool_t dataEndStream;                                                ///<The current DATA frame ends the stream
+   Http2Stream *bufferedStream;                                         ///<Buffered request of the stream being serviced
+   Http2Stream stream[HTTP_SERVER_HTTP2_MAX_STREAMS];                   ///<Pending streams
+   char_t method[HTTP_SERVER_METHOD_MAX_LEN + 1];                       ///<:method pseudo-header field
+   char_t path[HTTP_SERVER_URI_MAX_LEN + HTTP_SERVER_QUERY_STRING_MAX_LEN + 2]; ///<:path pseudo-header field
+   uint8_t headerBlock[HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE];            ///<Header block (request or response)
+   char_t field[HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE];                   ///<Decoded header field
+};
+
+
+//HTTP/2 server related functions
+bool_t http2CheckConnection(HttpConnection *connection);
+bool_t http2CheckUpgrade(HttpConnection *connection);
+
+error_t http2ServeConnection(HttpConnection *connection, bool_t upgrade);
+error_t http2ServeStream(HttpConnection *connection);
+error_t http2ParseRequest(HttpConnection *connection);
+
+error_t http2ProcessFrame(HttpConnection *connection, bool_t readData);
+
+error_t http2ProcessDataFrame(HttpConnection *connection, uint8_t flags,
+   uint32_t streamId, size_t length, bool_t readData);
+
+error_t http2ProcessHeadersFrame(HttpConnection *connection, uint8_t flags,
+   uint32_t streamId, size_t length);
+
+error_t http2ProcessSettingsFrame(HttpConnection *connection, uint8_t flags,
+   uint32_t streamId, size_t length);
+
+error_t http2ProcessWindowUpdateFrame(HttpConnection *connection,
+   uint32_t streamId, size_t length);
+
+error_t http2QueueStream(HttpConnection *connection, uint32_t streamId,
+   size_t length, bool_t endStream);
+
+error_t http2ActivateStream(HttpConnection *connection);
+void http2ReleaseStream(HttpConnection *connection);
+
+Http2Stream *http2FindStream(HttpConnection *connection, uint32_t streamId);
+bool_t http2IsIdleStream(HttpConnection *connection, uint32_t streamId);
+uint_t http2GetOpenStreams(HttpConnection *connection);
+
+error_t http2BufferData(HttpConnection *connection, Http2Stream *stream,
+   uint8_t flags, size_t length, size_t n, uint8_t padLength);
+
+void http2ParseHeaderField(void *param, char_t *name, char_t *value);
+void http2SaveHeaderField(void *param, char_t *name, char_t *value);
+void http2DiscardHeaderField(void *param, char_t *name, char_t *value);
+
+error_t http2WriteHeaders(HttpConnection *connection);
+error_t http2WriteData(HttpConnection *connection, const void *data, size_t length);
+error_t http2CloseStream(HttpConnection *connection);
+
+error_t http2ReadData(HttpConnection *connection,
+   void *data, size_t size, size_t *received, uint_t flags);
+
+error_t http2EndDataFrame(HttpConnection *connection);
+
+error_t http2ReadFrameHeader(HttpConnection *connection, uint8_t *type,
+   uint8_t *flags, size_t *length, uint32_t *streamId);
+
+error_t http2ReadPayload(HttpConnection *connection, void *data, size_t length);
+error_t http2DiscardPayload(HttpConnection *connection, size_t length);
+
+error_t http2SendFrame(HttpConnection *connection, uint8_t type, uint8_t flags,
+   uint32_t streamId, const void *payload, size_t length, uint_t httpFlags);
+
+error_t http2SendSettings(HttpConnection *connection);
+
+error_t http2SendWindowUpdate(HttpConnection *connection,
+   uint32_t streamId, uint32_t increment);
+
+error_t http2SendRstStream(HttpConnection *connection,
+   uint32_t streamId, Http2ErrorCode errorCode);
+
+error_t http2SendGoAway(HttpConnection *connection);
+
+error_t http2ConnectionError(HttpConnection *connection,
+   Http2ErrorCode errorCode);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
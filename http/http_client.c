@@ -1006,6 +1006,55 @@ error_t httpClientSetContentLength(HttpClientContext *context, size_t length)
 }
 
 
+/**
+ * @brief Request a byte range of the resource
+ *
+ * This function allows an interrupted download to be resumed from a given
+ * offset. If the server honors the request, the response carries a 206
+ * status code and the range actually sent can be retrieved with
+ * httpClientGetContentRange(). A server that ignores the Range field sends
+ * the whole resource with a 200 status code. An If-Range field may be added
+ * with httpClientAddHeaderField() so that the server sends the whole
+ * resource when the entity tag has changed
+ *
+ * @param[in] context Pointer to the HTTP client context
+ * @param[in] offset Position of the first byte to retrieve
+ * @param[in] length Number of bytes to retrieve (0 means up to the end
+ *   of the resource)
+ * @return Error code
+ **/
+
+error_t httpClientSetRange(HttpClientContext *context, size_t offset,
+   size_t length)
+{
+   char_t temp[30];
+
+   //Make sure the HTTP client context is valid
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check HTTP request state
+   if(context->requestState != HTTP_REQ_STATE_FORMAT_HEADER)
+      return ERROR_WRONG_STATE;
+
+   //Check whether the range is open-ended
+   if(length == 0)
+   {
+      //The range extends to the end of the resource
+      sprintf(temp, "bytes=%" PRIuSIZE "-", offset);
+   }
+   else
+   {
+      //Byte positions are inclusive
+      sprintf(temp, "bytes=%" PRIuSIZE "-%" PRIuSIZE, offset,
+         offset + length - 1);
+   }
+
+   //Add the Range header field
+   return httpClientAddHeaderField(context, "Range", temp);
+}
+
+
 /**
  * @brief Write HTTP request header
  * @param[in] context Pointer to the HTTP client context
@@ -1583,6 +1632,75 @@ const char_t *httpClientGetHeaderField(HttpClientContext *context,
 }
 
 
+/**
+ * @brief Retrieve the byte range carried by a 206 response
+ * @param[in] context Pointer to the HTTP client context
+ * @param[out] first Position of the first byte of the range
+ * @param[out] last Position of the last byte of the range
+ * @param[out] completeLength Length of the whole resource (0 if unknown)
+ * @return Error code
+ **/
+
+error_t httpClientGetContentRange(HttpClientContext *context,
+   size_t *first, size_t *last, size_t *completeLength)
+{
+   char_t *p;
+   const char_t *value;
+
+   //Check parameters
+   if(context == NULL || first == NULL || last == NULL ||
+      completeLength == NULL)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Only a partial response carries a byte range
+   if(context->statusCode != 206)
+      return ERROR_WRONG_STATE;
+
+   //Retrieve the value of the Content-Range header field
+   value = httpClientGetHeaderField(context, "Content-Range");
+   //Not found?
+   if(value == NULL)
+      return ERROR_INVALID_SYNTAX;
+
+   //The only range unit defined by HTTP/1.1 is bytes
+   if(strncasecmp(value, "bytes ", 6))
+      return ERROR_INVALID_SYNTAX;
+
+   //Get the first byte position
+   *first = strtoul(value + 6, &p, 10);
+   //Malformed field?
+   if(p == (value + 6) || *p != '-')
+      return ERROR_INVALID_SYNTAX;
+
+   //Get the last byte position
+   value = p + 1;
+   *last = strtoul(value, &p, 10);
+   //Malformed field?
+   if(p == value || *p != '/' || *last < *first)
+      return ERROR_INVALID_SYNTAX;
+
+   //The complete length may be unknown to the server
+   value = p + 1;
+   if(*value == '*')
+   {
+      *completeLength = 0;
+   }
+   else
+   {
+      //Get the length of the whole resource
+      *completeLength = strtoul(value, &p, 10);
+      //Malformed field?
+      if(p == value || *p != '\0')
+         return ERROR_INVALID_SYNTAX;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Iterate through the HTTP response header
  * @param[in] context Pointer to the HTTP client context
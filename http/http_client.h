@@ -348,6 +348,10 @@ error_t httpClientFormatHeaderField(HttpClientContext *context,
    const char_t *name, const char_t *format, ...);
 
 error_t httpClientSetContentLength(HttpClientContext *context, size_t length);
+
+error_t httpClientSetRange(HttpClientContext *context, size_t offset,
+   size_t length);
+
 error_t httpClientWriteHeader(HttpClientContext *context);
 
 error_t httpClientWriteBody(HttpClientContext *context, const void *data,
@@ -361,6 +365,9 @@ uint_t httpClientGetStatus(HttpClientContext *context);
 const char_t *httpClientGetHeaderField(HttpClientContext *context,
    const char_t *name);
 
+error_t httpClientGetContentRange(HttpClientContext *context,
+   size_t *first, size_t *last, size_t *completeLength);
+
 error_t httpClientGetNextHeaderField(HttpClientContext *context,
    const char_t **name, const char_t **value);
 
@@ -0,0 +1,501 @@
+/**
+ * @file http_client_pool.c
+ * @brief HTTP client connection pool
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "http/http_client.h"
+#include "http/http_client_pool.h"
+#include "http/http_client_misc.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_CLIENT_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Initialize connection pool
+ * @param[in] pool Pointer to the connection pool
+ * @return Error code
+ **/
+
+error_t httpClientPoolInit(HttpClientPool *pool)
+{
+   error_t error;
+   uint_t i;
+
+   //Make sure the connection pool is valid
+   if(pool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Clear connection pool
+   memset(pool, 0, sizeof(HttpClientPool));
+
+   //Default timeout
+   pool->timeout = HTTP_CLIENT_DEFAULT_TIMEOUT;
+
+   //Create a mutex to prevent simultaneous access to the pool
+   if(!osCreateMutex(&pool->mutex))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Initialize HTTP client contexts
+   for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+   {
+      //The TLS session state of each context is preserved across
+      //connections, so that sessions can be resumed
+      error = httpClientInit(&pool->entries[i].context);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+
+/**
+ * @brief Register TLS initialization callback function
+ * @param[in] pool Pointer to the connection pool
+ * @param[in] callback TLS initialization callback function
+ * @return Error code
+ **/
+
+error_t httpClientPoolRegisterTlsInitCallback(HttpClientPool *pool,
+   HttpClientTlsInitCallback callback)
+{
+   //Make sure the connection pool is valid
+   if(pool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save callback function
+   pool->tlsInitCallback = callback;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Set communication timeout for the connections of the pool
+ * @param[in] pool Pointer to the connection pool
+ * @param[in] timeout Timeout value, in milliseconds
+ * @return Error code
+ **/
+
+error_t httpClientPoolSetTimeout(HttpClientPool *pool, systime_t timeout)
+{
+   //Make sure the connection pool is valid
+   if(pool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save timeout value
+   pool->timeout = timeout;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get a connection to the specified HTTP server
+ *
+ * An idle persistent connection to the same server (IP address, port and
+ * TLS usage) is reused whenever possible. Idle connections that have been
+ * closed by the server, or that have been idle for too long, are discarded
+ * before reuse. Otherwise a new connection is established. The connection
+ * must be returned to the pool with httpClientPoolRelease() once the
+ * response has been read. Requests are not pipelined: a connection carries
+ * a single transaction at a time
+ *
+ * @param[in] pool Pointer to the connection pool
+ * @param[in] serverIpAddr IP address of the HTTP server to connect to
+ * @param[in] serverPort Port number
+ * @param[in] secure Use HTTP over TLS
+ * @param[out] context HTTP client context connected to the server
+ * @return Error code
+ **/
+
+error_t httpClientPoolAcquire(HttpClientPool *pool, const IpAddr *serverIpAddr,
+   uint16_t serverPort, bool_t secure, HttpClientContext **context)
+{
+   error_t error;
+   uint_t i;
+   systime_t time;
+   HttpClientPoolEntry *entry;
+   HttpClientPoolEntry *freeEntry;
+
+   //Check parameters
+   if(pool == NULL || serverIpAddr == NULL || context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+#if (HTTP_CLIENT_TLS_SUPPORT == DISABLED)
+   //HTTP over TLS is not supported
+   if(secure)
+      return ERROR_INVALID_PARAMETER;
+#endif
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&pool->mutex);
+
+   //Keep track of the entry to be used for a new connection
+   freeEntry = NULL;
+
+   //Loop through the connections
+   for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &pool->entries[i];
+
+      //Connections used by the application cannot be shared
+      if(entry->inUse)
+         continue;
+
+      //Idle persistent connection?
+      if(entry->context.state == HTTP_CLIENT_STATE_CONNECTED)
+      {
+         //Discard connections that have been idle for too long
+         if(timeCompare(time, entry->timestamp + HTTP_CLIENT_POOL_IDLE_TIMEOUT) >= 0)
+         {
+            //Close the connection
+            httpClientClose(&entry->context);
+         }
+         //Matching server?
+         else if(ipCompAddr(&entry->context.serverIpAddr, serverIpAddr) &&
+            entry->context.serverPort == serverPort && entry->secure == secure)
+         {
+            //Make sure the server has not closed the connection meanwhile
+            if(httpClientPoolCheckConnection(&entry->context))
+            {
+               //Reuse the connection
+               entry->inUse = TRUE;
+
+               //Update statistics
+               pool->stats.numRequests++;
+               pool->stats.numReused++;
+
+               //Release exclusive access to the pool
+               osReleaseMutex(&pool->mutex);
+
+               //Debug message
+               TRACE_DEBUG("HTTP client: reusing connection %u\r\n", i);
+
+               //Return the connection to the application
+               *context = &entry->context;
+               //Successful processing
+               return NO_ERROR;
+            }
+            else
+            {
+               //Update statistics
+               pool->stats.numStale++;
+
+               //Close the connection
+               httpClientClose(&entry->context);
+            }
+         }
+      }
+
+      //Free entries are preferred over idle connections to other servers
+      if(freeEntry == NULL)
+      {
+         freeEntry = entry;
+      }
+      else if(freeEntry->context.state == HTTP_CLIENT_STATE_CONNECTED)
+      {
+         //Keep track of the least recently used idle connection
+         if(entry->context.state != HTTP_CLIENT_STATE_CONNECTED ||
+            timeCompare(entry->timestamp, freeEntry->timestamp) < 0)
+         {
+            freeEntry = entry;
+         }
+      }
+   }
+
+   //Check whether a connection can be established
+   if(freeEntry != NULL)
+   {
+      //Evict the idle connection, if any
+      httpClientClose(&freeEntry->context);
+      //Reserve the entry
+      freeEntry->inUse = TRUE;
+      freeEntry->secure = secure;
+   }
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&pool->mutex);
+
+   //All the connections are currently in use?
+   if(freeEntry == NULL)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Point to the HTTP client context
+   entry = freeEntry;
+
+   //Set timeout value
+   httpClientSetTimeout(&entry->context, pool->timeout);
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   //HTTP over TLS is selected by registering the TLS initialization callback
+   httpClientRegisterTlsInitCallback(&entry->context,
+      secure ? pool->tlsInitCallback : NULL);
+#endif
+
+   //Save current time
+   time = osGetSystemTime();
+
+   //Establish a new connection with the HTTP server
+   error = httpClientConnect(&entry->context, serverIpAddr, serverPort);
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&pool->mutex);
+
+   //Check status code
+   if(!error)
+   {
+      //Update statistics
+      pool->stats.numRequests++;
+      pool->stats.numHandshakes++;
+      pool->stats.handshakeTime += osGetSystemTime() - time;
+
+      //Return the connection to the application
+      *context = &entry->context;
+   }
+   else
+   {
+      //Release the entry
+      entry->inUse = FALSE;
+   }
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&pool->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Return a connection to the pool
+ *
+ * The connection is kept open for subsequent requests if the last response
+ * has been entirely read and both parties agreed on a persistent connection.
+ * The trailer of a chunked response is consumed first, if necessary.
+ * Otherwise the connection is closed
+ *
+ * @param[in] pool Pointer to the connection pool
+ * @param[in] context HTTP client context obtained from httpClientPoolAcquire()
+ * @return Error code
+ **/
+
+error_t httpClientPoolRelease(HttpClientPool *pool, HttpClientContext *context)
+{
+   error_t error;
+   uint_t i;
+   HttpClientPoolEntry *entry;
+
+   //Check parameters
+   if(pool == NULL || context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The body of a chunked response has been read, but not its trailer?
+   if(context->state == HTTP_CLIENT_STATE_CONNECTED &&
+      (context->requestState == HTTP_REQ_STATE_RECEIVE_TRAILER ||
+      context->requestState == HTTP_REQ_STATE_PARSE_TRAILER))
+   {
+      //Consume the trailer up to the empty line that terminates it, so that
+      //the next response is not parsed from the middle of this one
+      error = httpClientCloseBody(context);
+
+      //The whole response has been received?
+      if(!error && context->state == HTTP_CLIENT_STATE_CONNECTED &&
+         context->requestState == HTTP_REQ_STATE_PARSE_TRAILER)
+      {
+         //The HTTP transaction is complete
+         httpClientChangeRequestState(context, HTTP_REQ_STATE_COMPLETE);
+      }
+   }
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&pool->mutex);
+
+   //Loop through the connections
+   for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &pool->entries[i];
+
+      //Matching HTTP client context?
+      if(&entry->context == context && entry->inUse)
+      {
+         //The connection can only be reused once the whole response has
+         //been consumed
+         if(context->state == HTTP_CLIENT_STATE_CONNECTED &&
+            context->keepAlive &&
+            (context->requestState == HTTP_REQ_STATE_INIT ||
+            context->requestState == HTTP_REQ_STATE_COMPLETE))
+         {
+            //Save the time at which the connection became idle
+            entry->timestamp = osGetSystemTime();
+         }
+         else
+         {
+            //Close the connection
+            httpClientClose(context);
+         }
+
+         //The connection is no longer used by the application
+         entry->inUse = FALSE;
+         break;
+      }
+   }
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&pool->mutex);
+
+   //Return status code
+   return (i < HTTP_CLIENT_POOL_SIZE) ? NO_ERROR : ERROR_INVALID_PARAMETER;
+}
+
+
+/**
+ * @brief Retrieve connection pool statistics
+ * @param[in] pool Pointer to the connection pool
+ * @param[out] stats Statistics, including the reuse ratio and an estimate of
+ *   the handshake time saved by reusing connections
+ * @return Error code
+ **/
+
+error_t httpClientPoolGetStats(HttpClientPool *pool, HttpClientPoolStats *stats)
+{
+   //Check parameters
+   if(pool == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&pool->mutex);
+
+   //Copy raw counters
+   *stats = pool->stats;
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&pool->mutex);
+
+   //Percentage of requests served by a reused connection
+   if(stats->numRequests > 0)
+      stats->reuseRatio = (stats->numReused * 100) / stats->numRequests;
+   else
+      stats->reuseRatio = 0;
+
+   //Each reuse saves the average handshake time
+   if(stats->numHandshakes > 0)
+      stats->timeSaved = (stats->handshakeTime / stats->numHandshakes) * stats->numReused;
+   else
+      stats->timeSaved = 0;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check whether an idle connection can be reused
+ *
+ * An idle persistent connection is not expected to receive any data. A
+ * readable socket means that the server has closed the connection (or sent
+ * unexpected data), in which case the connection must not be reused
+ *
+ * @param[in] context Pointer to the HTTP client context
+ * @return TRUE if the connection is still usable, else FALSE
+ **/
+
+bool_t httpClientPoolCheckConnection(HttpClientContext *context)
+{
+   error_t error;
+   SocketEventDesc eventDesc;
+
+   //Invalid socket?
+   if(context->socket == NULL)
+      return FALSE;
+
+   //Check the state of the socket without blocking
+   eventDesc.socket = context->socket;
+   eventDesc.eventMask = SOCKET_EVENT_RX_READY | SOCKET_EVENT_RX_SHUTDOWN |
+      SOCKET_EVENT_CLOSED;
+   eventDesc.eventFlags = 0;
+
+   //Poll the socket
+   error = socketPoll(&eventDesc, 1, NULL, 0);
+
+   //Any pending event?
+   if(!error && eventDesc.eventFlags != 0)
+      return FALSE;
+
+   //The connection is still usable
+   return TRUE;
+}
+
+
+/**
+ * @brief Release connection pool
+ * @param[in] pool Pointer to the connection pool
+ **/
+
+void httpClientPoolDeinit(HttpClientPool *pool)
+{
+   uint_t i;
+
+   //Make sure the connection pool is valid
+   if(pool != NULL)
+   {
+      //Release HTTP client contexts
+      for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+      {
+         httpClientDeinit(&pool->entries[i].context);
+      }
+
+      //Release previously allocated resources
+      osDeleteMutex(&pool->mutex);
+
+      //Clear connection pool
+      memset(pool, 0, sizeof(HttpClientPool));
+   }
+}
+
+#endif
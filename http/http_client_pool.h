@@ -0,0 +1,131 @@
+/**
+ * @file http_client_pool.h
+ * @brief HTTP client connection pool
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _HTTP_CLIENT_POOL_H
+#define _HTTP_CLIENT_POOL_H
+
+//Dependencies
+#include "core/net.h"
+#include "http/http_client.h"
+
+//Number of connections managed by the pool
+#ifndef HTTP_CLIENT_POOL_SIZE
+   #define HTTP_CLIENT_POOL_SIZE 2
+#elif (HTTP_CLIENT_POOL_SIZE < 1)
+   #error HTTP_CLIENT_POOL_SIZE parameter is not valid
+#endif
+
+//Maximum time an idle connection is kept open
+#ifndef HTTP_CLIENT_POOL_IDLE_TIMEOUT
+   #define HTTP_CLIENT_POOL_IDLE_TIMEOUT 30000
+#elif (HTTP_CLIENT_POOL_IDLE_TIMEOUT < 1000)
+   #error HTTP_CLIENT_POOL_IDLE_TIMEOUT parameter is not valid
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Connection pool entry
+ **/
+
+typedef struct
+{
+   HttpClientContext context; ///<HTTP client context
+   bool_t inUse;              ///<The connection is currently used by the application
+   bool_t secure;             ///<HTTP over TLS
+   systime_t timestamp;       ///<Time at which the connection became idle
+} HttpClientPoolEntry;
+
+
+/**
+ * @brief Connection pool statistics
+ **/
+
+typedef struct
+{
+   uint32_t numRequests;     ///<Number of connections handed out to the application
+   uint32_t numReused;       ///<Number of idle connections that have been reused
+   uint32_t numHandshakes;   ///<Number of connections that have been established
+   uint32_t numStale;        ///<Number of idle connections closed by the server
+   uint32_t handshakeTime;   ///<Cumulative time spent establishing connections, in ms
+   uint_t reuseRatio;        ///<Percentage of requests served by a reused connection
+   uint32_t timeSaved;       ///<Estimated handshake time saved by reuse, in ms
+} HttpClientPoolStats;
+
+
+/**
+ * @brief HTTP client connection pool
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                                    ///<Mutex preventing simultaneous access to the pool
+   systime_t timeout;                                ///<Timeout value
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   HttpClientTlsInitCallback tlsInitCallback;        ///<TLS initialization callback function
+#endif
+   HttpClientPoolEntry entries[HTTP_CLIENT_POOL_SIZE]; ///<Connections
+   HttpClientPoolStats stats;                        ///<Statistics
+} HttpClientPool;
+
+
+//HTTP client connection pool related functions
+error_t httpClientPoolInit(HttpClientPool *pool);
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+
+error_t httpClientPoolRegisterTlsInitCallback(HttpClientPool *pool,
+   HttpClientTlsInitCallback callback);
+
+#endif
+
+error_t httpClientPoolSetTimeout(HttpClientPool *pool, systime_t timeout);
+
+error_t httpClientPoolAcquire(HttpClientPool *pool, const IpAddr *serverIpAddr,
+   uint16_t serverPort, bool_t secure, HttpClientContext **context);
+
+error_t httpClientPoolRelease(HttpClientPool *pool, HttpClientContext *context);
+
+error_t httpClientPoolGetStats(HttpClientPool *pool, HttpClientPoolStats *stats);
+
+bool_t httpClientPoolCheckConnection(HttpClientContext *context);
+
+void httpClientPoolDeinit(HttpClientPool *pool);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -46,7 +46,9 @@
 #include "core/net.h"
 #include "http/http_server.h"
 #include "http/http_server_auth.h"
+#include "http/http_server_cache.h"
 #include "http/http_server_misc.h"
+#include "http/http2_server.h"
 #include "http/mime.h"
 #include "http/ssi.h"
 #include "debug.h"
@@ -150,6 +152,34 @@ error_t httpServerInit(HttpServerContext *context, const HttpServerSettings *set
          return ERROR_OUT_OF_RESOURCES;
    }
 
+#if (HTTP_SERVER_WORKER_POOL_SUPPORT == ENABLED)
+   //Create a mutex to protect the hand-over of connections to workers
+   if(!osCreateMutex(&context->poolMutex))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create an event object to wake up the dispatcher
+   if(!osCreateEvent(&context->event))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //The dispatcher polls every connection plus the listening socket
+   context->eventDesc = osAllocMem((context->settings.maxConnections + 1) *
+      sizeof(SocketEventDesc));
+   //Failed to allocate memory?
+   if(context->eventDesc == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Loop through worker tasks
+   for(i = 0; i < HTTP_SERVER_WORKER_COUNT; i++)
+   {
+      //Reference to the HTTP server context
+      context->workers[i].serverContext = context;
+
+      //Create an event object to wake up the worker
+      if(!osCreateEvent(&context->workers[i].event))
+         return ERROR_OUT_OF_RESOURCES;
+   }
+#endif
+
 #if (HTTP_SERVER_TLS_SUPPORT == ENABLED && TLS_TICKET_SUPPORT == ENABLED)
    //Initialize ticket encryption context
    error = tlsInitTicketContext(&context->tlsTicketContext);
@@ -164,6 +194,18 @@ error_t httpServerInit(HttpServerContext *context, const HttpServerSettings *set
       return ERROR_OUT_OF_RESOURCES;
 #endif
 
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   //Create a mutex to prevent simultaneous access to the resource cache
+   if(!osCreateMutex(&context->cacheMutex))
+      return ERROR_OUT_OF_RESOURCES;
+#endif
+
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED && HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+   //Create a mutex to prevent simultaneous access to the SSI cache
+   if(!osCreateMutex(&context->ssiCacheMutex))
+      return ERROR_OUT_OF_RESOURCES;
+#endif
+
    //Open a TCP socket
    context->socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_IP_PROTO_TCP);
    //Failed to open socket?
@@ -216,6 +258,24 @@ error_t httpServerStart(HttpServerContext *context)
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
+#if (HTTP_SERVER_WORKER_POOL_SUPPORT == ENABLED)
+   //Loop through worker tasks
+   for(i = 0; i < HTTP_SERVER_WORKER_COUNT; i++)
+   {
+      //Create a task to service requests on behalf of any connection
+      context->workers[i].taskHandle = osCreateTask("HTTP Worker",
+         httpWorkerTask, &context->workers[i], HTTP_SERVER_STACK_SIZE,
+         HTTP_SERVER_PRIORITY);
+
+      //Unable to create the task?
+      if(context->workers[i].taskHandle == OS_INVALID_HANDLE)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Create the HTTP server dispatcher task
+   context->taskHandle = osCreateTask("HTTP Dispatcher", httpDispatcherTask,
+      context, HTTP_SERVER_STACK_SIZE, HTTP_SERVER_PRIORITY);
+#else
    //Loop through client connections
    for(i = 0; i < context->settings.maxConnections; i++)
    {
@@ -232,6 +292,7 @@ error_t httpServerStart(HttpServerContext *context)
    //Create the HTTP server listener task
    context->taskHandle = osCreateTask("HTTP Listener", httpListenerTask,
       context, HTTP_SERVER_STACK_SIZE, HTTP_SERVER_PRIORITY);
+#endif
 
    //Unable to create the task?
    if(context->taskHandle == OS_INVALID_HANDLE)
@@ -301,319 +362,932 @@ void httpListenerTask(void *param)
                //Set timeout for blocking functions
                socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
 
+               //Flush the receive buffer
+               connection->rxBufferPos = 0;
+               connection->rxBufferLen = 0;
+
                //The client connection task is now running...
                connection->running = TRUE;
                //Service the current connection request
                osSetEvent(&connection->startEvent);
 
-               //We are done
+               //We are done
+               break;
+            }
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Task that services requests from an active connection
+ * @param[in] param Structure representing an HTTP connection with a client
+ **/
+
+void httpConnectionTask(void *param)
+{
+   error_t error;
+   uint_t counter;
+   HttpConnection *connection;
+
+   //Task prologue
+   osEnterTask();
+
+   //Point to the structure representing the HTTP connection
+   connection = (HttpConnection *) param;
+
+   //Endless loop
+   while(1)
+   {
+      //Wait for an incoming connection attempt
+      osWaitForEvent(&connection->startEvent, INFINITE_DELAY);
+
+      //Perform TLS related initialization, if necessary
+      error = httpStartConnection(connection);
+
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+      //HTTP/2 negotiated with ALPN or selected with prior knowledge?
+      if(!error && http2CheckConnection(connection))
+      {
+         //Service the streams of the HTTP/2 connection
+         http2ServeConnection(connection, FALSE);
+      }
+      else
+#endif
+      //Check status code
+      if(!error)
+      {
+         //Process incoming requests
+         for(counter = 0; counter < HTTP_SERVER_MAX_REQUESTS; counter++)
+         {
+            //Read the request and send the response
+            error = httpProcessRequest(connection);
+
+            //Internal error?
+            if(error)
+            {
+               //Close the connection immediately
+               break;
+            }
+
+            //Check whether the connection is persistent or not
+            if(!connection->request.keepAlive || !connection->response.keepAlive)
+            {
+               //Close the connection immediately
+               break;
+            }
+         }
+      }
+
+      //Close the connection
+      httpCloseConnection(connection);
+
+      //Ready to serve the next connection request...
+      connection->running = FALSE;
+      //Release semaphore
+      osReleaseSemaphore(&connection->serverContext->semaphore);
+   }
+}
+
+
+#if (HTTP_SERVER_WORKER_POOL_SUPPORT == ENABLED)
+
+/**
+ * @brief Dispatcher task (worker pool mode)
+ *
+ * The dispatcher accepts incoming connections and waits for idle keep-alive
+ * connections to become readable. The request header is accumulated by the
+ * dispatcher, and a connection is handed over to a worker task only once a
+ * complete request is available, so that idle or slow clients do not pin a
+ * task and its stack
+ *
+ * @param[in] param Pointer to the HTTP server context
+ **/
+
+void httpDispatcherTask(void *param)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   bool_t freeSlot;
+   systime_t time;
+   systime_t timeout;
+   systime_t elapsed;
+   HttpServerContext *context;
+   HttpConnection *connection;
+   SocketEventDesc *eventDesc;
+
+   //Task prologue
+   osEnterTask();
+
+   //Retrieve the HTTP server context
+   context = (HttpServerContext *) param;
+
+   //Point to the set of sockets to be polled
+   eventDesc = context->eventDesc;
+   //Number of client connections
+   n = context->settings.maxConnections;
+
+   //Process events
+   while(1)
+   {
+      //Get current time
+      time = osGetSystemTime();
+
+      //Wait for an event with no time limit by default
+      timeout = INFINITE_DELAY;
+      //Check whether a connection slot is available
+      freeSlot = FALSE;
+
+      //Clear event descriptor set
+      memset(eventDesc, 0, (n + 1) * sizeof(SocketEventDesc));
+
+      //Acquire exclusive access to the connection pool
+      osAcquireMutex(&context->poolMutex);
+
+      //Specify the events the dispatcher is interested in
+      for(i = 0; i < n; i++)
+      {
+         //Point to the current connection
+         connection = &context->connections[i];
+
+         //Check the state of the connection
+         if(connection->poolState == HTTP_POOL_STATE_CLOSED)
+         {
+            //The connection slot can be used to accept a new client
+            freeSlot = TRUE;
+         }
+         else if(connection->poolState == HTTP_POOL_STATE_IDLE)
+         {
+            //Time elapsed since the connection became idle
+            elapsed = time - connection->idleTimestamp;
+
+            //Check whether the keep-alive timer has elapsed
+            if(elapsed >= HTTP_SERVER_IDLE_TIMEOUT)
+            {
+               //The connection is to be closed by a worker task
+               connection->expired = TRUE;
+               connection->poolState = HTTP_POOL_STATE_READY;
+            }
+            //Pipelined request already in the receive buffer?
+            else if(connection->rxBufferPos < connection->rxBufferLen &&
+               httpCheckRequestHeader(connection))
+            {
+               //No need to poll the underlying socket for incoming traffic
+               connection->poolState = HTTP_POOL_STATE_READY;
+            }
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+            //Any data available in the receive buffer of the TLS context?
+            else if(connection->tlsContext != NULL &&
+               tlsIsRxReady(connection->tlsContext))
+            {
+               //No need to poll the underlying socket for incoming traffic
+               connection->poolState = HTTP_POOL_STATE_READY;
+            }
+#endif
+            else
+            {
+               //Wait for the next request
+               eventDesc[i].socket = connection->socket;
+               eventDesc[i].eventMask = SOCKET_EVENT_RX_READY;
+
+               //Adjust the polling timeout
+               timeout = MIN(timeout, HTTP_SERVER_IDLE_TIMEOUT - elapsed);
+            }
+         }
+         else
+         {
+            //The connection is waiting for a worker or is being serviced
+         }
+      }
+
+      //Do not accept any new connection until a slot becomes available
+      if(freeSlot)
+      {
+         //Wait for connection requests
+         eventDesc[n].socket = context->socket;
+         eventDesc[n].eventMask = SOCKET_EVENT_RX_READY;
+      }
+
+      //Hand over pending connections to idle worker tasks. Connections that
+      //cannot be dispatched yet will be when a worker signals the event
+      httpDispatchConnections(context);
+
+      //Release exclusive access to the connection pool
+      osReleaseMutex(&context->poolMutex);
+
+      //Wait for one of the set of sockets to become ready to perform I/O
+      error = socketPoll(eventDesc, n + 1, &context->event, timeout);
+
+      //Check status code
+      if(error == NO_ERROR || error == ERROR_TIMEOUT)
+      {
+         //Acquire exclusive access to the connection pool
+         osAcquireMutex(&context->poolMutex);
+
+         //Loop through the connection table
+         for(i = 0; i < n; i++)
+         {
+            //Point to the current connection
+            connection = &context->connections[i];
+
+            //Incoming data on an idle connection?
+            if(connection->poolState == HTTP_POOL_STATE_IDLE &&
+               eventDesc[i].eventFlags != 0)
+            {
+               //The request is serviced by a worker task once its header
+               //has been entirely received
+               if(httpPreReadRequest(connection))
+                  connection->poolState = HTTP_POOL_STATE_READY;
+            }
+         }
+
+         //Release exclusive access to the connection pool
+         osReleaseMutex(&context->poolMutex);
+
+         //Any connection request received?
+         if(eventDesc[n].eventFlags != 0)
+         {
+            //Accept connection request
+            httpAcceptConnection(context);
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Accept a connection request (worker pool mode)
+ * @param[in] context Pointer to the HTTP server context
+ **/
+
+void httpAcceptConnection(HttpServerContext *context)
+{
+   uint_t i;
+   uint16_t clientPort;
+   IpAddr clientIpAddr;
+   HttpConnection *connection;
+   Socket *socket;
+
+   //Accept incoming connection
+   socket = socketAccept(context->socket, &clientIpAddr, &clientPort);
+
+   //Make sure the socket handle is valid
+   if(socket != NULL)
+   {
+      //Acquire exclusive access to the connection pool
+      osAcquireMutex(&context->poolMutex);
+
+      //Loop through the connection table
+      for(i = 0; i < context->settings.maxConnections; i++)
+      {
+         //Point to the current connection
+         connection = &context->connections[i];
+
+         //Free connection slot?
+         if(connection->poolState == HTTP_POOL_STATE_CLOSED)
+            break;
+      }
+
+      //Any connection slot available?
+      if(i < context->settings.maxConnections)
+      {
+         //Debug message
+         TRACE_INFO("Connection established with client %s port %" PRIu16 "...\r\n",
+            ipAddrToString(&clientIpAddr, NULL), clientPort);
+
+         //Reference to the HTTP server settings
+         connection->settings = &context->settings;
+         //Reference to the HTTP server context
+         connection->serverContext = context;
+         //Reference to the new socket
+         connection->socket = socket;
+
+         //Set timeout for blocking functions
+         socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
+
+         //Flush the receive buffer
+         connection->rxBufferPos = 0;
+         connection->rxBufferLen = 0;
+
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+         //The TLS session is established by the worker task
+         connection->tlsContext = NULL;
+#endif
+         //The connection will be set up by the first worker task that
+         //services it
+         connection->started = FALSE;
+         connection->expired = FALSE;
+         connection->requestCount = 0;
+
+         //Wait for the first request
+         connection->idleTimestamp = osGetSystemTime();
+         connection->poolState = HTTP_POOL_STATE_IDLE;
+      }
+      else
+      {
+         //Debug message
+         TRACE_INFO("No connection slot available!\r\n");
+         //Close socket
+         socketClose(socket);
+      }
+
+      //Release exclusive access to the connection pool
+      osReleaseMutex(&context->poolMutex);
+   }
+}
+
+
+/**
+ * @brief Hand over pending connections to idle worker tasks
+ *
+ * The caller is responsible for holding the connection pool mutex
+ *
+ * @param[in] context Pointer to the HTTP server context
+ **/
+
+void httpDispatchConnections(HttpServerContext *context)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   HttpServerWorker *worker;
+   HttpConnection *connection;
+
+   //Number of client connections
+   n = context->settings.maxConnections;
+
+   //Loop through the worker tasks
+   for(i = 0; i < HTTP_SERVER_WORKER_COUNT; i++)
+   {
+      //Point to the current worker
+      worker = &context->workers[i];
+
+      //Skip busy workers
+      if(worker->connection != NULL)
+         continue;
+
+      //Connections are serviced in a round-robin fashion
+      for(j = 0; j < n; j++)
+      {
+         //Point to the next connection
+         connection = &context->connections[context->nextConnection];
+         //Advance the round-robin index
+         context->nextConnection = (context->nextConnection + 1) % n;
+
+         //Connection waiting for a worker task?
+         if(connection->poolState == HTTP_POOL_STATE_READY)
+         {
+            //The connection is now owned by the worker
+            connection->poolState = HTTP_POOL_STATE_BUSY;
+            worker->connection = connection;
+
+            //Wake up the worker task
+            osSetEvent(&worker->event);
+            break;
+         }
+      }
+
+      //No more pending connections?
+      if(j >= n)
+         break;
+   }
+}
+
+
+/**
+ * @brief Read the request header of an idle connection (worker pool mode)
+ *
+ * The header of a cleartext request is accumulated in the receive buffer by
+ * the dispatcher. Secure connections are handed over as soon as they become
+ * readable, since TLS records are decrypted by the worker task
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if the connection is ready to be serviced, else FALSE
+ **/
+
+bool_t httpPreReadRequest(HttpConnection *connection)
+{
+   error_t error;
+
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //TLS-secured connection?
+   if(connection->settings->tlsInitCallback != NULL)
+      return TRUE;
+#endif
+
+   //Discard the header of the previous request, but keep any pipelined data
+   httpCompactRxBuffer(connection);
+
+   //Requests that do not fit in the receive buffer are rejected by the
+   //worker task
+   if(connection->rxBufferLen >= HTTP_SERVER_RX_BUFFER_SIZE)
+      return TRUE;
+
+   //The socket is readable, so that this call does not block
+   error = httpReadRxBuffer(connection);
+
+   //The connection is closed by the worker task if an error occurred
+   if(error)
+      return TRUE;
+
+   //Check whether the request header is complete
+   return httpCheckRequestHeader(connection);
+}
+
+
+/**
+ * @brief Check whether the receive buffer holds a complete request header
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if the request header is complete, else FALSE
+ **/
+
+bool_t httpCheckRequestHeader(HttpConnection *connection)
+{
+   size_t i;
+   size_t n;
+   uint_t k;
+   const char_t *p;
+
+   //Point to the pending data
+   p = connection->rxBuffer + connection->rxBufferPos;
+   //Number of bytes available in the receive buffer
+   n = connection->rxBufferLen - connection->rxBufferPos;
+
+   //Requests that do not fit in the receive buffer are rejected by the
+   //worker task
+   if(n >= HTTP_SERVER_RX_BUFFER_SIZE)
+      return TRUE;
+
+   //Search for the end of the Request-Line
+   for(k = 0, i = 0; i < n && p[i] != '\n'; i++)
+   {
+      //Count the separators of the Request-Line
+      if(p[i] == ' ')
+         k++;
+   }
+
+   //Incomplete Request-Line?
+   if(i >= n)
+      return FALSE;
+
+   //A Simple-Request (HTTP 0.9) consists of the Request-Line only
+   if(k < 2)
+      return TRUE;
+
+   //Search for the empty line that terminates the header fields
+   for(i++; i < n; i++)
+   {
+      //Empty line found?
+      if(p[i] == '\n' && (p[i - 1] == '\n' ||
+         (p[i - 1] == '\r' && p[i - 2] == '\n')))
+      {
+         return TRUE;
+      }
+   }
+
+   //The request header is not complete yet
+   return FALSE;
+}
+
+
+/**
+ * @brief Worker task (worker pool mode)
+ * @param[in] param Pointer to the structure describing the worker
+ **/
+
+void httpWorkerTask(void *param)
+{
+   error_t error;
+   bool_t keepAlive;
+   HttpServerWorker *worker;
+   HttpConnection *connection;
+
+   //Task prologue
+   osEnterTask();
+
+   //Point to the structure describing the worker
+   worker = (HttpServerWorker *) param;
+
+   //Endless loop
+   while(1)
+   {
+      //Wait for a connection to be handed over by the dispatcher
+      osWaitForEvent(&worker->event, INFINITE_DELAY);
+
+      //Acquire exclusive access to the connection pool
+      osAcquireMutex(&worker->serverContext->poolMutex);
+      //Point to the connection to be serviced
+      connection = worker->connection;
+      //Release exclusive access to the connection pool
+      osReleaseMutex(&worker->serverContext->poolMutex);
+
+      //Spurious wake-up?
+      if(connection == NULL)
+         continue;
+
+      //The keep-alive timer has elapsed?
+      if(connection->expired)
+      {
+         //The client did not send any further request
+         error = ERROR_TIMEOUT;
+      }
+      else if(!connection->started)
+      {
+         //Perform TLS related initialization, if necessary
+         error = httpStartConnection(connection);
+         //The connection has been set up
+         connection->started = TRUE;
+      }
+      else
+      {
+         //Initialize status code
+         error = NO_ERROR;
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Read the request and send the response
+         error = httpProcessRequest(connection);
+         //Update the number of requests serviced on this connection
+         connection->requestCount++;
+      }
+
+      //Persistent connection?
+      if(!error && connection->request.keepAlive &&
+         connection->response.keepAlive &&
+         connection->requestCount < HTTP_SERVER_MAX_REQUESTS)
+      {
+         //Save the time at which the connection became idle
+         connection->idleTimestamp = osGetSystemTime();
+         //Keep the connection alive
+         keepAlive = TRUE;
+      }
+      else
+      {
+         //Close the connection
+         httpCloseConnection(connection);
+         //The connection slot can be reused
+         keepAlive = FALSE;
+      }
+
+      //Acquire exclusive access to the connection pool
+      osAcquireMutex(&worker->serverContext->poolMutex);
+
+      //Wait for the next request without holding the worker, or release
+      //the connection slot
+      if(keepAlive)
+         connection->poolState = HTTP_POOL_STATE_IDLE;
+      else
+         connection->poolState = HTTP_POOL_STATE_CLOSED;
+
+      //The worker is available again
+      worker->connection = NULL;
+
+      //Release exclusive access to the connection pool
+      osReleaseMutex(&worker->serverContext->poolMutex);
+      //Notify the dispatcher
+      osSetEvent(&worker->serverContext->event);
+   }
+}
+
+#endif
+
+
+/**
+ * @brief Set up a newly accepted connection
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpStartConnection(HttpConnection *connection)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //TLS-secured connection?
+   if(connection->settings->tlsInitCallback != NULL)
+   {
+      //Debug message
+      TRACE_INFO("Initializing TLS session...\r\n");
+
+      //Start of exception handling block
+      do
+      {
+         //Allocate TLS context
+         connection->tlsContext = tlsInit();
+         //Initialization failed?
+         if(connection->tlsContext == NULL)
+         {
+            //Report an error
+            error = ERROR_OUT_OF_MEMORY;
+            //Exit immediately
+            break;
+         }
+
+         //Select server operation mode
+         error = tlsSetConnectionEnd(connection->tlsContext,
+            TLS_CONNECTION_END_SERVER);
+         //Any error to report?
+         if(error)
+            break;
+
+         //Bind TLS to the relevant socket
+         error = tlsSetSocket(connection->tlsContext, connection->socket);
+         //Any error to report?
+         if(error)
+            break;
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+         //Enable session ticket mechanism
+         error = tlsSetTicketCallbacks(connection->tlsContext, tlsEncryptTicket,
+            tlsDecryptTicket, &connection->serverContext->tlsTicketContext);
+         //Any error to report?
+         if(error)
+            break;
+#endif
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED && TLS_ALPN_SUPPORT == ENABLED)
+         //Offer HTTP/2 to the client during the TLS handshake
+         error = tlsSetAlpnProtocolList(connection->tlsContext, "h2,http/1.1");
+         //Any error to report?
+         if(error)
+            break;
+#endif
+         //Invoke user-defined callback, if any
+         if(connection->settings->tlsInitCallback != NULL)
+         {
+            //Perform TLS related initialization
+            error = connection->settings->tlsInitCallback(connection,
+               connection->tlsContext);
+            //Any error to report?
+            if(error)
                break;
-            }
          }
-      }
+
+         //Establish a secure session
+         error = tlsConnect(connection->tlsContext);
+         //Any error to report?
+         if(error)
+            break;
+
+         //End of exception handling block
+      } while(0);
+   }
+   else
+   {
+      //Do not use TLS
+      connection->tlsContext = NULL;
    }
+#endif
+
+   //Return status code
+   return error;
 }
 
 
 /**
- * @brief Task that services requests from an active connection
- * @param[in] param Structure representing an HTTP connection with a client
+ * @brief Service a single request
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
  **/
 
-void httpConnectionTask(void *param)
+error_t httpProcessRequest(HttpConnection *connection)
 {
    error_t error;
-   uint_t counter;
-   HttpConnection *connection;
 
-   //Task prologue
-   osEnterTask();
+   //Debug message
+   TRACE_INFO("Waiting for request...\r\n");
 
-   //Point to the structure representing the HTTP connection
-   connection = (HttpConnection *) param;
+   //Clear request header
+   memset(&connection->request, 0, sizeof(HttpRequest));
+   //Clear response header
+   memset(&connection->response, 0, sizeof(HttpResponse));
 
-   //Endless loop
-   while(1)
+   //Read the HTTP request header and parse its contents
+   error = httpReadRequestHeader(connection);
+   //Any error to report?
+   if(error)
    {
-      //Wait for an incoming connection attempt
-      osWaitForEvent(&connection->startEvent, INFINITE_DELAY);
+      //Debug message
+      TRACE_INFO("No HTTP request received or parsing error...\r\n");
+      return error;
+   }
 
-      //Initialize status code
-      error = NO_ERROR;
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //The client asks to switch to HTTP/2 over cleartext TCP?
+   if(http2CheckUpgrade(connection))
+   {
+      //The request is serviced as stream 1 of the HTTP/2 connection
+      error = http2ServeConnection(connection, TRUE);
+      //The connection is closed once the HTTP/2 session is over
+      connection->response.keepAlive = FALSE;
+      //Return status code
+      return error;
+   }
+#endif
 
-#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
-      //TLS-secured connection?
-      if(connection->settings->tlsInitCallback != NULL)
-      {
-         //Debug message
-         TRACE_INFO("Initializing TLS session...\r\n");
+   //Process the request and send the response
+   return httpHandleRequest(connection);
+}
 
-         //Start of exception handling block
-         do
-         {
-            //Allocate TLS context
-            connection->tlsContext = tlsInit();
-            //Initialization failed?
-            if(connection->tlsContext == NULL)
-            {
-               //Report an error
-               error = ERROR_OUT_OF_MEMORY;
-               //Exit immediately
-               break;
-            }
 
-            //Select server operation mode
-            error = tlsSetConnectionEnd(connection->tlsContext,
-               TLS_CONNECTION_END_SERVER);
-            //Any error to report?
-            if(error)
-               break;
+/**
+ * @brief Process a request whose header has been parsed
+ *
+ * The request is authenticated and dispatched to the request callback, the
+ * SSI engine or the file system. The same code path serves HTTP/1.x
+ * requests and HTTP/2 streams
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
 
-            //Bind TLS to the relevant socket
-            error = tlsSetSocket(connection->tlsContext, connection->socket);
-            //Any error to report?
-            if(error)
-               break;
+error_t httpHandleRequest(HttpConnection *connection)
+{
+   error_t error;
 
-#if (TLS_TICKET_SUPPORT == ENABLED)
-            //Enable session ticket mechanism
-            error = tlsSetTicketCallbacks(connection->tlsContext, tlsEncryptTicket,
-               tlsDecryptTicket, &connection->serverContext->tlsTicketContext);
-            //Any error to report?
-            if(error)
-               break;
+   //Initialize status code
+   error = NO_ERROR;
+
+#if (HTTP_SERVER_BASIC_AUTH_SUPPORT == ENABLED || HTTP_SERVER_DIGEST_AUTH_SUPPORT == ENABLED)
+   //No Authorization header found?
+   if(!connection->request.auth.found)
+   {
+      //Invoke user-defined callback, if any
+      if(connection->settings->authCallback != NULL)
+      {
+         //Check whether the access to the specified URI is authorized
+         connection->status = connection->settings->authCallback(connection,
+            connection->request.auth.user, connection->request.uri);
+      }
+      else
+      {
+         //Access to the specified URI is allowed
+         connection->status = HTTP_ACCESS_ALLOWED;
+      }
+   }
+
+   //Check access status
+   if(connection->status == HTTP_ACCESS_ALLOWED)
+   {
+      //Access to the specified URI is allowed
+      error = NO_ERROR;
+   }
+   else if(connection->status == HTTP_ACCESS_BASIC_AUTH_REQUIRED)
+   {
+      //Basic access authentication is required
+      connection->response.auth.mode = HTTP_AUTH_MODE_BASIC;
+      //Report an error
+      error = ERROR_AUTH_REQUIRED;
+   }
+   else if(connection->status == HTTP_ACCESS_DIGEST_AUTH_REQUIRED)
+   {
+      //Digest access authentication is required
+      connection->response.auth.mode = HTTP_AUTH_MODE_DIGEST;
+      //Report an error
+      error = ERROR_AUTH_REQUIRED;
+   }
+   else
+   {
+      //Access to the specified URI is denied
+      error = ERROR_NOT_FOUND;
+   }
 #endif
-            //Invoke user-defined callback, if any
-            if(connection->settings->tlsInitCallback != NULL)
-            {
-               //Perform TLS related initialization
-               error = connection->settings->tlsInitCallback(connection,
-                  connection->tlsContext);
-               //Any error to report?
-               if(error)
-                  break;
-            }
+   //Debug message
+   TRACE_INFO("Sending HTTP response to the client...\r\n");
 
-            //Establish a secure session
-            error = tlsConnect(connection->tlsContext);
-            //Any error to report?
-            if(error)
-               break;
+   //Check status code
+   if(!error)
+   {
+      //Default HTTP header fields
+      httpInitResponseHeader(connection);
 
-            //End of exception handling block
-         } while(0);
+      //Invoke user-defined callback, if any
+      if(connection->settings->requestCallback != NULL)
+      {
+         error = connection->settings->requestCallback(connection,
+            connection->request.uri);
       }
       else
       {
-         //Do not use TLS
-         connection->tlsContext = NULL;
+         //Keep processing...
+         error = ERROR_NOT_FOUND;
       }
-#endif
 
       //Check status code
-      if(!error)
+      if(error == ERROR_NOT_FOUND)
       {
-         //Process incoming requests
-         for(counter = 0; counter < HTTP_SERVER_MAX_REQUESTS; counter++)
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+         //Use server-side scripting to dynamically generate HTML code?
+         if(httpCompExtension(connection->request.uri, ".stm") ||
+            httpCompExtension(connection->request.uri, ".shtm") ||
+            httpCompExtension(connection->request.uri, ".shtml"))
+         {
+            //SSI processing (Server Side Includes)
+            error = ssiExecuteScript(connection, connection->request.uri, 0);
+         }
+         else
+#endif
          {
-            //Debug message
-            TRACE_INFO("Waiting for request...\r\n");
+            //Set the maximum age for static resources
+            connection->response.maxAge = HTTP_SERVER_MAX_AGE;
 
-            //Clear request header
-            memset(&connection->request, 0, sizeof(HttpRequest));
-            //Clear response header
-            memset(&connection->response, 0, sizeof(HttpResponse));
+            //Send the contents of the requested page
+            error = httpSendResponse(connection, connection->request.uri);
+         }
+      }
 
-            //Read the HTTP request header and parse its contents
-            error = httpReadRequestHeader(connection);
-            //Any error to report?
-            if(error)
-            {
-               //Debug message
-               TRACE_INFO("No HTTP request received or parsing error...\r\n");
-               break;
-            }
+      //The requested resource is not available?
+      if(error == ERROR_NOT_FOUND)
+      {
+         //Default HTTP header fields
+         httpInitResponseHeader(connection);
 
-#if (HTTP_SERVER_BASIC_AUTH_SUPPORT == ENABLED || HTTP_SERVER_DIGEST_AUTH_SUPPORT == ENABLED)
-            //No Authorization header found?
-            if(!connection->request.auth.found)
-            {
-               //Invoke user-defined callback, if any
-               if(connection->settings->authCallback != NULL)
-               {
-                  //Check whether the access to the specified URI is authorized
-                  connection->status = connection->settings->authCallback(connection,
-                     connection->request.auth.user, connection->request.uri);
-               }
-               else
-               {
-                  //Access to the specified URI is allowed
-                  connection->status = HTTP_ACCESS_ALLOWED;
-               }
-            }
+         //Invoke user-defined callback, if any
+         if(connection->settings->uriNotFoundCallback != NULL)
+         {
+            error = connection->settings->uriNotFoundCallback(connection,
+               connection->request.uri);
+         }
+      }
+   }
 
-            //Check access status
-            if(connection->status == HTTP_ACCESS_ALLOWED)
-            {
-               //Access to the specified URI is allowed
-               error = NO_ERROR;
-            }
-            else if(connection->status == HTTP_ACCESS_BASIC_AUTH_REQUIRED)
-            {
-               //Basic access authentication is required
-               connection->response.auth.mode = HTTP_AUTH_MODE_BASIC;
-               //Report an error
-               error = ERROR_AUTH_REQUIRED;
-            }
-            else if(connection->status == HTTP_ACCESS_DIGEST_AUTH_REQUIRED)
-            {
-               //Digest access authentication is required
-               connection->response.auth.mode = HTTP_AUTH_MODE_DIGEST;
-               //Report an error
-               error = ERROR_AUTH_REQUIRED;
-            }
-            else
-            {
-               //Access to the specified URI is denied
-               error = ERROR_NOT_FOUND;
-            }
-#endif
-            //Debug message
-            TRACE_INFO("Sending HTTP response to the client...\r\n");
+   //Check status code
+   if(error)
+   {
+      //Default HTTP header fields
+      httpInitResponseHeader(connection);
 
-            //Check status code
-            if(!error)
-            {
-               //Default HTTP header fields
-               httpInitResponseHeader(connection);
-
-               //Invoke user-defined callback, if any
-               if(connection->settings->requestCallback != NULL)
-               {
-                  error = connection->settings->requestCallback(connection,
-                     connection->request.uri);
-               }
-               else
-               {
-                  //Keep processing...
-                  error = ERROR_NOT_FOUND;
-               }
-
-               //Check status code
-               if(error == ERROR_NOT_FOUND)
-               {
-#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
-                  //Use server-side scripting to dynamically generate HTML code?
-                  if(httpCompExtension(connection->request.uri, ".stm") ||
-                     httpCompExtension(connection->request.uri, ".shtm") ||
-                     httpCompExtension(connection->request.uri, ".shtml"))
-                  {
-                     //SSI processing (Server Side Includes)
-                     error = ssiExecuteScript(connection, connection->request.uri, 0);
-                  }
-                  else
-#endif
-                  {
-                     //Set the maximum age for static resources
-                     connection->response.maxAge = HTTP_SERVER_MAX_AGE;
-
-                     //Send the contents of the requested page
-                     error = httpSendResponse(connection, connection->request.uri);
-                  }
-               }
-
-               //The requested resource is not available?
-               if(error == ERROR_NOT_FOUND)
-               {
-                  //Default HTTP header fields
-                  httpInitResponseHeader(connection);
-
-                  //Invoke user-defined callback, if any
-                  if(connection->settings->uriNotFoundCallback != NULL)
-                  {
-                     error = connection->settings->uriNotFoundCallback(connection,
-                        connection->request.uri);
-                  }
-               }
-            }
+      //Bad request?
+      if(error == ERROR_INVALID_REQUEST)
+      {
+         //Send an error 400 and close the connection immediately
+         httpSendErrorResponse(connection, 400,
+            "The request is badly formed");
+      }
+      //Authorization required?
+      else if(error == ERROR_AUTH_REQUIRED)
+      {
+         //Send an error 401 and keep the connection alive
+         error = httpSendErrorResponse(connection, 401,
+            "Authorization required");
+      }
+      //Page not found?
+      else if(error == ERROR_NOT_FOUND)
+      {
+         //Send an error 404 and keep the connection alive
+         error = httpSendErrorResponse(connection, 404,
+            "The requested page could not be found");
+      }
+   }
 
-            //Check status code
-            if(error)
-            {
-               //Default HTTP header fields
-               httpInitResponseHeader(connection);
-
-               //Bad request?
-               if(error == ERROR_INVALID_REQUEST)
-               {
-                  //Send an error 400 and close the connection immediately
-                  httpSendErrorResponse(connection, 400,
-                     "The request is badly formed");
-               }
-               //Authorization required?
-               else if(error == ERROR_AUTH_REQUIRED)
-               {
-                  //Send an error 401 and keep the connection alive
-                  error = httpSendErrorResponse(connection, 401,
-                     "Authorization required");
-               }
-               //Page not found?
-               else if(error == ERROR_NOT_FOUND)
-               {
-                  //Send an error 404 and keep the connection alive
-                  error = httpSendErrorResponse(connection, 404,
-                     "The requested page could not be found");
-               }
-            }
+   //Return status code
+   return error;
+}
 
-            //Internal error?
-            if(error)
-            {
-               //Close the connection immediately
-               break;
-            }
 
-            //Check whether the connection is persistent or not
-            if(!connection->request.keepAlive || !connection->response.keepAlive)
-            {
-               //Close the connection immediately
-               break;
-            }
-         }
-      }
+/**
+ * @brief Close a connection
+ * @param[in] connection Structure representing an HTTP connection
+ **/
 
+void httpCloseConnection(HttpConnection *connection)
+{
 #if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
-      //Valid TLS context?
-      if(connection->tlsContext != NULL)
-      {
-         //Debug message
-         TRACE_INFO("Closing TLS session...\r\n");
-
-         //Gracefully close TLS session
-         tlsShutdown(connection->tlsContext);
-         //Release context
-         tlsFree(connection->tlsContext);
-      }
+   //Valid TLS context?
+   if(connection->tlsContext != NULL)
+   {
+      //Debug message
+      TRACE_INFO("Closing TLS session...\r\n");
+
+      //Gracefully close TLS session
+      tlsShutdown(connection->tlsContext);
+      //Release context
+      tlsFree(connection->tlsContext);
+      //Mark the TLS context as closed
+      connection->tlsContext = NULL;
+   }
 #endif
 
-      //Valid socket handle?
-      if(connection->socket != NULL)
-      {
-         //Debug message
-         TRACE_INFO("Graceful shutdown...\r\n");
-         //Graceful shutdown
-         socketShutdown(connection->socket, SOCKET_SD_BOTH);
-
-         //Debug message
-         TRACE_INFO("Closing socket...\r\n");
-         //Close socket
-         socketClose(connection->socket);
-      }
+   //Valid socket handle?
+   if(connection->socket != NULL)
+   {
+      //Debug message
+      TRACE_INFO("Graceful shutdown...\r\n");
+      //Graceful shutdown
+      socketShutdown(connection->socket, SOCKET_SD_BOTH);
 
-      //Ready to serve the next connection request...
-      connection->running = FALSE;
-      //Release semaphore
-      osReleaseSemaphore(&connection->serverContext->semaphore);
+      //Debug message
+      TRACE_INFO("Closing socket...\r\n");
+      //Close socket
+      socketClose(connection->socket);
+      //Mark the socket as closed
+      connection->socket = NULL;
    }
 }
 
@@ -628,6 +1302,15 @@ error_t httpWriteHeader(HttpConnection *connection)
 {
    error_t error;
 
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2Context != NULL)
+   {
+      //Send the response header in a HEADERS frame
+      return http2WriteHeaders(connection);
+   }
+#endif
+
    //Format HTTP response header
    error = httpFormatResponseHeader(connection, connection->buffer);
 
@@ -666,6 +1349,15 @@ error_t httpReadStream(HttpConnection *connection,
    //No data has been read yet
    *received = 0;
 
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2Context != NULL)
+   {
+      //The request body is carried in DATA frames
+      return http2ReadData(connection, data, size, received, flags);
+   }
+#endif
+
    //Chunked encoding transfer is used?
    if(connection->request.chunkedEncoding)
    {
@@ -769,6 +1461,15 @@ error_t httpWriteStream(HttpConnection *connection,
    error_t error;
    uint_t n;
 
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2Context != NULL)
+   {
+      //The response body is carried in DATA frames
+      return http2WriteData(connection, data, length);
+   }
+#endif
+
    //Use chunked encoding transfer?
    if(connection->response.chunkedEncoding)
    {
@@ -832,6 +1533,15 @@ error_t httpCloseStream(HttpConnection *connection)
 {
    error_t error;
 
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2Context != NULL)
+   {
+      //Half-close the stream
+      return http2CloseStream(connection);
+   }
+#endif
+
    //Use chunked encoding transfer?
    if(connection->response.chunkedEncoding)
    {
@@ -858,12 +1568,26 @@ error_t httpCloseStream(HttpConnection *connection)
 
 error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
 {
-#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
    error_t error;
+   size_t offset;
+   size_t count;
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
    size_t n;
    uint32_t length;
    FsFile *file;
+#else
+   size_t length;
+   const uint8_t *data;
+#endif
+
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   //Serve the resource through the static resource cache, provided
+   //that the URI fits in a cache entry
+   if(strlen(uri) <= HTTP_SERVER_URI_MAX_LEN)
+      return httpCacheSendResponse(connection, uri);
+#endif
 
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
    //Retrieve the full pathname
    httpGetAbsolutePath(connection, uri, connection->buffer,
       HTTP_SERVER_BUFFER_SIZE);
@@ -923,10 +1647,6 @@ error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
    if(file == NULL)
       return ERROR_NOT_FOUND;
 #else
-   error_t error;
-   size_t length;
-   const uint8_t *data;
-
    //Retrieve the full pathname
    httpGetAbsolutePath(connection, uri, connection->buffer,
       HTTP_SERVER_BUFFER_SIZE);
@@ -987,7 +1707,29 @@ error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
    connection->response.statusCode = 200;
    connection->response.contentType = mimeGetType(uri);
    connection->response.chunkedEncoding = FALSE;
-   connection->response.contentLength = length;
+
+   //Select the portion of the resource to be sent
+   httpSelectRange(connection, length, &offset, &count);
+   //Set the length of the response body
+   connection->response.contentLength = count;
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //Skip the bytes that precede the selected range
+   if(offset > 0)
+   {
+      //Move the file pointer to the first byte of the range
+      error = fsSeekFile(file, offset, FS_SEEK_SET);
+
+      //Any error to report?
+      if(error)
+      {
+         //Close the file
+         fsCloseFile(file);
+         //Return status code
+         return error;
+      }
+   }
+#endif
 
    //Send the header to the client
    error = httpWriteHeader(connection);
@@ -1004,10 +1746,10 @@ error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
 
 #if (HTTP_SERVER_FS_SUPPORT == ENABLED)
    //Send response body
-   while(length > 0)
+   while(count > 0)
    {
       //Limit the number of bytes to read at a time
-      n = MIN(length, HTTP_SERVER_BUFFER_SIZE);
+      n = MIN(count, HTTP_SERVER_BUFFER_SIZE);
 
       //Read data from the specified file
       error = fsReadFile(file, connection->buffer, n, &n);
@@ -1022,7 +1764,7 @@ error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
          break;
 
       //Decrement the count of remaining bytes to be transferred
-      length -= n;
+      count -= n;
    }
 
    //Close the file
@@ -1031,7 +1773,7 @@ error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
    //Successful file transfer?
    if(error == NO_ERROR || error == ERROR_END_OF_FILE)
    {
-      if(length == 0)
+      if(count == 0)
       {
          //Properly close the output stream
          error = httpCloseStream(connection);
@@ -1039,7 +1781,7 @@ error_t httpSendResponse(HttpConnection *connection, const char_t *uri)
    }
 #else
    //Send response body
-   error = httpWriteStream(connection, data, length);
+   error = httpWriteStream(connection, data + offset, count);
    //Any error to report?
    if(error)
       return error;
@@ -1266,8 +2008,21 @@ WebSocket *httpUpgradeToWebSocket(HttpConnection *connection)
    {
       error_t error;
 
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+      //Negotiate the extensions requested by the client
+      error = webSocketSetClientExtensions(webSocket,
+         connection->request.webSocketExtensions);
+
+      //Check status code
+      if(!error)
+      {
+         //Copy client's key
+         error = webSocketSetClientKey(webSocket, connection->request.clientKey);
+      }
+#else
       //Copy client's key
       error = webSocketSetClientKey(webSocket, connection->request.clientKey);
+#endif
 
       //Check status code
       if(!error)
@@ -65,6 +65,13 @@
    #error HTTP_SERVER_SSI_SUPPORT parameter is not valid
 #endif
 
+//Compiled SSI script cache support
+#ifndef HTTP_SERVER_SSI_CACHE_SUPPORT
+   #define HTTP_SERVER_SSI_CACHE_SUPPORT DISABLED
+#elif (HTTP_SERVER_SSI_CACHE_SUPPORT != ENABLED && HTTP_SERVER_SSI_CACHE_SUPPORT != DISABLED)
+   #error HTTP_SERVER_SSI_CACHE_SUPPORT parameter is not valid
+#endif
+
 //HTTP over TLS
 #ifndef HTTP_SERVER_TLS_SUPPORT
    #define HTTP_SERVER_TLS_SUPPORT DISABLED
@@ -114,6 +121,34 @@
    #error HTTP_SERVER_COOKIE_SUPPORT parameter is not valid
 #endif
 
+//Event-driven mode served by a pool of worker tasks
+#ifndef HTTP_SERVER_WORKER_POOL_SUPPORT
+   #define HTTP_SERVER_WORKER_POOL_SUPPORT DISABLED
+#elif (HTTP_SERVER_WORKER_POOL_SUPPORT != ENABLED && HTTP_SERVER_WORKER_POOL_SUPPORT != DISABLED)
+   #error HTTP_SERVER_WORKER_POOL_SUPPORT parameter is not valid
+#endif
+
+//Static resource cache support
+#ifndef HTTP_SERVER_CACHE_SUPPORT
+   #define HTTP_SERVER_CACHE_SUPPORT DISABLED
+#elif (HTTP_SERVER_CACHE_SUPPORT != ENABLED && HTTP_SERVER_CACHE_SUPPORT != DISABLED)
+   #error HTTP_SERVER_CACHE_SUPPORT parameter is not valid
+#endif
+
+//Byte-range requests support
+#ifndef HTTP_SERVER_RANGE_SUPPORT
+   #define HTTP_SERVER_RANGE_SUPPORT DISABLED
+#elif (HTTP_SERVER_RANGE_SUPPORT != ENABLED && HTTP_SERVER_RANGE_SUPPORT != DISABLED)
+   #error HTTP_SERVER_RANGE_SUPPORT parameter is not valid
+#endif
+
+//HTTP/2 support
+#ifndef HTTP_SERVER_HTTP2_SUPPORT
+   #define HTTP_SERVER_HTTP2_SUPPORT DISABLED
+#elif (HTTP_SERVER_HTTP2_SUPPORT != ENABLED && HTTP_SERVER_HTTP2_SUPPORT != DISABLED)
+   #error HTTP_SERVER_HTTP2_SUPPORT parameter is not valid
+#endif
+
 //Stack size required to run the HTTP server
 #ifndef HTTP_SERVER_STACK_SIZE
    #define HTTP_SERVER_STACK_SIZE 650
@@ -126,6 +161,13 @@
    #define HTTP_SERVER_PRIORITY OS_TASK_PRIORITY_NORMAL
 #endif
 
+//Number of worker tasks (worker pool mode)
+#ifndef HTTP_SERVER_WORKER_COUNT
+   #define HTTP_SERVER_WORKER_COUNT 2
+#elif (HTTP_SERVER_WORKER_COUNT < 1)
+   #error HTTP_SERVER_WORKER_COUNT parameter is not valid
+#endif
+
 //HTTP connection timeout
 #ifndef HTTP_SERVER_TIMEOUT
    #define HTTP_SERVER_TIMEOUT 10000
@@ -162,6 +204,13 @@
    #error HTTP_SERVER_BUFFER_SIZE parameter is not valid
 #endif
 
+//Size of the receive buffer used to parse request headers
+#ifndef HTTP_SERVER_RX_BUFFER_SIZE
+   #define HTTP_SERVER_RX_BUFFER_SIZE 1024
+#elif (HTTP_SERVER_RX_BUFFER_SIZE < 128)
+   #error HTTP_SERVER_RX_BUFFER_SIZE parameter is not valid
+#endif
+
 //Maximum size of root directory
 #ifndef HTTP_SERVER_ROOT_DIR_MAX_LEN
    #define HTTP_SERVER_ROOT_DIR_MAX_LEN 31
@@ -225,6 +274,54 @@
    #error HTTP_SERVER_SSI_MAX_RECURSION parameter is not valid
 #endif
 
+//Number of compiled SSI scripts kept in the cache
+#ifndef HTTP_SERVER_SSI_CACHE_SIZE
+   #define HTTP_SERVER_SSI_CACHE_SIZE 4
+#elif (HTTP_SERVER_SSI_CACHE_SIZE < 1)
+   #error HTTP_SERVER_SSI_CACHE_SIZE parameter is not valid
+#endif
+
+//Maximum size of a file that can be compiled and cached
+#ifndef HTTP_SERVER_SSI_CACHE_MAX_FILE_SIZE
+   #define HTTP_SERVER_SSI_CACHE_MAX_FILE_SIZE 8192
+#elif (HTTP_SERVER_SSI_CACHE_MAX_FILE_SIZE < 1)
+   #error HTTP_SERVER_SSI_CACHE_MAX_FILE_SIZE parameter is not valid
+#endif
+
+//Each HTTP/2 connection allocates an Http2Context, which holds the HPACK
+//decoder table (HPACK_DYNAMIC_TABLE_SIZE plus its index), the header block
+//and field buffers, and one buffer of HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE
+//bytes per stream. With the default settings, this amounts to about 16 KB
+//per connection
+
+//Maximum number of concurrent HTTP/2 streams (serviced or pending)
+#ifndef HTTP_SERVER_HTTP2_MAX_STREAMS
+   #define HTTP_SERVER_HTTP2_MAX_STREAMS 8
+#elif (HTTP_SERVER_HTTP2_MAX_STREAMS < 1)
+   #error HTTP_SERVER_HTTP2_MAX_STREAMS parameter is not valid
+#endif
+
+//Size of the buffer holding the request of a pending HTTP/2 stream
+#ifndef HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE
+   #define HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE 1024
+#elif (HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE < 256)
+   #error HTTP_SERVER_HTTP2_STREAM_BUFFER_SIZE parameter is not valid
+#endif
+
+//Size of the buffer holding an HTTP/2 header block
+#ifndef HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE
+   #define HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE 2048
+#elif (HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE < 256)
+   #error HTTP_SERVER_HTTP2_HEADER_BLOCK_SIZE parameter is not valid
+#endif
+
+//Size of the buffer holding a decoded HTTP/2 header field
+#ifndef HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE
+   #define HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE 1024
+#elif (HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE < 128)
+   #error HTTP_SERVER_HTTP2_FIELD_BUFFER_SIZE parameter is not valid
+#endif
+
 //Maximum age for static resources
 #ifndef HTTP_SERVER_MAX_AGE
    #define HTTP_SERVER_MAX_AGE 0
@@ -267,6 +364,27 @@
    #error HTTP_SERVER_COOKIE_MAX_LEN parameter is not valid
 #endif
 
+//Number of entries in the static resource cache
+#ifndef HTTP_SERVER_CACHE_SIZE
+   #define HTTP_SERVER_CACHE_SIZE 8
+#elif (HTTP_SERVER_CACHE_SIZE < 1)
+   #error HTTP_SERVER_CACHE_SIZE parameter is not valid
+#endif
+
+//Maximum size of a file body kept in the static resource cache
+#ifndef HTTP_SERVER_CACHE_MAX_BODY_SIZE
+   #define HTTP_SERVER_CACHE_MAX_BODY_SIZE HTTP_SERVER_BUFFER_SIZE
+#elif (HTTP_SERVER_CACHE_MAX_BODY_SIZE > HTTP_SERVER_BUFFER_SIZE)
+   #error HTTP_SERVER_CACHE_MAX_BODY_SIZE parameter is not valid
+#endif
+
+//Maximum length for entity tags
+#ifndef HTTP_SERVER_ETAG_MAX_LEN
+   #define HTTP_SERVER_ETAG_MAX_LEN 31
+#elif (HTTP_SERVER_ETAG_MAX_LEN < 18)
+   #error HTTP_SERVER_ETAG_MAX_LEN parameter is not valid
+#endif
+
 //Application specific context
 #ifndef HTTP_SERVER_PRIVATE_CONTEXT
    #define HTTP_SERVER_PRIVATE_CONTEXT
@@ -317,6 +435,10 @@ struct _HttpServerContext;
 struct _HttpConnection;
 #define HttpConnection struct _HttpConnection
 
+//Forward declaration of Http2Context structure
+struct _Http2Context;
+#define Http2Context struct _Http2Context
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -353,6 +475,19 @@ typedef enum
 } HttpConnState;
 
 
+/**
+ * @brief Connection states (worker pool mode)
+ **/
+
+typedef enum
+{
+   HTTP_POOL_STATE_CLOSED = 0, ///<The connection slot is free
+   HTTP_POOL_STATE_IDLE   = 1, ///<Waiting for the next request
+   HTTP_POOL_STATE_READY  = 2, ///<Waiting for a worker task
+   HTTP_POOL_STATE_BUSY   = 3  ///<Being serviced by a worker task
+} HttpPoolState;
+
+
 //The HTTP_FLAG_BREAK macro causes the httpReadStream() function to stop
 //reading data whenever the specified break character is encountered
 #define HTTP_FLAG_BREAK(c) (HTTP_FLAG_BREAK_CHAR | LSB(c))
@@ -483,6 +618,9 @@ typedef struct
    bool_t upgradeWebSocket;
    bool_t connectionUpgrade;
    char_t clientKey[WEB_SOCKET_CLIENT_KEY_SIZE + 1];
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   char_t webSocketExtensions[WEB_SOCKET_EXTENSIONS_MAX_LEN + 1];
+#endif
 #endif
 #if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
    bool_t acceptGzipEncoding;
@@ -494,6 +632,20 @@ typedef struct
 #if (HTTP_SERVER_COOKIE_SUPPORT == ENABLED)
    char_t cookie[HTTP_SERVER_COOKIE_MAX_LEN + 1];            ///<Cookie header field
 #endif
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   char_t ifNoneMatch[HTTP_SERVER_ETAG_MAX_LEN + 1];         ///<If-None-Match header field
+#endif
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   bool_t range;                                             ///<A byte range has been requested
+   bool_t rangeSuffix;                                       ///<The range designates the final bytes of the resource
+   size_t rangeFirst;                                        ///<First byte position (or suffix length)
+   size_t rangeLast;                                         ///<Last byte position
+   char_t ifRange[HTTP_SERVER_ETAG_MAX_LEN + 1];             ///<If-Range header field
+#endif
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   bool_t upgradeHttp2;                                      ///<The client asks to switch to HTTP/2 (h2c)
+   bool_t http2Settings;                                     ///<HTTP2-Settings header field
+#endif
 } HttpRequest;
 
 
@@ -522,6 +674,15 @@ typedef struct
 #if (HTTP_SERVER_COOKIE_SUPPORT == ENABLED)
    char_t setCookie[HTTP_SERVER_COOKIE_MAX_LEN + 1]; ///<Set-Cookie header field
 #endif
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   char_t etag[HTTP_SERVER_ETAG_MAX_LEN + 1];        ///<ETag header field
+#endif
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   bool_t acceptRanges;                              ///<Byte-range requests are accepted
+   size_t rangeFirst;                                ///<First byte position of the selected range
+   size_t rangeLast;                                 ///<Last byte position of the selected range
+   size_t completeLength;                            ///<Length of the whole resource
+#endif
 } HttpResponse;
 
 
@@ -564,6 +725,79 @@ typedef struct
 } HttpNonceCacheEntry;
 
 
+/**
+ * @brief Static resource cache entry
+ **/
+
+typedef struct
+{
+   bool_t valid;                                 ///<Valid entry
+   uint_t id;                                    ///<Unique identifier of the cached resource
+   char_t uri[HTTP_SERVER_URI_MAX_LEN + 1];      ///<Resource identifier
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   bool_t acceptGzipEncoding;                    ///<The client accepts gzip encoding
+   bool_t gzipEncoding;                          ///<The resource is gzip-compressed
+#endif
+   const char_t *contentType;                    ///<Content type
+   size_t length;                                ///<Length of the resource
+   char_t etag[HTTP_SERVER_ETAG_MAX_LEN + 1];    ///<Strong entity tag
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   DateTime modified;                            ///<Time of last modification of the file
+   uint8_t *body;                                ///<Copy of the file contents (small files only)
+#else
+   const uint8_t *data;                          ///<Resource data
+#endif
+   systime_t lastAccess;                         ///<Time stamp used by the LRU replacement policy
+} HttpCacheEntry;
+
+
+/**
+ * @brief Span of a compiled SSI script
+ **/
+
+typedef struct
+{
+   bool_t directive; ///<The span is an SSI directive rather than literal text
+   size_t offset;    ///<Offset of the span within the script
+   size_t length;    ///<Length of the span
+} HttpSsiSpan;
+
+
+/**
+ * @brief Compiled SSI script cache entry
+ **/
+
+typedef struct
+{
+   bool_t valid;                                      ///<Valid entry
+   uint_t refCount;                                   ///<Number of connections rendering the script
+   char_t path[HTTP_SERVER_ROOT_DIR_MAX_LEN +
+      HTTP_SERVER_URI_MAX_LEN + 2];                   ///<Full pathname of the script
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   uint32_t size;                                     ///<Size of the file
+   DateTime modified;                                 ///<Time of last modification
+#endif
+   const char_t *data;                                ///<Script contents
+   size_t length;                                     ///<Length of the script
+   HttpSsiSpan *spans;                                ///<List of literal spans and directives
+   uint_t numSpans;                                   ///<Number of spans
+   systime_t lastAccess;                              ///<Time stamp used by the LRU replacement policy
+} HttpSsiCacheEntry;
+
+
+/**
+ * @brief Worker task (worker pool mode)
+ **/
+
+typedef struct
+{
+   HttpServerContext *serverContext; ///<Reference to the HTTP server context
+   OsTask *taskHandle;               ///<Worker task handle
+   OsEvent event;                    ///<Event object used to wake up the worker
+   HttpConnection *connection;       ///<Connection being serviced, if any
+} HttpServerWorker;
+
+
 /**
  * @brief HTTP server context
  **/
@@ -575,6 +809,13 @@ struct _HttpServerContext
    OsSemaphore semaphore;                                        ///<Semaphore limiting the number of connections
    Socket *socket;                                               ///<Listening socket
    HttpConnection *connections;                                  ///<Client connections
+#if (HTTP_SERVER_WORKER_POOL_SUPPORT == ENABLED)
+   OsMutex poolMutex;                                            ///<Mutex protecting the hand-over of connections to workers
+   OsEvent event;                                                ///<Event object used to wake up the dispatcher
+   SocketEventDesc *eventDesc;                                   ///<Set of sockets polled by the dispatcher
+   HttpServerWorker workers[HTTP_SERVER_WORKER_COUNT];           ///<Worker tasks
+   uint_t nextConnection;                                        ///<Round-robin dispatching index
+#endif
 #if (HTTP_SERVER_TLS_SUPPORT == ENABLED && TLS_TICKET_SUPPORT == ENABLED)
    TlsTicketContext tlsTicketContext;                            ///<TLS ticket encryption context
 #endif
@@ -582,6 +823,15 @@ struct _HttpServerContext
    OsMutex nonceCacheMutex;                                      ///<Mutex preventing simultaneous access to the nonce cache
    HttpNonceCacheEntry nonceCache[HTTP_SERVER_NONCE_CACHE_SIZE]; ///<Nonce cache
 #endif
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   OsMutex cacheMutex;                                           ///<Mutex preventing simultaneous access to the resource cache
+   HttpCacheEntry cache[HTTP_SERVER_CACHE_SIZE];                 ///<Static resource cache
+   uint_t cacheNextId;                                           ///<Identifier assigned to the next cached resource
+#endif
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED && HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+   OsMutex ssiCacheMutex;                                        ///<Mutex preventing simultaneous access to the SSI cache
+   HttpSsiCacheEntry ssiCache[HTTP_SERVER_SSI_CACHE_SIZE];       ///<Compiled SSI script cache
+#endif
 };
 
 
@@ -603,6 +853,13 @@ struct _HttpConnection
    Socket *socket;                                     ///<Socket
 #if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
    TlsContext *tlsContext;                             ///<TLS context
+#endif
+#if (HTTP_SERVER_WORKER_POOL_SUPPORT == ENABLED)
+   HttpPoolState poolState;                            ///<State of the connection
+   bool_t started;                                     ///<The connection has been set up by a worker
+   bool_t expired;                                     ///<The keep-alive timer has elapsed
+   uint_t requestCount;                                ///<Number of requests serviced so far
+   systime_t idleTimestamp;                            ///<Time at which the connection became idle
 #endif
    HttpRequest request;                                ///<Incoming HTTP request header
    HttpResponse response;                              ///<HTTP response header
@@ -610,6 +867,12 @@ struct _HttpConnection
    char_t cgiParam[HTTP_SERVER_CGI_PARAM_MAX_LEN + 1]; ///<CGI parameter
    uint32_t dummy;                                     ///<Force alignment of the buffer on 32-bit boundaries
    char_t buffer[HTTP_SERVER_BUFFER_SIZE];             ///<Memory buffer for input/output operations
+   char_t rxBuffer[HTTP_SERVER_RX_BUFFER_SIZE];        ///<Receive buffer (request header and read-ahead data)
+   size_t rxBufferPos;                                 ///<Current read position in the receive buffer
+   size_t rxBufferLen;                                 ///<Number of bytes in the receive buffer
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   Http2Context *http2Context;                         ///<HTTP/2 connection state
+#endif
 #if (NET_RTOS_SUPPORT == DISABLED)
    HttpConnState state;                                ///<Connection state
    systime_t timestamp;
@@ -631,6 +894,18 @@ error_t httpServerStart(HttpServerContext *context);
 void httpListenerTask(void *param);
 void httpConnectionTask(void *param);
 
+void httpDispatcherTask(void *param);
+void httpAcceptConnection(HttpServerContext *context);
+void httpDispatchConnections(HttpServerContext *context);
+bool_t httpPreReadRequest(HttpConnection *connection);
+bool_t httpCheckRequestHeader(HttpConnection *connection);
+void httpWorkerTask(void *param);
+
+error_t httpStartConnection(HttpConnection *connection);
+error_t httpProcessRequest(HttpConnection *connection);
+error_t httpHandleRequest(HttpConnection *connection);
+void httpCloseConnection(HttpConnection *connection);
+
 error_t httpWriteHeader(HttpConnection *connection);
 
 error_t httpReadStream(HttpConnection *connection,
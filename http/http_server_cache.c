@@ -0,0 +1,768 @@
+/**
+ * @file http_server_cache.c
+ * @brief Static resource cache
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "http/http_server.h"
+#include "http/http_server_cache.h"
+#include "http/http_server_misc.h"
+#include "http/mime.h"
+#include "str.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_SUPPORT == ENABLED && HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Send static resource through the cache
+ *
+ * The metadata of recently requested resources (resolved path, gzip variant,
+ * content type, length and strong entity tag) is kept in a small LRU cache,
+ * together with the contents of small files. A request whose If-None-Match
+ * field matches the entity tag is answered with a 304 status code
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] uri NULL-terminated string containing the file to be sent in response
+ * @return Error code
+ **/
+
+error_t httpCacheSendResponse(HttpConnection *connection, const char_t *uri)
+{
+   error_t error;
+   size_t length;
+   size_t offset;
+   size_t count;
+   HttpServerContext *context;
+   HttpCacheEntry *entry;
+   HttpCacheEntry newEntry;
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t id;
+   bool_t cached;
+#else
+   const uint8_t *data;
+#endif
+
+   //Point to the HTTP server context
+   context = connection->serverContext;
+
+   //Clear the scratch entry
+   memset(&newEntry, 0, sizeof(HttpCacheEntry));
+
+   //Resolve the resource and retrieve its current metadata
+   error = httpCacheResolveEntry(connection, uri, &newEntry);
+   //The specified URI cannot be found?
+   if(error)
+      return error;
+
+   //Acquire exclusive access to the resource cache
+   osAcquireMutex(&context->cacheMutex);
+
+   //Search the cache for a matching entry
+   entry = httpCacheFindEntry(context, &newEntry);
+
+   //Cache miss?
+   if(entry == NULL)
+   {
+      //Release exclusive access to the resource cache while the resource
+      //is being loaded, so that other connections are not held up
+      osReleaseMutex(&context->cacheMutex);
+
+      //Debug message
+      TRACE_DEBUG("HTTP cache miss: %s\r\n", uri);
+
+      //Compute the entity tag of the resource
+      httpCacheLoadEntry(connection, &newEntry);
+
+      //Acquire exclusive access to the resource cache
+      osAcquireMutex(&context->cacheMutex);
+
+      //Another connection may have cached the same resource meanwhile
+      entry = httpCacheFindEntry(context, &newEntry);
+
+      //Already cached?
+      if(entry != NULL)
+      {
+         //Discard the newly loaded copy
+         httpCacheFreeEntry(&newEntry);
+      }
+      else
+      {
+         //Reclaim an entry from the cache
+         entry = httpCacheCreateEntry(context);
+         //Publish the newly loaded resource
+         *entry = newEntry;
+         //Assign a unique identifier to the cached resource
+         entry->id = context->cacheNextId++;
+         //The entry is now valid
+         entry->valid = TRUE;
+      }
+   }
+   else
+   {
+      //Debug message
+      TRACE_DEBUG("HTTP cache hit: %s\r\n", uri);
+   }
+
+   //Save the time at which the entry was last used
+   entry->lastAccess = osGetSystemTime();
+
+   //Copy the metadata before releasing the cache
+   length = entry->length;
+   connection->response.contentType = entry->contentType;
+   strcpy(connection->response.etag, entry->etag);
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   connection->response.gzipEncoding = entry->gzipEncoding;
+#endif
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   id = entry->id;
+   cached = (entry->body != NULL) ? TRUE : FALSE;
+#else
+   data = entry->data;
+#endif
+
+   //Release exclusive access to the resource cache
+   osReleaseMutex(&context->cacheMutex);
+
+   //Format HTTP response header
+   connection->response.statusCode = 200;
+   connection->response.chunkedEncoding = FALSE;
+   connection->response.contentLength = length;
+
+   //The client already holds the current representation of the resource?
+   if(httpCacheMatchEtag(connection->request.ifNoneMatch,
+      connection->response.etag))
+   {
+      //Debug message
+      TRACE_DEBUG("HTTP resource not modified: %s\r\n", uri);
+
+      //The 304 response does not contain a message body
+      connection->response.statusCode = 304;
+      connection->response.contentLength = 0;
+
+      //Send the header to the client
+      error = httpWriteHeader(connection);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Properly close output stream
+      return httpCloseStream(connection);
+   }
+
+   //Select the portion of the resource to be sent
+   httpSelectRange(connection, length, &offset, &count);
+   //Set the length of the response body
+   connection->response.contentLength = count;
+
+   //Send the header to the client
+   error = httpWriteHeader(connection);
+   //Any error to report?
+   if(error)
+      return error;
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //The contents of the file are held in the cache?
+   if(cached)
+   {
+      //Acquire exclusive access to the resource cache
+      osAcquireMutex(&context->cacheMutex);
+
+      //The entry may have been evicted since the header was sent
+      for(cached = FALSE, i = 0; i < HTTP_SERVER_CACHE_SIZE; i++)
+      {
+         //Point to the current entry
+         entry = &context->cache[i];
+
+         //Check whether the entry still holds the same resource
+         if(entry->valid && entry->id == id && entry->body != NULL)
+         {
+            //Copy the response body
+            memcpy(connection->buffer, entry->body + offset, count);
+            cached = TRUE;
+            break;
+         }
+      }
+
+      //Release exclusive access to the resource cache
+      osReleaseMutex(&context->cacheMutex);
+   }
+
+   //Send response body
+   if(cached)
+   {
+      //Send data to the client
+      error = httpWriteStream(connection, connection->buffer, count);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Properly close output stream
+      error = httpCloseStream(connection);
+   }
+   else
+   {
+      //Read the file and send its contents to the client
+      error = httpCacheSendFile(connection, uri, offset, count);
+   }
+#else
+   //Send response body
+   error = httpWriteStream(connection, data + offset, count);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Properly close output stream
+   error = httpCloseStream(connection);
+#endif
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Search the resource cache for a given resource
+ *
+ * An entry whose file has been modified (or whose resource data have
+ * changed) since it was loaded is discarded
+ *
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] key Resolved resource and its current metadata
+ * @return Pointer to the matching entry, if any
+ **/
+
+HttpCacheEntry *httpCacheFindEntry(HttpServerContext *context,
+   const HttpCacheEntry *key)
+{
+   uint_t i;
+   bool_t modified;
+   HttpCacheEntry *entry;
+
+   //Loop through the resource cache
+   for(i = 0; i < HTTP_SERVER_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &context->cache[i];
+
+      //Matching resource identifier?
+      if(entry->valid && !strcmp(entry->uri, key->uri))
+      {
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+         //Matching variant?
+         if(entry->acceptGzipEncoding == key->acceptGzipEncoding)
+#endif
+         {
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+            //Check whether the file has been modified since it was loaded
+            modified = (entry->length != key->length ||
+               compareDateTime(&entry->modified, &key->modified)) ? TRUE : FALSE;
+#else
+            //Check whether the resource data have changed
+            modified = (entry->data != key->data ||
+               entry->length != key->length) ? TRUE : FALSE;
+#endif
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+            //Check whether the resolved variant has changed
+            if(entry->gzipEncoding != key->gzipEncoding)
+               modified = TRUE;
+#endif
+            //Up-to-date entry?
+            if(!modified)
+            {
+               //A matching entry has been found
+               return entry;
+            }
+            else
+            {
+               //Stale entries are discarded so that the resource is reloaded
+               httpCacheFreeEntry(entry);
+            }
+         }
+      }
+   }
+
+   //The resource is not in the cache
+   return NULL;
+}
+
+
+/**
+ * @brief Reclaim an entry from the resource cache
+ *
+ * Free entries are used first. Otherwise the least recently used
+ * entry is evicted
+ *
+ * @param[in] context Pointer to the HTTP server context
+ * @return Pointer to the entry
+ **/
+
+HttpCacheEntry *httpCacheCreateEntry(HttpServerContext *context)
+{
+   uint_t i;
+   HttpCacheEntry *entry;
+   HttpCacheEntry *oldestEntry;
+
+   //Keep track of the least recently used entry
+   oldestEntry = &context->cache[0];
+
+   //Loop through the resource cache
+   for(i = 0; i < HTTP_SERVER_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &context->cache[i];
+
+      //Check whether the entry is currently in use
+      if(!entry->valid)
+         return entry;
+
+      //Keep track of the least recently used entry
+      if(timeCompare(entry->lastAccess, oldestEntry->lastAccess) < 0)
+         oldestEntry = entry;
+   }
+
+   //Evict the least recently used entry
+   httpCacheFreeEntry(oldestEntry);
+
+   //Return a pointer to the entry
+   return oldestEntry;
+}
+
+
+/**
+ * @brief Resolve a static resource and retrieve its current metadata
+ *
+ * Only the size and the modification time of the file are retrieved, so
+ * that the resource can be revalidated against the cache on every request
+ * without reading it
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] uri NULL-terminated string containing the resource identifier
+ * @param[out] entry Pointer to the scratch cache entry
+ * @return Error code
+ **/
+
+error_t httpCacheResolveEntry(HttpConnection *connection,
+   const char_t *uri, HttpCacheEntry *entry)
+{
+   error_t error;
+   bool_t gzipEncoding;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   size_t n;
+#endif
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   FsFileStat fileStat;
+#else
+   size_t length;
+   const uint8_t *data;
+#endif
+
+   //Use the non-compressed resource by default
+   gzipEncoding = FALSE;
+
+   //Retrieve the full pathname
+   httpGetAbsolutePath(connection, uri, connection->buffer,
+      HTTP_SERVER_BUFFER_SIZE);
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Check whether gzip compression is supported by the client
+   if(connection->request.acceptGzipEncoding)
+   {
+      //Calculate the length of the pathname
+      n = strlen(connection->buffer);
+
+      //Sanity check
+      if(n < (HTTP_SERVER_BUFFER_SIZE - 4))
+      {
+         //Append gzip extension
+         strcpy(connection->buffer + n, ".gz");
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+         //Retrieve the size and the modification time of the compressed file
+         error = fsGetFileStat(connection->buffer, &fileStat);
+#else
+         //Get the compressed resource data associated with the URI, if any
+         error = resGetData(connection->buffer, &data, &length);
+#endif
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_NOT_FOUND;
+      }
+
+      //Check whether the gzip-compressed resource exists
+      if(!error)
+      {
+         //Use gzip format
+         gzipEncoding = TRUE;
+      }
+      else
+      {
+         //Strip the gzip extension
+         connection->buffer[n] = '\0';
+      }
+   }
+#endif
+
+   //The non-compressed resource must be used?
+   if(!gzipEncoding)
+   {
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+      //Retrieve the size and the modification time of the file
+      error = fsGetFileStat(connection->buffer, &fileStat);
+#else
+      //Get the resource data associated with the URI
+      error = resGetData(connection->buffer, &data, &length);
+#endif
+      //The specified URI cannot be found?
+      if(error)
+         return ERROR_NOT_FOUND;
+   }
+
+   //Save the resource identifier
+   strSafeCopy(entry->uri, uri, HTTP_SERVER_URI_MAX_LEN);
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Save the selected variant
+   entry->acceptGzipEncoding = connection->request.acceptGzipEncoding;
+   entry->gzipEncoding = gzipEncoding;
+#endif
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //Save the size and the modification time of the file
+   entry->length = fileStat.size;
+   entry->modified = fileStat.modified;
+#else
+   //Resources are stored in non-volatile memory
+   entry->data = data;
+   entry->length = length;
+#endif
+
+   //Save the content type
+   entry->contentType = mimeGetType(uri);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the entity tag of a resource that is not yet cached
+ *
+ * The entry is not yet part of the cache, so this function can be called
+ * without holding the cache mutex. The caller assigns the entry identifier
+ * when the entry is published
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in,out] entry Pointer to the scratch cache entry
+ **/
+
+void httpCacheLoadEntry(HttpConnection *connection, HttpCacheEntry *entry)
+{
+   uint32_t hash;
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   error_t error;
+   size_t i;
+   size_t n;
+   uint8_t value[6];
+   FsFile *file;
+#endif
+
+   //FNV-1a offset basis
+   hash = 0x811C9DC5;
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //The entity tag is derived from the modification time of the file, so
+   //that the contents do not have to be read to validate the resource
+   STORE32BE(convertDateToUnixTime(&entry->modified), value);
+   STORE16BE(entry->modified.milliseconds, value + 4);
+
+   //Update hash value
+   hash = httpCacheHash(hash, value, sizeof(value));
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //The gzip-compressed variant has its own entity tag
+   if(entry->gzipEncoding)
+      hash = httpCacheHash(hash, (const uint8_t *) ".gz", 3);
+#endif
+
+   //The contents of small files are kept in memory
+   if(entry->length > 0 && entry->length <= HTTP_SERVER_CACHE_MAX_BODY_SIZE)
+   {
+      //The pathname of the resolved resource is still held in the buffer
+      file = fsOpenFile(connection->buffer, FS_FILE_MODE_READ);
+
+      //Check whether the file has been successfully opened
+      if(file != NULL)
+      {
+         //Allocate a memory buffer to hold the contents of the file
+         entry->body = osAllocMem(entry->length);
+
+         //Successful memory allocation?
+         if(entry->body != NULL)
+         {
+            //Read the contents of the file
+            for(i = 0; i < entry->length; i += n)
+            {
+               //Read data from the specified file
+               error = fsReadFile(file, entry->body + i, entry->length - i, &n);
+               //Any error to report?
+               if(error || n == 0)
+                  break;
+            }
+
+            //The file could not be read entirely?
+            if(i < entry->length)
+            {
+               //The file will be read when the response is sent
+               osFreeMem(entry->body);
+               entry->body = NULL;
+            }
+         }
+
+         //Close the file
+         fsCloseFile(file);
+      }
+   }
+#else
+   //Hash the resource data
+   hash = httpCacheHash(hash, entry->data, entry->length);
+#endif
+
+   //The strong entity tag combines the hash value with the length
+   sprintf(entry->etag, "\"%08" PRIX32 "%08" PRIX32 "\"",
+      hash, (uint32_t) entry->length);
+}
+
+
+/**
+ * @brief Release a cache entry
+ * @param[in] entry Pointer to the cache entry
+ **/
+
+void httpCacheFreeEntry(HttpCacheEntry *entry)
+{
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //Release the copy of the file contents
+   if(entry->body != NULL)
+   {
+      osFreeMem(entry->body);
+      entry->body = NULL;
+   }
+#endif
+
+   //The entry is now free
+   entry->valid = FALSE;
+}
+
+
+/**
+ * @brief Send the contents of a file that is not held in the cache
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] uri NULL-terminated string containing the resource identifier
+ * @param[in] offset Offset of the first byte to send
+ * @param[in] length Number of bytes to send
+ * @return Error code
+ **/
+
+error_t httpCacheSendFile(HttpConnection *connection,
+   const char_t *uri, size_t offset, size_t length)
+{
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+   FsFile *file;
+
+   //Retrieve the full pathname
+   httpGetAbsolutePath(connection, uri, connection->buffer,
+      HTTP_SERVER_BUFFER_SIZE);
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //The resolved variant is the gzip-compressed file?
+   if(connection->response.gzipEncoding)
+   {
+      //Calculate the length of the pathname
+      n = strlen(connection->buffer);
+
+      //Sanity check
+      if(n >= (HTTP_SERVER_BUFFER_SIZE - 4))
+         return ERROR_NOT_FOUND;
+
+      //Append gzip extension
+      strcpy(connection->buffer + n, ".gz");
+   }
+#endif
+
+   //Open the file for reading
+   file = fsOpenFile(connection->buffer, FS_FILE_MODE_READ);
+   //Failed to open the file?
+   if(file == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Skip the bytes that precede the selected range
+   if(offset > 0)
+      error = fsSeekFile(file, offset, FS_SEEK_SET);
+   else
+      error = NO_ERROR;
+
+   //Send response body
+   while(!error && length > 0)
+   {
+      //Limit the number of bytes to read at a time
+      n = MIN(length, HTTP_SERVER_BUFFER_SIZE);
+
+      //Read data from the specified file
+      error = fsReadFile(file, connection->buffer, n, &n);
+      //End of input stream?
+      if(error)
+         break;
+
+      //Send data to the client
+      error = httpWriteStream(connection, connection->buffer, n);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Decrement the count of remaining bytes to be transferred
+      length -= n;
+   }
+
+   //Close the file
+   fsCloseFile(file);
+
+   //Successful file transfer?
+   if(error == NO_ERROR || error == ERROR_END_OF_FILE)
+   {
+      if(length == 0)
+      {
+         //Properly close the output stream
+         error = httpCloseStream(connection);
+      }
+   }
+
+   //Return status code
+   return error;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Check whether an entity tag matches an If-None-Match field
+ * @param[in] list NULL-terminated string containing the If-None-Match field
+ * @param[in] etag NULL-terminated string containing the current entity tag
+ * @return TRUE if the entity tag matches, else FALSE
+ **/
+
+bool_t httpCacheMatchEtag(const char_t *list, const char_t *etag)
+{
+   size_t n;
+   const char_t *p;
+
+   //No entity tag?
+   if(etag[0] == '\0')
+      return FALSE;
+
+   //Calculate the length of the entity tag
+   n = strlen(etag);
+
+   //Point to the first entity tag of the list
+   p = list;
+
+   //Parse the comma-separated list
+   while(*p != '\0')
+   {
+      //Skip separators and whitespace characters
+      while(*p == ',' || *p == ' ' || *p == '\t')
+         p++;
+
+      //End of the list?
+      if(*p == '\0')
+         break;
+
+      //The value "*" matches any current representation
+      if(*p == '*')
+         return TRUE;
+
+      //If-None-Match uses the weak comparison function
+      if(!strncmp(p, "W/", 2))
+         p += 2;
+
+      //Compare opaque tags
+      if(!strncmp(p, etag, n))
+      {
+         //Make sure the entity tag is properly terminated
+         if(p[n] == '\0' || p[n] == ',' || p[n] == ' ' || p[n] == '\t')
+            return TRUE;
+      }
+
+      //Jump to the next entity tag
+      while(*p != '\0' && *p != ',')
+         p++;
+   }
+
+   //The entity tag does not match
+   return FALSE;
+}
+
+
+/**
+ * @brief Update FNV-1a hash value
+ * @param[in] hash Current hash value
+ * @param[in] data Pointer to the data to be hashed
+ * @param[in] length Length of the data, in bytes
+ * @return Updated hash value
+ **/
+
+uint32_t httpCacheHash(uint32_t hash, const uint8_t *data, size_t length)
+{
+   size_t i;
+
+   //Process incoming data
+   for(i = 0; i < length; i++)
+   {
+      hash ^= data[i];
+      hash *= 0x01000193;
+   }
+
+   //Return the updated hash value
+   return hash;
+}
+
+#endif
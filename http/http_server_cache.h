@@ -0,0 +1,69 @@
+/**
+ * @file http_server_cache.h
+ * @brief Static resource cache
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _HTTP_SERVER_CACHE_H
+#define _HTTP_SERVER_CACHE_H
+
+//Dependencies
+#include "http/http_server.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Static resource cache related functions
+error_t httpCacheSendResponse(HttpConnection *connection, const char_t *uri);
+
+HttpCacheEntry *httpCacheFindEntry(HttpServerContext *context,
+   const HttpCacheEntry *key);
+
+HttpCacheEntry *httpCacheCreateEntry(HttpServerContext *context);
+
+error_t httpCacheResolveEntry(HttpConnection *connection,
+   const char_t *uri, HttpCacheEntry *entry);
+
+void httpCacheLoadEntry(HttpConnection *connection, HttpCacheEntry *entry);
+
+void httpCacheFreeEntry(HttpCacheEntry *entry);
+
+error_t httpCacheSendFile(HttpConnection *connection,
+   const char_t *uri, size_t offset, size_t length);
+
+bool_t httpCacheMatchEtag(const char_t *list, const char_t *etag);
+
+uint32_t httpCacheHash(uint32_t hash, const uint8_t *data, size_t length);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
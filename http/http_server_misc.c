@@ -58,6 +58,7 @@ static const HttpStatusCodeDesc statusCodeList[] =
    {201, "Created"},
    {202, "Accepted"},
    {204, "No Content"},
+   {206, "Partial Content"},
    //Redirection
    {301, "Moved Permanently"},
    {302, "Found"},
@@ -67,6 +68,7 @@ static const HttpStatusCodeDesc statusCodeList[] =
    {401, "Unauthorized"},
    {403, "Forbidden"},
    {404, "Not Found"},
+   {416, "Range Not Satisfiable"},
    //Server error
    {500, "Internal Server Error"},
    {501, "Not Implemented"},
@@ -77,6 +79,12 @@ static const HttpStatusCodeDesc statusCodeList[] =
 
 /**
  * @brief Read HTTP request header and parse its contents
+ *
+ * The request header is read in large chunks into the receive buffer of
+ * the connection, and lines are then located in place. Any data following
+ * the header (request body or pipelined requests) is kept in the buffer and
+ * returned by subsequent calls to httpReceive()
+ *
  * @param[in] connection Structure representing an HTTP connection
  * @return Error code
  **/
@@ -84,7 +92,10 @@ static const HttpStatusCodeDesc statusCodeList[] =
 error_t httpReadRequestHeader(HttpConnection *connection)
 {
    error_t error;
-   size_t length;
+   char_t *line;
+
+   //Discard the header of the previous request, but keep any pipelined data
+   httpCompactRxBuffer(connection);
 
    //Set the maximum time the server will wait for an HTTP
    //request before closing the connection
@@ -94,8 +105,7 @@ error_t httpReadRequestHeader(HttpConnection *connection)
       return error;
 
    //Read the first line of the request
-   error = httpReceive(connection, connection->buffer,
-      HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
+   error = httpReadHeaderLine(connection, &line, FALSE);
    //Unable to read any data?
    if(error)
       return error;
@@ -106,13 +116,11 @@ error_t httpReadRequestHeader(HttpConnection *connection)
    if(error)
       return error;
 
-   //Properly terminate the string with a NULL character
-   connection->buffer[length] = '\0';
    //Debug message
-   TRACE_INFO("%s", connection->buffer);
+   TRACE_INFO("%s\r\n", line);
 
    //Parse the Request-Line
-   error = httpParseRequestLine(connection, connection->buffer);
+   error = httpParseRequestLine(connection, line);
    //Any error to report?
    if(error)
       return error;
@@ -124,39 +132,41 @@ error_t httpReadRequestHeader(HttpConnection *connection)
    connection->request.upgradeWebSocket = FALSE;
    connection->request.connectionUpgrade = FALSE;
    strcpy(connection->request.clientKey, "");
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   strcpy(connection->request.webSocketExtensions, "");
+#endif
+#endif
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   connection->request.upgradeHttp2 = FALSE;
+   connection->request.http2Settings = FALSE;
 #endif
 
    //HTTP 0.9 does not support Full-Request
    if(connection->request.version >= HTTP_VERSION_1_0)
    {
       //Local variables
-      char_t firstChar;
       char_t *separator;
       char_t *name;
       char_t *value;
 
-      //This variable is used to decode header fields that span multiple lines
-      firstChar = '\0';
-
       //Parse the header fields of the HTTP request
       while(1)
       {
          //Decode multiple-line header field
-         error = httpReadHeaderField(connection, connection->buffer,
-            HTTP_SERVER_BUFFER_SIZE, &firstChar);
+         error = httpReadHeaderLine(connection, &line, TRUE);
          //Any error to report?
          if(error)
             return error;
 
          //Debug message
-         TRACE_DEBUG("%s", connection->buffer);
+         TRACE_DEBUG("%s\r\n", line);
 
          //An empty line indicates the end of the header fields
-         if(!strcmp(connection->buffer, "\r\n"))
+         if(line[0] == '\0')
             break;
 
          //Check whether a separator is present
-         separator = strchr(connection->buffer, ':');
+         separator = strchr(line, ':');
 
          //Separator found?
          if(separator != NULL)
@@ -165,7 +175,7 @@ error_t httpReadRequestHeader(HttpConnection *connection)
             *separator = '\0';
 
             //Trim whitespace characters
-            name = strTrimWhitespace(connection->buffer);
+            name = strTrimWhitespace(line);
             value = strTrimWhitespace(separator + 1);
 
             //Parse HTTP header field
@@ -307,109 +317,217 @@ error_t httpParseRequestLine(HttpConnection *connection, char_t *requestLine)
 
 
 /**
- * @brief Read multiple-line header field
+ * @brief Read a line of the request header
+ *
+ * The line is located in the receive buffer and properly terminated with a
+ * NULL character, the trailing CRLF sequence being removed. When unfolding
+ * is requested, a CRLF immediately followed by a LWSP character is replaced
+ * with spaces so that the header field is returned as a single line
+ *
  * @param[in] connection Structure representing an HTTP connection
- * @param[out] buffer Buffer where to store the header field
- * @param[in] size Size of the buffer, in bytes
- * @param[in,out] firstChar Leading character of the header line
+ * @param[out] line Pointer to the resulting line
+ * @param[in] unfold Decode header fields that span multiple lines
  * @return Error code
  **/
 
-error_t httpReadHeaderField(HttpConnection *connection,
-   char_t *buffer, size_t size, char_t *firstChar)
+error_t httpReadHeaderLine(HttpConnection *connection, char_t **line,
+   bool_t unfold)
 {
    error_t error;
    size_t n;
    size_t length;
+   size_t scanPos;
+   char_t *p;
+   char_t *lf;
 
-   //This is the actual length of the header field
-   length = 0;
+   //Number of bytes that have already been scanned for a line terminator
+   scanPos = 0;
 
-   //The process of moving from a multiple-line representation of a header
-   //field to its single line representation is called unfolding
-   do
+   //Read data until a complete line is available
+   while(1)
    {
-      //Check the length of the header field
-      if((length + 1) >= size)
-      {
-         //Report an error
-         error = ERROR_INVALID_REQUEST;
-         //Exit immediately
-         break;
-      }
+      //Point to the beginning of the line
+      p = connection->rxBuffer + connection->rxBufferPos;
+      //Number of bytes available in the receive buffer
+      n = connection->rxBufferLen - connection->rxBufferPos;
+
+      //Search the unscanned data for a LF character
+      lf = memchr(p + scanPos, '\n', n - scanPos);
 
-      //NULL character found?
-      if(*firstChar == '\0')
+      //Line terminator found?
+      if(lf != NULL)
       {
-         //Prepare to decode the first header field
-         length = 0;
+         //Length of the line, including the terminator
+         length = lf - p + 1;
+
+         //Empty lines and request lines are never folded
+         if(!unfold || length <= 2)
+            break;
+
+         //The next character is needed to detect if the CRLF is
+         //immediately followed by a LWSP character
+         if(length < n)
+         {
+            //LWSP character found?
+            if(p[length] == ' ' || p[length] == '\t')
+            {
+               //Unfolding is accomplished by regarding CRLF immediately
+               //followed by a LWSP as equivalent to the LWSP character
+               p[length - 1] = ' ';
+
+               if(p[length - 2] == '\r')
+                  p[length - 2] = ' ';
+
+               //Keep on searching for the end of the header field
+               scanPos = length;
+               continue;
+            }
+
+            //The header field is complete
+            break;
+         }
+
+         //Wait for the next character
+         scanPos = length - 1;
       }
-      //LWSP character found?
-      else if(*firstChar == ' ' || *firstChar == '\t')
+      else
       {
-         //Unfolding is accomplished by regarding CRLF immediately
-         //followed by a LWSP as equivalent to the LWSP character
-         buffer[length] = *firstChar;
-         //The current header field spans multiple lines
-         length++;
+         //The whole data has been scanned
+         scanPos = n;
       }
-      //Any other character?
-      else
+
+      //The receive buffer is full?
+      if(connection->rxBufferLen >= HTTP_SERVER_RX_BUFFER_SIZE)
       {
-         //Restore the very first character of the header field
-         buffer[0] = *firstChar;
-         //Prepare to decode a new header field
-         length = 1;
+         //Lines that do not fit in the buffer are rejected
+         if(connection->rxBufferPos == 0)
+            return ERROR_INVALID_REQUEST;
+
+         //Discard the lines that have already been parsed
+         httpCompactRxBuffer(connection);
+         continue;
       }
 
-      //Read data until a CLRF character is encountered
-      error = httpReceive(connection, buffer + length,
-         size - 1 - length, &n, SOCKET_FLAG_BREAK_CRLF);
+      //Read as much data as possible
+      error = httpReadRxBuffer(connection);
       //Any error to report?
       if(error)
-         break;
+         return error;
+   }
 
-      //Update the length of the header field
-      length += n;
-      //Properly terminate the string with a NULL character
-      buffer[length] = '\0';
+   //Consume the line
+   connection->rxBufferPos += length;
 
-      //An empty line indicates the end of the header fields
-      if(!strcmp(buffer, "\r\n"))
-         break;
+   //Remove the trailing CRLF sequence
+   p[length - 1] = '\0';
 
-      //Read the next character to detect if the CRLF is immediately
-      //followed by a LWSP character
-      error = httpReceive(connection, firstChar,
-         sizeof(char_t), &n, SOCKET_FLAG_WAIT_ALL);
-      //Any error to report?
-      if(error)
-         break;
+   if(length >= 2 && p[length - 2] == '\r')
+      p[length - 2] = '\0';
 
-      //LWSP character found?
-      if(*firstChar == ' ' || *firstChar == '\t')
-      {
-         //CRLF immediately followed by LWSP as equivalent to the LWSP character
-         if(length >= 2)
-         {
-            if(buffer[length - 2] == '\r' || buffer[length - 1] == '\n')
-            {
-               //Remove trailing CRLF sequence
-               length -= 2;
-               //Properly terminate the string with a NULL character
-               buffer[length] = '\0';
-            }
-         }
-      }
+   //Return a pointer to the line
+   *line = p;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read data into the receive buffer
+ *
+ * The function returns as soon as some data are available
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpReadRxBuffer(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+   char_t *p;
+   size_t size;
+
+   //Point to the free space at the end of the receive buffer
+   p = connection->rxBuffer + connection->rxBufferLen;
+   size = HTTP_SERVER_RX_BUFFER_SIZE - connection->rxBufferLen;
+
+#if (NET_RTOS_SUPPORT == ENABLED)
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //Check whether a secure connection is being used
+   if(connection->tlsContext != NULL)
+   {
+      //Use TLS to receive data from the client
+      error = tlsRead(connection->tlsContext, p, size, &n, 0);
+   }
+   else
+#endif
+   {
+      //Receive data from the client
+      error = socketReceive(connection->socket, p, size, &n, 0);
+   }
+#else
+   //Number of data bytes that are pending in the I/O buffer
+   n = connection->bufferLen - connection->bufferPos;
 
-      //A header field may span multiple lines...
-   } while(*firstChar == ' ' || *firstChar == '\t');
+   //Any data to be copied?
+   if(n > 0)
+   {
+      //Limit the number of bytes to read at a time
+      n = MIN(n, size);
+
+      //Copy data to the receive buffer
+      memcpy(p, connection->buffer + connection->bufferPos, n);
+      //Advance current position
+      connection->bufferPos += n;
+
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //No more data available...
+      error = ERROR_END_OF_STREAM;
+   }
+#endif
+
+   //Check status code
+   if(!error)
+   {
+      //Update the length of the buffered data
+      connection->rxBufferLen += n;
+   }
 
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Move unread data to the beginning of the receive buffer
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void httpCompactRxBuffer(HttpConnection *connection)
+{
+   size_t n;
+
+   //Number of bytes that have not been read yet
+   n = connection->rxBufferLen - connection->rxBufferPos;
+
+   //Any data to move?
+   if(n > 0 && connection->rxBufferPos > 0)
+   {
+      memmove(connection->rxBuffer, connection->rxBuffer +
+         connection->rxBufferPos, n);
+   }
+
+   //Update the state of the buffer
+   connection->rxBufferPos = 0;
+   connection->rxBufferLen = n;
+}
+
+
 /**
  * @brief Parse HTTP header field
  * @param[in] connection Structure representing an HTTP connection
@@ -465,14 +583,31 @@ void httpParseHeaderField(HttpConnection *connection,
       //Parse Authorization header field
       httpParseAuthorizationField(connection, value);
    }
-#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED || HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
    //Upgrade header field?
    else if(!strcasecmp(name, "Upgrade"))
    {
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
       //WebSocket support?
       if(!strcasecmp(value, "websocket"))
          connection->request.upgradeWebSocket = TRUE;
+#endif
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+      //HTTP/2 over cleartext TCP?
+      if(!strcasecmp(value, "h2c"))
+         connection->request.upgradeHttp2 = TRUE;
+#endif
+   }
+#endif
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP2-Settings header field?
+   else if(!strcasecmp(name, "HTTP2-Settings"))
+   {
+      //The header field must be present in an upgrade request
+      connection->request.http2Settings = TRUE;
    }
+#endif
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
    //Sec-WebSocket-Key header field?
    else if(!strcasecmp(name, "Sec-WebSocket-Key"))
    {
@@ -480,6 +615,16 @@ void httpParseHeaderField(HttpConnection *connection,
       strSafeCopy(connection->request.clientKey, value,
          WEB_SOCKET_CLIENT_KEY_SIZE + 1);
    }
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //Sec-WebSocket-Extensions header field?
+   else if(!strcasecmp(name, "Sec-WebSocket-Extensions"))
+   {
+      //A truncated list of extensions cannot be interpreted reliably, so
+      //oversized values are ignored
+      if(strlen(value) <= WEB_SOCKET_EXTENSIONS_MAX_LEN)
+         strcpy(connection->request.webSocketExtensions, value);
+   }
+#endif
 #endif
 #if (HTTP_SERVER_COOKIE_SUPPORT == ENABLED)
    //Cookie header field?
@@ -489,6 +634,33 @@ void httpParseHeaderField(HttpConnection *connection,
       httpParseCookieField(connection, value);
    }
 #endif
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   //If-None-Match header field?
+   else if(!strcasecmp(name, "If-None-Match"))
+   {
+      //The list of entity tags is ignored when it does not fit in the buffer
+      if(strlen(value) <= HTTP_SERVER_ETAG_MAX_LEN)
+         strcpy(connection->request.ifNoneMatch, value);
+   }
+#endif
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   //Range header field?
+   else if(!strcasecmp(name, "Range"))
+   {
+      //Parse Range header field
+      httpParseRangeField(connection, value);
+   }
+   //If-Range header field?
+   else if(!strcasecmp(name, "If-Range"))
+   {
+      //A validator that does not fit in the buffer can never match, so
+      //the range is ignored and the whole resource is sent
+      if(strlen(value) <= HTTP_SERVER_ETAG_MAX_LEN)
+         strcpy(connection->request.ifRange, value);
+      else
+         strcpy(connection->request.ifRange, "-");
+   }
+#endif
 }
 
 
@@ -658,6 +830,191 @@ void httpParseCookieField(HttpConnection *connection, char_t *value)
 }
 
 
+/**
+ * @brief Parse Range header field
+ *
+ * Only a single byte range is supported. A request for multiple ranges
+ * is served with the whole resource, as permitted by RFC 7233
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] value Range field value
+ **/
+
+void httpParseRangeField(HttpConnection *connection, char_t *value)
+{
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   char_t *p;
+   size_t first;
+   size_t last;
+
+   //The only range unit defined by HTTP/1.1 is bytes
+   if(strncasecmp(value, "bytes=", 6))
+      return;
+
+   //Point to the byte range set
+   value += 6;
+
+   //Multiple ranges are not supported
+   if(strchr(value, ',') != NULL)
+      return;
+
+   //Suffix byte range?
+   if(*value == '-')
+   {
+      //Get the number of bytes at the end of the resource
+      first = strtoul(value + 1, &p, 10);
+
+      //Malformed range specifier?
+      if(p == (value + 1) || *p != '\0')
+         return;
+
+      //Save the suffix length
+      connection->request.rangeSuffix = TRUE;
+      connection->request.rangeFirst = first;
+      connection->request.rangeLast = 0;
+   }
+   else
+   {
+      //Get the first byte position
+      first = strtoul(value, &p, 10);
+
+      //Malformed range specifier?
+      if(p == value || *p != '-')
+         return;
+
+      //Point to the last byte position
+      value = p + 1;
+
+      //The last byte position may be omitted
+      if(*value == '\0')
+      {
+         //The range extends to the end of the resource
+         last = (size_t) -1;
+      }
+      else
+      {
+         //Get the last byte position
+         last = strtoul(value, &p, 10);
+
+         //Malformed range specifier?
+         if(p == value || *p != '\0')
+            return;
+      }
+
+      //A range whose last byte position is less than its first byte
+      //position is invalid and must be ignored
+      if(last < first)
+         return;
+
+      //Save byte positions
+      connection->request.rangeSuffix = FALSE;
+      connection->request.rangeFirst = first;
+      connection->request.rangeLast = last;
+   }
+
+   //A valid byte range has been requested
+   connection->request.range = TRUE;
+#endif
+}
+
+
+/**
+ * @brief Select the portion of a static resource to be sent
+ *
+ * When a satisfiable byte range has been requested, the status code is set
+ * to 206. An unsatisfiable range results in a 416 status code and an empty
+ * body. Otherwise the whole resource is selected
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] length Length of the resource
+ * @param[out] offset Offset of the first byte to be sent
+ * @param[out] count Number of bytes to be sent
+ **/
+
+void httpSelectRange(HttpConnection *connection, size_t length,
+   size_t *offset, size_t *count)
+{
+   //Send the whole resource by default
+   *offset = 0;
+   *count = length;
+
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   //Advertise support for byte-range requests
+   connection->response.acceptRanges = TRUE;
+   //Save the length of the whole resource
+   connection->response.completeLength = length;
+
+   //No range requested?
+   if(!connection->request.range)
+      return;
+
+   //Conditional range request?
+   if(connection->request.ifRange[0] != '\0')
+   {
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+      //The range is honored only if the strong entity tag matches
+      //the current representation of the resource
+      if(connection->response.etag[0] == '\0' ||
+         strcmp(connection->request.ifRange, connection->response.etag))
+      {
+         return;
+      }
+#else
+      //Entity tags are not available
+      return;
+#endif
+   }
+
+   //Suffix byte range?
+   if(connection->request.rangeSuffix)
+   {
+      //A suffix length of zero cannot be satisfied
+      if(connection->request.rangeFirst > 0 && length > 0)
+      {
+         //Select the final bytes of the resource
+         *count = MIN(connection->request.rangeFirst, length);
+         *offset = length - *count;
+      }
+      else
+      {
+         //The range is not satisfiable
+         *count = 0;
+      }
+   }
+   else
+   {
+      //The first byte position must lie within the resource
+      if(connection->request.rangeFirst < length)
+      {
+         //The last byte position is truncated to the end of the resource
+         *offset = connection->request.rangeFirst;
+         *count = MIN(connection->request.rangeLast, length - 1) - *offset + 1;
+      }
+      else
+      {
+         //The range is not satisfiable
+         *count = 0;
+      }
+   }
+
+   //Satisfiable range?
+   if(*count > 0)
+   {
+      //Partial content
+      connection->response.statusCode = 206;
+      connection->response.rangeFirst = *offset;
+      connection->response.rangeLast = *offset + *count - 1;
+   }
+   else
+   {
+      //Range not satisfiable
+      connection->response.statusCode = 416;
+      *offset = 0;
+   }
+#endif
+}
+
+
 /**
  * @brief Read chunk-size field from the input stream
  * @param[in] connection Structure representing an HTTP connection
@@ -760,6 +1117,16 @@ void httpInitResponseHeader(HttpConnection *connection)
    connection->response.gzipEncoding = FALSE;
 #endif
 
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   //No entity tag
+   connection->response.etag[0] = '\0';
+#endif
+
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   //Byte-range requests are only supported for static resources
+   connection->response.acceptRanges = FALSE;
+#endif
+
 #if (HTTP_SERVER_PERSISTENT_CONN_SUPPORT == ENABLED)
    //Persistent connections are accepted
    connection->response.keepAlive = connection->request.keepAlive;
@@ -908,12 +1275,51 @@ error_t httpFormatResponseHeader(HttpConnection *connection, char_t *buffer)
    }
 #endif
 
+#if (HTTP_SERVER_CACHE_SUPPORT == ENABLED)
+   //Valid entity tag?
+   if(connection->response.etag[0] != '\0')
+   {
+      //Set ETag field
+      p += sprintf(p, "ETag: %s\r\n", connection->response.etag);
+   }
+#endif
+
+#if (HTTP_SERVER_RANGE_SUPPORT == ENABLED)
+   //Byte-range requests are accepted?
+   if(connection->response.acceptRanges)
+   {
+      //Set Accept-Ranges field
+      p += sprintf(p, "Accept-Ranges: bytes\r\n");
+
+      //Partial content?
+      if(connection->response.statusCode == 206)
+      {
+         //Set Content-Range field
+         p += sprintf(p, "Content-Range: bytes %" PRIuSIZE "-%" PRIuSIZE
+            "/%" PRIuSIZE "\r\n", connection->response.rangeFirst,
+            connection->response.rangeLast, connection->response.completeLength);
+      }
+      //Range not satisfiable?
+      else if(connection->response.statusCode == 416)
+      {
+         //Set Content-Range field
+         p += sprintf(p, "Content-Range: bytes */%" PRIuSIZE "\r\n",
+            connection->response.completeLength);
+      }
+   }
+#endif
+
    //Use chunked encoding transfer?
    if(connection->response.chunkedEncoding)
    {
       //Set Transfer-Encoding field
       p += sprintf(p, "Transfer-Encoding: chunked\r\n");
    }
+   //A 304 response cannot contain a message body
+   else if(connection->response.statusCode == 304)
+   {
+      //The Content-Length field is omitted
+   }
    //Persistent connection?
    else if(connection->response.keepAlive)
    {
@@ -988,32 +1394,87 @@ error_t httpSend(HttpConnection *connection,
 error_t httpReceive(HttpConnection *connection,
    void *data, size_t size, size_t *received, uint_t flags)
 {
-#if (NET_RTOS_SUPPORT == ENABLED)
    error_t error;
+   size_t n;
+   char_t *p;
+   char_t *q;
+
+   //Number of data bytes that are pending in the receive buffer
+   n = connection->rxBufferLen - connection->rxBufferPos;
+
+   //Data that have been read ahead while parsing the request header must
+   //be consumed first
+   if(n > 0)
+   {
+      //Point to the pending data
+      p = connection->rxBuffer + connection->rxBufferPos;
+      //Limit the number of bytes to read at a time
+      n = MIN(n, size);
+
+      //The SOCKET_FLAG_BREAK_CHAR flag causes the function to stop reading
+      //data as soon as the specified break character is encountered
+      if((flags & SOCKET_FLAG_BREAK_CHAR) != 0)
+      {
+         //Search for the specified break character
+         q = memchr(p, LSB(flags), n);
+
+         //Break character found?
+         if(q != NULL)
+         {
+            //Adjust the number of data to read
+            n = q - p + 1;
+            //The read operation is complete
+            size = n;
+         }
+      }
 
+      //Copy data to user buffer
+      memcpy(data, p, n);
+      //Advance current position
+      connection->rxBufferPos += n;
+      //Total number of data that have been read
+      *received = n;
+
+      //The read operation is complete?
+      if(n == size)
+         return NO_ERROR;
+
+      //The break character has not been found yet, so that reading goes on
+      //from the transport layer. Otherwise, the SOCKET_FLAG_WAIT_ALL flag
+      //causes the function to return only when the requested number of
+      //bytes have been read
+      if((flags & SOCKET_FLAG_BREAK_CHAR) == 0 &&
+         (flags & SOCKET_FLAG_WAIT_ALL) == 0)
+      {
+         return NO_ERROR;
+      }
+
+      //Read the remaining data from the transport layer
+      data = (uint8_t *) data + n;
+      size -= n;
+   }
+   else
+   {
+      //No data have been read yet
+      *received = 0;
+   }
+
+#if (NET_RTOS_SUPPORT == ENABLED)
 #if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
    //Check whether a secure connection is being used
    if(connection->tlsContext != NULL)
    {
       //Use TLS to receive data from the client
-      error = tlsRead(connection->tlsContext, data, size, received, flags);
+      error = tlsRead(connection->tlsContext, data, size, &n, flags);
    }
    else
 #endif
    {
       //Receive data from the client
-      error = socketReceive(connection->socket, data, size, received, flags);
+      error = socketReceive(connection->socket, data, size, &n, flags);
    }
-
-   //Return status code
-   return error;
 #else
-   error_t error;
-   char_t c;
-   size_t i;
-   size_t n;
-
-   //Number of data bytes that are pending in the receive buffer
+   //Number of data bytes that are pending in the I/O buffer
    n = connection->bufferLen - connection->bufferPos;
 
    //Any data to be copied?
@@ -1024,25 +1485,20 @@ error_t httpReceive(HttpConnection *connection,
 
       //The HTTP_FLAG_BREAK_CHAR flag causes the function to stop reading
       //data as soon as the specified break character is encountered
-      if(flags & HTTP_FLAG_BREAK_CHAR)
+      if((flags & HTTP_FLAG_BREAK_CHAR) != 0)
       {
-         //Retrieve the break character code
-         c = LSB(flags);
-
          //Search for the specified break character
-         for(i = 0; i < n && connection->buffer[connection->bufferPos + i] != c; i++);
+         q = memchr(connection->buffer + connection->bufferPos, LSB(flags), n);
 
          //Adjust the number of data to read
-         n = MIN(n, i + 1);
+         if(q != NULL)
+            n = q - (connection->buffer + connection->bufferPos) + 1;
       }
 
       //Copy data to user buffer
       memcpy(data, connection->buffer + connection->bufferPos, n);
-
       //Advance current position
       connection->bufferPos += n;
-      //Total number of data that have been read
-      *received = n;
 
       //Successful processing
       error = NO_ERROR;
@@ -1052,10 +1508,22 @@ error_t httpReceive(HttpConnection *connection,
       //No more data available...
       error = ERROR_END_OF_STREAM;
    }
+#endif
+
+   //Check status code
+   if(!error)
+   {
+      //Total number of data that have been read
+      *received += n;
+   }
+   else if(*received > 0)
+   {
+      //Report the data that have been read from the receive buffer
+      error = NO_ERROR;
+   }
 
    //Return status code
    return error;
-#endif
 }
 
 
@@ -43,8 +43,11 @@ extern "C" {
 error_t httpReadRequestHeader(HttpConnection *connection);
 error_t httpParseRequestLine(HttpConnection *connection, char_t *requestLine);
 
-error_t httpReadHeaderField(HttpConnection *connection,
-   char_t *buffer, size_t size, char_t *firstChar);
+error_t httpReadHeaderLine(HttpConnection *connection, char_t **line,
+   bool_t unfold);
+
+error_t httpReadRxBuffer(HttpConnection *connection);
+void httpCompactRxBuffer(HttpConnection *connection);
 
 void httpParseHeaderField(HttpConnection *connection,
    const char_t *name, char_t *value);
@@ -59,6 +62,10 @@ void httpParseAcceptEncodingField(HttpConnection *connection,
    char_t *value);
 
 void httpParseCookieField(HttpConnection *connection, char_t *value);
+void httpParseRangeField(HttpConnection *connection, char_t *value);
+
+void httpSelectRange(HttpConnection *connection, size_t length,
+   size_t *offset, size_t *count);
 
 error_t httpReadChunkSize(HttpConnection *connection);
 
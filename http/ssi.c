@@ -80,6 +80,9 @@ error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t l
    uint_t j;
    const char_t *data;
 #endif
+#if (HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+   HttpSsiCacheEntry *entry;
+#endif
 
    //Recursion limit exceeded?
    if(level >= HTTP_SERVER_SSI_MAX_RECURSION)
@@ -89,6 +92,25 @@ error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t l
    httpGetAbsolutePath(connection, uri,
       connection->buffer, HTTP_SERVER_BUFFER_SIZE);
 
+#if (HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+   //Retrieve the compiled form of the script
+   error = ssiGetCompiledScript(connection, connection->buffer, &entry);
+   //The specified URI cannot be found?
+   if(error)
+      return error;
+
+   //The script is held in the cache?
+   if(entry != NULL)
+   {
+      //Render the compiled script
+      error = ssiExecuteCompiledScript(connection, entry, uri, level);
+      //The compiled script is no longer in use
+      ssiReleaseCompiledScript(connection->serverContext, entry);
+      //Return status code
+      return error;
+   }
+#endif
+
 #if (HTTP_SERVER_FS_SUPPORT == ENABLED)
    //Open the file for reading
    file = fsOpenFile(connection->buffer, FS_FILE_MODE_READ);
@@ -351,6 +373,504 @@ error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t l
 }
 
 
+#if (HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Retrieve the compiled form of an SSI script
+ *
+ * Scripts are compiled once into a list of literal spans and directives.
+ * File system scripts are revalidated against the size and modification
+ * time of the file, while resources are immutable. A NULL entry is returned
+ * when the script cannot be cached, in which case the caller falls back to
+ * the streaming parser
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] path NULL-terminated string containing the full pathname
+ * @param[out] entry Pointer to the compiled script, if any
+ * @return Error code
+ **/
+
+error_t ssiGetCompiledScript(HttpConnection *connection,
+   const char_t *path, HttpSsiCacheEntry **entry)
+{
+   error_t error;
+   uint_t i;
+   HttpServerContext *context;
+   HttpSsiCacheEntry *p;
+   HttpSsiCacheEntry newEntry;
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   FsFileStat fileStat;
+#endif
+
+   //Point to the HTTP server context
+   context = connection->serverContext;
+   //No compiled script yet
+   *entry = NULL;
+
+   //Clear the scratch entry
+   memset(&newEntry, 0, sizeof(HttpSsiCacheEntry));
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //Retrieve the size and the modification time of the file
+   error = fsGetFileStat(path, &fileStat);
+   //The specified URI cannot be found?
+   if(error)
+      return ERROR_NOT_FOUND;
+
+   //Save the size and the modification time of the file
+   newEntry.size = fileStat.size;
+   newEntry.modified = fileStat.modified;
+   newEntry.length = fileStat.size;
+#else
+   //Get the resource data associated with the URI
+   error = resGetData(path, (const uint8_t **) &newEntry.data,
+      &newEntry.length);
+   //The specified URI cannot be found?
+   if(error)
+      return error;
+#endif
+
+   //The pathname is too long to be used as a key?
+   if(strlen(path) >= sizeof(newEntry.path))
+      return NO_ERROR;
+
+   //Save the pathname
+   strcpy(newEntry.path, path);
+
+   //Acquire exclusive access to the SSI cache
+   osAcquireMutex(&context->ssiCacheMutex);
+   //Search the cache for an up-to-date compiled script
+   *entry = ssiFindCompiledScript(context, &newEntry);
+   //Release exclusive access to the SSI cache
+   osReleaseMutex(&context->ssiCacheMutex);
+
+   //Cache hit?
+   if(*entry != NULL)
+      return NO_ERROR;
+
+   //Large scripts are not cached
+   if(newEntry.length > HTTP_SERVER_SSI_CACHE_MAX_FILE_SIZE)
+      return NO_ERROR;
+
+   //Read and compile the script without holding the SSI cache, so that
+   //other connections are not held up by file system accesses
+   error = ssiLoadCompiledScript(&newEntry);
+   //The script cannot be cached?
+   if(error)
+      return NO_ERROR;
+
+   //Acquire exclusive access to the SSI cache
+   osAcquireMutex(&context->ssiCacheMutex);
+
+   //Another connection may have compiled the same script meanwhile
+   *entry = ssiFindCompiledScript(context, &newEntry);
+
+   //Already cached?
+   if(*entry != NULL)
+   {
+      //Discard the newly compiled script
+      ssiFreeCompiledScript(&newEntry);
+   }
+   else
+   {
+      //Keep track of the least recently used entry
+      p = NULL;
+
+      //Loop through the SSI cache
+      for(i = 0; i < HTTP_SERVER_SSI_CACHE_SIZE; i++)
+      {
+         //Entries currently in use cannot be reclaimed
+         if(context->ssiCache[i].refCount == 0)
+         {
+            //Free entries are used first
+            if(p == NULL)
+               p = &context->ssiCache[i];
+            else if(!context->ssiCache[i].valid && p->valid)
+               p = &context->ssiCache[i];
+            else if(context->ssiCache[i].valid == p->valid &&
+               timeCompare(context->ssiCache[i].lastAccess, p->lastAccess) < 0)
+               p = &context->ssiCache[i];
+         }
+      }
+
+      //Any entry available?
+      if(p != NULL)
+      {
+         //Evict the least recently used entry
+         ssiFreeCompiledScript(p);
+
+         //Publish the newly compiled script
+         *p = newEntry;
+         p->valid = TRUE;
+         p->refCount = 1;
+         p->lastAccess = osGetSystemTime();
+
+         //Return a pointer to the compiled script
+         *entry = p;
+      }
+      else
+      {
+         //All the entries are being rendered
+         ssiFreeCompiledScript(&newEntry);
+      }
+   }
+
+   //Release exclusive access to the SSI cache
+   osReleaseMutex(&context->ssiCacheMutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Search the SSI cache for an up-to-date compiled script
+ *
+ * Outdated entries for the same pathname are invalidated. This function
+ * must be called with the SSI cache mutex held
+ *
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] key Entry holding the pathname and the current version of
+ *   the script
+ * @return Pointer to the compiled script, if any
+ **/
+
+HttpSsiCacheEntry *ssiFindCompiledScript(HttpServerContext *context,
+   const HttpSsiCacheEntry *key)
+{
+   uint_t i;
+   HttpSsiCacheEntry *p;
+
+   //Loop through the SSI cache
+   for(i = 0; i < HTTP_SERVER_SSI_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      p = &context->ssiCache[i];
+
+      //Matching pathname?
+      if(p->valid && !strcmp(p->path, key->path))
+      {
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+         //Check whether the file has been modified since it was compiled
+         if(p->size == key->size &&
+            !compareDateTime(&p->modified, &key->modified))
+#else
+         //Check whether the resource data are the same
+         if(p->data == key->data && p->length == key->length)
+#endif
+         {
+            //The script is being rendered
+            p->refCount++;
+            //Save the time at which the entry was last used
+            p->lastAccess = osGetSystemTime();
+
+            //The compiled script can be used
+            return p;
+         }
+         else
+         {
+            //Invalidate the entry. Its memory is released as soon as the
+            //connections currently rendering the script are done
+            p->valid = FALSE;
+
+            //Entry not in use?
+            if(p->refCount == 0)
+               ssiFreeCompiledScript(p);
+         }
+      }
+   }
+
+   //No up-to-date compiled script
+   return NULL;
+}
+
+
+/**
+ * @brief Read and compile an SSI script
+ * @param[in,out] entry Entry holding the pathname and the length of the
+ *   script. The contents and the list of spans are filled in
+ * @return Error code
+ **/
+
+error_t ssiLoadCompiledScript(HttpSsiCacheEntry *entry)
+{
+   uint_t numSpans;
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   error_t error;
+   size_t i;
+   size_t n;
+   char_t *buffer;
+   FsFile *file;
+
+   //Allocate a memory buffer to hold the contents of the file
+   buffer = osAllocMem(entry->length + 1);
+   //Failed to allocate memory?
+   if(buffer == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Open the file for reading
+   file = fsOpenFile(entry->path, FS_FILE_MODE_READ);
+
+   //Valid file handle?
+   if(file != NULL)
+   {
+      //Read the whole file
+      for(i = 0; i < entry->length; i += n)
+      {
+         //Read data from the specified file
+         error = fsReadFile(file, buffer + i, entry->length - i, &n);
+         //Any error to report?
+         if(error || n == 0)
+            break;
+      }
+
+      //Close the file
+      fsCloseFile(file);
+   }
+
+   //The file could not be read entirely?
+   if(file == NULL || i < entry->length)
+   {
+      //Release memory buffer
+      osFreeMem(buffer);
+      //Report an error
+      return ERROR_NOT_FOUND;
+   }
+
+   //Save the contents of the file
+   entry->data = buffer;
+#endif
+
+   //Determine the number of spans
+   numSpans = ssiCompileScript(entry->data, entry->length, NULL);
+
+   //Allocate the list of spans
+   entry->spans = osAllocMem(MAX(numSpans, 1) * sizeof(HttpSsiSpan));
+
+   //Failed to allocate memory?
+   if(entry->spans == NULL)
+   {
+      //Clean up side effects
+      ssiFreeCompiledScript(entry);
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Compile the script
+   entry->numSpans = ssiCompileScript(entry->data, entry->length,
+      entry->spans);
+
+   //Debug message
+   TRACE_DEBUG("SSI script %s compiled (%u spans)\r\n", entry->path,
+      entry->numSpans);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release a compiled SSI script after rendering
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] entry Pointer to the compiled script
+ **/
+
+void ssiReleaseCompiledScript(HttpServerContext *context,
+   HttpSsiCacheEntry *entry)
+{
+   //Acquire exclusive access to the SSI cache
+   osAcquireMutex(&context->ssiCacheMutex);
+
+   //The script is no longer rendered by this connection
+   if(entry->refCount > 0)
+      entry->refCount--;
+
+   //Release the memory of an outdated script as soon as it is unused
+   if(!entry->valid && entry->refCount == 0)
+      ssiFreeCompiledScript(entry);
+
+   //Release exclusive access to the SSI cache
+   osReleaseMutex(&context->ssiCacheMutex);
+}
+
+
+/**
+ * @brief Release the memory held by a compiled SSI script
+ * @param[in] entry Pointer to the compiled script
+ **/
+
+void ssiFreeCompiledScript(HttpSsiCacheEntry *entry)
+{
+   //Release the list of spans
+   if(entry->spans != NULL)
+   {
+      osFreeMem(entry->spans);
+      entry->spans = NULL;
+   }
+
+#if (HTTP_SERVER_FS_SUPPORT == ENABLED)
+   //Release the copy of the file contents
+   if(entry->data != NULL)
+      osFreeMem((char_t *) entry->data);
+#endif
+
+   //Clear the entry
+   entry->data = NULL;
+   entry->length = 0;
+   entry->numSpans = 0;
+}
+
+
+/**
+ * @brief Compile an SSI script into literal spans and directives
+ * @param[in] data Pointer to the contents of the script
+ * @param[in] length Length of the script
+ * @param[out] spans List of spans (NULL to only count them)
+ * @return Number of spans
+ **/
+
+uint_t ssiCompileScript(const char_t *data, size_t length, HttpSsiSpan *spans)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   size_t pos;
+
+   //Number of spans
+   n = 0;
+
+   //Parse the specified script
+   for(pos = 0; pos < length; )
+   {
+      //Search for any SSI tags
+      error = ssiSearchTag(data + pos, length - pos, "<!--#", 5, &i);
+
+      //Opening identifier found?
+      if(!error)
+      {
+         //Search for the comment terminator
+         error = ssiSearchTag(data + pos + i + 5, length - pos - i - 5,
+            "-->", 3, &j);
+      }
+
+      //Check whether a valid SSI tag has been found?
+      if(!error)
+      {
+         //Literal text that precedes the tag
+         if(i > 0)
+         {
+            if(spans != NULL)
+            {
+               spans[n].directive = FALSE;
+               spans[n].offset = pos;
+               spans[n].length = i;
+            }
+
+            n++;
+         }
+
+         //SSI directive, without the opening identifier and the terminator
+         if(spans != NULL)
+         {
+            spans[n].directive = TRUE;
+            spans[n].offset = pos + i + 5;
+            spans[n].length = j;
+         }
+
+         n++;
+
+         //Advance data pointer over the SSI tag
+         pos += i + 5 + j + 3;
+      }
+      else
+      {
+         //The rest of the script is literal text
+         if(spans != NULL)
+         {
+            spans[n].directive = FALSE;
+            spans[n].offset = pos;
+            spans[n].length = length - pos;
+         }
+
+         n++;
+
+         //End of script
+         pos = length;
+      }
+   }
+
+   //Return the number of spans
+   return n;
+}
+
+
+/**
+ * @brief Render a compiled SSI script
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] entry Pointer to the compiled script
+ * @param[in] uri NULL-terminated string containing the file being processed
+ * @param[in] level Current level of recursion
+ * @return Error code
+ **/
+
+error_t ssiExecuteCompiledScript(HttpConnection *connection,
+   HttpSsiCacheEntry *entry, const char_t *uri, uint_t level)
+{
+   error_t error;
+   uint_t i;
+   HttpSsiSpan *span;
+
+   //Send the HTTP response header before executing the script
+   if(!level)
+   {
+      //Format HTTP response header
+      connection->response.statusCode = 200;
+      connection->response.contentType = mimeGetType(uri);
+      connection->response.chunkedEncoding = TRUE;
+
+      //Send the header to the client
+      error = httpWriteHeader(connection);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Walk through the compiled script
+   for(i = 0; i < entry->numSpans && !error; i++)
+   {
+      //Point to the current span
+      span = &entry->spans[i];
+
+      //SSI directive?
+      if(span->directive)
+      {
+         //Only the dynamic parts of the page are processed
+         error = ssiProcessCommand(connection, entry->data + span->offset,
+            span->length, uri, level);
+      }
+      else
+      {
+         //Literal text is sent directly from the script contents
+         error = httpWriteStream(connection, entry->data + span->offset,
+            span->length);
+      }
+   }
+
+   //Properly close the output stream
+   if(!level && error == NO_ERROR)
+      error = httpCloseStream(connection);
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
 /**
  * @brief Process SSI directive
  * @param[in] connection Structure representing an HTTP connection
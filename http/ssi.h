@@ -42,6 +42,24 @@ extern "C" {
 //SSI related functions
 error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t level);
 
+error_t ssiGetCompiledScript(HttpConnection *connection,
+   const char_t *path, HttpSsiCacheEntry **entry);
+
+HttpSsiCacheEntry *ssiFindCompiledScript(HttpServerContext *context,
+   const HttpSsiCacheEntry *key);
+
+error_t ssiLoadCompiledScript(HttpSsiCacheEntry *entry);
+
+void ssiReleaseCompiledScript(HttpServerContext *context,
+   HttpSsiCacheEntry *entry);
+
+void ssiFreeCompiledScript(HttpSsiCacheEntry *entry);
+
+uint_t ssiCompileScript(const char_t *data, size_t length, HttpSsiSpan *spans);
+
+error_t ssiExecuteCompiledScript(HttpConnection *connection,
+   HttpSsiCacheEntry *entry, const char_t *uri, uint_t level);
+
 error_t ssiProcessCommand(HttpConnection *connection,
    const char_t *tag, size_t length, const char_t *uri, uint_t level);
 
@@ -35,8 +35,10 @@
 #include <string.h>
 #include "core/net.h"
 #include "core/ip.h"
+#include "core/tcp_misc.h"
 #include "ipv4/ipv4.h"
 #include "ipv4/ipv4_misc.h"
+#include "ipv4/ipv4_pmtu.h"
 #include "ipv4/icmp.h"
 #include "mibs/mib2_module.h"
 #include "mibs/ip_mib_module.h"
@@ -117,6 +119,11 @@ void icmpProcessMessage(NetInterface *interface,
       //Process Echo Request message
       icmpProcessEchoRequest(interface, requestPseudoHeader, buffer, offset);
       break;
+   //Destination Unreachable?
+   case ICMP_TYPE_DEST_UNREACHABLE:
+      //Process Destination Unreachable message
+      icmpProcessDestUnreachable(interface, requestPseudoHeader, buffer, offset);
+      break;
    //Unknown type?
    default:
       //Debug message
@@ -250,6 +257,129 @@ void icmpProcessEchoRequest(NetInterface *interface,
 }
 
 
+/**
+ * @brief Destination Unreachable message processing
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader IPv4 pseudo header
+ * @param[in] buffer Multi-part buffer containing the incoming message
+ * @param[in] offset Offset to the first byte of the message
+ **/
+
+void icmpProcessDestUnreachable(NetInterface *interface,
+   Ipv4PseudoHeader *pseudoHeader, const NetBuffer *buffer, size_t offset)
+{
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+   size_t length;
+   size_t headerLength;
+   size_t mtu;
+   IcmpFragNeededMessage *message;
+   Ipv4Header *ipHeader;
+#if (TCP_SUPPORT == ENABLED)
+   IpAddr localIpAddr;
+   IpAddr remoteIpAddr;
+   TcpHeader *tcpHeader;
+#endif
+
+   //Retrieve the length of the message
+   length = netBufferGetLength(buffer) - offset;
+
+   //The message must include the IP header of the original datagram
+   if(length < (sizeof(IcmpFragNeededMessage) + sizeof(Ipv4Header)))
+      return;
+
+   //Point to the message header
+   message = netBufferAt(buffer, offset);
+   //Sanity check
+   if(message == NULL)
+      return;
+
+   //Debug message
+   TRACE_INFO("ICMP Destination Unreachable message received (%" PRIuSIZE " bytes)...\r\n", length);
+   //Dump message contents for debugging purpose
+   icmpDumpErrorMessage((IcmpErrorMessage *) message);
+
+   //Only Fragmentation Needed messages are of interest
+   if(message->code != ICMP_CODE_FRAG_NEEDED_AND_DF_SET)
+      return;
+
+   //Point to the IP header of the original datagram
+   ipHeader = netBufferAt(buffer, offset + sizeof(IcmpFragNeededMessage));
+   //Sanity check
+   if(ipHeader == NULL)
+      return;
+
+   //The original datagram must have been sent by the local host
+   if(ipv4CheckDestAddr(interface, ipHeader->srcAddr))
+      return;
+
+   //Retrieve the length of the quoted IP header
+   headerLength = ipHeader->headerLength * 4;
+
+   //Check the length of the quoted IP header
+   if(headerLength < sizeof(Ipv4Header))
+      return;
+
+#if (TCP_SUPPORT == ENABLED)
+   //TCP segment?
+   if(ipHeader->protocol == IPV4_PROTOCOL_TCP)
+   {
+      //The message must include the first 8 bytes of the TCP header
+      if(length < (sizeof(IcmpFragNeededMessage) + headerLength + 8))
+         return;
+
+      //Point to the quoted TCP header
+      tcpHeader = netBufferAt(buffer, offset + sizeof(IcmpFragNeededMessage) +
+         headerLength);
+      //Sanity check
+      if(tcpHeader == NULL)
+         return;
+
+      //Source address of the original datagram
+      localIpAddr.length = sizeof(Ipv4Addr);
+      localIpAddr.ipv4Addr = ipHeader->srcAddr;
+
+      //Destination address of the original datagram
+      remoteIpAddr.length = sizeof(Ipv4Addr);
+      remoteIpAddr.ipv4Addr = ipHeader->destAddr;
+
+      //Messages that do not refer to in-flight data of an existing
+      //connection are silently discarded (refer to RFC 5927, section 4.1)
+      if(!tcpCheckIcmpError(interface, &localIpAddr, &remoteIpAddr,
+         tcpHeader))
+      {
+         //Debug message
+         TRACE_WARNING("ICMP Fragmentation Needed message discarded!\r\n");
+         return;
+      }
+   }
+#endif
+
+   //Retrieve the Next-Hop MTU
+   mtu = ntohs(message->nextHopMtu);
+
+   //Routers that do not implement RFC 1191 set the Next-Hop MTU field to
+   //zero. In that case, the PMTU is estimated using the plateau table
+   if(mtu == 0 || mtu >= ntohs(ipHeader->totalLength))
+      mtu = ipv4GetPlateauMtu(ntohs(ipHeader->totalLength));
+
+   //Debug message
+   TRACE_INFO("Next-Hop MTU = %" PRIuSIZE "\r\n", mtu);
+
+   //Update the PMTU for the specified destination address
+   ipv4UpdatePathMtu(interface, ipHeader->destAddr, mtu);
+
+#if (TCP_SUPPORT == ENABLED)
+   //TCP segment?
+   if(ipHeader->protocol == IPV4_PROTOCOL_TCP)
+   {
+      //Adjust the SMSS of the connections using the same path
+      tcpProcessPathMtuChange(interface, &remoteIpAddr);
+   }
+#endif
+#endif
+}
+
+
 /**
  * @brief Send an ICMP Error message
  * @param[in] interface Underlying network interface
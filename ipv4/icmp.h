@@ -140,6 +140,21 @@ typedef __start_packed struct
 } __end_packed IcmpDestUnreachableMessage;
 
 
+/**
+ * @brief ICMP Fragmentation Needed message
+ **/
+
+typedef __start_packed struct
+{
+   uint8_t type;        //0
+   uint8_t code;        //1
+   uint16_t checksum;   //2-3
+   uint16_t unused;     //4-5
+   uint16_t nextHopMtu; //6-7
+   uint8_t data[];      //8
+} __end_packed IcmpFragNeededMessage;
+
+
 /**
  * @brief ICMP Time Exceeded message
  **/
@@ -199,6 +214,9 @@ void icmpProcessEchoRequest(NetInterface *interface,
    Ipv4PseudoHeader *requestPseudoHeader, const NetBuffer *request,
    size_t requestOffset);
 
+void icmpProcessDestUnreachable(NetInterface *interface,
+   Ipv4PseudoHeader *pseudoHeader, const NetBuffer *buffer, size_t offset);
+
 error_t icmpSendErrorMessage(NetInterface *interface, uint8_t type, uint8_t code,
    uint8_t parameter, const NetBuffer *ipPacket, size_t ipPacketOffset);
 
@@ -49,6 +49,8 @@
 #include "ipv4/arp.h"
 #include "ipv4/ipv4.h"
 #include "ipv4/ipv4_misc.h"
+#include "ipv4/ipv4_pmtu.h"
+#include "ipv4/ipv4_template.h"
 #include "ipv4/ipv4_routing.h"
 #include "ipv4/icmp.h"
 #include "ipv4/igmp.h"
@@ -102,6 +104,15 @@ error_t ipv4Init(NetInterface *interface)
 #if (IPV4_FRAG_SUPPORT == ENABLED)
    //Initialize the reassembly queue
    memset(context->fragQueue, 0, sizeof(context->fragQueue));
+   memset(context->fragHashTable, 0, sizeof(context->fragHashTable));
+   context->fragMemSize = 0;
+   //Clear reassembly statistics
+   memset(&context->fragStats, 0, sizeof(context->fragStats));
+#endif
+
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+   //Initialize the PMTU cache
+   ipv4FlushPathMtuCache(interface);
 #endif
 
    //Successful initialization
@@ -175,6 +186,11 @@ error_t ipv4SetHostAddrEx(NetInterface *interface, uint_t index, Ipv4Addr addr)
    mdnsResponderStartProbing(interface->mdnsResponderContext);
 #endif
 
+#if (IPV4_TEMPLATE_SUPPORT == ENABLED)
+   //The next hop of connected sockets may have changed
+   ipv4InvalidateTemplates(interface);
+#endif
+
    //Release exclusive access
    osReleaseMutex(&netMutex);
 
@@ -284,6 +300,10 @@ error_t ipv4SetSubnetMaskEx(NetInterface *interface, uint_t index, Ipv4Addr mask
    osAcquireMutex(&netMutex);
    //Set up subnet mask
    interface->ipv4Context.addrList[index].subnetMask = mask;
+#if (IPV4_TEMPLATE_SUPPORT == ENABLED)
+   //The next hop of connected sockets may have changed
+   ipv4InvalidateTemplates(interface);
+#endif
    //Release exclusive access
    osReleaseMutex(&netMutex);
 
@@ -382,6 +402,10 @@ error_t ipv4SetDefaultGatewayEx(NetInterface *interface, uint_t index,
    osAcquireMutex(&netMutex);
    //Set up default gateway address
    interface->ipv4Context.addrList[index].defaultGateway = addr;
+#if (IPV4_TEMPLATE_SUPPORT == ENABLED)
+   //The next hop of connected sockets may have changed
+   ipv4InvalidateTemplates(interface);
+#endif
    //Release exclusive access
    osReleaseMutex(&netMutex);
 
@@ -538,6 +562,16 @@ void ipv4LinkChangeEvent(NetInterface *interface)
    ipv4FlushFragQueue(interface);
 #endif
 
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+   //Flush the PMTU cache
+   ipv4FlushPathMtuCache(interface);
+#endif
+
+#if (IPV4_TEMPLATE_SUPPORT == ENABLED)
+   //Header templates must be rebuilt
+   ipv4InvalidateTemplates(interface);
+#endif
+
 #if (IGMP_SUPPORT == ENABLED)
    //Notify IGMP of link state changes
    igmpLinkChangeEvent(interface);
@@ -880,6 +914,7 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
 {
    error_t error;
    size_t length;
+   size_t pathMtu;
    uint16_t id;
 
    //Total number of IP datagrams which local IP user-protocols supplied to IP
@@ -904,22 +939,42 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
    //fragments of an original IP datagram
    id = interface->ipv4Context.identification++;
 
-   //If the payload length is smaller than the network
-   //interface MTU then no fragmentation is needed
-   if((length + sizeof(Ipv4Header)) <= interface->ipv4Context.linkMtu)
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+   //Retrieve the PMTU for the specified destination address
+   pathMtu = ipv4GetPathMtu(interface, pseudoHeader->destAddr);
+#else
+   //The PMTU value for the path is assumed to be the MTU of the first-hop link
+   pathMtu = interface->ipv4Context.linkMtu;
+#endif
+
+   //If the payload length is smaller than the PMTU then no fragmentation
+   //is needed
+   if((length + sizeof(Ipv4Header)) <= pathMtu)
    {
-      //Send data as is
-      error = ipv4SendPacket(interface, pseudoHeader, id, 0, buffer, offset,
-         flags);
+      //The DF bit is set in the IP header when performing Path MTU Discovery
+      //(refer to RFC 1191, section 3)
+      if((flags & IP_FLAG_DONT_FRAG) != 0)
+      {
+         //Send data as is, and prevent intermediate routers from fragmenting
+         //the datagram
+         error = ipv4SendPacket(interface, pseudoHeader, id, IPV4_FLAG_DF,
+            buffer, offset, flags);
+      }
+      else
+      {
+         //Send data as is
+         error = ipv4SendPacket(interface, pseudoHeader, id, 0, buffer, offset,
+            flags);
+      }
    }
-   //If the payload length exceeds the network interface MTU
-   //then the device must fragment the data
+   //If the payload length exceeds the PMTU then the device must fragment
+   //the data
    else
    {
 #if (IPV4_FRAG_SUPPORT == ENABLED)
       //Fragment IP datagram into smaller packets
       error = ipv4FragmentDatagram(interface, pseudoHeader, id, buffer, offset,
-         flags);
+         pathMtu, flags);
 #else
       //Fragmentation is not supported
       error = ERROR_MESSAGE_TOO_LONG;
@@ -79,6 +79,13 @@ struct _Ipv4PseudoHeader;
    #error IPV4_MULTICAST_FILTER_SIZE parameter is not valid
 #endif
 
+//Header templates for connected sockets
+#ifndef IPV4_TEMPLATE_SUPPORT
+   #define IPV4_TEMPLATE_SUPPORT DISABLED
+#elif (IPV4_TEMPLATE_SUPPORT != ENABLED && IPV4_TEMPLATE_SUPPORT != DISABLED)
+   #error IPV4_TEMPLATE_SUPPORT parameter is not valid
+#endif
+
 //Version number for IPv4
 #define IPV4_VERSION 4
 //Minimum MTU
@@ -344,8 +351,14 @@ typedef struct
    Ipv4AddrEntry addrList[IPV4_ADDR_LIST_SIZE];                 ///<IPv4 address list
    Ipv4Addr dnsServerList[IPV4_DNS_SERVER_LIST_SIZE];           ///<DNS servers
    Ipv4FilterEntry multicastFilter[IPV4_MULTICAST_FILTER_SIZE]; ///<Multicast filter table
+#if (IPV4_TEMPLATE_SUPPORT == ENABLED)
+   uint_t templateGeneration;                                   ///<Incremented whenever header templates must be rebuilt
+#endif
 #if (IPV4_FRAG_SUPPORT == ENABLED)
    Ipv4FragDesc fragQueue[IPV4_MAX_FRAG_DATAGRAMS];             ///<IPv4 fragment reassembly queue
+   Ipv4FragDesc *fragHashTable[IPV4_FRAG_HASH_TABLE_SIZE];      ///<Hash table used to locate datagrams being reassembled
+   size_t fragMemSize;                                          ///<Amount of memory used by the reassembly queue
+   Ipv4FragStats fragStats;                                     ///<Reassembly statistics
 #endif
 } Ipv4Context;
 
@@ -31,7 +31,7 @@
  * transmission unit (MTU) than the original datagram size. Refer to the
  * following RFCs for complete details:
  * - RFC 791: Internet Protocol specification
- * - RFC 815: IP datagram reassembly algorithms
+ * - RFC 1858: Security Considerations for IP Fragment Filtering
  *
  * @author Oryx Embedded SARL (www.oryx-embedded.com)
  * @version 1.9.6
@@ -64,13 +64,14 @@ systime_t ipv4FragTickCounter;
  * @param[in] id Fragment identification
  * @param[in] payload Multi-part buffer containing the payload
  * @param[in] payloadOffset Offset to the first payload byte
+ * @param[in] pathMtu PMTU value
  * @param[in] flags Set of flags that influences the behavior of this function
  * @return Error code
  **/
 
 error_t ipv4FragmentDatagram(NetInterface *interface,
    Ipv4PseudoHeader *pseudoHeader, uint16_t id, const NetBuffer *payload,
-   size_t payloadOffset, uint_t flags)
+   size_t payloadOffset, size_t pathMtu, uint_t flags)
 {
    error_t error;
    size_t offset;
@@ -93,8 +94,11 @@ error_t ipv4FragmentDatagram(NetInterface *interface,
    if(!fragment)
       return ERROR_OUT_OF_MEMORY;
 
+   //The node should never set its PMTU estimate below the IPv4 minimum MTU
+   pathMtu = MAX(pathMtu, IPV4_MINIMUM_MTU);
+
    //Determine the maximum payload size for fragmented packets
-   maxFragmentSize = interface->ipv4Context.linkMtu - sizeof(Ipv4Header);
+   maxFragmentSize = pathMtu - sizeof(Ipv4Header);
    //The size shall be a multiple of 8-byte blocks
    maxFragmentSize -= (maxFragmentSize % 8);
 
@@ -171,6 +175,11 @@ error_t ipv4FragmentDatagram(NetInterface *interface,
 
 /**
  * @brief IPv4 datagram reassembly algorithm
+ *
+ * Each fragment is copied once into a chunk sized to its payload. The
+ * chunks are linked in offset order so that the reassembled datagram can
+ * be passed to the upper layer without any further copy
+ *
  * @param[in] interface Underlying network interface
  * @param[in] packet Pointer to the IPv4 fragmented packet
  * @param[in] length Packet length including header and payload
@@ -180,12 +189,15 @@ void ipv4ReassembleDatagram(NetInterface *interface,
    const Ipv4Header *packet, size_t length)
 {
    error_t error;
+   uint_t i;
    uint16_t offset;
-   uint16_t dataFirst;
-   uint16_t dataLast;
+   size_t first;
+   size_t last;
+   size_t dataStart;
+   size_t dataFirst;
+   size_t dataLast;
+   const uint8_t *data;
    Ipv4FragDesc *frag;
-   Ipv4HoleDesc *hole;
-   Ipv4HoleDesc *prevHole;
 
    //Number of IP fragments received which needed to be reassembled
    MIB2_INC_COUNTER32(ipGroup.ipReasmReqds, 1);
@@ -209,10 +221,14 @@ void ipv4ReassembleDatagram(NetInterface *interface,
       return;
    }
 
+   //Point to the payload of the fragment
+   data = IPV4_DATA(packet);
+
    //Calculate the index of the first byte
-   dataFirst = (offset & IPV4_OFFSET_MASK) * 8;
+   dataStart = (offset & IPV4_OFFSET_MASK) * 8;
+   dataFirst = dataStart;
    //Calculate the index immediately following the last byte
-   dataLast = dataFirst + (uint16_t) length;
+   dataLast = dataFirst + length;
 
    //Search for a matching IP datagram being reassembled
    frag = ipv4SearchFragQueue(interface, packet);
@@ -229,193 +245,133 @@ void ipv4ReassembleDatagram(NetInterface *interface,
       return;
    }
 
-   //The very first fragment requires special handling
-   if(!(offset & IPV4_OFFSET_MASK))
-   {
-      //Calculate the length of the IP header including options
-      frag->headerLength = packet->headerLength * 4;
-
-      //Enforce the size of the reconstructed datagram
-      if((frag->headerLength + frag->dataLen) > IPV4_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Number of failures detected by the IP reassembly algorithm
-         MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+   //Initialize status code
+   error = NO_ERROR;
 
-      //Make sure the IP header entirely fits in the first chunk
-      if(frag->headerLength > frag->buffer.chunk[0].size)
+   //Start of exception handling block
+   do
+   {
+      //The very first fragment requires special handling
+      if(!(offset & IPV4_OFFSET_MASK))
       {
-         //Number of failures detected by the IP reassembly algorithm
-         MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
+         //Always take the IP header from the first fragment
+         error = ipv4CopyFragHeader(interface, frag, packet);
+         //Any error to report?
+         if(error)
+            break;
       }
 
-      //Fix the length of the first chunk
-      frag->buffer.chunk[0].length = (uint16_t) frag->headerLength;
-      //Always take the IP header from the first fragment
-      netBufferWrite((NetBuffer *) &frag->buffer, 0, packet, frag->headerLength);
-   }
-
-   //It may be necessary to increase the size of the buffer...
-   if(dataLast > frag->dataLen)
-   {
       //Enforce the size of the reconstructed datagram
       if((frag->headerLength + dataLast) > IPV4_MAX_FRAG_DATAGRAM_SIZE)
       {
-         //Number of failures detected by the IP reassembly algorithm
-         MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
-
-      //Adjust the size of the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->headerLength + dataLast + sizeof(Ipv4HoleDesc));
-
-      //Any error to report?
-      if(error)
-      {
-         //Number of failures detected by the IP reassembly algorithm
-         MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
+         //Report an error
+         error = ERROR_INVALID_LENGTH;
+         break;
       }
 
-      //Actual length of the payload
-      frag->dataLen = dataLast;
-   }
-
-   //Select the first hole descriptor from the list
-   hole = ipv4FindHole(frag, frag->firstHole);
-   //Keep track of the previous hole in the list
-   prevHole = NULL;
-
-   //Iterate through the hole descriptors
-   while(hole != NULL)
-   {
-      //Save lower and upper boundaries for later use
-      uint16_t holeFirst = hole->first;
-      uint16_t holeLast = hole->last;
-
-      //Check whether the newly arrived fragment interacts with this hole
-      //in some way
-      if(dataFirst < holeLast && dataLast > holeFirst)
+      //Last fragment?
+      if(!(offset & IPV4_FLAG_MF))
       {
-         //The current descriptor is no longer valid. We will destroy it,
-         //and in the next two steps, we will determine whether or not it
-         //is necessary to create any new hole descriptors
-         if(prevHole != NULL)
-            prevHole->next = hole->next;
-         else
-            frag->firstHole = hole->next;
-
-         //Is there still a hole at the beginning of the segment?
-         if(dataFirst > holeFirst)
+         //Check whether the total length of the datagram is consistent with
+         //the fragments that have already been received
+         if(frag->dataLen != 0 && frag->dataLen != dataLast)
          {
-            //Create a new entry that describes this hole
-            hole = ipv4FindHole(frag, holeFirst);
-            hole->first = holeFirst;
-            hole->last = dataFirst;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
+            //Report an error
+            error = ERROR_INVALID_LENGTH;
+            break;
          }
 
-         //Is there still a hole at the end of the segment?
-         if(dataLast < holeLast && (offset & IPV4_FLAG_MF))
+         //Any data beyond the end of the datagram?
+         if(frag->buffer.chunkCount > 1)
          {
-            //Create a new entry that describes this hole
-            hole = ipv4FindHole(frag, dataLast);
-            hole->first = dataLast;
-            hole->last = holeLast;
+            //Retrieve the last fragment received so far
+            i = frag->buffer.chunkCount - 1;
 
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
+            //Check the offset of the last byte
+            if((frag->chunkOffset[i] + frag->buffer.chunk[i].length) > dataLast)
             {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
+               //Report an error
+               error = ERROR_INVALID_LENGTH;
+               break;
             }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
          }
+
+         //The total length of the payload is now known
+         frag->dataLen = dataLast;
       }
-      else
+      else if(frag->dataLen != 0 && dataLast > frag->dataLen)
       {
-         //The newly arrived fragment does not interact with the current hole
-         prevHole = hole;
+         //The fragment extends beyond the end of the datagram
+         error = ERROR_INVALID_LENGTH;
+         break;
       }
 
-      //Select the next hole descriptor from the list
-      hole = ipv4FindHole(frag, prevHole ? prevHole->next : frag->firstHole);
-   }
+      //Loop through the fragments that have been received so far. Any
+      //portion of the new fragment that overlaps existing data is discarded
+      for(i = 1; i < frag->buffer.chunkCount && dataFirst < dataLast; i++)
+      {
+         //Range covered by the current fragment
+         first = frag->chunkOffset[i];
+         last = first + frag->buffer.chunk[i].length;
 
-   //Copy data from the fragment to the reassembly buffer
-   netBufferWrite((NetBuffer *) &frag->buffer,
-      frag->headerLength + dataFirst, IPV4_DATA(packet), length);
+         //The current fragment lies before the new data?
+         if(last <= dataFirst)
+            continue;
+         //The current fragment lies after the new data?
+         if(first >= dataLast)
+            break;
 
-   //Dump hole descriptor list
-   ipv4DumpHoleList(frag);
+         //Is there any data to insert before the current fragment?
+         if(dataFirst < first)
+         {
+            //Insert the corresponding portion of the new fragment
+            error = ipv4InsertFragment(interface, frag, i, dataFirst,
+               data + (dataFirst - dataStart), first - dataFirst);
+            //Any error to report?
+            if(error)
+               break;
+
+            //Skip the newly inserted chunk
+            i++;
+         }
 
-   //If the hole descriptor list is empty, the reassembly process is now complete
-   if(!ipv4FindHole(frag, frag->firstHole))
-   {
-      //Discard the extra hole descriptor that follows the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->headerLength + frag->dataLen);
+         //Skip the data that have already been received
+         dataFirst = last;
+      }
 
       //Check status code
       if(error)
+         break;
+
+      //Any remaining data?
+      if(dataFirst < dataLast)
       {
-         //Number of failures detected by the IP reassembly algorithm
-         MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+         //Insert the remaining portion of the new fragment
+         error = ipv4InsertFragment(interface, frag, i, dataFirst,
+            data + (dataFirst - dataStart), dataLast - dataFirst);
+         //Any error to report?
+         if(error)
+            break;
       }
-      else
+
+      //Dump the list of fragments
+      ipv4DumpFragList(frag);
+
+      //Check whether the reassembly process is now complete
+      if(frag->dataLen > 0 && frag->receivedLen == frag->dataLen)
       {
          //Point to the IP header
-         Ipv4Header *datagram = netBufferAt((NetBuffer *) &frag->buffer, 0);
+         Ipv4Header *datagram = frag->buffer.chunk[0].address;
+
+         //Upper-layer headers must not span several fragments (refer to
+         //RFC 1858, section 3.2)
+         if(frag->buffer.chunk[1].length < MIN(frag->dataLen,
+            IPV4_FRAG_MIN_FIRST_LENGTH))
+         {
+            //Report an error
+            error = ERROR_INVALID_LENGTH;
+            break;
+         }
 
          //Fix IP header
          datagram->totalLength = htons(frag->headerLength + frag->dataLen);
@@ -427,12 +383,27 @@ void ipv4ReassembleDatagram(NetInterface *interface,
          IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmOKs, 1);
          IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmOKs, 1);
 
-         //Pass the original IPv4 datagram to the higher protocol layer
+         //Pass the original IPv4 datagram to the higher protocol layer. The
+         //chunks of the reassembly buffer are handed over without any copy
          ipv4ProcessDatagram(interface, (NetBuffer *) &frag->buffer);
+
+         //Release previously allocated memory
+         ipv4DeleteFragDesc(interface, frag);
       }
 
-      //Release previously allocated memory
-      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Number of failures detected by the IP reassembly algorithm
+      MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Drop the partially reconstructed datagram
+      ipv4DeleteFragDesc(interface, frag);
    }
 }
 
@@ -451,7 +422,7 @@ void ipv4FragTick(NetInterface *interface)
    error_t error;
    uint_t i;
    systime_t time;
-   Ipv4HoleDesc *hole;
+   Ipv4FragDesc *frag;
 
    //Get current time
    time = osGetSystemTime();
@@ -460,7 +431,7 @@ void ipv4FragTick(NetInterface *interface)
    for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
    {
       //Point to the current entry in the reassembly queue
-      Ipv4FragDesc *frag = &interface->ipv4Context.fragQueue[i];
+      frag = &interface->ipv4Context.fragQueue[i];
 
       //Make sure the entry is currently in use
       if(frag->buffer.chunkCount > 0)
@@ -479,16 +450,16 @@ void ipv4FragTick(NetInterface *interface)
             IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
             IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
 
-            //Point to the first hole descriptor
-            hole = ipv4FindHole(frag, frag->firstHole);
+            //Number of datagrams discarded because of a reassembly timeout
+            interface->ipv4Context.fragStats.reasmTimeouts++;
 
             //Make sure the fragment zero has been received
             //before sending an ICMP message
-            if(hole != NULL && hole->first > 0)
+            if(frag->buffer.chunkCount > 1 && frag->chunkOffset[1] == 0)
             {
                //Fix the size of the reconstructed datagram
                error = netBufferSetLength((NetBuffer *) &frag->buffer,
-                  frag->headerLength + hole->first);
+                  frag->headerLength + frag->buffer.chunk[1].length);
 
                //Check status code
                if(!error)
@@ -500,7 +471,7 @@ void ipv4FragTick(NetInterface *interface)
             }
 
             //Drop the partially reconstructed datagram
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+            ipv4DeleteFragDesc(interface, frag);
          }
       }
    }
@@ -519,155 +490,397 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface,
 {
    error_t error;
    uint_t i;
+   uint_t h;
    Ipv4Header *datagram;
    Ipv4FragDesc *frag;
-   Ipv4HoleDesc *hole;
+   Ipv4Context *context;
 
-   //Search for a matching IP datagram being reassembled
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+
+   //Calculate the hash value of the datagram
+   h = ipv4FragHash(packet);
+
+   //Search the corresponding bucket for a matching IP datagram
+   for(frag = context->fragHashTable[h]; frag != NULL; frag = frag->next)
+   {
+      //Point to the corresponding datagram
+      datagram = frag->buffer.chunk[0].address;
+
+      //Check source and destination addresses
+      if(datagram->srcAddr != packet->srcAddr)
+         continue;
+      if(datagram->destAddr != packet->destAddr)
+         continue;
+      //Compare identification and protocol fields
+      if(datagram->identification != packet->identification)
+         continue;
+      if(datagram->protocol != packet->protocol)
+         continue;
+
+      //A matching entry has been found in the reassembly queue
+      return frag;
+   }
+
+   //If the current packet does not match an existing entry
+   //in the reassembly queue, then create a new entry
    for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
    {
       //Point to the current entry in the reassembly queue
-      frag = &interface->ipv4Context.fragQueue[i];
+      frag = &context->fragQueue[i];
 
-      //Check whether the current entry is used?
-      if(frag->buffer.chunkCount > 0)
-      {
-         //Point to the corresponding datagram
-         datagram = netBufferAt((NetBuffer *) &frag->buffer, 0);
+      //The current entry is free?
+      if(!frag->buffer.chunkCount)
+         break;
+   }
 
-         //Check source and destination addresses
-         if(datagram->srcAddr != packet->srcAddr)
-            continue;
-         if(datagram->destAddr != packet->destAddr)
-            continue;
-         //Compare identification and protocol fields
-         if(datagram->identification != packet->identification)
-            continue;
-         if(datagram->protocol != packet->protocol)
-            continue;
+   //The reassembly queue is full?
+   if(i >= IPV4_MAX_FRAG_DATAGRAMS)
+   {
+      //Evict the oldest datagram from the reassembly queue
+      frag = ipv4EvictFragDesc(interface, NULL);
+      //No entry available?
+      if(frag == NULL)
+         return NULL;
+   }
 
-         //A matching entry has been found in the reassembly queue
-         return frag;
-      }
+   //Number of chunks that comprise the reassembly buffer
+   frag->buffer.chunkCount = 0;
+   frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+
+   //Initial length of the reconstructed datagram
+   frag->headerLength = 0;
+   frag->dataLen = 0;
+   frag->receivedLen = 0;
+   frag->memSize = 0;
+
+   //Copy IPv4 header from the incoming fragment
+   error = ipv4CopyFragHeader(interface, frag, packet);
+   //Failed to allocate memory?
+   if(error)
+      return NULL;
+
+   //Save current time
+   frag->timestamp = osGetSystemTime();
+
+   //Insert the new entry at the head of the bucket
+   frag->next = context->fragHashTable[h];
+   context->fragHashTable[h] = frag;
+
+   //Return the matching fragment descriptor
+   return frag;
+}
+
+
+/**
+ * @brief Flush IPv4 reassembly queue
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv4FlushFragQueue(NetInterface *interface)
+{
+   uint_t i;
+   Ipv4Context *context;
+
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Drop any partially reconstructed datagram
+      netBufferSetLength((NetBuffer *) &context->fragQueue[i].buffer, 0);
    }
 
-   //If the current packet does not match an existing entry
-   //in the reassembly queue, then create a new entry
+   //Clear the hash table
+   memset(context->fragHashTable, 0, sizeof(context->fragHashTable));
+   //The reassembly queue is now empty
+   context->fragMemSize = 0;
+}
+
+
+/**
+ * @brief Evict the oldest datagram from the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] exclude Entry that must not be evicted (optional parameter)
+ * @return Pointer to the entry that has been freed, if any
+ **/
+
+Ipv4FragDesc *ipv4EvictFragDesc(NetInterface *interface,
+   const Ipv4FragDesc *exclude)
+{
+   uint_t i;
+   Ipv4FragDesc *frag;
+   Ipv4FragDesc *oldestFrag;
+
+   //Keep track of the oldest entry
+   oldestFrag = NULL;
+
+   //Loop through the reassembly queue
    for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
    {
       //Point to the current entry in the reassembly queue
       frag = &interface->ipv4Context.fragQueue[i];
 
-      //The current entry is free?
-      if(!frag->buffer.chunkCount)
+      //Check whether the entry is in use
+      if(frag->buffer.chunkCount > 0 && frag != exclude)
       {
-         //Number of chunks that comprise the reassembly buffer
-         frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+         //Keep track of the oldest entry
+         if(oldestFrag == NULL ||
+            timeCompare(frag->timestamp, oldestFrag->timestamp) < 0)
+         {
+            oldestFrag = frag;
+         }
+      }
+   }
 
-         //Allocate sufficient memory to hold the IPv4 header and
-         //the first hole descriptor
-         error = netBufferSetLength((NetBuffer *) &frag->buffer,
-            NET_MEM_POOL_BUFFER_SIZE + sizeof(Ipv4HoleDesc));
+   //Any entry found?
+   if(oldestFrag != NULL)
+   {
+      //Debug message
+      TRACE_INFO("Evicting IPv4 datagram from the reassembly queue...\r\n");
 
-         //Failed to allocate memory?
-         if(error)
+      //Number of failures detected by the IP reassembly algorithm
+      MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Number of datagrams evicted from the reassembly queue
+      interface->ipv4Context.fragStats.reasmEvictions++;
+
+      //Drop the partially reconstructed datagram
+      ipv4DeleteFragDesc(interface, oldestFrag);
+   }
+
+   //Return a pointer to the entry that has been freed
+   return oldestFrag;
+}
+
+
+/**
+ * @brief Remove a datagram from the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ **/
+
+void ipv4DeleteFragDesc(NetInterface *interface, Ipv4FragDesc *frag)
+{
+   uint_t h;
+   Ipv4FragDesc **p;
+   Ipv4Context *context;
+
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+
+   //Make sure the entry is currently in use
+   if(frag->buffer.chunkCount > 0)
+   {
+      //Calculate the hash value of the datagram
+      h = ipv4FragHash(frag->buffer.chunk[0].address);
+
+      //Remove the entry from the bucket
+      for(p = &context->fragHashTable[h]; *p != NULL; p = &(*p)->next)
+      {
+         //Matching entry?
+         if(*p == frag)
          {
-            //Clean up side effects
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return NULL;
+            *p = frag->next;
+            break;
          }
+      }
 
-         //Initial length of the reconstructed datagram
-         frag->headerLength = packet->headerLength * 4;
-         frag->dataLen = 0;
+      //Release previously allocated memory
+      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      //Update the amount of memory used by the reassembly queue
+      context->fragMemSize -= frag->memSize;
 
-         //Fix the length of the first chunk
-         frag->buffer.chunk[0].length = (uint16_t) frag->headerLength;
-         //Copy IPv4 header from the incoming fragment
-         netBufferWrite((NetBuffer *) &frag->buffer, 0, packet, frag->headerLength);
+      //The entry is now free
+      frag->next = NULL;
+      frag->memSize = 0;
+   }
+}
+
+
+/**
+ * @brief Copy the IP header of a fragment to the reassembly buffer
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ * @param[in] packet Incoming IPv4 packet
+ * @return Error code
+ **/
 
-         //Save current time
-         frag->timestamp = osGetSystemTime();
-         //Create a new entry in the hole descriptor list
-         frag->firstHole = 0;
+error_t ipv4CopyFragHeader(NetInterface *interface, Ipv4FragDesc *frag,
+   const Ipv4Header *packet)
+{
+   size_t length;
+   ChunkDesc *chunk;
+   Ipv4Context *context;
 
-         //Point to first hole descriptor
-         hole = ipv4FindHole(frag, frag->firstHole);
-         //The entry describes the datagram as being completely missing
-         hole->first = 0;
-         hole->last = IPV4_INFINITY;
-         hole->next = IPV4_INFINITY;
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+   //Point to the first chunk of the reassembly buffer
+   chunk = &frag->buffer.chunk[0];
 
-         //Dump hole descriptor list
-         ipv4DumpHoleList(frag);
+   //Calculate the length of the IP header including options
+   length = packet->headerLength * 4;
 
-         //Return the matching fragment descriptor
-         return frag;
+   //Allocate memory to hold the IP header, if necessary
+   if(frag->buffer.chunkCount == 0)
+   {
+      //The header chunk counts against the memory budget as well
+      while((context->fragMemSize +
+         NET_MEM_ALLOC_SIZE(IPV4_MAX_HEADER_LENGTH)) > IPV4_FRAG_MAX_MEM_SIZE)
+      {
+         //No other datagram can be evicted?
+         if(ipv4EvictFragDesc(interface, frag) == NULL)
+            return ERROR_OUT_OF_RESOURCES;
       }
+
+      //The chunk is large enough to hold the largest IP header
+      chunk->address = memPoolAlloc(IPV4_MAX_HEADER_LENGTH);
+      //Failed to allocate memory?
+      if(chunk->address == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Allocated memory
+      chunk->size = IPV4_MAX_HEADER_LENGTH;
+      frag->buffer.chunkCount = 1;
+
+      //Update the amount of memory used by the reassembly queue
+      frag->memSize += NET_MEM_ALLOC_SIZE(chunk->size);
+      context->fragMemSize += NET_MEM_ALLOC_SIZE(chunk->size);
    }
 
-   //The reassembly queue is full
-   return NULL;
+   //Copy the IP header
+   memcpy(chunk->address, packet, length);
+
+   //Fix the length of the first chunk
+   chunk->length = (uint16_t) length;
+   frag->headerLength = length;
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Flush IPv4 reassembly queue
+ * @brief Insert a fragment in the reassembly buffer
  * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ * @param[in] index Position of the new chunk in the reassembly buffer
+ * @param[in] offset Offset of the data within the payload
+ * @param[in] data Pointer to the data to be inserted
+ * @param[in] length Number of bytes to be inserted
+ * @return Error code
  **/
 
-void ipv4FlushFragQueue(NetInterface *interface)
+error_t ipv4InsertFragment(NetInterface *interface, Ipv4FragDesc *frag,
+   uint_t index, size_t offset, const uint8_t *data, size_t length)
 {
    uint_t i;
+   size_t size;
+   void *p;
+   Ipv4Context *context;
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+
+   //Limit the number of fragments per datagram
+   if(frag->buffer.chunkCount >= frag->buffer.maxChunkCount)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //When fixed-size blocks are used, a whole block is consumed by each
+   //chunk, however small the fragment is
+   size = NET_MEM_ALLOC_SIZE(length);
+
+   //The memory budget is shared by all the datagrams being reassembled.
+   //Evict the oldest datagrams until there is enough room
+   while((context->fragMemSize + size) > IPV4_FRAG_MAX_MEM_SIZE)
    {
-      //Drop any partially reconstructed datagram
-      netBufferSetLength((NetBuffer *) &interface->ipv4Context.fragQueue[i].buffer, 0);
+      //No other datagram can be evicted?
+      if(ipv4EvictFragDesc(interface, frag) == NULL)
+         return ERROR_OUT_OF_RESOURCES;
    }
+
+   //Allocate a chunk that exactly fits the data
+   p = memPoolAlloc(length);
+   //Failed to allocate memory?
+   if(p == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Make room for the new chunk
+   for(i = frag->buffer.chunkCount; i > index; i--)
+   {
+      frag->buffer.chunk[i] = frag->buffer.chunk[i - 1];
+      frag->chunkOffset[i] = frag->chunkOffset[i - 1];
+   }
+
+   //Copy data from the fragment
+   memcpy(p, data, length);
+
+   //Insert the new chunk
+   frag->buffer.chunk[index].address = p;
+   frag->buffer.chunk[index].length = (uint16_t) length;
+   frag->buffer.chunk[index].size = (uint16_t) length;
+   frag->chunkOffset[index] = (uint16_t) offset;
+   frag->buffer.chunkCount++;
+
+   //Update the number of payload bytes received so far
+   frag->receivedLen += length;
+
+   //Update the amount of memory used by the reassembly queue
+   frag->memSize += size;
+   context->fragMemSize += size;
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Retrieve hole descriptor
- * @param[in] frag IPv4 fragment descriptor
- * @param[in] offset Offset of the hole
- * @return A pointer to the hole descriptor is returned if the
- *   specified offset is valid. Otherwise NULL is returned
+ * @brief Calculate the hash value of a fragmented datagram
+ * @param[in] packet IPv4 header of the datagram
+ * @return Index of the corresponding bucket
  **/
 
-Ipv4HoleDesc *ipv4FindHole(Ipv4FragDesc *frag, uint16_t offset)
+uint_t ipv4FragHash(const Ipv4Header *packet)
 {
-   //Return a pointer to the hole descriptor
-   return netBufferAt((NetBuffer *) &frag->buffer, frag->headerLength + offset);
+   uint32_t h;
+
+   //The datagram is identified by its source and destination addresses,
+   //its protocol and identification fields
+   h = packet->srcAddr ^ packet->destAddr;
+   h ^= ((uint32_t) packet->identification << 16) | packet->protocol;
+
+   //Fold the result
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the bucket
+   return h % IPV4_FRAG_HASH_TABLE_SIZE;
 }
 
 
 /**
- * @brief Dump hole descriptor list
+ * @brief Dump the list of fragments received so far
  * @param[in] frag IPv4 fragment descriptor
  **/
 
-void ipv4DumpHoleList(Ipv4FragDesc *frag)
+void ipv4DumpFragList(Ipv4FragDesc *frag)
 {
 //Check debugging level
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   Ipv4HoleDesc *hole;
+   uint_t i;
 
    //Debug message
-   TRACE_DEBUG("Hole descriptor list:\r\n");
-   //Select the first hole descriptor from the list
-   hole = ipv4FindHole(frag, frag->firstHole);
+   TRACE_DEBUG("Fragment list:\r\n");
 
-   //Loop through the hole descriptor list
-   while(hole != NULL)
+   //Loop through the fragments
+   for(i = 1; i < frag->buffer.chunkCount; i++)
    {
-      //Display current hole
-      TRACE_DEBUG("  %" PRIu16 " - %" PRIu16 "\r\n", hole->first, hole->last);
-      //Select the next hole descriptor from the list
-      hole = ipv4FindHole(frag, hole->next);
+      //Display current fragment
+      TRACE_DEBUG("  %" PRIu16 " - %" PRIu16 "\r\n", frag->chunkOffset[i],
+         frag->chunkOffset[i] + frag->buffer.chunk[i].length);
    }
 #endif
 }
@@ -52,7 +52,7 @@
 //Maximum number of fragmented packets the host will accept
 //and hold in the reassembly queue simultaneously
 #ifndef IPV4_MAX_FRAG_DATAGRAMS
-   #define IPV4_MAX_FRAG_DATAGRAMS 4
+   #define IPV4_MAX_FRAG_DATAGRAMS 8
 #elif (IPV4_MAX_FRAG_DATAGRAMS < 1)
    #error IPV4_MAX_FRAG_DATAGRAMS parameter is not valid
 #endif
@@ -60,10 +60,31 @@
 //Maximum datagram size the host will accept when reassembling fragments
 #ifndef IPV4_MAX_FRAG_DATAGRAM_SIZE
    #define IPV4_MAX_FRAG_DATAGRAM_SIZE 8192
-#elif (IPV4_MAX_FRAG_DATAGRAM_SIZE < 576)
+#elif (IPV4_MAX_FRAG_DATAGRAM_SIZE < 576 || IPV4_MAX_FRAG_DATAGRAM_SIZE > 65535)
    #error IPV4_MAX_FRAG_DATAGRAM_SIZE parameter is not valid
 #endif
 
+//Maximum number of fragments per datagram
+#ifndef IPV4_MAX_FRAG_COUNT
+   #define IPV4_MAX_FRAG_COUNT 16
+#elif (IPV4_MAX_FRAG_COUNT < 2)
+   #error IPV4_MAX_FRAG_COUNT parameter is not valid
+#endif
+
+//Size of the hash table used to locate datagrams being reassembled
+#ifndef IPV4_FRAG_HASH_TABLE_SIZE
+   #define IPV4_FRAG_HASH_TABLE_SIZE 8
+#elif (IPV4_FRAG_HASH_TABLE_SIZE < 1)
+   #error IPV4_FRAG_HASH_TABLE_SIZE parameter is not valid
+#endif
+
+//Amount of memory shared by all the datagrams being reassembled
+#ifndef IPV4_FRAG_MAX_MEM_SIZE
+   #define IPV4_FRAG_MAX_MEM_SIZE 32768
+#elif (IPV4_FRAG_MAX_MEM_SIZE < IPV4_MAX_FRAG_DATAGRAM_SIZE)
+   #error IPV4_FRAG_MAX_MEM_SIZE parameter is not valid
+#endif
+
 //Maximum time an IPv4 fragment can spend waiting to be reassembled
 #ifndef IPV4_FRAG_TIME_TO_LIVE
    #define IPV4_FRAG_TIME_TO_LIVE 15000
@@ -71,8 +92,8 @@
    #error IPV4_FRAG_TIME_TO_LIVE parameter is not valid
 #endif
 
-//Infinity is implemented by a very large integer
-#define IPV4_INFINITY 0xFFFF
+//Minimum amount of data the first fragment must carry
+#define IPV4_FRAG_MIN_FIRST_LENGTH 64
 
 //C++ guard
 #ifdef __cplusplus
@@ -80,30 +101,6 @@ extern "C" {
 #endif
 
 
-//CodeWarrior or Win32 compiler?
-#if defined(__CWCC__) || defined(_WIN32)
-   #pragma pack(push, 1)
-#endif
-
-
-/**
- * @brief Hole descriptor
- **/
-
-typedef __start_packed struct
-{
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} __end_packed Ipv4HoleDesc;
-
-
-//CodeWarrior or Win32 compiler?
-#if defined(__CWCC__) || defined(_WIN32)
-   #pragma pack(pop)
-#endif
-
-
 /**
  * @brief Reassembly buffer
  **/
@@ -112,31 +109,49 @@ typedef struct
 {
    uint_t chunkCount;
    uint_t maxChunkCount;
-   ChunkDesc chunk[N(IPV4_MAX_FRAG_DATAGRAM_SIZE) + 1];
+   ChunkDesc chunk[IPV4_MAX_FRAG_COUNT + 1];
 } Ipv4ReassemblyBuffer;
 
 
 /**
  * @brief Fragmented packet descriptor
+ *
+ * The first chunk of the reassembly buffer holds the IP header. The
+ * following chunks hold the payload of the fragments, sorted by offset
+ *
  **/
 
-typedef struct
+typedef struct _Ipv4FragDesc
 {
-   systime_t timestamp;         ///<Time at which the first fragment was received
-   size_t headerLength;         ///<Length of the header
-   size_t dataLen;              ///<Length of the payload
-   uint16_t firstHole;          ///<Index of the first hole
-   Ipv4ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
+   struct _Ipv4FragDesc *next;                 ///<Next entry in the same hash bucket
+   systime_t timestamp;                        ///<Time at which the first fragment was received
+   size_t headerLength;                        ///<Length of the header
+   size_t dataLen;                             ///<Length of the payload (zero until the last fragment is received)
+   size_t receivedLen;                         ///<Number of payload bytes received so far
+   size_t memSize;                             ///<Amount of memory used by the datagram
+   uint16_t chunkOffset[IPV4_MAX_FRAG_COUNT + 1]; ///<Offset of each fragment within the payload
+   Ipv4ReassemblyBuffer buffer;                ///<Buffer containing the reassembled datagram
 } Ipv4FragDesc;
 
 
+/**
+ * @brief Reassembly statistics
+ **/
+
+typedef struct
+{
+   uint32_t reasmTimeouts;  ///<Number of datagrams discarded because the reassembly timer expired
+   uint32_t reasmEvictions; ///<Number of datagrams evicted to make room for newer ones
+} Ipv4FragStats;
+
+
 //Tick counter to handle periodic operations
 extern systime_t ipv4FragTickCounter;
 
 //IPv4 datagram fragmentation and reassembly
 error_t ipv4FragmentDatagram(NetInterface *interface,
    Ipv4PseudoHeader *pseudoHeader, uint16_t id, const NetBuffer *payload,
-   size_t payloadOffset, uint_t flags);
+   size_t payloadOffset, size_t pathMtu, uint_t flags);
 
 void ipv4ReassembleDatagram(NetInterface *interface,
    const Ipv4Header *packet, size_t length);
@@ -148,8 +163,19 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface,
 
 void ipv4FlushFragQueue(NetInterface *interface);
 
-Ipv4HoleDesc *ipv4FindHole(Ipv4FragDesc *frag, uint16_t offset);
-void ipv4DumpHoleList(Ipv4FragDesc *frag);
+Ipv4FragDesc *ipv4EvictFragDesc(NetInterface *interface,
+   const Ipv4FragDesc *exclude);
+
+void ipv4DeleteFragDesc(NetInterface *interface, Ipv4FragDesc *frag);
+
+error_t ipv4CopyFragHeader(NetInterface *interface, Ipv4FragDesc *frag,
+   const Ipv4Header *packet);
+
+error_t ipv4InsertFragment(NetInterface *interface, Ipv4FragDesc *frag,
+   uint_t index, size_t offset, const uint8_t *data, size_t length);
+
+uint_t ipv4FragHash(const Ipv4Header *packet);
+void ipv4DumpFragList(Ipv4FragDesc *frag);
 
 //C++ guard
 #ifdef __cplusplus
@@ -0,0 +1,228 @@
+/**
+ * @file ipv4_pmtu.c
+ * @brief Path MTU Discovery for IPv4
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL IPV4_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "ipv4/ipv4.h"
+#include "ipv4/ipv4_pmtu.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (IPV4_SUPPORT == ENABLED && IPV4_PMTU_SUPPORT == ENABLED)
+
+//Table of MTU plateaus (refer to RFC 1191, section 7)
+static const uint16_t ipv4MtuPlateaus[] =
+{
+   65535, 32000, 17914, 8166, 4352, 2002, 1492, 1006, 508, 296, 68
+};
+
+
+/**
+ * @brief Retrieve the PMTU for the specified path
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination IPv4 address
+ * @return PMTU value
+ **/
+
+size_t ipv4GetPathMtu(NetInterface *interface, Ipv4Addr destAddr)
+{
+   uint_t i;
+   size_t pathMtu;
+   systime_t time;
+   Ipv4PmtuCacheEntry *entry;
+
+   //The PMTU value for the path is initially assumed to be the MTU of the
+   //first-hop link
+   pathMtu = interface->ipv4Context.linkMtu;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through PMTU cache entries
+   for(i = 0; i < IPV4_PMTU_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &interface->ipv4PmtuCache[i];
+
+      //Check whether the entry is currently in use
+      if(entry->valid && entry->destAddr == destAddr)
+      {
+         //A PMTU estimate is periodically increased so that the host can
+         //detect an increase in the PMTU (refer to RFC 1191, section 6.3)
+         if(timeCompare(time, entry->timestamp + IPV4_PMTU_TIMEOUT) >= 0)
+         {
+            //Debug message
+            TRACE_INFO("IPv4 PMTU estimate has aged out...\r\n");
+            //Release the entry
+            entry->valid = FALSE;
+         }
+         else
+         {
+            //Use the existing PMTU estimate
+            pathMtu = MIN(entry->pathMtu, pathMtu);
+         }
+
+         //We are done
+         break;
+      }
+   }
+
+   //Return the PMTU value
+   return pathMtu;
+}
+
+
+/**
+ * @brief Update the PMTU for the specified path
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination IPv4 address
+ * @param[in] tentativePathMtu Tentative PMTU value
+ **/
+
+void ipv4UpdatePathMtu(NetInterface *interface, Ipv4Addr destAddr,
+   size_t tentativePathMtu)
+{
+   uint_t i;
+   systime_t time;
+   Ipv4PmtuCacheEntry *entry;
+   Ipv4PmtuCacheEntry *oldestEntry;
+
+   //A host must never reduce its estimate of the PMTU below 68 octets
+   tentativePathMtu = MAX(tentativePathMtu, IPV4_MINIMUM_MTU);
+
+   //The PMTU can never exceed the MTU of the first-hop link
+   if(tentativePathMtu >= interface->ipv4Context.linkMtu)
+      return;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through PMTU cache entries
+   for(i = 0; i < IPV4_PMTU_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &interface->ipv4PmtuCache[i];
+
+      //Current entry matches the specified address?
+      if(entry->valid && entry->destAddr == destAddr)
+      {
+         //If the tentative PMTU is less than the existing PMTU estimate,
+         //the tentative PMTU replaces the existing PMTU
+         if(tentativePathMtu < entry->pathMtu)
+         {
+            //Debug message
+            TRACE_INFO("IPv4 PMTU reduced to %" PRIuSIZE " bytes\r\n",
+               tentativePathMtu);
+
+            //Save the new PMTU estimate
+            entry->pathMtu = tentativePathMtu;
+            entry->timestamp = time;
+         }
+
+         //We are done
+         return;
+      }
+   }
+
+   //Keep track of the oldest entry
+   oldestEntry = &interface->ipv4PmtuCache[0];
+
+   //Loop through PMTU cache entries
+   for(i = 0; i < IPV4_PMTU_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &interface->ipv4PmtuCache[i];
+
+      //Check whether the entry is currently in use or not
+      if(!entry->valid)
+      {
+         //Use the first free entry
+         oldestEntry = entry;
+         break;
+      }
+
+      //Keep track of the oldest entry in the table
+      if((time - entry->timestamp) > (time - oldestEntry->timestamp))
+      {
+         oldestEntry = entry;
+      }
+   }
+
+   //Debug message
+   TRACE_INFO("IPv4 PMTU reduced to %" PRIuSIZE " bytes\r\n", tentativePathMtu);
+
+   //The oldest entry is removed whenever the table runs out of space
+   oldestEntry->valid = TRUE;
+   oldestEntry->destAddr = destAddr;
+   oldestEntry->pathMtu = tentativePathMtu;
+   oldestEntry->timestamp = time;
+}
+
+
+/**
+ * @brief Estimate the PMTU when the router does not report the next-hop MTU
+ * @param[in] totalLength Total length of the datagram that was dropped
+ * @return Largest plateau value that is less than the specified length
+ **/
+
+size_t ipv4GetPlateauMtu(size_t totalLength)
+{
+   uint_t i;
+
+   //Routers that do not implement RFC 1191 set the Next-Hop MTU field to
+   //zero. The host then uses the next lower plateau value as the new PMTU
+   //estimate (refer to RFC 1191, section 5)
+   for(i = 0; i < arraysize(ipv4MtuPlateaus); i++)
+   {
+      if(ipv4MtuPlateaus[i] < totalLength)
+         break;
+   }
+
+   //Return the PMTU estimate
+   return (i < arraysize(ipv4MtuPlateaus)) ? ipv4MtuPlateaus[i] :
+      IPV4_MINIMUM_MTU;
+}
+
+
+/**
+ * @brief Flush PMTU cache
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv4FlushPathMtuCache(NetInterface *interface)
+{
+   //Clear the PMTU cache
+   memset(interface->ipv4PmtuCache, 0, sizeof(interface->ipv4PmtuCache));
+}
+
+#endif
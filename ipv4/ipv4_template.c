@@ -0,0 +1,383 @@
+/**
+ * @file ipv4_template.c
+ * @brief IPv4 header templates for connected sockets
+ *
+ * @section Description
+ *
+ * A connected socket always sends its datagrams to the same destination,
+ * from the same source address and through the same next hop. The header
+ * template caches the pre-formatted IPv4 header and the ARP cache entry
+ * of the next hop so that, in steady state, only the Total Length and
+ * Identification fields need to be patched before the frame is handed to
+ * the Ethernet layer. The template falls back to the regular send path as
+ * soon as the ARP entry is no longer reachable or the configuration of the
+ * interface changes
+ *
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL IPV4_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "core/ip.h"
+#include "ipv4/ipv4.h"
+#include "ipv4/ipv4_misc.h"
+#include "ipv4/ipv4_template.h"
+#include "ipv4/arp.h"
+#include "mibs/mib2_module.h"
+#include "mibs/ip_mib_module.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (IPV4_SUPPORT == ENABLED && IPV4_TEMPLATE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Send an IPv4 datagram using a header template
+ * @param[in,out] hdrTemplate Header template associated with the flow
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader IPv4 pseudo header
+ * @param[in] buffer Multi-part buffer containing the payload
+ * @param[in] offset Offset to the first byte of the payload
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t ipv4SendTemplateDatagram(Ipv4HeaderTemplate *hdrTemplate,
+   NetInterface *interface, Ipv4PseudoHeader *pseudoHeader, NetBuffer *buffer,
+   size_t offset, uint_t flags)
+{
+   error_t error;
+   uint32_t temp;
+   size_t length;
+   uint16_t id;
+   Ipv4Header *packet;
+
+   //Check whether the TTL value is zero
+   if((flags & IP_FLAG_TTL) == 0)
+   {
+      //Use default Time-To-Live value
+      flags |= IPV4_DEFAULT_TTL;
+   }
+
+   //Retrieve the length of payload
+   length = netBufferGetLength(buffer) - offset;
+
+   //The template cannot be used if it is stale, or if the datagram needs
+   //to be fragmented
+   if(offset < sizeof(Ipv4Header) ||
+      !ipv4CheckTemplate(hdrTemplate, interface, pseudoHeader, length, flags))
+   {
+      //Send the datagram through the regular path
+      error = ipv4SendDatagram(interface, pseudoHeader, buffer, offset, flags);
+
+      //The next hop may have been resolved while sending the datagram
+      if(!error)
+      {
+         ipv4BuildTemplate(hdrTemplate, interface, pseudoHeader, flags);
+      }
+
+      //Return status code
+      return error;
+   }
+
+   //Total number of IP datagrams which local IP user-protocols supplied to IP
+   //in requests for transmission
+   MIB2_INC_COUNTER32(ipGroup.ipOutRequests, 1);
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsOutRequests, 1);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCOutRequests, 1);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsOutRequests, 1);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutRequests, 1);
+
+   //Identification field is primarily used to identify
+   //fragments of an original IP datagram
+   id = interface->ipv4Context.identification++;
+
+   //Make room for the header
+   offset -= sizeof(Ipv4Header);
+   //Calculate the size of the entire packet, including header and data
+   length += sizeof(Ipv4Header);
+
+   //Point to the IPv4 header
+   packet = netBufferAt(buffer, offset);
+   //Sanity check
+   if(packet == NULL)
+      return ERROR_FAILURE;
+
+   //Copy the pre-formatted header
+   *packet = hdrTemplate->header;
+
+   //Fill in the fields that vary from one datagram to another
+   packet->totalLength = htons(length);
+   packet->identification = htons(id);
+
+   //The checksum of the template was computed with both fields set to zero.
+   //Update it incrementally (refer to RFC 1624, section 3)
+   temp = (uint16_t) ~hdrTemplate->header.headerChecksum;
+   temp += packet->totalLength;
+   temp += packet->identification;
+
+   //Fold 32-bit sum to 16 bits
+   temp = (temp & 0xFFFF) + (temp >> 16);
+   temp = (temp & 0xFFFF) + (temp >> 16);
+
+   //Store the resulting checksum
+   packet->headerChecksum = (uint16_t) ~temp;
+
+   //Update IP statistics
+   ipv4UpdateOutStats(interface, hdrTemplate->nextHop, length);
+
+   //Debug message
+   TRACE_INFO("Sending IPv4 packet (%" PRIuSIZE " bytes)...\r\n", length);
+   //Dump IP header contents for debugging purpose
+   ipv4DumpHeader(packet);
+
+   //The next hop has already been resolved
+   error = ethSendFrame(interface, &hdrTemplate->arpEntry->macAddr, buffer,
+      offset, ETH_TYPE_IPV4);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether a header template can be used
+ * @param[in] hdrTemplate Header template associated with the flow
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader IPv4 pseudo header
+ * @param[in] length Length of the payload
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return TRUE if the template is up to date, else FALSE
+ **/
+
+bool_t ipv4CheckTemplate(Ipv4HeaderTemplate *hdrTemplate,
+   NetInterface *interface, const Ipv4PseudoHeader *pseudoHeader,
+   size_t length, uint_t flags)
+{
+   size_t pathMtu;
+   uint16_t fragOffset;
+   ArpCacheEntry *entry;
+
+   //The template must have been built for the same interface, and the
+   //configuration of the interface must not have changed since then
+   if(!hdrTemplate->valid || hdrTemplate->interface != interface ||
+      hdrTemplate->generation != interface->ipv4Context.templateGeneration)
+   {
+      return FALSE;
+   }
+
+   //The template must match the addresses and the protocol of the datagram
+   if(hdrTemplate->header.srcAddr != pseudoHeader->srcAddr ||
+      hdrTemplate->header.destAddr != pseudoHeader->destAddr ||
+      hdrTemplate->header.protocol != pseudoHeader->protocol)
+   {
+      return FALSE;
+   }
+
+   //Check the value of the DF bit
+   if((flags & IP_FLAG_DONT_FRAG) != 0)
+      fragOffset = HTONS(IPV4_FLAG_DF);
+   else
+      fragOffset = 0;
+
+   //The TTL and the DF bit are specified on a per-datagram basis
+   if(hdrTemplate->header.timeToLive != (flags & IP_FLAG_TTL) ||
+      hdrTemplate->header.fragmentOffset != fragOffset)
+   {
+      return FALSE;
+   }
+
+#if (IPV4_PMTU_SUPPORT == ENABLED)
+   //Retrieve the PMTU for the specified destination address
+   pathMtu = ipv4GetPathMtu(interface, pseudoHeader->destAddr);
+#else
+   //The PMTU value for the path is assumed to be the MTU of the first-hop link
+   pathMtu = interface->ipv4Context.linkMtu;
+#endif
+
+   //Datagrams that require fragmentation take the regular path
+   if((length + sizeof(Ipv4Header)) > pathMtu)
+      return FALSE;
+
+   //Point to the ARP cache entry of the next hop
+   entry = hdrTemplate->arpEntry;
+
+   //The entry may have been recycled for another address. Stale entries
+   //must go through arpResolve so that reachability gets verified
+   if(entry->ipAddr != hdrTemplate->nextHop ||
+      (entry->state != ARP_STATE_REACHABLE &&
+      entry->state != ARP_STATE_PERMANENT))
+   {
+      return FALSE;
+   }
+
+   //Ensure the source address is still valid
+   if(ipv4CheckSourceAddr(interface, pseudoHeader->srcAddr))
+      return FALSE;
+
+   //The template is up to date
+   return TRUE;
+}
+
+
+/**
+ * @brief Build a header template after a successful transmission
+ * @param[out] hdrTemplate Header template associated with the flow
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader IPv4 pseudo header
+ * @param[in] flags Set of flags that influences the behavior of this function
+ **/
+
+void ipv4BuildTemplate(Ipv4HeaderTemplate *hdrTemplate,
+   NetInterface *interface, const Ipv4PseudoHeader *pseudoHeader,
+   uint_t flags)
+{
+   uint_t i;
+   Ipv4Addr destIpAddr;
+   Ipv4AddrEntry *addrEntry;
+   ArpCacheEntry *arpEntry;
+   NetInterface *physicalInterface;
+   Ipv4Header *header;
+
+   //Invalidate the template
+   hdrTemplate->valid = FALSE;
+
+   //Point to the physical interface
+   physicalInterface = nicGetPhysicalInterface(interface);
+
+   //Templates are only used on Ethernet interfaces
+   if(physicalInterface->nicDriver == NULL ||
+      physicalInterface->nicDriver->type != NIC_TYPE_ETHERNET)
+   {
+      return;
+   }
+
+   //Get the destination IPv4 address
+   destIpAddr = pseudoHeader->destAddr;
+
+   //Only unicast destinations are eligible
+   if(destIpAddr == IPV4_UNSPECIFIED_ADDR ||
+      ipv4IsLocalHostAddr(destIpAddr) ||
+      ipv4IsBroadcastAddr(interface, destIpAddr) ||
+      ipv4IsMulticastAddr(destIpAddr))
+   {
+      return;
+   }
+
+   //Select the next hop the same way ipv4SendPacket does
+   if(!ipv4IsLinkLocalAddr(pseudoHeader->srcAddr) &&
+      !ipv4IsLinkLocalAddr(destIpAddr) &&
+      !ipv4IsOnLink(interface, destIpAddr) &&
+      (flags & IP_FLAG_DONT_ROUTE) == 0)
+   {
+      //Loop through the list of default gateways
+      for(i = 0; i < IPV4_ADDR_LIST_SIZE; i++)
+      {
+         //Point to the current entry
+         addrEntry = &interface->ipv4Context.addrList[i];
+
+         //Select the gateway associated with the source address
+         if(addrEntry->state == IPV4_ADDR_STATE_VALID &&
+            addrEntry->defaultGateway != IPV4_UNSPECIFIED_ADDR &&
+            addrEntry->addr == pseudoHeader->srcAddr)
+         {
+            break;
+         }
+      }
+
+      //No gateway found?
+      if(i >= IPV4_ADDR_LIST_SIZE)
+         return;
+
+      //Packets are forwarded through the selected gateway
+      destIpAddr = addrEntry->defaultGateway;
+   }
+
+   //Search the ARP cache for the next hop
+   arpEntry = arpFindEntry(interface, destIpAddr);
+
+   //The address resolution may still be in progress
+   if(arpEntry == NULL || (arpEntry->state != ARP_STATE_REACHABLE &&
+      arpEntry->state != ARP_STATE_PERMANENT))
+   {
+      return;
+   }
+
+   //Point to the pre-formatted header
+   header = &hdrTemplate->header;
+
+   //Format IPv4 header
+   header->version = IPV4_VERSION;
+   header->headerLength = 5;
+   header->typeOfService = 0;
+   header->totalLength = 0;
+   header->identification = 0;
+   header->timeToLive = flags & IP_FLAG_TTL;
+   header->protocol = pseudoHeader->protocol;
+   header->headerChecksum = 0;
+   header->srcAddr = pseudoHeader->srcAddr;
+   header->destAddr = pseudoHeader->destAddr;
+
+   //Check the value of the DF bit
+   if((flags & IP_FLAG_DONT_FRAG) != 0)
+      header->fragmentOffset = HTONS(IPV4_FLAG_DF);
+   else
+      header->fragmentOffset = 0;
+
+   //Calculate the checksum of the template
+   header->headerChecksum = ipCalcChecksum(header, sizeof(Ipv4Header));
+
+   //Save the next hop
+   hdrTemplate->nextHop = destIpAddr;
+   hdrTemplate->arpEntry = arpEntry;
+
+   //The template is now valid
+   hdrTemplate->interface = interface;
+   hdrTemplate->generation = interface->ipv4Context.templateGeneration;
+   hdrTemplate->valid = TRUE;
+}
+
+
+/**
+ * @brief Invalidate all the header templates bound to an interface
+ *
+ * This function must be called whenever the address configuration of the
+ * interface changes, since the next hop of a flow may change as well
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv4InvalidateTemplates(NetInterface *interface)
+{
+   //Templates built with a previous generation number are discarded
+   interface->ipv4Context.templateGeneration++;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file ipv4_template.h
+ * @brief IPv4 header templates for connected sockets
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _IPV4_TEMPLATE_H
+#define _IPV4_TEMPLATE_H
+
+//Dependencies
+#include "core/net.h"
+#include "ipv4/ipv4.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief IPv4 header template
+ *
+ * The template holds a pre-formatted IPv4 header together with the next hop
+ * and the ARP cache entry that were used the last time a datagram was sent
+ * for the flow. The checksum of the header is computed with the Total Length
+ * and Identification fields set to zero
+ *
+ **/
+
+typedef struct
+{
+   bool_t valid;              ///<Valid template
+   NetInterface *interface;   ///<Underlying network interface
+   uint_t generation;         ///<Interface configuration generation number
+   Ipv4Header header;         ///<Pre-formatted IPv4 header
+   Ipv4Addr nextHop;          ///<Next-hop address
+   ArpCacheEntry *arpEntry;   ///<ARP cache entry of the next hop
+} Ipv4HeaderTemplate;
+
+
+//IPv4 header template related functions
+error_t ipv4SendTemplateDatagram(Ipv4HeaderTemplate *hdrTemplate,
+   NetInterface *interface, Ipv4PseudoHeader *pseudoHeader, NetBuffer *buffer,
+   size_t offset, uint_t flags);
+
+bool_t ipv4CheckTemplate(Ipv4HeaderTemplate *hdrTemplate,
+   NetInterface *interface, const Ipv4PseudoHeader *pseudoHeader,
+   size_t length, uint_t flags);
+
+void ipv4BuildTemplate(Ipv4HeaderTemplate *hdrTemplate,
+   NetInterface *interface, const Ipv4PseudoHeader *pseudoHeader,
+   uint_t flags);
+
+void ipv4InvalidateTemplates(NetInterface *interface);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
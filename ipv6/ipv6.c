@@ -132,6 +132,10 @@ error_t ipv6Init(NetInterface *interface)
    context->identification = 0;
    //Initialize the reassembly queue
    memset(context->fragQueue, 0, sizeof(context->fragQueue));
+   memset(context->fragHashTable, 0, sizeof(context->fragHashTable));
+   context->fragMemSize = 0;
+   //Clear reassembly statistics
+   memset(&context->fragStats, 0, sizeof(context->fragStats));
 #endif
 
    //Successful initialization
@@ -1795,13 +1799,12 @@ error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
             if(error == NO_ERROR)
             {
                //Create a new Destination Cache entry
-               entry = ndpCreateDestCacheEntry(interface);
+               entry = ndpCreateDestCacheEntry(interface,
+                  &pseudoHeader->destAddr);
 
                //Destination cache entry successfully created?
                if(entry != NULL)
                {
-                  //Destination address
-                  entry->destAddr = pseudoHeader->destAddr;
                   //Address of the next hop
                   entry->nextHop = destIpAddr;
 
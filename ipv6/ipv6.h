@@ -474,6 +474,9 @@ typedef struct
 #if (IPV6_FRAG_SUPPORT == ENABLED)
    uint32_t identification;                                     ///<IPv6 fragment identification field
    Ipv6FragDesc fragQueue[IPV6_MAX_FRAG_DATAGRAMS];             ///<IPv6 fragment reassembly queue
+   Ipv6FragDesc *fragHashTable[IPV6_FRAG_HASH_TABLE_SIZE];      ///<Hash table used to locate datagrams being reassembled
+   size_t fragMemSize;                                          ///<Amount of memory used by the reassembly queue
+   Ipv6FragStats fragStats;                                     ///<Reassembly statistics
 #endif
 } Ipv6Context;
 
@@ -165,6 +165,11 @@ error_t ipv6FragmentDatagram(NetInterface *interface,
 
 /**
  * @brief Parse Fragment header and reassemble original datagram
+ *
+ * Each fragment is copied once into a chunk sized to its payload. The
+ * chunks are linked in offset order so that the reassembled datagram can
+ * be passed to the upper layer without any further copy
+ *
  * @param[in] interface Underlying network interface
  * @param[in] ipPacket Multi-part buffer containing the incoming IPv6 packet
  * @param[in] ipPacketOffset Offset to the first byte of the IPv6 packet
@@ -176,14 +181,16 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
    size_t ipPacketOffset, size_t fragHeaderOffset, size_t nextHeaderOffset)
 {
    error_t error;
+   uint_t i;
    size_t n;
    size_t length;
    uint16_t offset;
-   uint16_t dataFirst;
-   uint16_t dataLast;
+   size_t first;
+   size_t last;
+   size_t dataStart;
+   size_t dataFirst;
+   size_t dataLast;
    Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
-   Ipv6HoleDesc *prevHole;
    Ipv6Header *ipHeader;
    Ipv6FragmentHeader *fragHeader;
 
@@ -243,9 +250,10 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
    }
 
    //Calculate the index of the first byte
-   dataFirst = offset & IPV6_OFFSET_MASK;
+   dataStart = offset & IPV6_OFFSET_MASK;
+   dataFirst = dataStart;
    //Calculate the index immediately following the last byte
-   dataLast = dataFirst + (uint16_t) length;
+   dataLast = dataFirst + length;
 
    //Search for a matching IP datagram being reassembled
    frag = ipv6SearchFragQueue(interface, ipHeader, fragHeader);
@@ -261,80 +269,45 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
       return;
    }
 
-   //The very first fragment requires special handling
-   if(!(offset & IPV6_OFFSET_MASK))
-   {
-      uint8_t *p;
-
-      //Calculate the length of the unfragmentable part
-      frag->unfragPartLength = fragHeaderOffset - ipPacketOffset;
+   //Initialize status code
+   error = NO_ERROR;
 
-      //The size of the reconstructed datagram exceeds the maximum value?
-      if((frag->unfragPartLength + frag->fragPartLength) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
+   //Start of exception handling block
+   do
+   {
+      //The very first fragment requires special handling
+      if(!(offset & IPV6_OFFSET_MASK))
       {
-         //Number of failures detected by the IP reassembly algorithm
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+         uint8_t *p;
 
-         //Retrieve the offset of the Fragment header within the packet
+         //Calculate the length of the unfragmentable part
          n = fragHeaderOffset - ipPacketOffset;
-         //Compute the exact offset of the Fragment Offset field
-         n += (uint8_t *) &fragHeader->fragmentOffset - (uint8_t *) fragHeader;
-
-         //The fragment must be discarded and an ICMP Parameter Problem
-         //message should be sent to the source of the fragment, pointing
-         //to the Fragment Offset field of the fragment packet
-         icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
-            ICMPV6_CODE_INVALID_HEADER_FIELD, n, ipPacket, ipPacketOffset);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
 
-      //Make sure the unfragmentable part entirely fits in the first chunk
-      if(frag->unfragPartLength > frag->buffer.chunk[0].size)
-      {
-         //Number of failures detected by the IP reassembly algorithm
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
+         //Make sure the first chunk is large enough
+         error = ipv6ResizeUnfragPart(interface, frag, n);
+         //Any error to report?
+         if(error)
+            break;
+
+         //The unfragmentable part of the reassembled packet consists
+         //of all headers up to, but not including, the Fragment header
+         //of the first fragment packet
+         netBufferRead(frag->buffer.chunk[0].address, ipPacket,
+            ipPacketOffset, n);
+
+         //Point to the Next Header field of the last header
+         p = (uint8_t *) frag->buffer.chunk[0].address +
+            (nextHeaderOffset - ipPacketOffset);
+
+         //The Next Header field of the last header of the unfragmentable
+         //part is obtained from the Next Header field of the first
+         //fragment's Fragment header
+         *p = fragHeader->nextHeader;
       }
 
-      //Fix the length of the first chunk
-      frag->buffer.chunk[0].length = (uint16_t) frag->unfragPartLength;
-
-      //The unfragmentable part of the reassembled packet consists
-      //of all headers up to, but not including, the Fragment header
-      //of the first fragment packet
-      netBufferCopy((NetBuffer *) &frag->buffer, 0, ipPacket,
-         ipPacketOffset, frag->unfragPartLength);
-
-      //Point to the Next Header field of the last header
-      p = netBufferAt((NetBuffer *) &frag->buffer,
-         nextHeaderOffset - ipPacketOffset);
-
-      //The Next Header field of the last header of the unfragmentable
-      //part is obtained from the Next Header field of the first
-      //fragment's Fragment header
-      *p = fragHeader->nextHeader;
-   }
-
-   //It may be necessary to increase the size of the buffer...
-   if(dataLast > frag->fragPartLength)
-   {
       //The size of the reconstructed datagram exceeds the maximum value?
       if((frag->unfragPartLength + dataLast) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
       {
-         //Number of failures detected by the IP reassembly algorithm
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
          //Retrieve the offset of the Fragment header within the packet
          n = fragHeaderOffset - ipPacketOffset;
          //Compute the exact offset of the Fragment Offset field
@@ -346,156 +319,126 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
          icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
             ICMPV6_CODE_INVALID_HEADER_FIELD, n, ipPacket, ipPacketOffset);
 
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
+         //Report an error
+         error = ERROR_INVALID_LENGTH;
+         break;
       }
 
-      //Adjust the size of the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->unfragPartLength + dataLast + sizeof(Ipv6HoleDesc));
-
-      //Any error to report?
-      if(error)
+      //Last fragment?
+      if(!(offset & IPV6_FLAG_M))
       {
-         //Number of failures detected by the IP reassembly algorithm
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-         //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+         //Check whether the total length of the datagram is consistent with
+         //the fragments that have already been received
+         if(frag->fragPartLength != 0 && frag->fragPartLength != dataLast)
+         {
+            //Report an error
+            error = ERROR_INVALID_LENGTH;
+            break;
+         }
 
-      //Actual length of the fragmentable part
-      frag->fragPartLength = dataLast;
-   }
+         //Any data beyond the end of the datagram?
+         if(frag->buffer.chunkCount > 1)
+         {
+            //Retrieve the last fragment received so far
+            i = frag->buffer.chunkCount - 1;
 
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
-   //Keep track of the previous hole in the list
-   prevHole = NULL;
+            //Check the offset of the last byte
+            if((frag->chunkOffset[i] + frag->buffer.chunk[i].length) > dataLast)
+            {
+               //Report an error
+               error = ERROR_INVALID_LENGTH;
+               break;
+            }
+         }
 
-   //Iterate through the hole descriptors
-   while(hole != NULL)
-   {
-      //Save lower and upper boundaries for later use
-      uint16_t holeFirst = hole->first;
-      uint16_t holeLast = hole->last;
+         //The length of the fragmentable part is now known
+         frag->fragPartLength = dataLast;
+      }
+      else if(frag->fragPartLength != 0 && dataLast > frag->fragPartLength)
+      {
+         //The fragment extends beyond the end of the datagram
+         error = ERROR_INVALID_LENGTH;
+         break;
+      }
 
-      //Check whether the newly arrived fragment interacts with this hole
-      //in some way
-      if(dataFirst < holeLast && dataLast > holeFirst)
+      //Loop through the fragments that have been received so far
+      for(i = 1; i < frag->buffer.chunkCount && dataFirst < dataLast; i++)
       {
+         //Range covered by the current fragment
+         first = frag->chunkOffset[i];
+         last = first + frag->buffer.chunk[i].length;
+
+         //The current fragment lies before the new data?
+         if(last <= dataFirst)
+            continue;
+         //The current fragment lies after the new data?
+         if(first >= dataLast)
+            break;
+
 #if (IPV6_OVERLAPPING_FRAG_SUPPORT == DISABLED)
          //When reassembling an IPv6 datagram, if one or more its constituent
          //fragments is determined to be an overlapping fragment, the entire
          //datagram must be silently discarded (refer to RFC 5722, section 4)
-         if(dataFirst < holeFirst || dataLast > holeLast)
+         if(first != dataStart || last != dataLast)
          {
-            //Number of failures detected by the IP reassembly algorithm
-            IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-            IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-
-            //Drop the reconstructed datagram
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return;
+            //Report an error
+            error = ERROR_INVALID_PACKET;
+            break;
          }
 #endif
-         //The current descriptor is no longer valid. We will destroy it,
-         //and in the next two steps, we will determine whether or not it
-         //is necessary to create any new hole descriptors
-         if(prevHole != NULL)
-            prevHole->next = hole->next;
-         else
-            frag->firstHole = hole->next;
-
-         //Is there still a hole at the beginning of the segment?
-         if(dataFirst > holeFirst)
+         //Is there any data to insert before the current fragment?
+         if(dataFirst < first)
          {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, holeFirst);
-            hole->first = holeFirst;
-            hole->last = dataFirst;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
+            //Insert the corresponding portion of the new fragment
+            error = ipv6InsertFragment(interface, frag, i, dataFirst, ipPacket,
+               fragHeaderOffset + sizeof(Ipv6FragmentHeader) +
+               (dataFirst - dataStart), first - dataFirst);
+            //Any error to report?
+            if(error)
+               break;
+
+            //Skip the newly inserted chunk
+            i++;
          }
 
-         //Is there still a hole at the end of the segment?
-         if(dataLast < holeLast && (offset & IPV6_FLAG_M))
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, dataLast);
-            hole->first = dataLast;
-            hole->last = holeLast;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-      }
-      else
-      {
-         //The newly arrived fragment does not interact with the current hole
-         prevHole = hole;
+         //Any portion of the new fragment that overlaps existing data is
+         //discarded
+         dataFirst = last;
       }
 
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, prevHole ? prevHole->next : frag->firstHole);
-   }
-
-   //Copy data from the fragment to the reassembly buffer
-   netBufferCopy((NetBuffer *) &frag->buffer, frag->unfragPartLength + dataFirst,
-      ipPacket, fragHeaderOffset + sizeof(Ipv6FragmentHeader), length);
-
-   //Dump hole descriptor list
-   ipv6DumpHoleList(frag);
-
-   //If the hole descriptor list is empty, the reassembly process is now complete
-   if(!ipv6FindHole(frag, frag->firstHole))
-   {
-      //Discard the extra hole descriptor that follows the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->unfragPartLength + frag->fragPartLength);
-
       //Check status code
       if(error)
+         break;
+
+      //Any remaining data?
+      if(dataFirst < dataLast)
       {
-         //Number of failures detected by the IP reassembly algorithm
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+         //Insert the remaining portion of the new fragment
+         error = ipv6InsertFragment(interface, frag, i, dataFirst, ipPacket,
+            fragHeaderOffset + sizeof(Ipv6FragmentHeader) +
+            (dataFirst - dataStart), dataLast - dataFirst);
+         //Any error to report?
+         if(error)
+            break;
       }
-      else
+
+      //Dump the list of fragments
+      ipv6DumpFragList(frag);
+
+      //Check whether the reassembly process is now complete
+      if(frag->fragPartLength > 0 && frag->receivedLen == frag->fragPartLength)
       {
          //Point to the IPv6 header
-         Ipv6Header *datagram = netBufferAt((NetBuffer *) &frag->buffer, 0);
+         Ipv6Header *datagram = frag->buffer.chunk[0].address;
+
+         //Upper-layer headers must not span several fragments
+         if(frag->buffer.chunk[1].length < MIN(frag->fragPartLength,
+            IPV6_FRAG_MIN_FIRST_LENGTH))
+         {
+            //Report an error
+            error = ERROR_INVALID_LENGTH;
+            break;
+         }
 
          //Fix the Payload Length field
          datagram->payloadLen = htons(frag->unfragPartLength +
@@ -505,12 +448,26 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
          IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmOKs, 1);
          IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmOKs, 1);
 
-         //Pass the original IPv6 datagram to the higher protocol layer
+         //Pass the original IPv6 datagram to the higher protocol layer. The
+         //chunks of the reassembly buffer are handed over without any copy
          ipv6ProcessPacket(interface, (NetBuffer *) &frag->buffer, 0);
+
+         //Release previously allocated memory
+         ipv6DeleteFragDesc(interface, frag);
       }
 
-      //Release previously allocated memory
-      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Number of failures detected by the IP reassembly algorithm
+      IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Drop the partially reconstructed datagram
+      ipv6DeleteFragDesc(interface, frag);
    }
 }
 
@@ -529,7 +486,7 @@ void ipv6FragTick(NetInterface *interface)
    error_t error;
    uint_t i;
    systime_t time;
-   Ipv6HoleDesc *hole;
+   Ipv6FragDesc *frag;
 
    //Get current time
    time = osGetSystemTime();
@@ -538,7 +495,7 @@ void ipv6FragTick(NetInterface *interface)
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
    {
       //Point to the current entry in the reassembly queue
-      Ipv6FragDesc *frag = &interface->ipv6Context.fragQueue[i];
+      frag = &interface->ipv6Context.fragQueue[i];
 
       //Make sure the entry is currently in use
       if(frag->buffer.chunkCount > 0)
@@ -556,16 +513,16 @@ void ipv6FragTick(NetInterface *interface)
             IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
             IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
 
-            //Point to the first hole descriptor
-            hole = ipv6FindHole(frag, frag->firstHole);
+            //Number of datagrams discarded because of a reassembly timeout
+            interface->ipv6Context.fragStats.reasmTimeouts++;
 
             //Make sure the fragment zero has been received
             //before sending an ICMPv6 message
-            if(hole != NULL && hole->first > 0)
+            if(frag->buffer.chunkCount > 1 && frag->chunkOffset[1] == 0)
             {
                //Fix the size of the reconstructed datagram
                error = netBufferSetLength((NetBuffer *) &frag->buffer,
-                  frag->unfragPartLength + hole->first);
+                  frag->unfragPartLength + frag->buffer.chunk[1].length);
 
                //Check status code
                if(!error)
@@ -577,7 +534,7 @@ void ipv6FragTick(NetInterface *interface)
             }
 
             //Drop the partially reconstructed datagram
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+            ipv6DeleteFragDesc(interface, frag);
          }
       }
    }
@@ -597,155 +554,421 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
 {
    error_t error;
    uint_t i;
+   uint_t h;
    Ipv6Header *datagram;
    Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
+   Ipv6Context *context;
 
-   //Search for a matching IP datagram being reassembled
+   //Point to the IPv6 context
+   context = &interface->ipv6Context;
+
+   //Calculate the hash value of the datagram
+   h = ipv6FragHash(packet, header->identification);
+
+   //Search the corresponding bucket for a matching IP datagram
+   for(frag = context->fragHashTable[h]; frag != NULL; frag = frag->next)
+   {
+      //Point to the corresponding datagram
+      datagram = frag->buffer.chunk[0].address;
+
+      //Check source and destination addresses
+      if(!ipv6CompAddr(&datagram->srcAddr, &packet->srcAddr))
+         continue;
+      if(!ipv6CompAddr(&datagram->destAddr, &packet->destAddr))
+         continue;
+      //Compare fragment identification fields
+      if(frag->identification != header->identification)
+         continue;
+
+      //A matching entry has been found in the reassembly queue
+      return frag;
+   }
+
+   //If the current packet does not match an existing entry
+   //in the reassembly queue, then create a new entry
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
    {
       //Point to the current entry in the reassembly queue
-      frag = &interface->ipv6Context.fragQueue[i];
+      frag = &context->fragQueue[i];
 
-      //Check whether the current entry is used?
-      if(frag->buffer.chunkCount > 0)
-      {
-         //Point to the corresponding datagram
-         datagram = netBufferAt((NetBuffer *) &frag->buffer, 0);
+      //The current entry is free?
+      if(!frag->buffer.chunkCount)
+         break;
+   }
 
-         //Check source and destination addresses
-         if(!ipv6CompAddr(&datagram->srcAddr, &packet->srcAddr))
-            continue;
-         if(!ipv6CompAddr(&datagram->destAddr, &packet->destAddr))
-            continue;
-         //Compare fragment identification fields
-         if(frag->identification != header->identification)
-            continue;
+   //The reassembly queue is full?
+   if(i >= IPV6_MAX_FRAG_DATAGRAMS)
+   {
+      //Evict the oldest datagram from the reassembly queue
+      frag = ipv6EvictFragDesc(interface, NULL);
+      //No entry available?
+      if(frag == NULL)
+         return NULL;
+   }
 
-         //A matching entry has been found in the reassembly queue
-         return frag;
-      }
+   //Number of chunks that comprise the reassembly buffer
+   frag->buffer.chunkCount = 0;
+   frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+
+   //Initial length of the reconstructed datagram
+   frag->unfragPartLength = 0;
+   frag->fragPartLength = 0;
+   frag->receivedLen = 0;
+   frag->memSize = 0;
+
+   //Allocate memory to hold the IPv6 header
+   error = ipv6ResizeUnfragPart(interface, frag, sizeof(Ipv6Header));
+   //Failed to allocate memory?
+   if(error)
+      return NULL;
+
+   //Copy IPv6 header from the incoming fragment
+   memcpy(frag->buffer.chunk[0].address, packet, sizeof(Ipv6Header));
+
+   //Save current time
+   frag->timestamp = osGetSystemTime();
+   //Record fragment identification field
+   frag->identification = header->identification;
+
+   //Insert the new entry at the head of the bucket
+   frag->next = context->fragHashTable[h];
+   context->fragHashTable[h] = frag;
+
+   //Return the matching fragment descriptor
+   return frag;
+}
+
+
+/**
+ * @brief Flush IPv6 reassembly queue
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv6FlushFragQueue(NetInterface *interface)
+{
+   uint_t i;
+   Ipv6Context *context;
+
+   //Point to the IPv6 context
+   context = &interface->ipv6Context;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Drop any partially reconstructed datagram
+      netBufferSetLength((NetBuffer *) &context->fragQueue[i].buffer, 0);
    }
 
-   //If the current packet does not match an existing entry
-   //in the reassembly queue, then create a new entry
+   //Clear the hash table
+   memset(context->fragHashTable, 0, sizeof(context->fragHashTable));
+   //The reassembly queue is now empty
+   context->fragMemSize = 0;
+}
+
+
+/**
+ * @brief Evict the oldest datagram from the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] exclude Entry that must not be evicted (optional parameter)
+ * @return Pointer to the entry that has been freed, if any
+ **/
+
+Ipv6FragDesc *ipv6EvictFragDesc(NetInterface *interface,
+   const Ipv6FragDesc *exclude)
+{
+   uint_t i;
+   Ipv6FragDesc *frag;
+   Ipv6FragDesc *oldestFrag;
+
+   //Keep track of the oldest entry
+   oldestFrag = NULL;
+
+   //Loop through the reassembly queue
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
    {
       //Point to the current entry in the reassembly queue
       frag = &interface->ipv6Context.fragQueue[i];
 
-      //The current entry is free?
-      if(!frag->buffer.chunkCount)
+      //Check whether the entry is in use
+      if(frag->buffer.chunkCount > 0 && frag != exclude)
       {
-         //Number of chunks that comprise the reassembly buffer
-         frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+         //Keep track of the oldest entry
+         if(oldestFrag == NULL ||
+            timeCompare(frag->timestamp, oldestFrag->timestamp) < 0)
+         {
+            oldestFrag = frag;
+         }
+      }
+   }
 
-         //Allocate sufficient memory to hold the IPv6 header and
-         //the first hole descriptor
-         error = netBufferSetLength((NetBuffer *) &frag->buffer,
-            NET_MEM_POOL_BUFFER_SIZE + sizeof(Ipv6HoleDesc));
+   //Any entry found?
+   if(oldestFrag != NULL)
+   {
+      //Debug message
+      TRACE_INFO("Evicting IPv6 datagram from the reassembly queue...\r\n");
 
-         //Failed to allocate memory?
-         if(error)
+      //Number of failures detected by the IP reassembly algorithm
+      IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Number of datagrams evicted from the reassembly queue
+      interface->ipv6Context.fragStats.reasmEvictions++;
+
+      //Drop the partially reconstructed datagram
+      ipv6DeleteFragDesc(interface, oldestFrag);
+   }
+
+   //Return a pointer to the entry that has been freed
+   return oldestFrag;
+}
+
+
+/**
+ * @brief Remove a datagram from the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ **/
+
+void ipv6DeleteFragDesc(NetInterface *interface, Ipv6FragDesc *frag)
+{
+   uint_t h;
+   Ipv6FragDesc **p;
+   Ipv6Context *context;
+
+   //Point to the IPv6 context
+   context = &interface->ipv6Context;
+
+   //Make sure the entry is currently in use
+   if(frag->buffer.chunkCount > 0)
+   {
+      //Calculate the hash value of the datagram
+      h = ipv6FragHash(frag->buffer.chunk[0].address, frag->identification);
+
+      //Remove the entry from the bucket
+      for(p = &context->fragHashTable[h]; *p != NULL; p = &(*p)->next)
+      {
+         //Matching entry?
+         if(*p == frag)
          {
-            //Clean up side effects
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return NULL;
+            *p = frag->next;
+            break;
          }
+      }
+
+      //Release previously allocated memory
+      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      //Update the amount of memory used by the reassembly queue
+      context->fragMemSize -= frag->memSize;
+
+      //The entry is now free
+      frag->next = NULL;
+      frag->memSize = 0;
+   }
+}
+
+
+/**
+ * @brief Adjust the size of the unfragmentable part
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ * @param[in] length Length of the unfragmentable part
+ * @return Error code
+ **/
+
+error_t ipv6ResizeUnfragPart(NetInterface *interface, Ipv6FragDesc *frag,
+   size_t length)
+{
+   void *p;
+   ChunkDesc *chunk;
+   Ipv6Context *context;
 
-         //Initial length of the reconstructed datagram
-         frag->unfragPartLength = sizeof(Ipv6Header);
-         frag->fragPartLength = 0;
-
-         //Fix the length of the first chunk
-         frag->buffer.chunk[0].length = (uint16_t) frag->unfragPartLength;
-         //Copy IPv6 header from the incoming fragment
-         netBufferWrite((NetBuffer *) &frag->buffer, 0, packet, frag->unfragPartLength);
-
-         //Save current time
-         frag->timestamp = osGetSystemTime();
-         //Record fragment identification field
-         frag->identification = header->identification;
-         //Create a new entry in the hole descriptor list
-         frag->firstHole = 0;
-
-         //Point to first hole descriptor
-         hole = ipv6FindHole(frag, frag->firstHole);
-         //The entry describes the datagram as being completely missing
-         hole->first = 0;
-         hole->last = IPV6_INFINITY;
-         hole->next = IPV6_INFINITY;
-
-         //Dump hole descriptor list
-         ipv6DumpHoleList(frag);
-
-         //Return the matching fragment descriptor
-         return frag;
+   //Point to the IPv6 context
+   context = &interface->ipv6Context;
+   //Point to the first chunk of the reassembly buffer
+   chunk = &frag->buffer.chunk[0];
+
+   //The unfragmentable part must be at least as large as the IPv6 header
+   if(length < sizeof(Ipv6Header) || length > NET_MEM_POOL_BUFFER_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Check whether the current chunk is large enough
+   if(frag->buffer.chunkCount == 0 || chunk->size < length)
+   {
+      //The unfragmentable part counts against the memory budget as well
+      while((context->fragMemSize + NET_MEM_ALLOC_SIZE(length)) >
+         IPV6_FRAG_MAX_MEM_SIZE)
+      {
+         //No other datagram can be evicted?
+         if(ipv6EvictFragDesc(interface, frag) == NULL)
+            return ERROR_OUT_OF_RESOURCES;
       }
+
+      //Allocate a new chunk
+      p = memPoolAlloc(length);
+      //Failed to allocate memory?
+      if(p == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Preserve the IPv6 header, if any
+      if(frag->buffer.chunkCount > 0)
+      {
+         //Copy the IPv6 header to the new chunk
+         memcpy(p, chunk->address, sizeof(Ipv6Header));
+         //Release the previous chunk
+         memPoolFree(chunk->address);
+
+         //Update the amount of memory used by the reassembly queue
+         frag->memSize -= NET_MEM_ALLOC_SIZE(chunk->size);
+         context->fragMemSize -= NET_MEM_ALLOC_SIZE(chunk->size);
+      }
+
+      //Save the new chunk
+      chunk->address = p;
+      chunk->size = (uint16_t) length;
+      frag->buffer.chunkCount = MAX(frag->buffer.chunkCount, 1);
+
+      //Update the amount of memory used by the reassembly queue
+      frag->memSize += NET_MEM_ALLOC_SIZE(chunk->size);
+      context->fragMemSize += NET_MEM_ALLOC_SIZE(chunk->size);
    }
 
-   //The reassembly queue is full
-   return NULL;
+   //Fix the length of the first chunk
+   chunk->length = (uint16_t) length;
+   frag->unfragPartLength = length;
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Flush IPv6 reassembly queue
+ * @brief Insert a fragment in the reassembly buffer
  * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ * @param[in] index Position of the new chunk in the reassembly buffer
+ * @param[in] offset Offset of the data within the fragmentable part
+ * @param[in] buffer Multi-part buffer containing the data to be inserted
+ * @param[in] bufferOffset Offset to the first byte to be inserted
+ * @param[in] length Number of bytes to be inserted
+ * @return Error code
  **/
 
-void ipv6FlushFragQueue(NetInterface *interface)
+error_t ipv6InsertFragment(NetInterface *interface, Ipv6FragDesc *frag,
+   uint_t index, size_t offset, const NetBuffer *buffer, size_t bufferOffset,
+   size_t length)
 {
    uint_t i;
+   size_t size;
+   void *p;
+   Ipv6Context *context;
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   //Point to the IPv6 context
+   context = &interface->ipv6Context;
+
+   //Limit the number of fragments per datagram
+   if(frag->buffer.chunkCount >= frag->buffer.maxChunkCount)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //When fixed-size blocks are used, a whole block is consumed by each
+   //chunk, however small the fragment is
+   size = NET_MEM_ALLOC_SIZE(length);
+
+   //The memory budget is shared by all the datagrams being reassembled.
+   //Evict the oldest datagrams until there is enough room
+   while((context->fragMemSize + size) > IPV6_FRAG_MAX_MEM_SIZE)
    {
-      //Drop any partially reconstructed datagram
-      netBufferSetLength((NetBuffer *) &interface->ipv6Context.fragQueue[i].buffer, 0);
+      //No other datagram can be evicted?
+      if(ipv6EvictFragDesc(interface, frag) == NULL)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Allocate a chunk that exactly fits the data
+   p = memPoolAlloc(length);
+   //Failed to allocate memory?
+   if(p == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Make room for the new chunk
+   for(i = frag->buffer.chunkCount; i > index; i--)
+   {
+      frag->buffer.chunk[i] = frag->buffer.chunk[i - 1];
+      frag->chunkOffset[i] = frag->chunkOffset[i - 1];
    }
+
+   //Copy data from the fragment
+   netBufferRead(p, buffer, bufferOffset, length);
+
+   //Insert the new chunk
+   frag->buffer.chunk[index].address = p;
+   frag->buffer.chunk[index].length = (uint16_t) length;
+   frag->buffer.chunk[index].size = (uint16_t) length;
+   frag->chunkOffset[index] = (uint16_t) offset;
+   frag->buffer.chunkCount++;
+
+   //Update the number of bytes received so far
+   frag->receivedLen += length;
+
+   //Update the amount of memory used by the reassembly queue
+   frag->memSize += size;
+   context->fragMemSize += size;
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Retrieve hole descriptor
- * @param[in] frag IPv6 fragment descriptor
- * @param[in] offset Offset of the hole
- * @return A pointer to the hole descriptor is returned if the
- *   specified offset is valid. Otherwise NULL is returned
+ * @brief Calculate the hash value of a fragmented datagram
+ * @param[in] packet IPv6 header of the datagram
+ * @param[in] identification Fragment identification field
+ * @return Index of the corresponding bucket
  **/
 
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset)
+uint_t ipv6FragHash(const Ipv6Header *packet, uint32_t identification)
 {
-   //Return a pointer to the hole descriptor
-   return netBufferAt((NetBuffer *) &frag->buffer, frag->unfragPartLength + offset);
+   uint_t i;
+   uint32_t h;
+
+   //Initialize hash value
+   h = identification;
+
+   //The datagram is identified by its source and destination addresses
+   //and by its identification field
+   for(i = 0; i < 4; i++)
+   {
+      h ^= packet->srcAddr.dw[i];
+      h ^= packet->destAddr.dw[i];
+   }
+
+   //Fold the result
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the bucket
+   return h % IPV6_FRAG_HASH_TABLE_SIZE;
 }
 
 
 /**
- * @brief Dump hole descriptor list
+ * @brief Dump the list of fragments received so far
  * @param[in] frag IPv6 fragment descriptor
  **/
 
-void ipv6DumpHoleList(Ipv6FragDesc *frag)
+void ipv6DumpFragList(Ipv6FragDesc *frag)
 {
 //Check debugging level
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   Ipv6HoleDesc *hole;
+   uint_t i;
 
    //Debug message
-   TRACE_DEBUG("Hole descriptor list:\r\n");
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
+   TRACE_DEBUG("Fragment list:\r\n");
 
-   //Loop through the hole descriptor list
-   while(hole != NULL)
+   //Loop through the fragments
+   for(i = 1; i < frag->buffer.chunkCount; i++)
    {
-      //Display current hole
-      TRACE_DEBUG("  %" PRIu16 " - %" PRIu16 "\r\n", hole->first, hole->last);
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, hole->next);
+      //Display current fragment
+      TRACE_DEBUG("  %" PRIu16 " - %" PRIu16 "\r\n", frag->chunkOffset[i],
+         frag->chunkOffset[i] + frag->buffer.chunk[i].length);
    }
 #endif
 }
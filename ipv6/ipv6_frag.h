@@ -59,7 +59,7 @@
 //Maximum number of fragmented packets the host will accept
 //and hold in the reassembly queue simultaneously
 #ifndef IPV6_MAX_FRAG_DATAGRAMS
-   #define IPV6_MAX_FRAG_DATAGRAMS 4
+   #define IPV6_MAX_FRAG_DATAGRAMS 8
 #elif (IPV6_MAX_FRAG_DATAGRAMS < 1)
    #error IPV6_MAX_FRAG_DATAGRAMS parameter is not valid
 #endif
@@ -67,10 +67,31 @@
 //Maximum datagram size the host will accept when reassembling fragments
 #ifndef IPV6_MAX_FRAG_DATAGRAM_SIZE
    #define IPV6_MAX_FRAG_DATAGRAM_SIZE 8192
-#elif (IPV6_MAX_FRAG_DATAGRAM_SIZE < 1280)
+#elif (IPV6_MAX_FRAG_DATAGRAM_SIZE < 1280 || IPV6_MAX_FRAG_DATAGRAM_SIZE > 65535)
    #error IPV6_MAX_FRAG_DATAGRAM_SIZE parameter is not valid
 #endif
 
+//Maximum number of fragments per datagram
+#ifndef IPV6_MAX_FRAG_COUNT
+   #define IPV6_MAX_FRAG_COUNT 16
+#elif (IPV6_MAX_FRAG_COUNT < 2)
+   #error IPV6_MAX_FRAG_COUNT parameter is not valid
+#endif
+
+//Size of the hash table used to locate datagrams being reassembled
+#ifndef IPV6_FRAG_HASH_TABLE_SIZE
+   #define IPV6_FRAG_HASH_TABLE_SIZE 8
+#elif (IPV6_FRAG_HASH_TABLE_SIZE < 1)
+   #error IPV6_FRAG_HASH_TABLE_SIZE parameter is not valid
+#endif
+
+//Amount of memory shared by all the datagrams being reassembled
+#ifndef IPV6_FRAG_MAX_MEM_SIZE
+   #define IPV6_FRAG_MAX_MEM_SIZE 32768
+#elif (IPV6_FRAG_MAX_MEM_SIZE < IPV6_MAX_FRAG_DATAGRAM_SIZE)
+   #error IPV6_FRAG_MAX_MEM_SIZE parameter is not valid
+#endif
+
 //Maximum time an IPv6 fragment can spend waiting to be reassembled
 #ifndef IPV6_FRAG_TIME_TO_LIVE
    #define IPV6_FRAG_TIME_TO_LIVE 15000
@@ -78,8 +99,8 @@
    #error IPV6_FRAG_TIME_TO_LIVE parameter is not valid
 #endif
 
-//Infinity is implemented by a very large integer
-#define IPV6_INFINITY 0xFFFF
+//Minimum amount of data the first fragment must carry
+#define IPV6_FRAG_MIN_FIRST_LENGTH 64
 
 //C++ guard
 #ifdef __cplusplus
@@ -87,30 +108,6 @@ extern "C" {
 #endif
 
 
-//CodeWarrior or Win32 compiler?
-#if defined(__CWCC__) || defined(_WIN32)
-   #pragma pack(push, 1)
-#endif
-
-
-/**
- * @brief Hole descriptor
- **/
-
-typedef __start_packed struct
-{
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} __end_packed Ipv6HoleDesc;
-
-
-//CodeWarrior or Win32 compiler?
-#if defined(__CWCC__) || defined(_WIN32)
-   #pragma pack(pop)
-#endif
-
-
 /**
  * @brief Reassembly buffer
  **/
@@ -119,25 +116,43 @@ typedef struct
 {
    uint_t chunkCount;
    uint_t maxChunkCount;
-   ChunkDesc chunk[N(IPV6_MAX_FRAG_DATAGRAM_SIZE) + 1];
+   ChunkDesc chunk[IPV6_MAX_FRAG_COUNT + 1];
 } Ipv6ReassemblyBuffer;
 
 
 /**
  * @brief Fragmented packet descriptor
+ *
+ * The first chunk of the reassembly buffer holds the unfragmentable part.
+ * The following chunks hold the fragmentable part, sorted by offset
+ *
  **/
 
-typedef struct
+typedef struct _Ipv6FragDesc
 {
-   systime_t timestamp;         ///<Time at which the first fragment was received
-   uint32_t identification;     ///<Fragment identification field
-   size_t unfragPartLength;     ///<Length of the unfragmentable part
-   size_t fragPartLength;       ///<Length of the fragmentable part
-   uint16_t firstHole;          ///<Index of the first hole
-   Ipv6ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
+   struct _Ipv6FragDesc *next;                 ///<Next entry in the same hash bucket
+   systime_t timestamp;                        ///<Time at which the first fragment was received
+   uint32_t identification;                    ///<Fragment identification field
+   size_t unfragPartLength;                    ///<Length of the unfragmentable part
+   size_t fragPartLength;                      ///<Length of the fragmentable part (zero until the last fragment is received)
+   size_t receivedLen;                         ///<Number of bytes of the fragmentable part received so far
+   size_t memSize;                             ///<Amount of memory used by the datagram
+   uint16_t chunkOffset[IPV6_MAX_FRAG_COUNT + 1]; ///<Offset of each fragment within the fragmentable part
+   Ipv6ReassemblyBuffer buffer;                ///<Buffer containing the reassembled datagram
 } Ipv6FragDesc;
 
 
+/**
+ * @brief Reassembly statistics
+ **/
+
+typedef struct
+{
+   uint32_t reasmTimeouts;  ///<Number of datagrams discarded because the reassembly timer expired
+   uint32_t reasmEvictions; ///<Number of datagrams evicted to make room for newer ones
+} Ipv6FragStats;
+
+
 //Tick counter to handle periodic operations
 extern systime_t ipv6FragTickCounter;
 
@@ -156,8 +171,20 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
 
 void ipv6FlushFragQueue(NetInterface *interface);
 
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset);
-void ipv6DumpHoleList(Ipv6FragDesc *frag);
+Ipv6FragDesc *ipv6EvictFragDesc(NetInterface *interface,
+   const Ipv6FragDesc *exclude);
+
+void ipv6DeleteFragDesc(NetInterface *interface, Ipv6FragDesc *frag);
+
+error_t ipv6ResizeUnfragPart(NetInterface *interface, Ipv6FragDesc *frag,
+   size_t length);
+
+error_t ipv6InsertFragment(NetInterface *interface, Ipv6FragDesc *frag,
+   uint_t index, size_t offset, const NetBuffer *buffer, size_t bufferOffset,
+   size_t length);
+
+uint_t ipv6FragHash(const Ipv6Header *packet, uint32_t identification);
+void ipv6DumpFragList(Ipv6FragDesc *frag);
 
 //C++ guard
 #ifdef __cplusplus
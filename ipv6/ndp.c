@@ -141,14 +141,11 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
    else
    {
       //If no entry exists, then create a new one
-      entry = ndpCreateNeighborCacheEntry(interface);
+      entry = ndpCreateNeighborCacheEntry(interface, ipAddr);
 
       //Neighbor Cache entry successfully created?
       if(entry != NULL)
       {
-         //Record the IPv6 address whose MAC address is unknown
-         entry->ipAddr = *ipAddr;
-
          //Reset retransmission counter
          entry->retransmitCount = 0;
          //No packet are pending in the transmit queue
@@ -545,13 +542,12 @@ void ndpProcessRouterAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader
       if(linkLayerAddrOption)
       {
          //Create an entry for the router
-         entry = ndpCreateNeighborCacheEntry(interface);
+         entry = ndpCreateNeighborCacheEntry(interface, &pseudoHeader->srcAddr);
 
          //Neighbor cache entry successfully created?
          if(entry)
          {
-            //Record the IPv6 address and the corresponding MAC address
-            entry->ipAddr = pseudoHeader->srcAddr;
+            //Record the corresponding MAC address
             entry->macAddr = linkLayerAddrOption->linkLayerAddr;
             //The IsRouter flag must be set to TRUE
             entry->isRouter = TRUE;
@@ -828,13 +824,13 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
       if(!neighborCacheEntry)
       {
          //Create an entry
-         neighborCacheEntry = ndpCreateNeighborCacheEntry(interface);
+         neighborCacheEntry = ndpCreateNeighborCacheEntry(interface,
+            &pseudoHeader->srcAddr);
 
          //Neighbor Cache entry successfully created?
          if(neighborCacheEntry)
          {
-            //Record the IPv6 and the corresponding MAC address
-            neighborCacheEntry->ipAddr = pseudoHeader->srcAddr;
+            //Record the corresponding MAC address
             neighborCacheEntry->macAddr = option->linkLayerAddr;
             //Save current time
             neighborCacheEntry->timestamp = osGetSystemTime();
@@ -1251,13 +1247,11 @@ void ndpProcessRedirect(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
    {
       //If no Destination Cache entry exists for the destination, an
       //implementation should create such an entry
-      destCacheEntry = ndpCreateDestCacheEntry(interface);
+      destCacheEntry = ndpCreateDestCacheEntry(interface, &message->destAddr);
 
       //Destination cache entry successfully created?
       if(destCacheEntry)
       {
-         //Destination address
-         destCacheEntry->destAddr = message->destAddr;
          //Address of the next hop
          destCacheEntry->nextHop = message->targetAddr;
 
@@ -1289,13 +1283,12 @@ void ndpProcessRedirect(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
       if(!neighborCacheEntry)
       {
          //Create an entry for the target
-         neighborCacheEntry = ndpCreateNeighborCacheEntry(interface);
+         neighborCacheEntry = ndpCreateNeighborCacheEntry(interface,
+            &message->targetAddr);
 
          //Neighbor cache entry successfully created?
          if(neighborCacheEntry)
          {
-            //Record the Target address
-            neighborCacheEntry->ipAddr = message->targetAddr;
             //The cached link-layer address is copied from the option
             neighborCacheEntry->macAddr = option->linkLayerAddr;
             //Newly created Neighbor Cache entries should set the IsRouter flag to FALSE
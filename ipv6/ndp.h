@@ -586,7 +586,9 @@ typedef struct
    systime_t timestamp;                                          ///<Timestamp to manage retransmissions
    systime_t timeout;                                            ///<Timeout value
    NdpNeighborCacheEntry neighborCache[NDP_NEIGHBOR_CACHE_SIZE]; ///<Neighbor cache
+   uint_t neighborCacheMaxDist;                                  ///<Longest probe sequence in the Neighbor cache
    NdpDestCacheEntry destCache[NDP_DEST_CACHE_SIZE];             ///<Destination cache
+   uint_t destCacheMaxDist;                                      ///<Longest probe sequence in the Destination cache
 } NdpContext;
 
 
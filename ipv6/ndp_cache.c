@@ -46,42 +46,69 @@
 
 /**
  * @brief Create a new entry in the Neighbor cache
+ *
+ * The Neighbor cache is organized as an open-addressing hash table. The
+ * entry is placed in the first free slot following the home slot of the
+ * address, so that lookups only need to examine a few entries
+ *
  * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 address
  * @return Pointer to the newly created entry
  **/
 
-NdpNeighborCacheEntry *ndpCreateNeighborCacheEntry(NetInterface *interface)
+NdpNeighborCacheEntry *ndpCreateNeighborCacheEntry(NetInterface *interface,
+   const Ipv6Addr *ipAddr)
 {
    uint_t i;
+   uint_t n;
+   uint_t h;
+   uint_t oldestDist;
    systime_t time;
+   NdpContext *context;
    NdpNeighborCacheEntry *entry;
    NdpNeighborCacheEntry *oldestEntry;
 
+   //Point to the NDP context
+   context = &interface->ndpContext;
+
    //Get current time
    time = osGetSystemTime();
 
+   //Calculate the home slot of the address
+   h = ndpHashAddr(ipAddr) % NDP_NEIGHBOR_CACHE_SIZE;
+
    //Keep track of the oldest entry
-   oldestEntry = &interface->ndpContext.neighborCache[0];
+   oldestEntry = NULL;
+   oldestDist = 0;
 
-   //Loop through Neighbor cache entries
-   for(i = 0; i < NDP_NEIGHBOR_CACHE_SIZE; i++)
+   //Loop through Neighbor cache entries, starting from the home slot
+   for(n = 0; n < NDP_NEIGHBOR_CACHE_SIZE; n++)
    {
       //Point to the current entry
-      entry = &interface->ndpContext.neighborCache[i];
+      i = (h + n) % NDP_NEIGHBOR_CACHE_SIZE;
+      entry = &context->neighborCache[i];
 
       //Check whether the entry is currently in used or not
       if(entry->state == NDP_STATE_NONE)
       {
          //Erase contents
          memset(entry, 0, sizeof(NdpNeighborCacheEntry));
+         //Record the IPv6 address
+         entry->ipAddr = *ipAddr;
+
+         //Update the length of the longest probe sequence
+         context->neighborCacheMaxDist = MAX(context->neighborCacheMaxDist, n);
+
          //Return a pointer to the Neighbor cache entry
          return entry;
       }
 
       //Keep track of the oldest entry in the table
-      if((time - entry->timestamp) > (time - oldestEntry->timestamp))
+      if(oldestEntry == NULL ||
+         (time - entry->timestamp) > (time - oldestEntry->timestamp))
       {
          oldestEntry = entry;
+         oldestDist = n;
       }
    }
 
@@ -89,6 +116,12 @@ NdpNeighborCacheEntry *ndpCreateNeighborCacheEntry(NetInterface *interface)
    ndpFlushQueuedPackets(interface, oldestEntry);
    //The oldest entry is removed whenever the table runs out of space
    memset(oldestEntry, 0, sizeof(NdpNeighborCacheEntry));
+   //Record the IPv6 address
+   oldestEntry->ipAddr = *ipAddr;
+
+   //Update the length of the longest probe sequence
+   context->neighborCacheMaxDist = MAX(context->neighborCacheMaxDist,
+      oldestDist);
 
    //Return a pointer to the Neighbor cache entry
    return oldestEntry;
@@ -106,13 +139,23 @@ NdpNeighborCacheEntry *ndpCreateNeighborCacheEntry(NetInterface *interface)
 NdpNeighborCacheEntry *ndpFindNeighborCacheEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
    uint_t i;
+   uint_t n;
+   uint_t h;
+   NdpContext *context;
    NdpNeighborCacheEntry *entry;
 
-   //Loop through Neighbor cache entries
-   for(i = 0; i < NDP_NEIGHBOR_CACHE_SIZE; i++)
+   //Point to the NDP context
+   context = &interface->ndpContext;
+
+   //Calculate the home slot of the address
+   h = ndpHashAddr(ipAddr) % NDP_NEIGHBOR_CACHE_SIZE;
+
+   //An entry can never be found further than the longest probe sequence
+   for(n = 0; n <= context->neighborCacheMaxDist; n++)
    {
       //Point to the current entry
-      entry = &interface->ndpContext.neighborCache[i];
+      i = (h + n) % NDP_NEIGHBOR_CACHE_SIZE;
+      entry = &context->neighborCache[i];
 
       //Check whether the entry is currently in used
       if(entry->state != NDP_STATE_NONE)
@@ -280,6 +323,53 @@ void ndpFlushNeighborCache(NetInterface *interface)
       //Release Neighbor cache entry
       entry->state = NDP_STATE_NONE;
    }
+
+   //The Neighbor cache is now empty
+   interface->ndpContext.neighborCacheMaxDist = 0;
+}
+
+
+/**
+ * @brief Reachability confirmation from an upper-layer protocol
+ *
+ * Upper-layer protocols such as TCP provide a positive confirmation that
+ * a connection is making forward progress. The corresponding Neighbor cache
+ * entry is kept in REACHABLE state, without sending any probe (refer to
+ * RFC 4861, section 7.3.1)
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination IPv6 address
+ **/
+
+void ndpConfirmReachability(NetInterface *interface, const Ipv6Addr *destAddr)
+{
+   NdpDestCacheEntry *destCacheEntry;
+   NdpNeighborCacheEntry *neighborCacheEntry;
+
+   //Retrieve the next-hop neighbor from the Destination cache
+   destCacheEntry = ndpFindDestCacheEntry(interface, destAddr);
+
+   //Any matching entry?
+   if(destCacheEntry != NULL)
+   {
+      //Search the Neighbor cache for the next-hop address
+      neighborCacheEntry = ndpFindNeighborCacheEntry(interface,
+         &destCacheEntry->nextHop);
+
+      //The link-layer address of the neighbor must be known
+      if(neighborCacheEntry != NULL &&
+         neighborCacheEntry->state != NDP_STATE_INCOMPLETE)
+      {
+         //Save current time
+         neighborCacheEntry->timestamp = osGetSystemTime();
+         //Reachable time
+         neighborCacheEntry->timeout = interface->ndpContext.reachableTime;
+         //Reset retransmission counter
+         neighborCacheEntry->retransmitCount = 0;
+         //Switch to the REACHABLE state
+         neighborCacheEntry->state = NDP_STATE_REACHABLE;
+      }
+   }
 }
 
 
@@ -389,46 +479,73 @@ void ndpFlushQueuedPackets(NetInterface *interface, NdpNeighborCacheEntry *entry
 /**
  * @brief Create a new entry in the Destination Cache
  * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination IPv6 address
  * @return Pointer to the newly created entry
  **/
 
-NdpDestCacheEntry *ndpCreateDestCacheEntry(NetInterface *interface)
+NdpDestCacheEntry *ndpCreateDestCacheEntry(NetInterface *interface,
+   const Ipv6Addr *destAddr)
 {
    uint_t i;
+   uint_t n;
+   uint_t h;
+   uint_t oldestDist;
    systime_t time;
+   NdpContext *context;
    NdpDestCacheEntry *entry;
    NdpDestCacheEntry *oldestEntry;
 
+   //Point to the NDP context
+   context = &interface->ndpContext;
+
    //Get current time
    time = osGetSystemTime();
 
+   //Calculate the home slot of the address
+   h = ndpHashAddr(destAddr) % NDP_DEST_CACHE_SIZE;
+
    //Keep track of the oldest entry
-   oldestEntry = &interface->ndpContext.destCache[0];
+   oldestEntry = NULL;
+   oldestDist = 0;
 
-   //Loop through Destination cache entries
-   for(i = 0; i < NDP_DEST_CACHE_SIZE; i++)
+   //Loop through Destination cache entries, starting from the home slot
+   for(n = 0; n < NDP_DEST_CACHE_SIZE; n++)
    {
       //Point to the current entry
-      entry = &interface->ndpContext.destCache[i];
+      i = (h + n) % NDP_DEST_CACHE_SIZE;
+      entry = &context->destCache[i];
 
       //Check whether the entry is currently in used or not
       if(ipv6CompAddr(&entry->destAddr, &IPV6_UNSPECIFIED_ADDR))
       {
          //Erase contents
          memset(entry, 0, sizeof(NdpDestCacheEntry));
+         //Record the destination address
+         entry->destAddr = *destAddr;
+
+         //Update the length of the longest probe sequence
+         context->destCacheMaxDist = MAX(context->destCacheMaxDist, n);
+
          //Return a pointer to the Destination cache entry
          return entry;
       }
 
       //Keep track of the oldest entry in the table
-      if((time - entry->timestamp) > (time - oldestEntry->timestamp))
+      if(oldestEntry == NULL ||
+         (time - entry->timestamp) > (time - oldestEntry->timestamp))
       {
          oldestEntry = entry;
+         oldestDist = n;
       }
    }
 
    //The oldest entry is removed whenever the table runs out of space
    memset(oldestEntry, 0, sizeof(NdpDestCacheEntry));
+   //Record the destination address
+   oldestEntry->destAddr = *destAddr;
+
+   //Update the length of the longest probe sequence
+   context->destCacheMaxDist = MAX(context->destCacheMaxDist, oldestDist);
 
    //Return a pointer to the Destination cache entry
    return oldestEntry;
@@ -446,13 +563,23 @@ NdpDestCacheEntry *ndpCreateDestCacheEntry(NetInterface *interface)
 NdpDestCacheEntry *ndpFindDestCacheEntry(NetInterface *interface, const Ipv6Addr *destAddr)
 {
    uint_t i;
+   uint_t n;
+   uint_t h;
+   NdpContext *context;
    NdpDestCacheEntry *entry;
 
-   //Loop through Destination Cache entries
-   for(i = 0; i < NDP_DEST_CACHE_SIZE; i++)
+   //Point to the NDP context
+   context = &interface->ndpContext;
+
+   //Calculate the home slot of the address
+   h = ndpHashAddr(destAddr) % NDP_DEST_CACHE_SIZE;
+
+   //An entry can never be found further than the longest probe sequence
+   for(n = 0; n <= context->destCacheMaxDist; n++)
    {
       //Point to the current entry
-      entry = &interface->ndpContext.destCache[i];
+      i = (h + n) % NDP_DEST_CACHE_SIZE;
+      entry = &context->destCache[i];
 
       //Current entry matches the specified destination address?
       if(ipv6CompAddr(&entry->destAddr, destAddr))
@@ -474,6 +601,32 @@ void ndpFlushDestCache(NetInterface *interface)
    //Clear the Destination Cache
    memset(interface->ndpContext.destCache, 0,
       sizeof(interface->ndpContext.destCache));
+
+   //The Destination Cache is now empty
+   interface->ndpContext.destCacheMaxDist = 0;
+}
+
+
+/**
+ * @brief Calculate the hash value of an IPv6 address
+ * @param[in] ipAddr IPv6 address
+ * @return Hash value
+ **/
+
+uint_t ndpHashAddr(const Ipv6Addr *ipAddr)
+{
+   uint32_t h;
+
+   //Neighbors usually share the same prefix, hence the interface identifier
+   //is mixed into the hash value
+   h = ipAddr->dw[0] ^ ipAddr->dw[1] ^ ipAddr->dw[2] ^ ipAddr->dw[3];
+
+   //Fold the result
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the hash value
+   return h;
 }
 
 #endif
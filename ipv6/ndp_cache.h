@@ -41,19 +41,27 @@ extern "C" {
 #endif
 
 //NDP related functions
-NdpNeighborCacheEntry *ndpCreateNeighborCacheEntry(NetInterface *interface);
+NdpNeighborCacheEntry *ndpCreateNeighborCacheEntry(NetInterface *interface,
+   const Ipv6Addr *ipAddr);
+
 NdpNeighborCacheEntry *ndpFindNeighborCacheEntry(NetInterface *interface, const Ipv6Addr *ipAddr);
 
 void ndpUpdateNeighborCache(NetInterface *interface);
 void ndpFlushNeighborCache(NetInterface *interface);
 
+void ndpConfirmReachability(NetInterface *interface, const Ipv6Addr *destAddr);
+
 uint_t ndpSendQueuedPackets(NetInterface *interface, NdpNeighborCacheEntry *entry);
 void ndpFlushQueuedPackets(NetInterface *interface, NdpNeighborCacheEntry *entry);
 
-NdpDestCacheEntry *ndpCreateDestCacheEntry(NetInterface *interface);
+NdpDestCacheEntry *ndpCreateDestCacheEntry(NetInterface *interface,
+   const Ipv6Addr *destAddr);
+
 NdpDestCacheEntry *ndpFindDestCacheEntry(NetInterface *interface, const Ipv6Addr *destAddr);
 void ndpFlushDestCache(NetInterface *interface);
 
+uint_t ndpHashAddr(const Ipv6Addr *ipAddr);
+
 //C++ guard
 #ifdef __cplusplus
 }
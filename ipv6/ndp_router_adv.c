@@ -489,13 +489,12 @@ void ndpProcessRouterSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader
       if(!entry)
       {
          //Create an entry
-         entry = ndpCreateNeighborCacheEntry(interface);
+         entry = ndpCreateNeighborCacheEntry(interface, &pseudoHeader->srcAddr);
 
          //Neighbor Cache entry successfully created?
          if(entry)
          {
-            //Record the IPv6 and the corresponding MAC address
-            entry->ipAddr = pseudoHeader->srcAddr;
+            //Record the corresponding MAC address
             entry->macAddr = option->linkLayerAddr;
             //The IsRouter flag must be set to FALSE
             entry->isRouter = FALSE;
@@ -36,6 +36,7 @@
 #include "modbus/modbus_client_pdu.h"
 #include "modbus/modbus_client_transport.h"
 #include "modbus/modbus_client_misc.h"
+#include "modbus/modbus_client_async.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -223,6 +224,10 @@ error_t modbusClientConnect(ModbusClientContext *context,
          //Check status code
          if(error == NO_ERROR)
          {
+            //Flush receive buffer
+            context->responseAduLen = 0;
+            context->responseAduPos = 0;
+
             //Update Modbus/TCP client state
             context->state = MODBUS_CLIENT_STATE_CONNECTED;
          }
@@ -978,6 +983,10 @@ error_t modbusClientDisconnect(ModbusClientContext *context)
       //Check current state
       if(context->state == MODBUS_CLIENT_STATE_CONNECTED)
       {
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+         //Outstanding transactions are aborted
+         modbusClientAbortTransactions(context, ERROR_CONNECTION_CLOSING);
+#endif
          //Save current time
          context->timestamp = osGetSystemTime();
          //Update Modbus/TCP client state
@@ -1049,6 +1058,11 @@ error_t modbusClientClose(ModbusClientContext *context)
    //Update Modbus/TCP client state
    context->state = MODBUS_CLIENT_STATE_DISCONNECTED;
 
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+   //Outstanding transactions are aborted
+   modbusClientAbortTransactions(context, ERROR_NOT_CONNECTED);
+#endif
+
    //Successful processing
    return NO_ERROR;
 }
@@ -56,6 +56,20 @@
    #error MODBUS_CLIENT_DEFAULT_TIMEOUT parameter is not valid
 #endif
 
+//Asynchronous transactions
+#ifndef MODBUS_CLIENT_ASYNC_SUPPORT
+   #define MODBUS_CLIENT_ASYNC_SUPPORT ENABLED
+#elif (MODBUS_CLIENT_ASYNC_SUPPORT != ENABLED && MODBUS_CLIENT_ASYNC_SUPPORT != DISABLED)
+   #error MODBUS_CLIENT_ASYNC_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of outstanding asynchronous transactions
+#ifndef MODBUS_CLIENT_MAX_TRANSACTIONS
+   #define MODBUS_CLIENT_MAX_TRANSACTIONS 4
+#elif (MODBUS_CLIENT_MAX_TRANSACTIONS < 1)
+   #error MODBUS_CLIENT_MAX_TRANSACTIONS parameter is not valid
+#endif
+
 //TX buffer size for TLS connections
 #ifndef MODBUS_CLIENT_TLS_TX_BUFFER_SIZE
    #define MODBUS_CLIENT_TLS_TX_BUFFER_SIZE 2048
@@ -115,6 +129,50 @@ typedef error_t (*ModbusClientTlsInitCallback)(ModbusClientContext *context,
 #endif
 
 
+//Asynchronous transactions supported?
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+
+/**
+ * @brief Asynchronous transaction states
+ */
+
+typedef enum
+{
+   MODBUS_TRANSACTION_STATE_FREE    = 0,
+   MODBUS_TRANSACTION_STATE_SENDING = 1,
+   MODBUS_TRANSACTION_STATE_WAITING = 2
+} ModbusTransactionState;
+
+
+/**
+ * @brief Transaction completion callback function
+ **/
+
+typedef void (*ModbusClientCallback)(ModbusClientContext *context,
+   error_t error, void *param);
+
+
+/**
+ * @brief Asynchronous transaction
+ **/
+
+typedef struct
+{
+   ModbusTransactionState state;            ///<Transaction state
+   uint16_t transactionId;                  ///<Modbus transaction identifier
+   systime_t timeout;                       ///<Timeout value
+   systime_t timestamp;                     ///<Timestamp to manage timeout
+   void *value;                             ///<Buffer that receives the data read from the server
+   ModbusClientCallback callback;           ///<Completion callback function
+   void *param;                             ///<Opaque pointer passed to the callback function
+   uint8_t requestAdu[MODBUS_MAX_ADU_SIZE]; ///<Request ADU
+   size_t requestAduLen;                    ///<Length of the request ADU, in bytes
+   size_t requestAduPos;                    ///<Current position in the request ADU
+} ModbusClientTransaction;
+
+#endif
+
+
 /**
  * @brief Modbus/TCP client context
  **/
@@ -140,6 +198,9 @@ struct _ModbusClientContext
    size_t responseAduLen;                       ///<Length of the response ADU, in bytes
    size_t responseAduPos;                       ///<Current position in the response ADU
    ModbusExceptionCode exceptionCode;           ///<Exception code
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+   ModbusClientTransaction transactions[MODBUS_CLIENT_MAX_TRANSACTIONS]; ///<Asynchronous transactions
+#endif
 };
 
 
@@ -193,6 +254,54 @@ error_t modbusClientReadWriteMultipleRegs(ModbusClientContext *context,
    uint16_t readAddress, uint_t readQuantity, uint16_t *readValue,
    uint16_t writeAddress, uint_t writeQuantity, const uint16_t *writeValue);
 
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+
+error_t modbusClientReadCoilsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint8_t *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientReadDiscreteInputsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint8_t *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientReadHoldingRegsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint16_t *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientReadInputRegsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint16_t *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientWriteSingleCoilAsync(ModbusClientContext *context,
+   uint16_t address, bool_t value, ModbusClientCallback callback,
+   void *param);
+
+error_t modbusClientWriteSingleRegAsync(ModbusClientContext *context,
+   uint16_t address, uint16_t value, ModbusClientCallback callback,
+   void *param);
+
+error_t modbusClientWriteMultipleCoilsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, const uint8_t *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientWriteMultipleRegsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, const uint16_t *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientMaskWriteRegAsync(ModbusClientContext *context,
+   uint16_t address, uint16_t andMask, uint16_t orMask,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientReadWriteMultipleRegsAsync(ModbusClientContext *context,
+   uint16_t readAddress, uint_t readQuantity, uint16_t *readValue,
+   uint16_t writeAddress, uint_t writeQuantity, const uint16_t *writeValue,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientProcessEvents(ModbusClientContext *context,
+   systime_t timeout);
+
+#endif
+
 error_t modbusClientGetExceptionCode(ModbusClientContext *context,
    ModbusExceptionCode *exceptionCode);
 
@@ -0,0 +1,1261 @@
+/**
+ * @file modbus_client_async.c
+ * @brief Asynchronous Modbus/TCP client transactions
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Modbus/TCP allows a client to initiate several transactions without
+ * waiting for the completion of the previous ones. Requests are queued
+ * along with a completion callback and transmitted back to back on the
+ * same TCP connection. Responses are then matched to the outstanding
+ * requests using the transaction identifier of the MBAP header. A typical
+ * usage is:
+ *
+ * error = modbusClientReadHoldingRegsAsync(&context, 0, 10, regs,
+ *    readCallback, NULL);
+ *
+ * while(!error)
+ * {
+ *    error = modbusClientProcessEvents(&context, 100);
+ * }
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL MODBUS_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "modbus/modbus_client.h"
+#include "modbus/modbus_client_async.h"
+#include "modbus/modbus_client_pdu.h"
+#include "modbus/modbus_client_transport.h"
+#include "modbus/modbus_client_misc.h"
+#include "modbus/modbus_debug.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (MODBUS_CLIENT_SUPPORT == ENABLED && MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Read coils (asynchronous)
+ *
+ * The request is queued and the function returns immediately. The callback
+ * function is invoked from modbusClientProcessEvents once the matching
+ * response has been received or the timeout has elapsed. The output buffer
+ * must remain valid until then
+ *
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Address of the first coil
+ * @param[in] quantity Number of coils
+ * @param[out] value Value of the discrete outputs
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientReadCoilsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint8_t *value,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || value == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of coils must be in range 1 to 2000
+   if(quantity < 1 || quantity > 2000)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatReadCoilsReq(context, address,
+         quantity);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, value, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read discrete inputs (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Address of the first input
+ * @param[in] quantity Number of inputs
+ * @param[out] value Value of the discrete inputs
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientReadDiscreteInputsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint8_t *value,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || value == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of discrete inputs must be in range 1 to 2000
+   if(quantity < 1 || quantity > 2000)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatReadDiscreteInputsReq(context, address,
+         quantity);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, value, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read holding registers (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Starting register address
+ * @param[in] quantity Number of registers
+ * @param[out] value Value of the holding registers
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientReadHoldingRegsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint16_t *value,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || value == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of registers must be in range 1 to 125
+   if(quantity < 1 || quantity > 125)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatReadHoldingRegsReq(context, address,
+         quantity);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, value, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read input registers (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Starting register address
+ * @param[in] quantity Number of registers
+ * @param[out] value Value of the input registers
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientReadInputRegsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, uint16_t *value,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || value == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of registers must be in range 1 to 125
+   if(quantity < 1 || quantity > 125)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatReadInputRegsReq(context, address,
+         quantity);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, value, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Write single coil (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Address of the coil to be forced
+ * @param[in] value Value of the discrete output
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientWriteSingleCoilAsync(ModbusClientContext *context,
+   uint16_t address, bool_t value, ModbusClientCallback callback,
+   void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatWriteSingleCoilReq(context, address,
+         value);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, NULL, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Write single register (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Address of the register to be written
+ * @param[in] value Register value
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientWriteSingleRegAsync(ModbusClientContext *context,
+   uint16_t address, uint16_t value, ModbusClientCallback callback,
+   void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatWriteSingleRegReq(context, address,
+         value);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, NULL, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Write multiple coils (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Address of the first coil to be forced
+ * @param[in] quantity Number of coils
+ * @param[in] value Value of the discrete outputs
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientWriteMultipleCoilsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, const uint8_t *value,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || value == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of coils must be in range 1 to 1968
+   if(quantity < 1 || quantity > 1968)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatWriteMultipleCoilsReq(context, address,
+         quantity, value);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, NULL, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Write multiple registers (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Starting register address
+ * @param[in] quantity Number of registers
+ * @param[in] value Value of the holding registers
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientWriteMultipleRegsAsync(ModbusClientContext *context,
+   uint16_t address, uint_t quantity, const uint16_t *value,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || value == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of registers must be in range 1 to 123
+   if(quantity < 1 || quantity > 123)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatWriteMultipleRegsReq(context, address,
+         quantity, value);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, NULL, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Apply AND/OR bitmask to a register (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] address Address of the holding register
+ * @param[in] andMask AND bitmask
+ * @param[in] orMask OR bitmask
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientMaskWriteRegAsync(ModbusClientContext *context,
+   uint16_t address, uint16_t andMask, uint16_t orMask,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatMaskWriteRegReq(context, address,
+         andMask, orMask);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, NULL, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read/write multiple registers (asynchronous)
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] readAddress Address of the first holding registers to be read
+ * @param[in] readQuantity Number of holding registers to be read
+ * @param[out] readValue Value of the holding registers (read operation)
+ * @param[in] writeAddress Address of the first holding registers to be written
+ * @param[in] writeQuantity Number of holding registers to be written
+ * @param[in] writeValue Value of the holding registers (write operation)
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t modbusClientReadWriteMultipleRegsAsync(ModbusClientContext *context,
+   uint16_t readAddress, uint_t readQuantity, uint16_t *readValue,
+   uint16_t writeAddress, uint_t writeQuantity, const uint16_t *writeValue,
+   ModbusClientCallback callback, void *param)
+{
+   error_t error;
+   ModbusClientTransaction *transaction;
+
+   //Check parameters
+   if(context == NULL || readValue == NULL || writeValue == NULL ||
+      callback == NULL)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //The number of registers to be read must be in range 1 to 125
+   if(readQuantity < 1 || readQuantity > 125)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of registers to be written must be in range 1 to 121
+   if(writeQuantity < 1 || writeQuantity > 121)
+      return ERROR_INVALID_PARAMETER;
+
+   //Allocate a new transaction
+   error = modbusClientReserveTransaction(context, &transaction);
+
+   //Check status code
+   if(!error)
+   {
+      //Format request
+      error = modbusClientFormatReadWriteMultipleRegsReq(context,
+         readAddress, readQuantity, writeAddress, writeQuantity, writeValue);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Queue the request for transmission
+      modbusClientQueueTransaction(context, transaction, readValue, callback,
+         param);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process asynchronous transactions
+ *
+ * This function transmits the queued requests, dispatches the responses
+ * received from the server to the relevant completion callbacks and
+ * reports a timeout error for the transactions that did not complete in
+ * time. It must be called periodically as long as transactions are pending
+ *
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] timeout Maximum time to wait for a response, in milliseconds
+ * @return Error code
+ **/
+
+error_t modbusClientProcessEvents(ModbusClientContext *context,
+   systime_t timeout)
+{
+   error_t error;
+
+   //Make sure the Modbus/TCP client context is valid
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Asynchronous transactions can only be processed while no synchronous
+   //transaction is in progress
+   if(context->state != MODBUS_CLIENT_STATE_CONNECTED)
+      return ERROR_NOT_CONNECTED;
+
+   //Transmit the queued requests
+   error = modbusClientSendRequests(context);
+
+   //Check status code
+   if(!error)
+   {
+      //Any outstanding transaction?
+      if(modbusClientGetPendingTransactions(context) > 0)
+      {
+         //Do not wait beyond the expiration of the earliest transaction
+         socketSetTimeout(context->socket,
+            modbusClientGetWaitTime(context, timeout));
+
+         //Process as many responses as are available
+         while(!error)
+         {
+            //Receive response
+            error = modbusClientReceiveResponse(context);
+
+            //Once some data has been received, the remaining responses are
+            //read without blocking
+            socketSetTimeout(context->socket, 0);
+         }
+
+         //No more data to process?
+         if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+         {
+            //Catch exception
+            error = NO_ERROR;
+         }
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Complete the transactions whose timeout has elapsed
+      modbusClientCheckTransactionTimeouts(context);
+   }
+   else
+   {
+      //The connection is no longer usable. Report the error to the user
+      //application for all the outstanding transactions
+      modbusClientAbortTransactions(context, error);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Reserve a transaction slot
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[out] transaction Free transaction slot
+ * @return Error code
+ **/
+
+error_t modbusClientReserveTransaction(ModbusClientContext *context,
+   ModbusClientTransaction **transaction)
+{
+   uint_t i;
+
+   //A synchronous transaction is in progress?
+   if(context->state == MODBUS_CLIENT_STATE_SENDING ||
+      context->state == MODBUS_CLIENT_STATE_RECEIVING ||
+      context->state == MODBUS_CLIENT_STATE_COMPLETE)
+   {
+      return ERROR_WRONG_STATE;
+   }
+
+   //Make sure the Modbus/TCP client is connected
+   if(context->state != MODBUS_CLIENT_STATE_CONNECTED)
+      return ERROR_NOT_CONNECTED;
+
+   //Loop through the transaction table
+   for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      //Check whether the current entry is free
+      if(context->transactions[i].state == MODBUS_TRANSACTION_STATE_FREE)
+      {
+         //Return a pointer to the free entry
+         *transaction = &context->transactions[i];
+         //Successful processing
+         return NO_ERROR;
+      }
+   }
+
+   //The maximum number of outstanding transactions has been reached
+   return ERROR_OUT_OF_RESOURCES;
+}
+
+
+/**
+ * @brief Queue the request that has just been formatted
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] transaction Transaction slot
+ * @param[in] value Buffer that receives the data read from the server
+ * @param[in] callback Completion callback function
+ * @param[in] param Opaque pointer passed to the callback function
+ **/
+
+void modbusClientQueueTransaction(ModbusClientContext *context,
+   ModbusClientTransaction *transaction, void *value,
+   ModbusClientCallback callback, void *param)
+{
+   ModbusHeader *header;
+
+   //Point to the MBAP header of the request ADU
+   header = (ModbusHeader *) context->requestAdu;
+
+   //Save the request ADU. The unit identifier is captured at this point, so
+   //that a single connection can be used to poll several slaves
+   memcpy(transaction->requestAdu, context->requestAdu,
+      context->requestAduLen);
+
+   transaction->requestAduLen = context->requestAduLen;
+   transaction->requestAduPos = 0;
+
+   //Each transaction has its own timeout
+   transaction->transactionId = ntohs(header->transactionId);
+   transaction->timeout = context->timeout;
+   transaction->timestamp = context->timestamp;
+
+   //Save completion callback
+   transaction->value = value;
+   transaction->callback = callback;
+   transaction->param = param;
+
+   //The request ADU is transmitted by modbusClientProcessEvents
+   transaction->state = MODBUS_TRANSACTION_STATE_SENDING;
+
+   //The client is still available for further requests
+   context->state = MODBUS_CLIENT_STATE_CONNECTED;
+}
+
+
+/**
+ * @brief Transmit queued requests
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @return Error code
+ **/
+
+error_t modbusClientSendRequests(ModbusClientContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint_t flags;
+   size_t written;
+   ModbusClientTransaction *transaction;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Do not block when the transmit buffer is full
+   socketSetTimeout(context->socket, 0);
+
+   //Transmit the queued requests
+   while(!error)
+   {
+      //Number of requests waiting for transmission
+      n = 0;
+      //Request to be transmitted first
+      transaction = NULL;
+
+      //Requests are transmitted in the order in which they were queued, so
+      //a partially transmitted request is always completed first
+      for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+      {
+         //Request waiting for transmission?
+         if(context->transactions[i].state == MODBUS_TRANSACTION_STATE_SENDING)
+         {
+            //Select the oldest request
+            if(transaction == NULL)
+            {
+               transaction = &context->transactions[i];
+            }
+            else if((int16_t) (context->transactions[i].transactionId -
+               transaction->transactionId) < 0)
+            {
+               transaction = &context->transactions[i];
+            }
+
+            //Increment the number of requests
+            n++;
+         }
+      }
+
+      //No more requests to send?
+      if(transaction == NULL)
+         break;
+
+      //Consecutive requests are coalesced into as few TCP segments as
+      //possible. The last one is pushed immediately
+      flags = (n > 1) ? SOCKET_FLAG_DELAY : SOCKET_FLAG_NO_DELAY;
+
+      //Send more data
+      error = modbusClientSendData(context,
+         transaction->requestAdu + transaction->requestAduPos,
+         transaction->requestAduLen - transaction->requestAduPos,
+         &written, flags);
+
+      //Check status code
+      if(error == NO_ERROR || error == ERROR_TIMEOUT)
+      {
+         //Advance data pointer
+         transaction->requestAduPos += written;
+      }
+
+      //Request ADU successfully transmitted?
+      if(transaction->requestAduPos >= transaction->requestAduLen)
+      {
+         //Wait for the matching response
+         transaction->state = MODBUS_TRANSACTION_STATE_WAITING;
+      }
+   }
+
+   //The transmit buffer is full?
+   if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+   {
+      //The remaining requests will be sent later
+      error = NO_ERROR;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Receive response
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @return Error code
+ **/
+
+error_t modbusClientReceiveResponse(ModbusClientContext *context)
+{
+   error_t error;
+   size_t n;
+
+   //The receive buffer may still hold the response to the last synchronous
+   //transaction
+   if(context->responseAduPos >= sizeof(ModbusHeader) &&
+      context->responseAduPos >= context->responseAduLen)
+   {
+      //Flush receive buffer
+      context->responseAduLen = 0;
+      context->responseAduPos = 0;
+   }
+
+   //Receive Modbus response
+   if(context->responseAduPos < sizeof(ModbusHeader))
+   {
+      //Receive more data
+      error = modbusClientReceiveData(context,
+         context->responseAdu + context->responseAduPos,
+         sizeof(ModbusHeader) - context->responseAduPos, &n, 0);
+
+      //Check status code
+      if(error == NO_ERROR)
+      {
+         //Advance data pointer
+         context->responseAduPos += n;
+
+         //MBAP header successfully received?
+         if(context->responseAduPos >= sizeof(ModbusHeader))
+         {
+            //Parse MBAP header
+            error = modbusClientParseMbapHeader(context);
+         }
+      }
+   }
+   else
+   {
+      //Receive more data
+      error = modbusClientReceiveData(context,
+         context->responseAdu + context->responseAduPos,
+         context->responseAduLen - context->responseAduPos, &n, 0);
+
+      //Check status code
+      if(error == NO_ERROR)
+      {
+         //Advance data pointer
+         context->responseAduPos += n;
+      }
+   }
+
+   //Check status code
+   if(error == NO_ERROR)
+   {
+      //Complete response ADU received?
+      if(context->responseAduPos >= sizeof(ModbusHeader) &&
+         context->responseAduPos >= context->responseAduLen)
+      {
+         //Dispatch the response to the matching transaction
+         modbusClientProcessResponse(context);
+
+         //Flush receive buffer
+         context->responseAduLen = 0;
+         context->responseAduPos = 0;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Dispatch a response to the matching transaction
+ * @param[in] context Pointer to the Modbus/TCP client context
+ **/
+
+void modbusClientProcessResponse(ModbusClientContext *context)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   uint16_t transactionId;
+   uint8_t *pdu;
+   ModbusHeader *header;
+   ModbusClientTransaction *transaction;
+
+   //Point to the MBAP header of the response ADU
+   header = (ModbusHeader *) context->responseAdu;
+   //Point to the Modbus response PDU
+   pdu = modbusClientGetResponsePdu(context, &n);
+
+   //Debug message
+   TRACE_INFO("Modbus Client: Response PDU received (%" PRIuSIZE " bytes)...\r\n", n);
+   //Dump the contents of the PDU for debugging purpose
+   modbusDumpResponsePdu(pdu, n);
+
+   //Retrieve transaction identifier
+   transactionId = ntohs(header->transactionId);
+
+   //Loop through the transaction table
+   for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      //Point to the current entry
+      transaction = &context->transactions[i];
+
+      //Matching transaction?
+      if(transaction->state == MODBUS_TRANSACTION_STATE_WAITING &&
+         transaction->transactionId == transactionId)
+      {
+         //Parse response
+         error = modbusClientParseTransactionResp(context, transaction);
+         //Send a confirmation to the user application
+         modbusClientCompleteTransaction(context, transaction, error);
+
+         //We are done
+         return;
+      }
+   }
+
+   //If the transaction identifier does not refer to any pending transaction,
+   //the response must be discarded
+   TRACE_INFO("Modbus Client: Discarding response (transaction ID %" PRIu16 ")...\r\n",
+      transactionId);
+}
+
+
+/**
+ * @brief Parse the response to an asynchronous transaction
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] transaction Matching transaction
+ * @return Error code
+ **/
+
+error_t modbusClientParseTransactionResp(ModbusClientContext *context,
+   ModbusClientTransaction *transaction)
+{
+   error_t error;
+   void *request;
+   ModbusHeader *requestHeader;
+   ModbusHeader *responseHeader;
+
+   //Malformed response?
+   if(context->responseAduLen < (sizeof(ModbusHeader) + sizeof(uint8_t)))
+      return ERROR_INVALID_LENGTH;
+
+   //Point to the MBAP header of the Modbus request
+   requestHeader = (ModbusHeader *) transaction->requestAdu;
+   //Point to the MBAP header of the Modbus response
+   responseHeader = (ModbusHeader *) context->responseAdu;
+
+   //Check unit identifier
+   if(responseHeader->unitId != requestHeader->unitId)
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Check function code
+   if((responseHeader->pdu[0] & MODBUS_FUNCTION_CODE_MASK) !=
+      (requestHeader->pdu[0] & MODBUS_FUNCTION_CODE_MASK))
+   {
+      return ERROR_UNEXPECTED_RESPONSE;
+   }
+
+   //Exception response?
+   if(responseHeader->pdu[0] & MODBUS_EXCEPTION_MASK)
+   {
+      //The exception code can be retrieved from the completion callback by
+      //calling modbusClientGetExceptionCode
+      return modbusClientParseExceptionResp(context);
+   }
+
+   //Point to the Modbus request PDU
+   request = requestHeader->pdu;
+
+   //The parameters that are needed to check the response are retrieved from
+   //the request PDU
+   switch(requestHeader->pdu[0])
+   {
+   //Read Coils request?
+   case MODBUS_FUNCTION_READ_COILS:
+      //Parse response
+      error = modbusClientParseReadCoilsResp(context,
+         ntohs(((ModbusReadCoilsReq *) request)->quantityOfCoils),
+         transaction->value);
+      break;
+   //Read Discrete Inputs request?
+   case MODBUS_FUNCTION_READ_DISCRETE_INPUTS:
+      //Parse response
+      error = modbusClientParseReadDiscreteInputsResp(context,
+         ntohs(((ModbusReadDiscreteInputsReq *) request)->quantityOfInputs),
+         transaction->value);
+      break;
+   //Read Holding Registers request?
+   case MODBUS_FUNCTION_READ_HOLDING_REGS:
+      //Parse response
+      error = modbusClientParseReadHoldingRegsResp(context,
+         ntohs(((ModbusReadHoldingRegsReq *) request)->quantityOfRegs),
+         transaction->value);
+      break;
+   //Read Input Registers request?
+   case MODBUS_FUNCTION_READ_INPUT_REGS:
+      //Parse response
+      error = modbusClientParseReadInputRegsResp(context,
+         ntohs(((ModbusReadInputRegsReq *) request)->quantityOfRegs),
+         transaction->value);
+      break;
+   //Write Single Coil request?
+   case MODBUS_FUNCTION_WRITE_SINGLE_COIL:
+      //Parse response
+      error = modbusClientParseWriteSingleCoilResp(context,
+         ntohs(((ModbusWriteSingleCoilReq *) request)->outputAddr),
+         ntohs(((ModbusWriteSingleCoilReq *) request)->outputValue) ==
+         MODBUS_COIL_STATE_ON);
+      break;
+   //Write Single Register request?
+   case MODBUS_FUNCTION_WRITE_SINGLE_REG:
+      //Parse response
+      error = modbusClientParseWriteSingleRegResp(context,
+         ntohs(((ModbusWriteSingleRegReq *) request)->regAddr),
+         ntohs(((ModbusWriteSingleRegReq *) request)->regValue));
+      break;
+   //Write Multiple Coils request?
+   case MODBUS_FUNCTION_WRITE_MULTIPLE_COILS:
+      //Parse response
+      error = modbusClientParseWriteMultipleCoilsResp(context,
+         ntohs(((ModbusWriteMultipleCoilsReq *) request)->startingAddr),
+         ntohs(((ModbusWriteMultipleCoilsReq *) request)->quantityOfOutputs));
+      break;
+   //Write Multiple Registers request?
+   case MODBUS_FUNCTION_WRITE_MULTIPLE_REGS:
+      //Parse response
+      error = modbusClientParseWriteMultipleRegsResp(context,
+         ntohs(((ModbusWriteMultipleRegsReq *) request)->startingAddr),
+         ntohs(((ModbusWriteMultipleRegsReq *) request)->quantityOfRegs));
+      break;
+   //Mask Write Register request?
+   case MODBUS_FUNCTION_MASK_WRITE_REG:
+      //Parse response
+      error = modbusClientParseMaskWriteRegResp(context,
+         ntohs(((ModbusMaskWriteRegReq *) request)->referenceAddr),
+         ntohs(((ModbusMaskWriteRegReq *) request)->andMask),
+         ntohs(((ModbusMaskWriteRegReq *) request)->orMask));
+      break;
+   //Read/Write Multiple Registers request?
+   case MODBUS_FUNCTION_READ_WRITE_MULTIPLE_REGS:
+      //Parse response
+      error = modbusClientParseReadWriteMultipleRegsResp(context,
+         ntohs(((ModbusReadWriteMultipleRegsReq *) request)->quantityToRead),
+         transaction->value);
+      break;
+   //Unknown function code?
+   default:
+      //Report an error
+      error = ERROR_INVALID_RESPONSE;
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Complete the transactions whose timeout has elapsed
+ * @param[in] context Pointer to the Modbus/TCP client context
+ **/
+
+void modbusClientCheckTransactionTimeouts(ModbusClientContext *context)
+{
+   uint_t i;
+   systime_t time;
+   ModbusClientTransaction *transaction;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the transaction table
+   for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      //Point to the current entry
+      transaction = &context->transactions[i];
+
+      //A partially transmitted request cannot be withdrawn without
+      //corrupting the byte stream
+      if(transaction->state == MODBUS_TRANSACTION_STATE_WAITING ||
+         (transaction->state == MODBUS_TRANSACTION_STATE_SENDING &&
+         transaction->requestAduPos == 0))
+      {
+         //Check whether the timeout has elapsed
+         if(timeCompare(time, transaction->timestamp + transaction->timeout) >= 0)
+         {
+            //A late response will be silently discarded
+            modbusClientCompleteTransaction(context, transaction,
+               ERROR_TIMEOUT);
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Release a transaction and invoke its completion callback
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] transaction Transaction to be completed
+ * @param[in] error Status code reported to the user application
+ **/
+
+void modbusClientCompleteTransaction(ModbusClientContext *context,
+   ModbusClientTransaction *transaction, error_t error)
+{
+   ModbusClientCallback callback;
+   void *param;
+
+   //Save completion callback
+   callback = transaction->callback;
+   param = transaction->param;
+
+   //Release the entry before invoking the callback, so that the latter can
+   //initiate a new transaction
+   transaction->state = MODBUS_TRANSACTION_STATE_FREE;
+
+   //Send a confirmation to the user application
+   callback(context, error, param);
+}
+
+
+/**
+ * @brief Abort all the outstanding transactions
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] error Status code reported to the user application
+ **/
+
+void modbusClientAbortTransactions(ModbusClientContext *context,
+   error_t error)
+{
+   uint_t i;
+   bool_t aborted[MODBUS_CLIENT_MAX_TRANSACTIONS];
+
+   //Flush receive buffer
+   context->responseAduLen = 0;
+   context->responseAduPos = 0;
+
+   //Take a snapshot of the outstanding transactions first, since completion
+   //callbacks may initiate new transactions that must not be aborted
+   for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      aborted[i] = (context->transactions[i].state !=
+         MODBUS_TRANSACTION_STATE_FREE) ? TRUE : FALSE;
+   }
+
+   //Loop through the transaction table
+   for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      //Outstanding transaction?
+      if(aborted[i])
+      {
+         //Report the error to the user application
+         modbusClientCompleteTransaction(context, &context->transactions[i],
+            error);
+      }
+   }
+}
+
+
+/**
+ * @brief Get the number of outstanding transactions
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @return Number of outstanding transactions
+ **/
+
+uint_t modbusClientGetPendingTransactions(ModbusClientContext *context)
+{
+   uint_t i;
+   uint_t n;
+
+   //Loop through the transaction table
+   for(n = 0, i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      //Outstanding transaction?
+      if(context->transactions[i].state != MODBUS_TRANSACTION_STATE_FREE)
+         n++;
+   }
+
+   //Return the number of outstanding transactions
+   return n;
+}
+
+
+/**
+ * @brief Compute the maximum time to wait for a response
+ * @param[in] context Pointer to the Modbus/TCP client context
+ * @param[in] timeout Maximum time requested by the user application
+ * @return Time to wait, in milliseconds
+ **/
+
+systime_t modbusClientGetWaitTime(ModbusClientContext *context,
+   systime_t timeout)
+{
+   uint_t i;
+   systime_t time;
+   systime_t deadline;
+   ModbusClientTransaction *transaction;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the transaction table
+   for(i = 0; i < MODBUS_CLIENT_MAX_TRANSACTIONS; i++)
+   {
+      //Point to the current entry
+      transaction = &context->transactions[i];
+
+      //Outstanding transaction?
+      if(transaction->state != MODBUS_TRANSACTION_STATE_FREE)
+      {
+         //Compute the time at which the transaction expires
+         deadline = transaction->timestamp + transaction->timeout;
+
+         //Do not wait beyond the expiration of the transaction
+         if(timeCompare(deadline, time) > 0)
+            timeout = MIN(timeout, deadline - time);
+         else
+            timeout = 0;
+      }
+   }
+
+   //Return the time to wait
+   return timeout;
+}
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file modbus_client_async.h
+ * @brief Asynchronous Modbus/TCP client transactions
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _MODBUS_CLIENT_ASYNC_H
+#define _MODBUS_CLIENT_ASYNC_H
+
+//Dependencies
+#include "core/net.h"
+#include "modbus/modbus_client.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Asynchronous transactions supported?
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+
+//Modbus/TCP client related functions
+error_t modbusClientReserveTransaction(ModbusClientContext *context,
+   ModbusClientTransaction **transaction);
+
+void modbusClientQueueTransaction(ModbusClientContext *context,
+   ModbusClientTransaction *transaction, void *value,
+   ModbusClientCallback callback, void *param);
+
+error_t modbusClientSendRequests(ModbusClientContext *context);
+error_t modbusClientReceiveResponse(ModbusClientContext *context);
+void modbusClientProcessResponse(ModbusClientContext *context);
+
+error_t modbusClientParseTransactionResp(ModbusClientContext *context,
+   ModbusClientTransaction *transaction);
+
+void modbusClientCheckTransactionTimeouts(ModbusClientContext *context);
+
+void modbusClientCompleteTransaction(ModbusClientContext *context,
+   ModbusClientTransaction *transaction, error_t error);
+
+void modbusClientAbortTransactions(ModbusClientContext *context,
+   error_t error);
+
+uint_t modbusClientGetPendingTransactions(ModbusClientContext *context);
+systime_t modbusClientGetWaitTime(ModbusClientContext *context,
+   systime_t timeout);
+
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
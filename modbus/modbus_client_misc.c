@@ -36,6 +36,7 @@
 #include "modbus/modbus_client_pdu.h"
 #include "modbus/modbus_client_transport.h"
 #include "modbus/modbus_client_misc.h"
+#include "modbus/modbus_client_async.h"
 #include "modbus/modbus_debug.h"
 #include "debug.h"
 
@@ -73,6 +74,16 @@ error_t modbusClientTransaction(ModbusClientContext *context)
       socketSetTimeout(context->socket, 0);
    }
 
+#if (MODBUS_CLIENT_ASYNC_SUPPORT == ENABLED)
+   //Synchronous requests cannot be interleaved with the outstanding
+   //asynchronous transactions
+   if(modbusClientGetPendingTransactions(context) > 0)
+   {
+      //Report an error
+      error = ERROR_WRONG_STATE;
+   }
+   else
+#endif
    //Check current state
    if(context->state == MODBUS_CLIENT_STATE_SENDING)
    {
@@ -79,6 +79,20 @@ void modbusServerGetDefaultSettings(ModbusServerSettings *settings)
    settings->readInputRegCallback = NULL;
    //Set register value callback function
    settings->writeRegCallback = NULL;
+   //Get the state of a block of coils callback function
+   settings->readCoilsCallback = NULL;
+   //Get the state of a block of discrete inputs callback function
+   settings->readDiscreteInputsCallback = NULL;
+   //Set the state of a block of coils callback function
+   settings->writeCoilsCallback = NULL;
+   //Get the value of a block of registers callback function
+   settings->readRegsCallback = NULL;
+   //Get the value of a block of holding registers callback function
+   settings->readHoldingRegsCallback = NULL;
+   //Get the value of a block of input registers callback function
+   settings->readInputRegsCallback = NULL;
+   //Set the value of a block of registers callback function
+   settings->writeRegsCallback = NULL;
    //PDU processing callback
    settings->processPduCallback = NULL;
 }
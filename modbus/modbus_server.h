@@ -199,6 +199,40 @@ typedef error_t (*ModbusServerWriteRegCallback)(const char_t *role,
    uint16_t address, uint16_t value, bool_t commit);
 
 
+/**
+ * @brief Get the state of a block of coils callback function
+ **/
+
+typedef error_t (*ModbusServerReadCoilsCallback)(const char_t *role,
+   uint16_t address, uint16_t quantity, uint8_t *states);
+
+
+/**
+ * @brief Set the state of a block of coils callback function
+ **/
+
+typedef error_t (*ModbusServerWriteCoilsCallback)(const char_t *role,
+   uint16_t address, uint16_t quantity, const uint8_t *states,
+   bool_t commit);
+
+
+/**
+ * @brief Get the value of a block of registers callback function
+ **/
+
+typedef error_t (*ModbusServerReadRegsCallback)(const char_t *role,
+   uint16_t address, uint16_t quantity, uint8_t *values);
+
+
+/**
+ * @brief Set the value of a block of registers callback function
+ **/
+
+typedef error_t (*ModbusServerWriteRegsCallback)(const char_t *role,
+   uint16_t address, uint16_t quantity, const uint8_t *values,
+   bool_t commit);
+
+
 /**
  * @brief PDU processing callback function
  **/
@@ -213,22 +247,29 @@ typedef error_t (*ModbusServerProcessPduCallback)(const uint8_t *request,
 
 typedef struct
 {
-   NetInterface *interface;                                ///<Underlying network interface
-   uint16_t port;                                          ///<Modbus/TCP port number
-   uint8_t unitId;                                         ///<Unit identifier
+   NetInterface *interface;                                  ///<Underlying network interface
+   uint16_t port;                                            ///<Modbus/TCP port number
+   uint8_t unitId;                                           ///<Unit identifier
 #if (MODBUS_SERVER_TLS_SUPPORT == ENABLED)
-   ModbusServerTlsInitCallback tlsInitCallback;            ///<TLS initialization callback function
+   ModbusServerTlsInitCallback tlsInitCallback;              ///<TLS initialization callback function
 #endif
-   ModbusServerLockCallback lockCallback;                  ///<Lock Modbus table callback function
-   ModbusServerUnlockCallback unlockCallback;              ///<Unlock Modbus table callback function
-   ModbusServerReadCoilCallback readCoilCallback;          ///<Get coil state callback function
-   ModbusServerReadCoilCallback readDiscreteInputCallback; ///<Get discrete input state callback function
-   ModbusServerWriteCoilCallback writeCoilCallback;        ///<Set coil state callback function
-   ModbusServerReadRegCallback readRegCallback;            ///<Get register value callback function
-   ModbusServerReadRegCallback readHoldingRegCallback;     ///<Get holding register value callback function
-   ModbusServerReadRegCallback readInputRegCallback;       ///<Get input register value callback function
-   ModbusServerWriteRegCallback writeRegCallback;          ///<Set register value callback function
-   ModbusServerProcessPduCallback processPduCallback;      ///<PDU processing callback
+   ModbusServerLockCallback lockCallback;                    ///<Lock Modbus table callback function
+   ModbusServerUnlockCallback unlockCallback;                ///<Unlock Modbus table callback function
+   ModbusServerReadCoilCallback readCoilCallback;            ///<Get coil state callback function
+   ModbusServerReadCoilCallback readDiscreteInputCallback;   ///<Get discrete input state callback function
+   ModbusServerWriteCoilCallback writeCoilCallback;          ///<Set coil state callback function
+   ModbusServerReadRegCallback readRegCallback;              ///<Get register value callback function
+   ModbusServerReadRegCallback readHoldingRegCallback;       ///<Get holding register value callback function
+   ModbusServerReadRegCallback readInputRegCallback;         ///<Get input register value callback function
+   ModbusServerWriteRegCallback writeRegCallback;            ///<Set register value callback function
+   ModbusServerReadCoilsCallback readCoilsCallback;          ///<Get the state of a block of coils callback function
+   ModbusServerReadCoilsCallback readDiscreteInputsCallback; ///<Get the state of a block of discrete inputs callback function
+   ModbusServerWriteCoilsCallback writeCoilsCallback;        ///<Set the state of a block of coils callback function
+   ModbusServerReadRegsCallback readRegsCallback;            ///<Get the value of a block of registers callback function
+   ModbusServerReadRegsCallback readHoldingRegsCallback;     ///<Get the value of a block of holding registers callback function
+   ModbusServerReadRegsCallback readInputRegsCallback;       ///<Get the value of a block of input registers callback function
+   ModbusServerWriteRegsCallback writeRegsCallback;          ///<Set the value of a block of registers callback function
+   ModbusServerProcessPduCallback processPduCallback;        ///<PDU processing callback
 } ModbusServerSettings;
 
 
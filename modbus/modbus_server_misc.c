@@ -443,6 +443,7 @@ error_t modbusServerReadCoil(ModbusClientConnection *connection,
    uint16_t address, bool_t *state)
 {
    error_t error;
+   uint8_t buffer;
    ModbusServerContext *context;
 
    //Point to the Modbus/TCP server context
@@ -455,6 +456,14 @@ error_t modbusServerReadCoil(ModbusClientConnection *connection,
       error = context->settings.readCoilCallback(connection->role, address,
          state);
    }
+   else if(context->settings.readCoilsCallback != NULL)
+   {
+      //Read a block made of a single coil
+      error = context->settings.readCoilsCallback(connection->role, address,
+         1, &buffer);
+      //Retrieve the state of the coil
+      *state = buffer & 0x01;
+   }
    else
    {
       //Report an error
@@ -478,6 +487,7 @@ error_t modbusServerReadDiscreteInput(ModbusClientConnection *connection,
    uint16_t address, bool_t *state)
 {
    error_t error;
+   uint8_t buffer;
    ModbusServerContext *context;
 
    //Point to the Modbus/TCP server context
@@ -490,11 +500,19 @@ error_t modbusServerReadDiscreteInput(ModbusClientConnection *connection,
       error = context->settings.readDiscreteInputCallback(connection->role,
          address, state);
    }
-   else if(context->settings.readCoilCallback != NULL)
+   else if(context->settings.readDiscreteInputsCallback != NULL)
    {
-      //Invoke user callback function
-      error = context->settings.readCoilCallback(connection->role, address,
-         state);
+      //Read a block made of a single discrete input
+      error = context->settings.readDiscreteInputsCallback(connection->role,
+         address, 1, &buffer);
+      //Retrieve the state of the discrete input
+      *state = buffer & 0x01;
+   }
+   else if(context->settings.readCoilCallback != NULL ||
+      context->settings.readCoilsCallback != NULL)
+   {
+      //Discrete inputs and coils share the same table
+      error = modbusServerReadCoil(connection, address, state);
    }
    else
    {
@@ -521,6 +539,7 @@ error_t modbusServerWriteCoil(ModbusClientConnection *connection,
    uint16_t address, bool_t state, bool_t commit)
 {
    error_t error;
+   uint8_t buffer;
    ModbusServerContext *context;
 
    //Point to the Modbus/TCP server context
@@ -533,6 +552,15 @@ error_t modbusServerWriteCoil(ModbusClientConnection *connection,
       error = context->settings.writeCoilCallback(connection->role, address,
          state, commit);
    }
+   else if(context->settings.writeCoilsCallback != NULL)
+   {
+      //Write a block made of a single coil
+      buffer = state ? 0x01 : 0x00;
+
+      //Invoke user callback function
+      error = context->settings.writeCoilsCallback(connection->role, address,
+         1, &buffer, commit);
+   }
    else
    {
       //Report an error
@@ -556,6 +584,7 @@ error_t modbusServerReadHoldingReg(ModbusClientConnection *connection,
    uint16_t address, uint16_t *value)
 {
    error_t error;
+   uint8_t buffer[2];
    ModbusServerContext *context;
 
    //Point to the Modbus/TCP server context
@@ -568,12 +597,28 @@ error_t modbusServerReadHoldingReg(ModbusClientConnection *connection,
       error = context->settings.readHoldingRegCallback(connection->role,
          address, value);
    }
+   else if(context->settings.readHoldingRegsCallback != NULL)
+   {
+      //Read a block made of a single register
+      error = context->settings.readHoldingRegsCallback(connection->role,
+         address, 1, buffer);
+      //Register values are stored in network byte order
+      *value = LOAD16BE(buffer);
+   }
    else if(context->settings.readRegCallback != NULL)
    {
       //Invoke user callback function
       error = context->settings.readRegCallback(connection->role, address,
          value);
    }
+   else if(context->settings.readRegsCallback != NULL)
+   {
+      //Read a block made of a single register
+      error = context->settings.readRegsCallback(connection->role, address,
+         1, buffer);
+      //Register values are stored in network byte order
+      *value = LOAD16BE(buffer);
+   }
    else
    {
       //Report an error
@@ -597,6 +642,7 @@ error_t modbusServerReadInputReg(ModbusClientConnection *connection,
    uint16_t address, uint16_t *value)
 {
    error_t error;
+   uint8_t buffer[2];
    ModbusServerContext *context;
 
    //Point to the Modbus/TCP server context
@@ -609,12 +655,28 @@ error_t modbusServerReadInputReg(ModbusClientConnection *connection,
       error = context->settings.readInputRegCallback(connection->role,
          address, value);
    }
+   else if(context->settings.readInputRegsCallback != NULL)
+   {
+      //Read a block made of a single register
+      error = context->settings.readInputRegsCallback(connection->role,
+         address, 1, buffer);
+      //Register values are stored in network byte order
+      *value = LOAD16BE(buffer);
+   }
    else if(context->settings.readRegCallback != NULL)
    {
       //Invoke user callback function
       error = context->settings.readRegCallback(connection->role, address,
          value);
    }
+   else if(context->settings.readRegsCallback != NULL)
+   {
+      //Read a block made of a single register
+      error = context->settings.readRegsCallback(connection->role, address,
+         1, buffer);
+      //Register values are stored in network byte order
+      *value = LOAD16BE(buffer);
+   }
    else
    {
       //Report an error
@@ -640,6 +702,7 @@ error_t modbusServerWriteReg(ModbusClientConnection *connection,
    uint16_t address, uint16_t value, bool_t commit)
 {
    error_t error;
+   uint8_t buffer[2];
    ModbusServerContext *context;
 
    //Point to the Modbus/TCP server context
@@ -652,6 +715,15 @@ error_t modbusServerWriteReg(ModbusClientConnection *connection,
       error = context->settings.writeRegCallback(connection->role, address,
          value, commit);
    }
+   else if(context->settings.writeRegsCallback != NULL)
+   {
+      //Register values are stored in network byte order
+      STORE16BE(value, buffer);
+
+      //Write a block made of a single register
+      error = context->settings.writeRegsCallback(connection->role, address,
+         1, buffer, commit);
+   }
    else
    {
       //Report an error
@@ -663,6 +735,371 @@ error_t modbusServerWriteReg(ModbusClientConnection *connection,
 }
 
 
+/**
+ * @brief Get the state of a block of coils
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first coil
+ * @param[in] quantity Number of coils
+ * @param[out] states Coil states, packed as one coil per bit
+ * @return Error code
+ **/
+
+error_t modbusServerReadCoils(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *states)
+{
+   error_t error;
+   ModbusServerContext *context;
+
+   //Point to the Modbus/TCP server context
+   context = connection->context;
+
+   //Any registered callback?
+   if(context->settings.readCoilsCallback != NULL)
+   {
+      //Read the whole block at once
+      error = context->settings.readCoilsCallback(connection->role, address,
+         quantity, states);
+
+      //Clear the padding bits of the final data byte
+      modbusServerClearPaddingBits(states, quantity);
+   }
+   else
+   {
+      //Read the coils one at a time
+      error = modbusServerReadCoilsOneByOne(connection, address, quantity,
+         states, FALSE);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the state of a block of discrete inputs
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first discrete input
+ * @param[in] quantity Number of discrete inputs
+ * @param[out] states Discrete input states, packed as one input per bit
+ * @return Error code
+ **/
+
+error_t modbusServerReadDiscreteInputs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *states)
+{
+   error_t error;
+   ModbusServerContext *context;
+
+   //Point to the Modbus/TCP server context
+   context = connection->context;
+
+   //Any registered callback?
+   if(context->settings.readDiscreteInputsCallback != NULL)
+   {
+      //Read the whole block at once
+      error = context->settings.readDiscreteInputsCallback(connection->role,
+         address, quantity, states);
+
+      //Clear the padding bits of the final data byte
+      modbusServerClearPaddingBits(states, quantity);
+   }
+   else if(context->settings.readDiscreteInputCallback == NULL &&
+      context->settings.readCoilsCallback != NULL)
+   {
+      //Discrete inputs and coils share the same table
+      error = modbusServerReadCoils(connection, address, quantity, states);
+   }
+   else
+   {
+      //Read the discrete inputs one at a time
+      error = modbusServerReadCoilsOneByOne(connection, address, quantity,
+         states, TRUE);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Set the state of a block of coils
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first coil
+ * @param[in] quantity Number of coils
+ * @param[in] states Desired coil states, packed as one coil per bit
+ * @param[in] commit This flag indicates the current phase (validation phase
+ *   or write phase if the validation was successful)
+ * @return Error code
+ **/
+
+error_t modbusServerWriteCoils(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, const uint8_t *states, bool_t commit)
+{
+   error_t error;
+   uint16_t i;
+   ModbusServerContext *context;
+
+   //Point to the Modbus/TCP server context
+   context = connection->context;
+
+   //Any registered callback?
+   if(context->settings.writeCoilsCallback != NULL)
+   {
+      //Write the whole block at once
+      error = context->settings.writeCoilsCallback(connection->role, address,
+         quantity, states, commit);
+   }
+   else
+   {
+      //Initialize status code
+      error = NO_ERROR;
+
+      //Write the coils one at a time
+      for(i = 0; i < quantity && !error; i++)
+      {
+         error = modbusServerWriteCoil(connection, address + i,
+            MODBUS_TEST_COIL(states, i), commit);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the value of a block of holding registers
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first register
+ * @param[in] quantity Number of registers
+ * @param[out] values Register values, in network byte order
+ * @return Error code
+ **/
+
+error_t modbusServerReadHoldingRegs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *values)
+{
+   error_t error;
+   ModbusServerContext *context;
+
+   //Point to the Modbus/TCP server context
+   context = connection->context;
+
+   //Any registered callback?
+   if(context->settings.readHoldingRegsCallback != NULL)
+   {
+      //Read the whole block at once
+      error = context->settings.readHoldingRegsCallback(connection->role,
+         address, quantity, values);
+   }
+   else if(context->settings.readHoldingRegCallback == NULL &&
+      context->settings.readRegsCallback != NULL)
+   {
+      //Read the whole block at once
+      error = context->settings.readRegsCallback(connection->role, address,
+         quantity, values);
+   }
+   else
+   {
+      //Read the registers one at a time
+      error = modbusServerReadRegsOneByOne(connection, address, quantity,
+         values, FALSE);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the value of a block of input registers
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first register
+ * @param[in] quantity Number of registers
+ * @param[out] values Register values, in network byte order
+ * @return Error code
+ **/
+
+error_t modbusServerReadInputRegs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *values)
+{
+   error_t error;
+   ModbusServerContext *context;
+
+   //Point to the Modbus/TCP server context
+   context = connection->context;
+
+   //Any registered callback?
+   if(context->settings.readInputRegsCallback != NULL)
+   {
+      //Read the whole block at once
+      error = context->settings.readInputRegsCallback(connection->role,
+         address, quantity, values);
+   }
+   else if(context->settings.readInputRegCallback == NULL &&
+      context->settings.readRegsCallback != NULL)
+   {
+      //Read the whole block at once
+      error = context->settings.readRegsCallback(connection->role, address,
+         quantity, values);
+   }
+   else
+   {
+      //Read the registers one at a time
+      error = modbusServerReadRegsOneByOne(connection, address, quantity,
+         values, TRUE);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Set the value of a block of registers
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first register
+ * @param[in] quantity Number of registers
+ * @param[in] values Desired register values, in network byte order
+ * @param[in] commit This flag indicates the current phase (validation phase
+ *   or write phase if the validation was successful)
+ * @return Error code
+ **/
+
+error_t modbusServerWriteRegs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, const uint8_t *values, bool_t commit)
+{
+   error_t error;
+   uint16_t i;
+   ModbusServerContext *context;
+
+   //Point to the Modbus/TCP server context
+   context = connection->context;
+
+   //Any registered callback?
+   if(context->settings.writeRegsCallback != NULL)
+   {
+      //Write the whole block at once
+      error = context->settings.writeRegsCallback(connection->role, address,
+         quantity, values, commit);
+   }
+   else
+   {
+      //Initialize status code
+      error = NO_ERROR;
+
+      //Write the registers one at a time
+      for(i = 0; i < quantity && !error; i++)
+      {
+         error = modbusServerWriteReg(connection, address + i,
+            LOAD16BE(values + i * sizeof(uint16_t)), commit);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the state of a block of coils or discrete inputs, one at a time
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first item
+ * @param[in] quantity Number of items
+ * @param[out] states Item states, packed as one item per bit
+ * @param[in] discreteInputs Read discrete inputs rather than coils
+ * @return Error code
+ **/
+
+error_t modbusServerReadCoilsOneByOne(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *states,
+   bool_t discreteInputs)
+{
+   error_t error;
+   uint16_t i;
+   bool_t state;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Read the specified number of items
+   for(i = 0; i < quantity && !error; i++)
+   {
+      //Retrieve the state of the current item
+      if(discreteInputs)
+         error = modbusServerReadDiscreteInput(connection, address + i, &state);
+      else
+         error = modbusServerReadCoil(connection, address + i, &state);
+
+      //Successful read operation?
+      if(!error)
+      {
+         //The items are packed as one item per bit of the data field
+         if(state)
+            MODBUS_SET_COIL(states, i);
+         else
+            MODBUS_RESET_COIL(states, i);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the value of a block of registers, one at a time
+ * @param[in] connection Pointer to the client connection
+ * @param[in] address Address of the first register
+ * @param[in] quantity Number of registers
+ * @param[out] values Register values, in network byte order
+ * @param[in] inputRegs Read input registers rather than holding registers
+ * @return Error code
+ **/
+
+error_t modbusServerReadRegsOneByOne(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *values, bool_t inputRegs)
+{
+   error_t error;
+   uint16_t i;
+   uint16_t value;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Read the specified number of registers
+   for(i = 0; i < quantity && !error; i++)
+   {
+      //Retrieve the value of the current register
+      if(inputRegs)
+         error = modbusServerReadInputReg(connection, address + i, &value);
+      else
+         error = modbusServerReadHoldingReg(connection, address + i, &value);
+
+      //Convert the value to network byte order
+      STORE16BE(value, values + i * sizeof(uint16_t));
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Clear the padding bits of the final byte of a coil array
+ * @param[in,out] states Coil states, packed as one coil per bit
+ * @param[in] quantity Number of coils
+ **/
+
+void modbusServerClearPaddingBits(uint8_t *states, uint16_t quantity)
+{
+   //If the quantity of coils is not a multiple of eight, the remaining
+   //bits in the final data byte must be padded with zeros
+   if((quantity % 8) != 0)
+      states[quantity / 8] &= (1 << (quantity % 8)) - 1;
+}
+
+
 /**
  * @brief Translate exception code
  * @param[in] status Status code
@@ -77,6 +77,33 @@ error_t modbusServerReadInputReg(ModbusClientConnection *connection,
 error_t modbusServerWriteReg(ModbusClientConnection *connection,
    uint16_t address, uint16_t value, bool_t commit);
 
+error_t modbusServerReadCoils(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *states);
+
+error_t modbusServerReadDiscreteInputs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *states);
+
+error_t modbusServerWriteCoils(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, const uint8_t *states, bool_t commit);
+
+error_t modbusServerReadHoldingRegs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *values);
+
+error_t modbusServerReadInputRegs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *values);
+
+error_t modbusServerWriteRegs(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, const uint8_t *values, bool_t commit);
+
+error_t modbusServerReadCoilsOneByOne(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *states,
+   bool_t discreteInputs);
+
+error_t modbusServerReadRegsOneByOne(ModbusClientConnection *connection,
+   uint16_t address, uint16_t quantity, uint8_t *values, bool_t inputRegs);
+
+void modbusServerClearPaddingBits(uint8_t *states, uint16_t quantity);
+
 ModbusExceptionCode modbusServerTranslateExceptionCode(error_t status);
 
 //C++ guard
@@ -0,0 +1,230 @@
+/**
+ * @file modbus_server_table.c
+ * @brief Memory-mapped Modbus tables
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The following functions serve block-oriented callbacks from tables that
+ * are stored in memory. A typical usage is:
+ *
+ * error_t readHoldingRegsCallback(const char_t *role, uint16_t address,
+ *    uint16_t quantity, uint8_t *values)
+ * {
+ *    return modbusServerReadRegTable(&holdingRegTable, address, quantity,
+ *       values);
+ * }
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL MODBUS_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "modbus/modbus_server.h"
+#include "modbus/modbus_server_table.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (MODBUS_SERVER_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Get the state of a block of coils from a coil table
+ * @param[in] table Pointer to the coil table
+ * @param[in] address Address of the first coil
+ * @param[in] quantity Number of coils
+ * @param[out] states Coil states, packed as one coil per bit
+ * @return Error code
+ **/
+
+error_t modbusServerReadCoilTable(const ModbusServerCoilTable *table,
+   uint16_t address, uint16_t quantity, uint8_t *states)
+{
+   uint_t i;
+   uint_t offset;
+
+   //Make sure the whole block lies within the table
+   if(address < table->address)
+      return ERROR_INVALID_ADDRESS;
+   if((address - table->address + quantity) > table->count)
+      return ERROR_INVALID_ADDRESS;
+
+   //Position of the first coil in the table
+   offset = address - table->address;
+
+   //Check whether the block is byte-aligned
+   if((offset % 8) == 0)
+   {
+      //Copy the coil states
+      memcpy(states, table->states + offset / 8, (quantity + 7) / 8);
+   }
+   else
+   {
+      //Copy the coil states bit by bit
+      for(i = 0; i < quantity; i++)
+      {
+         if(MODBUS_TEST_COIL(table->states, offset + i))
+            MODBUS_SET_COIL(states, i);
+         else
+            MODBUS_RESET_COIL(states, i);
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the state of a block of coils in a coil table
+ * @param[in] table Pointer to the coil table
+ * @param[in] address Address of the first coil
+ * @param[in] quantity Number of coils
+ * @param[in] states Desired coil states, packed as one coil per bit
+ * @param[in] commit This flag indicates the current phase (validation phase
+ *   or write phase if the validation was successful)
+ * @return Error code
+ **/
+
+error_t modbusServerWriteCoilTable(ModbusServerCoilTable *table,
+   uint16_t address, uint16_t quantity, const uint8_t *states, bool_t commit)
+{
+   uint_t i;
+   uint_t offset;
+
+   //Make sure the whole block lies within the table
+   if(address < table->address)
+      return ERROR_INVALID_ADDRESS;
+   if((address - table->address + quantity) > table->count)
+      return ERROR_INVALID_ADDRESS;
+
+   //Read-only table?
+   if(!table->writable)
+      return ERROR_INVALID_ADDRESS;
+
+   //Write phase?
+   if(commit)
+   {
+      //Position of the first coil in the table
+      offset = address - table->address;
+
+      //Force the coils to the desired ON/OFF state
+      for(i = 0; i < quantity; i++)
+      {
+         if(MODBUS_TEST_COIL(states, i))
+            MODBUS_SET_COIL(table->states, offset + i);
+         else
+            MODBUS_RESET_COIL(table->states, offset + i);
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the value of a block of registers from a register table
+ * @param[in] table Pointer to the register table
+ * @param[in] address Address of the first register
+ * @param[in] quantity Number of registers
+ * @param[out] values Register values, in network byte order
+ * @return Error code
+ **/
+
+error_t modbusServerReadRegTable(const ModbusServerRegTable *table,
+   uint16_t address, uint16_t quantity, uint8_t *values)
+{
+   uint_t i;
+   const uint16_t *p;
+
+   //Make sure the whole block lies within the table
+   if(address < table->address)
+      return ERROR_INVALID_ADDRESS;
+   if((address - table->address + quantity) > table->count)
+      return ERROR_INVALID_ADDRESS;
+
+   //Point to the first register of the block
+   p = table->values + (address - table->address);
+
+   //Convert the values to network byte order
+   for(i = 0; i < quantity; i++)
+   {
+      STORE16BE(p[i], values + i * sizeof(uint16_t));
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the value of a block of registers in a register table
+ * @param[in] table Pointer to the register table
+ * @param[in] address Address of the first register
+ * @param[in] quantity Number of registers
+ * @param[in] values Desired register values, in network byte order
+ * @param[in] commit This flag indicates the current phase (validation phase
+ *   or write phase if the validation was successful)
+ * @return Error code
+ **/
+
+error_t modbusServerWriteRegTable(ModbusServerRegTable *table,
+   uint16_t address, uint16_t quantity, const uint8_t *values, bool_t commit)
+{
+   uint_t i;
+   uint16_t *p;
+
+   //Make sure the whole block lies within the table
+   if(address < table->address)
+      return ERROR_INVALID_ADDRESS;
+   if((address - table->address + quantity) > table->count)
+      return ERROR_INVALID_ADDRESS;
+
+   //Read-only table?
+   if(!table->writable)
+      return ERROR_INVALID_ADDRESS;
+
+   //Write phase?
+   if(commit)
+   {
+      //Point to the first register of the block
+      p = table->values + (address - table->address);
+
+      //Convert the values to host byte order
+      for(i = 0; i < quantity; i++)
+      {
+         p[i] = LOAD16BE(values + i * sizeof(uint16_t));
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
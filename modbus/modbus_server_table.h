@@ -0,0 +1,88 @@
+/**
+ * @file modbus_server_table.h
+ * @brief Memory-mapped Modbus tables
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _MODBUS_SERVER_TABLE_H
+#define _MODBUS_SERVER_TABLE_H
+
+//Dependencies
+#include "core/net.h"
+#include "modbus/modbus_server.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Memory-mapped coil table
+ **/
+
+typedef struct
+{
+   uint16_t address; ///<Address of the first coil
+   uint16_t count;   ///<Number of coils
+   uint8_t *states;  ///<Coil states, packed as one coil per bit
+   bool_t writable;  ///<The coils can be forced by clients
+} ModbusServerCoilTable;
+
+
+/**
+ * @brief Memory-mapped register table
+ **/
+
+typedef struct
+{
+   uint16_t address; ///<Address of the first register
+   uint16_t count;   ///<Number of registers
+   uint16_t *values; ///<Register values, in host byte order
+   bool_t writable;  ///<The registers can be written by clients
+} ModbusServerRegTable;
+
+
+//Modbus/TCP server related functions
+error_t modbusServerReadCoilTable(const ModbusServerCoilTable *table,
+   uint16_t address, uint16_t quantity, uint8_t *states);
+
+error_t modbusServerWriteCoilTable(ModbusServerCoilTable *table,
+   uint16_t address, uint16_t quantity, const uint8_t *states, bool_t commit);
+
+error_t modbusServerReadRegTable(const ModbusServerRegTable *table,
+   uint16_t address, uint16_t quantity, uint8_t *values);
+
+error_t modbusServerWriteRegTable(ModbusServerRegTable *table,
+   uint16_t address, uint16_t quantity, const uint8_t *values, bool_t commit);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
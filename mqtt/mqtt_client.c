@@ -37,6 +37,8 @@
 #include "mqtt/mqtt_client_packet.h"
 #include "mqtt/mqtt_client_transport.h"
 #include "mqtt/mqtt_client_misc.h"
+#include "mqtt/mqtt_client_queue.h"
+#include "mqtt/mqtt_client_topic.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -88,6 +90,8 @@ error_t mqttClientInit(MqttClientContext *context)
    context->state = MQTT_CLIENT_STATE_CLOSED;
    //Initialize packet identifier
    context->packetId = 0;
+   //Default limits until the server advertises its own
+   mqttClientResetServerSettings(context);
 
    //Successful initialization
    return NO_ERROR;
@@ -131,7 +135,7 @@ error_t mqttClientRegisterCallbacks(MqttClientContext *context,
 /**
  * @brief Set the MQTT protocol version to be used
  * @param[in] context Pointer to the MQTT client context
- * @param[in] version MQTT protocol version (3.1 or 3.1.1)
+ * @param[in] version MQTT protocol version (3.1, 3.1.1 or 5.0)
  * @return Error code
  **/
 
@@ -221,6 +225,112 @@ error_t mqttClientRegisterPublishCallback(MqttClientContext *context,
 }
 
 
+/**
+ * @brief Attach a handler to a topic filter
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] filter NULL-terminated string that contains the topic filter.
+ *   The '+' and '#' wildcard characters are supported
+ * @param[in] handler Callback function to be called when a PUBLISH message
+ *   whose topic name matches the filter is received
+ * @return Error code
+ **/
+
+error_t mqttClientRegisterTopicHandler(MqttClientContext *context,
+   const char_t *filter, MqttClientPublishCallback handler)
+{
+#if (MQTT_CLIENT_TOPIC_TRIE_SUPPORT == ENABLED)
+   error_t error;
+   uint_t i;
+
+   //Check parameters
+   if(context == NULL || filter == NULL || handler == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the syntax of the topic filter
+   error = mqttClientCheckTopicFilter(filter);
+   //Invalid topic filter?
+   if(error)
+      return error;
+
+   //Add the topic filter to the trie
+   i = mqttClientFindTopicNode(context, filter, TRUE);
+   //Failed to allocate a node?
+   if(i == 0)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Attach the handler to the topic filter
+   context->topicNodes[i].handler = handler;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Detach the handler from a topic filter
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] filter NULL-terminated string that contains the topic filter
+ * @return Error code
+ **/
+
+error_t mqttClientUnregisterTopicHandler(MqttClientContext *context,
+   const char_t *filter)
+{
+#if (MQTT_CLIENT_TOPIC_TRIE_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Check parameters
+   if(context == NULL || filter == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Search the trie for the topic filter
+   i = mqttClientFindTopicNode(context, filter, FALSE);
+
+   //No handler attached to the topic filter?
+   if(i == 0 || context->topicNodes[i].handler == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Detach the handler
+   context->topicNodes[i].handler = NULL;
+   //Release the nodes that are no longer needed
+   mqttClientPruneTopicNode(context, i);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register publish completion callback function
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] callback Callback function invoked when the QoS 1 or QoS 2
+ *   protocol exchange of a published message completes
+ * @return Error code
+ **/
+
+error_t mqttClientRegisterPublishCompleteCallback(MqttClientContext *context,
+   MqttClientPublishCompleteCallback callback)
+{
+   //Make sure the MQTT client context is valid
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save callback function
+   context->callbacks.publishCompleteCallback = callback;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Set communication timeout
  * @param[in] context Pointer to the MQTT client context
@@ -458,6 +568,73 @@ error_t mqttClientBindToInterface(MqttClientContext *context,
 }
 
 
+/**
+ * @brief Specify the file used to extend the store-and-forward queue
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] path NULL-terminated string specifying the path of the file.
+ *   Messages left over from a previous session are recovered
+ * @return Error code
+ **/
+
+error_t mqttClientSetQueueFile(MqttClientContext *context, const char_t *path)
+{
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED && MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || path == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the length of the path is acceptable
+   if(strlen(path) > MQTT_CLIENT_MAX_QUEUE_PATH_LEN)
+      return ERROR_INVALID_LENGTH;
+
+   //Save the path of the queue file
+   strcpy(context->queue.path, path);
+
+   //Recover the messages stored in the file
+   return mqttClientQueueLoadFile(context);
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Get the state of the store-and-forward queue
+ * @param[in] context Pointer to the MQTT client context
+ * @param[out] count Number of messages waiting in the queue
+ * @param[out] freeSpace Free space left in the RAM queue, in bytes
+ * @return Error code
+ **/
+
+error_t mqttClientGetQueueStatus(MqttClientContext *context,
+   uint_t *count, size_t *freeSpace)
+{
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || count == NULL || freeSpace == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Number of messages held in the RAM queue
+   *count = context->queue.count;
+
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   //Add the number of messages stored in the queue file
+   *count += context->queue.fileCount;
+#endif
+
+   //Free space left in the RAM queue
+   *freeSpace = MQTT_CLIENT_QUEUE_SIZE - context->queue.length;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Establish connection with the MQTT server
  * @param[in] context Pointer to the MQTT client context
@@ -524,6 +701,14 @@ error_t mqttClientConnect(MqttClientContext *context,
       }
       else if(context->state == MQTT_CLIENT_STATE_CONNECTED)
       {
+         //Messages that are still in flight belong to the previous session
+         if(cleanSession)
+            mqttClientFlushInflight(context);
+
+         //Forget the limits advertised by the server during the previous
+         //connection
+         mqttClientResetServerSettings(context);
+
          //Format CONNECT packet
          error = mqttClientFormatConnect(context, cleanSession);
 
@@ -560,6 +745,11 @@ error_t mqttClientConnect(MqttClientContext *context,
       }
       else if(context->state == MQTT_CLIENT_STATE_PACKET_RECEIVED)
       {
+         //When the session is resumed, unacknowledged PUBLISH and PUBREL
+         //packets must be resent
+         if(!cleanSession)
+            mqttClientRetransmitInflight(context);
+
          //Reset packet type
          context->packetType = MQTT_PACKET_TYPE_INVALID;
          //A CONNACK packet has been received
@@ -602,6 +792,10 @@ error_t mqttClientConnect(MqttClientContext *context,
  * @param[in] qos QoS level to be used when publishing the message
  * @param[in] retain This flag specifies if the message is to be retained
  * @param[out] packetId Packet identifier used to send the PUBLISH packet
+ *   (optional parameter). If specified, the function returns as soon as the
+ *   packet has been sent and does not wait for the PUBACK/PUBCOMP packet. The
+ *   publish completion callback reports the end of the QoS protocol exchange.
+ *   The value is set to zero when the message is queued
  * @return Error code
  **/
 
@@ -610,6 +804,7 @@ error_t mqttClientPublish(MqttClientContext *context,
    MqttQosLevel qos, bool_t retain, uint16_t *packetId)
 {
    error_t error;
+   MqttClientInflightEntry *entry;
 
    //Check parameters
    if(context == NULL || topic == NULL)
@@ -617,6 +812,21 @@ error_t mqttClientPublish(MqttClientContext *context,
    if(message == NULL && length != 0)
       return ERROR_INVALID_PARAMETER;
 
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED)
+   //Messages published while the connection is down, or while older
+   //messages are still pending, are stored and forwarded later on
+   if(mqttClientQueueIsActive(context))
+   {
+      //No packet identifier is assigned until the message is sent
+      if(packetId != NULL)
+         *packetId = 0;
+
+      //Add the message to the queue
+      return mqttClientEnqueueMessage(context, topic, message, length, qos,
+         retain);
+   }
+#endif
+
    //Initialize status code
    error = NO_ERROR;
 
@@ -626,20 +836,51 @@ error_t mqttClientPublish(MqttClientContext *context,
       //Check current state
       if(context->state == MQTT_CLIENT_STATE_IDLE)
       {
+         //QoS 1 and QoS 2 messages require a free entry in the in-flight
+         //window
+         if(qos != MQTT_QOS_LEVEL_0)
+            entry = mqttClientAllocInflightEntry(context);
+         else
+            entry = NULL;
+
          //Check for transmission completion
-         if(context->packetType == MQTT_PACKET_TYPE_INVALID)
+         if(context->packetType != MQTT_PACKET_TYPE_INVALID)
+         {
+            //Reset packet type
+            context->packetType = MQTT_PACKET_TYPE_INVALID;
+            //We are done
+            break;
+         }
+         else if(qos != MQTT_QOS_LEVEL_0 && entry == NULL)
          {
-            //Format PUBLISH packet
-            error = mqttClientFormatPublish(context, topic, message,
-               length, qos, retain);
+            //The window is full. Process incoming acknowledgments until an
+            //entry is released
+            error = mqttClientProcessEvents(context, context->settings.timeout);
+         }
+         else
+         {
+            //Pending retransmissions must be sent before any new message
+            error = mqttClientCheckInflight(context);
+
+            //Nothing left to retransmit?
+            if(!error && context->state == MQTT_CLIENT_STATE_IDLE)
+            {
+               //Format PUBLISH packet
+               error = mqttClientFormatPublish(context, topic, message,
+                  length, qos, retain);
+            }
 
             //Check status code
-            if(!error)
+            if(!error && context->state == MQTT_CLIENT_STATE_IDLE)
             {
                //Save the packet identifier used to send the PUBLISH packet
                if(packetId != NULL)
                   *packetId = context->packetId;
 
+               //Track the message until the QoS protocol exchange completes
+               if(qos != MQTT_QOS_LEVEL_0)
+                  mqttClientAddInflightEntry(context, entry, qos);
+
                //Debug message
                TRACE_INFO("MQTT: Sending PUBLISH packet (%" PRIuSIZE " bytes)...\r\n",
                   context->packetLen);
@@ -656,13 +897,6 @@ error_t mqttClientPublish(MqttClientContext *context,
                mqttClientChangeState(context, MQTT_CLIENT_STATE_SENDING_PACKET);
             }
          }
-         else
-         {
-            //Reset packet type
-            context->packetType = MQTT_PACKET_TYPE_INVALID;
-            //We are done
-            break;
-         }
       }
       else if(context->state == MQTT_CLIENT_STATE_SENDING_PACKET)
       {
@@ -924,6 +1158,34 @@ error_t mqttClientUnsubscribe(MqttClientContext *context,
 }
 
 
+/**
+ * @brief Get the number of QoS 1 and QoS 2 messages in flight
+ * @param[in] context Pointer to the MQTT client context
+ * @return Number of messages whose QoS protocol exchange is not complete
+ **/
+
+uint_t mqttClientGetInflightCount(MqttClientContext *context)
+{
+   uint_t i;
+   uint_t n;
+
+   //Make sure the MQTT client context is valid
+   if(context == NULL)
+      return 0;
+
+   //Loop through the in-flight window
+   for(n = 0, i = 0; i < MQTT_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Count the entries that are in use
+      if(context->inflight[i].state != MQTT_INFLIGHT_STATE_NONE)
+         n++;
+   }
+
+   //Return the number of messages in flight
+   return n;
+}
+
+
 /**
  * @brief Send ping request
  * @param[in] context Pointer to the MQTT client context
@@ -126,6 +126,83 @@
    #error MQTT_CLIENT_BUFFER_SIZE parameter is not valid
 #endif
 
+//Maximum number of QoS 1 and QoS 2 messages that can be in flight
+#ifndef MQTT_CLIENT_MAX_INFLIGHT
+   #define MQTT_CLIENT_MAX_INFLIGHT 4
+#elif (MQTT_CLIENT_MAX_INFLIGHT < 1)
+   #error MQTT_CLIENT_MAX_INFLIGHT parameter is not valid
+#endif
+
+//Size of the buffer used to retransmit an in-flight PUBLISH packet
+#ifndef MQTT_CLIENT_INFLIGHT_BUFFER_SIZE
+   #define MQTT_CLIENT_INFLIGHT_BUFFER_SIZE 128
+#elif (MQTT_CLIENT_INFLIGHT_BUFFER_SIZE < 1)
+   #error MQTT_CLIENT_INFLIGHT_BUFFER_SIZE parameter is not valid
+#endif
+
+//Maximum number of topic aliases in each direction (MQTT 5.0)
+#ifndef MQTT_CLIENT_TOPIC_ALIAS_MAX
+   #define MQTT_CLIENT_TOPIC_ALIAS_MAX 4
+#elif (MQTT_CLIENT_TOPIC_ALIAS_MAX < 0 || MQTT_CLIENT_TOPIC_ALIAS_MAX > 65535)
+   #error MQTT_CLIENT_TOPIC_ALIAS_MAX parameter is not valid
+#endif
+
+//Maximum length of a topic name that can be bound to a topic alias
+#ifndef MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN
+   #define MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN 64
+#elif (MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN < 1)
+   #error MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN parameter is not valid
+#endif
+
+//Store-and-forward queue support
+#ifndef MQTT_CLIENT_QUEUE_SUPPORT
+   #define MQTT_CLIENT_QUEUE_SUPPORT DISABLED
+#elif (MQTT_CLIENT_QUEUE_SUPPORT != ENABLED && MQTT_CLIENT_QUEUE_SUPPORT != DISABLED)
+   #error MQTT_CLIENT_QUEUE_SUPPORT parameter is not valid
+#endif
+
+//File system backend for the store-and-forward queue
+#ifndef MQTT_CLIENT_QUEUE_FS_SUPPORT
+   #define MQTT_CLIENT_QUEUE_FS_SUPPORT DISABLED
+#elif (MQTT_CLIENT_QUEUE_FS_SUPPORT != ENABLED && MQTT_CLIENT_QUEUE_FS_SUPPORT != DISABLED)
+   #error MQTT_CLIENT_QUEUE_FS_SUPPORT parameter is not valid
+#endif
+
+//Size of the store-and-forward queue, in bytes
+#ifndef MQTT_CLIENT_QUEUE_SIZE
+   #define MQTT_CLIENT_QUEUE_SIZE 2048
+#elif (MQTT_CLIENT_QUEUE_SIZE < 64 || (MQTT_CLIENT_QUEUE_SIZE % 4) != 0)
+   #error MQTT_CLIENT_QUEUE_SIZE parameter is not valid
+#endif
+
+//Maximum length of the queue file path
+#ifndef MQTT_CLIENT_MAX_QUEUE_PATH_LEN
+   #define MQTT_CLIENT_MAX_QUEUE_PATH_LEN 32
+#elif (MQTT_CLIENT_MAX_QUEUE_PATH_LEN < 1)
+   #error MQTT_CLIENT_MAX_QUEUE_PATH_LEN parameter is not valid
+#endif
+
+//Topic filter dispatch support
+#ifndef MQTT_CLIENT_TOPIC_TRIE_SUPPORT
+   #define MQTT_CLIENT_TOPIC_TRIE_SUPPORT DISABLED
+#elif (MQTT_CLIENT_TOPIC_TRIE_SUPPORT != ENABLED && MQTT_CLIENT_TOPIC_TRIE_SUPPORT != DISABLED)
+   #error MQTT_CLIENT_TOPIC_TRIE_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of nodes in the topic filter trie
+#ifndef MQTT_CLIENT_MAX_TOPIC_NODES
+   #define MQTT_CLIENT_MAX_TOPIC_NODES 32
+#elif (MQTT_CLIENT_MAX_TOPIC_NODES < 2 || MQTT_CLIENT_MAX_TOPIC_NODES > 65535)
+   #error MQTT_CLIENT_MAX_TOPIC_NODES parameter is not valid
+#endif
+
+//Maximum length of a topic level
+#ifndef MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN
+   #define MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN 16
+#elif (MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN < 1 || MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN > 255)
+   #error MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN parameter is not valid
+#endif
+
 //TLS supported?
 #if (MQTT_CLIENT_TLS_SUPPORT == ENABLED)
    #include "core/crypto.h"
@@ -137,6 +214,11 @@
    #include "web_socket/web_socket.h"
 #endif
 
+//File system backend supported?
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED && MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   #include "fs_port.h"
+#endif
+
 //Forward declaration of MqttClientContext structure
 struct _MqttClientContext;
 #define MqttClientContext struct _MqttClientContext
@@ -184,6 +266,19 @@ typedef void (*MqttClientPublishCallback)(MqttClientContext *context,
    bool_t dup, MqttQosLevel qos, bool_t retain, uint16_t packetId);
 
 
+/**
+ * @brief In-flight message states
+ **/
+
+typedef enum
+{
+   MQTT_INFLIGHT_STATE_NONE         = 0,
+   MQTT_INFLIGHT_STATE_WAIT_PUBACK  = 1,
+   MQTT_INFLIGHT_STATE_WAIT_PUBREC  = 2,
+   MQTT_INFLIGHT_STATE_WAIT_PUBCOMP = 3
+} MqttClientInflightState;
+
+
 /**
  * @brief PUBACK message received callback
  **/
@@ -216,6 +311,14 @@ typedef void (*MqttClientPubCompCallback)(MqttClientContext *context,
    uint16_t packetId);
 
 
+/**
+ * @brief Publish completion callback
+ **/
+
+typedef void (*MqttClientPublishCompleteCallback)(MqttClientContext *context,
+   uint16_t packetId);
+
+
 /**
  * @brief SUBACK message received callback
  **/
@@ -281,12 +384,76 @@ typedef struct
    MqttClientPubAckCallback subAckCallback;     ///<SUBACK message received callback
    MqttClientPubAckCallback unsubAckCallback;   ///<UNSUBACK message received callback
    MqttClientPingRespCallback pingRespCallback; ///<PINGRESP message received callback
+   MqttClientPublishCompleteCallback publishCompleteCallback; ///<Publish completion callback
 #if (MQTT_CLIENT_TLS_SUPPORT == ENABLED)
    MqttClientTlsInitCallback tlsInitCallback;   ///<TLS initialization callback
 #endif
 } MqttClientCallbacks;
 
 
+/**
+ * @brief In-flight message
+ **/
+
+typedef struct
+{
+   MqttClientInflightState state;                    ///<State of the QoS protocol exchange
+   uint16_t packetId;                                ///<Packet identifier
+   uint32_t seqNum;                                  ///<Order in which the message was sent
+   bool_t retransmit;                                ///<The message must be retransmitted
+   size_t length;                                    ///<Length of the PUBLISH packet (0 if not stored)
+   uint8_t packet[MQTT_CLIENT_INFLIGHT_BUFFER_SIZE]; ///<Copy of the PUBLISH packet
+} MqttClientInflightEntry;
+
+
+/**
+ * @brief Store-and-forward queue
+ **/
+
+typedef struct
+{
+   uint32_t buffer[MQTT_CLIENT_QUEUE_SIZE / 4];           ///<Ring buffer holding queued messages
+   size_t head;                                          ///<Position of the oldest record
+   size_t tail;                                          ///<Position where to write the next record
+   size_t length;                                        ///<Number of bytes in use
+   uint_t count;                                         ///<Number of messages waiting in the queue
+   size_t batchLen;                                      ///<Length of the packets coalesced so far
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   char_t path[MQTT_CLIENT_MAX_QUEUE_PATH_LEN + 1];      ///<Path of the queue file
+   uint32_t fileReadPos;                                 ///<Position of the oldest record in the file
+   uint32_t fileWritePos;                                ///<End of valid data in the file
+   uint_t fileCount;                                     ///<Number of messages waiting in the file
+#endif
+} MqttClientQueue;
+
+
+/**
+ * @brief Topic alias (MQTT 5.0)
+ **/
+
+typedef struct
+{
+   char_t topic[MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN + 1]; ///<Topic name bound to the alias
+   bool_t established;                               ///<The server knows the binding
+} MqttClientTopicAlias;
+
+
+/**
+ * @brief Node of the topic filter trie
+ **/
+
+typedef struct
+{
+   bool_t used;                                       ///<The node is in use
+   uint8_t levelLen;                                  ///<Length of the topic level
+   char_t level[MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN + 1]; ///<Topic level (may be a wildcard)
+   uint16_t parent;                                   ///<Index of the parent node
+   uint16_t child;                                    ///<Index of the first child (0 if none)
+   uint16_t sibling;                                  ///<Index of the next sibling (0 if none)
+   MqttClientPublishCallback handler;                 ///<Handler attached to the topic filter
+} MqttClientTopicNode;
+
+
 /**
  * @brief MQTT client settings
  **/
@@ -335,6 +502,21 @@ struct _MqttClientContext
    MqttPacketType packetType;               ///<Control packet type
    uint16_t packetId;                       ///<Packet identifier
    size_t remainingLen;                     ///<Length of the variable header and payload
+   MqttClientInflightEntry inflight[MQTT_CLIENT_MAX_INFLIGHT]; ///<In-flight QoS 1 and QoS 2 messages
+   uint32_t inflightSeqNum;                 ///<Sequence number of the last in-flight message
+   uint16_t serverReceiveMax;               ///<Receive Maximum advertised by the server
+   uint32_t serverMaxPacketSize;            ///<Maximum Packet Size advertised by the server (0 if unlimited)
+   uint16_t serverTopicAliasMax;            ///<Topic Alias Maximum advertised by the server
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   MqttClientTopicAlias txTopicAlias[MQTT_CLIENT_TOPIC_ALIAS_MAX]; ///<Topic aliases used when sending
+   MqttClientTopicAlias rxTopicAlias[MQTT_CLIENT_TOPIC_ALIAS_MAX]; ///<Topic aliases defined by the server
+#endif
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED)
+   MqttClientQueue queue;                   ///<Store-and-forward queue
+#endif
+#if (MQTT_CLIENT_TOPIC_TRIE_SUPPORT == ENABLED)
+   MqttClientTopicNode topicNodes[MQTT_CLIENT_MAX_TOPIC_NODES]; ///<Topic filter trie (node 0 is the root)
+#endif
 };
 
 
@@ -360,6 +542,15 @@ error_t mqttClientRegisterTlsInitCallback(MqttClientContext *context,
 error_t mqttClientRegisterPublishCallback(MqttClientContext *context,
    MqttClientPublishCallback callback);
 
+error_t mqttClientRegisterTopicHandler(MqttClientContext *context,
+   const char_t *filter, MqttClientPublishCallback handler);
+
+error_t mqttClientUnregisterTopicHandler(MqttClientContext *context,
+   const char_t *filter);
+
+error_t mqttClientRegisterPublishCompleteCallback(MqttClientContext *context,
+   MqttClientPublishCompleteCallback callback);
+
 error_t mqttClientSetTimeout(MqttClientContext *context, systime_t timeout);
 error_t mqttClientSetKeepAlive(MqttClientContext *context, uint16_t keepAlive);
 
@@ -378,6 +569,11 @@ error_t mqttClientSetWillMessage(MqttClientContext *context, const char_t *topic
 error_t mqttClientBindToInterface(MqttClientContext *context,
    NetInterface *interface);
 
+error_t mqttClientSetQueueFile(MqttClientContext *context, const char_t *path);
+
+error_t mqttClientGetQueueStatus(MqttClientContext *context,
+   uint_t *count, size_t *freeSpace);
+
 error_t mqttClientConnect(MqttClientContext *context,
    const IpAddr *serverIpAddr, uint16_t serverPort, bool_t cleanSession);
 
@@ -391,6 +587,8 @@ error_t mqttClientSubscribe(MqttClientContext *context,
 error_t mqttClientUnsubscribe(MqttClientContext *context,
    const char_t *topic, uint16_t *packetId);
 
+uint_t mqttClientGetInflightCount(MqttClientContext *context);
+
 error_t mqttClientPing(MqttClientContext *context, systime_t *rtt);
 
 error_t mqttClientTask(MqttClientContext *context, systime_t timeout);
@@ -37,6 +37,7 @@
 #include "mqtt/mqtt_client_packet.h"
 #include "mqtt/mqtt_client_transport.h"
 #include "mqtt/mqtt_client_misc.h"
+#include "mqtt/mqtt_client_queue.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -72,6 +73,22 @@ error_t mqttClientProcessEvents(MqttClientContext *context, systime_t timeout)
    //between control packets being sent does not exceed the keep-alive value
    error = mqttClientCheckKeepAlive(context);
 
+   //Check status code
+   if(!error)
+   {
+      //In-flight messages are retransmitted after the session is resumed
+      error = mqttClientCheckInflight(context);
+   }
+
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED)
+   //Check status code
+   if(!error)
+   {
+      //Queued messages are forwarded once the session is established
+      error = mqttClientCheckQueue(context);
+   }
+#endif
+
    //Check status code
    if(!error)
    {
@@ -206,6 +223,415 @@ error_t mqttClientCheckKeepAlive(MqttClientContext *context)
 }
 
 
+/**
+ * @brief Retransmit pending in-flight messages
+ * @param[in] context Pointer to the MQTT client context
+ * @return Error code
+ **/
+
+error_t mqttClientCheckInflight(MqttClientContext *context)
+{
+   error_t error;
+   uint_t i;
+   MqttClientInflightEntry *entry;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Retransmissions are only interleaved between other packet exchanges
+   if(context->state == MQTT_CLIENT_STATE_IDLE &&
+      context->packetType == MQTT_PACKET_TYPE_INVALID)
+   {
+      //Initialize pointer
+      entry = NULL;
+
+      //The client must resend PUBLISH packets in the order in which the
+      //original PUBLISH packets were sent
+      for(i = 0; i < MQTT_CLIENT_MAX_INFLIGHT; i++)
+      {
+         //Pending retransmission?
+         if(context->inflight[i].state != MQTT_INFLIGHT_STATE_NONE &&
+            context->inflight[i].retransmit)
+         {
+            //Keep track of the oldest message
+            if(entry == NULL || (int32_t) (context->inflight[i].seqNum -
+               entry->seqNum) < 0)
+            {
+               entry = &context->inflight[i];
+            }
+         }
+      }
+
+      //Any message to retransmit?
+      if(entry != NULL)
+      {
+         //The message is retransmitted only once per connection
+         entry->retransmit = FALSE;
+
+         //Check the state of the QoS protocol exchange
+         if(entry->state == MQTT_INFLIGHT_STATE_WAIT_PUBCOMP)
+         {
+            //The PUBLISH packet has already been acknowledged, so the
+            //PUBREL packet is resent instead
+            error = mqttClientFormatPubRel(context, entry->packetId);
+
+            //Check status code
+            if(!error)
+            {
+               //Debug message
+               TRACE_INFO("MQTT: Resending PUBREL packet (%" PRIuSIZE " bytes)...\r\n",
+                  context->packetLen);
+            }
+         }
+         else if(context->settings.version == MQTT_VERSION_5_0)
+         {
+            //Topic aliases only live as long as the network connection, so
+            //the PUBLISH packet is rebuilt with the full topic name
+            error = mqttClientFormatStoredPublish(context, entry->packet,
+               entry->length);
+
+            //Check status code
+            if(!error)
+            {
+               //Debug message
+               TRACE_INFO("MQTT: Resending PUBLISH packet (%" PRIuSIZE " bytes)...\r\n",
+                  context->packetLen);
+            }
+         }
+         else
+         {
+            //Copy the PUBLISH packet to the internal buffer
+            memcpy(context->buffer, entry->packet, entry->length);
+
+            //Point to the first byte of the MQTT packet
+            context->packet = context->buffer;
+            context->packetLen = entry->length;
+
+            //The DUP flag must be set when the client attempts to re-deliver
+            //a PUBLISH packet
+            ((MqttPacketHeader *) context->packet)->dup = TRUE;
+
+            //Debug message
+            TRACE_INFO("MQTT: Resending PUBLISH packet (%" PRIuSIZE " bytes)...\r\n",
+               context->packetLen);
+         }
+
+         //Check status code
+         if(!error)
+         {
+            //Dump the contents of the packet
+            TRACE_DEBUG_ARRAY("  ", context->packet, context->packetLen);
+
+            //Point to the beginning of the packet
+            context->packetPos = 0;
+
+            //Send the packet
+            mqttClientChangeState(context, MQTT_CLIENT_STATE_SENDING_PACKET);
+         }
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Generate a new packet identifier
+ * @param[in] context Pointer to the MQTT client context
+ * @return Packet identifier
+ **/
+
+uint16_t mqttClientGeneratePacketId(MqttClientContext *context)
+{
+   //Each time a client sends a new packet it must assign it a currently
+   //unused non-zero packet identifier
+   do
+   {
+      context->packetId++;
+   } while(context->packetId == 0 ||
+      mqttClientFindInflightEntry(context, context->packetId) != NULL);
+
+   //Return the packet identifier
+   return context->packetId;
+}
+
+
+/**
+ * @brief Get a free entry in the in-flight window
+ * @param[in] context Pointer to the MQTT client context
+ * @return Pointer to the free entry (NULL if the window is full)
+ **/
+
+MqttClientInflightEntry *mqttClientAllocInflightEntry(MqttClientContext *context)
+{
+   uint_t i;
+   uint_t n;
+   MqttClientInflightEntry *entry;
+
+   //Initialize pointer
+   entry = NULL;
+
+   //Loop through the in-flight window
+   for(n = 0, i = 0; i < MQTT_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Check whether the current entry is free
+      if(context->inflight[i].state == MQTT_INFLIGHT_STATE_NONE)
+      {
+         if(entry == NULL)
+            entry = &context->inflight[i];
+      }
+      else
+      {
+         //Number of QoS 1 and QoS 2 messages that are not acknowledged
+         n++;
+      }
+   }
+
+   //The client must not exceed the Receive Maximum value advertised by
+   //the server (MQTT 5.0)
+   if(n >= context->serverReceiveMax)
+      entry = NULL;
+
+   //Return a pointer to the free entry
+   return entry;
+}
+
+
+/**
+ * @brief Search the in-flight window for a given packet identifier
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] packetId Packet identifier
+ * @return Pointer to the matching entry (NULL if not found)
+ **/
+
+MqttClientInflightEntry *mqttClientFindInflightEntry(MqttClientContext *context,
+   uint16_t packetId)
+{
+   uint_t i;
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Matching entry?
+      if(context->inflight[i].state != MQTT_INFLIGHT_STATE_NONE &&
+         context->inflight[i].packetId == packetId)
+      {
+         return &context->inflight[i];
+      }
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+
+/**
+ * @brief Add the PUBLISH packet that has just been formatted to the window
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] entry Free entry of the in-flight window
+ * @param[in] qos QoS level of the message
+ **/
+
+void mqttClientAddInflightEntry(MqttClientContext *context,
+   MqttClientInflightEntry *entry, MqttQosLevel qos)
+{
+   //Save the packet identifier
+   entry->packetId = context->packetId;
+   entry->seqNum = ++context->inflightSeqNum;
+   entry->retransmit = FALSE;
+
+   //Wait for the acknowledgment from the server
+   if(qos == MQTT_QOS_LEVEL_1)
+      entry->state = MQTT_INFLIGHT_STATE_WAIT_PUBACK;
+   else
+      entry->state = MQTT_INFLIGHT_STATE_WAIT_PUBREC;
+
+   //Keep a copy of the packet so that it can be retransmitted if the
+   //connection is lost before the exchange completes
+   if(context->packetLen <= MQTT_CLIENT_INFLIGHT_BUFFER_SIZE)
+   {
+      memcpy(entry->packet, context->packet, context->packetLen);
+      entry->length = context->packetLen;
+   }
+   else
+   {
+      //The packet is too large to be stored
+      entry->length = 0;
+   }
+}
+
+
+/**
+ * @brief Release an in-flight message once the QoS exchange is complete
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] entry Pointer to the in-flight entry
+ **/
+
+void mqttClientCompleteInflightEntry(MqttClientContext *context,
+   MqttClientInflightEntry *entry)
+{
+   uint16_t packetId;
+
+   //Save the packet identifier
+   packetId = entry->packetId;
+
+   //Release the entry
+   entry->state = MQTT_INFLIGHT_STATE_NONE;
+
+   //Any registered callback?
+   if(context->callbacks.publishCompleteCallback != NULL)
+   {
+      //Invoke user callback function
+      context->callbacks.publishCompleteCallback(context, packetId);
+   }
+}
+
+
+/**
+ * @brief Discard all in-flight messages
+ * @param[in] context Pointer to the MQTT client context
+ **/
+
+void mqttClientFlushInflight(MqttClientContext *context)
+{
+   uint_t i;
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Release current entry
+      context->inflight[i].state = MQTT_INFLIGHT_STATE_NONE;
+   }
+}
+
+
+/**
+ * @brief Schedule the retransmission of all in-flight messages
+ * @param[in] context Pointer to the MQTT client context
+ **/
+
+void mqttClientRetransmitInflight(MqttClientContext *context)
+{
+   uint_t i;
+   MqttClientInflightEntry *entry;
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Point to the current entry
+      entry = &context->inflight[i];
+
+      //PUBREL packets can always be rebuilt, whereas PUBLISH packets can only
+      //be resent if a copy has been kept
+      if(entry->state == MQTT_INFLIGHT_STATE_WAIT_PUBCOMP)
+      {
+         entry->retransmit = TRUE;
+      }
+      else if(entry->state != MQTT_INFLIGHT_STATE_NONE)
+      {
+         //Check whether the PUBLISH packet has been stored
+         if(entry->length > 0)
+         {
+            entry->retransmit = TRUE;
+         }
+         else
+         {
+            //Debug message
+            TRACE_WARNING("MQTT: Cannot retransmit message %" PRIu16 "\r\n",
+               entry->packetId);
+
+            //The message is lost
+            entry->state = MQTT_INFLIGHT_STATE_NONE;
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Restore the default values of the parameters set by the server
+ * @param[in] context Pointer to the MQTT client context
+ **/
+
+void mqttClientResetServerSettings(MqttClientContext *context)
+{
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   uint_t i;
+#endif
+
+   //Default values that apply when the server does not send the
+   //corresponding property (or uses MQTT 3.1.1)
+   context->serverReceiveMax = 65535;
+   context->serverMaxPacketSize = 0;
+   context->serverTopicAliasMax = 0;
+
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   //Topic aliases only live as long as the network connection
+   for(i = 0; i < MQTT_CLIENT_TOPIC_ALIAS_MAX; i++)
+   {
+      //The binding between an alias and its topic name is kept on the
+      //client side, but must be sent again to the server
+      context->txTopicAlias[i].established = FALSE;
+      //Aliases defined by the server are discarded
+      context->rxTopicAlias[i].topic[0] = '\0';
+   }
+#endif
+}
+
+
+/**
+ * @brief Get the topic alias to be used for a given topic name
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] topic Topic name
+ * @return Topic alias (0 if no alias can be used)
+ **/
+
+uint16_t mqttClientGetTopicAlias(MqttClientContext *context,
+   const char_t *topic)
+{
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   uint_t i;
+   uint_t n;
+
+   //Topic aliases are only available with MQTT 5.0
+   if(context->settings.version != MQTT_VERSION_5_0)
+      return 0;
+
+   //The server limits the number of aliases the client can use
+   n = MIN(context->serverTopicAliasMax, MQTT_CLIENT_TOPIC_ALIAS_MAX);
+
+   //Make sure the topic name can be stored
+   if(strlen(topic) > MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN)
+      return 0;
+
+   //Loop through the topic aliases
+   for(i = 0; i < n; i++)
+   {
+      //Free alias?
+      if(context->txTopicAlias[i].topic[0] == '\0')
+      {
+         //Bind the alias to the topic name. Aliases are never reassigned, so
+         //that stored PUBLISH packets can always be resolved
+         strcpy(context->txTopicAlias[i].topic, topic);
+         context->txTopicAlias[i].established = FALSE;
+         break;
+      }
+
+      //Matching topic name?
+      if(!strcmp(context->txTopicAlias[i].topic, topic))
+         break;
+   }
+
+   //Return the topic alias (aliases are numbered from 1)
+   return (i < n) ? (uint16_t) (i + 1) : 0;
+#else
+   //Topic aliases are not supported
+   return 0;
+#endif
+}
+
+
 /**
  * @brief Serialize fixed header
  * @param[in] buffer Pointer to the output buffer
@@ -343,6 +769,79 @@ error_t mqttSerializeShort(uint8_t *buffer, size_t bufferLen,
 }
 
 
+/**
+ * @brief Write a 32-bit integer to the output buffer
+ * @param[in] buffer Pointer to the output buffer
+ * @param[in] bufferLen Maximum number of bytes the output buffer can hold
+ * @param[in,out] pos Current position
+ * @param[in] value 32-bit integer to be serialized
+ * @return Error code
+ **/
+
+error_t mqttSerializeInt(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, uint32_t value)
+{
+   size_t n;
+
+   //Point to the current position
+   n = *pos;
+
+   //Make sure the output buffer is large enough
+   if((n + sizeof(uint32_t)) > bufferLen)
+      return ERROR_BUFFER_OVERFLOW;
+
+   //Write the integer to the output buffer
+   STORE32BE(value, buffer + n);
+
+   //Advance current position
+   *pos = n + sizeof(uint32_t);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Write a variable byte integer to the output buffer
+ * @param[in] buffer Pointer to the output buffer
+ * @param[in] bufferLen Maximum number of bytes the output buffer can hold
+ * @param[in,out] pos Current position
+ * @param[in] value Integer to be serialized
+ * @return Error code
+ **/
+
+error_t mqttSerializeVarInt(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, uint32_t value)
+{
+   size_t n;
+
+   //Point to the current position
+   n = *pos;
+
+   //Variable byte integers are limited to 4 bytes
+   if(value >= 268435456)
+      return ERROR_INVALID_LENGTH;
+
+   //Encode the integer using 7 bits per byte
+   do
+   {
+      //Make sure the output buffer is large enough
+      if(n >= bufferLen)
+         return ERROR_BUFFER_OVERFLOW;
+
+      //The most significant bit indicates that there are following bytes
+      buffer[n++] = (value & 0x7F) | ((value > 0x7F) ? 0x80 : 0x00);
+      value >>= 7;
+   } while(value > 0);
+
+   //Advance current position
+   *pos = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Serialize string
  * @param[in] buffer Pointer to the output buffer
@@ -559,6 +1058,199 @@ error_t mqttDeserializeShort(uint8_t *buffer, size_t bufferLen,
 }
 
 
+/**
+ * @brief Read a variable byte integer from the input buffer
+ * @param[in] buffer Pointer to the input buffer
+ * @param[in] bufferLen Length of the input buffer
+ * @param[in,out] pos Current position
+ * @param[out] value Value of the integer
+ * @return Error code
+ **/
+
+error_t mqttDeserializeVarInt(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, uint32_t *value)
+{
+   uint_t i;
+   size_t n;
+
+   //Point to the current position
+   n = *pos;
+
+   //Decode the integer
+   for(*value = 0, i = 0; i < 4; i++)
+   {
+      //Make sure the input buffer is large enough
+      if(n >= bufferLen)
+         return ERROR_BUFFER_OVERFLOW;
+
+      //The least significant seven bits of each byte encode the data
+      *value |= (uint32_t) (buffer[n] & 0x7F) << (7 * i);
+
+      //Last byte?
+      if((buffer[n++] & 0x80) == 0)
+         break;
+   }
+
+   //Malformed variable byte integer?
+   if(i >= 4)
+      return ERROR_INVALID_SYNTAX;
+
+   //Advance current position
+   *pos = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read a property from the input buffer (MQTT 5.0)
+ * @param[in] buffer Pointer to the input buffer
+ * @param[in] bufferLen Position of the end of the property list
+ * @param[in,out] pos Current position
+ * @param[out] property Decoded property
+ * @return Error code
+ **/
+
+error_t mqttDeserializeProperty(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, MqttProperty *property)
+{
+   error_t error;
+   uint32_t id;
+   size_t n;
+   size_t length;
+
+   //The property starts with its identifier
+   error = mqttDeserializeVarInt(buffer, bufferLen, pos, &id);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Point to the current position
+   n = *pos;
+
+   //Save the property identifier
+   property->id = (uint8_t) id;
+   property->value = 0;
+   property->data = NULL;
+   property->length = 0;
+
+   //The data type depends on the property
+   switch(id)
+   {
+   //Byte properties
+   case MQTT_PROPERTY_PAYLOAD_FORMAT_INDICATOR:
+   case MQTT_PROPERTY_REQUEST_PROBLEM_INFORMATION:
+   case MQTT_PROPERTY_REQUEST_RESPONSE_INFORMATION:
+   case MQTT_PROPERTY_MAXIMUM_QOS:
+   case MQTT_PROPERTY_RETAIN_AVAILABLE:
+   case MQTT_PROPERTY_WILDCARD_SUBSCRIPTION_AVAILABLE:
+   case MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER_AVAILABLE:
+   case MQTT_PROPERTY_SHARED_SUBSCRIPTION_AVAILABLE:
+      //Malformed property?
+      if((n + sizeof(uint8_t)) > bufferLen)
+         return ERROR_INVALID_LENGTH;
+
+      //Read the value of the property
+      property->value = buffer[n];
+      n += sizeof(uint8_t);
+      break;
+
+   //Two byte integer properties
+   case MQTT_PROPERTY_SERVER_KEEP_ALIVE:
+   case MQTT_PROPERTY_RECEIVE_MAXIMUM:
+   case MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM:
+   case MQTT_PROPERTY_TOPIC_ALIAS:
+      //Malformed property?
+      if((n + sizeof(uint16_t)) > bufferLen)
+         return ERROR_INVALID_LENGTH;
+
+      //Read the value of the property
+      property->value = LOAD16BE(buffer + n);
+      n += sizeof(uint16_t);
+      break;
+
+   //Four byte integer properties
+   case MQTT_PROPERTY_MESSAGE_EXPIRY_INTERVAL:
+   case MQTT_PROPERTY_SESSION_EXPIRY_INTERVAL:
+   case MQTT_PROPERTY_WILL_DELAY_INTERVAL:
+   case MQTT_PROPERTY_MAXIMUM_PACKET_SIZE:
+      //Malformed property?
+      if((n + sizeof(uint32_t)) > bufferLen)
+         return ERROR_INVALID_LENGTH;
+
+      //Read the value of the property
+      property->value = LOAD32BE(buffer + n);
+      n += sizeof(uint32_t);
+      break;
+
+   //Variable byte integer properties
+   case MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER:
+      //Read the value of the property
+      error = mqttDeserializeVarInt(buffer, bufferLen, &n, &property->value);
+      break;
+
+   //UTF-8 string and binary data properties
+   case MQTT_PROPERTY_CONTENT_TYPE:
+   case MQTT_PROPERTY_RESPONSE_TOPIC:
+   case MQTT_PROPERTY_CORRELATION_DATA:
+   case MQTT_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER:
+   case MQTT_PROPERTY_AUTHENTICATION_METHOD:
+   case MQTT_PROPERTY_AUTHENTICATION_DATA:
+   case MQTT_PROPERTY_RESPONSE_INFORMATION:
+   case MQTT_PROPERTY_SERVER_REFERENCE:
+   case MQTT_PROPERTY_REASON_STRING:
+   //UTF-8 string pair property (only the name is returned)
+   case MQTT_PROPERTY_USER_PROPERTY:
+      //Malformed property?
+      if((n + sizeof(uint16_t)) > bufferLen)
+         return ERROR_INVALID_LENGTH;
+
+      //Decode the length field
+      length = LOAD16BE(buffer + n);
+      n += sizeof(uint16_t);
+
+      //Malformed property?
+      if((n + length) > bufferLen)
+         return ERROR_INVALID_LENGTH;
+
+      //Point to the string or binary data
+      property->data = buffer + n;
+      property->length = length;
+      n += length;
+
+      //A user property is a name/value pair
+      if(id == MQTT_PROPERTY_USER_PROPERTY)
+      {
+         //Malformed property?
+         if((n + sizeof(uint16_t)) > bufferLen)
+            return ERROR_INVALID_LENGTH;
+
+         //Skip the value
+         length = LOAD16BE(buffer + n);
+         n += sizeof(uint16_t) + length;
+
+         //Malformed property?
+         if(n > bufferLen)
+            return ERROR_INVALID_LENGTH;
+      }
+      break;
+
+   //Unknown property?
+   default:
+      //The receiver cannot determine the length of the property
+      error = ERROR_INVALID_SYNTAX;
+      break;
+   }
+
+   //Advance current position
+   *pos = n;
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Deserialize string
  * @param[in] buffer Pointer to the input buffer
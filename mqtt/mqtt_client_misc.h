@@ -44,6 +44,28 @@ extern "C" {
 void mqttClientChangeState(MqttClientContext *context, MqttClientState newState);
 error_t mqttClientProcessEvents(MqttClientContext *context, systime_t timeout);
 error_t mqttClientCheckKeepAlive(MqttClientContext *context);
+error_t mqttClientCheckInflight(MqttClientContext *context);
+
+uint16_t mqttClientGeneratePacketId(MqttClientContext *context);
+
+MqttClientInflightEntry *mqttClientAllocInflightEntry(MqttClientContext *context);
+
+MqttClientInflightEntry *mqttClientFindInflightEntry(MqttClientContext *context,
+   uint16_t packetId);
+
+void mqttClientAddInflightEntry(MqttClientContext *context,
+   MqttClientInflightEntry *entry, MqttQosLevel qos);
+
+void mqttClientCompleteInflightEntry(MqttClientContext *context,
+   MqttClientInflightEntry *entry);
+
+void mqttClientFlushInflight(MqttClientContext *context);
+void mqttClientRetransmitInflight(MqttClientContext *context);
+
+void mqttClientResetServerSettings(MqttClientContext *context);
+
+uint16_t mqttClientGetTopicAlias(MqttClientContext *context,
+   const char_t *topic);
 
 error_t mqttSerializeHeader(uint8_t *buffer, size_t *pos, MqttPacketType type,
    bool_t dup, MqttQosLevel qos, bool_t retain, size_t remainingLen);
@@ -54,6 +76,12 @@ error_t mqttSerializeByte(uint8_t *buffer, size_t bufferLen,
 error_t mqttSerializeShort(uint8_t *buffer, size_t bufferLen,
    size_t *pos, uint16_t value);
 
+error_t mqttSerializeInt(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, uint32_t value);
+
+error_t mqttSerializeVarInt(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, uint32_t value);
+
 error_t mqttSerializeString(uint8_t *buffer, size_t bufferLen,
    size_t *pos, const void *string, size_t stringLen);
 
@@ -69,6 +97,12 @@ error_t mqttDeserializeByte(uint8_t *buffer, size_t bufferLen,
 error_t mqttDeserializeShort(uint8_t *buffer, size_t bufferLen,
    size_t *pos, uint16_t *value);
 
+error_t mqttDeserializeVarInt(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, uint32_t *value);
+
+error_t mqttDeserializeProperty(uint8_t *buffer, size_t bufferLen,
+   size_t *pos, MqttProperty *property);
+
 error_t mqttDeserializeString(uint8_t *buffer, size_t bufferLen,
    size_t *pos, char_t **string, size_t *stringLen);
 
@@ -37,6 +37,7 @@
 #include "mqtt/mqtt_client_packet.h"
 #include "mqtt/mqtt_client_transport.h"
 #include "mqtt/mqtt_client_misc.h"
+#include "mqtt/mqtt_client_topic.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -60,7 +61,7 @@ static const char_t *packetLabel[16] =
    "PINGREQ",     //12
    "PINGRESP",    //13
    "DISCONNECT",  //14
-   "Reserved"     //15
+   "AUTH"         //15
 };
 
 
@@ -241,6 +242,11 @@ error_t mqttClientProcessPacket(MqttClientContext *context)
       //Process incoming PINGRESP packet
       error = mqttClientProcessPingResp(context, dup, qos, retain, remainingLen);
       break;
+   //DISCONNECT packet received?
+   case MQTT_PACKET_TYPE_DISCONNECT:
+      //Process incoming DISCONNECT packet
+      error = mqttClientProcessDisconnect(context, dup, qos, retain, remainingLen);
+      break;
    //Unknown packet received?
    default:
       //Report an error
@@ -288,6 +294,18 @@ error_t mqttClientProcessConnAck(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the server reports its capabilities using properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //Parse the list of properties
+      error = mqttClientParseProperties(context, MQTT_PACKET_TYPE_CONNACK,
+         NULL);
+
+      //Malformed packet?
+      if(error)
+         return error;
+   }
+
    //Any registered callback?
    if(context->callbacks.connAckCallback != NULL)
    {
@@ -327,6 +345,8 @@ error_t mqttClientProcessPublish(MqttClientContext *context,
    size_t topicLen;
    uint8_t *message;
    size_t messageLen;
+   uint16_t topicAlias;
+   uint_t n;
 
    //The Topic Name must be present as the first field in the PUBLISH
    //packet variable header
@@ -355,6 +375,21 @@ error_t mqttClientProcessPublish(MqttClientContext *context,
       packetId = 0;
    }
 
+   //No topic alias
+   topicAlias = 0;
+
+   //With MQTT 5.0, the variable header ends with a list of properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //Parse the list of properties
+      error = mqttClientParseProperties(context, MQTT_PACKET_TYPE_PUBLISH,
+         &topicAlias);
+
+      //Malformed packet?
+      if(error)
+         return error;
+   }
+
    //The payload contains the Application Message that is being published
    message = context->packet + context->packetPos;
 
@@ -364,13 +399,55 @@ error_t mqttClientProcessPublish(MqttClientContext *context,
 
    //Make room for the NULL character at the end of the Topic Name
    memmove(topic - 1, topic, topicLen);
-   //Properly terminate the string with a NULL character
-   topic[topicLen - 1] = '\0';
    //Point to the first character of the Topic Name
    topic--;
+   //Properly terminate the string with a NULL character
+   topic[topicLen] = '\0';
 
-   //Any registered callback?
-   if(context->callbacks.publishCallback != NULL)
+   //A topic alias can be used to reduce the size of the PUBLISH packet
+   if(topicAlias != 0)
+   {
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+      //The value must not exceed the Topic Alias Maximum sent by the client
+      if(topicAlias > MQTT_CLIENT_TOPIC_ALIAS_MAX)
+         return ERROR_INVALID_PACKET;
+
+      //Check whether the Topic Name is present
+      if(topicLen > 0)
+      {
+         //Make sure the Topic Name can be stored
+         if(topicLen > MQTT_CLIENT_MAX_TOPIC_ALIAS_LEN)
+            return ERROR_INVALID_LENGTH;
+
+         //The server binds the alias to the Topic Name
+         strcpy(context->rxTopicAlias[topicAlias - 1].topic, topic);
+      }
+      else
+      {
+         //The alias must have been defined by a previous PUBLISH packet
+         if(context->rxTopicAlias[topicAlias - 1].topic[0] == '\0')
+            return ERROR_INVALID_PACKET;
+
+         //Retrieve the Topic Name
+         topic = context->rxTopicAlias[topicAlias - 1].topic;
+      }
+#else
+      //The client does not accept any topic alias
+      return ERROR_INVALID_PACKET;
+#endif
+   }
+
+#if (MQTT_CLIENT_TOPIC_TRIE_SUPPORT == ENABLED)
+   //Invoke the handlers whose topic filter matches the topic name
+   n = mqttClientDispatchPublish(context, topic, message, messageLen,
+      dup, qos, retain, packetId);
+#else
+   //No topic filter handlers
+   n = 0;
+#endif
+
+   //The publish callback receives the messages that no handler claimed
+   if(n == 0 && context->callbacks.publishCallback != NULL)
    {
       //Invoke user callback function
       context->callbacks.publishCallback(context, topic,
@@ -437,6 +514,8 @@ error_t mqttClientProcessPubAck(MqttClientContext *context,
 {
    error_t error;
    uint16_t packetId;
+   uint8_t reasonCode;
+   MqttClientInflightEntry *entry;
 
    //If invalid flags are received, the receiver must close the network connection
    if(dup != FALSE && qos != MQTT_QOS_LEVEL_0 && retain != FALSE)
@@ -451,6 +530,20 @@ error_t mqttClientProcessPubAck(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the packet may carry a reason code
+   error = mqttClientParseReasonCode(context, &reasonCode);
+   //Failed to deserialize Reason Code field?
+   if(error)
+      return error;
+
+   //The server may refuse to deliver the message
+   if(reasonCode >= MQTT_REASON_CODE_UNSPECIFIED_ERROR)
+   {
+      //Debug message
+      TRACE_WARNING("MQTT: PUBLISH packet %" PRIu16 " rejected (reason code 0x%02" PRIX8 ")\r\n",
+         packetId, reasonCode);
+   }
+
    //Any registered callback?
    if(context->callbacks.pubAckCallback != NULL)
    {
@@ -458,6 +551,13 @@ error_t mqttClientProcessPubAck(MqttClientContext *context,
       context->callbacks.pubAckCallback(context, packetId);
    }
 
+   //Search the in-flight window for the matching PUBLISH packet
+   entry = mqttClientFindInflightEntry(context, packetId);
+
+   //The PUBACK packet completes the QoS 1 protocol exchange
+   if(entry != NULL && entry->state == MQTT_INFLIGHT_STATE_WAIT_PUBACK)
+      mqttClientCompleteInflightEntry(context, entry);
+
    //Notify the application that a PUBACK packet has been received
    if(context->packetType == MQTT_PACKET_TYPE_PUBLISH && context->packetId == packetId)
       mqttClientChangeState(context, MQTT_CLIENT_STATE_PACKET_RECEIVED);
@@ -481,6 +581,8 @@ error_t mqttClientProcessPubRec(MqttClientContext *context,
 {
    error_t error;
    uint16_t packetId;
+   uint8_t reasonCode;
+   MqttClientInflightEntry *entry;
 
    //If invalid flags are received, the receiver must close the network connection
    if(dup != FALSE && qos != MQTT_QOS_LEVEL_0 && retain != FALSE)
@@ -495,6 +597,12 @@ error_t mqttClientProcessPubRec(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the packet may carry a reason code
+   error = mqttClientParseReasonCode(context, &reasonCode);
+   //Failed to deserialize Reason Code field?
+   if(error)
+      return error;
+
    //Any registered callback?
    if(context->callbacks.pubRecCallback != NULL)
    {
@@ -502,6 +610,37 @@ error_t mqttClientProcessPubRec(MqttClientContext *context,
       context->callbacks.pubRecCallback(context, packetId);
    }
 
+   //Search the in-flight window for the matching PUBLISH packet
+   entry = mqttClientFindInflightEntry(context, packetId);
+
+   //A PUBREC packet with a reason code of 0x80 or greater ends the QoS 2
+   //protocol exchange (MQTT 5.0)
+   if(reasonCode >= MQTT_REASON_CODE_UNSPECIFIED_ERROR)
+   {
+      //Debug message
+      TRACE_WARNING("MQTT: PUBLISH packet %" PRIu16 " rejected (reason code 0x%02" PRIX8 ")\r\n",
+         packetId, reasonCode);
+
+      //The message will not be delivered
+      if(entry != NULL && entry->state == MQTT_INFLIGHT_STATE_WAIT_PUBREC)
+         mqttClientCompleteInflightEntry(context, entry);
+
+      //No PUBREL packet is sent in response
+      if(context->packetType == MQTT_PACKET_TYPE_PUBLISH && context->packetId == packetId)
+         mqttClientChangeState(context, MQTT_CLIENT_STATE_PACKET_RECEIVED);
+
+      //Successful processing
+      return NO_ERROR;
+   }
+
+   //The PUBLISH packet must not be retransmitted once a PUBREC packet has
+   //been received
+   if(entry != NULL && entry->state == MQTT_INFLIGHT_STATE_WAIT_PUBREC)
+   {
+      entry->state = MQTT_INFLIGHT_STATE_WAIT_PUBCOMP;
+      entry->length = 0;
+   }
+
    //A PUBREL packet is the response to a PUBREC packet. It is the third
    //packet of the QoS 2 protocol exchange
    error = mqttClientFormatPubRel(context, packetId);
@@ -597,6 +736,8 @@ error_t mqttClientProcessPubComp(MqttClientContext *context,
 {
    error_t error;
    uint16_t packetId;
+   uint8_t reasonCode;
+   MqttClientInflightEntry *entry;
 
    //If invalid flags are received, the receiver must close the network connection
    if(dup != FALSE && qos != MQTT_QOS_LEVEL_0 && retain != FALSE)
@@ -611,6 +752,20 @@ error_t mqttClientProcessPubComp(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the packet may carry a reason code
+   error = mqttClientParseReasonCode(context, &reasonCode);
+   //Failed to deserialize Reason Code field?
+   if(error)
+      return error;
+
+   //The server may have lost the state of the QoS 2 protocol exchange
+   if(reasonCode >= MQTT_REASON_CODE_UNSPECIFIED_ERROR)
+   {
+      //Debug message
+      TRACE_WARNING("MQTT: PUBREL packet %" PRIu16 " rejected (reason code 0x%02" PRIX8 ")\r\n",
+         packetId, reasonCode);
+   }
+
    //Any registered callback?
    if(context->callbacks.pubCompCallback != NULL)
    {
@@ -618,6 +773,13 @@ error_t mqttClientProcessPubComp(MqttClientContext *context,
       context->callbacks.pubCompCallback(context, packetId);
    }
 
+   //Search the in-flight window for the matching PUBREL packet
+   entry = mqttClientFindInflightEntry(context, packetId);
+
+   //The PUBCOMP packet completes the QoS 2 protocol exchange
+   if(entry != NULL && entry->state == MQTT_INFLIGHT_STATE_WAIT_PUBCOMP)
+      mqttClientCompleteInflightEntry(context, entry);
+
    //Notify the application that a PUBCOMP packet has been received
    if(context->packetType == MQTT_PACKET_TYPE_PUBLISH && context->packetId == packetId)
       mqttClientChangeState(context, MQTT_CLIENT_STATE_PACKET_RECEIVED);
@@ -641,6 +803,7 @@ error_t mqttClientProcessSubAck(MqttClientContext *context,
 {
    error_t error;
    uint16_t packetId;
+   uint8_t reasonCode;
 
    //If invalid flags are received, the receiver must close the network connection
    if(dup != FALSE && qos != MQTT_QOS_LEVEL_0 && retain != FALSE)
@@ -655,6 +818,38 @@ error_t mqttClientProcessSubAck(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the variable header ends with a list of properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //Parse the list of properties
+      error = mqttClientParseProperties(context, MQTT_PACKET_TYPE_SUBACK,
+         NULL);
+
+      //Malformed packet?
+      if(error)
+         return error;
+   }
+
+   //The payload contains a return code for the topic filter
+   if(context->packetPos < context->packetLen)
+   {
+      //Read the return code
+      error = mqttDeserializeByte(context->packet, context->packetLen,
+         &context->packetPos, &reasonCode);
+
+      //Failed to deserialize return code?
+      if(error)
+         return error;
+
+      //A value of 0x80 or greater indicates failure
+      if(reasonCode >= MQTT_REASON_CODE_UNSPECIFIED_ERROR)
+      {
+         //Debug message
+         TRACE_WARNING("MQTT: Subscription refused (reason code 0x%02" PRIX8 ")\r\n",
+            reasonCode);
+      }
+   }
+
    //Any registered callback?
    if(context->callbacks.subAckCallback != NULL)
    {
@@ -685,6 +880,7 @@ error_t mqttClientProcessUnsubAck(MqttClientContext *context,
 {
    error_t error;
    uint16_t packetId;
+   uint8_t reasonCode;
 
    //If invalid flags are received, the receiver must close the network connection
    if(dup != FALSE && qos != MQTT_QOS_LEVEL_0 && retain != FALSE)
@@ -699,6 +895,34 @@ error_t mqttClientProcessUnsubAck(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the UNSUBACK packet carries properties and reason codes
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //Parse the list of properties
+      error = mqttClientParseProperties(context, MQTT_PACKET_TYPE_UNSUBACK,
+         NULL);
+
+      //Malformed packet?
+      if(error)
+         return error;
+
+      //Read the reason code for the topic filter
+      error = mqttDeserializeByte(context->packet, context->packetLen,
+         &context->packetPos, &reasonCode);
+
+      //Failed to deserialize Reason Code field?
+      if(error)
+         return error;
+
+      //A value of 0x80 or greater indicates failure
+      if(reasonCode >= MQTT_REASON_CODE_UNSPECIFIED_ERROR)
+      {
+         //Debug message
+         TRACE_WARNING("MQTT: Unsubscription refused (reason code 0x%02" PRIX8 ")\r\n",
+            reasonCode);
+      }
+   }
+
    //Any registered callback?
    if(context->callbacks.unsubAckCallback != NULL)
    {
@@ -747,6 +971,212 @@ error_t mqttClientProcessPingResp(MqttClientContext *context,
 }
 
 
+/**
+ * @brief Process incoming DISCONNECT packet (MQTT 5.0)
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] dup DUP flag from the fixed header
+ * @param[in] qos QoS field from the fixed header
+ * @param[in] retain RETAIN flag from the fixed header
+ * @param[in] remainingLen Length of the variable header and the payload
+ **/
+
+error_t mqttClientProcessDisconnect(MqttClientContext *context,
+   bool_t dup, MqttQosLevel qos, bool_t retain, size_t remainingLen)
+{
+   error_t error;
+   uint8_t reasonCode;
+
+   //If invalid flags are received, the receiver must close the network connection
+   if(dup != FALSE && qos != MQTT_QOS_LEVEL_0 && retain != FALSE)
+      return ERROR_INVALID_PACKET;
+
+   //A server is only allowed to send a DISCONNECT packet with MQTT 5.0
+   if(context->settings.version != MQTT_VERSION_5_0)
+      return ERROR_INVALID_PACKET;
+
+   //The Reason Code may be omitted if its value is 0x00
+   error = mqttClientParseReasonCode(context, &reasonCode);
+
+   //Failed to deserialize the Reason Code?
+   if(error)
+      return error;
+
+   //Debug message
+   TRACE_WARNING("MQTT: Server closed the connection (reason code 0x%02" PRIX8 ")\r\n",
+      reasonCode);
+
+   //The server is about to close the network connection
+   return ERROR_CONNECTION_CLOSING;
+}
+
+
+/**
+ * @brief Parse the Reason Code of an acknowledgment packet
+ * @param[in] context Pointer to the MQTT client context
+ * @param[out] reasonCode Reason Code (0x00 if not present)
+ * @return Error code
+ **/
+
+error_t mqttClientParseReasonCode(MqttClientContext *context,
+   uint8_t *reasonCode)
+{
+   error_t error;
+
+   //Prior to MQTT 5.0, acknowledgment packets do not carry any reason code
+   *reasonCode = MQTT_REASON_CODE_SUCCESS;
+
+   //The Reason Code and the properties can be omitted if the Reason Code
+   //is 0x00 and there are no properties
+   if(context->settings.version == MQTT_VERSION_5_0 &&
+      context->packetPos < context->packetLen)
+   {
+      //Read the Reason Code
+      error = mqttDeserializeByte(context->packet, context->packetLen,
+         &context->packetPos, reasonCode);
+
+      //Failed to deserialize the Reason Code?
+      if(error)
+         return error;
+
+      //The property length is omitted if there are no properties
+      if(context->packetPos < context->packetLen)
+      {
+         //Parse the list of properties
+         error = mqttClientParseProperties(context, MQTT_PACKET_TYPE_INVALID,
+            NULL);
+
+         //Malformed packet?
+         if(error)
+            return error;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse the list of properties of an incoming packet (MQTT 5.0)
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] type Type of the packet that carries the properties
+ * @param[out] topicAlias Topic Alias property (PUBLISH packets only)
+ * @return Error code
+ **/
+
+error_t mqttClientParseProperties(MqttClientContext *context,
+   MqttPacketType type, uint16_t *topicAlias)
+{
+   error_t error;
+   uint32_t length;
+   size_t end;
+   MqttProperty property;
+
+   //No topic alias by default
+   if(topicAlias != NULL)
+      *topicAlias = 0;
+
+   //The list of properties is preceded by its length
+   error = mqttDeserializeVarInt(context->packet, context->packetLen,
+      &context->packetPos, &length);
+
+   //Failed to deserialize the Property Length field?
+   if(error)
+      return error;
+
+   //Malformed packet?
+   if(length > (context->packetLen - context->packetPos))
+      return ERROR_INVALID_LENGTH;
+
+   //Point to the end of the list
+   end = context->packetPos + length;
+
+   //Parse properties
+   while(context->packetPos < end)
+   {
+      //Read the next property
+      error = mqttDeserializeProperty(context->packet, end,
+         &context->packetPos, &property);
+
+      //Malformed property?
+      if(error)
+         return error;
+
+      //Check property identifier
+      if(property.id == MQTT_PROPERTY_REASON_STRING)
+      {
+         //Debug message
+         TRACE_DEBUG("MQTT: Reason string: %.*s\r\n", (int) property.length,
+            (const char_t *) property.data);
+      }
+      else if(type == MQTT_PACKET_TYPE_CONNACK)
+      {
+         //The server reports its capabilities in the CONNACK packet
+         if(property.id == MQTT_PROPERTY_RECEIVE_MAXIMUM)
+         {
+            //It is a protocol error to include the value 0
+            if(property.value == 0)
+               return ERROR_INVALID_PACKET;
+
+            //Limit the number of QoS 1 and QoS 2 publications in flight
+            context->serverReceiveMax = (uint16_t) property.value;
+         }
+         else if(property.id == MQTT_PROPERTY_MAXIMUM_PACKET_SIZE)
+         {
+            //It is a protocol error to include the value 0
+            if(property.value == 0)
+               return ERROR_INVALID_PACKET;
+
+            //Maximum packet size the server is willing to accept
+            context->serverMaxPacketSize = property.value;
+         }
+         else if(property.id == MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM)
+         {
+            //Highest value the server accepts as a topic alias
+            context->serverTopicAliasMax = (uint16_t) property.value;
+         }
+         else if(property.id == MQTT_PROPERTY_SERVER_KEEP_ALIVE)
+         {
+            //The client must use the keep-alive value assigned by the server
+            context->settings.keepAlive = (uint16_t) property.value;
+         }
+         else if(property.id == MQTT_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER)
+         {
+            //Save the client identifier assigned by the server
+            if(property.length <= MQTT_CLIENT_MAX_ID_LEN)
+            {
+               memcpy(context->settings.clientId, property.data,
+                  property.length);
+
+               //Properly terminate the string with a NULL character
+               context->settings.clientId[property.length] = '\0';
+            }
+         }
+      }
+      else if(type == MQTT_PACKET_TYPE_PUBLISH)
+      {
+         //Topic alias?
+         if(property.id == MQTT_PROPERTY_TOPIC_ALIAS && topicAlias != NULL)
+         {
+            //A Topic Alias of 0 is not permitted
+            if(property.value == 0)
+               return ERROR_INVALID_PACKET;
+
+            //Save the topic alias
+            *topicAlias = (uint16_t) property.value;
+         }
+      }
+      else
+      {
+         //Other properties are silently ignored
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Format CONNECT packet
  * @param[in] context Pointer to the MQTT client context
@@ -781,6 +1211,12 @@ error_t mqttClientFormatConnect(MqttClientContext *context,
       error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
          &n, MQTT_PROTOCOL_NAME_3_1_1, strlen(MQTT_PROTOCOL_NAME_3_1_1));
    }
+   else if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //MQTT 5.0 uses the same protocol name as MQTT 3.1.1
+      error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         &n, MQTT_PROTOCOL_NAME_5_0, strlen(MQTT_PROTOCOL_NAME_5_0));
+   }
    else
    {
       //Invalid protocol level
@@ -862,6 +1298,17 @@ error_t mqttClientFormatConnect(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the variable header ends with a list of properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //Write the properties to the output buffer
+      error = mqttClientFormatConnectProperties(context, &n, cleanSession);
+
+      //Failed to serialize properties?
+      if(error)
+         return error;
+   }
+
    //The Client Identifier identifies the client to the server. The Client
    //Identifier must be present and must be the first field in the CONNECT
    //packet payload
@@ -876,6 +1323,18 @@ error_t mqttClientFormatConnect(MqttClientContext *context,
    //the payload
    if(willMessage->topic[0] != '\0')
    {
+      //With MQTT 5.0, the Will Properties precede the Will Topic
+      if(context->settings.version == MQTT_VERSION_5_0)
+      {
+         //No Will Properties
+         error = mqttSerializeVarInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+            &n, 0);
+
+         //Failed to serialize data?
+         if(error)
+            return error;
+      }
+
       //Write the Will Topic to the output buffer
       error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
          &n, willMessage->topic, strlen(willMessage->topic));
@@ -941,6 +1400,92 @@ error_t mqttClientFormatConnect(MqttClientContext *context,
 }
 
 
+/**
+ * @brief Format the properties of the CONNECT packet (MQTT 5.0)
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in,out] pos Current position in the output buffer
+ * @param[in] cleanSession If this flag is set, then the client and server
+ *   must discard any previous session and start a new one
+ * @return Error code
+ **/
+
+error_t mqttClientFormatConnectProperties(MqttClientContext *context,
+   size_t *pos, bool_t cleanSession)
+{
+   error_t error;
+   uint32_t length;
+
+   //Calculate the length of the properties
+   length = 5;
+
+   //Persistent session?
+   if(!cleanSession)
+      length += 5;
+
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   //Topic aliases are accepted from the server
+   length += 3;
+#endif
+
+   //Write the Property Length field
+   error = mqttSerializeVarInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+      pos, length);
+
+   //Check status code
+   if(!error && !cleanSession)
+   {
+      //With MQTT 5.0, the session ends when the network connection is
+      //closed unless a Session Expiry Interval is specified. The maximum
+      //value means that the session does not expire
+      error = mqttSerializeByte(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         pos, MQTT_PROPERTY_SESSION_EXPIRY_INTERVAL);
+
+      //Check status code
+      if(!error)
+      {
+         error = mqttSerializeInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+            pos, 0xFFFFFFFF);
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The server must not send packets exceeding the size of the
+      //receive buffer
+      error = mqttSerializeByte(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         pos, MQTT_PROPERTY_MAXIMUM_PACKET_SIZE);
+
+      //Check status code
+      if(!error)
+      {
+         error = mqttSerializeInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+            pos, MQTT_CLIENT_BUFFER_SIZE);
+      }
+   }
+
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   //Check status code
+   if(!error)
+   {
+      //Highest value the client accepts as a topic alias
+      error = mqttSerializeByte(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         pos, MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM);
+
+      //Check status code
+      if(!error)
+      {
+         error = mqttSerializeShort(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+            pos, MQTT_CLIENT_TOPIC_ALIAS_MAX);
+      }
+   }
+#endif
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Format PUBLISH packet
  * @param[in] context Pointer to the MQTT client context
@@ -957,14 +1502,41 @@ error_t mqttClientFormatPublish(MqttClientContext *context, const char_t *topic,
 {
    error_t error;
    size_t n;
+   size_t bufferLen;
+   uint8_t *buffer;
+   uint16_t topicAlias;
+   bool_t established;
+
+#if (MQTT_CLIENT_QUEUE_SUPPORT == ENABLED)
+   //Queued messages are appended to the packets coalesced so far
+   buffer = context->buffer + context->queue.batchLen;
+   bufferLen = MQTT_CLIENT_BUFFER_SIZE - context->queue.batchLen;
+#else
+   //Point to the internal buffer
+   buffer = context->buffer;
+   bufferLen = MQTT_CLIENT_BUFFER_SIZE;
+#endif
 
    //Make room for the fixed header
    n = MQTT_MAX_HEADER_SIZE;
 
+   //With MQTT 5.0, a topic alias can be used in place of the Topic Name
+   topicAlias = mqttClientGetTopicAlias(context, topic);
+
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   //Once the server knows the binding, the Topic Name can be omitted
+   if(topicAlias != 0)
+      established = context->txTopicAlias[topicAlias - 1].established;
+   else
+#endif
+      established = FALSE;
+
    //The Topic Name must be present as the first field in the PUBLISH
    //packet variable header
-   error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
-      &n, topic, strlen(topic));
+   if(established)
+      error = mqttSerializeString(buffer, bufferLen, &n, "", 0);
+   else
+      error = mqttSerializeString(buffer, bufferLen, &n, topic, strlen(topic));
 
    //Failed to serialize Topic Name?
    if(error)
@@ -975,21 +1547,43 @@ error_t mqttClientFormatPublish(MqttClientContext *context, const char_t *topic,
    {
       //Each time a client sends a new PUBLISH packet it must assign it
       //a currently unused packet identifier
-      context->packetId++;
+      mqttClientGeneratePacketId(context);
 
       //The Packet Identifier field is only present in PUBLISH packets
       //where the QoS level is 1 or 2
-      error = mqttSerializeShort(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
-         &n, context->packetId);
+      error = mqttSerializeShort(buffer, bufferLen, &n, context->packetId);
 
       //Failed to serialize Packet Identifier field?
       if(error)
          return error;
    }
 
+   //With MQTT 5.0, the variable header ends with a list of properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //Write the length of the properties
+      error = mqttSerializeVarInt(buffer, bufferLen, &n,
+         (topicAlias != 0) ? 3 : 0);
+
+      //Topic alias?
+      if(!error && topicAlias != 0)
+      {
+         //Write the Topic Alias property
+         error = mqttSerializeByte(buffer, bufferLen, &n,
+            MQTT_PROPERTY_TOPIC_ALIAS);
+
+         //Check status code
+         if(!error)
+            error = mqttSerializeShort(buffer, bufferLen, &n, topicAlias);
+      }
+
+      //Failed to serialize properties?
+      if(error)
+         return error;
+   }
+
    //The payload contains the Application Message that is being published
-   error = mqttSerializeData(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
-      &n, message, length);
+   error = mqttSerializeData(buffer, bufferLen, &n, message, length);
 
    //Failed to serialize Application Message?
    if(error)
@@ -1002,13 +1596,189 @@ error_t mqttClientFormatPublish(MqttClientContext *context, const char_t *topic,
    n = MQTT_MAX_HEADER_SIZE;
 
    //Prepend the variable header and the payload with the fixed header
-   error = mqttSerializeHeader(context->buffer, &n, MQTT_PACKET_TYPE_PUBLISH,
+   error = mqttSerializeHeader(buffer, &n, MQTT_PACKET_TYPE_PUBLISH,
       FALSE, qos, retain, context->packetLen);
 
    //Failed to serialize fixed header?
    if(error)
       return error;
 
+   //Point to the first byte of the MQTT packet
+   context->packet = buffer + n;
+   //Calculate the length of the MQTT packet
+   context->packetLen += MQTT_MAX_HEADER_SIZE - n;
+
+   //The client must not send packets exceeding the Maximum Packet Size
+   //advertised by the server (MQTT 5.0)
+   if(context->serverMaxPacketSize != 0 &&
+      context->packetLen > context->serverMaxPacketSize)
+   {
+      return ERROR_INVALID_LENGTH;
+   }
+
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+   //The binding between the topic alias and the Topic Name is now known
+   //by the server
+   if(topicAlias != 0)
+      context->txTopicAlias[topicAlias - 1].established = TRUE;
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Rebuild a stored PUBLISH packet for retransmission (MQTT 5.0)
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] packet Copy of the PUBLISH packet
+ * @param[in] length Length of the PUBLISH packet
+ * @return Error code
+ **/
+
+error_t mqttClientFormatStoredPublish(MqttClientContext *context,
+   uint8_t *packet, size_t length)
+{
+   error_t error;
+   bool_t dup;
+   bool_t retain;
+   size_t n;
+   size_t pos;
+   size_t end;
+   size_t topicLen;
+   size_t remainingLen;
+   uint16_t packetId;
+   uint16_t topicAlias;
+   uint32_t propertyLen;
+   char_t *topic;
+   MqttPacketType type;
+   MqttQosLevel qos;
+   MqttProperty property;
+
+   //Initialize variables
+   pos = 0;
+   packetId = 0;
+   topicAlias = 0;
+
+   //Decode the fixed header of the stored packet
+   error = mqttDeserializeHeader(packet, length, &pos, &type, &dup, &qos,
+      &retain, &remainingLen);
+
+   //Corrupted packet?
+   if(error)
+      return error;
+
+   //Malformed packet?
+   if(remainingLen > (length - pos))
+      return ERROR_INVALID_LENGTH;
+
+   //Point to the end of the packet
+   end = pos + remainingLen;
+
+   //Read the Topic Name
+   error = mqttDeserializeString(packet, end, &pos, &topic, &topicLen);
+
+   //Check status code
+   if(!error && qos != MQTT_QOS_LEVEL_0)
+   {
+      //Read the Packet Identifier
+      error = mqttDeserializeShort(packet, end, &pos, &packetId);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Read the Property Length field
+      error = mqttDeserializeVarInt(packet, end, &pos, &propertyLen);
+   }
+
+   //Corrupted packet?
+   if(error)
+      return error;
+
+   //Malformed packet?
+   if(propertyLen > (end - pos))
+      return ERROR_INVALID_LENGTH;
+
+   //Parse properties
+   for(n = pos + propertyLen; pos < n; )
+   {
+      //Read the next property
+      error = mqttDeserializeProperty(packet, n, &pos, &property);
+      //Corrupted packet?
+      if(error)
+         return error;
+
+      //Topic alias?
+      if(property.id == MQTT_PROPERTY_TOPIC_ALIAS)
+         topicAlias = (uint16_t) property.value;
+   }
+
+   //The Topic Name has been omitted in favor of a topic alias?
+   if(topicLen == 0)
+   {
+      //Check the value of the topic alias
+      if(topicAlias == 0 || topicAlias > MQTT_CLIENT_TOPIC_ALIAS_MAX)
+         return ERROR_INVALID_PACKET;
+
+#if (MQTT_CLIENT_TOPIC_ALIAS_MAX > 0)
+      //Retrieve the Topic Name bound to the alias
+      topic = context->txTopicAlias[topicAlias - 1].topic;
+      topicLen = strlen(topic);
+#endif
+   }
+
+   //Make room for the fixed header
+   n = MQTT_MAX_HEADER_SIZE;
+
+   //Topic aliases are scoped to a network connection, so the full Topic
+   //Name is always sent
+   error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+      &n, topic, topicLen);
+
+   //Check status code
+   if(!error && qos != MQTT_QOS_LEVEL_0)
+   {
+      //The same Packet Identifier must be used
+      error = mqttSerializeShort(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         &n, packetId);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The rebuilt packet does not carry any property
+      error = mqttSerializeVarInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         &n, 0);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Copy the Application Message
+      error = mqttSerializeData(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         &n, packet + pos, end - pos);
+   }
+
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Calculate the length of the variable header and the payload
+   context->packetLen = n - MQTT_MAX_HEADER_SIZE;
+
+   //The fixed header will be encoded in reverse order
+   n = MQTT_MAX_HEADER_SIZE;
+
+   //The DUP flag must be set when the client attempts to re-deliver a
+   //PUBLISH packet
+   error = mqttSerializeHeader(context->buffer, &n, MQTT_PACKET_TYPE_PUBLISH,
+      TRUE, qos, retain, context->packetLen);
+
+   //Failed to serialize fixed header?
+   if(error)
+      return error;
+
    //Point to the first byte of the MQTT packet
    context->packet = context->buffer + n;
    //Calculate the length of the MQTT packet
@@ -1231,7 +2001,7 @@ error_t mqttClientFormatSubscribe(MqttClientContext *context,
 
    //Each time a client sends a new SUBSCRIBE packet it must assign it
    //a currently unused packet identifier
-   context->packetId++;
+   mqttClientGeneratePacketId(context);
 
    //Write Packet Identifier to the output buffer
    error = mqttSerializeShort(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
@@ -1241,6 +2011,18 @@ error_t mqttClientFormatSubscribe(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the variable header ends with a list of properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //No properties
+      error = mqttSerializeVarInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         &n, 0);
+
+      //Failed to serialize data?
+      if(error)
+         return error;
+   }
+
    //Write the Topic Filter to the output buffer
    error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
       &n, topic, strlen(topic));
@@ -1299,7 +2081,7 @@ error_t mqttClientFormatUnsubscribe(MqttClientContext *context,
 
    //Each time a client sends a new UNSUBSCRIBE packet it must assign it
    //a currently unused packet identifier
-   context->packetId++;
+   mqttClientGeneratePacketId(context);
 
    //Write Packet Identifier to the output buffer
    error = mqttSerializeShort(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
@@ -1309,6 +2091,18 @@ error_t mqttClientFormatUnsubscribe(MqttClientContext *context,
    if(error)
       return error;
 
+   //With MQTT 5.0, the variable header ends with a list of properties
+   if(context->settings.version == MQTT_VERSION_5_0)
+   {
+      //No properties
+      error = mqttSerializeVarInt(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
+         &n, 0);
+
+      //Failed to serialize data?
+      if(error)
+         return error;
+   }
+
    //Write the Topic Filter to the output buffer
    error = mqttSerializeString(context->buffer, MQTT_CLIENT_BUFFER_SIZE,
       &n, topic, strlen(topic));
@@ -71,12 +71,27 @@ error_t mqttClientProcessUnsubAck(MqttClientContext *context,
 error_t mqttClientProcessPingResp(MqttClientContext *context,
    bool_t dup, MqttQosLevel qos, bool_t retain, size_t remainingLen);
 
+error_t mqttClientProcessDisconnect(MqttClientContext *context,
+   bool_t dup, MqttQosLevel qos, bool_t retain, size_t remainingLen);
+
+error_t mqttClientParseReasonCode(MqttClientContext *context,
+   uint8_t *reasonCode);
+
+error_t mqttClientParseProperties(MqttClientContext *context,
+   MqttPacketType type, uint16_t *topicAlias);
+
 error_t mqttClientFormatConnect(MqttClientContext *context,
    bool_t cleanSession);
 
+error_t mqttClientFormatConnectProperties(MqttClientContext *context,
+   size_t *pos, bool_t cleanSession);
+
 error_t mqttClientFormatPublish(MqttClientContext *context, const char_t *topic,
    const void *message, size_t length, MqttQosLevel qos, bool_t retain);
 
+error_t mqttClientFormatStoredPublish(MqttClientContext *context,
+   uint8_t *packet, size_t length);
+
 error_t mqttClientFormatPubAck(MqttClientContext *context, uint16_t packetId);
 error_t mqttClientFormatPubRec(MqttClientContext *context, uint16_t packetId);
 error_t mqttClientFormatPubRel(MqttClientContext *context, uint16_t packetId);
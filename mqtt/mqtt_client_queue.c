@@ -0,0 +1,823 @@
+/**
+ * @file mqtt_client_queue.c
+ * @brief Store-and-forward queue for MQTT client
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL MQTT_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "mqtt/mqtt_client.h"
+#include "mqtt/mqtt_client_packet.h"
+#include "mqtt/mqtt_client_queue.h"
+#include "mqtt/mqtt_client_misc.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (MQTT_CLIENT_SUPPORT == ENABLED && MQTT_CLIENT_QUEUE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Check whether outgoing messages must go through the queue
+ * @param[in] context Pointer to the MQTT client context
+ * @return TRUE if the message must be queued, else FALSE
+ **/
+
+bool_t mqttClientQueueIsActive(MqttClientContext *context)
+{
+   bool_t active;
+
+   //Messages are queued as long as no session is established
+   if(context->state < MQTT_CLIENT_STATE_IDLE ||
+      context->state > MQTT_CLIENT_STATE_PACKET_RECEIVED)
+   {
+      active = TRUE;
+   }
+   else if(context->queue.length > 0)
+   {
+      //Older messages must be delivered first
+      active = TRUE;
+   }
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   else if(context->queue.fileCount > 0)
+   {
+      //Older messages are still waiting in the queue file
+      active = TRUE;
+   }
+#endif
+   else
+   {
+      //The message can be sent immediately
+      active = FALSE;
+   }
+
+   //Return TRUE if the message must be queued
+   return active;
+}
+
+
+/**
+ * @brief Add a message to the store-and-forward queue
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] topic Topic name
+ * @param[in] message Message payload
+ * @param[in] length Length of the message payload
+ * @param[in] qos QoS level to be used when publishing the message
+ * @param[in] retain This flag specifies if the message is to be retained
+ * @return Error code
+ **/
+
+error_t mqttClientEnqueueMessage(MqttClientContext *context,
+   const char_t *topic, const void *message, size_t length,
+   MqttQosLevel qos, bool_t retain)
+{
+   error_t error;
+   size_t n;
+   uint8_t *p;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord record;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+
+   //The topic name is stored with its terminating NUL character
+   n = strlen(topic) + 1;
+
+   //Format record header
+   record.flags = retain ? MQTT_CLIENT_QUEUE_FLAG_RETAIN : 0;
+   record.qos = qos;
+   record.topicLen = (uint16_t) n;
+   record.length = (uint32_t) length;
+
+   //Make sure the record can fit in the queue
+   if(n > UINT16_MAX || length > MQTT_CLIENT_QUEUE_SIZE ||
+      mqttClientGetQueueRecordSize(&record) > MQTT_CLIENT_QUEUE_SIZE)
+   {
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //A retained message supersedes any retained message for the same topic
+   //that is still waiting in the queue
+   if(retain)
+      mqttClientQueueCoalesce(context, topic);
+
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   //Once messages have overflowed to the file, new messages are appended to
+   //the file as well so that ordering is preserved
+   if(queue->fileCount > 0)
+      p = NULL;
+   else
+#endif
+   {
+      //Allocate room in the ring buffer
+      p = mqttClientQueueAlloc(context, mqttClientGetQueueRecordSize(&record));
+   }
+
+   //Successful allocation?
+   if(p != NULL)
+   {
+      //Copy the record header, the topic name and the payload
+      memcpy(p, &record, sizeof(MqttClientQueueRecord));
+      memcpy(p + sizeof(MqttClientQueueRecord), topic, n);
+
+      //The payload is optional
+      if(length > 0)
+         memcpy(p + sizeof(MqttClientQueueRecord) + n, message, length);
+
+      //Update the number of messages waiting in the queue
+      queue->count++;
+
+      //Successful processing
+      error = NO_ERROR;
+   }
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+   else if(queue->path[0] != '\0')
+   {
+      //Append the record to the queue file
+      error = mqttClientQueueWriteFile(context, &record, topic, message);
+   }
+#endif
+   else
+   {
+      //Report back-pressure to the publisher
+      error = ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Debug message
+      TRACE_INFO("MQTT: Message queued (%u messages pending)\r\n",
+         queue->count);
+   }
+   else
+   {
+      //Debug message
+      TRACE_WARNING("MQTT: Failed to queue message!\r\n");
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the oldest queued message
+ * @param[in] context Pointer to the MQTT client context
+ * @return Error code
+ **/
+
+error_t mqttClientCheckQueue(MqttClientContext *context)
+{
+   error_t error;
+   const char_t *topic;
+   const uint8_t *message;
+   MqttClientQueueRecord *record;
+   MqttClientInflightEntry *entry;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Queued messages are only interleaved between other packet exchanges
+   if(context->state == MQTT_CLIENT_STATE_IDLE &&
+      context->packetType == MQTT_PACKET_TYPE_INVALID)
+   {
+      //Consecutive PUBLISH packets are coalesced into the internal buffer
+      //so that they can be written to the network in a single call
+      context->queue.batchLen = 0;
+
+      //Process as many queued messages as possible
+      while((record = mqttClientQueuePeek(context)) != NULL)
+      {
+         //QoS 1 and QoS 2 messages require a free entry in the in-flight
+         //window
+         if(record->qos != MQTT_QOS_LEVEL_0)
+         {
+            //The message stays in the queue until the window has room for it
+            entry = mqttClientAllocInflightEntry(context);
+            //No free entry?
+            if(entry == NULL)
+               break;
+         }
+         else
+         {
+            //QoS 0 messages are not tracked
+            entry = NULL;
+         }
+
+         //Point to the topic name and to the payload
+         topic = (const char_t *) record + sizeof(MqttClientQueueRecord);
+         message = (const uint8_t *) topic + record->topicLen;
+
+         //Format PUBLISH packet
+         error = mqttClientFormatPublish(context, topic, message,
+            record->length, (MqttQosLevel) record->qos,
+            (record->flags & MQTT_CLIENT_QUEUE_FLAG_RETAIN) ? TRUE : FALSE);
+
+         //Check status code
+         if(!error)
+         {
+            //Track the message until the QoS protocol exchange completes
+            if(entry != NULL)
+            {
+               mqttClientAddInflightEntry(context, entry,
+                  (MqttQosLevel) record->qos);
+            }
+
+            //Debug message
+            TRACE_INFO("MQTT: Sending queued PUBLISH packet (%" PRIuSIZE " bytes)...\r\n",
+               context->packetLen);
+
+            //Dump the contents of the PUBLISH packet
+            TRACE_DEBUG_ARRAY("  ", context->packet, context->packetLen);
+
+            //Append the packet to the previous ones
+            memmove(context->buffer + context->queue.batchLen, context->packet,
+               context->packetLen);
+
+            //Update the length of the batch
+            context->queue.batchLen += context->packetLen;
+         }
+         else if(error == ERROR_BUFFER_OVERFLOW && context->queue.batchLen > 0)
+         {
+            //The message will be sent as part of the next batch
+            error = NO_ERROR;
+            break;
+         }
+         else
+         {
+            //Debug message
+            TRACE_WARNING("MQTT: Queued message too large, discarding it...\r\n");
+
+            //The message can never be sent
+            error = NO_ERROR;
+         }
+
+         //Remove the message from the queue
+         mqttClientQueuePop(context);
+      }
+
+      //Any packet ready to be sent?
+      if(context->queue.batchLen > 0)
+      {
+         //Point to the beginning of the batch
+         context->packet = context->buffer;
+         context->packetLen = context->queue.batchLen;
+         context->packetPos = 0;
+
+         //Send PUBLISH packets
+         mqttClientChangeState(context, MQTT_CLIENT_STATE_SENDING_PACKET);
+      }
+
+      //Subsequent packets are formatted at the beginning of the buffer
+      context->queue.batchLen = 0;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the size of a record, including padding
+ * @param[in] record Pointer to the record header
+ * @return Size of the record, in bytes
+ **/
+
+size_t mqttClientGetQueueRecordSize(const MqttClientQueueRecord *record)
+{
+   size_t n;
+
+   //Records are aligned on 32-bit boundaries
+   n = sizeof(MqttClientQueueRecord) + record->topicLen + record->length;
+   n = (n + 3) & ~3U;
+
+   //Return the size of the record
+   return n;
+}
+
+
+/**
+ * @brief Allocate room for a new record in the ring buffer
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] size Size of the record, in bytes
+ * @return Pointer to the allocated space (NULL if the queue is full)
+ **/
+
+uint8_t *mqttClientQueueAlloc(MqttClientContext *context, size_t size)
+{
+   size_t n;
+   uint8_t *p;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord *marker;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+   p = (uint8_t *) queue->buffer;
+
+   //Rewind to the beginning of the buffer when the queue is empty
+   if(queue->length == 0)
+   {
+      queue->head = 0;
+      queue->tail = 0;
+   }
+
+   //Records are never split, so check whether the free space is contiguous
+   if(queue->length == 0 || queue->tail > queue->head)
+   {
+      //Number of bytes available at the end of the buffer
+      n = MQTT_CLIENT_QUEUE_SIZE - queue->tail;
+
+      //Not enough room at the end of the buffer?
+      if(size > n)
+      {
+         //Make sure the record fits at the beginning of the buffer
+         if(size > queue->head)
+            return NULL;
+
+         //Tell the reader to skip the end of the buffer
+         if(n >= sizeof(MqttClientQueueRecord))
+         {
+            marker = (MqttClientQueueRecord *) (p + queue->tail);
+            marker->flags = MQTT_CLIENT_QUEUE_FLAG_WRAP;
+         }
+
+         //The end of the buffer is lost until the reader wraps around
+         queue->length += n;
+         queue->tail = 0;
+      }
+   }
+   else
+   {
+      //The free space lies between the tail and the head
+      if((queue->tail + size) > queue->head || queue->length >= MQTT_CLIENT_QUEUE_SIZE)
+         return NULL;
+   }
+
+   //Point to the allocated space
+   p += queue->tail;
+
+   //Update write position
+   queue->tail += size;
+   queue->length += size;
+
+   //Return a pointer to the allocated space
+   return p;
+}
+
+
+/**
+ * @brief Get the oldest record of the queue
+ * @param[in] context Pointer to the MQTT client context
+ * @return Pointer to the record (NULL if the queue is empty)
+ **/
+
+MqttClientQueueRecord *mqttClientQueuePeek(MqttClientContext *context)
+{
+   uint8_t *p;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord *record;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+   p = (uint8_t *) queue->buffer;
+
+   //Skip wrap markers and discarded records
+   while(1)
+   {
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+      //Move the oldest message of the file to the ring buffer as soon as
+      //the latter is empty
+      if(queue->length == 0 && queue->fileCount > 0)
+         mqttClientQueueReadFile(context);
+#endif
+
+      //The queue is empty?
+      if(queue->length == 0)
+      {
+         record = NULL;
+         break;
+      }
+
+      //Check whether the reader must wrap around
+      if((MQTT_CLIENT_QUEUE_SIZE - queue->head) < sizeof(MqttClientQueueRecord) ||
+         (p[queue->head] & MQTT_CLIENT_QUEUE_FLAG_WRAP) != 0)
+      {
+         //Release the end of the buffer
+         queue->length -= MQTT_CLIENT_QUEUE_SIZE - queue->head;
+         queue->head = 0;
+      }
+      else
+      {
+         //Point to the oldest record
+         record = (MqttClientQueueRecord *) (p + queue->head);
+
+         //Valid record?
+         if((record->flags & MQTT_CLIENT_QUEUE_FLAG_DISCARDED) == 0)
+            break;
+
+         //The record has been superseded by a more recent message
+         mqttClientQueuePop(context);
+      }
+   }
+
+   //Return a pointer to the record
+   return record;
+}
+
+
+/**
+ * @brief Remove the oldest record from the queue
+ * @param[in] context Pointer to the MQTT client context
+ **/
+
+void mqttClientQueuePop(MqttClientContext *context)
+{
+   size_t n;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord *record;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+
+   //Point to the oldest record (the reader has already wrapped around)
+   record = (MqttClientQueueRecord *) ((uint8_t *) queue->buffer + queue->head);
+
+   //Get the size of the record
+   n = mqttClientGetQueueRecordSize(record);
+
+   //Discarded records are not accounted for
+   if((record->flags & MQTT_CLIENT_QUEUE_FLAG_DISCARDED) == 0)
+      queue->count--;
+
+   //Release the record
+   queue->head += n;
+   queue->length -= n;
+}
+
+
+/**
+ * @brief Discard queued retained messages that match a given topic
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] topic Topic name
+ **/
+
+void mqttClientQueueCoalesce(MqttClientContext *context, const char_t *topic)
+{
+   size_t i;
+   size_t n;
+   size_t length;
+   uint8_t *p;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord *record;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+   p = (uint8_t *) queue->buffer;
+
+   //Start with the oldest record
+   i = queue->head;
+   length = queue->length;
+
+   //Loop through the records of the ring buffer
+   while(length > 0)
+   {
+      //Wrap around if necessary
+      if((MQTT_CLIENT_QUEUE_SIZE - i) < sizeof(MqttClientQueueRecord) ||
+         (p[i] & MQTT_CLIENT_QUEUE_FLAG_WRAP) != 0)
+      {
+         length -= MQTT_CLIENT_QUEUE_SIZE - i;
+         i = 0;
+      }
+      else
+      {
+         //Point to the current record
+         record = (MqttClientQueueRecord *) (p + i);
+         n = mqttClientGetQueueRecordSize(record);
+
+         //Retained message with the same topic name?
+         if((record->flags & MQTT_CLIENT_QUEUE_FLAG_DISCARDED) == 0 &&
+            (record->flags & MQTT_CLIENT_QUEUE_FLAG_RETAIN) != 0 &&
+            !strcmp((char_t *) record + sizeof(MqttClientQueueRecord), topic))
+         {
+            //The record will be skipped by the reader
+            record->flags |= MQTT_CLIENT_QUEUE_FLAG_DISCARDED;
+            queue->count--;
+         }
+
+         //Next record
+         i += n;
+         length -= n;
+      }
+   }
+}
+
+
+#if (MQTT_CLIENT_QUEUE_FS_SUPPORT == ENABLED)
+
+/**
+ * @brief Recover the messages stored in the queue file
+ * @param[in] context Pointer to the MQTT client context
+ * @return Error code
+ **/
+
+error_t mqttClientQueueLoadFile(MqttClientContext *context)
+{
+   error_t error;
+   size_t n;
+   uint32_t pos;
+   uint32_t fileSize;
+   FsFile *file;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord record;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+
+   //Reset the file state
+   queue->fileReadPos = 0;
+   queue->fileWritePos = 0;
+   queue->fileCount = 0;
+
+   //Retrieve the size of the queue file
+   error = fsGetFileSize(queue->path, &fileSize);
+   //No file left over from a previous session?
+   if(error)
+      return NO_ERROR;
+
+   //Open the queue file for reading
+   file = fsOpenFile(queue->path, FS_FILE_MODE_READ);
+   //Failed to open the file?
+   if(file == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Start with the first record
+   pos = 0;
+
+   //Count the records that have been completely written
+   while(1)
+   {
+      //Move to the next record
+      error = fsSeekFile(file, pos, FS_SEEK_SET);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Read the record header
+      error = fsReadFile(file, &record, sizeof(MqttClientQueueRecord), &n);
+      //End of file?
+      if(error || n != sizeof(MqttClientQueueRecord))
+         break;
+
+      //Get the size of the record
+      n = mqttClientGetQueueRecordSize(&record);
+
+      //A truncated record is ignored and will be overwritten
+      if(n > MQTT_CLIENT_QUEUE_SIZE || (pos + n) > fileSize)
+         break;
+
+      //Next record
+      pos += n;
+      queue->fileCount++;
+   }
+
+   //Close file
+   fsCloseFile(file);
+
+   //New records are appended after the last valid record
+   queue->fileWritePos = pos;
+
+   //Debug message
+   TRACE_INFO("MQTT: %u messages recovered from queue file\r\n",
+      queue->fileCount);
+
+   //Delete the file if it does not contain any valid record
+   if(queue->fileCount == 0)
+      fsDeleteFile(queue->path);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Append a record to the queue file
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] record Pointer to the record header
+ * @param[in] topic Topic name
+ * @param[in] message Message payload
+ * @return Error code
+ **/
+
+error_t mqttClientQueueWriteFile(MqttClientContext *context,
+   const MqttClientQueueRecord *record, const char_t *topic,
+   const void *message)
+{
+   error_t error;
+   size_t n;
+   uint32_t padding;
+   FsFile *file;
+   MqttClientQueue *queue;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+
+   //Open the queue file for writing
+   file = fsOpenFile(queue->path, FS_FILE_MODE_WRITE | FS_FILE_MODE_CREATE);
+   //Failed to open the file?
+   if(file == NULL)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Get the size of the record
+   n = mqttClientGetQueueRecordSize(record);
+
+   //Append the record after the last valid record
+   error = fsSeekFile(file, queue->fileWritePos, FS_SEEK_SET);
+
+   //Write the record header
+   if(!error)
+   {
+      error = fsWriteFile(file, (void *) record,
+         sizeof(MqttClientQueueRecord));
+   }
+
+   //Write the topic name
+   if(!error)
+      error = fsWriteFile(file, (void *) topic, record->topicLen);
+
+   //Write the payload
+   if(!error && record->length > 0)
+      error = fsWriteFile(file, (void *) message, record->length);
+
+   //Write padding bytes
+   if(!error)
+   {
+      //Records are aligned on 32-bit boundaries
+      padding = 0;
+
+      error = fsWriteFile(file, &padding, n - sizeof(MqttClientQueueRecord) -
+         record->topicLen - record->length);
+   }
+
+   //Close file
+   fsCloseFile(file);
+
+   //Check status code
+   if(!error)
+   {
+      //Update the state of the queue file
+      queue->fileWritePos += n;
+      queue->fileCount++;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Move the oldest record of the queue file to the ring buffer
+ * @param[in] context Pointer to the MQTT client context
+ * @return Error code
+ **/
+
+error_t mqttClientQueueReadFile(MqttClientContext *context)
+{
+   error_t error;
+   size_t n;
+   size_t size;
+   uint8_t *p;
+   FsFile *file;
+   MqttClientQueue *queue;
+   MqttClientQueueRecord record;
+
+   //Point to the store-and-forward queue
+   queue = &context->queue;
+
+   //Open the queue file for reading
+   file = fsOpenFile(queue->path, FS_FILE_MODE_READ);
+
+   //Check whether the file has been successfully opened
+   if(file != NULL)
+   {
+      //Move to the oldest record
+      error = fsSeekFile(file, queue->fileReadPos, FS_SEEK_SET);
+
+      //Read the record header
+      if(!error)
+      {
+         error = fsReadFile(file, &record, sizeof(MqttClientQueueRecord), &n);
+
+         //Truncated record?
+         if(!error && n != sizeof(MqttClientQueueRecord))
+            error = ERROR_END_OF_FILE;
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Get the size of the record
+         size = mqttClientGetQueueRecordSize(&record);
+
+         //The ring buffer is empty, so the allocation can only fail if the
+         //record is corrupted
+         p = mqttClientQueueAlloc(context, size);
+
+         //Successful allocation?
+         if(p != NULL)
+         {
+            //Copy the record header
+            memcpy(p, &record, sizeof(MqttClientQueueRecord));
+
+            //Read the rest of the record
+            error = fsReadFile(file, p + sizeof(MqttClientQueueRecord),
+               size - sizeof(MqttClientQueueRecord), &n);
+
+            //Truncated record?
+            if(!error && n != (size - sizeof(MqttClientQueueRecord)))
+               error = ERROR_END_OF_FILE;
+
+            //Check status code
+            if(!error)
+            {
+               //The message is now held in the ring buffer
+               queue->count++;
+               queue->fileReadPos += size;
+               queue->fileCount--;
+            }
+            else
+            {
+               //Release the allocated space
+               queue->length = 0;
+            }
+         }
+         else
+         {
+            //Report an error
+            error = ERROR_INVALID_LENGTH;
+         }
+      }
+
+      //Close file
+      fsCloseFile(file);
+   }
+   else
+   {
+      //Report an error
+      error = ERROR_NOT_FOUND;
+   }
+
+   //The remaining records cannot be recovered if the file is corrupted
+   if(error)
+   {
+      //Debug message
+      TRACE_WARNING("MQTT: Queue file is corrupted, discarding %u messages...\r\n",
+         queue->fileCount);
+
+      //Discard the remaining records
+      queue->fileCount = 0;
+   }
+
+   //All the records have been read?
+   if(queue->fileCount == 0)
+   {
+      //Delete the queue file
+      fsDeleteFile(queue->path);
+
+      //Reset the file state
+      queue->fileReadPos = 0;
+      queue->fileWritePos = 0;
+   }
+
+   //Return status code
+   return error;
+}
+
+#endif
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file mqtt_client_queue.h
+ * @brief Store-and-forward queue for MQTT client
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _MQTT_CLIENT_QUEUE_H
+#define _MQTT_CLIENT_QUEUE_H
+
+//Dependencies
+#include "core/net.h"
+#include "mqtt/mqtt_client.h"
+
+//Record flags
+#define MQTT_CLIENT_QUEUE_FLAG_RETAIN    0x01
+#define MQTT_CLIENT_QUEUE_FLAG_DISCARDED 0x02
+#define MQTT_CLIENT_QUEUE_FLAG_WRAP      0x80
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Queue record header
+ **/
+
+typedef struct
+{
+   uint8_t flags;     ///<Record flags
+   uint8_t qos;       ///<QoS level
+   uint16_t topicLen; ///<Length of the topic name, including the terminating NUL
+   uint32_t length;   ///<Length of the message payload
+} MqttClientQueueRecord;
+
+
+//MQTT client related functions
+bool_t mqttClientQueueIsActive(MqttClientContext *context);
+
+error_t mqttClientEnqueueMessage(MqttClientContext *context,
+   const char_t *topic, const void *message, size_t length,
+   MqttQosLevel qos, bool_t retain);
+
+error_t mqttClientCheckQueue(MqttClientContext *context);
+
+size_t mqttClientGetQueueRecordSize(const MqttClientQueueRecord *record);
+uint8_t *mqttClientQueueAlloc(MqttClientContext *context, size_t size);
+MqttClientQueueRecord *mqttClientQueuePeek(MqttClientContext *context);
+void mqttClientQueuePop(MqttClientContext *context);
+void mqttClientQueueCoalesce(MqttClientContext *context, const char_t *topic);
+
+error_t mqttClientQueueLoadFile(MqttClientContext *context);
+
+error_t mqttClientQueueWriteFile(MqttClientContext *context,
+   const MqttClientQueueRecord *record, const char_t *topic,
+   const void *message);
+
+error_t mqttClientQueueReadFile(MqttClientContext *context);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
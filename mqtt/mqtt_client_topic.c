@@ -0,0 +1,370 @@
+/**
+ * @file mqtt_client_topic.c
+ * @brief Topic filter dispatch for MQTT client
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL MQTT_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "mqtt/mqtt_client.h"
+#include "mqtt/mqtt_client_topic.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (MQTT_CLIENT_SUPPORT == ENABLED && MQTT_CLIENT_TOPIC_TRIE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Check the syntax of a topic filter
+ * @param[in] filter NULL-terminated string that contains the topic filter
+ * @return Error code
+ **/
+
+error_t mqttClientCheckTopicFilter(const char_t *filter)
+{
+   size_t n;
+   const char_t *p;
+
+   //A topic filter must be at least one character long
+   if(filter[0] == '\0')
+      return ERROR_INVALID_SYNTAX;
+
+   //Loop through the topic levels
+   while(1)
+   {
+      //Search for the next topic level separator
+      p = strchr(filter, '/');
+      //Length of the current topic level
+      n = (p != NULL) ? (size_t) (p - filter) : strlen(filter);
+
+      //Check the length of the topic level
+      if(n > MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN)
+         return ERROR_INVALID_LENGTH;
+
+      //Wildcard characters must occupy an entire level of the filter
+      if(n > 1 && (memchr(filter, '+', n) != NULL ||
+         memchr(filter, '#', n) != NULL))
+      {
+         return ERROR_INVALID_SYNTAX;
+      }
+
+      //The multi-level wildcard must be the last character of the filter
+      if(n == 1 && filter[0] == '#' && p != NULL)
+         return ERROR_INVALID_SYNTAX;
+
+      //Last topic level?
+      if(p == NULL)
+         break;
+
+      //Point to the next topic level
+      filter = p + 1;
+   }
+
+   //The topic filter is valid
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Search the topic filter trie for a given filter
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] filter NULL-terminated string that contains the topic filter
+ * @param[in] create Add the missing nodes to the trie
+ * @return Index of the matching node (0 if not found)
+ **/
+
+uint_t mqttClientFindTopicNode(MqttClientContext *context,
+   const char_t *filter, bool_t create)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   const char_t *p;
+   MqttClientTopicNode *node;
+
+   //Start with the root node
+   i = 0;
+
+   //Loop through the topic levels
+   while(filter != NULL)
+   {
+      //Search for the next topic level separator
+      p = strchr(filter, '/');
+      //Length of the current topic level
+      n = (p != NULL) ? (size_t) (p - filter) : strlen(filter);
+
+      //Search the children of the current node for the topic level
+      for(j = context->topicNodes[i].child; j != 0;
+         j = context->topicNodes[j].sibling)
+      {
+         //Compare topic levels
+         if(context->topicNodes[j].levelLen == n &&
+            !memcmp(context->topicNodes[j].level, filter, n))
+         {
+            break;
+         }
+      }
+
+      //No matching child?
+      if(j == 0)
+      {
+         //Make sure the topic level can be stored
+         if(!create || n > MQTT_CLIENT_MAX_TOPIC_LEVEL_LEN)
+            break;
+
+         //Loop through the trie nodes
+         for(j = 1; j < MQTT_CLIENT_MAX_TOPIC_NODES; j++)
+         {
+            //Check whether the current node is available
+            if(!context->topicNodes[j].used)
+               break;
+         }
+
+         //The trie is full?
+         if(j >= MQTT_CLIENT_MAX_TOPIC_NODES)
+         {
+            //Debug message
+            TRACE_WARNING("MQTT: No free topic filter node!\r\n");
+
+            //Release the nodes that have been created so far
+            mqttClientPruneTopicNode(context, i);
+            //Report an error
+            j = 0;
+            break;
+         }
+
+         //Point to the new node
+         node = &context->topicNodes[j];
+
+         //Initialize node
+         node->used = TRUE;
+         node->levelLen = (uint8_t) n;
+         memcpy(node->level, filter, n);
+         node->level[n] = '\0';
+         node->child = 0;
+         node->handler = NULL;
+
+         //Insert the node in the list of children of the current node
+         node->parent = i;
+         node->sibling = context->topicNodes[i].child;
+         context->topicNodes[i].child = j;
+      }
+
+      //Move to the next level of the trie
+      i = j;
+      //Point to the next topic level
+      filter = (p != NULL) ? p + 1 : NULL;
+   }
+
+   //Return the index of the matching node
+   return (filter == NULL) ? i : 0;
+}
+
+
+/**
+ * @brief Release a node that no longer holds any handler or child
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] index Index of the node
+ **/
+
+void mqttClientPruneTopicNode(MqttClientContext *context, uint_t index)
+{
+   uint_t i;
+   MqttClientTopicNode *node;
+
+   //The root node is never released
+   while(index != 0)
+   {
+      //Point to the current node
+      node = &context->topicNodes[index];
+
+      //The node is still needed?
+      if(node->handler != NULL || node->child != 0)
+         break;
+
+      //Unlink the node from the list of children of its parent
+      if(context->topicNodes[node->parent].child == index)
+      {
+         context->topicNodes[node->parent].child = node->sibling;
+      }
+      else
+      {
+         //Search the list of siblings
+         for(i = context->topicNodes[node->parent].child;
+            context->topicNodes[i].sibling != index;
+            i = context->topicNodes[i].sibling)
+         {
+         }
+
+         //Remove the node from the list
+         context->topicNodes[i].sibling = node->sibling;
+      }
+
+      //Release the node
+      node->used = FALSE;
+
+      //The parent may no longer be needed either
+      index = node->parent;
+   }
+}
+
+
+/**
+ * @brief Dispatch an incoming PUBLISH message to the matching handlers
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] topic Topic name
+ * @param[in] message Message payload
+ * @param[in] length Length of the message payload
+ * @param[in] dup DUP flag from the fixed header
+ * @param[in] qos QoS field from the fixed header
+ * @param[in] retain RETAIN flag from the fixed header
+ * @param[in] packetId Packet identifier
+ * @return Number of handlers that have been invoked
+ **/
+
+uint_t mqttClientDispatchPublish(MqttClientContext *context,
+   const char_t *topic, const uint8_t *message, size_t length,
+   bool_t dup, MqttQosLevel qos, bool_t retain, uint16_t packetId)
+{
+   //Walk the trie from the root node. The recursion depth is bounded by the
+   //depth of the trie, not by the number of levels in the topic name
+   return mqttClientMatchTopicNode(context, 0, topic, topic, message, length,
+      dup, qos, retain, packetId);
+}
+
+
+/**
+ * @brief Match the remaining topic levels against the children of a node
+ * @param[in] context Pointer to the MQTT client context
+ * @param[in] index Index of the current node
+ * @param[in] level Remaining topic levels (NULL if all levels have been
+ *   matched)
+ * @param[in] topic Topic name
+ * @param[in] message Message payload
+ * @param[in] length Length of the message payload
+ * @param[in] dup DUP flag from the fixed header
+ * @param[in] qos QoS field from the fixed header
+ * @param[in] retain RETAIN flag from the fixed header
+ * @param[in] packetId Packet identifier
+ * @return Number of handlers that have been invoked
+ **/
+
+uint_t mqttClientMatchTopicNode(MqttClientContext *context, uint_t index,
+   const char_t *level, const char_t *topic, const uint8_t *message,
+   size_t length, bool_t dup, MqttQosLevel qos, bool_t retain,
+   uint16_t packetId)
+{
+   uint_t i;
+   uint_t count;
+   size_t n;
+   bool_t wildcard;
+   const char_t *p;
+   const char_t *next;
+   MqttClientTopicNode *node;
+
+   //Number of handlers invoked so far
+   count = 0;
+
+   //All the topic levels have been matched?
+   if(level == NULL)
+   {
+      //Invoke the handler attached to the topic filter, if any
+      if(index != 0 && context->topicNodes[index].handler != NULL)
+      {
+         context->topicNodes[index].handler(context, topic, message,
+            length, dup, qos, retain, packetId);
+
+         count++;
+      }
+
+      //No more levels
+      n = 0;
+      next = NULL;
+   }
+   else
+   {
+      //Search for the next topic level separator
+      p = strchr(level, '/');
+
+      //Length of the current topic level
+      n = (p != NULL) ? (size_t) (p - level) : strlen(level);
+      //Point to the next topic level
+      next = (p != NULL) ? p + 1 : NULL;
+   }
+
+   //Topic names beginning with a '$' character are not matched by filters
+   //starting with a wildcard character (refer to MQTT 3.1.1, section 4.7.2)
+   wildcard = (index != 0 || topic[0] != '$') ? TRUE : FALSE;
+
+   //Loop through the children of the current node
+   for(i = context->topicNodes[index].child; i != 0; i = node->sibling)
+   {
+      //Point to the current child
+      node = &context->topicNodes[i];
+
+      //Multi-level wildcard?
+      if(node->levelLen == 1 && node->level[0] == '#')
+      {
+         //The multi-level wildcard matches the parent level and any number of
+         //child levels
+         if(wildcard && node->handler != NULL)
+         {
+            node->handler(context, topic, message, length, dup, qos, retain,
+               packetId);
+
+            count++;
+         }
+      }
+      else if(level != NULL)
+      {
+         //Single-level wildcard or exact match?
+         if(node->levelLen == 1 && node->level[0] == '+')
+         {
+            //The single-level wildcard matches exactly one topic level
+            if(wildcard)
+            {
+               count += mqttClientMatchTopicNode(context, i, next, topic,
+                  message, length, dup, qos, retain, packetId);
+            }
+         }
+         else if(node->levelLen == n && !memcmp(node->level, level, n))
+         {
+            //Match the next topic level
+            count += mqttClientMatchTopicNode(context, i, next, topic,
+               message, length, dup, qos, retain, packetId);
+         }
+      }
+   }
+
+   //Return the number of handlers that have been invoked
+   return count;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file mqtt_client_topic.h
+ * @brief Topic filter dispatch for MQTT client
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _MQTT_CLIENT_TOPIC_H
+#define _MQTT_CLIENT_TOPIC_H
+
+//Dependencies
+#include "core/net.h"
+#include "mqtt/mqtt_client.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//MQTT client related functions
+error_t mqttClientCheckTopicFilter(const char_t *filter);
+
+uint_t mqttClientFindTopicNode(MqttClientContext *context,
+   const char_t *filter, bool_t create);
+
+void mqttClientPruneTopicNode(MqttClientContext *context, uint_t index);
+
+uint_t mqttClientDispatchPublish(MqttClientContext *context,
+   const char_t *topic, const uint8_t *message, size_t length,
+   bool_t dup, MqttQosLevel qos, bool_t retain, uint16_t packetId);
+
+uint_t mqttClientMatchTopicNode(MqttClientContext *context, uint_t index,
+   const char_t *level, const char_t *topic, const uint8_t *message,
+   size_t length, bool_t dup, MqttQosLevel qos, bool_t retain,
+   uint16_t packetId);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
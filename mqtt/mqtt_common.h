@@ -43,6 +43,8 @@
 #define MQTT_PROTOCOL_NAME_3_1 "MQIsdp"
 //MQTT 3.1.1 protocol name
 #define MQTT_PROTOCOL_NAME_3_1_1 "MQTT"
+//MQTT 5.0 protocol name
+#define MQTT_PROTOCOL_NAME_5_0 "MQTT"
 
 //Minimum size of MQTT header
 #define MQTT_MIN_HEADER_SIZE 2
@@ -62,7 +64,8 @@ extern "C" {
 typedef enum
 {
    MQTT_VERSION_3_1   = 3, ///<MQTT version 3.1
-   MQTT_VERSION_3_1_1 = 4  ///<MQTT version 3.1.1
+   MQTT_VERSION_3_1_1 = 4, ///<MQTT version 3.1.1
+   MQTT_VERSION_5_0   = 5  ///<MQTT version 5.0
 } MqttVersion;
 
 
@@ -111,7 +114,8 @@ typedef enum
    MQTT_PACKET_TYPE_UNSUBACK    = 11, ///<Unsubscribe acknowledgment
    MQTT_PACKET_TYPE_PINGREQ     = 12, ///<Ping request
    MQTT_PACKET_TYPE_PINGRESP    = 13, ///<Ping response
-   MQTT_PACKET_TYPE_DISCONNECT  = 14  ///<Client is disconnecting
+   MQTT_PACKET_TYPE_DISCONNECT  = 14, ///<Client is disconnecting
+   MQTT_PACKET_TYPE_AUTH        = 15  ///<Authentication exchange (MQTT 5.0)
 } MqttPacketType;
 
 
@@ -157,6 +161,81 @@ typedef enum
 } MqttConnectRetCode;
 
 
+/**
+ * @brief Property identifiers (MQTT 5.0)
+ **/
+
+typedef enum
+{
+   MQTT_PROPERTY_PAYLOAD_FORMAT_INDICATOR          = 0x01,
+   MQTT_PROPERTY_MESSAGE_EXPIRY_INTERVAL           = 0x02,
+   MQTT_PROPERTY_CONTENT_TYPE                      = 0x03,
+   MQTT_PROPERTY_RESPONSE_TOPIC                    = 0x08,
+   MQTT_PROPERTY_CORRELATION_DATA                  = 0x09,
+   MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER           = 0x0B,
+   MQTT_PROPERTY_SESSION_EXPIRY_INTERVAL           = 0x11,
+   MQTT_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER        = 0x12,
+   MQTT_PROPERTY_SERVER_KEEP_ALIVE                 = 0x13,
+   MQTT_PROPERTY_AUTHENTICATION_METHOD             = 0x15,
+   MQTT_PROPERTY_AUTHENTICATION_DATA               = 0x16,
+   MQTT_PROPERTY_REQUEST_PROBLEM_INFORMATION       = 0x17,
+   MQTT_PROPERTY_WILL_DELAY_INTERVAL               = 0x18,
+   MQTT_PROPERTY_REQUEST_RESPONSE_INFORMATION      = 0x19,
+   MQTT_PROPERTY_RESPONSE_INFORMATION              = 0x1A,
+   MQTT_PROPERTY_SERVER_REFERENCE                  = 0x1C,
+   MQTT_PROPERTY_REASON_STRING                     = 0x1F,
+   MQTT_PROPERTY_RECEIVE_MAXIMUM                   = 0x21,
+   MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM               = 0x22,
+   MQTT_PROPERTY_TOPIC_ALIAS                       = 0x23,
+   MQTT_PROPERTY_MAXIMUM_QOS                       = 0x24,
+   MQTT_PROPERTY_RETAIN_AVAILABLE                  = 0x25,
+   MQTT_PROPERTY_USER_PROPERTY                     = 0x26,
+   MQTT_PROPERTY_MAXIMUM_PACKET_SIZE               = 0x27,
+   MQTT_PROPERTY_WILDCARD_SUBSCRIPTION_AVAILABLE   = 0x28,
+   MQTT_PROPERTY_SUBSCRIPTION_IDENTIFIER_AVAILABLE = 0x29,
+   MQTT_PROPERTY_SHARED_SUBSCRIPTION_AVAILABLE     = 0x2A
+} MqttPropertyId;
+
+
+/**
+ * @brief Reason codes (MQTT 5.0)
+ **/
+
+typedef enum
+{
+   MQTT_REASON_CODE_SUCCESS                       = 0x00,
+   MQTT_REASON_CODE_NO_MATCHING_SUBSCRIBERS       = 0x10,
+   MQTT_REASON_CODE_UNSPECIFIED_ERROR             = 0x80,
+   MQTT_REASON_CODE_MALFORMED_PACKET              = 0x81,
+   MQTT_REASON_CODE_PROTOCOL_ERROR                = 0x82,
+   MQTT_REASON_CODE_IMPLEMENTATION_SPECIFIC_ERROR = 0x83,
+   MQTT_REASON_CODE_UNSUPPORTED_PROTOCOL_VERSION  = 0x84,
+   MQTT_REASON_CODE_NOT_AUTHORIZED                = 0x87,
+   MQTT_REASON_CODE_SERVER_BUSY                   = 0x89,
+   MQTT_REASON_CODE_SESSION_TAKEN_OVER            = 0x8E,
+   MQTT_REASON_CODE_TOPIC_NAME_INVALID            = 0x90,
+   MQTT_REASON_CODE_PACKET_ID_NOT_FOUND           = 0x92,
+   MQTT_REASON_CODE_RECEIVE_MAXIMUM_EXCEEDED      = 0x93,
+   MQTT_REASON_CODE_TOPIC_ALIAS_INVALID           = 0x94,
+   MQTT_REASON_CODE_PACKET_TOO_LARGE              = 0x95,
+   MQTT_REASON_CODE_QUOTA_EXCEEDED                = 0x97,
+   MQTT_REASON_CODE_PAYLOAD_FORMAT_INVALID        = 0x99
+} MqttReasonCode;
+
+
+/**
+ * @brief Property (MQTT 5.0)
+ **/
+
+typedef struct
+{
+   uint8_t id;          ///<Property identifier
+   uint32_t value;      ///<Value of an integer property
+   const uint8_t *data; ///<Value of a string or binary property
+   size_t length;       ///<Length of the string or binary data
+} MqttProperty;
+
+
 //CodeWarrior or Win32 compiler?
 #if defined(__CWCC__) || defined(_WIN32)
    #pragma pack(push, 1)
@@ -159,6 +159,29 @@ error_t mqttSnClientRegisterPublishCallback(MqttSnClientContext *context,
 }
 
 
+/**
+ * @brief Register publish completion callback function
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @param[in] callback Callback function to be called when the QoS protocol
+ *   exchange of a pipelined message is complete
+ * @return Error code
+ **/
+
+error_t mqttSnClientRegisterPublishCompleteCallback(MqttSnClientContext *context,
+   MqttSnClientPublishCompleteCallback callback)
+{
+   //Make sure the MQTT-SN client context is valid
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save callback function
+   context->publishCompleteCallback = callback;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Set the list of predefined topics
  * @param[in] context Pointer to the MQTT-SN client context
@@ -520,9 +543,11 @@ error_t mqttSnClientConnect(MqttSnClientContext *context, bool_t cleanSession)
             //Check whether the CleanSession flag is set
             if(cleanSession)
             {
-               //Discard previous session state
-               memset(context->topicTable, 0, sizeof(context->topicTable));
+               //Discard previous session state. The topic names are cached so
+               //that they can be registered again
+               mqttSnClientInvalidateTopics(context);
                memset(context->msgIdTable, 0, sizeof(context->msgIdTable));
+               mqttSnClientFlushInflight(context);
             }
 
             //The CONNECT message is sent by a client to setup a connection
@@ -574,6 +599,9 @@ error_t mqttSnClientConnect(MqttSnClientContext *context, bool_t cleanSession)
             {
                //The connection request has been accepted by the gateway
                context->state = MQTT_SN_CLIENT_STATE_ACTIVE;
+
+               //Messages left over from the previous connection are resent
+               mqttSnClientRetransmitInflight(context);
             }
             else
             {
@@ -616,8 +644,136 @@ error_t mqttSnClientConnect(MqttSnClientContext *context, bool_t cleanSession)
 }
 
 
+/**
+ * @brief Register a topic name
+ *
+ * Long topic names must be registered before they can be published. The
+ * registration is normally performed on demand by mqttSnClientPublish, but
+ * it can be done in advance to keep the REGISTER/REGACK exchange off the
+ * publishing path
+ *
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @param[in] topicName Topic name
+ * @return Error code
+ **/
+
+error_t mqttSnClientRegisterTopic(MqttSnClientContext *context,
+   const char_t *topicName)
+{
+   error_t error;
+   systime_t time;
+
+   //Check parameters
+   if(context == NULL || topicName == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Register procedure
+   while(!error)
+   {
+      //Get current time
+      time = osGetSystemTime();
+
+      //Check current state
+      if(context->state == MQTT_SN_CLIENT_STATE_ACTIVE)
+      {
+         //Short topic names and predefined topic IDs are never registered
+         if(mqttSnClientIsShortTopicName(topicName) ||
+            mqttSnClientFindTopicName(context, topicName) != MQTT_SN_INVALID_TOPIC_ID ||
+            mqttSnClientFindPredefTopicName(context, topicName) != MQTT_SN_INVALID_TOPIC_ID)
+         {
+            //The topic ID is known
+            break;
+         }
+
+         //Save current time
+         context->startTime = time;
+
+         //The message identifier allows the sender to match a message with
+         //its corresponding acknowledgment
+         mqttSnClientGenerateMessageId(context);
+
+         //To register a topic name a client sends a REGISTER message to
+         //the gateway
+         error = mqttSnClientSendRegister(context, topicName);
+      }
+      else if(context->state == MQTT_SN_CLIENT_STATE_SENDING_REQ)
+      {
+         //Check whether the timeout has elapsed
+         if(timeCompare(time, context->startTime + context->timeout) >= 0)
+         {
+            //Abort the retransmission procedure
+            context->state = MQTT_SN_CLIENT_STATE_DISCONNECTING;
+            //Report a timeout error
+            error = ERROR_TIMEOUT;
+         }
+         else if(timeCompare(time, context->retransmitStartTime +
+            MQTT_SN_CLIENT_RETRY_TIMEOUT) >= 0)
+         {
+            //If the retry timer times out and the expected gateway's reply
+            //is not received, the client retransmits the message
+            error = mqttSnClientSendRegister(context, topicName);
+         }
+         else
+         {
+            //Wait for the gateway's reply
+            error = mqttSnClientProcessEvents(context, MQTT_SN_CLIENT_TICK_INTERVAL);
+         }
+      }
+      else if(context->state == MQTT_SN_CLIENT_STATE_RESP_RECEIVED)
+      {
+         //Update MQTT-SN client state
+         context->state = MQTT_SN_CLIENT_STATE_ACTIVE;
+
+         //Check the type of the received message
+         if(context->msgType == MQTT_SN_MSG_TYPE_REGACK)
+         {
+            //If the registration has not been accepted, the failure reason is
+            //encoded in the return code field of the REGACK message
+            if(context->returnCode == MQTT_SN_RETURN_CODE_ACCEPTED)
+            {
+               //Save the topic ID assigned by the gateway
+               error = mqttSnClientAddTopic(context, topicName, context->topicId);
+            }
+            else
+            {
+               //The registration request has been rejected by the gateway
+               error = ERROR_REQUEST_REJECTED;
+            }
+         }
+         else
+         {
+            //Report an error
+            error = ERROR_UNEXPECTED_RESPONSE;
+         }
+      }
+      else
+      {
+         //Invalid state
+         error = ERROR_NOT_CONNECTED;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Publish message
+ *
+ * When a publish completion callback has been registered, QoS 1 and QoS 2
+ * messages are pipelined: the function returns as soon as the message has
+ * been sent, and the completion of the QoS protocol exchange is reported
+ * through the callback. Up to MQTT_SN_CLIENT_MAX_INFLIGHT messages can be
+ * outstanding at a time. Otherwise the function waits for the gateway's
+ * acknowledgment.
+ *
+ * QoS -1 messages can be sent without any connection setup, provided that
+ * the topic is a short topic name or a predefined topic
+ *
  * @param[in] context Pointer to the MQTT-SN client context
  * @param[in] topicName Topic name
  * @param[in] message Message payload
@@ -636,7 +792,9 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
 {
    error_t error;
    systime_t time;
+   systime_t startTime;
    uint16_t publishMsgId;
+   MqttSnClientInflightEntry *entry;
 
    //Check parameters
    if(context == NULL || topicName == NULL)
@@ -646,9 +804,66 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
    if(dup && msgId == NULL)
       return ERROR_INVALID_PARAMETER;
 
+   //QoS -1 messages are fire-and-forget
+   if(qos == MQTT_SN_QOS_LEVEL_MINUS_1)
+   {
+      //Only short topic names and predefined topic IDs can be used, since
+      //there is no registration procedure
+      if(!mqttSnClientIsShortTopicName(topicName) &&
+         mqttSnClientFindPredefTopicName(context, topicName) == MQTT_SN_INVALID_TOPIC_ID)
+      {
+         return ERROR_INVALID_PARAMETER;
+      }
+
+      //The message identifier is not relevant
+      if(msgId != NULL)
+         *msgId = 0;
+
+      //Check current state
+      if(context->state == MQTT_SN_CLIENT_STATE_DISCONNECTED)
+      {
+         //No connection setup is possible over DTLS
+         if(context->transportProtocol != MQTT_SN_TRANSPORT_PROTOCOL_UDP)
+            return ERROR_NOT_CONNECTED;
+
+         //Open a plain UDP socket for the duration of the transmission
+         error = mqttSnClientOpenConnection(context, FALSE);
+
+         //Check status code
+         if(!error)
+         {
+            //Send the PUBLISH message to the gateway
+            error = mqttSnClientSendPublish(context, 0, topicName, message,
+               length, qos, retain, FALSE);
+         }
+
+         //Close the socket
+         mqttSnClientCloseConnection(context);
+      }
+      else if(context->state == MQTT_SN_CLIENT_STATE_ACTIVE ||
+         context->state == MQTT_SN_CLIENT_STATE_SENDING_REQ ||
+         context->state == MQTT_SN_CLIENT_STATE_RESP_RECEIVED)
+      {
+         //Send the PUBLISH message over the current connection
+         error = mqttSnClientSendPublish(context, 0, topicName, message,
+            length, qos, retain, FALSE);
+      }
+      else
+      {
+         //Invalid state
+         error = ERROR_WRONG_STATE;
+      }
+
+      //Return status code
+      return error;
+   }
+
    //Initialize status code
    error = NO_ERROR;
 
+   //Save current time
+   startTime = osGetSystemTime();
+
    //Initialize message identifier
    if(dup)
       publishMsgId = *msgId;
@@ -672,13 +887,57 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
             mqttSnClientFindTopicName(context, topicName) == 0 &&
             mqttSnClientFindPredefTopicName(context, topicName) == 0)
          {
-            //The message identifier allows the sender to match a message with
-            //its corresponding acknowledgment
-            mqttSnClientGenerateMessageId(context);
+            //Register the topic name before publishing
+            error = mqttSnClientRegisterTopic(context, topicName);
+         }
+         else if((qos == MQTT_SN_QOS_LEVEL_1 || qos == MQTT_SN_QOS_LEVEL_2) &&
+            !dup && context->publishCompleteCallback != NULL)
+         {
+            //Pipelined messages require a free entry in the in-flight window
+            entry = mqttSnClientAllocInflightEntry(context);
 
-            //To register a topic name a client sends a REGISTER message to
-            //the gateway
-            error = mqttSnClientSendRegister(context, topicName);
+            //Any free entry?
+            if(entry != NULL)
+            {
+               //The message identifier allows the sender to match a message
+               //with its corresponding acknowledgment
+               publishMsgId = mqttSnClientGenerateMessageId(context);
+
+               //Send PUBLISH message
+               error = mqttSnClientSendPublish(context, publishMsgId,
+                  topicName, message, length, qos, retain, FALSE);
+
+               //Check status code
+               if(!error)
+               {
+                  //Track the message until the QoS protocol exchange
+                  //completes
+                  error = mqttSnClientAddInflightEntry(context, entry,
+                     publishMsgId, qos);
+
+                  //Successful processing?
+                  if(!error)
+                     break;
+
+                  //The message is too large to be stored, so the client
+                  //waits for the gateway's reply instead
+                  error = NO_ERROR;
+                  context->retransmitStartTime = time;
+                  context->state = MQTT_SN_CLIENT_STATE_SENDING_REQ;
+                  context->msgType = MQTT_SN_MSG_TYPE_PUBLISH;
+               }
+            }
+            else if(timeCompare(time, startTime + context->timeout) >= 0)
+            {
+               //No message has been acknowledged in time
+               error = ERROR_TIMEOUT;
+            }
+            else
+            {
+               //The window is full. Process incoming acknowledgments until
+               //an entry is released
+               error = mqttSnClientProcessEvents(context, MQTT_SN_CLIENT_TICK_INTERVAL);
+            }
          }
          else
          {
@@ -705,6 +964,11 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
             //is performed by the sender
             if(qos != MQTT_SN_QOS_LEVEL_1 && qos != MQTT_SN_QOS_LEVEL_2)
                break;
+
+            //Wait for the gateway's reply
+            context->retransmitStartTime = time;
+            context->state = MQTT_SN_CLIENT_STATE_SENDING_REQ;
+            context->msgType = MQTT_SN_MSG_TYPE_PUBLISH;
          }
       }
       else if(context->state == MQTT_SN_CLIENT_STATE_SENDING_REQ)
@@ -732,12 +996,7 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
          {
             //If the retry timer times out and the expected gateway's reply
             //is not received, the client retransmits the message
-            if(context->msgType == MQTT_SN_MSG_TYPE_REGISTER)
-            {
-               //Retransmit REGISTER message
-               error = mqttSnClientSendRegister(context, topicName);
-            }
-            else if(context->msgType == MQTT_SN_MSG_TYPE_PUBLISH)
+            if(context->msgType == MQTT_SN_MSG_TYPE_PUBLISH)
             {
                //Retransmit PUBLISH message
                error = mqttSnClientSendPublish(context, publishMsgId,
@@ -753,6 +1012,9 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
                //Report an error
                error = ERROR_INVALID_TYPE;
             }
+
+            //Restart the retry timer
+            context->retransmitStartTime = time;
          }
          else
          {
@@ -777,22 +1039,7 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
          }
 
          //Check the type of the received message
-         if(context->msgType == MQTT_SN_MSG_TYPE_REGACK)
-         {
-            //If the registration has not been accepted, the failure reason is
-            //encoded in the return code field of the REGACK message
-            if(context->returnCode == MQTT_SN_RETURN_CODE_ACCEPTED)
-            {
-               //Save the topic ID assigned by the gateway
-               error = mqttSnClientAddTopic(context, topicName, context->topicId);
-            }
-            else
-            {
-               //The registration request has been rejected by the gateway
-               error = ERROR_REQUEST_REJECTED;
-            }
-         }
-         else if(context->msgType == MQTT_SN_MSG_TYPE_PUBACK)
+         if(context->msgType == MQTT_SN_MSG_TYPE_PUBACK)
          {
             //If the publish request has not been accepted, the failure reason
             //is encoded in the return code field of the PUBACK message
@@ -824,6 +1071,11 @@ error_t mqttSnClientPublish(MqttSnClientContext *context,
                //A PUBREL packet is the response to a PUBREC packet. It is the
                //third packet of the QoS 2 protocol exchange
                error = mqttSnClientSendPubRel(context, context->msgId);
+
+               //Wait for the PUBCOMP message
+               context->retransmitStartTime = time;
+               context->state = MQTT_SN_CLIENT_STATE_SENDING_REQ;
+               context->msgType = MQTT_SN_MSG_TYPE_PUBREL;
             }
             else
             {
@@ -1326,6 +1578,34 @@ error_t mqttSnClientGetReturnCode(MqttSnClientContext *context,
 }
 
 
+/**
+ * @brief Get the number of QoS 1 and QoS 2 messages in flight
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @return Number of messages that have not been fully acknowledged
+ **/
+
+uint_t mqttSnClientGetInflightCount(MqttSnClientContext *context)
+{
+   uint_t i;
+   uint_t n;
+
+   //Make sure the MQTT-SN client context is valid
+   if(context == NULL)
+      return 0;
+
+   //Loop through the in-flight window
+   for(n = 0, i = 0; i < MQTT_SN_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Count the entries that are in use
+      if(context->inflight[i].state != MQTT_SN_INFLIGHT_STATE_NONE)
+         n++;
+   }
+
+   //Return the number of in-flight messages
+   return n;
+}
+
+
 /**
  * @brief Process MQTT-SN client events
  * @param[in] context Pointer to the MQTT-SN client context
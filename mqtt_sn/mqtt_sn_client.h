@@ -64,6 +64,20 @@
    #error MQTT_SN_CLIENT_MSG_ID_TABLE_SIZE parameter is not valid
 #endif
 
+//Maximum number of QoS 1 and QoS 2 messages that can be in flight
+#ifndef MQTT_SN_CLIENT_MAX_INFLIGHT
+   #define MQTT_SN_CLIENT_MAX_INFLIGHT 4
+#elif (MQTT_SN_CLIENT_MAX_INFLIGHT < 1)
+   #error MQTT_SN_CLIENT_MAX_INFLIGHT parameter is not valid
+#endif
+
+//Size of the buffer used to store a copy of each in-flight PUBLISH message
+#ifndef MQTT_SN_CLIENT_INFLIGHT_BUFFER_SIZE
+   #define MQTT_SN_CLIENT_INFLIGHT_BUFFER_SIZE 128
+#elif (MQTT_SN_CLIENT_INFLIGHT_BUFFER_SIZE < 8)
+   #error MQTT_SN_CLIENT_INFLIGHT_BUFFER_SIZE parameter is not valid
+#endif
+
 //Maximum length of the client identifier
 #ifndef MQTT_SN_CLIENT_MAX_ID_LEN
    #define MQTT_SN_CLIENT_MAX_ID_LEN 23
@@ -191,6 +205,27 @@ typedef void (*MqttSnClientPublishCallback)(MqttSnClientContext *context,
    MqttSnQosLevel qos, bool_t retain);
 
 
+/**
+ * @brief Publish completion callback
+ **/
+
+typedef void (*MqttSnClientPublishCompleteCallback)(MqttSnClientContext *context,
+   uint16_t msgId, MqttSnReturnCode returnCode);
+
+
+/**
+ * @brief State of an in-flight message
+ **/
+
+typedef enum
+{
+   MQTT_SN_INFLIGHT_STATE_NONE         = 0,
+   MQTT_SN_INFLIGHT_STATE_WAIT_PUBACK  = 1,
+   MQTT_SN_INFLIGHT_STATE_WAIT_PUBREC  = 2,
+   MQTT_SN_INFLIGHT_STATE_WAIT_PUBCOMP = 3
+} MqttSnClientInflightState;
+
+
 /**
  * @brief Will message
  **/
@@ -212,6 +247,7 @@ typedef struct
 {
    char_t topicName[MQTT_SN_CLIENT_MAX_TOPIC_NAME_LEN + 1]; ///<Topic name
    uint16_t topicId;                                        ///<Topic identifier
+   bool_t valid;                                            ///<The topic ID is valid for the current session
 } MqttSnClientTopicEntry;
 
 
@@ -226,6 +262,21 @@ typedef struct
 } MqttSnClientMsgIdEntry;
 
 
+/**
+ * @brief In-flight QoS 1 or QoS 2 message
+ **/
+
+typedef struct
+{
+   MqttSnClientInflightState state;                     ///<State of the QoS protocol exchange
+   uint16_t msgId;                                      ///<Message identifier
+   systime_t startTime;                                 ///<Time at which the message was first sent
+   systime_t retransmitStartTime;                       ///<Time at which the last message was sent
+   size_t length;                                       ///<Length of the PUBLISH message
+   uint8_t buffer[MQTT_SN_CLIENT_INFLIGHT_BUFFER_SIZE]; ///<Copy of the PUBLISH message
+} MqttSnClientInflightEntry;
+
+
 /**
  * @brief MQTT-SN client context
  **/
@@ -248,6 +299,7 @@ struct _MqttSnClientContext
    MqttSnClientDtlsInitCallback dtlsInitCallback;     ///<DTLS initialization callback
 #endif
    MqttSnClientPublishCallback publishCallback;       ///<PUBLISH message received callback
+   MqttSnClientPublishCompleteCallback publishCompleteCallback; ///<Publish completion callback
    IpAddr gwIpAddr;                                   ///<Gateway IP address
    uint16_t gwPort;                                   ///<Gateway port number
    systime_t startTime;                               ///<Start time
@@ -262,6 +314,7 @@ struct _MqttSnClientContext
    MqttSnReturnCode returnCode;                       ///<Status code returned by the gateway
    MqttSnClientTopicEntry topicTable[MQTT_SN_CLIENT_TOPIC_TABLE_SIZE];
    MqttSnClientMsgIdEntry msgIdTable[MQTT_SN_CLIENT_MSG_ID_TABLE_SIZE];
+   MqttSnClientInflightEntry inflight[MQTT_SN_CLIENT_MAX_INFLIGHT]; ///<In-flight QoS 1 and QoS 2 messages
 };
 
 
@@ -281,6 +334,9 @@ error_t mqttSnClientRegisterDtlsInitCallback(MqttSnClientContext *context,
 error_t mqttSnClientRegisterPublishCallback(MqttSnClientContext *context,
    MqttSnClientPublishCallback callback);
 
+error_t mqttSnClientRegisterPublishCompleteCallback(MqttSnClientContext *context,
+   MqttSnClientPublishCompleteCallback callback);
+
 error_t mqttSnClientSetPredefinedTopics(MqttSnClientContext *context,
    MqttSnPredefinedTopic *predefinedTopics, uint_t size);
 
@@ -308,6 +364,9 @@ error_t mqttSnClientSearchGateway(MqttSnClientContext *context,
 
 error_t mqttSnClientConnect(MqttSnClientContext *context, bool_t cleanSession);
 
+error_t mqttSnClientRegisterTopic(MqttSnClientContext *context,
+   const char_t *topicName);
+
 error_t mqttSnClientPublish(MqttSnClientContext *context,
    const char_t *topicName, const void *message, size_t length,
    MqttSnQosLevel qos, bool_t retain, bool_t dup, uint16_t *msgId);
@@ -327,6 +386,8 @@ error_t mqttSnClientUpdateWillMessage(MqttSnClientContext *context,
 error_t mqttSnClientGetReturnCode(MqttSnClientContext *context,
    MqttSnReturnCode *returnCode);
 
+uint_t mqttSnClientGetInflightCount(MqttSnClientContext *context);
+
 error_t mqttSnClientTask(MqttSnClientContext *context, systime_t timeout);
 
 error_t mqttSnClientDisconnect(MqttSnClientContext *context);
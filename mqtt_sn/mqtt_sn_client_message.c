@@ -519,6 +519,7 @@ error_t mqttSnClientProcessPubAck(MqttSnClientContext *context,
    uint16_t msgId;
    uint16_t topicId;
    MqttSnReturnCode returnCode;
+   MqttSnClientInflightEntry *entry;
 
    //Parse PUBACK message
    error = mqttSnParsePubAck(message, &msgId, &topicId, &returnCode);
@@ -539,6 +540,24 @@ error_t mqttSnClientProcessPubAck(MqttSnClientContext *context,
          //The MQTT-SN gateway is alive
          context->keepAliveCounter = 0;
       }
+      else
+      {
+         //Search the in-flight window for a matching message
+         entry = mqttSnClientFindInflightEntry(context, msgId);
+
+         //A PUBACK message acknowledges a QoS 1 message, or reports the
+         //rejection of a QoS 2 message
+         if(entry != NULL && (entry->state == MQTT_SN_INFLIGHT_STATE_WAIT_PUBACK ||
+            (entry->state == MQTT_SN_INFLIGHT_STATE_WAIT_PUBREC &&
+            returnCode != MQTT_SN_RETURN_CODE_ACCEPTED)))
+         {
+            //The QoS protocol exchange is complete
+            mqttSnClientCompleteInflightEntry(context, entry, returnCode);
+
+            //The MQTT-SN gateway is alive
+            context->keepAliveCounter = 0;
+         }
+      }
    }
 
    //Return status code
@@ -558,6 +577,7 @@ error_t mqttSnClientProcessPubRec(MqttSnClientContext *context,
 {
    error_t error;
    uint16_t msgId;
+   MqttSnClientInflightEntry *entry;
 
    //Parse PUBREC message
    error = mqttSnParsePubRec(message, &msgId);
@@ -577,6 +597,31 @@ error_t mqttSnClientProcessPubRec(MqttSnClientContext *context,
          //The MQTT-SN gateway is alive
          context->keepAliveCounter = 0;
       }
+      else
+      {
+         //Search the in-flight window for a matching message
+         entry = mqttSnClientFindInflightEntry(context, msgId);
+
+         //Check the state of the QoS protocol exchange
+         if(entry != NULL && entry->state == MQTT_SN_INFLIGHT_STATE_WAIT_PUBREC)
+         {
+            //A PUBREL packet is the response to a PUBREC packet. It is the
+            //third packet of the QoS 2 protocol exchange
+            error = mqttSnClientSendPubRel(context, msgId);
+
+            //Wait for the PUBCOMP message
+            entry->state = MQTT_SN_INFLIGHT_STATE_WAIT_PUBCOMP;
+            entry->retransmitStartTime = osGetSystemTime();
+
+            //The MQTT-SN gateway is alive
+            context->keepAliveCounter = 0;
+         }
+         else if(entry != NULL && entry->state == MQTT_SN_INFLIGHT_STATE_WAIT_PUBCOMP)
+         {
+            //The PUBREL message has been lost
+            error = mqttSnClientSendPubRel(context, msgId);
+         }
+      }
    }
 
    //Return status code
@@ -628,6 +673,7 @@ error_t mqttSnClientProcessPubComp(MqttSnClientContext *context,
 {
    error_t error;
    uint16_t msgId;
+   MqttSnClientInflightEntry *entry;
 
    //Parse PUBCOMP message
    error = mqttSnParsePubComp(message, &msgId);
@@ -647,6 +693,22 @@ error_t mqttSnClientProcessPubComp(MqttSnClientContext *context,
          //The MQTT-SN gateway is alive
          context->keepAliveCounter = 0;
       }
+      else
+      {
+         //Search the in-flight window for a matching message
+         entry = mqttSnClientFindInflightEntry(context, msgId);
+
+         //Check the state of the QoS protocol exchange
+         if(entry != NULL && entry->state == MQTT_SN_INFLIGHT_STATE_WAIT_PUBCOMP)
+         {
+            //The QoS 2 protocol exchange is complete
+            mqttSnClientCompleteInflightEntry(context, entry,
+               MQTT_SN_RETURN_CODE_ACCEPTED);
+
+            //The MQTT-SN gateway is alive
+            context->keepAliveCounter = 0;
+         }
+      }
    }
 
    //Return status code
@@ -1184,7 +1246,6 @@ error_t mqttSnClientSendPublish(MqttSnClientContext *context,
    size_t length, MqttSnQosLevel qos, bool_t retain, bool_t dup)
 {
    error_t error;
-   systime_t time;
    uint16_t topicId;
    MqttSnFlags flags;
 
@@ -1260,26 +1321,9 @@ error_t mqttSnClientSendPublish(MqttSnClientContext *context,
       error = mqttSnClientSendDatagram(context, context->message.buffer,
          context->message.length);
 
-      //Get current time
-      time = osGetSystemTime();
-
-      //Check QoS level
-      if(qos == MQTT_SN_QOS_LEVEL_1 || qos == MQTT_SN_QOS_LEVEL_2)
-      {
-         //Save the time at which the message was sent
-         context->retransmitStartTime = time;
-         context->keepAliveTimestamp = time;
-
-         //Update MQTT-SN client state
-         context->state = MQTT_SN_CLIENT_STATE_SENDING_REQ;
-         context->msgType = MQTT_SN_MSG_TYPE_PUBLISH;
-      }
-      else
-      {
-         //In the QoS 0, no response is sent by the receiver and no retry
-         //is performed by the sender
-         context->state = MQTT_SN_CLIENT_STATE_ACTIVE;
-      }
+      //Save the time at which the message was sent. The caller is in charge
+      //of tracking the acknowledgment, if any
+      context->keepAliveTimestamp = osGetSystemTime();
    }
 
    //Return status code
@@ -1368,7 +1412,6 @@ error_t mqttSnClientSendPubRec(MqttSnClientContext *context, uint16_t msgId)
 error_t mqttSnClientSendPubRel(MqttSnClientContext *context, uint16_t msgId)
 {
    error_t error;
-   systime_t time;
 
    //Format PUBREL message
    error = mqttSnFormatPubRel(&context->message, msgId);
@@ -1387,16 +1430,9 @@ error_t mqttSnClientSendPubRel(MqttSnClientContext *context, uint16_t msgId)
       error = mqttSnClientSendDatagram(context, context->message.buffer,
          context->message.length);
 
-      //Get current time
-      time = osGetSystemTime();
-
-      //Save the time at which the message was sent
-      context->retransmitStartTime = time;
-      context->keepAliveTimestamp = time;
-
-      //Update MQTT-SN client state
-      context->state = MQTT_SN_CLIENT_STATE_SENDING_REQ;
-      context->msgType = MQTT_SN_MSG_TYPE_PUBREL;
+      //Save the time at which the message was sent. The caller is in charge
+      //of tracking the PUBCOMP message
+      context->keepAliveTimestamp = osGetSystemTime();
    }
 
    //Return status code
@@ -37,6 +37,7 @@
 #include "mqtt_sn/mqtt_sn_client_message.h"
 #include "mqtt_sn/mqtt_sn_client_transport.h"
 #include "mqtt_sn/mqtt_sn_client_misc.h"
+#include "mqtt_sn/mqtt_sn_debug.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -149,6 +150,19 @@ error_t mqttSnClientProcessEvents(MqttSnClientContext *context,
          }
       }
 
+      //Check status code
+      if(!error)
+      {
+         //Make sure the MQTT-SN client is connected
+         if(context->state == MQTT_SN_CLIENT_STATE_ACTIVE ||
+            context->state == MQTT_SN_CLIENT_STATE_SENDING_REQ ||
+            context->state == MQTT_SN_CLIENT_STATE_RESP_RECEIVED)
+         {
+            //Retransmit in-flight messages that have not been acknowledged
+            error = mqttSnClientCheckInflight(context);
+         }
+      }
+
       //Check whether the timeout has elapsed
    } while(error == NO_ERROR && context->message.length == 0 && d > 0);
 
@@ -254,6 +268,7 @@ error_t mqttSnClientAddTopic(MqttSnClientContext *context,
       {
          //Update topic identifier
          context->topicTable[i].topicId = topicId;
+         context->topicTable[i].valid = TRUE;
 
          //We are done
          return NO_ERROR;
@@ -265,18 +280,33 @@ error_t mqttSnClientAddTopic(MqttSnClientContext *context,
    {
       //Check whether the current entry is free
       if(context->topicTable[i].topicName[0] == '\0')
-      {
-         //Save mapping between topic name and topic ID
-         strcpy(context->topicTable[i].topicName, topicName);
-         context->topicTable[i].topicId = topicId;
+         break;
+   }
 
-         //A new entry has been successfully created
-         return NO_ERROR;
+   //If the table is full, the entries inherited from a previous session are
+   //recycled
+   if(i >= MQTT_SN_CLIENT_TOPIC_TABLE_SIZE)
+   {
+      //Loop through the topic table
+      for(i = 0; i < MQTT_SN_CLIENT_TOPIC_TABLE_SIZE; i++)
+      {
+         //Stale entry?
+         if(!context->topicTable[i].valid)
+            break;
       }
    }
 
-   //The table runs out of entries
-   return ERROR_OUT_OF_RESOURCES;
+   //The table runs out of entries?
+   if(i >= MQTT_SN_CLIENT_TOPIC_TABLE_SIZE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Save mapping between topic name and topic ID
+   strcpy(context->topicTable[i].topicName, topicName);
+   context->topicTable[i].topicId = topicId;
+   context->topicTable[i].valid = TRUE;
+
+   //A new entry has been successfully created
+   return NO_ERROR;
 }
 
 
@@ -300,6 +330,7 @@ error_t mqttSnClientDeleteTopic(MqttSnClientContext *context,
       {
          //Release current entry
          context->topicTable[i].topicName[0] = '\0';
+         context->topicTable[i].valid = FALSE;
 
          //We are done
          return NO_ERROR;
@@ -311,6 +342,25 @@ error_t mqttSnClientDeleteTopic(MqttSnClientContext *context,
 }
 
 
+/**
+ * @brief Invalidate the topic IDs learnt during the previous session
+ * @param[in] context Pointer to the MQTT-SN client context
+ **/
+
+void mqttSnClientInvalidateTopics(MqttSnClientContext *context)
+{
+   uint_t i;
+
+   //The topic names are kept so that they can be registered again without
+   //losing their slot, but the topic IDs assigned by the gateway are no
+   //longer relevant
+   for(i = 0; i < MQTT_SN_CLIENT_TOPIC_TABLE_SIZE; i++)
+   {
+      context->topicTable[i].valid = FALSE;
+   }
+}
+
+
 /**
  * @brief Retrieve the topic name associated with a given topic ID
  * @param[in] context Pointer to the MQTT-SN client context
@@ -334,7 +384,8 @@ const char_t *mqttSnClientFindTopicId(MqttSnClientContext *context,
       for(i = 0; i < MQTT_SN_CLIENT_TOPIC_TABLE_SIZE; i++)
       {
          //Matching topic identifier?
-         if(context->topicTable[i].topicId == topicId)
+         if(context->topicTable[i].valid &&
+            context->topicTable[i].topicId == topicId)
          {
             //Retrieve the corresponding topic name
             topicName = context->topicTable[i].topicName;
@@ -371,7 +422,8 @@ uint16_t mqttSnClientFindTopicName(MqttSnClientContext *context,
       for(i = 0; i < MQTT_SN_CLIENT_TOPIC_TABLE_SIZE; i++)
       {
          //Matching topic name?
-         if(!strcmp(context->topicTable[i].topicName, topicName))
+         if(context->topicTable[i].valid &&
+            !strcmp(context->topicTable[i].topicName, topicName))
          {
             //Retrieve the corresponding topic identifier
             topicId = context->topicTable[i].topicId;
@@ -589,6 +641,249 @@ bool_t mqttSnClientIsDuplicateMessageId(MqttSnClientContext *context,
 }
 
 
+/**
+ * @brief Retransmit in-flight messages whose retry timer has expired
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @return Error code
+ **/
+
+error_t mqttSnClientCheckInflight(MqttSnClientContext *context)
+{
+   error_t error;
+   uint_t i;
+   systime_t time;
+   MqttSnClientInflightEntry *entry;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_SN_CLIENT_MAX_INFLIGHT && !error; i++)
+   {
+      //Point to the current entry
+      entry = &context->inflight[i];
+
+      //Skip free entries
+      if(entry->state == MQTT_SN_INFLIGHT_STATE_NONE)
+         continue;
+
+      //Check whether the timeout has elapsed
+      if(timeCompare(time, entry->startTime + context->timeout) >= 0)
+      {
+         //The gateway is considered offline
+         context->state = MQTT_SN_CLIENT_STATE_DISCONNECTING;
+         //Report a timeout error
+         error = ERROR_TIMEOUT;
+      }
+      else if(timeCompare(time, entry->retransmitStartTime +
+         MQTT_SN_CLIENT_RETRY_TIMEOUT) >= 0)
+      {
+         //Check the state of the QoS protocol exchange
+         if(entry->state == MQTT_SN_INFLIGHT_STATE_WAIT_PUBCOMP)
+         {
+            //The PUBLISH message has already been acknowledged, so the
+            //PUBREL message is resent instead
+            error = mqttSnClientSendPubRel(context, entry->msgId);
+         }
+         else
+         {
+            //Debug message
+            TRACE_INFO("Resending PUBLISH message (%" PRIuSIZE " bytes)...\r\n",
+               entry->length);
+
+            //Dump the contents of the message for debugging purpose
+            mqttSnDumpMessage(entry->buffer, entry->length);
+
+            //Retransmit the copy of the PUBLISH message
+            error = mqttSnClientSendDatagram(context, entry->buffer,
+               entry->length);
+
+            //Save the time at which the message was sent
+            context->keepAliveTimestamp = time;
+         }
+
+         //Restart the retry timer
+         entry->retransmitStartTime = time;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Allocate a free entry in the in-flight window
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @return Pointer to the free entry (NULL if the window is full)
+ **/
+
+MqttSnClientInflightEntry *mqttSnClientAllocInflightEntry(
+   MqttSnClientContext *context)
+{
+   uint_t i;
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_SN_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Check whether the current entry is free
+      if(context->inflight[i].state == MQTT_SN_INFLIGHT_STATE_NONE)
+         return &context->inflight[i];
+   }
+
+   //The window is full
+   return NULL;
+}
+
+
+/**
+ * @brief Search the in-flight window for a given message identifier
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @param[in] msgId Message identifier
+ * @return Pointer to the matching entry (NULL if not found)
+ **/
+
+MqttSnClientInflightEntry *mqttSnClientFindInflightEntry(
+   MqttSnClientContext *context, uint16_t msgId)
+{
+   uint_t i;
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_SN_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Matching message identifier?
+      if(context->inflight[i].state != MQTT_SN_INFLIGHT_STATE_NONE &&
+         context->inflight[i].msgId == msgId)
+      {
+         return &context->inflight[i];
+      }
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+
+/**
+ * @brief Add the PUBLISH message that has just been sent to the window
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @param[in] entry Free entry of the in-flight window
+ * @param[in] msgId Message identifier
+ * @param[in] qos QoS level of the message
+ * @return Error code
+ **/
+
+error_t mqttSnClientAddInflightEntry(MqttSnClientContext *context,
+   MqttSnClientInflightEntry *entry, uint16_t msgId, MqttSnQosLevel qos)
+{
+   size_t n;
+   MqttSnFlags *flags;
+
+   //Make sure the message fits in the entry
+   if(context->message.length > MQTT_SN_CLIENT_INFLIGHT_BUFFER_SIZE)
+      return ERROR_BUFFER_OVERFLOW;
+
+   //Keep a copy of the message so that it can be retransmitted
+   memcpy(entry->buffer, context->message.buffer, context->message.length);
+   entry->length = context->message.length;
+
+   //The Length field is either 1 or 3 octets long, and is followed by the
+   //MsgType field and by the Flags field
+   n = (entry->buffer[0] == 0x01) ? 4 : 2;
+
+   //Sanity check
+   if(n >= entry->length)
+      return ERROR_INVALID_LENGTH;
+
+   //The DUP flag is set for every retransmission of the message
+   flags = (MqttSnFlags *) (entry->buffer + n);
+   flags->dup = TRUE;
+
+   //Save the message identifier
+   entry->msgId = msgId;
+
+   //Start the retry timer
+   entry->startTime = osGetSystemTime();
+   entry->retransmitStartTime = entry->startTime;
+
+   //Wait for the acknowledgment from the gateway
+   if(qos == MQTT_SN_QOS_LEVEL_1)
+      entry->state = MQTT_SN_INFLIGHT_STATE_WAIT_PUBACK;
+   else
+      entry->state = MQTT_SN_INFLIGHT_STATE_WAIT_PUBREC;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release an in-flight message once the QoS exchange is complete
+ * @param[in] context Pointer to the MQTT-SN client context
+ * @param[in] entry Pointer to the in-flight entry
+ * @param[in] returnCode Return code reported by the gateway
+ **/
+
+void mqttSnClientCompleteInflightEntry(MqttSnClientContext *context,
+   MqttSnClientInflightEntry *entry, MqttSnReturnCode returnCode)
+{
+   //Release the entry
+   entry->state = MQTT_SN_INFLIGHT_STATE_NONE;
+
+   //Any registered callback?
+   if(context->publishCompleteCallback != NULL)
+   {
+      //Invoke user callback function
+      context->publishCompleteCallback(context, entry->msgId, returnCode);
+   }
+}
+
+
+/**
+ * @brief Discard all in-flight messages
+ * @param[in] context Pointer to the MQTT-SN client context
+ **/
+
+void mqttSnClientFlushInflight(MqttSnClientContext *context)
+{
+   uint_t i;
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_SN_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //Release current entry
+      context->inflight[i].state = MQTT_SN_INFLIGHT_STATE_NONE;
+   }
+}
+
+
+/**
+ * @brief Schedule the retransmission of all in-flight messages
+ * @param[in] context Pointer to the MQTT-SN client context
+ **/
+
+void mqttSnClientRetransmitInflight(MqttSnClientContext *context)
+{
+   uint_t i;
+   systime_t time;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the in-flight window
+   for(i = 0; i < MQTT_SN_CLIENT_MAX_INFLIGHT; i++)
+   {
+      //The messages are resent as soon as the session is resumed
+      context->inflight[i].startTime = time;
+      context->inflight[i].retransmitStartTime = time -
+         MQTT_SN_CLIENT_RETRY_TIMEOUT;
+   }
+}
+
+
 /**
  * @brief Check whether a topic name is a short topic name
  * @param[in] topicName Topic name
@@ -53,6 +53,8 @@ error_t mqttSnClientAddTopic(MqttSnClientContext *context,
 error_t mqttSnClientDeleteTopic(MqttSnClientContext *context,
    const char_t *topicName);
 
+void mqttSnClientInvalidateTopics(MqttSnClientContext *context);
+
 const char_t *mqttSnClientFindTopicId(MqttSnClientContext *context,
    uint16_t topicId);
 
@@ -76,6 +78,23 @@ error_t mqttSnClientDiscardMessageId(MqttSnClientContext *context,
 bool_t mqttSnClientIsDuplicateMessageId(MqttSnClientContext *context,
    uint16_t msgId);
 
+error_t mqttSnClientCheckInflight(MqttSnClientContext *context);
+
+MqttSnClientInflightEntry *mqttSnClientAllocInflightEntry(
+   MqttSnClientContext *context);
+
+MqttSnClientInflightEntry *mqttSnClientFindInflightEntry(
+   MqttSnClientContext *context, uint16_t msgId);
+
+error_t mqttSnClientAddInflightEntry(MqttSnClientContext *context,
+   MqttSnClientInflightEntry *entry, uint16_t msgId, MqttSnQosLevel qos);
+
+void mqttSnClientCompleteInflightEntry(MqttSnClientContext *context,
+   MqttSnClientInflightEntry *entry, MqttSnReturnCode returnCode);
+
+void mqttSnClientFlushInflight(MqttSnClientContext *context);
+void mqttSnClientRetransmitInflight(MqttSnClientContext *context);
+
 bool_t mqttSnClientIsShortTopicName(const char_t *topicName);
 
 //C++ guard
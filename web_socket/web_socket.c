@@ -39,6 +39,7 @@
 #include "web_socket/web_socket_frame.h"
 #include "web_socket/web_socket_transport.h"
 #include "web_socket/web_socket_misc.h"
+#include "web_socket/web_socket_deflate.h"
 #include "str.h"
 #include "encoding/base64.h"
 #include "debug.h"
@@ -129,6 +130,14 @@ WebSocket *webSocketOpen(void)
          {
             //Set the default timeout to be used
             webSocket->timeout = INFINITE_DELAY;
+
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+            //The permessage-deflate extension is offered or accepted by default
+            webSocket->deflateEnabled = TRUE;
+            webSocket->deflateMaxWindowBits = WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS;
+            webSocket->deflateNoContextTakeover = FALSE;
+#endif
+
             //Enter the CLOSED state
             webSocket->state = WS_STATE_CLOSED;
 
@@ -370,6 +379,77 @@ error_t webSocketSetAuthInfo(WebSocket *webSocket, const char_t *username,
 }
 
 
+/**
+ * @brief Configure the permessage-deflate extension
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] enabled Offer (client) or accept (server) the extension
+ * @param[in] maxWindowBits Maximum LZ77 window size, expressed as a base-2
+ *   logarithm, used in either direction. This value bounds the amount of
+ *   history kept by the compressor and the decompressor
+ * @param[in] noContextTakeover Reset the compressor after each message
+ * @return Error code
+ **/
+
+error_t webSocketSetDeflateParams(WebSocket *webSocket, bool_t enabled,
+   uint_t maxWindowBits, bool_t noContextTakeover)
+{
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //Make sure the WebSocket handle is valid
+   if(webSocket == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The window size cannot exceed the size of the buffers
+   if(maxWindowBits < WS_DEFLATE_MIN_WINDOW_BITS ||
+      maxWindowBits > WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Save parameters
+   webSocket->deflateEnabled = enabled;
+   webSocket->deflateMaxWindowBits = maxWindowBits;
+   webSocket->deflateNoContextTakeover = noContextTakeover;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //The permessage-deflate extension is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Retrieve permessage-deflate statistics
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[out] stats Compression statistics
+ * @return Error code
+ **/
+
+error_t webSocketGetDeflateStats(WebSocket *webSocket,
+   WebSocketDeflateStats *stats)
+{
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //Check parameters
+   if(webSocket == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The extension must have been negotiated
+   if(webSocket->deflateContext == NULL)
+      return ERROR_WRONG_STATE;
+
+   //Copy statistics
+   *stats = webSocket->deflateContext->stats;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //The permessage-deflate extension is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Bind the WebSocket to a particular network interface
  * @param[in] webSocket Handle to a WebSocket
@@ -648,6 +728,48 @@ error_t webSocketConnect(WebSocket *webSocket, const IpAddr *serverIpAddr,
 }
 
 
+/**
+ * @brief Set the extensions requested by the client
+ *
+ * This function must be called before webSocketSetClientKey, when the
+ * client's handshake has been parsed by the HTTP server
+ *
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] extensions NULL-terminated string that holds the value of the
+ *   Sec-WebSocket-Extensions header field
+ * @return Error code
+ **/
+
+error_t webSocketSetClientExtensions(WebSocket *webSocket,
+   const char_t *extensions)
+{
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   char_t buffer[WEB_SOCKET_EXTENSIONS_MAX_LEN + 1];
+
+   //Check parameters
+   if(webSocket == NULL || extensions == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the length of the string
+   if(strlen(extensions) > WEB_SOCKET_EXTENSIONS_MAX_LEN)
+      return ERROR_INVALID_LENGTH;
+
+   //The string is modified while it is being parsed
+   strcpy(buffer, extensions);
+
+   //a WebSocket server is a WebSocket endpoint that awaits
+   //connections from peers
+   webSocket->endpoint = WS_ENDPOINT_SERVER;
+
+   //Accept the permessage-deflate extension, if offered
+   return webSocketParseExtensionsField(webSocket, buffer);
+#else
+   //No extension is supported
+   return NO_ERROR;
+#endif
+}
+
+
 /**
  * @brief Set client's key
  * @param[in] webSocket Handle to a WebSocket
@@ -967,18 +1089,14 @@ error_t webSocketSend(WebSocket *webSocket, const void *data,
  * @param[out] written Actual number of bytes written (optional parameter)
  * @param[in] firstFrag First fragment of the message
  * @param[in] lastFrag Last fragment of the message
+ * @return Error code
  **/
 
 error_t webSocketSendEx(WebSocket *webSocket, const void *data, size_t length,
    WebSocketFrameType type, size_t *written, bool_t firstFrag, bool_t lastFrag)
 {
    error_t error;
-   size_t i;
-   size_t j;
-   size_t k;
    size_t n;
-   const uint8_t *p;
-   WebSocketFrameContext *txContext;
 
    //Check parameters
    if(webSocket == NULL || data == NULL)
@@ -990,133 +1108,99 @@ error_t webSocketSendEx(WebSocket *webSocket, const void *data, size_t length,
    if(webSocket->state != WS_STATE_OPEN)
       return ERROR_NOT_CONNECTED;
 
-   //Point to the TX context
-   txContext = &webSocket->txContext;
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //The permessage-deflate extension applies to data messages only
+   if(webSocket->deflateContext != NULL &&
+      (type == WS_FRAME_TYPE_TEXT || type == WS_FRAME_TYPE_BINARY))
+   {
+      //Compress the data and send them
+      return webSocketSendCompressedData(webSocket, data, length, type,
+         written, firstFrag, lastFrag);
+   }
+#endif
 
-   //Initialize status code
-   error = NO_ERROR;
+   //A fragmented message consists of a single frame with the FIN bit
+   //clear and an opcode other than 0, followed by zero or more frames
+   //with the FIN bit clear and the opcode set to 0, and terminated by
+   //a single frame with the FIN bit set and an opcode of 0
+   if(!firstFrag)
+      type = WS_FRAME_TYPE_CONTINUATION;
 
-   //Point to the application data to be written
-   p = (const uint8_t *) data;
-   //No data has been transmitted yet
-   i = 0;
+   //Send the data
+   error = webSocketSendFrame(webSocket, data, length, type, lastFrag, &n);
 
-   //Send as much data as possible
-   while(1)
-   {
-      //Check current sub-state
-      if(txContext->state == WS_SUB_STATE_INIT)
-      {
-         //A fragmented message consists of a single frame with the FIN bit
-         //clear and an opcode other than 0, followed by zero or more frames
-         //with the FIN bit clear and the opcode set to 0, and terminated by
-         //a single frame with the FIN bit set and an opcode of 0
-         if(!firstFrag)
-            type = WS_FRAME_TYPE_CONTINUATION;
-
-         //Format WebSocket frame header
-         error = webSocketFormatFrameHeader(webSocket, lastFrag, type, length - i);
-
-         //Send the frame header
-         txContext->state = WS_SUB_STATE_FRAME_HEADER;
-      }
-      else if(txContext->state == WS_SUB_STATE_FRAME_HEADER)
-      {
-         //Any remaining data to be sent?
-         if(txContext->bufferPos < txContext->bufferLen)
-         {
-            //Send more data
-            error = webSocketSendData(webSocket,
-               txContext->buffer + txContext->bufferPos,
-               txContext->bufferLen - txContext->bufferPos, &n, 0);
+   //Total number of data that have been written
+   if(written != NULL)
+      *written = n;
 
-            //Advance data pointer
-            txContext->bufferPos += n;
-         }
-         else
-         {
-            //Flush the transmit buffer
-            txContext->payloadPos = 0;
-            txContext->bufferPos = 0;
-            txContext->bufferLen = 0;
+   //Return status code
+   return error;
+}
 
-            //Send the payload of the WebSocket frame
-            txContext->state = WS_SUB_STATE_FRAME_PAYLOAD;
-         }
-      }
-      else if(txContext->state == WS_SUB_STATE_FRAME_PAYLOAD)
-      {
-         //Any remaining data to be sent?
-         if(txContext->bufferPos < txContext->bufferLen)
-         {
-            //Send more data
-            error = webSocketSendData(webSocket,
-               txContext->buffer + txContext->bufferPos,
-               txContext->bufferLen - txContext->bufferPos, &n, 0);
 
-            //Advance data pointer
-            txContext->payloadPos += n;
-            txContext->bufferPos += n;
+/**
+ * @brief Transmit a message whose payload is split across several buffers
+ *
+ * The buffers are sent as a single WebSocket frame, without being gathered
+ * in an intermediate buffer first
+ *
+ * @param[in] webSocket Handle that identifies a WebSocket
+ * @param[in] iov Array of buffers holding the data to be transmitted
+ * @param[in] iovCount Number of entries in the array
+ * @param[in] type Frame type
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @return Error code
+ **/
 
-            //Total number of data that have been written
-            i += n;
-         }
-         else
-         {
-            //Send as much data as possible
-            if(txContext->payloadPos < txContext->payloadLen)
-            {
-               //Calculate the number of bytes that are pending
-               n = MIN(length - i, txContext->payloadLen - txContext->payloadPos);
-               //Limit the number of bytes to be copied at a time
-               n = MIN(n, WEB_SOCKET_BUFFER_SIZE);
+error_t webSocketSendV(WebSocket *webSocket, const WebSocketIoVec *iov,
+   uint_t iovCount, WebSocketFrameType type, size_t *written)
+{
+   error_t error;
+   size_t n;
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   uint_t k;
+   size_t m;
+#endif
 
-               //Copy application data to the transmit buffer
-               memcpy(txContext->buffer, p, n);
+   //Check parameters
+   if(webSocket == NULL || iov == NULL || iovCount == 0)
+      return ERROR_INVALID_PARAMETER;
 
-               //All frames sent from the client to the server are masked
-               if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
-               {
-                  //Apply masking
-                  for(j = 0; j < n; j++)
-                  {
-                     //Index of the masking key to be applied
-                     k = (txContext->payloadPos + j) % 4;
-                     //Convert unmasked data into masked data
-                     txContext->buffer[j] = p[i + j] ^ txContext->maskingKey[k];
-                  }
-               }
+   //A data frame may be transmitted by either the client or the server at
+   //any time after opening handshake completion and before that endpoint
+   //has sent a Close frame
+   if(webSocket->state != WS_STATE_OPEN)
+      return ERROR_NOT_CONNECTED;
 
-               //Rewind to the beginning of the buffer
-               txContext->bufferPos = 0;
-               //Update the number of data buffered but not yet sent
-               txContext->bufferLen = n;
-            }
-            else
-            {
-               //Prepare to send a new WebSocket frame
-               txContext->state = WS_SUB_STATE_INIT;
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //The permessage-deflate extension applies to data messages only
+   if(webSocket->deflateContext != NULL &&
+      (type == WS_FRAME_TYPE_TEXT || type == WS_FRAME_TYPE_BINARY))
+   {
+      //Initialize status code
+      error = NO_ERROR;
 
-               //Write operation complete?
-               if(i >= length)
-                  break;
-            }
-         }
-      }
-      else
+      //The buffers are fed to the compressor one after the other
+      for(n = 0, k = 0; k < iovCount && !error; k++)
       {
-         //Invalid state
-         error = ERROR_WRONG_STATE;
-      }
+         //Compress the data and send them
+         error = webSocketSendCompressedData(webSocket, iov[k].data,
+            iov[k].length, type, &m, k == 0, k == (iovCount - 1));
 
-      //Any error to report?
-      if(error)
-         break;
+         //Total number of data that have been written
+         n += m;
+      }
+   }
+   else
+#endif
+   {
+      //Send the data
+      error = webSocketSendFrameV(webSocket, iov, iovCount, type, TRUE, &n);
    }
 
    //Total number of data that have been written
    if(written != NULL)
-      *written = i;
+      *written = n;
 
    //Return status code
    return error;
@@ -1161,7 +1245,6 @@ error_t webSocketReceiveEx(WebSocket *webSocket, void *data, size_t size,
 {
    error_t error;
    size_t i;
-   size_t j;
    size_t k;
    size_t n;
    WebSocketFrame *frame;
@@ -1294,6 +1377,33 @@ error_t webSocketReceiveEx(WebSocket *webSocket, void *data, size_t size,
             rxContext->state = WS_SUB_STATE_FRAME_PAYLOAD;
          }
       }
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+      else if(rxContext->state == WS_SUB_STATE_FRAME_PAYLOAD &&
+         rxContext->compressed &&
+         rxContext->controlFrameType == WS_FRAME_TYPE_CONTINUATION)
+      {
+         //Decompress the payload of the data frame
+         error = webSocketReceiveCompressedData(webSocket,
+            (data != NULL) ? (uint8_t *) data + i : NULL, size - i, &n);
+
+         //Total number of data that have been read
+         i += n;
+
+         //The payload has been entirely decompressed?
+         if(!error && rxContext->state == WS_SUB_STATE_INIT)
+         {
+            //Last fragment of the message?
+            if(rxContext->fin)
+            {
+               if(lastFrag != NULL)
+                  *lastFrag = TRUE;
+
+               //Exit immediately
+               break;
+            }
+         }
+      }
+#endif
       else if(rxContext->state == WS_SUB_STATE_FRAME_PAYLOAD)
       {
          if(rxContext->payloadPos < rxContext->payloadLen)
@@ -1310,13 +1420,8 @@ error_t webSocketReceiveEx(WebSocket *webSocket, void *data, size_t size,
             if(rxContext->mask)
             {
                //Unmask the data
-               for(j = 0; j < n; j++)
-               {
-                  //Index of the masking key to be applied
-                  k = (rxContext->payloadPos + j) % 4;
-                  //Convert masked data into unmasked data
-                  rxContext->buffer[j] ^= rxContext->maskingKey[k];
-               }
+               webSocketApplyMask(rxContext->buffer, rxContext->buffer, n,
+                  rxContext->maskingKey, rxContext->payloadPos);
             }
 
             //Text frame?
@@ -1565,6 +1670,11 @@ void webSocketClose(WebSocket *webSocket)
       tlsFreeSessionState(&webSocket->tlsSession);
 #endif
 
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+      //Release permessage-deflate context
+      webSocketReleaseDeflateContext(webSocket);
+#endif
+
       //Release the WebSocket
       webSocketChangeState(webSocket, WS_STATE_UNUSED);
    }
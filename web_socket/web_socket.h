@@ -70,6 +70,13 @@
    #error WEB_SOCKET_DIGEST_AUTH_SUPPORT parameter is not valid
 #endif
 
+//permessage-deflate extension support
+#ifndef WEB_SOCKET_DEFLATE_SUPPORT
+   #define WEB_SOCKET_DEFLATE_SUPPORT DISABLED
+#elif (WEB_SOCKET_DEFLATE_SUPPORT != ENABLED && WEB_SOCKET_DEFLATE_SUPPORT != DISABLED)
+   #error WEB_SOCKET_DEFLATE_SUPPORT parameter is not valid
+#endif
+
 //Maximum number of connection attempts
 #ifndef WEB_SOCKET_MAX_CONN_RETRIES
    #define WEB_SOCKET_MAX_CONN_RETRIES 3
@@ -161,6 +168,13 @@
    #error WEB_SOCKET_CNONCE_SIZE parameter is not valid
 #endif
 
+//Maximum length of the Sec-WebSocket-Extensions header field
+#ifndef WEB_SOCKET_EXTENSIONS_MAX_LEN
+   #define WEB_SOCKET_EXTENSIONS_MAX_LEN 64
+#elif (WEB_SOCKET_EXTENSIONS_MAX_LEN < 1)
+   #error WEB_SOCKET_EXTENSIONS_MAX_LEN parameter is not valid
+#endif
+
 //TLS supported?
 #if (WEB_SOCKET_TLS_SUPPORT == ENABLED)
    #include "core/crypto.h"
@@ -176,6 +190,10 @@
 struct _WebSocket;
 #define WebSocket struct _WebSocket
 
+//Forward declaration of WebSocketDeflateContext structure
+struct _WebSocketDeflateContext;
+#define WebSocketDeflateContext struct _WebSocketDeflateContext
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -387,6 +405,17 @@ typedef struct
 } WebSocketHandshakeContext;
 
 
+/**
+ * @brief Scatter-gather buffer descriptor
+ **/
+
+typedef struct
+{
+   const void *data; ///<Pointer to the data
+   size_t length;    ///<Length of the data, in bytes
+} WebSocketIoVec;
+
+
 /**
  * @brief Frame encoding/decoding context
  **/
@@ -404,6 +433,9 @@ typedef struct
    uint8_t buffer[WEB_SOCKET_BUFFER_SIZE]; ///<Data buffer
    size_t bufferLen;                       ///<Length of the data buffer
    size_t bufferPos;                       ///<Current position
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   bool_t compressed;                      ///<Compressed message (RSV1 bit)
+#endif
 } WebSocketFrameContext;
 
 
@@ -419,6 +451,25 @@ typedef struct
 } WebSocketUtf8Context;
 
 
+/**
+ * @brief permessage-deflate statistics
+ **/
+
+typedef struct
+{
+   uint32_t txMessageCount;    ///<Number of compressed messages sent
+   uint32_t txRawBytes;        ///<Number of bytes before compression
+   uint32_t txCompressedBytes; ///<Number of bytes after compression
+   systime_t txTime;           ///<Time spent compressing data
+   systime_t txMaxTime;        ///<Longest time spent compressing a message
+   uint32_t rxMessageCount;    ///<Number of compressed messages received
+   uint32_t rxCompressedBytes; ///<Number of bytes before decompression
+   uint32_t rxRawBytes;        ///<Number of bytes after decompression
+   systime_t rxTime;           ///<Time spent decompressing data
+   systime_t rxMaxTime;        ///<Longest time spent decompressing a message
+} WebSocketDeflateStats;
+
+
 /**
  * @brief Structure describing a WebSocket
  **/
@@ -450,6 +501,12 @@ struct _WebSocket
    WebSocketFrameContext txContext;
    WebSocketFrameContext rxContext;
    WebSocketUtf8Context utf8Context;
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   bool_t deflateEnabled;                    ///<Offer or accept the permessage-deflate extension
+   uint_t deflateMaxWindowBits;              ///<Maximum LZ77 window size (base-2 logarithm)
+   bool_t deflateNoContextTakeover;          ///<Reset the compression context after each message
+   WebSocketDeflateContext *deflateContext;  ///<permessage-deflate context
+#endif
 };
 
 
@@ -482,11 +539,20 @@ error_t webSocketSetSubProtocol(WebSocket *webSocket, const char_t *subProtocol)
 error_t webSocketSetAuthInfo(WebSocket *webSocket, const char_t *username,
    const char_t *password, uint_t allowedAuthModes);
 
+error_t webSocketSetDeflateParams(WebSocket *webSocket, bool_t enabled,
+   uint_t maxWindowBits, bool_t noContextTakeover);
+
+error_t webSocketGetDeflateStats(WebSocket *webSocket,
+   WebSocketDeflateStats *stats);
+
 error_t webSocketBindToInterface(WebSocket *webSocket, NetInterface *interface);
 
 error_t webSocketConnect(WebSocket *webSocket, const IpAddr *serverIpAddr,
    uint16_t serverPort, const char_t *uri);
 
+error_t webSocketSetClientExtensions(WebSocket *webSocket,
+   const char_t *extensions);
+
 error_t webSocketSetClientKey(WebSocket *webSocket, const char_t *clientKey);
 error_t webSocketParseClientHandshake(WebSocket *webSocket);
 error_t webSocketSendServerHandshake(WebSocket *webSocket);
@@ -500,6 +566,9 @@ error_t webSocketSend(WebSocket *webSocket, const void *data,
 error_t webSocketSendEx(WebSocket *webSocket, const void *data, size_t length,
    WebSocketFrameType type, size_t *written, bool_t firstFrag, bool_t lastFrag);
 
+error_t webSocketSendV(WebSocket *webSocket, const WebSocketIoVec *iov,
+   uint_t iovCount, WebSocketFrameType type, size_t *written);
+
 error_t webSocketReceive(WebSocket *webSocket, void *data,
    size_t size, WebSocketFrameType *type, size_t *received);
 
@@ -0,0 +1,1809 @@
+/**
+ * @file web_socket_deflate.c
+ * @brief permessage-deflate extension (RFC 7692)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The permessage-deflate extension compresses the payload of data messages
+ * using the DEFLATE algorithm (RFC 1951). The compressor relies on a hash
+ * chain LZ77 match finder and fixed Huffman codes. The decompressor accepts
+ * any valid DEFLATE stream and can be suspended at any point, so that both
+ * directions operate on bounded buffers regardless of the message size.
+ * Refer to RFC 7692 for more details
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL WEB_SOCKET_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "web_socket/web_socket.h"
+#include "web_socket/web_socket_frame.h"
+#include "web_socket/web_socket_transport.h"
+#include "web_socket/web_socket_misc.h"
+#include "web_socket/web_socket_deflate.h"
+#include "str.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (WEB_SOCKET_SUPPORT == ENABLED && WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+
+//Empty stored block removed from the end of each compressed message
+static const uint8_t webSocketDeflateTrailer[4] = {0x00, 0x00, 0xFF, 0xFF};
+
+//Base lengths for length codes 257..285
+static const uint16_t lengthBase[29] =
+{
+   3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+//Extra bits for length codes 257..285
+static const uint8_t lengthExtra[29] =
+{
+   0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+//Base offsets for distance codes 0..29
+static const uint16_t distBase[30] =
+{
+   1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+   8193, 12289, 16385, 24577
+};
+
+//Extra bits for distance codes 0..29
+static const uint8_t distExtra[30] =
+{
+   0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+//Order in which the code length code lengths are transmitted
+static const uint8_t codeLengthOrder[19] =
+{
+   16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+/**
+ * @brief Allocate and initialize permessage-deflate context
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] txWindowBits LZ77 window size used by the local compressor
+ * @param[in] rxWindowBits LZ77 window size used by the remote compressor
+ * @param[in] txNoContextTakeover Reset the compressor after each message
+ * @param[in] rxNoContextTakeover Reset the decompressor after each message
+ * @return Error code
+ **/
+
+error_t webSocketInitDeflateContext(WebSocket *webSocket, uint_t txWindowBits,
+   uint_t rxWindowBits, bool_t txNoContextTakeover, bool_t rxNoContextTakeover)
+{
+   WebSocketDeflateContext *context;
+
+   //Release previous context, if any
+   webSocketReleaseDeflateContext(webSocket);
+
+   //Allocate a memory buffer to hold the compression state
+   context = osAllocMem(sizeof(WebSocketDeflateContext));
+   //Failed to allocate memory?
+   if(context == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Clear the context
+   memset(context, 0, sizeof(WebSocketDeflateContext));
+
+   //Save negotiated parameters
+   context->txWindowBits = txWindowBits;
+   context->rxWindowBits = rxWindowBits;
+   context->txNoContextTakeover = txNoContextTakeover;
+   context->rxNoContextTakeover = rxNoContextTakeover;
+
+   //Initialize Huffman decoding tables
+   context->rxLitTable.symbol = context->rxLitSymbols;
+   context->rxDistTable.symbol = context->rxDistSymbols;
+
+   //Initialize the compressor and the decompressor
+   webSocketResetCompressor(context);
+   webSocketResetDecompressor(context);
+
+   //Debug message
+   TRACE_INFO("WebSocket: permessage-deflate enabled (TX window = %u bits, RX window = %u bits)\r\n",
+      txWindowBits, rxWindowBits);
+
+   //Attach the context to the WebSocket
+   webSocket->deflateContext = context;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release permessage-deflate context
+ * @param[in] webSocket Handle to a WebSocket
+ **/
+
+void webSocketReleaseDeflateContext(WebSocket *webSocket)
+{
+   //Any context attached to the WebSocket?
+   if(webSocket->deflateContext != NULL)
+   {
+      //Release previously allocated memory
+      osFreeMem(webSocket->deflateContext);
+      webSocket->deflateContext = NULL;
+   }
+}
+
+
+/**
+ * @brief Parse a window size parameter
+ * @param[in] value NULL-terminated string that contains the parameter value
+ * @param[out] windowBits Window size (base-2 logarithm)
+ * @return Error code
+ **/
+
+error_t webSocketParseWindowBits(char_t *value, uint_t *windowBits)
+{
+   size_t n;
+   char_t *p;
+
+   //The value may be specified as a quoted string
+   n = strlen(value);
+
+   //Remove the quotes, if any
+   if(n >= 2 && value[0] == '\"' && value[n - 1] == '\"')
+   {
+      value[n - 1] = '\0';
+      value++;
+   }
+
+   //The value must be a decimal integer with no leading zeros
+   if(value[0] < '1' || value[0] > '9')
+      return ERROR_INVALID_SYNTAX;
+
+   //Convert the string to integer
+   *windowBits = strtoul(value, &p, 10);
+
+   //Syntax error?
+   if(*p != '\0')
+      return ERROR_INVALID_SYNTAX;
+
+   //The value must be in the range 8 to 15
+   if(*windowBits < WS_DEFLATE_MIN_WINDOW_BITS ||
+      *windowBits > WS_DEFLATE_MAX_WINDOW_BITS)
+   {
+      return ERROR_INVALID_SYNTAX;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse Sec-WebSocket-Extensions header field
+ *
+ * A server accepts the first permessage-deflate offer that is compatible
+ * with its configuration. A client fails the connection if the server's
+ * response contains anything but a valid permessage-deflate response
+ *
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] value NULL-terminated string that contains the value of header field
+ * @return Error code
+ **/
+
+error_t webSocketParseExtensionsField(WebSocket *webSocket, char_t *value)
+{
+   error_t error;
+   bool_t valid;
+   bool_t serverNoContextTakeover;
+   bool_t clientNoContextTakeover;
+   uint_t serverMaxWindowBits;
+   uint_t clientMaxWindowBits;
+   uint_t txWindowBits;
+   uint_t rxWindowBits;
+   char_t *p;
+   char_t *q;
+   char_t *token;
+   char_t *param;
+   char_t *separator;
+
+   //Get the first extension of the list
+   token = strtok_r(value, ",", &p);
+
+   //Parse the comma-separated list of extensions
+   while(token != NULL)
+   {
+      //Get the name of the extension
+      param = strtok_r(token, ";", &q);
+      param = (param != NULL) ? strTrimWhitespace(param) : "";
+
+      //permessage-deflate extension?
+      if(!strcasecmp(param, "permessage-deflate"))
+      {
+         //Initialize extension parameters
+         valid = TRUE;
+         serverNoContextTakeover = FALSE;
+         clientNoContextTakeover = FALSE;
+         serverMaxWindowBits = 0;
+         clientMaxWindowBits = 0;
+
+         //Get the first parameter
+         param = strtok_r(NULL, ";", &q);
+
+         //Parse the list of extension parameters
+         while(param != NULL && valid)
+         {
+            //Check whether a value is present
+            separator = strchr(param, '=');
+
+            //Split the parameter
+            if(separator != NULL)
+            {
+               *separator = '\0';
+               separator = strTrimWhitespace(separator + 1);
+            }
+
+            //Trim whitespace characters
+            param = strTrimWhitespace(param);
+
+            //Check parameter name
+            if(!strcasecmp(param, "server_no_context_takeover"))
+            {
+               //This parameter has no value and must not appear twice
+               if(separator != NULL || serverNoContextTakeover)
+                  valid = FALSE;
+
+               serverNoContextTakeover = TRUE;
+            }
+            else if(!strcasecmp(param, "client_no_context_takeover"))
+            {
+               //This parameter has no value and must not appear twice
+               if(separator != NULL || clientNoContextTakeover)
+                  valid = FALSE;
+
+               clientNoContextTakeover = TRUE;
+            }
+            else if(!strcasecmp(param, "server_max_window_bits"))
+            {
+               //This parameter has a value and must not appear twice
+               if(separator == NULL || serverMaxWindowBits != 0)
+                  valid = FALSE;
+               else if(webSocketParseWindowBits(separator, &serverMaxWindowBits))
+                  valid = FALSE;
+            }
+            else if(!strcasecmp(param, "client_max_window_bits"))
+            {
+               //This parameter must not appear twice
+               if(clientMaxWindowBits != 0)
+               {
+                  valid = FALSE;
+               }
+               else if(separator != NULL)
+               {
+                  //Parse the value of the parameter
+                  if(webSocketParseWindowBits(separator, &clientMaxWindowBits))
+                     valid = FALSE;
+               }
+               else if(webSocket->endpoint == WS_ENDPOINT_SERVER)
+               {
+                  //The client supports any window size it may be asked for
+                  clientMaxWindowBits = WS_DEFLATE_MAX_WINDOW_BITS;
+               }
+               else
+               {
+                  //A server response must specify a value
+                  valid = FALSE;
+               }
+            }
+            else
+            {
+               //Unknown extension parameter
+               valid = FALSE;
+            }
+
+            //Get next parameter
+            param = strtok_r(NULL, ";", &q);
+         }
+
+         //Client or server operation?
+         if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
+         {
+            //The client must fail the connection if the server accepts an
+            //extension that was not offered, or accepts it more than once
+            if(!webSocket->deflateEnabled || webSocket->deflateContext != NULL)
+               return ERROR_INVALID_SYNTAX;
+
+            //Malformed response?
+            if(!valid)
+               return ERROR_INVALID_SYNTAX;
+
+            //Window size used by the server to compress data
+            if(serverMaxWindowBits != 0)
+               rxWindowBits = serverMaxWindowBits;
+            else
+               rxWindowBits = WS_DEFLATE_MAX_WINDOW_BITS;
+
+            //The server must comply with the limit specified in the offer
+            if(rxWindowBits > webSocket->deflateMaxWindowBits)
+               return ERROR_INVALID_SYNTAX;
+
+            //Window size used by the client to compress data
+            txWindowBits = webSocket->deflateMaxWindowBits;
+
+            //The server may request a smaller window
+            if(clientMaxWindowBits != 0)
+               txWindowBits = MIN(txWindowBits, clientMaxWindowBits);
+
+            //Allocate compression context
+            error = webSocketInitDeflateContext(webSocket, txWindowBits,
+               rxWindowBits, clientNoContextTakeover ||
+               webSocket->deflateNoContextTakeover, serverNoContextTakeover);
+            //Any error to report?
+            if(error)
+               return error;
+         }
+         else
+         {
+            //Skip the offer if the extension is disabled or has already been
+            //accepted
+            if(webSocket->deflateEnabled && webSocket->deflateContext == NULL)
+            {
+               //Unless the client indicates that it can limit its own window,
+               //it may use up to 32KB of history
+               if(clientMaxWindowBits == 0 &&
+                  webSocket->deflateMaxWindowBits < WS_DEFLATE_MAX_WINDOW_BITS)
+               {
+                  valid = FALSE;
+               }
+
+               //Acceptable offer?
+               if(valid)
+               {
+                  //Window size used by the server to compress data
+                  txWindowBits = webSocket->deflateMaxWindowBits;
+
+                  //The client may request a smaller window
+                  if(serverMaxWindowBits != 0)
+                     txWindowBits = MIN(txWindowBits, serverMaxWindowBits);
+
+                  //Window size used by the client to compress data
+                  if(clientMaxWindowBits != 0)
+                     rxWindowBits = MIN(clientMaxWindowBits, webSocket->deflateMaxWindowBits);
+                  else
+                     rxWindowBits = WS_DEFLATE_MAX_WINDOW_BITS;
+
+                  //Allocate compression context
+                  error = webSocketInitDeflateContext(webSocket, txWindowBits,
+                     rxWindowBits, serverNoContextTakeover ||
+                     webSocket->deflateNoContextTakeover, clientNoContextTakeover);
+
+                  //Failed to allocate memory?
+                  if(error)
+                  {
+                     //The connection proceeds without compression
+                     TRACE_WARNING("WebSocket: permessage-deflate offer declined!\r\n");
+                  }
+               }
+            }
+         }
+      }
+      else
+      {
+         //The server must not accept an extension that was not offered
+         if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
+            return ERROR_INVALID_SYNTAX;
+      }
+
+      //Get next extension
+      token = strtok_r(NULL, ",", &p);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format Sec-WebSocket-Extensions header field
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[out] output Buffer where to format the header field
+ * @return Total length of the header field
+ **/
+
+size_t webSocketAddExtensionsField(WebSocket *webSocket, char_t *output)
+{
+   size_t n;
+   WebSocketDeflateContext *context;
+
+   //Point to the permessage-deflate context
+   context = webSocket->deflateContext;
+
+   //Client or server operation?
+   if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
+   {
+      //Check whether the extension should be offered
+      if(!webSocket->deflateEnabled)
+         return 0;
+
+      //The client indicates that it can limit the size of its own window
+      n = sprintf(output, "Sec-WebSocket-Extensions: permessage-deflate; "
+         "client_max_window_bits");
+
+      //Limit the size of the window used by the server
+      if(webSocket->deflateMaxWindowBits < WS_DEFLATE_MAX_WINDOW_BITS)
+      {
+         n += sprintf(output + n, "; server_max_window_bits=%u",
+            webSocket->deflateMaxWindowBits);
+      }
+
+      //The client will not use context takeover
+      if(webSocket->deflateNoContextTakeover)
+         n += sprintf(output + n, "; client_no_context_takeover");
+   }
+   else
+   {
+      //Check whether an offer has been accepted
+      if(context == NULL)
+         return 0;
+
+      //Accept the permessage-deflate extension
+      n = sprintf(output, "Sec-WebSocket-Extensions: permessage-deflate");
+
+      //The server will not use context takeover
+      if(context->txNoContextTakeover)
+         n += sprintf(output + n, "; server_no_context_takeover");
+
+      //The client has announced that it will not use context takeover
+      if(context->rxNoContextTakeover)
+         n += sprintf(output + n, "; client_no_context_takeover");
+
+      //Size of the window used by the server
+      if(context->txWindowBits < WS_DEFLATE_MAX_WINDOW_BITS)
+      {
+         n += sprintf(output + n, "; server_max_window_bits=%u",
+            context->txWindowBits);
+      }
+
+      //Limit the size of the window used by the client
+      if(context->rxWindowBits < WS_DEFLATE_MAX_WINDOW_BITS)
+      {
+         n += sprintf(output + n, "; client_max_window_bits=%u",
+            context->rxWindowBits);
+      }
+   }
+
+   //Terminate the header field with a CRLF sequence
+   n += sprintf(output + n, "\r\n");
+
+   //Return the total length of the header field
+   return n;
+}
+
+
+/**
+ * @brief Send a compressed frame
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] type Frame type
+ * @return Error code
+ **/
+
+error_t webSocketSendDeflateFrame(WebSocket *webSocket,
+   WebSocketFrameType type)
+{
+   error_t error;
+   size_t n;
+   WebSocketDeflateContext *context;
+
+   //Point to the permessage-deflate context
+   context = webSocket->deflateContext;
+
+   //Only the first frame of the message carries the frame type
+   if(context->txMessageOpen)
+      type = WS_FRAME_TYPE_CONTINUATION;
+
+   //The RSV1 bit is set on the first frame of a compressed message
+   webSocket->txContext.compressed = TRUE;
+
+   //Send the compressed data
+   error = webSocketSendFrame(webSocket, context->txBuffer + context->txBufferPos,
+      context->txBufferLen - context->txBufferPos, type, context->txFin, &n);
+
+   //Restore the default behavior
+   webSocket->txContext.compressed = FALSE;
+
+   //Advance data pointer
+   context->txBufferPos += n;
+
+   //Check status code
+   if(!error)
+   {
+      //Update statistics
+      context->stats.txCompressedBytes += context->txBufferLen;
+
+      //Flush the buffer
+      context->txBufferLen = 0;
+      context->txBufferPos = 0;
+
+      //The following frames are continuation frames, unless the message
+      //is complete
+      context->txMessageOpen = !context->txFin;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Compress and transmit data over the WebSocket connection
+ * @param[in] webSocket Handle that identifies a WebSocket
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of data bytes to send
+ * @param[in] type Frame type
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] firstFrag First fragment of the message
+ * @param[in] lastFrag Last fragment of the message
+ * @return Error code
+ **/
+
+error_t webSocketSendCompressedData(WebSocket *webSocket, const void *data,
+   size_t length, WebSocketFrameType type, size_t *written,
+   bool_t firstFrag, bool_t lastFrag)
+{
+   error_t error;
+   size_t i;
+   systime_t time;
+   const uint8_t *p;
+   WebSocketDeflateContext *context;
+
+   //Point to the permessage-deflate context
+   context = webSocket->deflateContext;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Point to the application data to be written
+   p = (const uint8_t *) data;
+   //No data has been transmitted yet
+   i = 0;
+
+   //Complete the transmission of a frame that has been interrupted
+   if(context->txBufferLen > 0 &&
+      webSocket->txContext.state != WS_SUB_STATE_INIT)
+   {
+      error = webSocketSendDeflateFrame(webSocket, type);
+   }
+
+   //Beginning of a new message?
+   if(firstFrag && !context->txMessageOpen)
+      context->txMessageTime = 0;
+
+   //Compress as much data as possible
+   while(!error)
+   {
+      //Save current time
+      time = osGetSystemTime();
+
+      //Not enough room in the buffer for another symbol?
+      if((context->txBufferLen + WEB_SOCKET_DEFLATE_MARGIN) > WEB_SOCKET_DEFLATE_BUFFER_SIZE)
+      {
+         //Send the compressed data as a non-final fragment
+         context->txFin = FALSE;
+         error = webSocketSendDeflateFrame(webSocket, type);
+      }
+      else if(i < length)
+      {
+         //Copy the data to the sliding window
+         i += webSocketDeflateFill(context, p + i, length - i);
+
+         //Compress the data, keeping enough lookahead to find matches
+         //that span several chunks of input
+         webSocketDeflateData(context, FALSE);
+      }
+      else if(context->txWindowPos < context->txWindowLen)
+      {
+         //Compress the remaining data
+         webSocketDeflateData(context, TRUE);
+      }
+      else
+      {
+         //The data must be flushed so that the receiver can decode them. The
+         //trailing empty stored block is omitted at the end of the message
+         webSocketDeflateFlush(context, lastFrag);
+
+         //Update statistics
+         context->txMessageTime += osGetSystemTime() - time;
+
+         //Send the compressed data
+         context->txFin = lastFrag;
+         error = webSocketSendDeflateFrame(webSocket, type);
+
+         //End of message?
+         if(!error && lastFrag)
+         {
+            //Update statistics
+            context->stats.txMessageCount++;
+            context->stats.txTime += context->txMessageTime;
+            context->stats.txMaxTime = MAX(context->stats.txMaxTime,
+               context->txMessageTime);
+
+            //The compressor may not reuse the sliding window for the next
+            //message
+            if(context->txNoContextTakeover)
+               webSocketResetCompressor(context);
+         }
+
+         //We are done
+         break;
+      }
+
+      //Update statistics
+      context->txMessageTime += osGetSystemTime() - time;
+   }
+
+   //Update statistics
+   context->stats.txRawBytes += i;
+
+   //Total number of data that have been written
+   if(written != NULL)
+      *written = i;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Receive and decompress data from a WebSocket connection
+ * @param[in] webSocket Handle that identifies a WebSocket
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @return Error code
+ **/
+
+error_t webSocketReceiveCompressedData(WebSocket *webSocket, void *data,
+   size_t size, size_t *received)
+{
+   error_t error;
+   size_t i;
+   size_t k;
+   size_t m;
+   size_t n;
+   systime_t time;
+   uint8_t *output;
+   uint8_t buffer[64];
+   WebSocketFrameContext *rxContext;
+   WebSocketDeflateContext *context;
+
+   //Point to the RX context
+   rxContext = &webSocket->rxContext;
+   //Point to the permessage-deflate context
+   context = webSocket->deflateContext;
+
+   //Initialize status code
+   error = NO_ERROR;
+   //No data has been read yet
+   i = 0;
+
+   //Read as much data as possible
+   while(i < size)
+   {
+      //The decompressed data are discarded if no buffer is supplied
+      if(data != NULL)
+      {
+         output = (uint8_t *) data + i;
+         m = size - i;
+      }
+      else
+      {
+         output = buffer;
+         m = MIN(size - i, sizeof(buffer));
+      }
+
+      //Save current time
+      time = osGetSystemTime();
+
+      //Decompress the data
+      error = webSocketInflateData(context, rxContext->buffer + rxContext->bufferPos,
+         rxContext->bufferLen - rxContext->bufferPos, &k, output, m, &n);
+
+      //Update statistics
+      context->rxMessageTime += osGetSystemTime() - time;
+      context->stats.rxRawBytes += n;
+
+      //Advance data pointers
+      rxContext->bufferPos += k;
+      i += n;
+
+      //Check status code
+      if(!error)
+      {
+         //Text frame?
+         if(rxContext->dataFrameType == WS_FRAME_TYPE_TEXT)
+         {
+            //Invalid UTF-8 sequence?
+            if(!webSocketCheckUtf8Stream(&webSocket->utf8Context, output, n, 0))
+               error = ERROR_INVALID_FRAME;
+         }
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+
+      //The decompressor stops when the input is exhausted or when the output
+      //buffer is full
+      if(rxContext->bufferPos < rxContext->bufferLen || n >= m)
+         continue;
+
+      //Check whether the whole payload has been read
+      if(rxContext->payloadPos < rxContext->payloadLen)
+      {
+         //Limit the number of bytes to read at a time
+         n = MIN(rxContext->payloadLen - rxContext->payloadPos,
+            WEB_SOCKET_BUFFER_SIZE);
+
+         //Read more data
+         error = webSocketReceiveData(webSocket, rxContext->buffer, n, &n, 0);
+
+         //All frames sent from the client to the server are masked
+         if(rxContext->mask)
+         {
+            //Unmask the data
+            webSocketApplyMask(rxContext->buffer, rxContext->buffer, n,
+               rxContext->maskingKey, rxContext->payloadPos);
+         }
+
+         //Update statistics
+         context->stats.rxCompressedBytes += n;
+
+         //Advance data pointer
+         rxContext->payloadPos += n;
+         //Decompress the data
+         rxContext->bufferPos = 0;
+         rxContext->bufferLen = n;
+      }
+      else if(rxContext->fin && !context->rxTrailer)
+      {
+         //Append the 4 octets that were removed by the sender
+         memcpy(rxContext->buffer, webSocketDeflateTrailer,
+            sizeof(webSocketDeflateTrailer));
+
+         //Decompress the trailer
+         rxContext->bufferPos = 0;
+         rxContext->bufferLen = sizeof(webSocketDeflateTrailer);
+         context->rxTrailer = TRUE;
+      }
+      else
+      {
+         //End of message?
+         if(rxContext->fin)
+         {
+            //The decompressor must stop on a block boundary
+            if(context->rxState != WS_INFLATE_STATE_HEADER &&
+               context->rxState != WS_INFLATE_STATE_DONE)
+            {
+               error = ERROR_INVALID_FRAME;
+            }
+
+            //Text message?
+            if(rxContext->dataFrameType == WS_FRAME_TYPE_TEXT)
+            {
+               //The UTF-8 stream must be properly terminated
+               if(webSocket->utf8Context.utf8CharIndex != 0)
+                  error = ERROR_INVALID_FRAME;
+            }
+
+            //Update statistics
+            context->stats.rxMessageCount++;
+            context->stats.rxTime += context->rxMessageTime;
+            context->stats.rxMaxTime = MAX(context->stats.rxMaxTime,
+               context->rxMessageTime);
+
+            //Prepare to decode the next message
+            context->rxState = WS_INFLATE_STATE_HEADER;
+            context->rxBitBuffer = 0;
+            context->rxBitCount = 0;
+            context->rxTrailer = FALSE;
+            context->rxMessageTime = 0;
+
+            //The decompressor may not reuse the sliding window for the next
+            //message
+            if(context->rxNoContextTakeover)
+               webSocketResetDecompressor(context);
+         }
+
+         //Flush the receive buffer
+         rxContext->bufferPos = 0;
+         rxContext->bufferLen = 0;
+
+         //Decode the next WebSocket frame
+         rxContext->state = WS_SUB_STATE_INIT;
+         break;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+   }
+
+   //Malformed compressed data?
+   if(error == ERROR_INVALID_FRAME)
+   {
+      //The endpoint must fail the WebSocket connection
+      webSocket->statusCode = WS_STATUS_CODE_INVALID_PAYLOAD_DATA;
+   }
+
+   //Return the total number of data that have been read
+   *received = i;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Reset the compressor
+ * @param[in] context Pointer to the permessage-deflate context
+ **/
+
+void webSocketResetCompressor(WebSocketDeflateContext *context)
+{
+   //Flush the sliding window
+   context->txWindowLen = 0;
+   context->txWindowPos = 0;
+
+   //Clear the hash table
+   memset(context->txHead, 0, sizeof(context->txHead));
+
+   //Flush the bit buffer
+   context->txBitBuffer = 0;
+   context->txBitCount = 0;
+   context->txBlockOpen = FALSE;
+}
+
+
+/**
+ * @brief Copy data to the sliding window
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] data Pointer to the data to be compressed
+ * @param[in] length Number of bytes available
+ * @return Number of bytes that have been copied
+ **/
+
+size_t webSocketDeflateFill(WebSocketDeflateContext *context,
+   const uint8_t *data, size_t length)
+{
+   uint_t i;
+   size_t n;
+
+   //The buffer holds twice the window size. Once it is full, the upper half
+   //is moved down so that a full window of history is always available
+   if(context->txWindowLen >= (2 * WEB_SOCKET_DEFLATE_WINDOW_SIZE) &&
+      context->txWindowPos >= WEB_SOCKET_DEFLATE_WINDOW_SIZE)
+   {
+      //Slide the window
+      memmove(context->txWindow, context->txWindow + WEB_SOCKET_DEFLATE_WINDOW_SIZE,
+         WEB_SOCKET_DEFLATE_WINDOW_SIZE);
+
+      //Adjust positions
+      context->txWindowLen -= WEB_SOCKET_DEFLATE_WINDOW_SIZE;
+      context->txWindowPos -= WEB_SOCKET_DEFLATE_WINDOW_SIZE;
+
+      //Update the hash table. Entries that fall out of the window are
+      //discarded
+      for(i = 0; i < WEB_SOCKET_DEFLATE_HASH_SIZE; i++)
+      {
+         if(context->txHead[i] >= WEB_SOCKET_DEFLATE_WINDOW_SIZE)
+            context->txHead[i] -= WEB_SOCKET_DEFLATE_WINDOW_SIZE;
+         else
+            context->txHead[i] = 0;
+      }
+
+      //Update the hash chains
+      for(i = 0; i < WEB_SOCKET_DEFLATE_WINDOW_SIZE; i++)
+      {
+         if(context->txPrev[i] >= WEB_SOCKET_DEFLATE_WINDOW_SIZE)
+            context->txPrev[i] -= WEB_SOCKET_DEFLATE_WINDOW_SIZE;
+         else
+            context->txPrev[i] = 0;
+      }
+   }
+
+   //Limit the number of bytes to copy at a time
+   n = MIN(length, (2 * WEB_SOCKET_DEFLATE_WINDOW_SIZE) - context->txWindowLen);
+
+   //Copy the data
+   memcpy(context->txWindow + context->txWindowLen, data, n);
+   context->txWindowLen += n;
+
+   //Return the number of bytes that have been copied
+   return n;
+}
+
+
+/**
+ * @brief Write bits to the compressed stream
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] value Bits to be written (least significant bit first)
+ * @param[in] length Number of bits
+ **/
+
+void webSocketDeflatePutBits(WebSocketDeflateContext *context,
+   uint32_t value, uint_t length)
+{
+   //Append the bits to the bit buffer
+   context->txBitBuffer |= value << context->txBitCount;
+   context->txBitCount += length;
+
+   //Output complete bytes
+   while(context->txBitCount >= 8)
+   {
+      context->txBuffer[context->txBufferLen++] = context->txBitBuffer & 0xFF;
+      context->txBitBuffer >>= 8;
+      context->txBitCount -= 8;
+   }
+}
+
+
+/**
+ * @brief Write a Huffman code to the compressed stream
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] code Huffman code
+ * @param[in] length Length of the code, in bits
+ **/
+
+void webSocketDeflatePutCode(WebSocketDeflateContext *context,
+   uint_t code, uint_t length)
+{
+   uint_t i;
+   uint32_t value;
+
+   //Huffman codes are packed starting with the most significant bit
+   for(value = 0, i = 0; i < length; i++)
+   {
+      value = (value << 1) | (code & 1);
+      code >>= 1;
+   }
+
+   //Write the code
+   webSocketDeflatePutBits(context, value, length);
+}
+
+
+/**
+ * @brief Encode a literal/length symbol using the fixed Huffman code
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] symbol Literal/length symbol (0-287)
+ **/
+
+void webSocketDeflatePutSymbol(WebSocketDeflateContext *context, uint_t symbol)
+{
+   //The fixed code is defined in RFC 1951, section 3.2.6
+   if(symbol < 144)
+      webSocketDeflatePutCode(context, 0x30 + symbol, 8);
+   else if(symbol < 256)
+      webSocketDeflatePutCode(context, 0x190 + symbol - 144, 9);
+   else if(symbol < 280)
+      webSocketDeflatePutCode(context, symbol - 256, 7);
+   else
+      webSocketDeflatePutCode(context, 0xC0 + symbol - 280, 8);
+}
+
+
+/**
+ * @brief Encode a match
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] length Length of the match
+ * @param[in] distance Distance of the match
+ **/
+
+void webSocketDeflatePutMatch(WebSocketDeflateContext *context,
+   uint_t length, uint_t distance)
+{
+   uint_t i;
+
+   //Search the length code
+   for(i = 28; lengthBase[i] > length; i--)
+   {
+   }
+
+   //Encode the length
+   webSocketDeflatePutSymbol(context, 257 + i);
+   webSocketDeflatePutBits(context, length - lengthBase[i], lengthExtra[i]);
+
+   //Search the distance code
+   for(i = 29; distBase[i] > distance; i--)
+   {
+   }
+
+   //Encode the distance
+   webSocketDeflatePutCode(context, i, 5);
+   webSocketDeflatePutBits(context, distance - distBase[i], distExtra[i]);
+}
+
+
+/**
+ * @brief Compress the data held in the sliding window
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] flush Compress all the data, even if the lookahead is short
+ **/
+
+void webSocketDeflateData(WebSocketDeflateContext *context, bool_t flush)
+{
+   uint_t h;
+   uint_t k;
+   uint_t n;
+   uint_t chain;
+   uint_t candidate;
+   uint_t maxDistance;
+   uint_t matchLen;
+   uint_t matchDist;
+   size_t pos;
+   size_t lookahead;
+   const uint8_t *window;
+
+   //Point to the sliding window
+   window = context->txWindow;
+   //Matches cannot reach further than the negotiated window size
+   maxDistance = 1 << context->txWindowBits;
+
+   //Encode as many symbols as possible
+   while(context->txWindowPos < context->txWindowLen)
+   {
+      //Current position
+      pos = context->txWindowPos;
+      //Number of bytes that remain to be encoded
+      lookahead = context->txWindowLen - pos;
+
+      //Keep enough data to find the longest match, unless the data must
+      //be flushed
+      if(lookahead < WEB_SOCKET_DEFLATE_MIN_LOOKAHEAD && !flush)
+         break;
+
+      //Make sure there is enough room in the buffer
+      if((context->txBufferLen + WEB_SOCKET_DEFLATE_MARGIN) > WEB_SOCKET_DEFLATE_BUFFER_SIZE)
+         break;
+
+      //Start a new block with fixed Huffman codes (BFINAL = 0, BTYPE = 01)
+      if(!context->txBlockOpen)
+      {
+         webSocketDeflatePutBits(context, 0x02, 3);
+         context->txBlockOpen = TRUE;
+      }
+
+      //No match found so far
+      matchLen = 0;
+      matchDist = 0;
+
+      //A match is at least 3 bytes long
+      if(lookahead >= WEB_SOCKET_DEFLATE_MIN_MATCH)
+      {
+         //Hash the next 3 bytes
+         h = ((window[pos] << 16) | (window[pos + 1] << 8) | window[pos + 2]);
+         h = (h * 2654435761U) >> (32 - WEB_SOCKET_DEFLATE_HASH_BITS);
+         h &= WEB_SOCKET_DEFLATE_HASH_SIZE - 1;
+
+         //Insert the current position in the hash chain
+         candidate = context->txHead[h];
+         context->txPrev[pos & (WEB_SOCKET_DEFLATE_WINDOW_SIZE - 1)] = candidate;
+         context->txHead[h] = (uint16_t) pos;
+
+         //Limit the length of the match
+         n = MIN(lookahead, WEB_SOCKET_DEFLATE_MAX_MATCH);
+
+         //Walk through the hash chain
+         for(chain = WEB_SOCKET_DEFLATE_MAX_CHAIN; chain > 0 && candidate != 0 &&
+            candidate < pos && (pos - candidate) <= maxDistance; chain--)
+         {
+            //Quick check on the byte that would extend the best match
+            if(window[candidate + matchLen] == window[pos + matchLen])
+            {
+               //Compute the length of the match
+               for(k = 0; k < n && window[candidate + k] == window[pos + k]; k++)
+               {
+               }
+
+               //Longer match found?
+               if(k > matchLen)
+               {
+                  matchLen = k;
+                  matchDist = pos - candidate;
+
+                  //Longest possible match?
+                  if(k >= n)
+                     break;
+               }
+            }
+
+            //Get the previous position with the same hash value
+            candidate = context->txPrev[candidate & (WEB_SOCKET_DEFLATE_WINDOW_SIZE - 1)];
+         }
+      }
+
+      //Match found?
+      if(matchLen >= WEB_SOCKET_DEFLATE_MIN_MATCH)
+      {
+         //Encode the length/distance pair
+         webSocketDeflatePutMatch(context, matchLen, matchDist);
+
+         //Insert the strings that start within the match in the hash table
+         for(k = 1; k < matchLen && (pos + k + 2) < context->txWindowLen; k++)
+         {
+            h = ((window[pos + k] << 16) | (window[pos + k + 1] << 8) | window[pos + k + 2]);
+            h = (h * 2654435761U) >> (32 - WEB_SOCKET_DEFLATE_HASH_BITS);
+            h &= WEB_SOCKET_DEFLATE_HASH_SIZE - 1;
+
+            context->txPrev[(pos + k) & (WEB_SOCKET_DEFLATE_WINDOW_SIZE - 1)] = context->txHead[h];
+            context->txHead[h] = (uint16_t) (pos + k);
+         }
+
+         //Skip the matched bytes
+         context->txWindowPos += matchLen;
+      }
+      else
+      {
+         //Encode a literal
+         webSocketDeflatePutSymbol(context, window[pos]);
+         context->txWindowPos++;
+      }
+   }
+}
+
+
+/**
+ * @brief Flush the compressed stream on a byte boundary
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] final End of message
+ **/
+
+void webSocketDeflateFlush(WebSocketDeflateContext *context, bool_t final)
+{
+   //Terminate the current block with an end-of-block symbol
+   if(context->txBlockOpen)
+   {
+      webSocketDeflatePutSymbol(context, 256);
+      context->txBlockOpen = FALSE;
+   }
+
+   //Start an empty stored block (BFINAL = 0, BTYPE = 00)
+   webSocketDeflatePutBits(context, 0, 3);
+
+   //Pad to a byte boundary
+   if(context->txBitCount > 0)
+      webSocketDeflatePutBits(context, 0, 8 - context->txBitCount);
+
+   //The LEN and NLEN fields of the stored block are removed at the end of
+   //the message (refer to RFC 7692, section 7.2.1)
+   if(!final)
+   {
+      memcpy(context->txBuffer + context->txBufferLen, webSocketDeflateTrailer,
+         sizeof(webSocketDeflateTrailer));
+
+      context->txBufferLen += sizeof(webSocketDeflateTrailer);
+   }
+}
+
+
+/**
+ * @brief Reset the decompressor
+ * @param[in] context Pointer to the permessage-deflate context
+ **/
+
+void webSocketResetDecompressor(WebSocketDeflateContext *context)
+{
+   //Flush the sliding window
+   context->rxWindowPos = 0;
+   context->rxWindowLen = 0;
+
+   //Wait for a block header
+   context->rxState = WS_INFLATE_STATE_HEADER;
+   context->rxBitBuffer = 0;
+   context->rxBitCount = 0;
+   context->rxTrailer = FALSE;
+}
+
+
+/**
+ * @brief Build a canonical Huffman decoding table
+ * @param[out] table Huffman decoding table
+ * @param[in] lengths Code length of each symbol
+ * @param[in] n Number of symbols
+ * @return Error code
+ **/
+
+error_t webSocketBuildHuffmanTable(WebSocketHuffmanTable *table,
+   const uint8_t *lengths, uint_t n)
+{
+   uint_t i;
+   int_t left;
+   uint16_t offsets[16];
+
+   //Count the number of codes of each length
+   memset(table->count, 0, sizeof(table->count));
+
+   for(i = 0; i < n; i++)
+   {
+      table->count[lengths[i]]++;
+   }
+
+   //Check for an over-subscribed set of lengths
+   for(left = 1, i = 1; i < 16; i++)
+   {
+      left = (left << 1) - table->count[i];
+
+      if(left < 0)
+         return ERROR_INVALID_SYNTAX;
+   }
+
+   //Compute the offset of the first symbol of each length
+   for(offsets[1] = 0, i = 1; i < 15; i++)
+   {
+      offsets[i + 1] = offsets[i] + table->count[i];
+   }
+
+   //Sort the symbols by code
+   for(i = 0; i < n; i++)
+   {
+      if(lengths[i] != 0)
+         table->symbol[offsets[lengths[i]]++] = i;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode a Huffman-coded symbol without consuming it
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] table Huffman decoding table
+ * @param[out] length Length of the code, in bits
+ * @return Decoded symbol, -1 if more bits are needed or -2 if the code is
+ *   not valid
+ **/
+
+int_t webSocketPeekSymbol(WebSocketDeflateContext *context,
+   const WebSocketHuffmanTable *table, uint_t *length)
+{
+   uint_t i;
+   uint_t code;
+   uint_t first;
+   uint_t index;
+   uint_t count;
+
+   //Codes are packed starting with the most significant bit
+   for(code = 0, first = 0, index = 0, i = 1; i < 16; i++)
+   {
+      //Not enough bits in the bit buffer?
+      if(i > context->rxBitCount)
+         return -1;
+
+      //Get the next bit of the code
+      code |= (context->rxBitBuffer >> (i - 1)) & 1;
+      count = table->count[i];
+
+      //Check whether the code has the current length
+      if(code < (first + count))
+      {
+         *length = i;
+         return table->symbol[index + code - first];
+      }
+
+      //Move to the next length
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+   }
+
+   //Invalid code
+   return -2;
+}
+
+
+/**
+ * @brief Read bits from the compressed stream
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] length Number of bits to read
+ * @return Value of the bits
+ **/
+
+uint_t webSocketInflateGetBits(WebSocketDeflateContext *context, uint_t length)
+{
+   uint_t value;
+
+   //Extract the bits
+   value = context->rxBitBuffer & ((1UL << length) - 1);
+
+   //Consume the bits
+   context->rxBitBuffer >>= length;
+   context->rxBitCount -= length;
+
+   //Return the value of the bits
+   return value;
+}
+
+
+/**
+ * @brief Write a decompressed byte
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[out] output Output buffer
+ * @param[in] c Value of the byte
+ **/
+
+void webSocketInflatePutByte(WebSocketDeflateContext *context,
+   uint8_t *output, uint8_t c)
+{
+   //Copy the byte to the output buffer
+   *output = c;
+
+   //Update the sliding window
+   context->rxWindow[context->rxWindowPos] = c;
+   context->rxWindowPos = (context->rxWindowPos + 1) & (WEB_SOCKET_DEFLATE_WINDOW_SIZE - 1);
+
+   //Keep track of the amount of history
+   if(context->rxWindowLen < WEB_SOCKET_DEFLATE_WINDOW_SIZE)
+      context->rxWindowLen++;
+}
+
+
+/**
+ * @brief Decompress data
+ *
+ * The decompressor consumes as much input as possible and stops when either
+ * the input is exhausted or the output buffer is full. Its state is saved so
+ * that the next call resumes where the previous one left off
+ *
+ * @param[in] context Pointer to the permessage-deflate context
+ * @param[in] input Compressed data
+ * @param[in] inputLen Length of the compressed data
+ * @param[out] consumed Number of bytes of compressed data that have been used
+ * @param[out] output Buffer where to store the decompressed data
+ * @param[in] outputSize Size of the output buffer
+ * @param[out] produced Number of bytes of decompressed data
+ * @return Error code
+ **/
+
+error_t webSocketInflateData(WebSocketDeflateContext *context,
+   const uint8_t *input, size_t inputLen, size_t *consumed,
+   uint8_t *output, size_t outputSize, size_t *produced)
+{
+   error_t error;
+   int_t symbol;
+   size_t i;
+   size_t j;
+   uint_t n;
+   uint_t length;
+   uint_t value;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Initialize variables
+   i = 0;
+   j = 0;
+
+   //Decompress as much data as possible
+   while(!error)
+   {
+      //Load as many bytes as possible in the bit buffer. At least 25 bits are
+      //available unless the input is exhausted
+      while(context->rxBitCount <= 24 && i < inputLen)
+      {
+         context->rxBitBuffer |= (uint32_t) input[i++] << context->rxBitCount;
+         context->rxBitCount += 8;
+      }
+
+      //Check current state
+      if(context->rxState == WS_INFLATE_STATE_HEADER)
+      {
+         //Each block starts with a 3-bit header
+         if(context->rxBitCount < 3)
+            break;
+
+         //BFINAL is set on the last block of the data
+         context->rxFinalBlock = webSocketInflateGetBits(context, 1);
+         //BTYPE specifies how the data are compressed
+         value = webSocketInflateGetBits(context, 2);
+
+         //Check block type
+         if(value == 0)
+         {
+            //Stored blocks start on a byte boundary
+            webSocketInflateGetBits(context, context->rxBitCount & 7);
+            context->rxState = WS_INFLATE_STATE_STORED_LEN;
+         }
+         else if(value == 1)
+         {
+            //Fixed Huffman codes (refer to RFC 1951, section 3.2.6)
+            memset(context->rxLengths, 8, 144);
+            memset(context->rxLengths + 144, 9, 112);
+            memset(context->rxLengths + 256, 7, 24);
+            memset(context->rxLengths + 280, 8, 8);
+            memset(context->rxLengths + 288, 5, 32);
+
+            //Build the decoding tables
+            webSocketBuildHuffmanTable(&context->rxLitTable, context->rxLengths, 288);
+            webSocketBuildHuffmanTable(&context->rxDistTable, context->rxLengths + 288, 32);
+
+            //Decode the compressed data
+            context->rxState = WS_INFLATE_STATE_CODES;
+         }
+         else if(value == 2)
+         {
+            //Dynamic Huffman codes
+            context->rxState = WS_INFLATE_STATE_DYN_HEADER;
+         }
+         else
+         {
+            //Reserved block type
+            error = ERROR_INVALID_FRAME;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_STORED_LEN)
+      {
+         //LEN and NLEN are 16-bit fields
+         if(context->rxBitCount < 32)
+            break;
+
+         //Retrieve LEN and NLEN fields
+         context->rxLength = context->rxBitBuffer & 0xFFFF;
+         value = (context->rxBitBuffer >> 16) & 0xFFFF;
+
+         //Flush the bit buffer
+         context->rxBitBuffer = 0;
+         context->rxBitCount = 0;
+
+         //NLEN is the one's complement of LEN
+         if(context->rxLength == (~value & 0xFFFF))
+            context->rxState = WS_INFLATE_STATE_STORED_COPY;
+         else
+            error = ERROR_INVALID_FRAME;
+      }
+      else if(context->rxState == WS_INFLATE_STATE_STORED_COPY)
+      {
+         //Copy uncompressed data
+         while(context->rxLength > 0 && j < outputSize)
+         {
+            //The bit buffer holds whole bytes
+            if(context->rxBitCount >= 8)
+               value = webSocketInflateGetBits(context, 8);
+            else if(i < inputLen)
+               value = input[i++];
+            else
+               break;
+
+            //Write the byte
+            webSocketInflatePutByte(context, output + j++, value);
+            context->rxLength--;
+         }
+
+         //End of block?
+         if(context->rxLength == 0)
+         {
+            if(context->rxFinalBlock)
+               context->rxState = WS_INFLATE_STATE_DONE;
+            else
+               context->rxState = WS_INFLATE_STATE_HEADER;
+         }
+         else
+         {
+            //The input is exhausted or the output buffer is full
+            break;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_DYN_HEADER)
+      {
+         //HLIT, HDIST and HCLEN fields
+         if(context->rxBitCount < 14)
+            break;
+
+         //Retrieve the number of codes of each type
+         context->rxNumLitCodes = webSocketInflateGetBits(context, 5) + 257;
+         context->rxNumDistCodes = webSocketInflateGetBits(context, 5) + 1;
+         context->rxNumCodeLenCodes = webSocketInflateGetBits(context, 4) + 4;
+
+         //Check the number of codes
+         if(context->rxNumLitCodes > 286 || context->rxNumDistCodes > 30)
+            error = ERROR_INVALID_FRAME;
+
+         //Read the code length code lengths
+         memset(context->rxLengths, 0, 19);
+         context->rxIndex = 0;
+         context->rxState = WS_INFLATE_STATE_DYN_CODE_LENS;
+      }
+      else if(context->rxState == WS_INFLATE_STATE_DYN_CODE_LENS)
+      {
+         //Each code length code length is 3 bits long
+         if(context->rxIndex < context->rxNumCodeLenCodes)
+         {
+            if(context->rxBitCount < 3)
+               break;
+
+            context->rxLengths[codeLengthOrder[context->rxIndex++]] =
+               webSocketInflateGetBits(context, 3);
+         }
+         else
+         {
+            //Build the code length decoding table
+            error = webSocketBuildHuffmanTable(&context->rxLitTable,
+               context->rxLengths, 19);
+
+            //Read the literal/length and distance code lengths
+            context->rxIndex = 0;
+            context->rxState = WS_INFLATE_STATE_DYN_LENS;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_DYN_LENS)
+      {
+         //Total number of code lengths
+         n = context->rxNumLitCodes + context->rxNumDistCodes;
+
+         //Decode the code lengths
+         if(context->rxIndex < n)
+         {
+            //Decode the next symbol
+            symbol = webSocketPeekSymbol(context, &context->rxLitTable, &length);
+
+            //Not enough data?
+            if(symbol == -1)
+               break;
+
+            //Check symbol value
+            if(symbol < 0)
+            {
+               //Invalid code
+               error = ERROR_INVALID_FRAME;
+            }
+            else if(symbol < 16)
+            {
+               //Code length of the next symbol
+               webSocketInflateGetBits(context, length);
+               context->rxLengths[context->rxIndex++] = symbol;
+            }
+            else
+            {
+               //Symbols 16, 17 and 18 use 2, 3 and 7 extra bits
+               value = (symbol == 16) ? 2 : (symbol == 17) ? 3 : 7;
+
+               //Not enough data?
+               if(context->rxBitCount < (length + value))
+                  break;
+
+               //Consume the symbol
+               webSocketInflateGetBits(context, length);
+
+               //Retrieve the repeat count
+               if(symbol == 18)
+                  value = webSocketInflateGetBits(context, value) + 11;
+               else
+                  value = webSocketInflateGetBits(context, value) + 3;
+
+               //Symbol 16 repeats the previous code length
+               if(symbol == 16 && context->rxIndex == 0)
+                  error = ERROR_INVALID_FRAME;
+               else if((context->rxIndex + value) > n)
+                  error = ERROR_INVALID_FRAME;
+
+               //Check status code
+               if(!error)
+               {
+                  //Code length to be repeated
+                  length = (symbol == 16) ? context->rxLengths[context->rxIndex - 1] : 0;
+
+                  //Repeat the code length
+                  while(value-- > 0)
+                  {
+                     context->rxLengths[context->rxIndex++] = length;
+                  }
+               }
+            }
+         }
+         else
+         {
+            //The end-of-block symbol must have a code
+            if(context->rxLengths[256] == 0)
+               error = ERROR_INVALID_FRAME;
+
+            //Build the literal/length decoding table
+            if(!error)
+            {
+               error = webSocketBuildHuffmanTable(&context->rxLitTable,
+                  context->rxLengths, context->rxNumLitCodes);
+            }
+
+            //Build the distance decoding table
+            if(!error)
+            {
+               error = webSocketBuildHuffmanTable(&context->rxDistTable,
+                  context->rxLengths + context->rxNumLitCodes,
+                  context->rxNumDistCodes);
+            }
+
+            //Decode the compressed data
+            context->rxState = WS_INFLATE_STATE_CODES;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_CODES)
+      {
+         //Decode the next literal/length symbol
+         symbol = webSocketPeekSymbol(context, &context->rxLitTable, &length);
+
+         //Not enough data?
+         if(symbol == -1)
+            break;
+
+         //Check symbol value
+         if(symbol < 0)
+         {
+            //Invalid code
+            error = ERROR_INVALID_FRAME;
+         }
+         else if(symbol < 256)
+         {
+            //The output buffer is full?
+            if(j >= outputSize)
+               break;
+
+            //Write the literal
+            webSocketInflateGetBits(context, length);
+            webSocketInflatePutByte(context, output + j++, symbol);
+         }
+         else if(symbol == 256)
+         {
+            //End of block
+            webSocketInflateGetBits(context, length);
+
+            //Last block?
+            if(context->rxFinalBlock)
+               context->rxState = WS_INFLATE_STATE_DONE;
+            else
+               context->rxState = WS_INFLATE_STATE_HEADER;
+         }
+         else if(symbol < 286)
+         {
+            //Number of extra bits
+            value = lengthExtra[symbol - 257];
+
+            //Not enough data?
+            if(context->rxBitCount < (length + value))
+               break;
+
+            //Retrieve the length of the match
+            webSocketInflateGetBits(context, length);
+            context->rxLength = lengthBase[symbol - 257] +
+               webSocketInflateGetBits(context, value);
+
+            //Decode the distance
+            context->rxState = WS_INFLATE_STATE_DIST;
+         }
+         else
+         {
+            //Invalid symbol
+            error = ERROR_INVALID_FRAME;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_DIST)
+      {
+         //Decode the next distance symbol
+         symbol = webSocketPeekSymbol(context, &context->rxDistTable, &length);
+
+         //Not enough data?
+         if(symbol == -1)
+            break;
+
+         //Check symbol value
+         if(symbol >= 0 && symbol < 30)
+         {
+            //Consume the symbol
+            webSocketInflateGetBits(context, length);
+            context->rxSymbol = symbol;
+
+            //Read the extra bits
+            context->rxState = WS_INFLATE_STATE_DIST_EXTRA;
+         }
+         else
+         {
+            //Invalid code
+            error = ERROR_INVALID_FRAME;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_DIST_EXTRA)
+      {
+         //Number of extra bits
+         value = distExtra[context->rxSymbol];
+
+         //Not enough data?
+         if(context->rxBitCount < value)
+            break;
+
+         //Retrieve the distance of the match
+         context->rxDistance = distBase[context->rxSymbol] +
+            webSocketInflateGetBits(context, value);
+
+         //The distance cannot exceed the amount of history nor the window
+         //size negotiated for the peer
+         if(context->rxDistance <= context->rxWindowLen &&
+            context->rxDistance <= (1U << context->rxWindowBits))
+         {
+            context->rxState = WS_INFLATE_STATE_COPY;
+         }
+         else
+         {
+            error = ERROR_INVALID_FRAME;
+         }
+      }
+      else if(context->rxState == WS_INFLATE_STATE_COPY)
+      {
+         //Copy the match from the sliding window
+         while(context->rxLength > 0 && j < outputSize)
+         {
+            //Retrieve the byte located at the specified distance
+            value = context->rxWindow[(context->rxWindowPos - context->rxDistance) &
+               (WEB_SOCKET_DEFLATE_WINDOW_SIZE - 1)];
+
+            //Write the byte
+            webSocketInflatePutByte(context, output + j++, value);
+            context->rxLength--;
+         }
+
+         //The output buffer is full?
+         if(context->rxLength > 0)
+            break;
+
+         //Decode the next symbol
+         context->rxState = WS_INFLATE_STATE_CODES;
+      }
+      else
+      {
+         //Any data following the final block are ignored
+         context->rxBitBuffer = 0;
+         context->rxBitCount = 0;
+         i = inputLen;
+         break;
+      }
+   }
+
+   //Malformed compressed data?
+   if(error)
+      error = ERROR_INVALID_FRAME;
+
+   //Return the number of bytes consumed and produced
+   *consumed = i;
+   *produced = j;
+
+   //Return status code
+   return error;
+}
+
+#endif
@@ -0,0 +1,232 @@
+/**
+ * @file web_socket_deflate.h
+ * @brief permessage-deflate extension (RFC 7692)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _WEB_SOCKET_DEFLATE_H
+#define _WEB_SOCKET_DEFLATE_H
+
+//Dependencies
+#include "core/net.h"
+#include "web_socket/web_socket.h"
+
+//Maximum size of the LZ77 sliding window (base-2 logarithm)
+#ifndef WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS
+   #define WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS 11
+#elif (WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS < 9 || WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS > 15)
+   #error WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS parameter is not valid
+#endif
+
+//Size of the hash table used to find matches (base-2 logarithm)
+#ifndef WEB_SOCKET_DEFLATE_HASH_BITS
+   #define WEB_SOCKET_DEFLATE_HASH_BITS 10
+#elif (WEB_SOCKET_DEFLATE_HASH_BITS < 8 || WEB_SOCKET_DEFLATE_HASH_BITS > 15)
+   #error WEB_SOCKET_DEFLATE_HASH_BITS parameter is not valid
+#endif
+
+//Maximum number of hash chain entries examined for each match
+#ifndef WEB_SOCKET_DEFLATE_MAX_CHAIN
+   #define WEB_SOCKET_DEFLATE_MAX_CHAIN 16
+#elif (WEB_SOCKET_DEFLATE_MAX_CHAIN < 1)
+   #error WEB_SOCKET_DEFLATE_MAX_CHAIN parameter is not valid
+#endif
+
+//Size of the buffer that holds compressed data
+#ifndef WEB_SOCKET_DEFLATE_BUFFER_SIZE
+   #define WEB_SOCKET_DEFLATE_BUFFER_SIZE 512
+#elif (WEB_SOCKET_DEFLATE_BUFFER_SIZE < 64)
+   #error WEB_SOCKET_DEFLATE_BUFFER_SIZE parameter is not valid
+#endif
+
+//Size of the LZ77 sliding window
+#define WEB_SOCKET_DEFLATE_WINDOW_SIZE (1 << WEB_SOCKET_DEFLATE_MAX_WINDOW_BITS)
+//Size of the hash table
+#define WEB_SOCKET_DEFLATE_HASH_SIZE (1 << WEB_SOCKET_DEFLATE_HASH_BITS)
+
+//Range of window sizes allowed by the extension (base-2 logarithm)
+#define WS_DEFLATE_MIN_WINDOW_BITS 8
+#define WS_DEFLATE_MAX_WINDOW_BITS 15
+
+//Minimum and maximum length of a match
+#define WEB_SOCKET_DEFLATE_MIN_MATCH 3
+#define WEB_SOCKET_DEFLATE_MAX_MATCH 258
+//Amount of lookahead required to find the longest possible match
+#define WEB_SOCKET_DEFLATE_MIN_LOOKAHEAD (WEB_SOCKET_DEFLATE_MAX_MATCH + WEB_SOCKET_DEFLATE_MIN_MATCH + 1)
+//Room kept at the end of the buffer for one symbol and a flush sequence
+#define WEB_SOCKET_DEFLATE_MARGIN 16
+
+//RSV1 bit (compressed message)
+#define WEB_SOCKET_RSV1 0x04
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Decompressor states
+ **/
+
+typedef enum
+{
+   WS_INFLATE_STATE_HEADER        = 0,
+   WS_INFLATE_STATE_STORED_LEN    = 1,
+   WS_INFLATE_STATE_STORED_COPY   = 2,
+   WS_INFLATE_STATE_DYN_HEADER    = 3,
+   WS_INFLATE_STATE_DYN_CODE_LENS = 4,
+   WS_INFLATE_STATE_DYN_LENS      = 5,
+   WS_INFLATE_STATE_CODES         = 6,
+   WS_INFLATE_STATE_DIST          = 7,
+   WS_INFLATE_STATE_DIST_EXTRA    = 8,
+   WS_INFLATE_STATE_COPY          = 9,
+   WS_INFLATE_STATE_DONE          = 10
+} WebSocketInflateState;
+
+
+/**
+ * @brief Canonical Huffman decoding table
+ **/
+
+typedef struct
+{
+   uint16_t count[16]; ///<Number of codes of each length
+   uint16_t *symbol;   ///<Symbols ordered by code
+} WebSocketHuffmanTable;
+
+
+/**
+ * @brief permessage-deflate context
+ **/
+
+struct _WebSocketDeflateContext
+{
+   uint_t txWindowBits;                                ///<LZ77 window size used by the local compressor
+   uint_t rxWindowBits;                                ///<LZ77 window size used by the remote compressor
+   bool_t txNoContextTakeover;                         ///<Reset the compressor after each message
+   bool_t rxNoContextTakeover;                         ///<Reset the decompressor after each message
+   uint8_t txWindow[2 * WEB_SOCKET_DEFLATE_WINDOW_SIZE];
+   uint16_t txHead[WEB_SOCKET_DEFLATE_HASH_SIZE];
+   uint16_t txPrev[WEB_SOCKET_DEFLATE_WINDOW_SIZE];
+   size_t txWindowLen;                                 ///<Number of bytes in the sliding window
+   size_t txWindowPos;                                 ///<Position of the next byte to encode
+   uint32_t txBitBuffer;
+   uint_t txBitCount;
+   bool_t txBlockOpen;                                 ///<A compressed block has been started
+   bool_t txMessageOpen;                               ///<The first frame of the message has been sent
+   bool_t txFin;                                       ///<FIN flag of the pending frame
+   systime_t txMessageTime;                            ///<Time spent compressing the current message
+   uint8_t txBuffer[WEB_SOCKET_DEFLATE_BUFFER_SIZE];   ///<Compressed data
+   size_t txBufferLen;
+   size_t txBufferPos;
+   uint8_t rxWindow[WEB_SOCKET_DEFLATE_WINDOW_SIZE];
+   uint_t rxWindowPos;                                 ///<Current position in the circular window
+   uint_t rxWindowLen;                                 ///<Number of bytes of history
+   WebSocketInflateState rxState;
+   uint32_t rxBitBuffer;
+   uint_t rxBitCount;
+   bool_t rxFinalBlock;
+   bool_t rxTrailer;                                   ///<The 4-byte trailer has been appended
+   uint_t rxLength;                                    ///<Remaining length of the current block or match
+   uint_t rxDistance;                                  ///<Distance of the current match
+   uint_t rxSymbol;                                    ///<Current distance symbol
+   uint_t rxNumLitCodes;
+   uint_t rxNumDistCodes;
+   uint_t rxNumCodeLenCodes;
+   uint_t rxIndex;
+   systime_t rxMessageTime;                            ///<Time spent decompressing the current message
+   uint8_t rxLengths[320];
+   uint16_t rxLitSymbols[288];
+   uint16_t rxDistSymbols[32];
+   WebSocketHuffmanTable rxLitTable;
+   WebSocketHuffmanTable rxDistTable;
+   WebSocketDeflateStats stats;
+};
+
+
+//permessage-deflate related functions
+error_t webSocketInitDeflateContext(WebSocket *webSocket, uint_t txWindowBits,
+   uint_t rxWindowBits, bool_t txNoContextTakeover, bool_t rxNoContextTakeover);
+
+void webSocketReleaseDeflateContext(WebSocket *webSocket);
+
+error_t webSocketParseWindowBits(char_t *value, uint_t *windowBits);
+error_t webSocketParseExtensionsField(WebSocket *webSocket, char_t *value);
+size_t webSocketAddExtensionsField(WebSocket *webSocket, char_t *output);
+
+error_t webSocketSendDeflateFrame(WebSocket *webSocket,
+   WebSocketFrameType type);
+
+error_t webSocketSendCompressedData(WebSocket *webSocket, const void *data,
+   size_t length, WebSocketFrameType type, size_t *written,
+   bool_t firstFrag, bool_t lastFrag);
+
+error_t webSocketReceiveCompressedData(WebSocket *webSocket, void *data,
+   size_t size, size_t *received);
+
+void webSocketResetCompressor(WebSocketDeflateContext *context);
+size_t webSocketDeflateFill(WebSocketDeflateContext *context,
+   const uint8_t *data, size_t length);
+
+void webSocketDeflatePutBits(WebSocketDeflateContext *context,
+   uint32_t value, uint_t length);
+
+void webSocketDeflatePutCode(WebSocketDeflateContext *context,
+   uint_t code, uint_t length);
+
+void webSocketDeflatePutSymbol(WebSocketDeflateContext *context, uint_t symbol);
+
+void webSocketDeflatePutMatch(WebSocketDeflateContext *context,
+   uint_t length, uint_t distance);
+
+void webSocketDeflateData(WebSocketDeflateContext *context, bool_t flush);
+void webSocketDeflateFlush(WebSocketDeflateContext *context, bool_t final);
+
+void webSocketResetDecompressor(WebSocketDeflateContext *context);
+
+error_t webSocketBuildHuffmanTable(WebSocketHuffmanTable *table,
+   const uint8_t *lengths, uint_t n);
+
+int_t webSocketPeekSymbol(WebSocketDeflateContext *context,
+   const WebSocketHuffmanTable *table, uint_t *length);
+
+uint_t webSocketInflateGetBits(WebSocketDeflateContext *context, uint_t length);
+
+void webSocketInflatePutByte(WebSocketDeflateContext *context,
+   uint8_t *output, uint8_t c);
+
+error_t webSocketInflateData(WebSocketDeflateContext *context,
+   const uint8_t *input, size_t inputLen, size_t *consumed,
+   uint8_t *output, size_t outputSize, size_t *produced);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
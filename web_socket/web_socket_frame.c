@@ -37,6 +37,7 @@
 #include "web_socket/web_socket_frame.h"
 #include "web_socket/web_socket_transport.h"
 #include "web_socket/web_socket_misc.h"
+#include "web_socket/web_socket_deflate.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -75,6 +76,12 @@ error_t webSocketFormatFrameHeader(WebSocket *webSocket,
    frame->reserved = 0;
    frame->opcode = type;
 
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //The RSV1 bit is set on the first frame of a compressed message
+   if(txContext->compressed && type != WS_FRAME_TYPE_CONTINUATION)
+      frame->reserved = WEB_SOCKET_RSV1;
+#endif
+
    //All frames sent from the client to the server are masked by a 32-bit
    //value that is contained within the frame
    if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
@@ -168,6 +175,201 @@ error_t webSocketFormatFrameHeader(WebSocket *webSocket,
 }
 
 
+/**
+ * @brief Send a WebSocket frame
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] data Pointer to the payload data
+ * @param[in] length Length of the payload data
+ * @param[in] type Frame type
+ * @param[in] fin FIN flag
+ * @param[out] written Actual number of bytes written
+ * @return Error code
+ **/
+
+error_t webSocketSendFrame(WebSocket *webSocket, const uint8_t *data,
+   size_t length, WebSocketFrameType type, bool_t fin, size_t *written)
+{
+   WebSocketIoVec iov;
+
+   //The payload is held in a single buffer
+   iov.data = data;
+   iov.length = length;
+
+   //Send the WebSocket frame
+   return webSocketSendFrameV(webSocket, &iov, 1, type, fin, written);
+}
+
+
+/**
+ * @brief Send a WebSocket frame whose payload is split across several buffers
+ * @param[in] webSocket Handle to a WebSocket
+ * @param[in] iov Array of buffers holding the payload data
+ * @param[in] iovCount Number of entries in the array
+ * @param[in] type Frame type
+ * @param[in] fin FIN flag
+ * @param[out] written Actual number of bytes written
+ * @return Error code
+ **/
+
+error_t webSocketSendFrameV(WebSocket *webSocket, const WebSocketIoVec *iov,
+   uint_t iovCount, WebSocketFrameType type, bool_t fin, size_t *written)
+{
+   error_t error;
+   uint_t k;
+   size_t i;
+   size_t j;
+   size_t n;
+   size_t length;
+   const uint8_t *p;
+   WebSocketFrameContext *txContext;
+
+   //Point to the TX context
+   txContext = &webSocket->txContext;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Calculate the total length of the payload
+   for(length = 0, k = 0; k < iovCount; k++)
+      length += iov[k].length;
+
+   //No data has been transmitted yet
+   i = 0;
+   //Point to the first buffer
+   k = 0;
+   j = 0;
+
+   //Send as much data as possible
+   while(1)
+   {
+      //Skip the buffers that have been entirely transmitted
+      while(k < iovCount && j >= iov[k].length)
+      {
+         k++;
+         j = 0;
+      }
+
+      //Point to the application data to be written
+      p = (k < iovCount) ? (const uint8_t *) iov[k].data + j : NULL;
+
+      //Check current sub-state
+      if(txContext->state == WS_SUB_STATE_INIT)
+      {
+         //Format WebSocket frame header
+         error = webSocketFormatFrameHeader(webSocket, fin, type, length - i);
+
+         //Send the frame header
+         txContext->state = WS_SUB_STATE_FRAME_HEADER;
+      }
+      else if(txContext->state == WS_SUB_STATE_FRAME_HEADER)
+      {
+         //Any remaining data to be sent?
+         if(txContext->bufferPos < txContext->bufferLen)
+         {
+            //The header is held back so that it can be coalesced with the
+            //first bytes of the payload in the same TCP segment
+            error = webSocketSendData(webSocket,
+               txContext->buffer + txContext->bufferPos,
+               txContext->bufferLen - txContext->bufferPos, &n,
+               (txContext->payloadLen > 0) ? SOCKET_FLAG_DELAY : 0);
+
+            //Advance data pointer
+            txContext->bufferPos += n;
+         }
+         else
+         {
+            //Flush the transmit buffer
+            txContext->payloadPos = 0;
+            txContext->bufferPos = 0;
+            txContext->bufferLen = 0;
+
+            //Send the payload of the WebSocket frame
+            txContext->state = WS_SUB_STATE_FRAME_PAYLOAD;
+         }
+      }
+      else if(txContext->state == WS_SUB_STATE_FRAME_PAYLOAD)
+      {
+         //Any remaining data to be sent?
+         if(txContext->bufferPos < txContext->bufferLen)
+         {
+            //Send more data
+            error = webSocketSendData(webSocket,
+               txContext->buffer + txContext->bufferPos,
+               txContext->bufferLen - txContext->bufferPos, &n, 0);
+
+            //Advance data pointer
+            txContext->payloadPos += n;
+            txContext->bufferPos += n;
+
+            //Total number of data that have been written
+            i += n;
+            j += n;
+         }
+         else if(txContext->payloadPos < txContext->payloadLen && p != NULL)
+         {
+            //Calculate the number of bytes that are pending in the
+            //current buffer
+            n = MIN(iov[k].length - j, txContext->payloadLen - txContext->payloadPos);
+
+            //All frames sent from the client to the server are masked
+            if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
+            {
+               //Limit the number of bytes to be copied at a time
+               n = MIN(n, WEB_SOCKET_BUFFER_SIZE);
+
+               //Copy application data to the transmit buffer and apply
+               //masking in a single pass
+               webSocketApplyMask(txContext->buffer, p, n,
+                  txContext->maskingKey, txContext->payloadPos);
+
+               //Rewind to the beginning of the buffer
+               txContext->bufferPos = 0;
+               //Update the number of data buffered but not yet sent
+               txContext->bufferLen = n;
+            }
+            else
+            {
+               //Unmasked payload data are passed directly to the transport
+               //layer, without going through the transmit buffer
+               error = webSocketSendData(webSocket, p, n, &n, 0);
+
+               //Advance data pointer
+               txContext->payloadPos += n;
+
+               //Total number of data that have been written
+               i += n;
+               j += n;
+            }
+         }
+         else
+         {
+            //Prepare to send a new WebSocket frame
+            txContext->state = WS_SUB_STATE_INIT;
+
+            //Write operation complete?
+            if(i >= length)
+               break;
+         }
+      }
+      else
+      {
+         //Invalid state
+         error = ERROR_WRONG_STATE;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+   }
+
+   //Total number of data that have been written
+   *written = i;
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Parse WebSocket frame header
  * @param[in] webSocket Handle to a WebSocket
@@ -179,9 +381,9 @@ error_t webSocketFormatFrameHeader(WebSocket *webSocket,
 error_t webSocketParseFrameHeader(WebSocket *webSocket,
    const WebSocketFrame *frame, WebSocketFrameType *type)
 {
-   size_t j;
    size_t k;
    size_t n;
+   uint_t reserved;
    uint16_t statusCode;
    WebSocketFrameContext *rxContext;
 
@@ -259,10 +461,29 @@ error_t webSocketParseFrameHeader(WebSocket *webSocket,
       webSocket->utf8Context.utf8CodePoint = 0;
    }
 
+   //Retrieve the RSV field
+   reserved = frame->reserved;
+
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //The permessage-deflate extension defines the meaning of the RSV1 bit
+   if(webSocket->deflateContext != NULL)
+   {
+      //The RSV1 bit is set on the first frame of a compressed message
+      if(frame->opcode == WS_FRAME_TYPE_TEXT ||
+         frame->opcode == WS_FRAME_TYPE_BINARY)
+      {
+         //Check whether the message is compressed
+         rxContext->compressed = (reserved & WEB_SOCKET_RSV1) ? TRUE : FALSE;
+         //Clear the RSV1 bit
+         reserved &= ~WEB_SOCKET_RSV1;
+      }
+   }
+#endif
+
    //If the RSV field is a nonzero value and none of the negotiated extensions
    //defines the meaning of such a nonzero value, the receiving endpoint must
    //fail the WebSocket connection
-   if(frame->reserved != 0)
+   if(reserved != 0)
    {
       //Report a protocol error
       webSocket->statusCode = WS_STATUS_CODE_PROTOCOL_ERROR;
@@ -318,13 +539,8 @@ error_t webSocketParseFrameHeader(WebSocket *webSocket,
          if(frame->mask)
          {
             //Unmask the data
-            for(j = 0; j < rxContext->payloadLen; j++)
-            {
-               //Index of the masking key to be applied
-               k = j % 4;
-               //Convert masked data into unmasked data
-               *((uint8_t *) frame + n + j) ^= rxContext->maskingKey[k];
-            }
+            webSocketApplyMask((uint8_t *) frame + n, (uint8_t *) frame + n,
+               rxContext->payloadLen, rxContext->maskingKey, 0);
          }
 
          //If there is a body, the first two bytes of the body must be
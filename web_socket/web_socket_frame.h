@@ -44,6 +44,12 @@ extern "C" {
 error_t webSocketFormatFrameHeader(WebSocket *webSocket,
    bool_t fin, WebSocketFrameType type, size_t payloadLen);
 
+error_t webSocketSendFrame(WebSocket *webSocket, const uint8_t *data,
+   size_t length, WebSocketFrameType type, bool_t fin, size_t *written);
+
+error_t webSocketSendFrameV(WebSocket *webSocket, const WebSocketIoVec *iov,
+   uint_t iovCount, WebSocketFrameType type, bool_t fin, size_t *written);
+
 error_t webSocketParseFrameHeader(WebSocket *webSocket,
    const WebSocketFrame *frame, WebSocketFrameType *type);
 
@@ -39,6 +39,7 @@
 #include "web_socket/web_socket_frame.h"
 #include "web_socket/web_socket_transport.h"
 #include "web_socket/web_socket_misc.h"
+#include "web_socket/web_socket_deflate.h"
 #include "encoding/base64.h"
 #include "hash/sha1.h"
 #include "str.h"
@@ -163,6 +164,11 @@ error_t webSocketParseHandshake(WebSocket *webSocket)
          webSocket->authContext.stale = FALSE;
 #endif
 
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+         //Extensions are negotiated again on each handshake
+         webSocketReleaseDeflateContext(webSocket);
+#endif
+
          //Client or server operation?
          if(webSocket->endpoint == WS_ENDPOINT_CLIENT)
          {
@@ -570,6 +576,14 @@ error_t webSocketParseHeaderField(WebSocket *webSocket, char_t *line)
                WEB_SOCKET_SERVER_KEY_SIZE + 1);
          }
       }
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+      //Sec-WebSocket-Extensions header field found?
+      else if(!strcasecmp(name, "Sec-WebSocket-Extensions"))
+      {
+         //Parse Sec-WebSocket-Extensions header field
+         return webSocketParseExtensionsField(webSocket, value);
+      }
+#endif
 #if (WEB_SOCKET_BASIC_AUTH_SUPPORT == ENABLED || WEB_SOCKET_DIGEST_AUTH_SUPPORT == ENABLED)
       //WWW-Authenticate header field found?
       else if(!strcasecmp(name, "WWW-Authenticate"))
@@ -696,6 +710,11 @@ error_t webSocketFormatClientHandshake(WebSocket *webSocket, uint16_t serverPort
    p += sprintf(p, "Sec-WebSocket-Key: %s\r\n",
       webSocket->handshakeContext.clientKey);
 
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //Add Sec-WebSocket-Extensions header field
+   p += webSocketAddExtensionsField(webSocket, p);
+#endif
+
    //Add Sec-WebSocket-Version header field
    p += sprintf(p, "Sec-WebSocket-Version: 13\r\n");
    //An empty line indicates the end of the header fields
@@ -748,6 +767,11 @@ error_t webSocketFormatServerHandshake(WebSocket *webSocket)
    p += sprintf(p, "Sec-WebSocket-Accept: %s\r\n",
       webSocket->handshakeContext.serverKey);
 
+#if (WEB_SOCKET_DEFLATE_SUPPORT == ENABLED)
+   //Add Sec-WebSocket-Extensions header field
+   p += webSocketAddExtensionsField(webSocket, p);
+#endif
+
    //An empty line indicates the end of the header fields
    p += sprintf(p, "\r\n");
 
@@ -1359,4 +1383,75 @@ bool_t webSocketCheckUtf8Stream(WebSocketUtf8Context *context,
    return valid;
 }
 
+
+/**
+ * @brief Apply the masking key to payload data
+ *
+ * The data are copied and masked in a single pass. Once the output pointer
+ * is 32-bit aligned, the masking key is applied a word at a time. Since
+ * masking is an XOR operation, the same function is used to unmask
+ * received data
+ *
+ * @param[out] output Output buffer (may be the same as the input buffer)
+ * @param[in] input Data to be masked or unmasked
+ * @param[in] length Number of bytes to process
+ * @param[in] maskingKey 32-bit masking key
+ * @param[in] offset Position of the first byte within the payload data
+ **/
+
+void webSocketApplyMask(uint8_t *output, const uint8_t *input, size_t length,
+   const uint8_t *maskingKey, size_t offset)
+{
+   size_t i;
+   uint32_t a;
+   uint32_t b;
+   uint32_t m;
+   uint8_t mask[4];
+
+   //Process the leading bytes until the output pointer is 32-bit aligned
+   for(i = 0; i < length && ((size_t) (output + i) & 3) != 0; i++)
+   {
+      output[i] = input[i] ^ maskingKey[(offset + i) & 3];
+   }
+
+   //Rotate the masking key so that mask[0] applies to the current byte
+   mask[0] = maskingKey[(offset + i) & 3];
+   mask[1] = maskingKey[(offset + i + 1) & 3];
+   mask[2] = maskingKey[(offset + i + 2) & 3];
+   mask[3] = maskingKey[(offset + i + 3) & 3];
+
+   //The masking key is stored in memory order, so that the result does
+   //not depend on the endianness of the CPU
+   memcpy(&m, mask, sizeof(uint32_t));
+
+   //Process 8 bytes at a time. Words are moved with memcpy, which avoids
+   //misaligned and type-punned accesses while still compiling to single
+   //word loads and stores
+   while((length - i) >= 8)
+   {
+      memcpy(&a, input + i, sizeof(uint32_t));
+      memcpy(&b, input + i + 4, sizeof(uint32_t));
+      a ^= m;
+      b ^= m;
+      memcpy(output + i, &a, sizeof(uint32_t));
+      memcpy(output + i + 4, &b, sizeof(uint32_t));
+      i += 8;
+   }
+
+   //Process 4 bytes at a time
+   while((length - i) >= 4)
+   {
+      memcpy(&a, input + i, sizeof(uint32_t));
+      a ^= m;
+      memcpy(output + i, &a, sizeof(uint32_t));
+      i += 4;
+   }
+
+   //Process the trailing bytes
+   for(m = 0; i < length; i++, m++)
+   {
+      output[i] = input[i] ^ mask[m];
+   }
+}
+
 #endif
@@ -85,6 +85,9 @@ error_t webSocketDecodePercentEncodedString(const char_t *input,
 bool_t webSocketCheckUtf8Stream(WebSocketUtf8Context *context,
    const uint8_t *data, size_t length, size_t remaining);
 
+void webSocketApplyMask(uint8_t *output, const uint8_t *input, size_t length,
+   const uint8_t *maskingKey, size_t offset);
+
 //C++ guard
 #ifdef __cplusplus
 }